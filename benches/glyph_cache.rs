@@ -5,6 +5,7 @@
 use std::collections::HashMap;
 
 use fontdue::{Font, FontSettings, Metrics};
+use token::view::GlyphCache as GlyphAtlas;
 
 #[global_allocator]
 static ALLOC: divan::AllocProfiler = divan::AllocProfiler::system();
@@ -107,6 +108,76 @@ fn glyph_cache_lookup_after_warmup(text_repeats: usize) {
     }
 }
 
+// ============================================================================
+// Packed atlas (token::view::GlyphCache)
+// ============================================================================
+
+fn warm_atlas(font: &Font, font_size: f32, chars: impl Iterator<Item = char>) -> GlyphAtlas {
+    let mut atlas = GlyphAtlas::new();
+    for ch in chars {
+        atlas.get_or_insert_with(ch, font_size.to_bits(), || font.rasterize(ch, font_size));
+    }
+    atlas
+}
+
+/// Hit path for ASCII text, served from the direct-indexed table
+#[divan::bench(args = [100, 500, 1000])]
+fn atlas_lookup_ascii_hit(bencher: divan::Bencher, text_repeats: usize) {
+    let font = load_test_font();
+    let font_size = 16.0_f32;
+    let mut atlas = warm_atlas(&font, font_size, ' '..='~');
+    let text = "The quick brown fox jumps over the lazy dog.\n".repeat(text_repeats);
+
+    bencher.bench_local(|| {
+        let mut coverage = 0usize;
+        for ch in text.chars() {
+            let (glyph, _) = atlas.get_or_insert_with(ch, font_size.to_bits(), || unreachable!());
+            coverage += glyph.rows().map(|row| row.len()).sum::<usize>();
+        }
+        divan::black_box(coverage)
+    });
+}
+
+/// Hit path for CJK text, served through the hash index
+#[divan::bench(args = [100, 500])]
+fn atlas_lookup_cjk_hit(bencher: divan::Bencher, text_repeats: usize) {
+    let font = load_test_font();
+    let font_size = 16.0_f32;
+    let line = "日本語のテキストを表示する。漢字、ひらがな、カタカナ。\n";
+    let mut atlas = warm_atlas(&font, font_size, line.chars());
+    let text = line.repeat(text_repeats);
+
+    bencher.bench_local(|| {
+        for ch in text.chars() {
+            divan::black_box(atlas.get_or_insert_with(ch, font_size.to_bits(), || unreachable!()));
+        }
+    });
+}
+
+/// Cold start: rasterize and pack printable ASCII into an empty atlas
+#[divan::bench(args = [12.0, 16.0, 24.0])]
+fn atlas_cold_fill_ascii(bencher: divan::Bencher, font_size: f32) {
+    let font = load_test_font();
+
+    bencher.bench_local(|| divan::black_box(warm_atlas(&font, font_size, ' '..='~')));
+}
+
+/// Cold start that overflows a small budget, exercising shelf eviction
+#[divan::bench]
+fn atlas_cold_fill_with_eviction(bencher: divan::Bencher) {
+    let font = load_test_font();
+    let font_size = 16.0_f32;
+    let chars: Vec<char> = (0x4e00..0x4e00 + 4000).filter_map(char::from_u32).collect();
+
+    bencher.bench_local(|| {
+        let mut atlas = GlyphAtlas::with_max_bytes(64 * 1024);
+        for &ch in &chars {
+            atlas.get_or_insert_with(ch, font_size.to_bits(), || font.rasterize(ch, font_size));
+        }
+        divan::black_box(atlas.memory_bytes())
+    });
+}
+
 // ============================================================================
 // HashMap lookup patterns (cache-only, no rasterization)
 // ============================================================================
@@ -2,7 +2,10 @@
 //!
 //! Run with: cargo bench rendering
 
+use divan::counter::ItemsCount;
+use token::model::editor_area::Rect;
 use token::rendering::blend_pixel_u8;
+use token::view::{Frame, LineRenderCache};
 
 #[global_allocator]
 static ALLOC: divan::AllocProfiler = divan::AllocProfiler::system();
@@ -225,3 +228,117 @@ fn render_cursors(cursor_count: usize) {
     }
     divan::black_box(&buffer);
 }
+
+// ============================================================================
+// Frame row kernels (throughput in pixels per second)
+// ============================================================================
+
+/// 1080p, 1440p and 4K frames
+const FRAME_WIDTHS: [usize; 3] = [1920, 2560, 3840];
+
+fn full_frame(width: usize) -> (Vec<u32>, usize, Rect) {
+    let height = width * 9 / 16;
+    let rect = Rect::new(0.0, 0.0, width as f32, height as f32);
+    (vec![0xFF1E1E2E; width * height], height, rect)
+}
+
+#[divan::bench(args = FRAME_WIDTHS)]
+fn frame_fill_rect(bencher: divan::Bencher, width: usize) {
+    let (mut buffer, height, rect) = full_frame(width);
+
+    bencher
+        .counter(ItemsCount::new(width * height))
+        .bench_local(|| {
+            let mut frame = Frame::new(&mut buffer, width, height);
+            frame.fill_rect(rect, 0xFF45475A);
+        });
+}
+
+#[divan::bench(args = FRAME_WIDTHS)]
+fn frame_blend_rect(bencher: divan::Bencher, width: usize) {
+    let (mut buffer, height, rect) = full_frame(width);
+
+    bencher
+        .counter(ItemsCount::new(width * height))
+        .bench_local(|| {
+            let mut frame = Frame::new(&mut buffer, width, height);
+            frame.blend_rect(rect, 0x6045475A);
+        });
+}
+
+#[divan::bench(args = FRAME_WIDTHS)]
+fn frame_dim(bencher: divan::Bencher, width: usize) {
+    let (mut buffer, height, _) = full_frame(width);
+
+    bencher
+        .counter(ItemsCount::new(width * height))
+        .bench_local(|| {
+            let mut frame = Frame::new(&mut buffer, width, height);
+            frame.dim(96);
+        });
+}
+
+/// Per-pixel `blend_pixel` loop the row kernels are checked against
+#[divan::bench(args = FRAME_WIDTHS)]
+fn frame_blend_pixel_reference(bencher: divan::Bencher, width: usize) {
+    let (mut buffer, height, _) = full_frame(width);
+
+    bencher
+        .counter(ItemsCount::new(width * height))
+        .bench_local(|| {
+            let mut frame = Frame::new(&mut buffer, width, height);
+            for y in 0..height {
+                for x in 0..width {
+                    frame.blend_pixel(x, y, 0x6045475A);
+                }
+            }
+        });
+}
+
+/// A screen of 10×16 glyph rows blitted through the coverage kernel
+#[divan::bench(args = FRAME_WIDTHS)]
+fn frame_glyph_coverage_blit(bencher: divan::Bencher, width: usize) {
+    let (mut buffer, height, _) = full_frame(width);
+    let glyph_row: Vec<u8> = (0..10).map(|i| (i * 29 % 256) as u8).collect();
+    let glyphs_per_line = width / 10;
+    let lines = height / 20;
+
+    bencher
+        .counter(ItemsCount::new(glyphs_per_line * lines * 10 * 16))
+        .bench_local(|| {
+            let mut frame = Frame::new(&mut buffer, width, height);
+            for line in 0..lines {
+                for gy in 0..16 {
+                    let y = (line * 20 + 2 + gy) as isize;
+                    for col in 0..glyphs_per_line {
+                        frame.blend_coverage_span((col * 10) as isize, y, &glyph_row, 0xFFCDD6F4);
+                    }
+                }
+            }
+        });
+}
+
+/// The same screen of 20px text lines served from the line render cache
+#[divan::bench(args = FRAME_WIDTHS)]
+fn frame_line_cache_blit(bencher: divan::Bencher, width: usize) {
+    let (mut buffer, height, _) = full_frame(width);
+    let lines = height / 20;
+    let mut cache = LineRenderCache::new();
+    {
+        let frame = Frame::new(&mut buffer, width, height);
+        for line in 0..lines {
+            cache.store(line as u64, &frame, 0, line * 20, width, 20);
+        }
+    }
+
+    bencher
+        .counter(ItemsCount::new(width * lines * 20))
+        .bench_local(|| {
+            let mut frame = Frame::new(&mut buffer, width, height);
+            cache.begin_frame();
+            for line in 0..lines {
+                let key = (lines - 1 - line) as u64;
+                divan::black_box(cache.blit(key, &mut frame, 0, line * 20, width, 20));
+            }
+        });
+}
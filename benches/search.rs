@@ -3,6 +3,9 @@
 //! Run with: cargo bench search
 
 use ropey::Rope;
+use token::model::Document;
+use token::syntax::TextEdit;
+use token::util::{MatchIndex, SearchQuery};
 
 #[global_allocator]
 static ALLOC: divan::AllocProfiler = divan::AllocProfiler::system();
@@ -233,3 +236,137 @@ fn search_whole_word(line_count: usize) {
     }
     divan::black_box(matches);
 }
+
+// ============================================================================
+// Rope-chunk search engine (token::util::SearchQuery)
+// ============================================================================
+
+fn large_rope(line_count: usize) -> Rope {
+    Rope::from_str(&"The quick brown fox jumps over the lazy dog.\n".repeat(line_count))
+}
+
+#[divan::bench(args = [100_000, 1_000_000, 2_000_000])]
+fn rope_chunks_literal(bencher: divan::Bencher, line_count: usize) {
+    let rope = large_rope(line_count);
+    let query = SearchQuery::new("lazy", true).unwrap();
+
+    bencher.bench_local(|| divan::black_box(query.find_all(&rope)));
+}
+
+#[divan::bench(args = [100_000, 1_000_000, 2_000_000])]
+fn rope_chunks_case_insensitive(bencher: divan::Bencher, line_count: usize) {
+    let rope = large_rope(line_count);
+    let query = SearchQuery::new("THE", false).unwrap();
+
+    bencher.bench_local(|| divan::black_box(query.find_all(&rope)));
+}
+
+#[divan::bench(args = [100_000, 1_000_000])]
+fn rope_chunks_unicode_case_insensitive(bencher: divan::Bencher, line_count: usize) {
+    let rope = Rope::from_str(&"Grüße aus München, über den Fluss.\n".repeat(line_count));
+    let query = SearchQuery::new("ÜBER", false).unwrap();
+
+    bencher.bench_local(|| divan::black_box(query.find_all(&rope)));
+}
+
+#[divan::bench(args = [1_000_000])]
+fn rope_chunks_rare_pattern(bencher: divan::Bencher, line_count: usize) {
+    let rope = large_rope(line_count);
+    let query = SearchQuery::new("xyzzyx", true).unwrap();
+
+    bencher.bench_local(|| {
+        let matches = query.find_all(&rope);
+        assert!(matches.is_empty());
+        divan::black_box(matches)
+    });
+}
+
+#[divan::bench(args = [1_000_000])]
+fn rope_chunks_count_only(bencher: divan::Bencher, line_count: usize) {
+    let rope = large_rope(line_count);
+    let query = SearchQuery::new("the", true).unwrap();
+
+    bencher.bench_local(|| {
+        let mut count = 0;
+        query.for_each_match(&rope, |_, _| {
+            count += 1;
+            true
+        });
+        divan::black_box(count)
+    });
+}
+
+/// Find-next from the middle of the document stops at the first match
+#[divan::bench(args = [1_000_000])]
+fn document_find_next_from_middle(bencher: divan::Bencher, line_count: usize) {
+    let doc =
+        Document::with_text(&"The quick brown fox jumps over the lazy dog.\n".repeat(line_count));
+    let middle = doc.buffer.len_chars() / 2;
+
+    bencher.bench_local(|| {
+        divan::black_box(doc.find_next_occurrence_with_options("fox", middle, false))
+    });
+}
+
+/// Baseline for the engine above: flatten the rope and search the `String`
+#[divan::bench(args = [100_000, 1_000_000])]
+fn flattened_string_literal(bencher: divan::Bencher, line_count: usize) {
+    let rope = large_rope(line_count);
+
+    bencher.bench_local(|| {
+        let haystack = rope.to_string();
+        let matches: Vec<usize> = haystack.match_indices("lazy").map(|(i, _)| i).collect();
+        divan::black_box(matches)
+    });
+}
+
+// ============================================================================
+// Incremental match index (token::util::MatchIndex)
+// ============================================================================
+
+/// Patch the index for one typed char in the middle of the document
+#[divan::bench(args = [100_000, 1_000_000])]
+fn match_index_keystroke(bencher: divan::Bencher, line_count: usize) {
+    let mut rope = large_rope(line_count);
+    let mut index = MatchIndex::build("fox", true, &rope, 0).unwrap();
+    let middle = rope.len_chars() / 2;
+    let mut revision = 0;
+
+    bencher.bench_local(|| {
+        // Alternate insert and delete so the document doesn't grow
+        let edit = if revision % 2 == 0 {
+            rope.insert(middle, "x");
+            TextEdit::insert(middle, "x")
+        } else {
+            rope.remove(middle..middle + 1);
+            TextEdit::delete(middle, 1)
+        };
+        assert!(index.apply_edits(&rope, revision, revision + 1, &[edit]));
+        revision += 1;
+        divan::black_box(index.len())
+    });
+}
+
+/// Rescan after the same keystroke, for comparison
+#[divan::bench(args = [100_000, 1_000_000])]
+fn match_index_rebuild(bencher: divan::Bencher, line_count: usize) {
+    let rope = large_rope(line_count);
+
+    bencher.bench_local(|| {
+        divan::black_box(MatchIndex::build("fox", true, &rope, 0).map(|m| m.len()))
+    });
+}
+
+// ============================================================================
+// Find in files
+// ============================================================================
+
+/// Scan one file's text for a rare match, as find-in-files does per file
+#[divan::bench(args = [true, false])]
+fn find_in_files_scan_text(bencher: divan::Bencher, case_sensitive: bool) {
+    let mut text = "The quick brown fox jumps over the lazy dog.\n".repeat(100_000);
+    text.push_str("let needle = 1;\n");
+    let query = SearchQuery::new("needle", case_sensitive).unwrap();
+
+    bencher.bench(|| divan::black_box(token::model::find_in_files::search_text(&query, &text)));
+}
@@ -40,7 +40,9 @@ pub fn make_model(lines: usize) -> AppModel {
         dock_layout: token::panel::DockLayout::default(),
         terminal: token::terminal::TerminalState::default(),
         outline_panel: token::model::OutlinePanelState::default(),
+        find_in_files: token::model::FindInFilesState::default(),
         recent_files: token::recent_files::RecentFiles::default(),
+        memory: token::memory::MemoryStats::default(),
         #[cfg(debug_assertions)]
         debug_overlay: None,
     }
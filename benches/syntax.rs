@@ -280,6 +280,27 @@ fn generate_large_javascript(lines: usize) -> String {
 // Full parse benchmarks (current implementation)
 // ============================================================================
 
+/// Cold grammar setup paid on a language's first use
+#[divan::bench(args = ["rust", "javascript", "html", "css", "yaml", "markdown"])]
+fn ensure_language_cold(bencher: divan::Bencher, lang: &str) {
+    let language = match lang {
+        "rust" => LanguageId::Rust,
+        "javascript" => LanguageId::JavaScript,
+        "html" => LanguageId::Html,
+        "css" => LanguageId::Css,
+        "yaml" => LanguageId::Yaml,
+        "markdown" => LanguageId::Markdown,
+        _ => panic!("Unknown language"),
+    };
+
+    bencher
+        .with_inputs(ParserState::new)
+        .bench_local_values(|mut state| {
+            divan::black_box(state.ensure_language(language));
+            state
+        });
+}
+
 #[divan::bench(args = ["rust", "javascript", "html", "css", "yaml", "markdown"])]
 fn parse_sample(lang: &str) {
     let mut state = ParserState::new();
@@ -386,6 +407,82 @@ fn parse_with_small_edit_large_rust(iterations: usize) {
     }
 }
 
+/// Keystrokes in prose of a README with many fenced code blocks; unchanged
+/// blocks reuse their cached injection instead of being re-parsed
+#[divan::bench(args = [10, 50])]
+fn markdown_prose_edit_with_code_blocks(bencher: divan::Bencher, blocks: usize) {
+    let mut source = String::from("# Readme\n\nIntro\n\n");
+    for i in 0..blocks {
+        source.push_str(&format!(
+            "Step {}\n\n```rust\nfn step_{}() -> u32 {{\n    {}\n}}\n```\n\n",
+            i, i, i
+        ));
+    }
+
+    let mut state = ParserState::new();
+    let doc_id = DocumentId(1);
+    state.parse_and_highlight(&source, LanguageId::Markdown, doc_id, 0);
+    let mut revision = 0;
+
+    bencher.bench_local(|| {
+        revision += 1;
+        source.insert(source.find("Intro").unwrap() + 5, 'x');
+        divan::black_box(state.parse_and_highlight(&source, LanguageId::Markdown, doc_id, revision))
+    });
+}
+
+/// Reparse after a keystroke in a large Blade layout of deeply nested
+/// components; the HTML scanner serializes its tag stack, custom component
+/// names included, at every external token
+///
+/// Only the incremental tree-sitter parse is timed. Every sample starts from
+/// the same tree and the same edited source, so samples are comparable.
+#[divan::bench(args = [50, 200])]
+fn blade_reparse_nested_components(bencher: divan::Bencher, sections: usize) {
+    let mut source = String::from("<x-layout>\n<main>\n<p>Intro</p>\n");
+    for i in 0..sections {
+        source.push_str(&format!("<x-section.level-{} id=\"{}\">\n", i % 8, i));
+        source.push_str(&format!(
+            "<x-card title=\"{}\">\n  <x-card.header>\n    <div class=\"row\">\n      \
+             <x-badge>{{{{ $items[{}] }}}}</x-badge>\n    </div>\n  </x-card.header>\n  \
+             @if ($show)\n    <x-slot:footer><span>{}</span></x-slot:footer>\n  @endif\n\
+             </x-card>\n",
+            i, i, i
+        ));
+    }
+    for i in (0..sections).rev() {
+        source.push_str(&format!("</x-section.level-{}>\n", i % 8));
+    }
+    source.push_str("</main>\n</x-layout>\n");
+
+    let mut parser = tree_sitter::Parser::new();
+    parser
+        .set_language(&tree_sitter_blade::LANGUAGE.into())
+        .unwrap();
+    let tree = parser.parse(&source, None).unwrap();
+
+    let at = source.find("Intro").unwrap() + 5;
+    let mut edited = source.clone();
+    edited.insert(at, 'x');
+    let position = tree_sitter::Point::new(2, 8);
+    let edit = tree_sitter::InputEdit {
+        start_byte: at,
+        old_end_byte: at,
+        new_end_byte: at + 1,
+        start_position: position,
+        old_end_position: position,
+        new_end_position: tree_sitter::Point::new(2, 9),
+    };
+
+    bencher
+        .with_inputs(|| {
+            let mut old_tree = tree.clone();
+            old_tree.edit(&edit);
+            old_tree
+        })
+        .bench_local_values(|old_tree| parser.parse(&edited, Some(&old_tree)));
+}
+
 // ============================================================================
 // Highlight extraction only (after parsing)
 // ============================================================================
@@ -525,7 +622,7 @@ fn query_capture_iteration(lang: &str) {
     // Parse and extract highlights (query matching is inside)
     let highlights = state.parse_and_highlight(&source, language, doc_id, 1);
 
-    let total_tokens: usize = highlights.lines.values().map(|lh| lh.tokens.len()).sum();
+    let total_tokens = highlights.token_count();
     divan::black_box(total_tokens);
 }
 
@@ -541,11 +638,31 @@ fn highlights_memory_rust_large() {
 
     let highlights = state.parse_and_highlight(&source, LanguageId::Rust, doc_id, 1);
 
-    // Count total allocations in highlights
-    let line_count = highlights.lines.len();
-    let token_count: usize = highlights.lines.values().map(|lh| lh.tokens.len()).sum();
+    // Tokens live in one arena, so this is the whole footprint
+    let line_count = highlights.line_count();
+    let token_count = highlights.token_count();
+    let bytes = highlights.memory_bytes();
+
+    divan::black_box((line_count, token_count, bytes));
+}
 
-    divan::black_box((line_count, token_count));
+#[divan::bench(args = [1000, 10000, 50000])]
+fn highlights_shift_for_newlines(bencher: divan::Bencher, lines: usize) {
+    let mut state = ParserState::new();
+    let source = generate_large_rust(lines);
+    let mut highlights = state.parse_and_highlight(&source, LanguageId::Rust, DocumentId(1), 1);
+    let line_count = source.lines().count();
+
+    // Type 20 newlines near the top, then delete them again
+    bencher.bench_local(|| {
+        for i in 0..20 {
+            highlights.shift_for_edit(10 + i, line_count + i, line_count + i + 1);
+        }
+        for i in (0..20).rev() {
+            highlights.shift_for_edit(10 + i, line_count + i + 1, line_count + i);
+        }
+        divan::black_box(&highlights);
+    });
 }
 
 // ============================================================================
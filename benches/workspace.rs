@@ -7,7 +7,9 @@ mod support;
 use std::collections::HashSet;
 use std::path::PathBuf;
 
-use token::model::{FileExtension, FileNode, FileTree, ScaledMetrics, Workspace};
+use token::model::{
+    FileExtension, FileIndex, FileNode, FileQuery, FileTree, ScaledMetrics, ScanState, Workspace,
+};
 
 #[global_allocator]
 static ALLOC: divan::AllocProfiler = divan::AllocProfiler::system();
@@ -193,6 +195,7 @@ fn create_workspace_with_tree(file_count: usize) -> Workspace {
         sidebar_visible: true,
         sidebar_width_logical: metrics.sidebar_default_width_logical,
         scroll_offset: 0,
+        scan: ScanState::default(),
     }
 }
 
@@ -291,6 +294,7 @@ fn reveal_file_deep_path(depth: usize) {
         sidebar_visible: true,
         sidebar_width_logical: 250.0,
         scroll_offset: 0,
+        scan: ScanState::default(),
     };
 
     // Create a deep path
@@ -356,3 +360,87 @@ fn large_tree_get_item_at_end(params: (usize, usize)) {
     let total = tree.count_visible(&expanded);
     divan::black_box(tree.get_visible_item(total - 1, &expanded));
 }
+
+// ============================================================================
+// Disk scanning benchmarks (synthetic 100k-file tree)
+// ============================================================================
+
+/// `100 × 10` directories of 100 files each, written once per bench run
+fn synthetic_workspace() -> &'static std::path::Path {
+    static TREE: std::sync::OnceLock<tempfile::TempDir> = std::sync::OnceLock::new();
+    TREE.get_or_init(|| {
+        let dir = tempfile::tempdir().expect("create temp dir");
+        std::fs::write(dir.path().join(".gitignore"), "*.tmp\nbuild/\n").unwrap();
+        for top in 0..100 {
+            for sub in 0..10 {
+                let path = dir.path().join(format!("pkg{}/mod{}", top, sub));
+                std::fs::create_dir_all(&path).unwrap();
+                for file in 0..100 {
+                    std::fs::write(path.join(format!("file{}.rs", file)), "").unwrap();
+                }
+            }
+        }
+        dir
+    })
+    .path()
+}
+
+#[divan::bench(sample_count = 10)]
+fn scan_synthetic_100k_files(bencher: divan::Bencher) {
+    let root = synthetic_workspace();
+    bencher.bench(|| FileTree::from_directory(divan::black_box(root)).unwrap());
+}
+
+#[divan::bench(sample_count = 10)]
+fn patch_created_file_in_100k_tree(bencher: divan::Bencher) {
+    let root = synthetic_workspace();
+    let created = root.join("pkg50/mod5/new_file.rs");
+    std::fs::write(&created, "").unwrap();
+    let mut tree = FileTree::from_directory(root).unwrap();
+    let paths = vec![created];
+
+    bencher.bench_local(|| divan::black_box(tree.patch_paths(&paths)));
+}
+
+// ============================================================================
+// File finder benchmarks (300k indexed paths)
+// ============================================================================
+
+fn synthetic_file_index() -> &'static FileIndex {
+    static INDEX: std::sync::OnceLock<FileIndex> = std::sync::OnceLock::new();
+    INDEX.get_or_init(|| {
+        let mut index = FileIndex::new();
+        for i in 0..300_000 {
+            index.insert(PathBuf::from(format!(
+                "/project/pkg{}/src/module_{}/file_{}.rs",
+                i % 300,
+                i % 1000,
+                i
+            )));
+        }
+        index
+    })
+}
+
+#[divan::bench(args = ["f", "fi", "modsrc", "file_1234"])]
+fn file_finder_first_keystroke(bencher: divan::Bencher, query: &str) {
+    let index = synthetic_file_index();
+    let root = PathBuf::from("/project");
+    bencher.bench(|| {
+        let mut session = FileQuery::default();
+        divan::black_box(index.search(query, &mut session, &root))
+    });
+}
+
+#[divan::bench]
+fn file_finder_typing_narrows(bencher: divan::Bencher) {
+    let index = synthetic_file_index();
+    let root = PathBuf::from("/project");
+    let query = "file_1234";
+    bencher.bench(|| {
+        let mut session = FileQuery::default();
+        for end in 1..=query.len() {
+            divan::black_box(index.search(&query[..end], &mut session, &root));
+        }
+    });
+}
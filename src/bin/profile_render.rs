@@ -9,8 +9,17 @@
 //!
 //! Or to profile with a specific scenario:
 //!   samply record ./target/profiling/profile_render --frames 1000 --splits 3
+//!
+//! Or to replay a session recorded with `TOKEN_RECORD_SESSION=session.jsonl`
+//! through the real update and render path:
+//!   ./target/profiling/profile_render --replay session.jsonl --save-baseline base.json
+//!   ./target/profiling/profile_render --replay session.jsonl --baseline base.json
+
+#[cfg(feature = "dhat-heap")]
+#[global_allocator]
+static ALLOC: dhat::Alloc = dhat::Alloc;
 
-use std::path::PathBuf;
+use std::path::{Path, PathBuf};
 use std::time::{Duration, Instant};
 
 use anyhow::Result;
@@ -55,11 +64,38 @@ struct Args {
     /// Print timing statistics
     #[arg(long)]
     stats: bool,
+
+    /// Replay a recorded session instead of rendering synthetic frames
+    #[arg(long)]
+    replay: Option<PathBuf>,
+
+    /// Pace replayed messages as they were recorded instead of at full speed
+    #[arg(long, requires = "replay")]
+    realtime: bool,
+
+    /// Compare the replay against a baseline saved with --save-baseline
+    #[arg(long, requires = "replay")]
+    baseline: Option<PathBuf>,
+
+    /// Save the replay's per-message timings as a baseline
+    #[arg(long, requires = "replay")]
+    save_baseline: Option<PathBuf>,
+
+    /// Relative slowdown against the baseline reported as a regression
+    #[arg(long, default_value = "0.1")]
+    threshold: f64,
 }
 
 fn main() -> Result<()> {
+    #[cfg(feature = "dhat-heap")]
+    let _profiler = dhat::Profiler::new_heap();
+
     let args = Args::parse();
 
+    if let Some(path) = &args.replay {
+        return run_replay(&args, path);
+    }
+
     eprintln!("Profile Render - Multi-Split Performance Test");
     eprintln!("==============================================");
     eprintln!("Frames: {}", args.frames);
@@ -201,6 +237,261 @@ fn main() -> Result<()> {
     Ok(())
 }
 
+/// Replay a recorded session headlessly and report per-message timings
+fn run_replay(args: &Args, path: &Path) -> Result<()> {
+    use token::model::AppModel;
+    use token::replay::{ReplayReport, ReplaySample, Session};
+    use token::syntax::ParserState;
+    use token::update::update;
+    use token::view::Renderer;
+
+    let session = Session::load(path).map_err(anyhow::Error::msg)?;
+    let header = &session.header;
+    let (width, height) = header.window_size;
+
+    eprintln!("Profile Render - Session Replay");
+    eprintln!("===============================");
+    eprintln!("Session:  {}", path.display());
+    eprintln!("Messages: {}", session.events.len());
+    eprintln!("Window:   {}x{} @{}x", width, height, header.scale_factor);
+    eprintln!("Files:    {}", header.files.len());
+    let pacing = if args.realtime {
+        "real-time"
+    } else {
+        "full speed"
+    };
+    eprintln!("Pacing:   {}", pacing);
+    eprintln!();
+
+    // Rebuild the state recording started from, the way App does
+    let mut renderer = Renderer::headless(width, height, header.scale_factor)?;
+    let mut model = AppModel::new(width, height, header.scale_factor, header.files.clone());
+    model.set_char_width(renderer.char_width());
+    model.line_height = renderer.line_height();
+    model.recompute_tab_bar_height_from_line_height();
+    model.resize(width, height);
+
+    let mut parser = ParserState::new();
+    let mut perf = token::perf::PerfStats::default();
+    let doc_ids: Vec<_> = model.editor_area.documents.keys().copied().collect();
+    highlight_documents(&mut model, &mut parser, &doc_ids);
+    renderer.render(&mut model, &mut perf, &token::commands::Damage::Full)?;
+
+    let mut report = ReplayReport::default();
+    let mut frames = 0usize;
+    let start_time = Instant::now();
+
+    for (index, event) in session.events.iter().enumerate() {
+        if args.realtime {
+            if let Some(wait) = event.at().checked_sub(start_time.elapsed()) {
+                std::thread::sleep(wait);
+            }
+        }
+
+        let label = event.msg.label();
+        let msg = event.msg.clone().into_msg();
+        let (blocks_before, bytes_before) = heap_totals();
+
+        let update_start = Instant::now();
+        let cmd = update(&mut model, msg);
+        let update_time = update_start.elapsed();
+
+        let mut damage = cmd.as_ref().map(|cmd| cmd.damage()).unwrap_or_default();
+
+        // Syntax workers aren't running; parse what the message asked for
+        // synchronously so later frames render with highlights
+        let mut syntax_docs = Vec::new();
+        if let Some(cmd) = &cmd {
+            collect_syntax_requests(cmd, &mut syntax_docs);
+        }
+        let syntax_start = Instant::now();
+        damage.merge(highlight_documents(&mut model, &mut parser, &syntax_docs));
+        let syntax_time = if syntax_docs.is_empty() {
+            Duration::ZERO
+        } else {
+            syntax_start.elapsed()
+        };
+
+        let render_time = if damage.needs_redraw() {
+            let render_start = Instant::now();
+            renderer.render(&mut model, &mut perf, &damage)?;
+            frames += 1;
+            Some(render_start.elapsed())
+        } else {
+            None
+        };
+
+        let (blocks_after, bytes_after) = heap_totals();
+        report.record(
+            label,
+            ReplaySample {
+                update: update_time,
+                syntax: syntax_time,
+                render: render_time,
+                allocations: blocks_after - blocks_before,
+                allocated_bytes: bytes_after - bytes_before,
+            },
+        );
+
+        if (index + 1) % 1000 == 0 {
+            eprintln!("  Replayed {} messages...", index + 1);
+        }
+    }
+
+    let total_time = start_time.elapsed();
+    std::hint::black_box(renderer.back_buffer());
+
+    eprintln!();
+    eprintln!(
+        "Replayed {} messages ({} frames) in {:.2}s",
+        session.events.len(),
+        frames,
+        total_time.as_secs_f64()
+    );
+    eprintln!();
+    print_replay_report(&report);
+
+    if let Some(path) = &args.save_baseline {
+        std::fs::write(path, serde_json::to_string_pretty(&report.to_json())?)?;
+        eprintln!();
+        eprintln!("Baseline saved to {}", path.display());
+    }
+
+    if let Some(path) = &args.baseline {
+        let baseline: serde_json::Value = serde_json::from_str(&std::fs::read_to_string(path)?)?;
+        let regressions = report.compare(&baseline, args.threshold);
+        eprintln!();
+        if regressions.is_empty() {
+            eprintln!(
+                "No regressions against {} (threshold {:.0}%)",
+                path.display(),
+                args.threshold * 100.0
+            );
+        } else {
+            eprintln!(
+                "Regressions against {} (threshold {:.0}%):",
+                path.display(),
+                args.threshold * 100.0
+            );
+            for regression in &regressions {
+                eprintln!("  {}", regression);
+            }
+            anyhow::bail!("{} regression(s) against baseline", regressions.len());
+        }
+    }
+
+    Ok(())
+}
+
+/// Parse and highlight `doc_ids` synchronously, delivering the results
+/// through `update` as the syntax workers would; returns the damage
+fn highlight_documents(
+    model: &mut token::model::AppModel,
+    parser: &mut token::syntax::ParserState,
+    doc_ids: &[token::model::editor_area::DocumentId],
+) -> token::commands::Damage {
+    use token::messages::{Msg, SyntaxMsg};
+
+    let mut damage = token::commands::Damage::None;
+    for &document_id in doc_ids {
+        let Some(doc) = model.editor_area.documents.get(&document_id) else {
+            continue;
+        };
+        if !doc.syntax_enabled() {
+            continue;
+        }
+        let revision = doc.revision;
+        let source = doc.buffer.to_string();
+        let highlights = parser.parse_and_highlight(&source, doc.language, document_id, revision);
+        let msg = Msg::Syntax(SyntaxMsg::ParseCompleted {
+            document_id,
+            revision,
+            highlights,
+            outline: None,
+        });
+        if let Some(cmd) = token::update::update(model, msg) {
+            damage.merge(cmd.damage());
+        }
+    }
+    damage
+}
+
+/// Documents a command asks the syntax workers to parse
+fn collect_syntax_requests(
+    cmd: &token::commands::Cmd,
+    doc_ids: &mut Vec<token::model::editor_area::DocumentId>,
+) {
+    use token::commands::Cmd;
+
+    match cmd {
+        Cmd::Batch(cmds) => {
+            for cmd in cmds {
+                collect_syntax_requests(cmd, doc_ids);
+            }
+        }
+        Cmd::DebouncedSyntaxParse { document_id, .. } | Cmd::RunSyntaxParse { document_id, .. } => {
+            if !doc_ids.contains(document_id) {
+                doc_ids.push(*document_id);
+            }
+        }
+        _ => {}
+    }
+}
+
+/// Total heap blocks and bytes allocated so far
+#[cfg(feature = "dhat-heap")]
+fn heap_totals() -> (u64, u64) {
+    let stats = dhat::HeapStats::get();
+    (stats.total_blocks, stats.total_bytes)
+}
+
+/// Allocation counting needs the `dhat-heap` feature
+#[cfg(not(feature = "dhat-heap"))]
+fn heap_totals() -> (u64, u64) {
+    (0, 0)
+}
+
+fn print_replay_report(report: &token::replay::ReplayReport) {
+    let ms = |d: Duration| d.as_secs_f64() * 1000.0;
+
+    eprintln!("Per-Message Timing (ms, p50 / p99):");
+    eprintln!(
+        "  {:<36} {:>6}  {:>17}  {:>17}  {:>10}",
+        "message", "count", "update", "render", "allocs/msg"
+    );
+    let rows = report
+        .by_label
+        .iter()
+        .map(|(label, stats)| (label.as_str(), stats))
+        .chain(std::iter::once(("total", &report.total)));
+    for (label, stats) in rows {
+        eprintln!(
+            "  {:<36} {:>6}  {:>8.3} / {:>6.3}  {:>8.3} / {:>6.3}  {:>10}",
+            label,
+            stats.count(),
+            ms(stats.update.percentile(0.5)),
+            ms(stats.update.percentile(0.99)),
+            ms(stats.render.percentile(0.5)),
+            ms(stats.render.percentile(0.99)),
+            stats.allocations_per_msg(),
+        );
+    }
+    if report.total.syntax.count() > 0 {
+        eprintln!();
+        eprintln!(
+            "  Synchronous syntax parses: {} (p50 {:.3}ms, max {:.3}ms)",
+            report.total.syntax.count(),
+            ms(report.total.syntax.percentile(0.5)),
+            ms(report.total.syntax.max()),
+        );
+    }
+    #[cfg(not(feature = "dhat-heap"))]
+    {
+        eprintln!();
+        eprintln!("  (build with --features dhat-heap to count allocations)");
+    }
+}
+
 fn create_model(args: &Args) -> Result<token::model::AppModel> {
     use token::config::EditorConfig;
     use token::messages::{LayoutMsg, Msg};
@@ -261,7 +552,9 @@ fn create_model(args: &Args) -> Result<token::model::AppModel> {
         dock_layout: token::panel::DockLayout::default(),
         terminal: token::terminal::TerminalState::default(),
         outline_panel: token::model::OutlinePanelState::default(),
+        find_in_files: token::model::FindInFilesState::default(),
         recent_files: token::recent_files::RecentFiles::default(),
+        memory: token::memory::MemoryStats::default(),
         #[cfg(debug_assertions)]
         debug_overlay: None,
     };
@@ -7,7 +7,6 @@
 //!   cargo run --bin screenshot -- --all
 //!   cargo run --bin screenshot -- --all --out-dir screenshots/output
 
-use std::collections::HashMap;
 use std::path::PathBuf;
 use std::process::Command;
 
@@ -283,7 +282,9 @@ fn create_model_from_scenario(scenario: &Scenario, theme: Theme) -> Result<AppMo
         dock_layout: token::panel::DockLayout::default(),
         terminal: token::terminal::TerminalState::default(),
         outline_panel: token::model::OutlinePanelState::default(),
+        find_in_files: token::model::FindInFilesState::default(),
         recent_files: token::recent_files::RecentFiles::default(),
+        memory: token::memory::MemoryStats::default(),
         #[cfg(debug_assertions)]
         debug_overlay: None,
     };
@@ -408,7 +409,7 @@ fn apply_view_modes(model: &mut AppModel, scenario: &Scenario) {
             });
 
             if let Some((text, delimiter)) = content {
-                if let Ok(data) = parse_csv(&text, delimiter) {
+                if let Ok(data) = parse_csv(text, delimiter) {
                     if !data.is_empty() && data.column_count() > 0 {
                         let line_height = model.line_height.max(1);
                         let tab_bar_height = model.metrics.tab_bar_height;
@@ -676,7 +677,7 @@ fn render_to_buffer(model: &mut AppModel, font_info: &FontInfo) -> Vec<u32> {
     let bg = model.theme.editor.background.to_argb_u32();
     let mut buffer: Vec<u32> = vec![bg; width * height];
 
-    let mut glyph_cache: GlyphCache = HashMap::new();
+    let mut glyph_cache = GlyphCache::new();
 
     let status_bar_height = font_info.line_height;
 
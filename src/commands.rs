@@ -3,10 +3,13 @@
 //! Commands represent side effects that should be performed after an update.
 
 use std::path::PathBuf;
+use std::sync::atomic::AtomicBool;
+use std::sync::{Arc, OnceLock};
 
 use crate::keymap::{Command as KeymapCommand, Keymap};
 use crate::model::editor_area::DocumentId;
-use crate::syntax::LanguageId;
+use crate::syntax::{EditDelta, LanguageId};
+use crate::util::char_mask;
 
 // ============================================================================
 // Command Palette Registry
@@ -43,6 +46,7 @@ pub enum CommandId {
 
     // Find/Replace
     Find,
+    FindInFiles,
 
     // UI
     ShowCommandPalette,
@@ -196,6 +200,11 @@ pub static COMMANDS: &[CommandDef] = &[
         label: "Find...",
         keybinding: Some("⌘F"),
     },
+    CommandDef {
+        id: CommandId::FindInFiles,
+        label: "Find in Files...",
+        keybinding: Some("⇧⌘F"),
+    },
     CommandDef {
         id: CommandId::ShowCommandPalette,
         label: "Show Command Palette",
@@ -305,11 +314,9 @@ pub static DEBUG_COMMANDS: &[CommandDef] = &[
 
 /// Calculate fuzzy match score. Returns None if no match, Some(score) if matches.
 /// Higher score = better match. Consecutive matches and word-start matches score higher.
-fn fuzzy_match_score(query: &str, target: &str) -> Option<i32> {
-    let query_chars: Vec<char> = query.to_lowercase().chars().collect();
-    let target_lower = target.to_lowercase();
-    let target_chars: Vec<char> = target_lower.chars().collect();
-
+///
+/// Both inputs are already lowercased.
+fn fuzzy_match_score(query_chars: &[char], target_lower: &str) -> Option<i32> {
     if query_chars.is_empty() {
         return Some(0);
     }
@@ -319,7 +326,7 @@ fn fuzzy_match_score(query: &str, target: &str) -> Option<i32> {
     let mut prev_matched = false;
     let mut prev_was_separator = true; // Start of string counts as separator
 
-    for (i, &tc) in target_chars.iter().enumerate() {
+    for (i, tc) in target_lower.chars().enumerate() {
         let is_separator = tc == ' ' || tc == '_' || tc == '-';
 
         if query_idx < query_chars.len() && tc == query_chars[query_idx] {
@@ -358,6 +365,22 @@ fn fuzzy_match_score(query: &str, target: &str) -> Option<i32> {
     }
 }
 
+/// Lowercased label and [`char_mask`] of every command, in `all_commands`
+/// order, computed once since the palette filters on every frame
+fn command_search_keys() -> &'static [(String, u64)] {
+    static KEYS: OnceLock<Vec<(String, u64)>> = OnceLock::new();
+    KEYS.get_or_init(|| {
+        all_commands()
+            .iter()
+            .map(|cmd| {
+                let lower = cmd.label.to_lowercase();
+                let mask = char_mask(&lower);
+                (lower, mask)
+            })
+            .collect()
+    })
+}
+
 /// Get all available commands (including debug commands in debug builds)
 fn all_commands() -> Vec<&'static CommandDef> {
     #[allow(unused_mut)]
@@ -375,9 +398,15 @@ pub fn filter_commands(query: &str) -> Vec<&'static CommandDef> {
         return all;
     }
 
+    let query_chars: Vec<char> = query.to_lowercase().chars().collect();
+    let query_mask = char_mask(query);
     let mut matches: Vec<(&'static CommandDef, i32)> = all
         .into_iter()
-        .filter_map(|cmd| fuzzy_match_score(query, cmd.label).map(|score| (cmd, score)))
+        .zip(command_search_keys())
+        .filter(|(_, (_, mask))| mask & query_mask == query_mask)
+        .filter_map(|(cmd, (label, _))| {
+            fuzzy_match_score(&query_chars, label).map(|score| (cmd, score))
+        })
         .collect();
 
     // Sort by score descending (best matches first)
@@ -409,6 +438,7 @@ impl CommandId {
             CommandId::PrevTab => Some(KeymapCommand::PrevTab),
             CommandId::CloseTab => Some(KeymapCommand::CloseTab),
             CommandId::Find => Some(KeymapCommand::ToggleFindReplace),
+            CommandId::FindInFiles => Some(KeymapCommand::FindInFiles),
             CommandId::ShowCommandPalette => Some(KeymapCommand::ToggleCommandPalette),
             CommandId::SwitchTheme => None,
             CommandId::OpenConfigDirectory => None,
@@ -479,6 +509,11 @@ pub enum DamageArea {
     /// This enables the most fine-grained optimization for cursor blink which happens
     /// at 2Hz and would otherwise require full EditorArea redraws.
     CursorLines(Vec<usize>),
+    /// Rows of the terminal panel whose content changed, redrawn in place
+    /// without the surrounding dock. PTY output arrives up to 60 times a
+    /// second; repainting the whole editor and docks for each would spend
+    /// the frame on pixels that didn't change.
+    Terminal,
 }
 
 impl Damage {
@@ -578,6 +613,15 @@ impl Damage {
         }
     }
 
+    /// Check if this damage includes the terminal panel (or is full)
+    pub fn includes_terminal(&self) -> bool {
+        match self {
+            Damage::None => false,
+            Damage::Full => true,
+            Damage::Areas(areas) => areas.iter().any(|a| matches!(a, DamageArea::Terminal)),
+        }
+    }
+
     /// Get cursor lines if this is a cursor-lines-only damage
     pub fn cursor_lines_only(&self) -> Option<&[usize]> {
         match self {
@@ -620,6 +664,28 @@ pub enum Cmd {
     SaveFile { path: PathBuf, content: String },
     /// Load file asynchronously
     LoadFile { path: PathBuf },
+    /// Stream a large file into a document in the background, sending
+    /// `AppMsg::LargeFileChunk` as it grows, until `cancel` is set
+    StreamLargeFile {
+        document_id: DocumentId,
+        path: PathBuf,
+        cancel: Arc<AtomicBool>,
+    },
+    /// Decode an image in the background, sending `AppMsg::ImageDecoded`
+    /// with its mip chain, the level for zoom `scale` already built
+    DecodeImage {
+        document_id: DocumentId,
+        path: PathBuf,
+        scale: f64,
+    },
+    /// Scan workspace directories in the background, sending
+    /// `WorkspaceMsg::ScanBatch` as listings arrive
+    ScanWorkspace { request: crate::model::ScanRequest },
+    /// Search workspace files in the background, sending
+    /// `FindInFilesMsg::Results` as matches arrive
+    FindInFiles {
+        request: crate::model::FileSearchRequest,
+    },
     /// Open a path in the system file explorer/finder
     OpenInExplorer { path: PathBuf },
     /// Reveal a file in the system file manager (select it)
@@ -661,11 +727,26 @@ pub enum Cmd {
     RunSyntaxParse {
         document_id: DocumentId,
         revision: u64,
-        source: String,
+        /// O(1) snapshot of the document buffer at `revision`
+        snapshot: ropey::Rope,
+        /// Edits since the previous parse request (None if unknown)
+        edits: Option<EditDelta>,
         language: LanguageId,
+        /// Lines to highlight first (the viewport plus a margin), or `None`
+        /// to highlight the whole document in one pass
+        priority_lines: Option<std::ops::Range<usize>>,
+        /// Whether the document currently has highlights to keep showing
+        /// outside `priority_lines`
+        has_highlights: bool,
+        /// Whether an active tab shows the document, so the worker pool
+        /// should get to it before background tabs
+        visible: bool,
     },
     /// Drop debounced parse state and worker-side cached parse trees for a document.
     ClearSyntaxState { document_id: DocumentId },
+    /// Drop worker-side cached parse trees to bring the parser cache under
+    /// its soft cap; queued parses and outlines are kept
+    EvictSyntaxCache { document_ids: Vec<DocumentId> },
 
     // === Display Commands ===
     /// Reinitialize the renderer (e.g., after scale factor change)
@@ -740,6 +821,10 @@ impl Cmd {
             // File operations may cause full redraw (file load changes content)
             Cmd::SaveFile { .. } => Damage::Full,
             Cmd::LoadFile { .. } => Damage::Full,
+            Cmd::StreamLargeFile { .. } => Damage::Areas(vec![]),
+            Cmd::DecodeImage { .. } => Damage::Areas(vec![]),
+            Cmd::ScanWorkspace { .. } => Damage::Areas(vec![]),
+            Cmd::FindInFiles { .. } => Damage::Areas(vec![]),
             Cmd::OpenInExplorer { .. } => Damage::Full,
             Cmd::RevealFileInFinder { .. } => Damage::Areas(vec![]),
             Cmd::OpenFileInEditor { .. } => Damage::Full,
@@ -763,6 +848,7 @@ impl Cmd {
             Cmd::DebouncedSyntaxParse { .. } => Damage::Areas(vec![]),
             Cmd::RunSyntaxParse { .. } => Damage::Areas(vec![]),
             Cmd::ClearSyntaxState { .. } => Damage::Areas(vec![]),
+            Cmd::EvictSyntaxCache { .. } => Damage::Areas(vec![]),
             // Reinitialize triggers full redraw
             Cmd::ReinitializeRenderer => Damage::Full,
             // Quit doesn't need redraw - app is exiting
@@ -790,6 +876,11 @@ impl Cmd {
         Cmd::RedrawAreas(vec![DamageArea::StatusBar])
     }
 
+    /// Create a command to redraw the terminal panel's changed rows
+    pub fn redraw_terminal() -> Self {
+        Cmd::RedrawAreas(vec![DamageArea::Terminal])
+    }
+
     /// Create a command to redraw specific cursor lines
     pub fn redraw_cursor_lines(lines: Vec<usize>) -> Self {
         if lines.is_empty() {
@@ -969,6 +1060,21 @@ mod tests {
         }
     }
 
+    #[test]
+    fn test_damage_terminal_merges_without_editor() {
+        let mut damage = Cmd::redraw_terminal().damage();
+        damage.merge(Cmd::redraw_terminal().damage());
+        assert!(damage.includes_terminal());
+        assert!(!damage.includes_editor());
+        assert!(!damage.includes_status_bar());
+        assert!(damage.cursor_lines_only().is_none());
+
+        damage.merge(Damage::status_bar());
+        assert!(
+            matches!(&damage, Damage::Areas(areas) if areas == &[DamageArea::Terminal, DamageArea::StatusBar])
+        );
+    }
+
     #[test]
     fn test_damage_needs_redraw() {
         assert!(!Damage::None.needs_redraw());
@@ -2,8 +2,12 @@
 //!
 //! Stores user preferences in `~/.config/token-editor/config.yaml`
 
+use std::collections::BTreeMap;
+
 use serde::{Deserialize, Serialize};
 
+use crate::memory::MemorySubsystem;
+
 /// Result of reloading configuration
 #[derive(Debug, Clone, PartialEq)]
 pub enum ReloadResult {
@@ -43,6 +47,21 @@ pub struct EditorConfig {
     /// When false, no scrollbars are rendered and no space is reserved for them.
     #[serde(default = "default_true")]
     pub show_scrollbar: bool,
+
+    /// Files larger than this (in MB) open in large-file mode (default: 16)
+    ///
+    /// Large files are loaded in the background in chunks and have syntax
+    /// highlighting turned off.
+    #[serde(default = "default_large_file_threshold_mb")]
+    pub large_file_threshold_mb: u64,
+
+    /// Soft memory caps in MB per subsystem, e.g. `parser_cache: 256`
+    /// (default: none)
+    ///
+    /// A subsystem over its cap drops what it can rebuild on demand: the
+    /// parser cache evicts the parse trees of documents in background tabs.
+    #[serde(default, skip_serializing_if = "BTreeMap::is_empty")]
+    pub memory_caps_mb: BTreeMap<MemorySubsystem, u64>,
 }
 
 fn default_theme() -> String {
@@ -57,6 +76,10 @@ fn default_true() -> bool {
     true
 }
 
+fn default_large_file_threshold_mb() -> u64 {
+    16
+}
+
 impl Default for EditorConfig {
     fn default() -> Self {
         Self {
@@ -65,6 +88,8 @@ impl Default for EditorConfig {
             auto_surround: true,
             bracket_matching: true,
             show_scrollbar: true,
+            large_file_threshold_mb: default_large_file_threshold_mb(),
+            memory_caps_mb: BTreeMap::new(),
         }
     }
 }
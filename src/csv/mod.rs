@@ -15,7 +15,7 @@
 //! └── ViewMode
 //!     ├── Text (default)
 //!     └── Csv(CsvState)
-//!             ├── CsvData (parsed grid)
+//!             ├── CsvData (row index over the text)
 //!             ├── CsvViewport (visible region)
 //!             └── CellEditState (when editing)
 //! ```
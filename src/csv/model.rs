@@ -1,14 +1,16 @@
 //! CSV data model types
 //!
-//! Memory-efficient storage using delimited strings instead of Vec<Vec<String>>.
+//! Cells are read lazily out of the source text through a row-offset index.
+
+use std::borrow::Cow;
+use std::collections::BTreeMap;
+use std::sync::Arc;
 
 use crate::editable::{EditConstraints, EditableState, MoveTarget, StringBuffer};
 
+use super::parser::{escape_csv_value, parse_csv, Fields};
 use super::viewport::CsvViewport;
 
-/// Internal delimiter for cell storage (0xFA - rarely used in real data)
-pub const CELL_DELIMITER: char = '\u{00FA}';
-
 /// Supported CSV delimiters
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
 pub enum Delimiter {
@@ -270,17 +272,36 @@ pub struct CellEdit {
     pub new_value: String,
 }
 
-/// Memory-efficient CSV data storage
+/// CSV data backed by the source text
 ///
-/// Instead of storing `Vec<Vec<String>>` which has significant overhead,
-/// each row is stored as a single string with cells delimited by CELL_DELIMITER (0xFA).
-/// This reduces memory allocations while still allowing O(1) row access.
-#[derive(Debug, Clone, Default)]
+/// Parsing only records the byte offset where each row starts; cells are
+/// split out of the shared source when a row is read, so memory stays close
+/// to the file size plus one offset per row. Cell edits are kept in an
+/// overlay on top of the source rather than rewriting it.
+#[derive(Debug, Clone)]
 pub struct CsvData {
-    /// Each row stored as delimiter-separated string
-    rows: Vec<String>,
+    /// Text the row offsets point into, shared between clones
+    source: Arc<str>,
+    /// Field delimiter byte used by the source
+    delimiter: u8,
+    /// Byte offset where each row starts
+    row_starts: Vec<usize>,
     /// Number of columns (max across all rows)
     column_count: usize,
+    /// Cells set since parsing, by (row, column)
+    edits: BTreeMap<(usize, usize), String>,
+}
+
+impl Default for CsvData {
+    fn default() -> Self {
+        Self {
+            source: Arc::from(""),
+            delimiter: b',',
+            row_starts: Vec::new(),
+            column_count: 0,
+            edits: BTreeMap::new(),
+        }
+    }
 }
 
 impl CsvData {
@@ -289,21 +310,47 @@ impl CsvData {
         Self::default()
     }
 
+    /// Create CSV data from a row index built over `source`
+    pub(super) fn from_index(
+        source: Arc<str>,
+        delimiter: u8,
+        row_starts: Vec<usize>,
+        column_count: usize,
+    ) -> Self {
+        Self {
+            source,
+            delimiter,
+            row_starts,
+            column_count,
+            edits: BTreeMap::new(),
+        }
+    }
+
     /// Create CSV data from parsed rows
     pub fn from_rows(parsed_rows: Vec<Vec<String>>) -> Self {
-        let column_count = parsed_rows.iter().map(|r| r.len()).max().unwrap_or(0);
-
-        let rows = parsed_rows
-            .into_iter()
-            .map(|row| row.join(&CELL_DELIMITER.to_string()))
-            .collect();
+        let mut source = String::new();
+        for row in &parsed_rows {
+            if row.iter().all(|cell| cell.is_empty()) {
+                // Keep the row from reading back as a skipped blank line
+                source.push_str("\"\"");
+            }
+            for (i, cell) in row.iter().enumerate() {
+                if i > 0 {
+                    source.push(',');
+                }
+                source.push_str(&escape_csv_value(cell, Delimiter::Comma));
+            }
+            source.push('\n');
+        }
 
-        Self { rows, column_count }
+        let mut data = parse_csv(source, Delimiter::Comma).unwrap_or_default();
+        data.column_count = parsed_rows.iter().map(|r| r.len()).max().unwrap_or(0);
+        data
     }
 
     /// Get number of rows
     pub fn row_count(&self) -> usize {
-        self.rows.len()
+        self.row_starts.len()
     }
 
     /// Get number of columns
@@ -312,56 +359,45 @@ impl CsvData {
     }
 
     /// Get cell value at position
-    pub fn get(&self, row: usize, col: usize) -> &str {
-        if row >= self.rows.len() {
-            return "";
-        }
-
-        let row_str = &self.rows[row];
-        let mut col_idx = 0;
-        let mut start = 0;
-
-        for (i, c) in row_str.char_indices() {
-            if c == CELL_DELIMITER {
-                if col_idx == col {
-                    return &row_str[start..i];
-                }
-                col_idx += 1;
-                start = i + c.len_utf8();
-            }
-        }
-
-        if col_idx == col {
-            return &row_str[start..];
+    pub fn get(&self, row: usize, col: usize) -> Cow<'_, str> {
+        if let Some(value) = self.edits.get(&(row, col)) {
+            return Cow::Borrowed(value);
         }
-
-        ""
+        self.fields(row).nth(col).unwrap_or(Cow::Borrowed(""))
     }
 
     /// Get entire row as iterator over cells
-    pub fn row_cells(&self, row: usize) -> impl Iterator<Item = &str> {
-        self.rows
-            .get(row)
-            .map(|s| s.as_str())
-            .unwrap_or("")
-            .split(CELL_DELIMITER)
+    pub fn row_cells(&self, row: usize) -> impl Iterator<Item = Cow<'_, str>> {
+        // Edits may reach past the row's last parsed field
+        let edited_len = self
+            .edits
+            .range((row, 0)..(row + 1, 0))
+            .next_back()
+            .map_or(0, |(&(_, col), _)| col + 1);
+        let mut fields = self.fields(row);
+        let mut col = 0;
+
+        std::iter::from_fn(move || {
+            let field = fields.next();
+            if field.is_none() && col >= edited_len {
+                return None;
+            }
+            let value = match self.edits.get(&(row, col)) {
+                Some(value) => Cow::Borrowed(value.as_str()),
+                None => field.unwrap_or(Cow::Borrowed("")),
+            };
+            col += 1;
+            Some(value)
+        })
     }
 
     /// Set cell value at position
     pub fn set(&mut self, row: usize, col: usize, value: &str) {
-        if row >= self.rows.len() {
+        if row >= self.row_starts.len() {
             return;
         }
 
-        let cells: Vec<&str> = self.rows[row].split(CELL_DELIMITER).collect();
-        let mut new_cells: Vec<String> = cells.iter().map(|s| s.to_string()).collect();
-
-        while new_cells.len() <= col {
-            new_cells.push(String::new());
-        }
-
-        new_cells[col] = value.to_string();
-        self.rows[row] = new_cells.join(&CELL_DELIMITER.to_string());
+        self.edits.insert((row, col), value.to_string());
 
         if col >= self.column_count {
             self.column_count = col + 1;
@@ -370,7 +406,27 @@ impl CsvData {
 
     /// Check if data is empty
     pub fn is_empty(&self) -> bool {
-        self.rows.is_empty()
+        self.row_starts.is_empty()
+    }
+
+    /// Approximate heap bytes held by the source, row index and edits
+    ///
+    /// The source is shared between clones and counted by each of them.
+    pub fn memory_bytes(&self) -> usize {
+        let edit_bytes: usize = self
+            .edits
+            .values()
+            .map(|value| value.capacity() + std::mem::size_of::<((usize, usize), String)>())
+            .sum();
+        self.source.len() + self.row_starts.capacity() * std::mem::size_of::<usize>() + edit_bytes
+    }
+
+    /// Parsed fields of a row, without edits applied
+    fn fields(&self, row: usize) -> Fields<'_> {
+        match self.row_starts.get(row) {
+            Some(&start) => Fields::new(&self.source, self.delimiter, start),
+            None => Fields::empty(),
+        }
     }
 }
 
@@ -409,14 +465,32 @@ impl CsvState {
         }
     }
 
+    /// Approximate heap bytes held by the data and view state
+    pub fn memory_bytes(&self) -> usize {
+        let editing = self.editing.as_ref().map_or(0, |edit| {
+            edit.original.capacity() + edit.editable.history_memory_bytes()
+        });
+        self.data.memory_bytes()
+            + self.column_widths.capacity() * std::mem::size_of::<usize>()
+            + editing
+    }
+
     /// Calculate optimal column widths based on content
+    ///
+    /// Looks at the first rows and an even sample of the rest, so opening a
+    /// huge file doesn't read every row.
     fn calculate_column_widths(data: &CsvData) -> Vec<usize> {
         const MIN_WIDTH: usize = 4;
         const MAX_WIDTH: usize = 40;
+        const HEAD_ROWS: usize = 100;
+        const SAMPLED_ROWS: usize = 100;
 
         let mut widths = vec![MIN_WIDTH; data.column_count()];
 
-        for row in 0..data.row_count().min(100) {
+        let row_count = data.row_count();
+        let head = row_count.min(HEAD_ROWS);
+        let step = ((row_count - head) / SAMPLED_ROWS).max(1);
+        for row in (0..head).chain((head..row_count).step_by(step).take(SAMPLED_ROWS)) {
             for (col, cell) in data.row_cells(row).enumerate() {
                 if col < widths.len() {
                     let cell_width = cell.chars().count();
@@ -466,7 +540,7 @@ impl CsvState {
             .unwrap_or(4);
         self.editing = Some(CellEditState::new(
             self.selected_cell,
-            value.to_string(),
+            value.into_owned(),
             col_width,
         ));
     }
@@ -476,7 +550,7 @@ impl CsvState {
         let original = self
             .data
             .get(self.selected_cell.row, self.selected_cell.col)
-            .to_string();
+            .into_owned();
         let col_width = self
             .column_widths
             .get(self.selected_cell.col)
@@ -610,6 +684,24 @@ mod tests {
         assert_eq!(data.get(0, 1), "also updated");
     }
 
+    #[test]
+    fn test_csv_data_edits_overlay_source() {
+        use super::super::parse_csv;
+
+        let mut data = parse_csv("a,b\n1\n", Delimiter::Comma).unwrap();
+        data.set(1, 3, "z");
+        data.set(0, 0, "edited");
+        data.set(9, 0, "out of range");
+
+        assert_eq!(data.column_count(), 4);
+        assert_eq!(data.get(0, 0), "edited");
+        let cells: Vec<_> = data.row_cells(0).collect();
+        assert_eq!(cells, vec!["edited", "b"]);
+        let cells: Vec<_> = data.row_cells(1).collect();
+        assert_eq!(cells, vec!["1", "", "", "z"]);
+        assert_eq!(data.row_cells(9).count(), 0);
+    }
+
     #[test]
     fn test_delimiter_from_extension() {
         assert_eq!(Delimiter::from_extension("csv"), Delimiter::Comma);
@@ -623,7 +715,7 @@ mod tests {
         let rows = vec![vec!["a".to_string(), "b".to_string(), "c".to_string()]];
         let data = CsvData::from_rows(rows);
 
-        let cells: Vec<&str> = data.row_cells(0).collect();
+        let cells: Vec<_> = data.row_cells(0).collect();
         assert_eq!(cells, vec!["a", "b", "c"]);
     }
 
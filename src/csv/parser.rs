@@ -1,10 +1,19 @@
-//! CSV parsing using the csv crate
+//! CSV parsing
 //!
 //! RFC 4180 compliant parsing with support for quoted fields,
 //! escaped quotes, and custom delimiters.
+//!
+//! Parsing only indexes where each row starts; cells are split out of the
+//! source text when a row is read (see [`Fields`]). Large files are indexed
+//! in newline-aligned chunks on several threads.
 
 use super::model::{CsvData, Delimiter};
-use std::io::Cursor;
+use std::borrow::Cow;
+use std::ops::Range;
+use std::sync::Arc;
+
+/// Smallest chunk worth indexing on its own thread
+const MIN_INDEX_CHUNK_BYTES: usize = 1 << 20;
 
 /// Error type for CSV parsing
 #[derive(Debug, Clone)]
@@ -26,34 +35,279 @@ impl std::error::Error for ParseError {}
 
 /// Parse CSV content into CsvData
 ///
-/// Uses the csv crate for RFC 4180 compliant parsing.
-pub fn parse_csv(content: &str, delimiter: Delimiter) -> Result<CsvData, ParseError> {
-    let cursor = Cursor::new(content.as_bytes());
-
-    let mut reader = csv::ReaderBuilder::new()
-        .delimiter(delimiter.char() as u8)
-        .has_headers(false)
-        .flexible(true)
-        .from_reader(cursor);
-
-    let mut rows: Vec<Vec<String>> = Vec::new();
-
-    for (line_num, result) in reader.records().enumerate() {
-        match result {
-            Ok(record) => {
-                let row: Vec<String> = record.iter().map(|s| s.to_string()).collect();
-                rows.push(row);
+/// Takes ownership of the text (the grid reads cells out of it) and only
+/// builds the row index up front. Follows the csv crate's flexible,
+/// header-less reading: rows may have different lengths, blank lines are
+/// skipped, and an unterminated quote runs to the end of the file.
+pub fn parse_csv(
+    content: impl Into<Arc<str>>,
+    delimiter: Delimiter,
+) -> Result<CsvData, ParseError> {
+    let source = content.into();
+    let delim = delimiter.char() as u8;
+    let (row_starts, column_count) = index_rows(source.as_bytes(), delim);
+    Ok(CsvData::from_index(source, delim, row_starts, column_count))
+}
+
+/// Row index of one chunk of the source
+struct ChunkIndex {
+    /// Byte offset of each row starting in the chunk
+    rows: Vec<usize>,
+    /// Most fields seen in a row
+    columns: usize,
+    /// The chunk ends inside a quoted field, so its last row continues into
+    /// the next chunk
+    open: bool,
+}
+
+/// Find the start of every row and the widest row's field count
+fn index_rows(bytes: &[u8], delimiter: u8) -> (Vec<usize>, usize) {
+    let cores = std::thread::available_parallelism().map_or(1, |n| n.get());
+    let chunk_count = (bytes.len() / MIN_INDEX_CHUNK_BYTES).clamp(1, cores);
+    if chunk_count == 1 {
+        let chunk = index_chunk(bytes, 0..bytes.len(), delimiter);
+        return (chunk.rows, chunk.columns);
+    }
+
+    let mut bounds = vec![0];
+    for i in 1..chunk_count {
+        let target = (bytes.len() * i / chunk_count).max(*bounds.last().unwrap_or(&0));
+        let start = memchr::memchr(b'\n', &bytes[target..]).map_or(bytes.len(), |p| target + p + 1);
+        if start < bytes.len() && start > *bounds.last().unwrap_or(&0) {
+            bounds.push(start);
+        }
+    }
+    bounds.push(bytes.len());
+    index_chunks(bytes, &bounds, delimiter)
+}
+
+/// Index the chunks between consecutive `bounds` on one thread each
+///
+/// Every bound must follow a newline, so each chunk begins either at a row
+/// start or inside a quoted field. All chunks are indexed assuming a row
+/// start, then the (rare) chunks whose predecessor ended inside quotes are
+/// indexed again from the start of the row that runs into them.
+fn index_chunks(bytes: &[u8], bounds: &[usize], delimiter: u8) -> (Vec<usize>, usize) {
+    let chunks: Vec<ChunkIndex> = std::thread::scope(|scope| {
+        let handles: Vec<_> = bounds
+            .windows(2)
+            .map(|w| {
+                let range = w[0]..w[1];
+                scope.spawn(move || index_chunk(bytes, range, delimiter))
+            })
+            .collect();
+        handles
+            .into_iter()
+            .map(|handle| handle.join().expect("CSV index thread panicked"))
+            .collect()
+    });
+
+    let mut rows = Vec::with_capacity(chunks.iter().map(|c| c.rows.len()).sum());
+    let mut columns = 0;
+    let mut open = false;
+    for (chunk, &end) in chunks.into_iter().zip(&bounds[1..]) {
+        let chunk = if open {
+            let start = rows.pop().unwrap_or(0);
+            index_chunk(bytes, start..end, delimiter)
+        } else {
+            chunk
+        };
+        rows.extend(chunk.rows);
+        columns = columns.max(chunk.columns);
+        open = chunk.open;
+    }
+    (rows, columns)
+}
+
+/// Index the rows of `bytes[range]`, which must start at a row start
+fn index_chunk(bytes: &[u8], range: Range<usize>, delimiter: u8) -> ChunkIndex {
+    let end = range.end;
+    let mut pos = range.start;
+    let mut rows = Vec::new();
+    let mut columns = 0;
+    let mut row_columns = 0;
+    let mut in_row = false;
+    let mut in_quotes = false;
+    let mut field_start = false;
+
+    while pos < end {
+        if in_quotes {
+            match memchr::memchr(b'"', &bytes[pos..end]) {
+                Some(i) => {
+                    pos += i + 1;
+                    if pos < end && bytes[pos] == b'"' {
+                        // Doubled quote: still inside the field
+                        pos += 1;
+                    } else {
+                        in_quotes = false;
+                    }
+                }
+                None => pos = end,
+            }
+            continue;
+        }
+
+        if !in_row {
+            // Blank lines don't make rows
+            if matches!(bytes[pos], b'\n' | b'\r') {
+                pos += 1;
+                continue;
             }
-            Err(e) => {
-                return Err(ParseError {
-                    message: e.to_string(),
-                    line: Some(line_num + 1),
-                });
+            rows.push(pos);
+            in_row = true;
+            row_columns = 1;
+            field_start = true;
+        }
+
+        if field_start && bytes[pos] == b'"' {
+            in_quotes = true;
+            field_start = false;
+            pos += 1;
+            continue;
+        }
+        field_start = false;
+
+        match memchr::memchr2(delimiter, b'\n', &bytes[pos..end]) {
+            Some(i) => {
+                pos += i;
+                if bytes[pos] == delimiter {
+                    row_columns += 1;
+                    field_start = true;
+                } else {
+                    columns = columns.max(row_columns);
+                    in_row = false;
+                }
+                pos += 1;
+            }
+            None => pos = end,
+        }
+    }
+    if in_row {
+        columns = columns.max(row_columns);
+    }
+
+    ChunkIndex {
+        rows,
+        columns,
+        open: in_quotes,
+    }
+}
+
+/// Iterator over the fields of one row, decoded from the source text
+///
+/// Unquoted fields and quoted fields without doubled quotes borrow from the
+/// source; only fields with escapes (or text after a closing quote) allocate.
+pub(super) struct Fields<'a> {
+    source: &'a str,
+    delimiter: u8,
+    pos: usize,
+    done: bool,
+}
+
+impl<'a> Fields<'a> {
+    /// Fields of the row starting at byte `start`
+    pub(super) fn new(source: &'a str, delimiter: u8, start: usize) -> Self {
+        Self {
+            source,
+            delimiter,
+            pos: start,
+            done: false,
+        }
+    }
+
+    /// A row with no fields
+    pub(super) fn empty() -> Self {
+        Self {
+            source: "",
+            delimiter: b',',
+            pos: 0,
+            done: true,
+        }
+    }
+
+    /// End of the unquoted text from `pos`: the next delimiter or newline
+    fn field_end(&self, pos: usize) -> usize {
+        let bytes = self.source.as_bytes();
+        memchr::memchr2(self.delimiter, b'\n', &bytes[pos..]).map_or(bytes.len(), |i| pos + i)
+    }
+
+    /// Step past the delimiter or line ending at `end`, returning where the
+    /// field's text ends (without the `\r` of a CRLF line ending)
+    fn finish_field(&mut self, end: usize) -> usize {
+        let bytes = self.source.as_bytes();
+        if end < bytes.len() && bytes[end] == self.delimiter {
+            self.pos = end + 1;
+            end
+        } else {
+            self.done = true;
+            if end > 0 && bytes[end - 1] == b'\r' {
+                end - 1
+            } else {
+                end
             }
         }
     }
+}
+
+impl<'a> Iterator for Fields<'a> {
+    type Item = Cow<'a, str>;
 
-    Ok(CsvData::from_rows(rows))
+    fn next(&mut self) -> Option<Cow<'a, str>> {
+        if self.done {
+            return None;
+        }
+        let source = self.source;
+        let bytes = source.as_bytes();
+        let start = self.pos;
+
+        if bytes.get(start) != Some(&b'"') {
+            let end = self.field_end(start);
+            let text_end = self.finish_field(end).max(start);
+            return Some(Cow::Borrowed(&source[start..text_end]));
+        }
+
+        // Quoted field: collect text up to the closing quote, unescaping
+        // doubled quotes
+        let mut escaped: Option<String> = None;
+        let mut segment = start + 1;
+        let mut pos = segment;
+        let content = loop {
+            match memchr::memchr(b'"', &bytes[pos..]) {
+                Some(i) if bytes.get(pos + i + 1) == Some(&b'"') => {
+                    let quote = pos + i;
+                    escaped
+                        .get_or_insert_with(String::new)
+                        .push_str(&source[segment..=quote]);
+                    pos = quote + 2;
+                    segment = pos;
+                }
+                Some(i) => {
+                    let quote = pos + i;
+                    pos = quote + 1;
+                    break &source[segment..quote];
+                }
+                None => {
+                    pos = bytes.len();
+                    break &source[segment..];
+                }
+            }
+        };
+
+        // Anything between the closing quote and the delimiter is kept as-is
+        let end = self.field_end(pos);
+        let tail_end = self.finish_field(end).max(pos);
+        let tail = &source[pos..tail_end];
+
+        Some(match escaped {
+            None if tail.is_empty() => Cow::Borrowed(content),
+            escaped => {
+                let mut value = escaped.unwrap_or_default();
+                value.push_str(content);
+                value.push_str(tail);
+                Cow::Owned(value)
+            }
+        })
+    }
 }
 
 /// Detect delimiter by analyzing first few lines
@@ -174,6 +428,58 @@ mod tests {
         assert!(data.is_empty());
     }
 
+    #[test]
+    fn test_parse_crlf_blank_lines_and_trailing_delimiter() {
+        let content = "a,b\r\n\r\n1,\r\n\n\"x\"\r\n";
+        let data = parse_csv(content, Delimiter::Comma).unwrap();
+
+        assert_eq!(data.row_count(), 3);
+        assert_eq!(data.column_count(), 2);
+        assert_eq!(data.get(0, 1), "b");
+        assert_eq!(data.get(1, 0), "1");
+        assert_eq!(data.get(1, 1), "");
+        assert_eq!(data.get(2, 0), "x");
+    }
+
+    #[test]
+    fn test_parse_quoted_newlines_and_text_after_quote() {
+        let content = "\"multi\nline\",b\n\"ab\"cd,\"unterminated\nrest";
+        let data = parse_csv(content, Delimiter::Comma).unwrap();
+
+        assert_eq!(data.row_count(), 2);
+        assert_eq!(data.get(0, 0), "multi\nline");
+        assert_eq!(data.get(0, 1), "b");
+        assert_eq!(data.get(1, 0), "abcd");
+        assert_eq!(data.get(1, 1), "unterminated\nrest");
+    }
+
+    #[test]
+    fn test_chunked_index_matches_single_pass() {
+        let mut content = String::new();
+        for i in 0..200 {
+            if i % 7 == 0 {
+                content.push_str(&format!("{},\"quoted\n\n{}\n\",x\n", i, "y".repeat(i % 5)));
+            } else {
+                content.push_str(&format!("{},b{},\"c,{}\"\n\n", i, i, i));
+            }
+        }
+        let bytes = content.as_bytes();
+        let single = index_chunk(bytes, 0..bytes.len(), b',');
+        assert_eq!(single.columns, 3);
+
+        // A chunk per line, so many chunks start inside a quoted field
+        let mut bounds = vec![0];
+        bounds.extend(content.match_indices('\n').map(|(i, _)| i + 1));
+        let (rows, columns) = index_chunks(bytes, &bounds, b',');
+        assert_eq!(rows, single.rows);
+        assert_eq!(columns, 3);
+
+        let data = parse_csv(content.as_str(), Delimiter::Comma).unwrap();
+        assert_eq!(data.row_count(), 200);
+        assert_eq!(data.get(7, 1), "quoted\n\nyy\n");
+        assert_eq!(data.get(8, 2), "c,8");
+    }
+
     #[test]
     fn test_parse_single_column() {
         let content = "a\nb\nc\n";
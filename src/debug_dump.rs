@@ -4,8 +4,9 @@
 //! Triggered by F7 in debug builds.
 
 use serde::Serialize;
-use std::collections::HashMap;
+use std::collections::{BTreeMap, HashMap};
 
+use token::memory::{self, MemoryUsage};
 use token::model::{AppModel, LayoutNode, SplitDirection};
 
 #[derive(Serialize)]
@@ -16,6 +17,7 @@ pub struct StateDump {
     pub char_width: f32,
     pub editor_area: EditorAreaDump,
     pub ui: UiStateDump,
+    pub memory: MemoryDump,
 }
 
 #[derive(Serialize)]
@@ -36,6 +38,7 @@ pub struct DocumentDump {
     pub char_count: usize,
     pub undo_stack_size: usize,
     pub redo_stack_size: usize,
+    pub undo_memory_bytes: usize,
     pub language: String,
     pub revision: u64,
     pub syntax_highlights: Option<SyntaxHighlightsDump>,
@@ -133,10 +136,27 @@ pub enum LayoutNodeDump {
     },
 }
 
+#[derive(Serialize)]
+pub struct MemoryDump {
+    pub total_bytes: usize,
+    /// Bytes per subsystem, by subsystem name
+    pub subsystems: BTreeMap<&'static str, SubsystemMemoryDump>,
+    /// Cached parse-state bytes per document, from the syntax workers
+    pub parser_cache_documents: BTreeMap<u64, usize>,
+}
+
+#[derive(Serialize)]
+pub struct SubsystemMemoryDump {
+    pub bytes: usize,
+    pub cap_bytes: Option<usize>,
+}
+
 #[derive(Serialize)]
 pub struct UiStateDump {
     pub cursor_visible: bool,
     pub status_bar_segments: usize,
+    /// Undo history bytes of the open modal's and remembered modals' inputs
+    pub modal_undo_memory_bytes: usize,
 }
 
 impl StateDump {
@@ -152,7 +172,9 @@ impl StateDump {
             ui: UiStateDump {
                 cursor_visible: model.ui.cursor_visible,
                 status_bar_segments: model.ui.status_bar.all_segments().count(),
+                modal_undo_memory_bytes: memory::modal_undo_memory_bytes(model),
             },
+            memory: MemoryDump::from_model(model),
         }
     }
 
@@ -182,18 +204,16 @@ impl EditorAreaDump {
             .iter()
             .map(|(id, doc)| {
                 let syntax_highlights = doc.syntax_highlights.as_ref().map(|hl| {
-                    let total_tokens: usize = hl.lines.values().map(|lh| lh.tokens.len()).sum();
+                    let total_tokens = hl.token_count();
                     let lines_with_tokens: Vec<LineHighlightDump> = hl
-                        .lines
-                        .iter()
-                        .map(|(&line, lh)| LineHighlightDump {
+                        .iter_lines()
+                        .map(|(line, tokens)| LineHighlightDump {
                             line,
-                            tokens: lh
-                                .tokens
+                            tokens: tokens
                                 .iter()
                                 .map(|t| TokenDump {
-                                    start_col: t.start_col,
-                                    end_col: t.end_col,
+                                    start_col: t.start_col as usize,
+                                    end_col: t.end_col as usize,
                                     highlight_name: token::syntax::HIGHLIGHT_NAMES
                                         .get(t.highlight as usize)
                                         .unwrap_or(&"?")
@@ -204,7 +224,7 @@ impl EditorAreaDump {
                         .collect();
                     SyntaxHighlightsDump {
                         revision: hl.revision,
-                        line_count: hl.lines.len(),
+                        line_count: hl.line_count(),
                         total_tokens,
                         lines_with_tokens,
                     }
@@ -219,6 +239,7 @@ impl EditorAreaDump {
                         char_count: doc.buffer.len_chars(),
                         undo_stack_size: doc.undo_stack.len(),
                         redo_stack_size: doc.redo_stack.len(),
+                        undo_memory_bytes: doc.undo_memory_bytes(),
                         language: doc.language.display_name().to_string(),
                         revision: doc.revision,
                         syntax_highlights,
@@ -309,6 +330,32 @@ impl EditorAreaDump {
     }
 }
 
+impl MemoryDump {
+    fn from_model(model: &AppModel) -> Self {
+        let usage = MemoryUsage::measure(model);
+        Self {
+            total_bytes: usage.total(),
+            subsystems: usage
+                .iter()
+                .map(|(subsystem, bytes)| {
+                    (
+                        subsystem.name(),
+                        SubsystemMemoryDump {
+                            bytes,
+                            cap_bytes: memory::cap_bytes(model, subsystem),
+                        },
+                    )
+                })
+                .collect(),
+            parser_cache_documents: model
+                .memory
+                .parser_cache_documents()
+                .map(|(document_id, bytes)| (document_id.0, bytes))
+                .collect(),
+        }
+    }
+}
+
 fn layout_node_dump(node: &LayoutNode) -> LayoutNodeDump {
     match node {
         LayoutNode::Empty => LayoutNodeDump::Empty,
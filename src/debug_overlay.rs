@@ -5,7 +5,9 @@
 use std::collections::VecDeque;
 use std::time::Instant;
 
+use crate::memory::{self, MemoryUsage};
 use crate::model::{AppModel, EditorState};
+use crate::view::editor_special_tabs::format_file_size;
 
 /// Maximum number of messages to retain in history
 const MESSAGE_HISTORY_SIZE: usize = 50;
@@ -25,6 +27,8 @@ pub struct DebugOverlay {
     pub show_messages: bool,
     /// Show syntax highlighting state
     pub show_syntax: bool,
+    /// Show memory held per subsystem
+    pub show_memory: bool,
     /// Recent message history
     pub message_history: VecDeque<MessageEntry>,
     /// Recent syntax events history
@@ -71,6 +75,7 @@ impl DebugOverlay {
             show_selections: true,
             show_messages: true,
             show_syntax: true,
+            show_memory: true,
             message_history: VecDeque::with_capacity(MESSAGE_HISTORY_SIZE),
             syntax_events: VecDeque::with_capacity(SYNTAX_EVENT_HISTORY_SIZE),
         }
@@ -142,6 +147,11 @@ impl DebugOverlay {
             lines.extend(self.render_syntax_info(model));
         }
 
+        if self.show_memory {
+            lines.push(String::new());
+            lines.extend(self.render_memory_info(model));
+        }
+
         if self.show_messages && !self.message_history.is_empty() {
             lines.push(String::new());
             lines.push("Recent Messages:".to_string());
@@ -213,6 +223,29 @@ impl DebugOverlay {
         ]
     }
 
+    fn render_memory_info(&self, model: &AppModel) -> Vec<String> {
+        let usage = MemoryUsage::measure(model);
+        let mut lines = vec![format!(
+            "Memory: {}",
+            format_file_size(usage.total() as u64)
+        )];
+        for (subsystem, bytes) in usage.iter() {
+            let cap = memory::cap_bytes(model, subsystem);
+            let cap_note = match cap {
+                Some(cap) if bytes > cap => format!(" OVER CAP {}", format_file_size(cap as u64)),
+                Some(cap) => format!(" / {}", format_file_size(cap as u64)),
+                None => String::new(),
+            };
+            lines.push(format!(
+                "  {:<18} {:>9}{}",
+                subsystem.name(),
+                format_file_size(bytes as u64),
+                cap_note
+            ));
+        }
+        lines
+    }
+
     fn render_syntax_info(&self, model: &AppModel) -> Vec<String> {
         let mut lines = vec!["Syntax Highlighting:".to_string()];
 
@@ -227,8 +260,8 @@ impl DebugOverlay {
             lines.push(format!("  Language: {}", lang_name));
 
             if let Some(ref highlights) = doc.syntax_highlights {
-                let line_count = highlights.lines.len();
-                let total_tokens: usize = highlights.lines.values().map(|lh| lh.tokens.len()).sum();
+                let line_count = highlights.line_count();
+                let total_tokens = highlights.token_count();
                 let hl_revision = highlights.revision;
                 let revision_match = if hl_revision == revision {
                     "✓"
@@ -243,9 +276,9 @@ impl DebugOverlay {
 
                 // Show tokens for the current cursor line
                 let cursor_line = model.editor().primary_cursor().line;
-                if let Some(line_highlights) = highlights.lines.get(&cursor_line) {
+                if let Some(line_tokens) = highlights.get_line(cursor_line) {
                     lines.push(format!("  Line {} tokens:", cursor_line));
-                    for (i, tok) in line_highlights.tokens.iter().take(5).enumerate() {
+                    for (i, tok) in line_tokens.iter().take(5).enumerate() {
                         let hl_name = crate::syntax::HIGHLIGHT_NAMES
                             .get(tok.highlight as usize)
                             .unwrap_or(&"?");
@@ -254,11 +287,8 @@ impl DebugOverlay {
                             i, tok.start_col, tok.end_col, hl_name
                         ));
                     }
-                    if line_highlights.tokens.len() > 5 {
-                        lines.push(format!(
-                            "    ... {} more tokens",
-                            line_highlights.tokens.len() - 5
-                        ));
+                    if line_tokens.len() > 5 {
+                        lines.push(format!("    ... {} more tokens", line_tokens.len() - 5));
                     }
                 } else {
                     lines.push(format!("  Line {} tokens: (none)", cursor_line));
@@ -1,7 +1,16 @@
 //! Edit history (undo/redo) for the unified text editing system.
+//!
+//! The undo stack is a ring buffer bounded by the bytes its operations hold
+//! rather than by entry count, and consecutive single-character typing or
+//! deleting is merged into one operation per word.
+
+use std::collections::VecDeque;
 
 use super::cursor::Cursor;
 
+/// Default byte budget for the operations of one history
+pub const DEFAULT_HISTORY_BYTES: usize = 256 * 1024;
+
 /// A single edit operation that can be undone/redone.
 #[derive(Debug, Clone)]
 pub struct EditOperation {
@@ -94,57 +103,155 @@ impl EditOperation {
             cursors_after: self.cursors_before.clone(),
         }
     }
+
+    /// Heap and inline bytes held by this operation
+    pub fn memory_bytes(&self) -> usize {
+        std::mem::size_of::<Self>()
+            + self.deleted_text.capacity()
+            + self.inserted_text.capacity()
+            + (self.cursors_before.capacity() + self.cursors_after.capacity())
+                * std::mem::size_of::<Cursor>()
+    }
+
+    /// Extend this operation with `next` if both are single-cursor typing
+    /// (or deleting) that continues exactly where this one left off.
+    ///
+    /// Typing merges within a word: a run of spaces is kept with the word
+    /// before it and a new word, or any newline, starts a new operation.
+    fn try_coalesce(&mut self, next: &EditOperation) -> bool {
+        if self.cursors_after.len() != 1
+            || next.cursors_before.len() != 1
+            || self.cursors_after != next.cursors_before
+        {
+            return false;
+        }
+
+        let mut next_chars = next.inserted_text.chars().chain(next.deleted_text.chars());
+        let next_char = match (next_chars.next(), next_chars.next()) {
+            (Some(ch), None) if ch != '\n' => ch,
+            _ => return false,
+        };
+
+        if next.deleted_text.is_empty() {
+            // Typing, onto a previous insert (or a replace that typed over a
+            // selection)
+            let last_char = match self.inserted_text.chars().next_back() {
+                Some(ch) => ch,
+                None => return false,
+            };
+            let inserted_len = self.inserted_text.chars().count();
+            if next.offset != self.offset + inserted_len
+                || (last_char.is_whitespace() && !next_char.is_whitespace())
+            {
+                return false;
+            }
+            self.inserted_text.push(next_char);
+        } else {
+            if !self.inserted_text.is_empty() || self.deleted_text.is_empty() {
+                return false;
+            }
+            if next.offset + 1 == self.offset {
+                // Backspace
+                self.deleted_text.insert(0, next_char);
+                self.offset = next.offset;
+            } else if next.offset == self.offset {
+                // Forward delete
+                self.deleted_text.push(next_char);
+            } else {
+                return false;
+            }
+        }
+
+        self.cursors_after.clone_from(&next.cursors_after);
+        true
+    }
 }
 
 /// Edit history with undo/redo stacks.
-#[derive(Debug, Clone, Default)]
+///
+/// Operations are kept oldest-first in a ring buffer; once their combined
+/// [`memory_bytes`](EditOperation::memory_bytes) pass the budget the oldest
+/// are dropped. The newest operation is always kept, so even an edit larger
+/// than the whole budget can be undone.
+#[derive(Debug, Clone)]
 pub struct EditHistory {
-    undo_stack: Vec<EditOperation>,
+    undo_stack: VecDeque<EditOperation>,
     redo_stack: Vec<EditOperation>,
-    max_size: usize,
+    /// Bytes held by `undo_stack` and `redo_stack`
+    bytes: usize,
+    max_bytes: usize,
+    /// Whether the next push may merge into the top of the undo stack
+    coalesce: bool,
+}
+
+impl Default for EditHistory {
+    fn default() -> Self {
+        Self::new()
+    }
 }
 
 impl EditHistory {
-    /// Create a new edit history with default max size
+    /// Create a new edit history with the default byte budget
     pub fn new() -> Self {
-        Self {
-            undo_stack: Vec::new(),
-            redo_stack: Vec::new(),
-            max_size: 1000,
-        }
+        Self::with_max_bytes(DEFAULT_HISTORY_BYTES)
     }
 
-    /// Create a new edit history with specified max size
-    pub fn with_max_size(max_size: usize) -> Self {
+    /// Create a new edit history that keeps at most `max_bytes` of operations
+    pub fn with_max_bytes(max_bytes: usize) -> Self {
         Self {
-            undo_stack: Vec::new(),
+            undo_stack: VecDeque::new(),
             redo_stack: Vec::new(),
-            max_size,
+            bytes: 0,
+            max_bytes,
+            coalesce: false,
         }
     }
 
     /// Push an operation onto the undo stack (clears redo stack)
+    ///
+    /// Typing that continues the previous operation is merged into it.
     pub fn push(&mut self, op: EditOperation) {
-        self.redo_stack.clear();
-        self.undo_stack.push(op);
-
-        // Trim if exceeded max size
-        while self.undo_stack.len() > self.max_size {
-            self.undo_stack.remove(0);
+        self.clear_redo();
+
+        if self.coalesce {
+            if let Some(last) = self.undo_stack.back_mut() {
+                let before = last.memory_bytes();
+                if last.try_coalesce(&op) {
+                    self.bytes = self.bytes - before + last.memory_bytes();
+                    self.trim();
+                    return;
+                }
+            }
         }
+
+        self.bytes += op.memory_bytes();
+        self.undo_stack.push_back(op);
+        self.coalesce = true;
+        self.trim();
+    }
+
+    /// Stop the next push from merging into the current top operation
+    pub fn break_coalescing(&mut self) {
+        self.coalesce = false;
     }
 
     /// Pop an operation from the undo stack (moves to redo stack)
     pub fn pop_undo(&mut self) -> Option<EditOperation> {
-        let op = self.undo_stack.pop()?;
-        self.redo_stack.push(op.inverse());
+        let op = self.undo_stack.pop_back()?;
+        let inverse = op.inverse();
+        self.bytes = self.bytes - op.memory_bytes() + inverse.memory_bytes();
+        self.redo_stack.push(inverse);
+        self.coalesce = false;
         Some(op)
     }
 
     /// Pop an operation from the redo stack (moves to undo stack)
     pub fn pop_redo(&mut self) -> Option<EditOperation> {
         let op = self.redo_stack.pop()?;
-        self.undo_stack.push(op.inverse());
+        let inverse = op.inverse();
+        self.bytes = self.bytes - op.memory_bytes() + inverse.memory_bytes();
+        self.undo_stack.push_back(inverse);
+        self.coalesce = false;
         Some(op)
     }
 
@@ -162,6 +269,8 @@ impl EditHistory {
     pub fn clear(&mut self) {
         self.undo_stack.clear();
         self.redo_stack.clear();
+        self.bytes = 0;
+        self.coalesce = false;
     }
 
     /// Get the number of operations in the undo stack
@@ -173,6 +282,26 @@ impl EditHistory {
     pub fn redo_count(&self) -> usize {
         self.redo_stack.len()
     }
+
+    /// Bytes held by the undo and redo stacks
+    pub fn memory_bytes(&self) -> usize {
+        self.bytes
+    }
+
+    fn clear_redo(&mut self) {
+        for op in self.redo_stack.drain(..) {
+            self.bytes -= op.memory_bytes();
+        }
+    }
+
+    /// Drop the oldest operations until the budget is met, keeping the newest
+    fn trim(&mut self) {
+        while self.bytes > self.max_bytes && self.undo_stack.len() > 1 {
+            if let Some(op) = self.undo_stack.pop_front() {
+                self.bytes -= op.memory_bytes();
+            }
+        }
+    }
 }
 
 #[cfg(test)]
@@ -211,7 +340,7 @@ mod tests {
     fn test_history_undo_redo() {
         let mut history = EditHistory::new();
 
-        // Push two operations
+        // Push two operations that don't continue each other
         history.push(EditOperation::insert(
             0,
             "a".to_string(),
@@ -220,9 +349,9 @@ mod tests {
         ));
         history.push(EditOperation::insert(
             1,
-            "b".to_string(),
+            "bc".to_string(),
             cursor_at(0, 1),
-            cursor_at(0, 2),
+            cursor_at(0, 3),
         ));
 
         assert_eq!(history.undo_count(), 2);
@@ -230,18 +359,112 @@ mod tests {
 
         // Undo once - returns the original operation
         let op1 = history.pop_undo().unwrap();
-        assert_eq!(op1.inserted_text, "b");
+        assert_eq!(op1.inserted_text, "bc");
         assert!(history.can_redo());
 
         // Redo - returns the inverse of the inverse (back to original insert)
-        // The redo stack contains the inverse (a delete of "b"),
+        // The redo stack contains the inverse (a delete of "bc"),
         // and pop_redo returns that inverse and pushes its inverse back to undo
         let op2 = history.pop_redo().unwrap();
-        // op2 is the inverse: it has deleted_text="b", inserted_text=""
-        assert_eq!(op2.deleted_text, "b");
+        // op2 is the inverse: it has deleted_text="bc", inserted_text=""
+        assert_eq!(op2.deleted_text, "bc");
         assert!(!history.can_redo());
     }
 
+    #[test]
+    fn test_history_coalesces_typing_per_word() {
+        let mut history = EditHistory::new();
+        for (i, ch) in "hi you".chars().enumerate() {
+            history.push(EditOperation::insert(
+                i,
+                ch.to_string(),
+                cursor_at(0, i),
+                cursor_at(0, i + 1),
+            ));
+        }
+
+        assert_eq!(history.undo_count(), 2);
+        let op = history.pop_undo().unwrap();
+        assert_eq!(op.inserted_text, "you");
+        assert_eq!(op.offset, 3);
+        assert_eq!(op.cursors_before, vec![cursor_at(0, 3)]);
+        assert_eq!(op.cursors_after, vec![cursor_at(0, 6)]);
+        let op = history.pop_undo().unwrap();
+        assert_eq!(op.inserted_text, "hi ");
+
+        // Typing after an undo starts a new operation
+        history.pop_redo();
+        history.push(EditOperation::insert(
+            3,
+            "x".to_string(),
+            cursor_at(0, 3),
+            cursor_at(0, 4),
+        ));
+        assert_eq!(history.undo_count(), 2);
+    }
+
+    #[test]
+    fn test_history_coalesces_backspace_and_forward_delete() {
+        let mut history = EditHistory::new();
+        // Backspace over "abc" from the end
+        for i in (0..3).rev() {
+            history.push(EditOperation::delete(
+                i,
+                "abc"[i..i + 1].to_string(),
+                cursor_at(0, i + 1),
+                cursor_at(0, i),
+            ));
+        }
+        // Forward delete of "de" no longer continues the backspaces' cursor
+        for ch in ["d", "e"] {
+            history.push(EditOperation::delete(
+                5,
+                ch.to_string(),
+                cursor_at(0, 5),
+                cursor_at(0, 5),
+            ));
+        }
+
+        assert_eq!(history.undo_count(), 2);
+        assert_eq!(history.pop_undo().unwrap().deleted_text, "de");
+        let op = history.pop_undo().unwrap();
+        assert_eq!(op.deleted_text, "abc");
+        assert_eq!(op.offset, 0);
+    }
+
+    #[test]
+    fn test_history_does_not_coalesce_moved_cursor_or_newline() {
+        let mut history = EditHistory::new();
+        history.push(EditOperation::insert(
+            0,
+            "a".to_string(),
+            cursor_at(0, 0),
+            cursor_at(0, 1),
+        ));
+        history.push(EditOperation::insert(
+            1,
+            "\n".to_string(),
+            cursor_at(0, 1),
+            cursor_at(1, 0),
+        ));
+        // Cursor moved between edits
+        history.push(EditOperation::insert(
+            0,
+            "b".to_string(),
+            cursor_at(0, 0),
+            cursor_at(0, 1),
+        ));
+        history.break_coalescing();
+        history.push(EditOperation::insert(
+            1,
+            "c".to_string(),
+            cursor_at(0, 1),
+            cursor_at(0, 2),
+        ));
+
+        assert_eq!(history.undo_count(), 4);
+    }
+
     #[test]
     fn test_history_push_clears_redo() {
         let mut history = EditHistory::new();
@@ -266,18 +489,55 @@ mod tests {
     }
 
     #[test]
-    fn test_history_max_size() {
-        let mut history = EditHistory::with_max_size(3);
+    fn test_history_byte_budget_evicts_oldest() {
+        let op = |i: usize, len: usize| {
+            EditOperation::insert(i * 100, "x".repeat(len), cursor_at(i, 0), cursor_at(i, len))
+        };
+        let op_bytes = op(0, 10).memory_bytes();
+        let mut history = EditHistory::with_max_bytes(3 * op_bytes);
 
         for i in 0..5 {
-            history.push(EditOperation::insert(
-                i,
-                format!("{}", i),
-                cursor_at(0, i),
-                cursor_at(0, i + 1),
-            ));
+            history.push(op(i, 10));
         }
-
         assert_eq!(history.undo_count(), 3);
+        assert_eq!(history.memory_bytes(), 3 * op_bytes);
+        assert_eq!(history.pop_undo().unwrap().offset, 400);
+
+        // An edit larger than the whole budget is still undoable
+        history.push(op(9, 10_000));
+        assert_eq!(history.undo_count(), 1);
+        assert!(history.memory_bytes() > 3 * op_bytes);
+
+        history.clear();
+        assert_eq!(history.memory_bytes(), 0);
+    }
+
+    #[test]
+    fn test_history_memory_tracks_undo_and_redo() {
+        let mut history = EditHistory::new();
+        history.push(EditOperation::replace(
+            0,
+            "old".to_string(),
+            "new text".to_string(),
+            cursor_at(0, 0),
+            cursor_at(0, 8),
+        ));
+        let bytes = history.memory_bytes();
+        assert!(bytes > 0);
+
+        history.pop_undo();
+        history.pop_redo();
+        assert_eq!(history.undo_count(), 1);
+        assert_eq!(history.memory_bytes(), history.undo_stack[0].memory_bytes());
+
+        history.pop_undo();
+        history.push(EditOperation::insert(
+            0,
+            "z".to_string(),
+            cursor_at(0, 0),
+            cursor_at(0, 1),
+        ));
+        assert_eq!(history.redo_count(), 0);
+        assert_eq!(history.memory_bytes(), history.undo_stack[0].memory_bytes());
     }
 }
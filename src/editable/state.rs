@@ -97,6 +97,11 @@ impl<B: TextBuffer> EditableState<B> {
         self.constraints.enable_undo && self.history.can_redo()
     }
 
+    /// Bytes held by the undo/redo history
+    pub fn history_memory_bytes(&self) -> usize {
+        self.history.memory_bytes()
+    }
+
     /// Collapse to a single cursor (for contexts that don't support multi-cursor)
     pub fn collapse_cursors(&mut self) {
         if self.cursors.len() > 1 {
@@ -1171,16 +1176,19 @@ mod tests {
 
         state.insert_char('a');
         state.insert_char('b');
-        assert_eq!(state.text(), "ab");
+        state.insert_char(' ');
+        state.insert_char('c');
+        assert_eq!(state.text(), "ab c");
 
+        // Typing is undone a word at a time
         assert!(state.undo());
-        assert_eq!(state.text(), "a");
+        assert_eq!(state.text(), "ab ");
 
         assert!(state.undo());
         assert_eq!(state.text(), "");
 
         assert!(state.redo());
-        assert_eq!(state.text(), "a");
+        assert_eq!(state.text(), "ab ");
     }
 
     #[test]
@@ -0,0 +1,232 @@
+//! Frame pacing for the event loop
+//!
+//! Holding a key, dragging a selection or scrolling with a trackpad makes
+//! winit deliver events much faster than the display refreshes. Drawing a
+//! frame per event burns CPU without showing more frames, so the runtime
+//! coalesces those bursts and asks [`FrameScheduler`] when it may draw: at
+//! most once per refresh interval, and immediately when the last frame is
+//! older than that, so input after a pause isn't delayed.
+//!
+//! [`FramePacingStats`] (kept in [`PerfStats::pacing`](crate::perf::PerfStats))
+//! counts frames that started later than they could have, the refresh
+//! intervals they missed, and the input events merged into other updates.
+
+use std::time::{Duration, Instant};
+
+/// Refresh interval used until the monitor reports its rate (60 Hz)
+pub const DEFAULT_REFRESH_INTERVAL: Duration = Duration::from_nanos(16_666_667);
+
+/// Refresh rates outside this range are treated as bogus monitor reports
+const MIN_REFRESH_MILLIHERTZ: u32 = 20_000;
+const MAX_REFRESH_MILLIHERTZ: u32 = 500_000;
+
+/// Frame pacing counters, kept in every build
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct FramePacingStats {
+    /// Frames started
+    pub frames: u64,
+    /// Frames that started more than half a refresh interval after they
+    /// were due
+    pub late_frames: u64,
+    /// Whole refresh intervals missed by late frames
+    pub dropped_frames: u64,
+    /// Input events merged into a later event's update
+    pub coalesced_events: u64,
+    /// Largest delay of a frame past its due time
+    pub worst_lateness: Duration,
+}
+
+impl FramePacingStats {
+    /// Record a frame that started `lateness` after it was due
+    pub fn record_frame(&mut self, lateness: Duration, interval: Duration) {
+        self.frames += 1;
+        if lateness > interval / 2 {
+            self.late_frames += 1;
+            self.dropped_frames += (lateness.as_nanos() / interval.as_nanos().max(1)) as u64;
+        }
+        self.worst_lateness = self.worst_lateness.max(lateness);
+    }
+
+    /// Record `count` input events merged into another update
+    pub fn record_coalesced(&mut self, count: u64) {
+        self.coalesced_events += count;
+    }
+}
+
+/// Decides when the event loop may start the next frame
+#[derive(Debug)]
+pub struct FrameScheduler {
+    interval: Duration,
+    /// Start of the previous frame
+    last_frame: Option<Instant>,
+    /// When a redraw was first wanted since the previous frame
+    wanted_since: Option<Instant>,
+    /// Whether the window was already asked to redraw for it
+    issued: bool,
+}
+
+impl Default for FrameScheduler {
+    fn default() -> Self {
+        Self {
+            interval: DEFAULT_REFRESH_INTERVAL,
+            last_frame: None,
+            wanted_since: None,
+            issued: false,
+        }
+    }
+}
+
+impl FrameScheduler {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn interval(&self) -> Duration {
+        self.interval
+    }
+
+    /// Pace frames to the monitor's refresh rate, as reported by winit;
+    /// unknown or implausible rates fall back to 60 Hz
+    pub fn set_refresh_rate_millihertz(&mut self, millihertz: Option<u32>) {
+        self.interval = match millihertz {
+            Some(mhz) if (MIN_REFRESH_MILLIHERTZ..=MAX_REFRESH_MILLIHERTZ).contains(&mhz) => {
+                Duration::from_nanos(1_000_000_000_000 / mhz as u64)
+            }
+            _ => DEFAULT_REFRESH_INTERVAL,
+        };
+    }
+
+    /// Note that something changed and needs a redraw
+    pub fn want_redraw(&mut self, now: Instant) {
+        self.wanted_since.get_or_insert(now);
+    }
+
+    /// When the wanted redraw may start: one interval after the previous
+    /// frame, or right away when that has passed
+    fn due(&self) -> Option<Instant> {
+        let wanted = self.wanted_since?;
+        Some(match self.last_frame {
+            Some(last) => wanted.max(last + self.interval),
+            None => wanted,
+        })
+    }
+
+    /// Whether the window should be asked to redraw now
+    pub fn poll(&mut self, now: Instant) -> bool {
+        match self.due() {
+            Some(due) if due <= now => {
+                self.issued = true;
+                true
+            }
+            _ => false,
+        }
+    }
+
+    /// When the event loop has to wake up to request a wanted redraw;
+    /// `None` when there is none or it was already requested
+    pub fn wake_at(&self) -> Option<Instant> {
+        if self.issued {
+            None
+        } else {
+            self.due()
+        }
+    }
+
+    /// A frame is starting; frames nobody asked for (e.g. after the window
+    /// was exposed) are never late
+    pub fn begin_frame(&mut self, now: Instant, stats: &mut FramePacingStats) {
+        let lateness = self
+            .due()
+            .map_or(Duration::ZERO, |due| now.saturating_duration_since(due));
+        stats.record_frame(lateness, self.interval);
+        self.last_frame = Some(now);
+        self.wanted_since = None;
+        self.issued = false;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const INTERVAL: Duration = DEFAULT_REFRESH_INTERVAL;
+
+    #[test]
+    fn test_first_redraw_is_immediate() {
+        let mut scheduler = FrameScheduler::new();
+        let now = Instant::now();
+        scheduler.want_redraw(now);
+        assert!(scheduler.poll(now));
+        assert_eq!(scheduler.wake_at(), None, "already requested");
+    }
+
+    #[test]
+    fn test_redraws_wait_for_the_next_refresh() {
+        let mut scheduler = FrameScheduler::new();
+        let mut stats = FramePacingStats::default();
+        let start = Instant::now();
+        scheduler.begin_frame(start, &mut stats);
+
+        // A burst of input right after a frame waits for the next refresh
+        let soon = start + Duration::from_millis(2);
+        scheduler.want_redraw(soon);
+        scheduler.want_redraw(soon + Duration::from_millis(1));
+        assert!(!scheduler.poll(soon));
+        assert_eq!(scheduler.wake_at(), Some(start + INTERVAL));
+
+        assert!(scheduler.poll(start + INTERVAL));
+        scheduler.begin_frame(start + INTERVAL, &mut stats);
+        assert_eq!(stats.frames, 2);
+        assert_eq!(stats.late_frames, 0);
+
+        // Nothing wanted, nothing to wake up for
+        assert_eq!(scheduler.wake_at(), None);
+        assert!(!scheduler.poll(start + INTERVAL * 5));
+    }
+
+    #[test]
+    fn test_input_after_a_pause_is_not_delayed() {
+        let mut scheduler = FrameScheduler::new();
+        let mut stats = FramePacingStats::default();
+        let start = Instant::now();
+        scheduler.begin_frame(start, &mut stats);
+
+        let later = start + Duration::from_secs(2);
+        scheduler.want_redraw(later);
+        assert!(scheduler.poll(later));
+        scheduler.begin_frame(later + Duration::from_millis(1), &mut stats);
+        assert_eq!(stats.late_frames, 0);
+    }
+
+    #[test]
+    fn test_late_frames_count_missed_intervals() {
+        let mut scheduler = FrameScheduler::new();
+        let mut stats = FramePacingStats::default();
+        let start = Instant::now();
+        scheduler.begin_frame(start, &mut stats);
+
+        scheduler.want_redraw(start);
+        // Due one interval after the last frame, started three intervals on
+        scheduler.begin_frame(start + INTERVAL * 4, &mut stats);
+        assert_eq!(stats.late_frames, 1);
+        assert_eq!(stats.dropped_frames, 3);
+        assert!(stats.worst_lateness >= INTERVAL * 3);
+
+        // Unrequested frames are never late
+        scheduler.begin_frame(start + INTERVAL * 20, &mut stats);
+        assert_eq!(stats.late_frames, 1);
+        assert_eq!(stats.frames, 3);
+    }
+
+    #[test]
+    fn test_refresh_rate() {
+        let mut scheduler = FrameScheduler::new();
+        scheduler.set_refresh_rate_millihertz(Some(120_000));
+        assert_eq!(scheduler.interval(), Duration::from_nanos(8_333_333));
+
+        scheduler.set_refresh_rate_millihertz(Some(0));
+        assert_eq!(scheduler.interval(), DEFAULT_REFRESH_INTERVAL);
+        scheduler.set_refresh_rate_millihertz(None);
+        assert_eq!(scheduler.interval(), DEFAULT_REFRESH_INTERVAL);
+    }
+}
@@ -40,12 +40,29 @@ impl FileSystemWatcher {
     /// Events are debounced with a 500ms delay to coalesce rapid changes
     /// (e.g., git operations, build processes).
     pub fn new(root: PathBuf) -> Result<Self, notify::Error> {
+        Self::with_wake(root, || {})
+    }
+
+    /// Like [`new`](Self::new), calling `wake` from the watcher thread
+    /// whenever events are queued, so an idle event loop can sleep until
+    /// there is something to poll
+    pub fn with_wake(
+        root: PathBuf,
+        wake: impl Fn() + Send + 'static,
+    ) -> Result<Self, notify::Error> {
         let (tx, rx) = mpsc::channel();
 
         // 500ms debounce delay - balances responsiveness with avoiding spam
         let debounce_duration = Duration::from_millis(500);
 
-        let mut debouncer = new_debouncer(debounce_duration, tx)?;
+        let mut debouncer = new_debouncer(
+            debounce_duration,
+            move |result: notify_debouncer_mini::DebounceEventResult| {
+                if tx.send(result).is_ok() {
+                    wake();
+                }
+            },
+        )?;
 
         // Watch the root directory recursively
         debouncer
@@ -393,6 +410,33 @@ mod tests {
         assert!(!events.is_empty(), "Should detect file creation");
     }
 
+    #[test]
+    #[cfg_attr(
+        target_os = "macos",
+        ignore = "FSEvents on macOS requires a CFRunLoop, which is unavailable in test threads"
+    )]
+    fn test_watcher_wakes_when_events_are_queued() {
+        use std::sync::atomic::{AtomicUsize, Ordering};
+        use std::sync::Arc;
+
+        let dir = tempdir().expect("Failed to create temp dir");
+        let wakes = Arc::new(AtomicUsize::new(0));
+        let counter = Arc::clone(&wakes);
+        let watcher = FileSystemWatcher::with_wake(dir.path().to_path_buf(), move || {
+            counter.fetch_add(1, Ordering::SeqCst);
+        })
+        .expect("Failed to create watcher");
+
+        fs::write(dir.path().join("wake.txt"), "hello").expect("Failed to write file");
+
+        let events = poll_events_with_timeout(&watcher, Duration::from_millis(3000));
+        assert!(!events.is_empty(), "Should detect file creation");
+        assert!(
+            wakes.load(Ordering::SeqCst) > 0,
+            "Should wake the event loop"
+        );
+    }
+
     #[test]
     #[cfg_attr(
         target_os = "macos",
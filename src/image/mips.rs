@@ -0,0 +1,230 @@
+//! Pre-scaled copies of a decoded image
+//!
+//! Sampling a 40-megapixel image straight from full resolution at 10% zoom
+//! reads one pixel in a hundred, scattered over rows far apart, and aliases
+//! badly. A [`MipChain`] keeps the image at full size plus successively
+//! halved levels, built on demand with a 2×2 box filter, and rendering
+//! samples the smallest level that still has at least one texel per screen
+//! pixel.
+
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+
+/// Source of [`MipChain::id`]s
+static NEXT_CHAIN_ID: AtomicU64 = AtomicU64::new(1);
+
+/// One level of a mip chain: RGBA8 pixels, 4 bytes per pixel
+pub struct MipLevel {
+    pub width: u32,
+    pub height: u32,
+    pub pixels: Vec<u8>,
+}
+
+// A derived Debug would print every pixel
+impl std::fmt::Debug for MipLevel {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("MipLevel")
+            .field("width", &self.width)
+            .field("height", &self.height)
+            .finish_non_exhaustive()
+    }
+}
+
+impl MipLevel {
+    /// This level halved in both dimensions (rounding up), each pixel the
+    /// alpha-weighted average of the 2×2 block it covers
+    fn downsample(&self) -> MipLevel {
+        let width = self.width.div_ceil(2).max(1);
+        let height = self.height.div_ceil(2).max(1);
+        let src_w = self.width as usize;
+        let src_h = self.height as usize;
+        let mut pixels = Vec::with_capacity(width as usize * height as usize * 4);
+
+        for y in 0..height as usize {
+            let rows = [2 * y, (2 * y + 1).min(src_h - 1)];
+            for x in 0..width as usize {
+                let cols = [2 * x, (2 * x + 1).min(src_w - 1)];
+                let mut sum = [0u32; 4];
+                for row in rows {
+                    for col in cols {
+                        let i = (row * src_w + col) * 4;
+                        let a = self.pixels[i + 3] as u32;
+                        sum[0] += self.pixels[i] as u32 * a;
+                        sum[1] += self.pixels[i + 1] as u32 * a;
+                        sum[2] += self.pixels[i + 2] as u32 * a;
+                        sum[3] += a;
+                    }
+                }
+                // Weight colors by alpha so transparent pixels don't darken
+                // the edges of opaque ones
+                let alpha = sum[3];
+                if alpha == 0 {
+                    pixels.extend_from_slice(&[0, 0, 0, 0]);
+                } else {
+                    pixels.extend_from_slice(&[
+                        (sum[0] / alpha) as u8,
+                        (sum[1] / alpha) as u8,
+                        (sum[2] / alpha) as u8,
+                        (alpha / 4) as u8,
+                    ]);
+                }
+            }
+        }
+
+        MipLevel {
+            width,
+            height,
+            pixels,
+        }
+    }
+}
+
+/// A decoded image and the smaller levels built from it so far
+///
+/// Levels are shared between clones, so cloning a chain is cheap.
+#[derive(Debug, Clone)]
+pub struct MipChain {
+    /// Identifies the decoded image, for keying cached renders of it
+    id: u64,
+    /// Level `k` is `levels[0]` scaled by `2^-k`
+    levels: Vec<Arc<MipLevel>>,
+}
+
+impl MipChain {
+    /// Chain holding only the full-size image
+    ///
+    /// `pixels` must hold `width * height` RGBA8 pixels; missing ones are
+    /// filled in as transparent.
+    pub fn new(width: u32, height: u32, mut pixels: Vec<u8>) -> Self {
+        pixels.resize(width as usize * height as usize * 4, 0);
+        Self {
+            id: NEXT_CHAIN_ID.fetch_add(1, Ordering::Relaxed),
+            levels: vec![Arc::new(MipLevel {
+                width,
+                height,
+                pixels,
+            })],
+        }
+    }
+
+    pub fn id(&self) -> u64 {
+        self.id
+    }
+
+    /// The full-size image
+    pub fn base(&self) -> &MipLevel {
+        &self.levels[0]
+    }
+
+    /// Number of levels built so far
+    pub fn built_levels(&self) -> usize {
+        self.levels.len()
+    }
+
+    /// The smallest level that still has a texel per screen pixel at zoom
+    /// `scale`: the level whose scale `2^-k` is closest to `scale` without
+    /// going below it
+    pub fn level_for_scale(scale: f64) -> usize {
+        if scale.is_nan() || scale <= 0.0 || scale >= 1.0 {
+            return 0;
+        }
+        (1.0 / scale).log2().floor() as usize
+    }
+
+    /// Build levels down to `level`, stopping early at a 1×1 level
+    pub fn ensure_level(&mut self, level: usize) {
+        while self.levels.len() <= level {
+            let last = &self.levels[self.levels.len() - 1];
+            if last.width <= 1 && last.height <= 1 {
+                break;
+            }
+            let next = Arc::new(last.downsample());
+            self.levels.push(next);
+        }
+    }
+
+    /// Build the level rendering at zoom `scale` samples from
+    pub fn ensure_scale(&mut self, scale: f64) {
+        self.ensure_level(Self::level_for_scale(scale));
+    }
+
+    /// The level to sample at zoom `scale` and its index: the one
+    /// [`level_for_scale`](Self::level_for_scale) picks if it's built,
+    /// otherwise the smallest built level, which is larger than needed
+    pub fn level(&self, scale: f64) -> (usize, &MipLevel) {
+        let index = Self::level_for_scale(scale).min(self.levels.len() - 1);
+        (index, &self.levels[index])
+    }
+
+    /// Bytes of pixel data held by all built levels
+    pub fn memory_bytes(&self) -> usize {
+        self.levels.iter().map(|level| level.pixels.len()).sum()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn solid(width: u32, height: u32, rgba: [u8; 4]) -> Vec<u8> {
+        rgba.repeat((width * height) as usize)
+    }
+
+    #[test]
+    fn test_level_for_scale_stays_at_or_above_the_zoom() {
+        assert_eq!(MipChain::level_for_scale(2.0), 0);
+        assert_eq!(MipChain::level_for_scale(1.0), 0);
+        assert_eq!(MipChain::level_for_scale(0.6), 0);
+        assert_eq!(MipChain::level_for_scale(0.5), 1);
+        assert_eq!(MipChain::level_for_scale(0.3), 1);
+        assert_eq!(MipChain::level_for_scale(0.25), 2);
+        assert_eq!(MipChain::level_for_scale(0.1), 3);
+        assert_eq!(MipChain::level_for_scale(0.0), 0);
+    }
+
+    #[test]
+    fn test_levels_are_built_only_when_asked_for() {
+        let mut chain = MipChain::new(16, 10, solid(16, 10, [10, 20, 30, 255]));
+        assert_eq!(chain.built_levels(), 1);
+        assert_eq!(chain.level(0.1).0, 0);
+
+        chain.ensure_scale(0.3);
+        assert_eq!(chain.built_levels(), 2);
+        let (index, level) = chain.level(0.1);
+        assert_eq!((index, level.width, level.height), (1, 8, 5));
+
+        chain.ensure_level(10);
+        let (_, smallest) = chain.level(0.0001);
+        assert_eq!((smallest.width, smallest.height), (1, 1));
+        assert_eq!(&smallest.pixels[..], &[10, 20, 30, 255]);
+    }
+
+    #[test]
+    fn test_downsample_weights_colors_by_alpha() {
+        // One opaque red pixel and three transparent black ones
+        let mut pixels = solid(2, 2, [0, 0, 0, 0]);
+        pixels[..4].copy_from_slice(&[200, 0, 0, 255]);
+        let mut chain = MipChain::new(2, 2, pixels);
+        chain.ensure_level(1);
+        assert_eq!(&chain.level(0.5).1.pixels[..], &[200, 0, 0, 63]);
+    }
+
+    #[test]
+    fn test_odd_sizes_round_up() {
+        let mut chain = MipChain::new(5, 3, solid(5, 3, [1, 2, 3, 255]));
+        chain.ensure_level(1);
+        let level = chain.level(0.5).1;
+        assert_eq!((level.width, level.height), (3, 2));
+        assert_eq!(level.pixels.len(), 3 * 2 * 4);
+        assert!(level.pixels.chunks(4).all(|p| p == [1, 2, 3, 255]));
+    }
+
+    #[test]
+    fn test_clones_share_levels_and_id() {
+        let chain = MipChain::new(4, 4, solid(4, 4, [0, 0, 0, 255]));
+        let copy = chain.clone();
+        assert_eq!(copy.id(), chain.id());
+        assert!(std::ptr::eq(copy.base(), chain.base()));
+        assert_ne!(MipChain::new(1, 1, vec![0; 4]).id(), chain.id());
+    }
+}
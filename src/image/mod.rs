@@ -1,16 +1,31 @@
 //! Image viewer module
 //!
 //! Provides image viewing with pan and zoom support.
-//! Images are decoded into RGBA pixel buffers and rendered
-//! with nearest-neighbor scaling.
+//! Opening an image reads only its header; the pixels are decoded on a
+//! background thread into a [`MipChain`] and rendered with nearest-neighbor
+//! sampling from the level closest to the current zoom.
 
+pub mod mips;
 pub mod render;
 
+pub use mips::{MipChain, MipLevel};
+
+/// Pixels of an image in the viewer
+#[derive(Debug, Clone)]
+pub enum ImageData {
+    /// Decoding on a background thread; a placeholder is shown meanwhile
+    Loading,
+    /// Decoded RGBA pixels and the mip levels built from them so far
+    Ready(MipChain),
+    /// Decoding failed with this error
+    Failed(String),
+}
+
 /// State for the image viewer mode
 #[derive(Debug, Clone)]
 pub struct ImageState {
-    /// Decoded RGBA pixel data (4 bytes per pixel)
-    pub pixels: Vec<u8>,
+    /// Decoded pixels, once the background decode finished
+    pub data: ImageData,
     /// Image width in pixels
     pub width: u32,
     /// Image height in pixels
@@ -59,10 +74,32 @@ impl ImageState {
         format: String,
         viewport_width: u32,
         viewport_height: u32,
+    ) -> Self {
+        let mut state = Self::loading(
+            width,
+            height,
+            file_size,
+            format,
+            viewport_width,
+            viewport_height,
+        );
+        state.set_decoded(MipChain::new(width, height, pixels));
+        state
+    }
+
+    /// Create an ImageState for an image whose pixels are still being
+    /// decoded, sized from its header
+    pub fn loading(
+        width: u32,
+        height: u32,
+        file_size: u64,
+        format: String,
+        viewport_width: u32,
+        viewport_height: u32,
     ) -> Self {
         let scale = Self::compute_fit_scale(width, height, viewport_width, viewport_height);
         Self {
-            pixels,
+            data: ImageData::Loading,
             width,
             height,
             file_size,
@@ -95,6 +132,47 @@ impl ImageState {
         fit_scale.min(1.0)
     }
 
+    /// Bytes of decoded pixel data, including built mip levels
+    pub fn memory_bytes(&self) -> usize {
+        match &self.data {
+            ImageData::Ready(chain) => chain.memory_bytes(),
+            ImageData::Loading | ImageData::Failed(_) => 0,
+        }
+    }
+
+    /// Store the decoded pixels, building the mip level for the current zoom
+    pub fn set_decoded(&mut self, mut chain: MipChain) {
+        // The decoder has the final say on the size the header suggested
+        self.width = chain.base().width;
+        self.height = chain.base().height;
+        chain.ensure_scale(self.scale);
+        self.data = ImageData::Ready(chain);
+    }
+
+    /// Decoded pixels, if ready
+    pub fn mips(&self) -> Option<&MipChain> {
+        match &self.data {
+            ImageData::Ready(chain) => Some(chain),
+            _ => None,
+        }
+    }
+
+    /// Whether the pixels are still being decoded
+    pub fn is_loading(&self) -> bool {
+        matches!(self.data, ImageData::Loading)
+    }
+
+    /// Build the mip level rendering at the current zoom samples from
+    ///
+    /// Called once per frame before rendering; levels already built make it
+    /// a no-op.
+    pub fn sync_mips(&mut self) {
+        let scale = self.scale;
+        if let ImageData::Ready(chain) = &mut self.data {
+            chain.ensure_scale(scale);
+        }
+    }
+
     /// Get the zoom level as a percentage integer (e.g. 100 for 1.0)
     pub fn zoom_percent(&self) -> u32 {
         (self.scale * 100.0).round() as u32
@@ -112,18 +190,45 @@ impl ImageState {
     }
 }
 
-/// Load and decode an image file into an ImageState.
+/// Open an image file for viewing without decoding it.
 ///
-/// Returns None if the file can't be read or decoded.
-pub fn load_image(
+/// Reads the file size and the image header, which is enough to size and
+/// fit the viewer; the pixels are decoded later by [`decode_image`].
+/// Returns None if the file can't be read or its header isn't recognized.
+pub fn open_image(
     path: &std::path::Path,
     viewport_width: u32,
     viewport_height: u32,
 ) -> Option<ImageState> {
     let file_size = std::fs::metadata(path).ok()?.len();
+    let (width, height) = image::image_dimensions(path).ok()?;
+
+    Some(ImageState::loading(
+        width,
+        height,
+        file_size,
+        format_name(path),
+        viewport_width,
+        viewport_height,
+    ))
+}
 
-    let format = path
-        .extension()
+/// Decode an image file into a mip chain, building the level for zoom
+/// `scale` up front.
+///
+/// Runs on a background thread; see [`Cmd::DecodeImage`](crate::commands::Cmd::DecodeImage).
+pub fn decode_image(path: &std::path::Path, scale: f64) -> Result<MipChain, String> {
+    let img = image::open(path).map_err(|e| e.to_string())?;
+    let rgba = img.to_rgba8();
+    let (width, height) = rgba.dimensions();
+    let mut chain = MipChain::new(width, height, rgba.into_raw());
+    chain.ensure_scale(scale);
+    Ok(chain)
+}
+
+/// Display name of an image's format, from its extension
+fn format_name(path: &std::path::Path) -> String {
+    path.extension()
         .and_then(|e| e.to_str())
         .map(|e| match e.to_lowercase().as_str() {
             "jpg" | "jpeg" => "JPEG".to_string(),
@@ -134,20 +239,5 @@ pub fn load_image(
             "ico" => "ICO".to_string(),
             other => other.to_uppercase(),
         })
-        .unwrap_or_else(|| "Unknown".to_string());
-
-    let img = image::open(path).ok()?;
-    let rgba = img.to_rgba8();
-    let (width, height) = rgba.dimensions();
-    let pixels = rgba.into_raw();
-
-    Some(ImageState::new(
-        pixels,
-        width,
-        height,
-        file_size,
-        format,
-        viewport_width,
-        viewport_height,
-    ))
+        .unwrap_or_else(|| "Unknown".to_string())
 }
@@ -1,16 +1,18 @@
 //! Image rendering for the view layer
 //!
 //! Renders checkerboard background and scaled image pixels
-//! into the framebuffer using nearest-neighbor sampling.
+//! into the framebuffer using nearest-neighbor sampling from the
+//! image's mip level closest to the current zoom.
 
-use crate::image::ImageState;
+use crate::image::{ImageState, MipLevel};
 use crate::theme::ImagePreviewTheme;
 use crate::view::frame::Frame;
 
 /// Render an image in the given screen rectangle.
 ///
 /// 1. Fills the area with checkerboard pattern
-/// 2. Blits visible portion of the image with nearest-neighbor scaling
+/// 2. Blits visible portion of the image with nearest-neighbor scaling,
+///    or a solid placeholder of the image's size while it is still decoding
 /// 3. Centers the image if it's smaller than the viewport
 pub fn render_image(
     frame: &mut Frame,
@@ -43,76 +45,83 @@ pub fn render_image(
 
     let buf_width = frame.width();
     let buf_height = frame.height();
-    let buffer = frame.buffer_mut();
-    let img_w = image.width;
-    let img_h = image.height;
-    let scale = image.scale;
-    let off_x = image.offset_x;
-    let off_y = image.offset_y;
+    let visible_width = area_width.min(buf_width.saturating_sub(area_x));
+    let visible_height = area_height.min(buf_height.saturating_sub(area_y));
 
-    for sy in 0..area_height {
-        let screen_y = area_y + sy;
-        if screen_y >= buf_height {
-            break;
-        }
+    // Level to sample from; without one (still decoding) texels are image
+    // pixels and only their coverage matters
+    let level: Option<&MipLevel> = image.mips().map(|chain| chain.level(image.scale).1);
+    let (level_w, level_h) = level.map_or((image.width, image.height), |l| (l.width, l.height));
 
-        let row_start = screen_y * buf_width;
+    // Map screen pixels to level texels once per column and once per row
+    let to_texel = |screen: usize, center: f64, offset: f64, size: u32, level_size: u32| {
+        let img = ((screen as f64 - center) / image.scale + offset) as i64;
+        (img >= 0 && img < size as i64)
+            .then(|| (img as u64 * level_size as u64 / size as u64) as usize)
+    };
+    let columns: Vec<Option<usize>> = (0..visible_width)
+        .map(|sx| to_texel(sx, center_x, image.offset_x, image.width, level_w))
+        .collect();
 
-        for sx in 0..area_width {
-            let screen_x = area_x + sx;
-            if screen_x >= buf_width {
-                break;
-            }
+    let buffer = frame.buffer_mut();
 
-            // Map screen pixel to image coordinates
-            let img_x_f = (sx as f64 - center_x) / scale + off_x;
-            let img_y_f = (sy as f64 - center_y) / scale + off_y;
+    for sy in 0..visible_height {
+        let screen_y = area_y + sy;
+        let row_start = screen_y * buf_width + area_x;
+        let row = &mut buffer[row_start..row_start + visible_width];
+        let checker_row = (sy / cell) & 1;
+
+        let src_row = to_texel(sy, center_y, image.offset_y, image.height, level_h);
 
+        for (sx, (out, column)) in row.iter_mut().zip(&columns).enumerate() {
             // Checkerboard for background
             let checker_col = (sx / cell) & 1;
-            let checker_row = (sy / cell) & 1;
             let bg = if (checker_col ^ checker_row) == 0 {
                 light
             } else {
                 dark
             };
 
-            let pixel_idx = row_start + screen_x;
-
-            // Check if this screen pixel maps to a valid image pixel
-            let img_x = img_x_f as i64;
-            let img_y = img_y_f as i64;
+            let (Some(src_y), Some(src_x)) = (src_row, *column) else {
+                *out = bg;
+                continue;
+            };
+            let Some(level) = level else {
+                // Still decoding: show where the image will be
+                *out = dark;
+                continue;
+            };
 
-            if img_x >= 0 && img_y >= 0 && (img_x as u32) < img_w && (img_y as u32) < img_h {
-                let src_idx = (img_y as usize * img_w as usize + img_x as usize) * 4;
+            let src_idx = (src_y * level_w as usize + src_x) * 4;
+            let Some(px) = level.pixels.get(src_idx..src_idx + 4) else {
+                *out = bg;
+                continue;
+            };
+            *out = blend_over(px, bg);
+        }
+    }
+}
 
-                if src_idx + 3 < image.pixels.len() {
-                    let r = image.pixels[src_idx] as u32;
-                    let g = image.pixels[src_idx + 1] as u32;
-                    let b = image.pixels[src_idx + 2] as u32;
-                    let a = image.pixels[src_idx + 3] as u32;
+/// An RGBA8 pixel alpha-blended over an opaque ARGB background
+#[inline]
+fn blend_over(px: &[u8], bg: u32) -> u32 {
+    let r = px[0] as u32;
+    let g = px[1] as u32;
+    let b = px[2] as u32;
+    let a = px[3] as u32;
 
-                    if a == 255 {
-                        buffer[pixel_idx] = 0xFF000000 | (r << 16) | (g << 8) | b;
-                    } else if a == 0 {
-                        buffer[pixel_idx] = bg;
-                    } else {
-                        // Alpha blend over checkerboard
-                        let inv_a = 255 - a;
-                        let bg_r = (bg >> 16) & 0xFF;
-                        let bg_g = (bg >> 8) & 0xFF;
-                        let bg_b = bg & 0xFF;
-                        let out_r = (r * a + bg_r * inv_a) / 255;
-                        let out_g = (g * a + bg_g * inv_a) / 255;
-                        let out_b = (b * a + bg_b * inv_a) / 255;
-                        buffer[pixel_idx] = 0xFF000000 | (out_r << 16) | (out_g << 8) | out_b;
-                    }
-                } else {
-                    buffer[pixel_idx] = bg;
-                }
-            } else {
-                buffer[pixel_idx] = bg;
-            }
-        }
+    if a == 255 {
+        0xFF000000 | (r << 16) | (g << 8) | b
+    } else if a == 0 {
+        bg
+    } else {
+        let inv_a = 255 - a;
+        let bg_r = (bg >> 16) & 0xFF;
+        let bg_g = (bg >> 8) & 0xFF;
+        let bg_b = bg & 0xFF;
+        let out_r = (r * a + bg_r * inv_a) / 255;
+        let out_g = (g * a + bg_g * inv_a) / 255;
+        let out_b = (b * a + bg_b * inv_a) / 255;
+        0xFF000000 | (out_r << 16) | (out_g << 8) | out_b
     }
 }
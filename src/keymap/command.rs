@@ -170,6 +170,8 @@ pub enum Command {
     ToggleGotoLine,
     /// Toggle find/replace dialog
     ToggleFindReplace,
+    /// Toggle find-in-files dialog
+    FindInFiles,
     /// Open recent files modal
     OpenRecentFiles,
 
@@ -394,6 +396,7 @@ impl Command {
             }
             ToggleGotoLine => vec![Msg::Ui(UiMsg::ToggleModal(ModalId::GotoLine))],
             ToggleFindReplace => vec![Msg::Ui(UiMsg::ToggleModal(ModalId::FindReplace))],
+            FindInFiles => vec![Msg::Ui(UiMsg::ToggleModal(ModalId::FindInFiles))],
             OpenRecentFiles => vec![Msg::Ui(UiMsg::ToggleModal(ModalId::RecentFiles))],
 
             // Layout
@@ -505,6 +508,7 @@ impl Command {
             Command::ToggleCommandPalette
                 | Command::ToggleGotoLine
                 | Command::ToggleFindReplace
+                | Command::FindInFiles
                 | Command::OpenRecentFiles
                 | Command::FuzzyFileFinder
                 | Command::ToggleSidebar
@@ -591,6 +595,7 @@ impl Command {
             ToggleCommandPalette => "Command Palette",
             ToggleGotoLine => "Go to Line",
             ToggleFindReplace => "Find and Replace",
+            FindInFiles => "Find in Files",
             OpenRecentFiles => "Open Recent Files",
 
             NewTab => "New Tab",
@@ -155,6 +155,7 @@ pub fn default_bindings() -> Vec<Keybinding> {
         bind(KeyCode::Char('a'), cmd_shift, Command::ToggleCommandPalette),
         bind(KeyCode::Char('l'), cmd, Command::ToggleGotoLine),
         bind(KeyCode::Char('f'), cmd, Command::ToggleFindReplace),
+        bind(KeyCode::Char('f'), cmd_shift, Command::FindInFiles),
         // ====================================================================
         // Layout: Splits
         // ====================================================================
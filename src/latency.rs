@@ -0,0 +1,443 @@
+//! Input-to-present latency tracking
+//!
+//! [`PerfStats`](crate::perf::PerfStats) times render stages of a single
+//! frame, and only in debug builds. [`LatencyTracker`] measures what the
+//! user feels instead: how long after an input event its update finished,
+//! its syntax highlights came back from the workers, and the frame showing
+//! it was presented. It is always on; stamping an event costs an
+//! `Instant::now()` and recording a sample one histogram increment.
+//!
+//! Samples go into [`LatencyHistogram`]s, one per input kind and phase.
+//! The histograms bucket log-linearly like HDR histograms, so percentiles
+//! are within 1/16 of the true value at any magnitude while memory stays
+//! fixed.
+//!
+//! Set `TOKEN_LATENCY_REPORT` to a file path to have the histograms written
+//! there as JSON on exit (see [`report_path_from_env`]). With the
+//! `profile-tracing` feature every sample is also emitted as a tracing event,
+//! so `profile-chrome` traces show it next to the frame spans.
+
+use std::collections::HashMap;
+use std::time::{Duration, Instant};
+
+use crate::model::editor_area::DocumentId;
+
+/// Environment variable naming the file the latency report is written to
+pub const LATENCY_REPORT_ENV: &str = "TOKEN_LATENCY_REPORT";
+
+/// Sub-buckets per power of two; bounds the relative error to 1/16
+const SUB_BUCKET_BITS: u32 = 4;
+const SUB_BUCKETS: usize = 1 << SUB_BUCKET_BITS;
+
+/// Powers of two covered above the linear range: up to ~19 hours in µs
+const MAGNITUDES: usize = 32;
+
+const BUCKETS: usize = SUB_BUCKETS * (MAGNITUDES + 1);
+
+/// Syntax parses awaited at once; older ones are dropped past this
+const MAX_SYNTAX_WAITS: usize = 64;
+
+/// Inputs awaiting a present at once; older ones are dropped past this
+const MAX_PENDING_INPUTS: usize = 256;
+
+/// Kind of input event a latency sample started from
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum InputKind {
+    Key,
+    MouseButton,
+    MouseWheel,
+    Resize,
+}
+
+impl InputKind {
+    pub const ALL: [Self; 4] = [Self::Key, Self::MouseButton, Self::MouseWheel, Self::Resize];
+
+    pub const COUNT: usize = Self::ALL.len();
+
+    pub const fn label(self) -> &'static str {
+        match self {
+            Self::Key => "key",
+            Self::MouseButton => "mouse_button",
+            Self::MouseWheel => "mouse_wheel",
+            Self::Resize => "resize",
+        }
+    }
+}
+
+/// Point an input event's effect reached when a sample was taken
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum LatencyPhase {
+    /// The event's update and the commands it returned were processed
+    Update,
+    /// Syntax highlights for the edit it made arrived from the workers
+    Syntax,
+    /// A frame including its effect was presented
+    Present,
+}
+
+impl LatencyPhase {
+    pub const ALL: [Self; 3] = [Self::Update, Self::Syntax, Self::Present];
+
+    pub const COUNT: usize = Self::ALL.len();
+
+    pub const fn label(self) -> &'static str {
+        match self {
+            Self::Update => "update",
+            Self::Syntax => "syntax",
+            Self::Present => "present",
+        }
+    }
+}
+
+/// Log-linear histogram of durations in microseconds
+///
+/// Buckets are allocated on the first sample, so empty histograms are free.
+#[derive(Debug, Clone, Default)]
+pub struct LatencyHistogram {
+    counts: Vec<u64>,
+    total: u64,
+    sum_us: u64,
+    max_us: u64,
+}
+
+impl LatencyHistogram {
+    /// Bucket holding `us`: values below `SUB_BUCKETS` get one each, then
+    /// every power of two is split into `SUB_BUCKETS` equal parts
+    fn bucket(us: u64) -> usize {
+        if us < SUB_BUCKETS as u64 {
+            return us as usize;
+        }
+        let magnitude = (63 - us.leading_zeros()) - SUB_BUCKET_BITS;
+        let sub = (us >> magnitude) as usize - SUB_BUCKETS;
+        ((magnitude as usize + 1) * SUB_BUCKETS + sub).min(BUCKETS - 1)
+    }
+
+    /// Largest value that falls into `bucket`
+    fn bucket_max(bucket: usize) -> u64 {
+        if bucket < SUB_BUCKETS {
+            return bucket as u64;
+        }
+        let magnitude = (bucket / SUB_BUCKETS - 1) as u32;
+        let sub = (bucket % SUB_BUCKETS + SUB_BUCKETS) as u64;
+        ((sub + 1) << magnitude) - 1
+    }
+
+    pub fn record(&mut self, elapsed: Duration) {
+        let us = elapsed.as_micros().min(u64::MAX as u128) as u64;
+        if self.counts.is_empty() {
+            self.counts = vec![0; BUCKETS];
+        }
+        self.counts[Self::bucket(us)] += 1;
+        self.total += 1;
+        self.sum_us = self.sum_us.saturating_add(us);
+        self.max_us = self.max_us.max(us);
+    }
+
+    /// Number of samples recorded
+    pub fn count(&self) -> u64 {
+        self.total
+    }
+
+    pub fn max(&self) -> Duration {
+        Duration::from_micros(self.max_us)
+    }
+
+    pub fn mean(&self) -> Duration {
+        if self.total == 0 {
+            return Duration::ZERO;
+        }
+        Duration::from_micros(self.sum_us / self.total)
+    }
+
+    /// Duration at or below which fraction `quantile` (0.0..=1.0) of the
+    /// samples fall, rounded up to its bucket and clamped to the maximum
+    pub fn percentile(&self, quantile: f64) -> Duration {
+        if self.total == 0 {
+            return Duration::ZERO;
+        }
+        let rank = ((quantile.clamp(0.0, 1.0) * self.total as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (bucket, count) in self.counts.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return Duration::from_micros(Self::bucket_max(bucket).min(self.max_us));
+            }
+        }
+        self.max()
+    }
+
+    /// Summary as JSON: sample count and p50/p90/p99/max in microseconds
+    pub fn to_json(&self) -> serde_json::Value {
+        serde_json::json!({
+            "count": self.total,
+            "mean_us": self.mean().as_micros() as u64,
+            "p50_us": self.percentile(0.50).as_micros() as u64,
+            "p90_us": self.percentile(0.90).as_micros() as u64,
+            "p99_us": self.percentile(0.99).as_micros() as u64,
+            "max_us": self.max_us,
+        })
+    }
+}
+
+/// An input event whose effect hasn't been presented yet
+#[derive(Debug, Clone, Copy)]
+struct PendingInput {
+    kind: InputKind,
+    start: Instant,
+}
+
+/// Follows input events through update, syntax parsing and present, and
+/// keeps latency histograms per input kind and phase
+#[derive(Debug, Default)]
+pub struct LatencyTracker {
+    histograms: [[LatencyHistogram; LatencyPhase::COUNT]; InputKind::COUNT],
+    /// The event being handled, between `begin_input` and `end_input`
+    current: Option<PendingInput>,
+    /// Handled events that requested a redraw, oldest first
+    awaiting_present: Vec<PendingInput>,
+    /// Events that scheduled a syntax parse, by document and revision
+    awaiting_syntax: HashMap<(DocumentId, u64), PendingInput>,
+}
+
+impl LatencyTracker {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Stamp an input event as it arrives, before it is handled
+    pub fn begin_input(&mut self, kind: InputKind) {
+        self.begin_input_at(kind, Instant::now());
+    }
+
+    /// Stamp an input event that arrived at `start`, e.g. the first of a
+    /// burst merged into one update
+    pub fn begin_input_at(&mut self, kind: InputKind, start: Instant) {
+        self.current = Some(PendingInput { kind, start });
+    }
+
+    /// Finish handling the current input event. If it requested a redraw,
+    /// its present latency is taken at the next [`presented`](Self::presented).
+    pub fn end_input(&mut self, needs_redraw: bool) {
+        let Some(input) = self.current.take() else {
+            return;
+        };
+        self.record(input, LatencyPhase::Update, input.start.elapsed());
+        if needs_redraw {
+            if self.awaiting_present.len() >= MAX_PENDING_INPUTS {
+                self.awaiting_present.remove(0);
+            }
+            self.awaiting_present.push(input);
+        }
+    }
+
+    /// Note that the current input event scheduled a syntax parse of
+    /// `document_id` at `revision`
+    pub fn await_syntax(&mut self, document_id: DocumentId, revision: u64) {
+        let Some(input) = self.current else {
+            return;
+        };
+        if self.awaiting_syntax.len() >= MAX_SYNTAX_WAITS {
+            // Parses that never came back, e.g. of a closed document
+            if let Some(oldest) = self
+                .awaiting_syntax
+                .iter()
+                .min_by_key(|(_, input)| input.start)
+                .map(|(key, _)| *key)
+            {
+                self.awaiting_syntax.remove(&oldest);
+            }
+        }
+        self.awaiting_syntax.insert((document_id, revision), input);
+    }
+
+    /// Syntax highlights of `document_id` at `revision` arrived; edits up
+    /// to that revision share the result, since parses coalesce
+    pub fn syntax_completed(&mut self, document_id: DocumentId, revision: u64) {
+        let now = Instant::now();
+        let done: Vec<(DocumentId, u64)> = self
+            .awaiting_syntax
+            .keys()
+            .filter(|(doc, rev)| *doc == document_id && *rev <= revision)
+            .copied()
+            .collect();
+        for key in done {
+            if let Some(input) = self.awaiting_syntax.remove(&key) {
+                self.record(input, LatencyPhase::Syntax, now - input.start);
+            }
+        }
+    }
+
+    /// A frame was presented; everything handled before it is on screen
+    pub fn presented(&mut self) {
+        let now = Instant::now();
+        for input in std::mem::take(&mut self.awaiting_present) {
+            self.record(input, LatencyPhase::Present, now - input.start);
+        }
+    }
+
+    fn record(&mut self, input: PendingInput, phase: LatencyPhase, elapsed: Duration) {
+        #[cfg(feature = "profile-tracing")]
+        tracing::info!(
+            target: "token::latency",
+            kind = input.kind.label(),
+            phase = phase.label(),
+            latency_us = elapsed.as_micros() as u64,
+            "input_latency"
+        );
+        self.histograms[input.kind as usize][phase as usize].record(elapsed);
+    }
+
+    pub fn histogram(&self, kind: InputKind, phase: LatencyPhase) -> &LatencyHistogram {
+        &self.histograms[kind as usize][phase as usize]
+    }
+
+    /// Input kinds with at least one present sample
+    pub fn active_kinds(&self) -> Vec<InputKind> {
+        InputKind::ALL
+            .into_iter()
+            .filter(|kind| self.histogram(*kind, LatencyPhase::Present).count() > 0)
+            .collect()
+    }
+
+    /// All histograms as JSON, keyed by input kind and then phase; empty
+    /// histograms are left out
+    pub fn to_json(&self) -> serde_json::Value {
+        let mut kinds = serde_json::Map::new();
+        for kind in InputKind::ALL {
+            let mut phases = serde_json::Map::new();
+            for phase in LatencyPhase::ALL {
+                let histogram = self.histogram(kind, phase);
+                if histogram.count() > 0 {
+                    phases.insert(phase.label().to_string(), histogram.to_json());
+                }
+            }
+            if !phases.is_empty() {
+                kinds.insert(kind.label().to_string(), phases.into());
+            }
+        }
+        serde_json::json!({ "input_latency": kinds })
+    }
+
+    /// Write [`to_json`](Self::to_json) to `path`
+    pub fn write_report(&self, path: &std::path::Path) -> std::io::Result<()> {
+        let json = serde_json::to_string_pretty(&self.to_json())?;
+        std::fs::write(path, json)
+    }
+}
+
+/// Where the latency report should be written, from `TOKEN_LATENCY_REPORT`
+pub fn report_path_from_env() -> Option<std::path::PathBuf> {
+    std::env::var_os(LATENCY_REPORT_ENV)
+        .filter(|value| !value.is_empty())
+        .map(std::path::PathBuf::from)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_buckets_bound_relative_error() {
+        for us in (0..20_000u64).chain([1 << 20, u32::MAX as u64, 1 << 35]) {
+            let bucket = LatencyHistogram::bucket(us);
+            let max = LatencyHistogram::bucket_max(bucket);
+            assert!(max >= us, "{us} above its bucket max {max}");
+            assert!(
+                max - us <= us / SUB_BUCKETS as u64,
+                "{us} in bucket up to {max}"
+            );
+            if bucket > 0 {
+                assert!(LatencyHistogram::bucket_max(bucket - 1) < us);
+            }
+        }
+    }
+
+    #[test]
+    fn test_percentiles() {
+        let mut histogram = LatencyHistogram::default();
+        assert_eq!(histogram.percentile(0.5), Duration::ZERO);
+        for ms in 1..=100 {
+            histogram.record(Duration::from_millis(ms));
+        }
+        assert_eq!(histogram.count(), 100);
+        assert_eq!(histogram.max(), Duration::from_millis(100));
+
+        let p50 = histogram.percentile(0.50).as_micros() as f64;
+        let p99 = histogram.percentile(0.99).as_micros() as f64;
+        assert!((50_000.0..=50_000.0 * 1.0625).contains(&p50), "p50 {p50}");
+        assert!((99_000.0..=100_000.0).contains(&p99), "p99 {p99}");
+        assert_eq!(histogram.percentile(1.0), Duration::from_millis(100));
+    }
+
+    #[test]
+    fn test_inputs_are_followed_to_present() {
+        let mut tracker = LatencyTracker::new();
+        let start = Instant::now() - Duration::from_millis(5);
+        tracker.begin_input_at(InputKind::Key, start);
+        tracker.end_input(true);
+        tracker.begin_input(InputKind::MouseWheel);
+        tracker.end_input(false);
+        assert_eq!(tracker.active_kinds(), Vec::<InputKind>::new());
+
+        tracker.presented();
+        let present = tracker.histogram(InputKind::Key, LatencyPhase::Present);
+        assert_eq!(present.count(), 1);
+        assert!(present.max() >= Duration::from_millis(5));
+        assert_eq!(
+            tracker
+                .histogram(InputKind::MouseWheel, LatencyPhase::Update)
+                .count(),
+            1
+        );
+        assert_eq!(tracker.active_kinds(), vec![InputKind::Key]);
+
+        // Already presented inputs aren't counted again
+        tracker.presented();
+        assert_eq!(
+            tracker
+                .histogram(InputKind::Key, LatencyPhase::Present)
+                .count(),
+            1
+        );
+    }
+
+    #[test]
+    fn test_coalesced_syntax_parse_completes_earlier_revisions() {
+        let mut tracker = LatencyTracker::new();
+        let doc = DocumentId(1);
+        for revision in 1..=3 {
+            tracker.begin_input(InputKind::Key);
+            tracker.await_syntax(doc, revision);
+            tracker.end_input(true);
+        }
+        tracker.await_syntax(doc, 9); // no input being handled: ignored
+
+        tracker.syntax_completed(DocumentId(2), 3);
+        tracker.syntax_completed(doc, 2);
+        let syntax = tracker.histogram(InputKind::Key, LatencyPhase::Syntax);
+        assert_eq!(syntax.count(), 2);
+        tracker.syntax_completed(doc, 3);
+        assert_eq!(
+            tracker
+                .histogram(InputKind::Key, LatencyPhase::Syntax)
+                .count(),
+            3
+        );
+        assert!(tracker.awaiting_syntax.is_empty());
+    }
+
+    #[test]
+    fn test_json_report_lists_recorded_phases() {
+        let mut tracker = LatencyTracker::new();
+        tracker.begin_input(InputKind::Key);
+        tracker.end_input(true);
+        tracker.presented();
+
+        let json = tracker.to_json();
+        let key = &json["input_latency"]["key"];
+        assert_eq!(key["update"]["count"], 1);
+        assert_eq!(key["present"]["count"], 1);
+        assert!(key.get("syntax").is_none());
+        assert!(json["input_latency"].get("resize").is_none());
+    }
+}
@@ -11,10 +11,13 @@ pub mod csv;
 #[cfg(debug_assertions)]
 pub mod debug_overlay;
 pub mod editable;
+pub mod frame_pacing;
 pub mod fs_watcher;
 pub mod image;
 pub mod keymap;
+pub mod latency;
 pub mod markdown;
+pub mod memory;
 pub mod messages;
 pub mod model;
 pub mod outline;
@@ -23,6 +26,7 @@ pub mod panel;
 pub mod panels;
 pub mod perf;
 pub mod recent_files;
+pub mod replay;
 pub mod syntax;
 pub mod terminal;
 pub mod theme;
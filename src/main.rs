@@ -30,6 +30,7 @@ fn main() -> Result<()> {
 
     let event_loop = EventLoop::new()?;
     let mut app = App::new(800, 600, startup_config);
+    app.set_event_loop_proxy(event_loop.create_proxy());
     event_loop.run_app(&mut app)?;
 
     Ok(())
@@ -106,7 +107,9 @@ mod tests {
             dock_layout: token::panel::DockLayout::default(),
             terminal: token::terminal::TerminalState::default(),
             outline_panel: token::model::OutlinePanelState::default(),
+            find_in_files: token::model::FindInFilesState::default(),
             recent_files: token::recent_files::RecentFiles::default(),
+            memory: token::memory::MemoryStats::default(),
             #[cfg(debug_assertions)]
             debug_overlay: None,
         }
@@ -707,7 +710,9 @@ mod tests {
             dock_layout: token::panel::DockLayout::default(),
             terminal: token::terminal::TerminalState::default(),
             outline_panel: token::model::OutlinePanelState::default(),
+            find_in_files: token::model::FindInFilesState::default(),
             recent_files: token::recent_files::RecentFiles::default(),
+            memory: token::memory::MemoryStats::default(),
             #[cfg(debug_assertions)]
             debug_overlay: None,
         };
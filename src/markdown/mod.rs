@@ -2,10 +2,15 @@
 //!
 //! Provides live Markdown preview with webview rendering and scroll synchronization.
 
+mod patch;
 mod preview;
 mod renderer;
 mod theme;
 
+pub use patch::{diff_blocks, style_script, BlockPatch};
 pub use preview::{MarkdownStyle, PreviewPane, RenderedLine, StyledSegment};
-pub use renderer::{content_to_preview_html, markdown_to_html};
+pub use renderer::{
+    content_to_preview_html, markdown_page, markdown_to_blocks, markdown_to_html, preview_css,
+    MarkdownBlock,
+};
 pub use theme::PreviewTheme;
@@ -0,0 +1,139 @@
+//! Block-level diffs between two renders of a Markdown preview
+//!
+//! An edit usually touches one block: the blocks before it render exactly as
+//! before, and the blocks after it render the same HTML, moved by the number
+//! of lines the edit added or removed. [`diff_blocks`] finds the changed run
+//! in between, and [`BlockPatch::to_script`] turns it into a call to the
+//! page's `applyBlockPatch`, which swaps those blocks in place so the page
+//! keeps its scroll position instead of reloading.
+
+use super::MarkdownBlock;
+
+/// Replace `removed` blocks at `start` with `inserted`
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct BlockPatch {
+    /// Index of the first block replaced
+    pub start: usize,
+    /// Number of old blocks removed at `start`
+    pub removed: usize,
+    /// New blocks inserted in their place
+    pub inserted: Vec<MarkdownBlock>,
+    /// Source lines the blocks after the inserted ones moved by
+    pub line_delta: isize,
+}
+
+impl BlockPatch {
+    /// Script applying this patch to a page showing version `from`,
+    /// leaving it at version `to`
+    pub fn to_script(&self, from: u64, to: u64) -> String {
+        let blocks: Vec<String> = self.inserted.iter().map(MarkdownBlock::element).collect();
+        format!(
+            "window.applyBlockPatch({}, {}, {}, {}, {}, {});",
+            from,
+            to,
+            self.start,
+            self.removed,
+            serde_json::to_string(&blocks).unwrap_or_else(|_| "[]".to_string()),
+            self.line_delta
+        )
+    }
+}
+
+/// The patch turning `old` into `new`, or `None` if they are the same
+pub fn diff_blocks(old: &[MarkdownBlock], new: &[MarkdownBlock]) -> Option<BlockPatch> {
+    let prefix = old.iter().zip(new).take_while(|(a, b)| a == b).count();
+    if prefix == old.len() && prefix == new.len() {
+        return None;
+    }
+
+    // Blocks after the edit all moved by the same number of lines
+    let line_delta = match (old.last(), new.last()) {
+        (Some(a), Some(b)) => b.line as isize - a.line as isize,
+        _ => 0,
+    };
+    let suffix = old[prefix..]
+        .iter()
+        .rev()
+        .zip(new[prefix..].iter().rev())
+        .take_while(|(a, b)| a.html == b.html && b.line as isize - a.line as isize == line_delta)
+        .count();
+
+    Some(BlockPatch {
+        start: prefix,
+        removed: old.len() - prefix - suffix,
+        inserted: new[prefix..new.len() - suffix].to_vec(),
+        line_delta: if suffix > 0 { line_delta } else { 0 },
+    })
+}
+
+/// Script replacing the page's stylesheet
+pub fn style_script(css: &str) -> String {
+    format!(
+        "window.setPreviewStyle({});",
+        serde_json::to_string(css).unwrap_or_else(|_| "\"\"".to_string())
+    )
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::markdown::markdown_to_blocks;
+
+    const DOC: &str = "# Title\n\nFirst paragraph.\n\nSecond paragraph.\n\n- item\n";
+
+    #[test]
+    fn test_identical_renders_need_no_patch() {
+        let blocks = markdown_to_blocks(DOC);
+        assert_eq!(diff_blocks(&blocks, &blocks), None);
+    }
+
+    #[test]
+    fn test_editing_a_block_replaces_only_it() {
+        let old = markdown_to_blocks(DOC);
+        let new = markdown_to_blocks(&DOC.replace("First", "Edited"));
+
+        let patch = diff_blocks(&old, &new).unwrap();
+        assert_eq!((patch.start, patch.removed), (1, 1));
+        assert_eq!(patch.inserted, vec![new[1].clone()]);
+        assert_eq!(patch.line_delta, 0);
+    }
+
+    #[test]
+    fn test_inserted_lines_shift_following_blocks() {
+        let old = markdown_to_blocks(DOC);
+        let new =
+            markdown_to_blocks(&DOC.replace("First paragraph.", "First\nparagraph,\nlonger."));
+
+        let patch = diff_blocks(&old, &new).unwrap();
+        assert_eq!(
+            (patch.start, patch.removed, patch.inserted.len()),
+            (1, 1, 1)
+        );
+        assert_eq!(patch.line_delta, 2);
+    }
+
+    #[test]
+    fn test_added_and_removed_blocks() {
+        let old = markdown_to_blocks(DOC);
+        let new = markdown_to_blocks(&format!("{DOC}\nAppended.\n"));
+        let patch = diff_blocks(&old, &new).unwrap();
+        assert_eq!((patch.start, patch.removed), (old.len(), 0));
+        assert_eq!(patch.inserted.len(), 1);
+
+        let new = markdown_to_blocks(&DOC.replace("Second paragraph.\n\n", ""));
+        let patch = diff_blocks(&old, &new).unwrap();
+        assert_eq!((patch.start, patch.removed), (2, 1));
+        assert!(patch.inserted.is_empty());
+        assert_eq!(patch.line_delta, -2);
+    }
+
+    #[test]
+    fn test_patch_script_quotes_block_html() {
+        let new = markdown_to_blocks("Say \"hi\"\n");
+        let patch = diff_blocks(&[], &new).unwrap();
+        let script = patch.to_script(4, 5);
+        assert!(script.starts_with("window.applyBlockPatch(4, 5, 0, 0, [\""));
+        assert!(script.contains(r#"data-line=\"1\""#));
+        assert!(script.ends_with("], 0);"));
+    }
+}
@@ -72,4 +72,23 @@ impl PreviewPane {
     pub fn needs_refresh(&self, document_revision: u64) -> bool {
         self.last_revision != document_revision
     }
+
+    /// Approximate heap bytes held by the rendered HTML and lines
+    pub fn memory_bytes(&self) -> usize {
+        let lines: usize = self
+            .rendered_lines
+            .iter()
+            .map(|line| {
+                std::mem::size_of::<RenderedLine>()
+                    + line
+                        .segments
+                        .iter()
+                        .map(|segment| {
+                            segment.text.capacity() + std::mem::size_of::<StyledSegment>()
+                        })
+                        .sum::<usize>()
+            })
+            .sum();
+        self.rendered_html.capacity() + lines
+    }
 }
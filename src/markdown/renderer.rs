@@ -1,25 +1,85 @@
 //! Markdown to HTML renderer using pulldown-cmark
+//!
+//! Documents are rendered as a list of top-level blocks so the webview
+//! preview can be patched block by block (see [`super::patch`]) instead of
+//! reloading the page on every edit. Each block is wrapped in a
+//! `<div class="md-block" data-line="N">` carrying its first source line;
+//! line markers inside it are relative to that line, so a block that only
+//! moved renders to the same HTML.
 
-use pulldown_cmark::{html, Event, Options, Parser, Tag, TagEnd};
+use std::ops::Range;
+
+use pulldown_cmark::{html, Event, Options, Parser, Tag};
 
 use super::PreviewTheme;
 use crate::syntax::LanguageId;
 
+/// One top-level block (heading, paragraph, list, table, ...) of a
+/// rendered Markdown document
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct MarkdownBlock {
+    /// 1-based source line the block starts on
+    pub line: usize,
+    /// The block's HTML, with line markers relative to `line`
+    pub html: String,
+}
+
+impl MarkdownBlock {
+    /// The block as it appears in the page's `#content`
+    pub fn element(&self) -> String {
+        format!(
+            r#"<div class="md-block" data-line="{}">{}</div>"#,
+            self.line, self.html
+        )
+    }
+}
+
 /// Convert markdown to a complete HTML document with styling
 pub fn markdown_to_html(markdown: &str, theme: &PreviewTheme) -> String {
+    markdown_page(&markdown_to_blocks(markdown), &preview_css(theme), 0)
+}
+
+/// Render markdown as its top-level blocks
+pub fn markdown_to_blocks(markdown: &str) -> Vec<MarkdownBlock> {
     let options = Options::ENABLE_TABLES
         | Options::ENABLE_FOOTNOTES
         | Options::ENABLE_STRIKETHROUGH
         | Options::ENABLE_TASKLISTS;
 
-    let parser = Parser::new_ext(markdown, options);
+    // The HTML writer numbers footnotes across everything it is given, so
+    // documents that may use them are rendered as a single block
+    let split_blocks = !markdown.contains("[^");
 
-    // Add line markers for scroll sync
-    let parser_with_markers = add_line_markers(parser, markdown);
+    let mut lines = LineCounter::new(markdown);
+    let mut blocks = Vec::new();
+    let mut pending: Vec<(Event<'_>, Range<usize>)> = Vec::new();
+    let mut depth = 0usize;
 
-    let mut html_output = String::new();
-    html::push_html(&mut html_output, parser_with_markers);
+    for (event, range) in Parser::new_ext(markdown, options).into_offset_iter() {
+        match event {
+            Event::Start(_) => depth += 1,
+            Event::End(_) => depth = depth.saturating_sub(1),
+            _ => {}
+        }
+        pending.push((event, range));
+        if depth == 0 && split_blocks {
+            blocks.push(render_block(pending.drain(..), &mut lines));
+        }
+    }
+    if !pending.is_empty() {
+        blocks.push(render_block(pending.drain(..), &mut lines));
+    }
+    blocks
+}
 
+/// A complete preview page showing `blocks`
+///
+/// The stylesheet sits in its own `<style id="preview-style">` so a theme
+/// change replaces it in place. `version` identifies this set of blocks to
+/// the block-patch script, which reloads the page when a patch was made
+/// against a different version.
+pub fn markdown_page(blocks: &[MarkdownBlock], css: &str, version: u64) -> String {
+    let content: String = blocks.iter().map(MarkdownBlock::element).collect();
     format!(
         r#"<!DOCTYPE html>
 <html>
@@ -27,17 +87,16 @@ pub fn markdown_to_html(markdown: &str, theme: &PreviewTheme) -> String {
     <meta charset="utf-8">
     <meta name="viewport" content="width=device-width, initial-scale=1">
     <link rel="stylesheet" href="https://cdnjs.cloudflare.com/ajax/libs/highlight.js/11.9.0/styles/github-dark.min.css">
-    <style>{}</style>
+    <style id="preview-style">{}</style>
 </head>
 <body>
     <div id="content">{}</div>
     <script src="https://cdnjs.cloudflare.com/ajax/libs/highlight.js/11.9.0/highlight.min.js"></script>
+    <script>window.previewVersion = {};</script>
     <script>{}</script>
 </body>
 </html>"#,
-        generate_css(theme),
-        html_output,
-        SCROLL_SYNC_JS
+        css, content, version, SCROLL_SYNC_JS
     )
 }
 
@@ -86,8 +145,8 @@ fn html_to_preview(html_content: &str) -> String {
     }
 }
 
-/// Generate CSS from theme colors
-fn generate_css(theme: &PreviewTheme) -> String {
+/// Stylesheet for the Markdown preview in `theme`'s colors
+pub fn preview_css(theme: &PreviewTheme) -> String {
     format!(
         r#"
 * {{
@@ -284,19 +343,64 @@ del {{
     )
 }
 
-/// JavaScript for scroll synchronization and syntax highlighting
+/// JavaScript for scroll synchronization, syntax highlighting and block
+/// patches
 const SCROLL_SYNC_JS: &str = r#"
 // Initialize syntax highlighting
 if (typeof hljs !== 'undefined') {
     hljs.highlightAll();
 }
 
+// Source line of a line marker: its block's first line plus its offset
+function markerLine(el) {
+    const block = el.closest('.md-block');
+    return parseInt(block.dataset.line, 10) + parseInt(el.dataset.offset, 10);
+}
+
 // Scroll to a specific source line
 window.scrollToLine = function(line) {
-    const el = document.querySelector(`[data-line="${line}"]`);
-    if (el) {
-        el.scrollIntoView({ behavior: 'smooth', block: 'start' });
+    let target = null;
+    for (const el of document.querySelectorAll('[data-offset]')) {
+        if (markerLine(el) > line) break;
+        target = el;
+    }
+    if (target) {
+        target.scrollIntoView({ behavior: 'smooth', block: 'start' });
+    }
+};
+
+// Replace `removed` blocks at `start` with `blocks` (HTML strings) and
+// shift the blocks after them by `lineDelta` source lines
+window.applyBlockPatch = function(from, to, start, removed, blocks, lineDelta) {
+    const content = document.getElementById('content');
+    const children = content.children;
+    if (window.previewVersion !== from || start + removed > children.length) {
+        location.reload();
+        return;
+    }
+    for (let i = 0; i < removed; i++) {
+        children[start].remove();
+    }
+    const template = document.createElement('template');
+    template.innerHTML = blocks.join('');
+    const inserted = Array.from(template.content.children);
+    content.insertBefore(template.content, children[start] || null);
+    if (lineDelta !== 0) {
+        for (let i = start + inserted.length; i < children.length; i++) {
+            children[i].dataset.line = parseInt(children[i].dataset.line, 10) + lineDelta;
+        }
     }
+    if (typeof hljs !== 'undefined') {
+        for (const block of inserted) {
+            block.querySelectorAll('pre code').forEach((el) => hljs.highlightElement(el));
+        }
+    }
+    window.previewVersion = to;
+};
+
+// Replace the preview stylesheet (theme change)
+window.setPreviewStyle = function(css) {
+    document.getElementById('preview-style').textContent = css;
 };
 
 // Report scroll position back to editor
@@ -304,18 +408,17 @@ let scrollTimeout = null;
 window.addEventListener('scroll', function() {
     if (scrollTimeout) clearTimeout(scrollTimeout);
     scrollTimeout = setTimeout(function() {
-        const elements = document.querySelectorAll('[data-line]');
+        const elements = document.querySelectorAll('[data-offset]');
         let visibleLine = null;
-        const viewportTop = window.scrollY;
-        
+
         for (const el of elements) {
             const rect = el.getBoundingClientRect();
             if (rect.top >= 0) {
-                visibleLine = parseInt(el.getAttribute('data-line'), 10);
+                visibleLine = markerLine(el);
                 break;
             }
         }
-        
+
         if (visibleLine !== null && window.webkit && window.webkit.messageHandlers) {
             window.webkit.messageHandlers.scrollSync.postMessage({ line: visibleLine });
         }
@@ -323,50 +426,66 @@ window.addEventListener('scroll', function() {
 });
 "#;
 
-/// Add data-line attributes to block-level elements for scroll sync
-fn add_line_markers<'a>(parser: Parser<'a>, markdown: &'a str) -> impl Iterator<Item = Event<'a>> {
-    let mut current_line = 1;
-    let mut last_offset = 0;
-
-    parser.into_offset_iter().flat_map(move |(event, range)| {
-        // Update line number based on offset (guard against non-monotonic offsets)
-        if range.start >= last_offset {
-            let new_lines = markdown[last_offset..range.start]
-                .chars()
-                .filter(|c| *c == '\n')
-                .count();
-            current_line += new_lines;
-            last_offset = range.start;
+/// 1-based line numbers of byte offsets, counted incrementally. Offsets
+/// that move backwards (as nested events can) keep the last line.
+struct LineCounter<'a> {
+    text: &'a str,
+    offset: usize,
+    line: usize,
+}
+
+impl<'a> LineCounter<'a> {
+    fn new(text: &'a str) -> Self {
+        Self {
+            text,
+            offset: 0,
+            line: 1,
+        }
+    }
+
+    fn line_at(&mut self, offset: usize) -> usize {
+        if offset > self.offset {
+            self.line +=
+                memchr::memchr_iter(b'\n', &self.text.as_bytes()[self.offset..offset]).count();
+            self.offset = offset;
         }
+        self.line
+    }
+}
 
-        match &event {
-            Event::Start(tag) => {
-                let line = current_line;
-                match tag {
-                    Tag::Heading { .. }
+/// Render one top-level block, adding `data-offset` line markers before
+/// block-level elements for scroll sync
+fn render_block<'a>(
+    events: impl Iterator<Item = (Event<'a>, Range<usize>)>,
+    lines: &mut LineCounter<'_>,
+) -> MarkdownBlock {
+    let mut first_line = None;
+    let events = events.flat_map(|(event, range)| {
+        let line = lines.line_at(range.start);
+        let block_line = *first_line.get_or_insert(line);
+        let marker = matches!(
+            &event,
+            Event::Start(
+                Tag::Heading { .. }
                     | Tag::Paragraph
                     | Tag::BlockQuote(_)
                     | Tag::CodeBlock(_)
                     | Tag::List(_)
-                    | Tag::Item => {
-                        // Insert a span with data-line before the element
-                        vec![
-                            Event::Html(format!(r#"<span data-line="{}"></span>"#, line).into()),
-                            event,
-                        ]
-                    }
-                    _ => vec![event],
-                }
-            }
-            Event::End(TagEnd::Heading(_))
-            | Event::End(TagEnd::Paragraph)
-            | Event::End(TagEnd::BlockQuote(_))
-            | Event::End(TagEnd::CodeBlock)
-            | Event::End(TagEnd::List(_))
-            | Event::End(TagEnd::Item) => vec![event],
-            _ => vec![event],
-        }
-    })
+                    | Tag::Item
+            )
+        )
+        .then(|| {
+            Event::Html(format!(r#"<span data-offset="{}"></span>"#, line - block_line).into())
+        });
+        marker.into_iter().chain(std::iter::once(event))
+    });
+
+    let mut html_output = String::new();
+    html::push_html(&mut html_output, events);
+    MarkdownBlock {
+        line: first_line.unwrap_or(1),
+        html: html_output,
+    }
 }
 
 #[cfg(test)]
@@ -418,6 +537,49 @@ mod tests {
         assert!(html.contains("<td>"));
     }
 
+    #[test]
+    fn test_markdown_to_blocks_splits_top_level_blocks() {
+        let md = "# Title\n\nSome text\nwrapped\n\n- a\n- b\n\n---\n";
+        let blocks = markdown_to_blocks(md);
+
+        let lines: Vec<usize> = blocks.iter().map(|b| b.line).collect();
+        assert_eq!(lines, vec![1, 3, 6, 9]);
+        assert!(blocks[0].html.contains("<h1>"));
+        assert!(blocks[2].html.contains("<ul>"));
+        assert!(blocks[3].html.contains("<hr />"));
+        // Markers are relative to the block: the list's second item is one
+        // line below its start
+        assert!(blocks[2].html.contains(r#"<span data-offset="1"></span>"#));
+    }
+
+    #[test]
+    fn test_markdown_blocks_render_the_same_when_moved() {
+        let before = markdown_to_blocks("Intro\n\n## Section\n\n1. one\n2. two\n");
+        let after = markdown_to_blocks("Intro\nmore intro\n\n\n## Section\n\n1. one\n2. two\n");
+
+        assert_ne!(before[0], after[0]);
+        assert_eq!(before[1].html, after[1].html);
+        assert_eq!(before[2].html, after[2].html);
+        assert_eq!(after[2].line, before[2].line + 2);
+    }
+
+    #[test]
+    fn test_markdown_with_footnotes_is_one_block() {
+        let md = "Text[^1]\n\n[^1]: Note\n";
+        let blocks = markdown_to_blocks(md);
+        assert_eq!(blocks.len(), 1);
+        assert!(blocks[0].html.contains("footnote"));
+    }
+
+    #[test]
+    fn test_markdown_page_embeds_style_and_version() {
+        let blocks = markdown_to_blocks("# Hi");
+        let page = markdown_page(&blocks, "body{}", 3);
+        assert!(page.contains(r#"<style id="preview-style">body{}</style>"#));
+        assert!(page.contains("window.previewVersion = 3;"));
+        assert!(page.contains(r#"<div class="md-block" data-line="1"><span data-offset="0">"#));
+    }
+
     #[test]
     fn test_preview_theme_default() {
         let theme = PreviewTheme::default();
@@ -0,0 +1,248 @@
+//! Per-subsystem memory accounting
+//!
+//! The `dhat-heap` feature profiles the whole process; this answers, in a
+//! running session, which owner holds the memory. Each owner reports its
+//! approximate heap bytes through a `memory_bytes` method and
+//! [`MemoryUsage::measure`] sums them per [`MemorySubsystem`]. Owners living
+//! off the model report in: syntax workers send their parser caches as
+//! `SyntaxMsg::ParserCacheReport`, and the renderer records its glyph atlas
+//! after each frame. Both land in [`MemoryStats`].
+//!
+//! Figures are what each owner holds, not allocator totals: rope chunks
+//! shared with worker snapshots are counted once, with the buffer, and
+//! tree-sitter trees are estimated from their node counts.
+//!
+//! Subsystems can be given soft caps (`memory_caps_mb` in the config).
+//! Going over one never fails anything; [`evict_parser_caches`] drops the
+//! parse trees of documents in background tabs, which are rebuilt when they
+//! are next parsed, and the debug overlay flags any other subsystem over
+//! its cap.
+
+use std::collections::HashMap;
+
+use serde::{Deserialize, Serialize};
+
+use crate::model::editor_area::DocumentId;
+use crate::model::{AppModel, FindReplaceState, ModalState, ViewMode};
+
+/// An owner of memory that is accounted separately
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash, Serialize, Deserialize)]
+#[serde(rename_all = "snake_case")]
+pub enum MemorySubsystem {
+    /// Document ropes and their per-line caches
+    Buffers,
+    /// Document undo/redo stacks and modal input histories
+    UndoHistory,
+    /// Highlight tokens held by documents
+    SyntaxHighlights,
+    /// Parse trees and injections cached by the syntax workers
+    ParserCache,
+    /// The renderer's glyph coverage atlas
+    GlyphCache,
+    /// Row indexes and edits of CSV views
+    Csv,
+    /// Decoded pixels of image views
+    Images,
+    /// Terminal grids and scrollback
+    Terminal,
+    /// Rendered markdown previews
+    Preview,
+}
+
+impl MemorySubsystem {
+    pub const COUNT: usize = 9;
+
+    pub const ALL: [Self; Self::COUNT] = [
+        Self::Buffers,
+        Self::UndoHistory,
+        Self::SyntaxHighlights,
+        Self::ParserCache,
+        Self::GlyphCache,
+        Self::Csv,
+        Self::Images,
+        Self::Terminal,
+        Self::Preview,
+    ];
+
+    /// Name used in the config, the state dump and the debug overlay
+    pub fn name(self) -> &'static str {
+        match self {
+            Self::Buffers => "buffers",
+            Self::UndoHistory => "undo_history",
+            Self::SyntaxHighlights => "syntax_highlights",
+            Self::ParserCache => "parser_cache",
+            Self::GlyphCache => "glyph_cache",
+            Self::Csv => "csv",
+            Self::Images => "images",
+            Self::Terminal => "terminal",
+            Self::Preview => "preview",
+        }
+    }
+}
+
+/// Bytes held per subsystem
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct MemoryUsage {
+    bytes: [usize; MemorySubsystem::COUNT],
+}
+
+impl MemoryUsage {
+    /// Measure every subsystem; the parser cache and glyph atlas come from
+    /// the latest reports in `model.memory`
+    pub fn measure(model: &AppModel) -> Self {
+        let mut usage = Self::default();
+        let area = &model.editor_area;
+
+        for doc in area.documents.values() {
+            usage.add(MemorySubsystem::Buffers, doc.buffer_memory_bytes());
+            usage.add(MemorySubsystem::UndoHistory, doc.undo_memory_bytes());
+            if let Some(highlights) = &doc.syntax_highlights {
+                usage.add(MemorySubsystem::SyntaxHighlights, highlights.memory_bytes());
+            }
+        }
+        usage.add(MemorySubsystem::UndoHistory, modal_undo_memory_bytes(model));
+
+        for editor in area.editors.values() {
+            match &editor.view_mode {
+                ViewMode::Text => {}
+                ViewMode::Csv(csv) => usage.add(MemorySubsystem::Csv, csv.memory_bytes()),
+                ViewMode::Image(image) => usage.add(MemorySubsystem::Images, image.memory_bytes()),
+            }
+        }
+
+        usage.add(
+            MemorySubsystem::ParserCache,
+            model.memory.parser_cache_bytes(),
+        );
+        usage.add(MemorySubsystem::GlyphCache, model.memory.glyph_cache_bytes);
+        usage.add(MemorySubsystem::Terminal, model.terminal.memory_bytes());
+        for preview in area.previews.values() {
+            usage.add(MemorySubsystem::Preview, preview.memory_bytes());
+        }
+        usage
+    }
+
+    pub fn get(&self, subsystem: MemorySubsystem) -> usize {
+        self.bytes[subsystem as usize]
+    }
+
+    pub fn add(&mut self, subsystem: MemorySubsystem, bytes: usize) {
+        self.bytes[subsystem as usize] += bytes;
+    }
+
+    /// Bytes of all subsystems
+    pub fn total(&self) -> usize {
+        self.bytes.iter().sum()
+    }
+
+    /// Bytes per subsystem, in [`MemorySubsystem::ALL`] order
+    pub fn iter(&self) -> impl Iterator<Item = (MemorySubsystem, usize)> + '_ {
+        MemorySubsystem::ALL
+            .into_iter()
+            .map(|subsystem| (subsystem, self.get(subsystem)))
+    }
+}
+
+/// Memory reported by owners outside the model
+#[derive(Debug, Clone, Default)]
+pub struct MemoryStats {
+    /// Cached parse-state bytes per document, by syntax worker, as of each
+    /// worker's latest report
+    parser_caches: HashMap<usize, Vec<(DocumentId, usize)>>,
+    /// Bytes of the renderer's glyph atlas, as of the last frame
+    pub glyph_cache_bytes: usize,
+}
+
+impl MemoryStats {
+    /// Replace a syntax worker's parser cache report
+    pub fn record_parser_cache(&mut self, worker: usize, documents: Vec<(DocumentId, usize)>) {
+        self.parser_caches.insert(worker, documents);
+    }
+
+    /// Bytes cached by all syntax workers
+    pub fn parser_cache_bytes(&self) -> usize {
+        self.parser_caches
+            .values()
+            .flatten()
+            .map(|&(_, bytes)| bytes)
+            .sum()
+    }
+
+    /// Cached parse-state bytes of each document, in no particular order
+    pub fn parser_cache_documents(&self) -> impl Iterator<Item = (DocumentId, usize)> + '_ {
+        self.parser_caches.values().flatten().copied()
+    }
+
+    /// Drop `documents` from the reports until their workers report again
+    fn forget_parser_caches(&mut self, documents: &[DocumentId]) {
+        for report in self.parser_caches.values_mut() {
+            report.retain(|(document_id, _)| !documents.contains(document_id));
+        }
+    }
+}
+
+/// Soft cap of `subsystem` in bytes, if the config sets one
+pub fn cap_bytes(model: &AppModel, subsystem: MemorySubsystem) -> Option<usize> {
+    model
+        .config
+        .memory_caps_mb
+        .get(&subsystem)
+        .map(|&mb| (mb as usize).saturating_mul(1024 * 1024))
+}
+
+/// Documents whose cached parse trees to drop to bring the parser cache
+/// under its cap, largest first
+///
+/// Only documents no active tab shows are evicted: a visible document would
+/// be reparsed from scratch on its next keystroke. They are removed from
+/// the reports right away so the next report doesn't evict them again.
+pub fn evict_parser_caches(model: &mut AppModel) -> Vec<DocumentId> {
+    let Some(cap) = cap_bytes(model, MemorySubsystem::ParserCache) else {
+        return Vec::new();
+    };
+    let mut total = model.memory.parser_cache_bytes();
+    if total <= cap {
+        return Vec::new();
+    }
+
+    let mut candidates: Vec<(DocumentId, usize)> = model
+        .memory
+        .parser_cache_documents()
+        .filter(|&(document_id, _)| !model.editor_area.is_document_visible(document_id))
+        .collect();
+    candidates.sort_by_key(|&(document_id, bytes)| (std::cmp::Reverse(bytes), document_id.0));
+
+    let mut evicted = Vec::new();
+    for (document_id, bytes) in candidates {
+        if total <= cap {
+            break;
+        }
+        total -= bytes;
+        evicted.push(document_id);
+    }
+    model.memory.forget_parser_caches(&evicted);
+    evicted
+}
+
+/// Undo history bytes of the open modal's and remembered modals' inputs
+pub fn modal_undo_memory_bytes(model: &AppModel) -> usize {
+    let find_replace = |state: &FindReplaceState| {
+        state.query_editable.history_memory_bytes() + state.replace_editable.history_memory_bytes()
+    };
+    let active = match &model.ui.active_modal {
+        Some(ModalState::CommandPalette(state)) => state.editable.history_memory_bytes(),
+        Some(ModalState::GotoLine(state)) => state.editable.history_memory_bytes(),
+        Some(ModalState::FindReplace(state)) => find_replace(state),
+        Some(ModalState::FileFinder(state)) => state.editable.history_memory_bytes(),
+        Some(ModalState::RecentFiles(state)) => state.editable.history_memory_bytes(),
+        Some(ModalState::FindInFiles(state)) => state.editable.history_memory_bytes(),
+        Some(ModalState::ThemePicker(_)) | None => 0,
+    };
+    let remembered = model
+        .ui
+        .last_command_palette
+        .as_ref()
+        .map_or(0, |state| state.editable.history_memory_bytes())
+        + model.ui.last_find_replace.as_ref().map_or(0, find_replace);
+    active + remembered
+}
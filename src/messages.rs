@@ -4,10 +4,12 @@
 
 use std::path::PathBuf;
 
+use serde::{Deserialize, Serialize};
+
 use crate::editable::{EditContext, TextEditMsg};
 
 /// Direction for cursor movement
-#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
 pub enum Direction {
     Up,
     Down,
@@ -16,7 +18,7 @@ pub enum Direction {
 }
 
 /// Editor-specific messages (cursor movement, viewport scrolling)
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum EditorMsg {
     // === Basic Movement ===
     /// Move cursor in a direction
@@ -112,7 +114,7 @@ pub enum EditorMsg {
 }
 
 /// Document-specific messages (text editing, undo/redo)
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum DocumentMsg {
     /// Insert a character at cursor
     InsertChar(char),
@@ -155,7 +157,7 @@ pub enum DocumentMsg {
 use crate::model::{GroupId, ModalId, SegmentContent, SegmentId, SplitDirection, TabId};
 
 /// Modal-specific messages (command palette, goto line, find/replace)
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum ModalMsg {
     /// Open command palette
     OpenCommandPalette,
@@ -306,7 +308,7 @@ pub enum UiMsg {
 }
 
 /// Layout messages (split views, tabs, groups)
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum LayoutMsg {
     /// Create a new untitled document in the focused group
     NewTab,
@@ -407,6 +409,25 @@ pub enum AppMsg {
         path: PathBuf,
         result: Result<String, String>,
     },
+    /// A large file streaming in the background has grown (async result)
+    ///
+    /// `buffer` is the whole text loaded so far, not just the new chunk.
+    LargeFileChunk {
+        document_id: crate::model::editor_area::DocumentId,
+        buffer: ropey::Rope,
+        bytes_read: u64,
+        finished: bool,
+    },
+    /// Streaming a large file failed partway through
+    LargeFileFailed {
+        document_id: crate::model::editor_area::DocumentId,
+        error: String,
+    },
+    /// An image opened in the viewer finished decoding (async result)
+    ImageDecoded {
+        document_id: crate::model::editor_area::DocumentId,
+        result: Result<crate::image::MipChain, String>,
+    },
     /// Quit the application
     Quit,
     /// Reload configuration from disk
@@ -450,6 +471,7 @@ pub enum SyntaxMsg {
         document_id: crate::model::editor_area::DocumentId,
         revision: u64,
         highlights: crate::syntax::SyntaxHighlights,
+        /// New outline; `None` when unchanged since the last one sent
         outline: Option<crate::outline::OutlineData>,
     },
     /// Language changed for a document (triggers re-parse)
@@ -457,6 +479,17 @@ pub enum SyntaxMsg {
         document_id: crate::model::editor_area::DocumentId,
         language: crate::syntax::LanguageId,
     },
+    /// A syntax worker initialized a language's grammar (first use or pre-warm)
+    LanguageInitialized {
+        language: crate::syntax::LanguageId,
+        elapsed: std::time::Duration,
+    },
+    /// A syntax worker's cached parse-state bytes per document, sent when
+    /// they change
+    ParserCacheReport {
+        worker: usize,
+        documents: Vec<(crate::model::editor_area::DocumentId, usize)>,
+    },
 }
 
 /// Markdown preview messages
@@ -610,6 +643,31 @@ pub enum OutlineMsg {
     Scroll { lines: i32 },
 }
 
+/// Find-in-files messages (results panel and background search)
+#[derive(Debug, Clone)]
+pub enum FindInFilesMsg {
+    /// Files with matches from a background search
+    Results {
+        search_id: u64,
+        files: Vec<crate::model::find_in_files::FileMatches>,
+    },
+    /// A background search finished (or was cancelled)
+    Finished {
+        search_id: u64,
+        summary: crate::model::find_in_files::SearchSummary,
+    },
+    /// Click on a row in the results panel
+    ClickRow { index: usize, click_count: u8 },
+    /// Navigate up in the results
+    SelectPrevious,
+    /// Navigate down in the results
+    SelectNext,
+    /// Open the selected match
+    OpenSelected,
+    /// Scroll the results panel
+    Scroll { lines: i32 },
+}
+
 /// Terminal panel messages.
 ///
 /// Toggle/focus/panel switching is handled by the existing `DockMsg` --
@@ -769,10 +827,19 @@ pub enum WorkspaceMsg {
     /// File system change detected by watcher (triggers tree refresh)
     /// Contains the paths that changed for incremental updates.
     FileSystemChange { paths: Vec<PathBuf> },
+
+    /// Directory listings from a background workspace scan
+    ScanBatch {
+        generation: u64,
+        dirs: Vec<crate::model::workspace_scan::ScannedDir>,
+    },
+
+    /// A background workspace scan finished
+    ScanFinished { generation: u64 },
 }
 
 /// Image viewer messages
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum ImageMsg {
     /// Zoom by delta at mouse position (scroll wheel or keyboard)
     Zoom {
@@ -821,6 +888,8 @@ pub enum Msg {
     Dock(DockMsg),
     /// Outline panel messages
     Outline(OutlineMsg),
+    /// Find-in-files messages
+    FindInFiles(FindInFilesMsg),
     /// Unified text editing messages (Phase 2 - editable system)
     TextEdit(EditContext, TextEditMsg),
     /// Terminal panel messages
@@ -1,11 +1,18 @@
 //! Document model - represents the text buffer and file state
 
-use ropey::Rope;
+use ropey::{Rope, RopeSlice};
+use std::ops::Range;
 use std::path::PathBuf;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
 
 use super::editor::Cursor;
 use super::editor_area::DocumentId;
-use crate::syntax::{LanguageId, SyntaxHighlights};
+use crate::syntax::{EditJournal, LanguageId, SyntaxHighlights, TextEdit};
+use crate::util::text::{char_col_to_visual_col, visual_col_to_char_col};
+use crate::util::{
+    LineColumnCache, LineColumns, MatchCache, MatchIndex, SearchQuery, LONG_LINE_BYTES,
+};
 
 /// Represents an edit operation for undo/redo functionality
 #[derive(Debug, Clone)]
@@ -41,6 +48,106 @@ pub enum EditOperation {
     },
 }
 
+impl EditOperation {
+    /// Buffer changes made by applying this operation, in application order
+    pub fn text_edits(&self) -> Vec<TextEdit> {
+        let mut edits = Vec::new();
+        self.collect_text_edits(false, &mut edits);
+        edits
+    }
+
+    /// Buffer changes made by undoing this operation, in application order
+    pub fn undo_text_edits(&self) -> Vec<TextEdit> {
+        let mut edits = Vec::new();
+        self.collect_text_edits(true, &mut edits);
+        edits
+    }
+
+    /// Heap and inline bytes held by this operation
+    pub fn memory_bytes(&self) -> usize {
+        let heap = match self {
+            EditOperation::Insert { text, .. } | EditOperation::Delete { text, .. } => {
+                text.capacity()
+            }
+            EditOperation::Replace {
+                deleted_text,
+                inserted_text,
+                ..
+            } => deleted_text.capacity() + inserted_text.capacity(),
+            EditOperation::Batch {
+                operations,
+                cursors_before,
+                cursors_after,
+            } => {
+                operations
+                    .iter()
+                    .map(EditOperation::memory_bytes)
+                    .sum::<usize>()
+                    + (cursors_before.capacity() + cursors_after.capacity())
+                        * std::mem::size_of::<Cursor>()
+            }
+        };
+        std::mem::size_of::<Self>() + heap
+    }
+
+    fn collect_text_edits(&self, undo: bool, out: &mut Vec<TextEdit>) {
+        match self {
+            EditOperation::Insert { position, text, .. } => out.push(if undo {
+                TextEdit::delete(*position, text.chars().count())
+            } else {
+                TextEdit::insert(*position, text)
+            }),
+            EditOperation::Delete { position, text, .. } => out.push(if undo {
+                TextEdit::insert(*position, text)
+            } else {
+                TextEdit::delete(*position, text.chars().count())
+            }),
+            EditOperation::Replace {
+                position,
+                deleted_text,
+                inserted_text,
+                ..
+            } => out.push(if undo {
+                TextEdit::replace(*position, inserted_text.chars().count(), deleted_text)
+            } else {
+                TextEdit::replace(*position, deleted_text.chars().count(), inserted_text)
+            }),
+            EditOperation::Batch { operations, .. } => {
+                if undo {
+                    for op in operations.iter().rev() {
+                        op.collect_text_edits(true, out);
+                    }
+                } else {
+                    for op in operations {
+                        op.collect_text_edits(false, out);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/// Progress of a large file that is still streaming into its buffer
+#[derive(Debug, Clone)]
+pub struct LoadProgress {
+    /// Bytes loaded into the buffer so far
+    pub bytes_read: u64,
+    /// File size when loading started
+    pub total_bytes: u64,
+    /// Shared with the reader thread; set to stop it reading
+    pub cancel: Arc<AtomicBool>,
+}
+
+impl LoadProgress {
+    /// Loaded fraction as a whole percentage (0-100)
+    pub fn percent(&self) -> u64 {
+        if self.total_bytes == 0 {
+            return 100;
+        }
+        (self.bytes_read.saturating_mul(100) / self.total_bytes).min(100)
+    }
+}
+
 /// Document state - the text buffer and associated file metadata
 #[derive(Debug, Clone)]
 pub struct Document {
@@ -75,6 +182,18 @@ pub struct Document {
     /// Document revision counter (incremented on each edit)
     /// Used for staleness checking in async parsing
     pub revision: u64,
+    /// Buffer edits since the last snapshot sent to the syntax worker
+    pub edit_journal: EditJournal,
+    /// Find matches for recent queries, patched on every journaled edit
+    pub match_cache: MatchCache,
+    /// Column tables of long visible lines, for the current revision
+    pub line_columns: LineColumnCache,
+
+    // === Large Files ===
+    /// Opened in large-file mode (no syntax highlighting)
+    pub large_file: bool,
+    /// Set while the file is still streaming in; the buffer is read-only
+    pub loading: Option<LoadProgress>,
 }
 
 impl Document {
@@ -93,6 +212,11 @@ impl Document {
             syntax_highlights: None,
             outline: None,
             revision: 0,
+            edit_journal: EditJournal::default(),
+            match_cache: MatchCache::default(),
+            line_columns: LineColumnCache::default(),
+            large_file: false,
+            loading: None,
         }
     }
 
@@ -106,16 +230,54 @@ impl Document {
 
     /// Load a document from a file path
     pub fn from_file(path: PathBuf) -> Result<Self, std::io::Error> {
-        let content = std::fs::read_to_string(&path)?;
+        // Build the rope straight from the file instead of going through a
+        // String, which would hold the whole file in memory twice
+        let file = std::fs::File::open(&path)?;
+        let buffer = Rope::from_reader(std::io::BufReader::new(file))?;
         let language = LanguageId::from_path(&path);
         Ok(Self {
-            buffer: Rope::from(content),
+            buffer,
             file_path: Some(path),
             language,
             ..Self::new()
         })
     }
 
+    /// Create an empty large-file document whose contents will be streamed in
+    /// by `Cmd::StreamLargeFile`
+    pub fn loading_from_file(path: PathBuf, total_bytes: u64) -> Self {
+        let language = LanguageId::from_path(&path);
+        Self {
+            file_path: Some(path),
+            language,
+            large_file: true,
+            loading: Some(LoadProgress {
+                bytes_read: 0,
+                total_bytes,
+                cancel: Arc::new(AtomicBool::new(false)),
+            }),
+            ..Self::new()
+        }
+    }
+
+    /// Whether this document should be sent to the syntax worker
+    pub fn syntax_enabled(&self) -> bool {
+        self.language.has_highlighting() && !self.large_file
+    }
+
+    /// Whether the buffer is still streaming in from disk
+    pub fn is_loading(&self) -> bool {
+        self.loading.is_some()
+    }
+
+    /// Stop streaming the file in, if it still is (the document is closing
+    /// or being replaced)
+    pub fn stop_loading(&mut self) {
+        if let Some(progress) = self.loading.take() {
+            progress.cancel.store(true, Ordering::Relaxed);
+        }
+    }
+
     /// Create a new empty document with a target file path
     ///
     /// Used when the user specifies a non-existent file path on the command line.
@@ -186,34 +348,31 @@ impl Document {
     /// Also trims the trailing newline for display purposes.
     #[inline]
     pub fn get_line_cow(&self, line_idx: usize) -> Option<std::borrow::Cow<'_, str>> {
-        use std::borrow::Cow;
-
-        if line_idx >= self.buffer.len_lines() {
-            return None;
-        }
-
-        let line = self.buffer.line(line_idx);
-        let len = line.len_chars();
+        self.get_line_range_cow(line_idx, 0..usize::MAX)
+    }
 
-        // Calculate trim length (remove trailing newline)
-        let trim_len = if len > 0 && line.char(len - 1) == '\n' {
-            if len > 1 && line.char(len - 2) == '\r' {
-                2 // CRLF
-            } else {
-                1 // LF
-            }
-        } else {
-            0
-        };
+    /// Get the chars `chars` of a line (clamped to the line, without its
+    /// line ending) as Cow<str>, avoiding allocation when possible
+    ///
+    /// Rendering a long line only needs the part that's scrolled into view;
+    /// this copies at most that part when the line spans several chunks.
+    pub fn get_line_range_cow(
+        &self,
+        line_idx: usize,
+        chars: Range<usize>,
+    ) -> Option<std::borrow::Cow<'_, str>> {
+        use std::borrow::Cow;
 
-        let trimmed = line.slice(..len - trim_len);
+        let trimmed = self.trimmed_line(line_idx)?;
+        let end = chars.end.min(trimmed.len_chars());
+        let window = trimmed.slice(chars.start.min(end)..end);
 
         // Try to get as a contiguous slice (zero allocation)
-        if let Some(s) = trimmed.as_str() {
+        if let Some(s) = window.as_str() {
             Some(Cow::Borrowed(s))
         } else {
             // Falls back to allocation only when line spans multiple chunks
-            Some(Cow::Owned(trimmed.to_string()))
+            Some(Cow::Owned(window.to_string()))
         }
     }
 
@@ -224,21 +383,69 @@ impl Document {
     /// CRLF file would overcount by 1 (the `\r`), diverging from what's
     /// actually rendered and from `view::helpers::trim_line_ending`.
     pub fn line_length(&self, line_idx: usize) -> usize {
+        self.trimmed_line(line_idx)
+            .map_or(0, |line| line.len_chars())
+    }
+
+    /// A line without its trailing `\n` or `\r\n`
+    fn trimmed_line(&self, line_idx: usize) -> Option<RopeSlice<'_>> {
         if line_idx < self.buffer.len_lines() {
-            let line = self.buffer.line(line_idx);
-            let len = line.len_chars();
-            let trim_len = if len > 0 && line.char(len - 1) == '\n' {
-                if len > 1 && line.char(len - 2) == '\r' {
-                    2
-                } else {
-                    1
-                }
-            } else {
-                0
-            };
-            len - trim_len
+            Some(trim_line_ending(self.buffer.line(line_idx)))
         } else {
-            0
+            None
+        }
+    }
+
+    /// Build column tables for the long lines among `lines`, so rendering,
+    /// hit testing and cursor placement on them don't scan from the start
+    /// of the line. Tables of older revisions are dropped.
+    pub fn ensure_line_columns(&mut self, lines: Range<usize>) {
+        self.line_columns.sync(self.revision);
+        let end = lines.end.min(self.buffer.len_lines());
+        for line_idx in lines.start..end {
+            if self.line_columns.get(line_idx, self.revision).is_some() {
+                continue;
+            }
+            let line = trim_line_ending(self.buffer.line(line_idx));
+            if line.len_bytes() >= LONG_LINE_BYTES {
+                self.line_columns.insert(
+                    line_idx,
+                    self.revision,
+                    LineColumns::from_chunks(line.chunks()),
+                );
+            }
+        }
+    }
+
+    /// Column table of a line, if it's long and its table is current
+    pub fn line_columns(&self, line_idx: usize) -> Option<&Arc<LineColumns>> {
+        self.line_columns.get(line_idx, self.revision)
+    }
+
+    /// Visual (tab-expanded) column of char column `char_col` on a line
+    pub fn visual_col(&self, line_idx: usize, char_col: usize) -> usize {
+        let Some(line) = self.trimmed_line(line_idx) else {
+            return 0;
+        };
+        match self.line_columns(line_idx) {
+            Some(columns) => columns.visual_at_char(|cp| line.chars_at(cp.char), char_col),
+            None => {
+                char_col_to_visual_col(&self.get_line_cow(line_idx).unwrap_or_default(), char_col)
+            }
+        }
+    }
+
+    /// Char column at visual column `visual_col` on a line, clamped to the
+    /// line length
+    pub fn char_col_at_visual(&self, line_idx: usize, visual_col: usize) -> usize {
+        let Some(line) = self.trimmed_line(line_idx) else {
+            return 0;
+        };
+        match self.line_columns(line_idx) {
+            Some(columns) => columns.char_at_visual(|cp| line.chars_at(cp.char), visual_col),
+            None => {
+                visual_col_to_char_col(&self.get_line_cow(line_idx).unwrap_or_default(), visual_col)
+            }
         }
     }
 
@@ -283,23 +490,83 @@ impl Document {
         trimmed.len()
     }
 
+    /// Bytes held by the text buffer and its column tables
+    ///
+    /// Rope chunks are shared with snapshots sent to the syntax workers, so
+    /// they are counted here only.
+    pub fn buffer_memory_bytes(&self) -> usize {
+        self.buffer.capacity() + self.line_columns.memory_bytes()
+    }
+
+    /// Bytes held by the undo and redo stacks
+    pub fn undo_memory_bytes(&self) -> usize {
+        self.undo_stack
+            .iter()
+            .chain(&self.redo_stack)
+            .map(EditOperation::memory_bytes)
+            .sum()
+    }
+
     /// Push an edit operation onto the undo stack and clear redo stack
     pub fn push_edit(&mut self, op: EditOperation) {
+        let edits = op.text_edits();
         self.undo_stack.push(op);
         self.redo_stack.clear();
         self.is_modified = true;
-        self.revision = self.revision.wrapping_add(1);
+        self.record_buffer_edits(edits);
         // Keep existing syntax highlights until new ones arrive.
         // This prevents "flash of unstyled text" during the debounce window.
         // The revision check in ParseCompleted ensures only matching highlights are applied.
     }
 
+    /// Bump the revision for buffer changes that were already applied to
+    /// `buffer`, journaling them for the syntax worker and patching cached
+    /// find matches.
+    ///
+    /// `push_edit` calls this itself; use it directly for changes that don't
+    /// go through the undo stack (undo/redo replays, bulk replacements).
+    pub fn record_buffer_edits(&mut self, edits: impl IntoIterator<Item = TextEdit>) {
+        let revision_before = self.revision;
+        self.revision = self.revision.wrapping_add(1);
+        let edits: Vec<TextEdit> = edits.into_iter().collect();
+        self.match_cache
+            .apply_edits(&self.buffer, revision_before, self.revision, &edits);
+        self.edit_journal
+            .record(revision_before, self.revision, edits);
+    }
+
+    /// Cached matches of `needle`, searching the buffer only if they aren't
+    /// current. Returns `None` for an empty needle.
+    pub fn match_index(&mut self, needle: &str, case_sensitive: bool) -> Option<&MatchIndex> {
+        self.match_cache
+            .get_or_build(needle, case_sensitive, &self.buffer, self.revision)
+    }
+
+    /// Match count for `needle` if its matches are cached and current
+    pub fn cached_match_count(&self, needle: &str, case_sensitive: bool) -> Option<usize> {
+        self.match_cache
+            .get(needle, case_sensitive, self.revision)
+            .map(MatchIndex::len)
+    }
+
     /// Get highlight tokens for a specific line
     pub fn get_line_highlights(&self, line: usize) -> &[crate::syntax::HighlightToken] {
         self.syntax_highlights
             .as_ref()
-            .and_then(|h| h.get_line(line))
-            .map(|lh| lh.tokens.as_slice())
+            .map(|h| h.get_line_tokens(line))
+            .unwrap_or(&[])
+    }
+
+    /// Get highlight tokens of a line that can color char columns from `col`
+    /// on (see `SyntaxHighlights::get_line_tokens_from`)
+    pub fn get_line_highlights_from(
+        &self,
+        line: usize,
+        col: usize,
+    ) -> &[crate::syntax::HighlightToken] {
+        self.syntax_highlights
+            .as_ref()
+            .map(|h| h.get_line_tokens_from(line, col))
             .unwrap_or(&[])
     }
 
@@ -316,56 +583,9 @@ impl Document {
         needle: &str,
         case_sensitive: bool,
     ) -> Vec<(usize, usize)> {
-        if needle.is_empty() {
-            return Vec::new();
-        }
-
-        let haystack = self.buffer.to_string();
-        let needle_char_len = needle.chars().count();
-
-        // For case-insensitive search, convert both to lowercase
-        let (search_haystack, search_needle) = if case_sensitive {
-            (haystack.clone(), needle.to_string())
-        } else {
-            (haystack.to_lowercase(), needle.to_lowercase())
-        };
-
-        let needle_byte_len = search_needle.len();
-
-        // Build byte offset → char index mapping (only for char boundaries)
-        // Use original haystack for char mapping since byte positions correspond
-        let byte_to_char: std::collections::HashMap<usize, usize> = haystack
-            .char_indices()
-            .enumerate()
-            .map(|(char_idx, (byte_idx, _))| (byte_idx, char_idx))
-            .collect();
-
-        let mut results = Vec::new();
-        let mut start_byte = 0;
-
-        while start_byte <= search_haystack.len().saturating_sub(needle_byte_len) {
-            if let Some(rel_byte) = search_haystack[start_byte..].find(&search_needle) {
-                let match_start_byte = start_byte + rel_byte;
-
-                // Convert byte offset to char offset
-                if let Some(&start_char) = byte_to_char.get(&match_start_byte) {
-                    let end_char = start_char + needle_char_len;
-                    results.push((start_char, end_char));
-                }
-
-                // Advance by the byte length of the first character of the match
-                // to allow overlapping matches while staying on char boundaries
-                let first_char_byte_len = search_haystack[match_start_byte..]
-                    .chars()
-                    .next()
-                    .map(|c| c.len_utf8())
-                    .unwrap_or(1);
-                start_byte = match_start_byte + first_char_byte_len;
-            } else {
-                break;
-            }
-        }
-        results
+        SearchQuery::new(needle, case_sensitive)
+            .map(|query| query.find_all(&self.buffer))
+            .unwrap_or_default()
     }
 
     /// Find next occurrence after given offset (wraps back to start)
@@ -384,19 +604,21 @@ impl Document {
         after_offset: usize,
         case_sensitive: bool,
     ) -> Option<(usize, usize)> {
-        if needle.is_empty() {
-            return None;
-        }
-
-        let occurrences = self.find_all_occurrences_with_options(needle, case_sensitive);
-
-        // Find first occurrence after current position
-        if let Some(&occ) = occurrences.iter().find(|(start, _)| *start > after_offset) {
-            return Some(occ);
-        }
-
-        // Wrap around to first occurrence
-        occurrences.first().copied()
+        let query = SearchQuery::new(needle, case_sensitive)?;
+
+        // Stop at the first occurrence after the current position, keeping
+        // the very first one to wrap around to
+        let mut first = None;
+        let mut next = None;
+        query.for_each_match(&self.buffer, |start, end| {
+            first.get_or_insert((start, end));
+            if start > after_offset {
+                next = Some((start, end));
+                return false;
+            }
+            true
+        });
+        next.or(first)
     }
 
     /// Find previous occurrence before given offset (wraps to end)
@@ -406,24 +628,36 @@ impl Document {
         before_offset: usize,
         case_sensitive: bool,
     ) -> Option<(usize, usize)> {
-        if needle.is_empty() {
-            return None;
-        }
-
-        let occurrences = self.find_all_occurrences_with_options(needle, case_sensitive);
+        let query = SearchQuery::new(needle, case_sensitive)?;
+
+        // The last occurrence before the current position; without one, wrap
+        // around to the last occurrence in the document
+        let mut prev = None;
+        let mut last = None;
+        query.for_each_match(&self.buffer, |start, end| {
+            if start < before_offset {
+                prev = Some((start, end));
+            }
+            last = Some((start, end));
+            true
+        });
+        prev.or(last)
+    }
+}
 
-        // Find last occurrence before current position
-        if let Some(&occ) = occurrences
-            .iter()
-            .rev()
-            .find(|(start, _)| *start < before_offset)
-        {
-            return Some(occ);
+/// `line` without its trailing `\n` or `\r\n`
+fn trim_line_ending(line: RopeSlice<'_>) -> RopeSlice<'_> {
+    let len = line.len_chars();
+    let trim_len = if len > 0 && line.char(len - 1) == '\n' {
+        if len > 1 && line.char(len - 2) == '\r' {
+            2 // CRLF
+        } else {
+            1 // LF
         }
-
-        // Wrap around to last occurrence
-        occurrences.last().copied()
-    }
+    } else {
+        0
+    };
+    line.slice(..len - trim_len)
 }
 
 impl Default for Document {
@@ -460,6 +694,32 @@ mod tests {
         assert_eq!(doc.language, LanguageId::PlainText);
     }
 
+    #[test]
+    fn test_loading_from_file_disables_syntax() {
+        let doc = Document::loading_from_file(PathBuf::from("big.rs"), 1000);
+        assert_eq!(doc.language, LanguageId::Rust);
+        assert!(doc.is_loading());
+        assert!(!doc.syntax_enabled());
+        assert!(!doc.is_modified);
+        assert_eq!(doc.buffer.len_chars(), 0);
+    }
+
+    #[test]
+    fn test_load_progress_percent() {
+        let progress = LoadProgress {
+            bytes_read: 250,
+            total_bytes: 1000,
+            cancel: Default::default(),
+        };
+        assert_eq!(progress.percent(), 25);
+        let empty = LoadProgress {
+            bytes_read: 0,
+            total_bytes: 0,
+            cancel: Default::default(),
+        };
+        assert_eq!(empty.percent(), 100);
+    }
+
     #[test]
     fn test_with_text_creates_buffer() {
         let doc = Document::with_text("hello\nworld");
@@ -671,6 +931,40 @@ mod tests {
         assert!(doc.get_line(99).is_none());
     }
 
+    #[test]
+    fn test_get_line_range_cow_clamps_to_line() {
+        let doc = Document::with_text("hello world\r\nnext");
+        assert_eq!(doc.get_line_range_cow(0, 6..99).as_deref(), Some("world"));
+        assert_eq!(doc.get_line_range_cow(0, 20..30).as_deref(), Some(""));
+        assert!(doc.get_line_range_cow(5, 0..1).is_none());
+    }
+
+    #[test]
+    fn test_long_line_columns_match_scanning_the_line() {
+        let line = "\tab".repeat(2000);
+        let mut doc = Document::with_text(&format!("{line}\r\nshort\tline\n"));
+        doc.ensure_line_columns(0..5);
+        assert!(doc.line_columns(0).is_some());
+        assert!(doc.line_columns(1).is_none());
+
+        for col in [0, 1, 3, 1024, 4099, 5999, 6000, 7000] {
+            assert_eq!(doc.visual_col(0, col), char_col_to_visual_col(&line, col));
+        }
+        for visual in [0, 2, 4, 5, 4097, 15999, 16000, 20000] {
+            assert_eq!(
+                doc.char_col_at_visual(0, visual),
+                visual_col_to_char_col(&line, visual)
+            );
+        }
+        assert_eq!(doc.visual_col(1, 6), 8);
+        assert_eq!(doc.char_col_at_visual(1, 99), 10);
+
+        // An edit invalidates the tables until they're rebuilt
+        doc.revision += 1;
+        assert!(doc.line_columns(0).is_none());
+        assert_eq!(doc.visual_col(0, 3), 6);
+    }
+
     // ========================================================================
     // Cursor/offset conversion tests
     // ========================================================================
@@ -751,10 +1045,91 @@ mod tests {
         assert!(doc.redo_stack.is_empty());
     }
 
+    #[test]
+    fn test_push_edit_journals_batch_in_application_order() {
+        let mut doc = Document::with_text("ab\ncd");
+        doc.buffer.insert(3, "X");
+        doc.buffer.insert(0, "Y");
+        doc.push_edit(EditOperation::Batch {
+            operations: vec![
+                EditOperation::Insert {
+                    position: 3,
+                    text: "X".to_string(),
+                    cursor_before: Cursor::default(),
+                    cursor_after: Cursor::default(),
+                },
+                EditOperation::Insert {
+                    position: 0,
+                    text: "Y".to_string(),
+                    cursor_before: Cursor::default(),
+                    cursor_after: Cursor::default(),
+                },
+            ],
+            cursors_before: vec![],
+            cursors_after: vec![],
+        });
+
+        let delta = doc.edit_journal.take(doc.revision).unwrap();
+        assert_eq!(
+            delta.edits,
+            vec![TextEdit::insert(3, "X"), TextEdit::insert(0, "Y")]
+        );
+    }
+
+    #[test]
+    fn test_undo_text_edits_invert_replace() {
+        let op = EditOperation::Replace {
+            position: 2,
+            deleted_text: "old".to_string(),
+            inserted_text: "newer".to_string(),
+            cursor_before: Cursor::default(),
+            cursor_after: Cursor::default(),
+        };
+        assert_eq!(op.text_edits(), vec![TextEdit::replace(2, 3, "newer")]);
+        assert_eq!(op.undo_text_edits(), vec![TextEdit::replace(2, 5, "old")]);
+    }
+
+    #[test]
+    fn test_unjournaled_revision_bump_invalidates_journal() {
+        let mut doc = Document::with_text("hello");
+        doc.push_edit(EditOperation::Insert {
+            position: 0,
+            text: "X".to_string(),
+            cursor_before: Cursor::default(),
+            cursor_after: Cursor::default(),
+        });
+        doc.revision += 1;
+        assert!(doc.edit_journal.take(doc.revision).is_none());
+    }
+
     // ========================================================================
     // Find tests
     // ========================================================================
 
+    #[test]
+    fn test_match_index_follows_edits() {
+        let mut doc = Document::with_text("foo bar foo");
+        assert_eq!(doc.cached_match_count("foo", true), None);
+        assert_eq!(doc.match_index("foo", true).map(|m| m.len()), Some(2));
+
+        doc.buffer.insert(4, "foo ");
+        doc.push_edit(EditOperation::Insert {
+            position: 4,
+            text: "foo ".to_string(),
+            cursor_before: Cursor::default(),
+            cursor_after: Cursor::default(),
+        });
+        assert_eq!(doc.cached_match_count("foo", true), Some(3));
+        assert_eq!(
+            doc.match_index("foo", true).unwrap().to_vec(),
+            doc.find_all_occurrences("foo")
+        );
+
+        // Revision bumps that bypass the journal leave the index stale
+        doc.revision += 1;
+        assert_eq!(doc.cached_match_count("foo", true), None);
+    }
+
     #[test]
     fn test_find_all_occurrences_basic() {
         let doc = Document::with_text("abc abc abc");
@@ -5,6 +5,8 @@
 
 use std::collections::HashMap;
 
+use serde::{Deserialize, Serialize};
+
 use super::document::Document;
 use super::editor::{EditorState, ScrollRevealMode};
 use crate::markdown::PreviewPane;
@@ -22,11 +24,11 @@ pub struct DocumentId(pub u64);
 pub struct EditorId(pub u64);
 
 /// Unique identifier for an editor group (pane)
-#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, Serialize, Deserialize)]
 pub struct GroupId(pub u64);
 
 /// Unique identifier for a tab
-#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, Serialize, Deserialize)]
 pub struct TabId(pub u64);
 
 // ============================================================================
@@ -109,7 +111,7 @@ impl EditorGroup {
 // ============================================================================
 
 /// Direction for splitting editor groups
-#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
 pub enum SplitDirection {
     /// Children arranged left-to-right
     Horizontal,
@@ -381,6 +383,15 @@ impl EditorArea {
             .collect()
     }
 
+    /// Check if a document is shown by the active tab of any group
+    pub fn is_document_visible(&self, doc_id: DocumentId) -> bool {
+        self.groups
+            .values()
+            .filter_map(EditorGroup::active_editor_id)
+            .filter_map(|editor_id| self.editors.get(&editor_id))
+            .any(|editor| editor.document_id == Some(doc_id))
+    }
+
     /// Find if a file is already open by its path
     /// Returns the document ID and group/tab info if found
     pub fn find_open_file(&self, path: &std::path::Path) -> Option<(DocumentId, GroupId, usize)> {
@@ -757,6 +768,42 @@ impl EditorArea {
         }
     }
 
+    /// Build column tables for the long lines each group's active editor
+    /// shows, so rendering and hit testing them stays cheap.
+    pub fn sync_visible_line_columns(&mut self) {
+        for group in self.groups.values() {
+            let Some(editor) = group
+                .active_editor_id()
+                .and_then(|id| self.editors.get(&id))
+            else {
+                continue;
+            };
+            let Some(document) = editor
+                .document_id
+                .and_then(|id| self.documents.get_mut(&id))
+            else {
+                continue;
+            };
+            // One extra line for the partially visible row at the bottom
+            let top = editor.viewport.top_line;
+            document.ensure_line_columns(top..top + editor.viewport.visible_lines + 1);
+        }
+    }
+
+    /// Build the mip level each visible image viewer samples from at its
+    /// current zoom, so zooming out renders from a downsampled copy.
+    pub fn sync_image_mips(&mut self) {
+        for group in self.groups.values() {
+            if let Some(state) = group
+                .active_editor_id()
+                .and_then(|id| self.editors.get_mut(&id))
+                .and_then(|editor| editor.view_mode.as_image_mut())
+            {
+                state.sync_mips();
+            }
+        }
+    }
+
     /// Compute layout for all groups given the available rectangle.
     /// Updates the `rect` field of each EditorGroup.
     /// Returns a list of splitter bar positions for rendering/hit testing.
@@ -0,0 +1,350 @@
+//! Fuzzy-searchable index of workspace files
+//!
+//! Kept up to date by the [`FileTree`](super::FileTree) as directories are
+//! scanned and watcher events are patched in, so the file finder doesn't
+//! have to walk the tree when it opens. Each file's name is stored with its
+//! lowercased bytes and a [`char_mask`] so most candidates are rejected
+//! without running the matcher.
+
+use std::collections::HashMap;
+use std::path::{Path, PathBuf};
+
+use nucleo_matcher::{Config, Matcher, Utf32Str};
+
+use super::FileMatch;
+use crate::util::char_mask;
+
+/// Results returned for a non-empty query
+const MAX_RESULTS: usize = 50;
+
+/// Files listed (alphabetically) for an empty query
+const MAX_UNFILTERED_RESULTS: usize = 100;
+
+/// Candidates per thread before scoring is split across threads
+const PARALLEL_CHUNK: usize = 16 * 1024;
+
+#[derive(Debug, Clone)]
+struct IndexedFile {
+    path: PathBuf,
+    /// File name, which is what queries are matched against
+    name: Box<str>,
+    /// `name` lowercased, when it is ASCII
+    ascii_lower: Option<Box<[u8]>>,
+    /// [`char_mask`] of `name`; all bits set for non-ASCII names, which
+    /// the matcher normalizes (`é` matches `e`)
+    mask: u64,
+}
+
+impl IndexedFile {
+    fn new(path: PathBuf) -> Self {
+        let name: Box<str> = path
+            .file_name()
+            .and_then(|n| n.to_str())
+            .unwrap_or("")
+            .into();
+        let (ascii_lower, mask) = if name.is_ascii() {
+            (
+                Some(name.to_ascii_lowercase().into_bytes().into_boxed_slice()),
+                char_mask(&name),
+            )
+        } else {
+            (None, u64::MAX)
+        };
+        Self {
+            path,
+            name,
+            ascii_lower,
+            mask,
+        }
+    }
+
+    /// Cheap necessary condition for `needle` matching this file
+    fn may_match(&self, needle: &str, needle_mask: u64) -> bool {
+        if self.mask & needle_mask != needle_mask {
+            return false;
+        }
+        match &self.ascii_lower {
+            // The matcher lowercases the name but not the needle
+            Some(lower) if needle.is_ascii() => {
+                let mut rest = lower.iter();
+                needle
+                    .bytes()
+                    .all(|b| rest.by_ref().any(|&candidate| candidate == b))
+            }
+            _ => true,
+        }
+    }
+}
+
+/// All files in a workspace, for the file finder and find-in-files
+#[derive(Debug, Clone, Default)]
+pub struct FileIndex {
+    files: Vec<IndexedFile>,
+    /// Position of each path in `files`
+    slots: HashMap<PathBuf, usize>,
+}
+
+impl FileIndex {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Number of indexed files
+    pub fn len(&self) -> usize {
+        self.files.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.files.is_empty()
+    }
+
+    pub fn contains(&self, path: &Path) -> bool {
+        self.slots.contains_key(path)
+    }
+
+    /// Every indexed path, in index order
+    pub fn paths(&self) -> impl Iterator<Item = &Path> {
+        self.files.iter().map(|file| file.path.as_path())
+    }
+
+    /// Add a file (no-op if it is already indexed)
+    pub fn insert(&mut self, path: PathBuf) {
+        if self.slots.contains_key(&path) {
+            return;
+        }
+        self.slots.insert(path.clone(), self.files.len());
+        self.files.push(IndexedFile::new(path));
+    }
+
+    /// Remove a file, returning whether it was indexed
+    pub fn remove(&mut self, path: &Path) -> bool {
+        let Some(slot) = self.slots.remove(path) else {
+            return false;
+        };
+        self.files.swap_remove(slot);
+        if let Some(moved) = self.files.get(slot) {
+            self.slots.insert(moved.path.clone(), slot);
+        }
+        true
+    }
+
+    /// Rank the files whose names fuzzy-match `query`
+    ///
+    /// `session` carries the matches of the previous query: when `query`
+    /// extends it, only those are scored again. A session must only be used
+    /// with one index, and is reset by searching with a query that doesn't
+    /// extend the last one.
+    pub fn search(
+        &self,
+        query: &str,
+        session: &mut FileQuery,
+        workspace_root: &Path,
+    ) -> Vec<FileMatch> {
+        if query.is_empty() {
+            *session = FileQuery::default();
+            return self.unfiltered(workspace_root);
+        }
+
+        let narrowing = session.candidates.is_some() && query.starts_with(&session.query);
+        let scored = match session.candidates.take().filter(|_| narrowing) {
+            Some(candidates) => self.score(&candidates, query),
+            None => {
+                let all: Vec<u32> = (0..self.files.len() as u32).collect();
+                self.score(&all, query)
+            }
+        };
+        session.query = query.to_string();
+        session.candidates = Some(scored.iter().map(|&(slot, _)| slot).collect());
+
+        self.top_matches(scored, query, workspace_root)
+    }
+
+    /// Score `candidates` (slots in index order) against `query`, splitting
+    /// large candidate sets across threads. Matches stay in index order.
+    fn score(&self, candidates: &[u32], query: &str) -> Vec<(u32, u16)> {
+        let threads = std::thread::available_parallelism()
+            .map_or(1, |n| n.get())
+            .min(candidates.len().div_ceil(PARALLEL_CHUNK))
+            .max(1);
+        if threads == 1 {
+            return self.score_chunk(candidates, query);
+        }
+
+        let chunk_len = candidates.len().div_ceil(threads);
+        std::thread::scope(|scope| {
+            let handles: Vec<_> = candidates
+                .chunks(chunk_len)
+                .map(|chunk| scope.spawn(move || self.score_chunk(chunk, query)))
+                .collect();
+            handles
+                .into_iter()
+                .flat_map(|handle| handle.join().unwrap())
+                .collect()
+        })
+    }
+
+    fn score_chunk(&self, candidates: &[u32], query: &str) -> Vec<(u32, u16)> {
+        let mut matcher = Matcher::new(Config::DEFAULT);
+        let mut needle_buf = Vec::new();
+        let needle = Utf32Str::new(query, &mut needle_buf);
+        let needle_mask = char_mask(&query.to_lowercase());
+
+        let mut name_buf = Vec::new();
+        candidates
+            .iter()
+            .filter_map(|&slot| {
+                let file = &self.files[slot as usize];
+                if !file.may_match(query, needle_mask) {
+                    return None;
+                }
+                let haystack = Utf32Str::new(&file.name, &mut name_buf);
+                matcher
+                    .fuzzy_match(haystack, needle)
+                    .map(|score| (slot, score))
+            })
+            .collect()
+    }
+
+    /// The best `MAX_RESULTS` of `scored`, with match indices for
+    /// highlighting (computed only for the files returned)
+    fn top_matches(
+        &self,
+        mut scored: Vec<(u32, u16)>,
+        query: &str,
+        workspace_root: &Path,
+    ) -> Vec<FileMatch> {
+        // Best score first; ties keep index order
+        let rank = |a: &(u32, u16), b: &(u32, u16)| b.1.cmp(&a.1).then(a.0.cmp(&b.0));
+        if scored.len() > MAX_RESULTS {
+            scored.select_nth_unstable_by(MAX_RESULTS - 1, rank);
+            scored.truncate(MAX_RESULTS);
+        }
+        scored.sort_unstable_by(rank);
+
+        let mut matcher = Matcher::new(Config::DEFAULT);
+        let mut needle_buf = Vec::new();
+        let needle = Utf32Str::new(query, &mut needle_buf);
+        let mut name_buf = Vec::new();
+        scored
+            .into_iter()
+            .map(|(slot, score)| {
+                let file = &self.files[slot as usize];
+                let haystack = Utf32Str::new(&file.name, &mut name_buf);
+                let mut indices = Vec::new();
+                matcher.fuzzy_indices(haystack, needle, &mut indices);
+                FileMatch::from_path(&file.path, workspace_root, score as u32, indices)
+            })
+            .collect()
+    }
+
+    /// The first files by path, for an empty query
+    fn unfiltered(&self, workspace_root: &Path) -> Vec<FileMatch> {
+        let mut paths: Vec<&Path> = self.files.iter().map(|file| file.path.as_path()).collect();
+        if paths.len() > MAX_UNFILTERED_RESULTS {
+            paths.select_nth_unstable(MAX_UNFILTERED_RESULTS - 1);
+            paths.truncate(MAX_UNFILTERED_RESULTS);
+        }
+        paths.sort_unstable();
+        paths
+            .into_iter()
+            .map(|path| FileMatch::from_path(path, workspace_root, 0, vec![]))
+            .collect()
+    }
+}
+
+/// Matches of the last query searched in a [`FileIndex`], so that typing
+/// further narrows them instead of rescanning every file
+#[derive(Debug, Clone, Default)]
+pub struct FileQuery {
+    query: String,
+    /// Slots of the files that matched `query`
+    candidates: Option<Vec<u32>>,
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn index(paths: &[&str]) -> FileIndex {
+        let mut index = FileIndex::new();
+        for path in paths {
+            index.insert(PathBuf::from(path));
+        }
+        index
+    }
+
+    fn names(results: &[FileMatch]) -> Vec<&str> {
+        results.iter().map(|m| m.filename.as_str()).collect()
+    }
+
+    #[test]
+    fn test_char_mask_subsets() {
+        let name = char_mask("main.rs");
+        assert_eq!(char_mask("MAIN") & !name, 0);
+        assert_eq!(char_mask("mrs.") & !name, 0);
+        assert_ne!(char_mask("x") & !name, 0);
+        assert_ne!(char_mask("é") & !name, 0);
+    }
+
+    #[test]
+    fn test_insert_remove_keeps_slots_consistent() {
+        let mut index = index(&["/p/a.rs", "/p/b.rs", "/p/c.rs"]);
+        index.insert(PathBuf::from("/p/a.rs"));
+        assert_eq!(index.len(), 3);
+
+        assert!(index.remove(Path::new("/p/a.rs")));
+        assert!(!index.remove(Path::new("/p/a.rs")));
+        assert!(index.contains(Path::new("/p/c.rs")));
+        assert!(index.remove(Path::new("/p/c.rs")));
+        assert_eq!(index.len(), 1);
+        assert!(index.contains(Path::new("/p/b.rs")));
+    }
+
+    #[test]
+    fn test_search_ranks_and_highlights() {
+        let index = index(&["/p/src/main.rs", "/p/src/model.rs", "/p/README.md"]);
+        let mut session = FileQuery::default();
+
+        let results = index.search("mai", &mut session, Path::new("/p"));
+        assert_eq!(names(&results), vec!["main.rs"]);
+        assert_eq!(results[0].relative_path, "src/main.rs");
+        assert_eq!(results[0].indices, vec![0, 1, 2]);
+
+        let results = index.search("rs", &mut session, Path::new("/p"));
+        assert_eq!(results.len(), 2);
+
+        // Empty query lists files by path
+        let results = index.search("", &mut session, Path::new("/p"));
+        assert_eq!(names(&results), vec!["README.md", "main.rs", "model.rs"]);
+    }
+
+    #[test]
+    fn test_search_narrows_previous_matches() {
+        let index = index(&["/p/main.rs", "/p/model.rs", "/p/lib.rs"]);
+        let mut session = FileQuery::default();
+
+        index.search("m", &mut session, Path::new("/p"));
+        assert_eq!(session.candidates.as_ref().unwrap().len(), 2);
+        let results = index.search("mo", &mut session, Path::new("/p"));
+        assert_eq!(names(&results), vec!["model.rs"]);
+        assert_eq!(session.candidates.as_ref().unwrap().len(), 1);
+
+        // Backspacing rescans everything
+        let results = index.search("l", &mut session, Path::new("/p"));
+        assert_eq!(names(&results), vec!["lib.rs", "model.rs"]);
+    }
+
+    #[test]
+    fn test_parallel_scoring_matches_sequential() {
+        let mut index = FileIndex::new();
+        for i in 0..3 * PARALLEL_CHUNK {
+            index.insert(PathBuf::from(format!("/p/dir{}/file{}.rs", i % 7, i)));
+        }
+        let all: Vec<u32> = (0..index.len() as u32).collect();
+
+        let parallel = index.score(&all, "f12");
+        let sequential = index.score_chunk(&all, "f12");
+        assert!(!parallel.is_empty());
+        assert_eq!(parallel, sequential);
+    }
+}
@@ -0,0 +1,593 @@
+//! Workspace-wide find-in-files
+//!
+//! A search walks the workspace's [`FileIndex`], which the file tree keeps
+//! filtered by the ignore rules, on a pool of threads that pull files off a
+//! shared counter. Each file is read whole and checked with the query's
+//! vectorized byte kernel before any line bookkeeping is done, so a file
+//! without a match costs one read and one `memchr` pass. Binary files (see
+//! [`is_binary_content`]) are skipped, and documents with unsaved edits are
+//! searched from their rope instead of from disk.
+//!
+//! Results stream back in batches of whole files, and every worker checks
+//! the search's cancel flag between files, so a search superseded by a new
+//! query stops within one file per thread.
+
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::mpsc::{self, RecvTimeoutError};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use ropey::Rope;
+
+use super::FileIndex;
+use crate::util::{is_binary_content, SearchQuery};
+
+/// Matches collected across all files before a search stops early
+const MAX_TOTAL_MATCHES: usize = 10_000;
+
+/// Matching lines kept per file
+const MAX_LINES_PER_FILE: usize = 1_000;
+
+/// Files larger than this are not searched
+const MAX_SEARCH_FILE_SIZE: u64 = 64 * 1024 * 1024;
+
+/// Chars of a matching line kept for its preview
+const PREVIEW_CHARS: usize = 200;
+
+/// Chars kept before the first match when a preview must be cut at the start
+const PREVIEW_CONTEXT: usize = 40;
+
+/// Files with matches collected before a batch is reported
+const BATCH_FILES: usize = 64;
+
+/// Longest a result waits before its batch is reported
+const BATCH_INTERVAL: Duration = Duration::from_millis(50);
+
+// ============================================================================
+// Results
+// ============================================================================
+
+/// One line containing at least one match
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct LineMatch {
+    /// Zero-indexed line number
+    pub line: usize,
+    /// Char column of the first match on the line
+    pub column: usize,
+    /// Text of the line, without leading indentation and cut to a window
+    /// around the first match
+    pub preview: String,
+    /// Char ranges of the matches within `preview`
+    pub highlights: Vec<(usize, usize)>,
+}
+
+/// Matches of one file, in line order
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct FileMatches {
+    pub path: PathBuf,
+    pub lines: Vec<LineMatch>,
+}
+
+impl FileMatches {
+    /// Number of individual matches
+    pub fn match_count(&self) -> usize {
+        self.lines.iter().map(|line| line.highlights.len()).sum()
+    }
+}
+
+/// A search to run off the main thread
+#[derive(Debug, Clone)]
+pub struct FileSearchRequest {
+    /// Identifies the search's results; see [`FindInFilesState::search_id`]
+    pub id: u64,
+    pub query: String,
+    pub case_sensitive: bool,
+    pub files: Arc<FileIndex>,
+    /// Open documents with unsaved edits, searched instead of their file
+    pub buffers: Vec<(PathBuf, Rope)>,
+    /// Set when the search is superseded
+    pub cancel: Arc<AtomicBool>,
+}
+
+/// How a search ended
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct SearchSummary {
+    /// Files read and scanned (binary and oversized files excluded)
+    pub files_searched: usize,
+    /// The search stopped at [`MAX_TOTAL_MATCHES`]
+    pub truncated: bool,
+}
+
+// ============================================================================
+// Search
+// ============================================================================
+
+/// Run `request`, reporting files with matches to `on_batch` as they are
+/// found. Stops when the request is cancelled, when `on_batch` returns
+/// `false`, or after [`MAX_TOTAL_MATCHES`] matches.
+pub fn search_files(
+    request: &FileSearchRequest,
+    mut on_batch: impl FnMut(Vec<FileMatches>) -> bool,
+) -> SearchSummary {
+    let Some(query) = SearchQuery::new(&request.query, request.case_sensitive) else {
+        return SearchSummary::default();
+    };
+
+    let disk_files: Vec<&Path> = request
+        .files
+        .paths()
+        .filter(|path| !request.buffers.iter().any(|(buffer, _)| buffer == path))
+        .collect();
+    let jobs = request.buffers.len() + disk_files.len();
+
+    let next = AtomicUsize::new(0);
+    let searched = AtomicUsize::new(0);
+    let matches = AtomicUsize::new(0);
+    let stop = AtomicBool::new(false);
+    let stopped = || stop.load(Ordering::Relaxed) || request.cancel.load(Ordering::Relaxed);
+
+    let threads = std::thread::available_parallelism()
+        .map_or(1, |n| n.get())
+        .min(jobs)
+        .max(1);
+    let (tx, rx) = mpsc::channel();
+    std::thread::scope(|scope| {
+        for _ in 0..threads {
+            let tx = tx.clone();
+            let (query, disk_files) = (&query, &disk_files);
+            let (next, searched, matches, stopped) = (&next, &searched, &matches, &stopped);
+            scope.spawn(move || {
+                while !stopped() {
+                    let job = next.fetch_add(1, Ordering::Relaxed);
+                    let (path, lines) = if let Some((path, rope)) = request.buffers.get(job) {
+                        (path.as_path(), search_rope(query, rope))
+                    } else if let Some(path) = disk_files.get(job - request.buffers.len()) {
+                        match search_file(query, path) {
+                            Some(lines) => (*path, lines),
+                            None => continue,
+                        }
+                    } else {
+                        break;
+                    };
+                    searched.fetch_add(1, Ordering::Relaxed);
+                    if lines.is_empty() {
+                        continue;
+                    }
+                    let file = FileMatches {
+                        path: path.to_path_buf(),
+                        lines,
+                    };
+                    matches.fetch_add(file.match_count(), Ordering::Relaxed);
+                    if tx.send(file).is_err() {
+                        break;
+                    }
+                }
+            });
+        }
+        drop(tx);
+
+        let mut batch = Vec::new();
+        let mut batch_started = Instant::now();
+        loop {
+            let wait = BATCH_INTERVAL.saturating_sub(batch_started.elapsed());
+            let flush = match rx.recv_timeout(wait) {
+                Ok(file) => {
+                    if batch.is_empty() {
+                        batch_started = Instant::now();
+                    }
+                    batch.push(file);
+                    batch.len() >= BATCH_FILES || batch_started.elapsed() >= BATCH_INTERVAL
+                }
+                Err(RecvTimeoutError::Timeout) => true,
+                Err(RecvTimeoutError::Disconnected) => break,
+            };
+            if matches.load(Ordering::Relaxed) >= MAX_TOTAL_MATCHES {
+                stop.store(true, Ordering::Relaxed);
+            }
+            if flush && !batch.is_empty() && !stopped() {
+                if !on_batch(std::mem::take(&mut batch)) {
+                    stop.store(true, Ordering::Relaxed);
+                }
+                batch_started = Instant::now();
+            }
+        }
+        // Files found while hitting the cap are still reported
+        if !batch.is_empty() && !request.cancel.load(Ordering::Relaxed) {
+            on_batch(batch);
+        }
+    });
+
+    SearchSummary {
+        files_searched: searched.load(Ordering::Relaxed),
+        truncated: matches.load(Ordering::Relaxed) >= MAX_TOTAL_MATCHES,
+    }
+}
+
+/// Search a file on disk. `None` if it can't be read, is too large or
+/// looks binary.
+fn search_file(query: &SearchQuery, path: &Path) -> Option<Vec<LineMatch>> {
+    let size = std::fs::metadata(path).ok()?.len();
+    if size > MAX_SEARCH_FILE_SIZE {
+        tracing::debug!("Not searching {} ({} bytes)", path.display(), size);
+        return None;
+    }
+    let bytes = match std::fs::read(path) {
+        Ok(bytes) => bytes,
+        Err(e) => {
+            tracing::debug!("Not searching {}: {}", path.display(), e);
+            return None;
+        }
+    };
+    if is_binary_content(&bytes) {
+        return None;
+    }
+    if !query.may_match_bytes(&bytes) {
+        return Some(Vec::new());
+    }
+    let text = String::from_utf8_lossy(&bytes);
+    Some(search_text(query, &text))
+}
+
+/// Matches in `text`, grouped by line
+pub fn search_text(query: &SearchQuery, text: &str) -> Vec<LineMatch> {
+    let bytes = text.as_bytes();
+    let mut lines = LineCollector::default();
+    // Line of the last match and its byte range, plus the char column of
+    // the last match's start byte, so that many matches on one long line
+    // don't rescan it from the start
+    let mut line = 0;
+    let mut line_start = 0;
+    let mut line_end = None;
+    let mut column_byte = 0;
+    let mut column = 0;
+    query.for_each_match_in_str(text, |start, end| {
+        let skipped = &bytes[column_byte..start];
+        if let Some(last_newline) = memchr::memrchr(b'\n', skipped) {
+            line += memchr::memchr_iter(b'\n', skipped).count();
+            line_start = column_byte + last_newline + 1;
+            line_end = None;
+            column_byte = line_start;
+            column = 0;
+        }
+        let line_end = *line_end.get_or_insert_with(|| {
+            memchr::memchr(b'\n', &bytes[start..]).map_or(bytes.len(), |i| start + i)
+        });
+        column += text[column_byte..start].chars().count();
+        column_byte = start;
+        let match_chars = text[start..end.min(line_end)].chars().count();
+        lines.push(line, column, column + match_chars, || {
+            text[line_start..line_end].chars()
+        })
+    });
+    lines.lines
+}
+
+/// Matches in an open document's `rope`, grouped by line
+pub fn search_rope(query: &SearchQuery, rope: &Rope) -> Vec<LineMatch> {
+    let mut lines = LineCollector::default();
+    query.for_each_match(rope, |start, end| {
+        let line = rope.char_to_line(start);
+        let line_start = rope.line_to_char(line);
+        let line_text = rope.line(line);
+        let line_len = line_text.len_chars();
+        lines.push(
+            line,
+            start - line_start,
+            (end - line_start).min(line_len),
+            || line_text.chars(),
+        )
+    });
+    lines.lines
+}
+
+/// Builds [`LineMatch`]es from matches reported in order
+#[derive(Default)]
+struct LineCollector {
+    lines: Vec<LineMatch>,
+    /// Chars of the current line dropped from the start of its preview
+    preview_start: usize,
+}
+
+impl LineCollector {
+    /// Add a match spanning chars `start..end` of `line`. `line_chars`
+    /// yields the line's text and is only called for the first match on a
+    /// line. Returns `false` once the file has [`MAX_LINES_PER_FILE`] lines.
+    fn push<I>(
+        &mut self,
+        line: usize,
+        start: usize,
+        end: usize,
+        line_chars: impl FnOnce() -> I,
+    ) -> bool
+    where
+        I: Iterator<Item = char> + Clone,
+    {
+        if let Some(last) = self.lines.last_mut().filter(|last| last.line == line) {
+            let preview_len = last.preview.chars().count();
+            let start = start.saturating_sub(self.preview_start);
+            if start < preview_len {
+                let end = end.saturating_sub(self.preview_start).min(preview_len);
+                last.highlights.push((start, end));
+            }
+            return true;
+        }
+        if self.lines.len() >= MAX_LINES_PER_FILE {
+            return false;
+        }
+
+        let chars = line_chars();
+        let indent = chars
+            .clone()
+            .take(start)
+            .take_while(|c| c.is_whitespace())
+            .count();
+        self.preview_start = indent.max(start.saturating_sub(PREVIEW_CONTEXT));
+        let preview: String = chars
+            .skip(self.preview_start)
+            .take_while(|&c| c != '\n' && c != '\r')
+            .take(PREVIEW_CHARS)
+            .collect();
+        let preview_len = preview.chars().count();
+        let highlight_start = start - self.preview_start;
+        let highlights = vec![(
+            highlight_start,
+            (end - self.preview_start).clamp(highlight_start, preview_len),
+        )];
+        self.lines.push(LineMatch {
+            line,
+            column: start,
+            preview,
+            highlights,
+        });
+        true
+    }
+}
+
+// ============================================================================
+// Panel State
+// ============================================================================
+
+/// A row of the search results panel
+#[derive(Debug, Clone, Copy)]
+pub enum SearchResultRow<'a> {
+    /// Header naming a file with matches
+    File(&'a FileMatches),
+    /// A matching line under its file's header
+    Line(&'a FileMatches, &'a LineMatch),
+}
+
+/// State of the find-in-files results panel
+#[derive(Debug, Default)]
+pub struct FindInFilesState {
+    /// Query of the current (or last) search
+    pub query: String,
+    pub case_sensitive: bool,
+    /// Id of the current search; batches from older searches are dropped
+    pub search_id: u64,
+    /// Cancel flag of the search in flight
+    cancel: Option<Arc<AtomicBool>>,
+    /// Files with matches, in the order they were reported
+    pub results: Vec<FileMatches>,
+    pub match_count: usize,
+    /// Results are still streaming in
+    pub searching: bool,
+    /// The search stopped at the match limit
+    pub truncated: bool,
+    /// Selected row (see [`FindInFilesState::rows_from`])
+    pub selected_index: Option<usize>,
+    pub scroll_offset: usize,
+}
+
+impl FindInFilesState {
+    /// Start searching for `query`, cancelling the search in flight and
+    /// clearing the results. Queries with an uppercase letter are case
+    /// sensitive. Returns `None` (after clearing) for an empty query.
+    pub fn start(
+        &mut self,
+        query: &str,
+        files: Arc<FileIndex>,
+        buffers: Vec<(PathBuf, Rope)>,
+    ) -> Option<FileSearchRequest> {
+        self.cancel();
+        self.search_id += 1;
+        self.query = query.to_string();
+        self.case_sensitive = query.chars().any(char::is_uppercase);
+        self.results.clear();
+        self.match_count = 0;
+        self.truncated = false;
+        self.selected_index = None;
+        self.scroll_offset = 0;
+        if query.is_empty() {
+            return None;
+        }
+
+        let cancel = Arc::new(AtomicBool::new(false));
+        self.cancel = Some(Arc::clone(&cancel));
+        self.searching = true;
+        Some(FileSearchRequest {
+            id: self.search_id,
+            query: self.query.clone(),
+            case_sensitive: self.case_sensitive,
+            files,
+            buffers,
+            cancel,
+        })
+    }
+
+    /// Stop the search in flight, keeping the results so far
+    pub fn cancel(&mut self) {
+        if let Some(cancel) = self.cancel.take() {
+            cancel.store(true, Ordering::Relaxed);
+        }
+        self.searching = false;
+    }
+
+    /// Append a batch of results. Returns `false` (and drops the batch) if
+    /// it belongs to an older search.
+    pub fn apply_batch(&mut self, search_id: u64, files: Vec<FileMatches>) -> bool {
+        if search_id != self.search_id {
+            return false;
+        }
+        self.match_count += files.iter().map(FileMatches::match_count).sum::<usize>();
+        self.results.extend(files);
+        true
+    }
+
+    /// Record the end of a search. Returns `false` if it belongs to an
+    /// older search.
+    pub fn finish(&mut self, search_id: u64, summary: SearchSummary) -> bool {
+        if search_id != self.search_id {
+            return false;
+        }
+        self.cancel = None;
+        self.searching = false;
+        self.truncated = summary.truncated;
+        true
+    }
+
+    /// Number of rows: a header per file plus its matching lines
+    pub fn row_count(&self) -> usize {
+        self.results.iter().map(|file| 1 + file.lines.len()).sum()
+    }
+
+    /// Rows from `start` on
+    pub fn rows_from(&self, start: usize) -> impl Iterator<Item = SearchResultRow<'_>> {
+        self.results
+            .iter()
+            .flat_map(|file| {
+                std::iter::once(SearchResultRow::File(file)).chain(
+                    file.lines
+                        .iter()
+                        .map(move |line| SearchResultRow::Line(file, line)),
+                )
+            })
+            .skip(start)
+    }
+
+    pub fn row(&self, index: usize) -> Option<SearchResultRow<'_>> {
+        self.rows_from(index).next()
+    }
+
+    /// Where a row leads: the file and the (line, column) of its first
+    /// match
+    pub fn target(&self, index: usize) -> Option<(&Path, usize, usize)> {
+        match self.row(index)? {
+            SearchResultRow::File(file) => {
+                let first = file.lines.first()?;
+                Some((&file.path, first.line, first.column))
+            }
+            SearchResultRow::Line(file, line) => Some((&file.path, line.line, line.column)),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn matches(text: &str, needle: &str) -> Vec<LineMatch> {
+        search_text(&SearchQuery::new(needle, false).unwrap(), text)
+    }
+
+    #[test]
+    fn test_matches_are_grouped_by_line() {
+        let text = "fn main() {\n    let main = 1;\n}\nmain main\n";
+        let lines = matches(text, "main");
+        assert_eq!(lines.len(), 3);
+
+        assert_eq!((lines[0].line, lines[0].column), (0, 3));
+        assert_eq!(lines[0].preview, "fn main() {");
+        assert_eq!(lines[0].highlights, vec![(3, 7)]);
+
+        // Indentation is dropped from the preview
+        assert_eq!((lines[1].line, lines[1].column), (1, 8));
+        assert_eq!(lines[1].preview, "let main = 1;");
+        assert_eq!(lines[1].highlights, vec![(4, 8)]);
+
+        assert_eq!(lines[2].line, 3);
+        assert_eq!(lines[2].highlights, vec![(0, 4), (5, 9)]);
+    }
+
+    #[test]
+    fn test_columns_and_highlights_are_chars() {
+        let lines = matches("αβγ = \"héllo\" // HÉLLO\r\n", "héllo");
+        assert_eq!(lines.len(), 1);
+        assert_eq!(lines[0].column, 7);
+        assert_eq!(lines[0].preview, "αβγ = \"héllo\" // HÉLLO");
+        assert_eq!(lines[0].highlights, vec![(7, 12), (17, 22)]);
+    }
+
+    #[test]
+    fn test_long_lines_are_cut_around_the_first_match() {
+        let text = format!("{}needle{}", "x".repeat(500), "y".repeat(500));
+        let lines = matches(&text, "needle");
+        let line = &lines[0];
+        assert_eq!(line.column, 500);
+        assert_eq!(line.preview.chars().count(), PREVIEW_CHARS);
+        assert_eq!(
+            line.highlights,
+            vec![(PREVIEW_CONTEXT, PREVIEW_CONTEXT + 6)]
+        );
+        assert!(line.preview[PREVIEW_CONTEXT..].starts_with("needle"));
+    }
+
+    #[test]
+    fn test_rope_search_matches_text_search() {
+        let text = "alpha\n  beta alpha\nALPHA gamma\n".repeat(50);
+        let query = SearchQuery::new("alpha", false).unwrap();
+        assert_eq!(
+            search_rope(&query, &Rope::from_str(&text)),
+            search_text(&query, &text)
+        );
+    }
+
+    #[test]
+    fn test_lines_per_file_are_capped() {
+        let text = "hit\n".repeat(MAX_LINES_PER_FILE + 10);
+        assert_eq!(matches(&text, "hit").len(), MAX_LINES_PER_FILE);
+    }
+
+    #[test]
+    fn test_stale_batches_are_dropped() {
+        let mut state = FindInFilesState::default();
+        let files = Arc::new(FileIndex::new());
+        let first = state.start("a", Arc::clone(&files), vec![]).unwrap();
+        let second = state.start("ab", files, vec![]).unwrap();
+        assert!(first.cancel.load(Ordering::Relaxed));
+        assert!(!second.cancel.load(Ordering::Relaxed));
+
+        let file = FileMatches {
+            path: PathBuf::from("/p/a.rs"),
+            lines: matches("ab ab\nab", "ab"),
+        };
+        assert!(!state.apply_batch(first.id, vec![file.clone()]));
+        assert!(state.apply_batch(second.id, vec![file]));
+        assert_eq!(state.match_count, 3);
+        assert_eq!(state.row_count(), 3);
+        assert!(matches!(state.row(0), Some(SearchResultRow::File(_))));
+        assert_eq!(state.target(0), Some((Path::new("/p/a.rs"), 0, 0)));
+        assert_eq!(state.target(2), Some((Path::new("/p/a.rs"), 1, 0)));
+        assert!(state.target(3).is_none());
+
+        assert!(state.finish(second.id, SearchSummary::default()));
+        assert!(!state.searching);
+        assert!(state
+            .start("", Arc::new(FileIndex::new()), vec![])
+            .is_none());
+        assert!(state.results.is_empty());
+    }
+
+    #[test]
+    fn test_smart_case() {
+        let mut state = FindInFilesState::default();
+        let files = Arc::new(FileIndex::new());
+        assert!(
+            !state
+                .start("needle", Arc::clone(&files), vec![])
+                .unwrap()
+                .case_sensitive
+        );
+        assert!(state.start("Needle", files, vec![]).unwrap().case_sensitive);
+    }
+}
@@ -5,11 +5,14 @@
 pub mod document;
 pub mod editor;
 pub mod editor_area;
+pub mod file_index;
+pub mod find_in_files;
 pub mod status_bar;
 pub mod ui;
 pub mod workspace;
+pub mod workspace_scan;
 
-pub use document::{Document, EditOperation};
+pub use document::{Document, EditOperation, LoadProgress};
 pub use editor::{
     BinaryPlaceholderState, Cursor, EditorState, OccurrenceState, Position,
     RectangleSelectionState, ScrollRevealMode, Selection, TabContent, TextViewportMap, ViewMode,
@@ -19,17 +22,19 @@ pub use editor_area::{
     DocumentId, EditorArea, EditorGroup, EditorId, GroupId, LayoutNode, Rect, SplitContainer,
     SplitDirection, SplitterBar, Tab, TabId, SPLITTER_WIDTH,
 };
+pub use file_index::{FileIndex, FileQuery};
+pub use find_in_files::{FileSearchRequest, FindInFilesState};
 pub use status_bar::{
     sync_status_bar, RenderedSegment, SegmentContent, SegmentId, SegmentPosition, StatusBar,
     StatusBarLayout, StatusSegment, TransientMessage,
 };
 pub use ui::{
-    CommandPaletteState, DropState, FileFinderState, FileMatch, FindReplaceField, FindReplaceState,
-    FocusTarget, GotoLineState, HoverRegion, ModalId, ModalState, OutlinePanelState,
-    RecentFilesState, ScrollbarDragAxis, ScrollbarDragState, SidebarResizeState, ThemePickerState,
-    UiState,
+    CommandPaletteState, DropState, FileFinderState, FileMatch, FindInFilesModalState,
+    FindReplaceField, FindReplaceState, FocusTarget, GotoLineState, HoverRegion, ModalId,
+    ModalState, OutlinePanelState, RecentFilesState, ScrollbarDragAxis, ScrollbarDragState,
+    SidebarResizeState, ThemePickerState, UiState,
 };
-pub use workspace::{FileExtension, FileNode, FileTree, Workspace};
+pub use workspace::{FileExtension, FileNode, FileTree, ScanRequest, ScanState, Workspace};
 
 use crate::config::EditorConfig;
 use crate::config_paths;
@@ -37,7 +42,7 @@ use crate::config_paths;
 use crate::debug_overlay::DebugOverlay;
 use crate::recent_files::RecentFiles;
 use crate::theme::{load_theme, Theme};
-use crate::util::{is_likely_binary, validate_file_for_opening, FileOpenError};
+use crate::util::{is_large_file, is_likely_binary, validate_file_for_opening, FileOpenError};
 use std::path::PathBuf;
 
 // ============================================================================
@@ -136,21 +141,45 @@ fn load_config_and_theme() -> (EditorConfig, Theme) {
     (config, theme)
 }
 
+/// Load a validated text file, or start a large-file load for the runtime to
+/// stream in (see `Cmd::StreamLargeFile`)
+fn open_text_document(
+    path: PathBuf,
+    size_bytes: u64,
+    large_file_threshold_mb: u64,
+) -> std::io::Result<Document> {
+    if is_large_file(size_bytes, large_file_threshold_mb) {
+        Ok(Document::loading_from_file(path, size_bytes))
+    } else {
+        Document::from_file(path)
+    }
+}
+
 /// Create initial session with documents and editor area
-fn create_initial_session(file_paths: Vec<PathBuf>, geom: &ViewportGeometry) -> InitialSession {
+fn create_initial_session(
+    file_paths: Vec<PathBuf>,
+    geom: &ViewportGeometry,
+    large_file_threshold_mb: u64,
+) -> InitialSession {
     // Load first file or create empty document
     let (first_document, status_message) = if let Some(first_path) = file_paths.first() {
         // Validate and load the first file
         match validate_file_for_opening(first_path) {
-            Ok(()) => {
+            Ok(size_bytes) => {
                 // File exists and is valid - check for binary
                 if is_likely_binary(first_path) {
                     let msg = format!("Cannot open binary file: {}", first_path.display());
                     (Document::new(), msg)
                 } else {
-                    match Document::from_file(first_path.clone()) {
+                    match open_text_document(
+                        first_path.clone(),
+                        size_bytes,
+                        large_file_threshold_mb,
+                    ) {
                         Ok(doc) => {
-                            let msg = if file_paths.len() > 1 {
+                            let msg = if doc.is_loading() {
+                                format!("Loading {}...", first_path.display())
+                            } else if file_paths.len() > 1 {
                                 format!("Opened {} files", file_paths.len())
                             } else {
                                 format!("Loaded: {}", first_path.display())
@@ -190,13 +219,13 @@ fn create_initial_session(file_paths: Vec<PathBuf>, geom: &ViewportGeometry) ->
     for path in file_paths.into_iter().skip(1) {
         // Validate before attempting to open
         let doc = match validate_file_for_opening(&path) {
-            Ok(()) => {
+            Ok(size_bytes) => {
                 // File exists - check for binary
                 if is_likely_binary(&path) {
                     tracing::warn!("Skipping binary file: {}", path.display());
                     continue;
                 }
-                match Document::from_file(path.clone()) {
+                match open_text_document(path.clone(), size_bytes, large_file_threshold_mb) {
                     Ok(doc) => doc,
                     Err(e) => {
                         tracing::warn!("Failed to open {}: {}", path.display(), e);
@@ -415,8 +444,12 @@ pub struct AppModel {
     pub terminal: crate::terminal::TerminalState,
     /// Outline panel UI state (expand/collapse, selection, scroll)
     pub outline_panel: crate::model::ui::OutlinePanelState,
+    /// Find-in-files results panel state (query, streamed results, selection)
+    pub find_in_files: FindInFilesState,
     /// Recent files list (persistent across sessions)
     pub recent_files: RecentFiles,
+    /// Memory reported by the syntax workers and the renderer
+    pub memory: crate::memory::MemoryStats,
     /// Debug overlay state (debug builds only)
     #[cfg(debug_assertions)]
     pub debug_overlay: Option<DebugOverlay>,
@@ -446,7 +479,7 @@ impl AppModel {
         let InitialSession {
             editor_area,
             status_message,
-        } = create_initial_session(file_paths, &geom);
+        } = create_initial_session(file_paths, &geom, config.large_file_threshold_mb);
 
         Self {
             editor_area,
@@ -461,26 +494,33 @@ impl AppModel {
             dock_layout: crate::panel::DockLayout::default(),
             terminal: crate::terminal::TerminalState::default(),
             outline_panel: crate::model::ui::OutlinePanelState::default(),
+            find_in_files: FindInFilesState::default(),
             recent_files,
+            memory: crate::memory::MemoryStats::default(),
             #[cfg(debug_assertions)]
             debug_overlay: Some(DebugOverlay::new()),
         }
     }
 
     /// Open a directory as workspace
-    pub fn open_workspace(&mut self, root: PathBuf) {
-        match Workspace::new(root.clone(), &self.metrics) {
-            Ok(workspace) => {
+    ///
+    /// Only the root folder is listed here; the returned scan fills in the
+    /// rest of the file tree in the background.
+    pub fn open_workspace(&mut self, root: PathBuf) -> Option<ScanRequest> {
+        match Workspace::open(root.clone(), &self.metrics) {
+            Ok((workspace, scan)) => {
                 // Sync dock layout with workspace sidebar state
                 self.dock_layout.left.is_open = workspace.sidebar_visible;
                 self.dock_layout.left.size_logical = workspace.sidebar_width_logical;
                 self.workspace = Some(workspace);
                 self.ui
                     .set_status(format!("Opened workspace: {}", root.display()));
+                Some(scan)
             }
             Err(e) => {
                 self.ui
                     .set_status(format!("Failed to open workspace: {}", e));
+                None
             }
         }
     }
@@ -1,11 +1,14 @@
 //! UI state - status bar, cursor blink, modals, and other UI concerns
 
 use super::editor_area::{GroupId, SplitDirection};
+use super::file_index::{FileIndex, FileQuery};
 use super::status_bar::{StatusBar, TransientMessage};
 use crate::editable::{EditConstraints, EditableState, StringBuffer};
 use crate::panel::DockPosition;
 use crate::theme::{list_available_themes, ThemeInfo};
+use serde::{Deserialize, Serialize};
 use std::path::PathBuf;
+use std::sync::Arc;
 use std::time::{Duration, Instant};
 
 // ============================================================================
@@ -69,7 +72,7 @@ pub enum HoverRegion {
 // ============================================================================
 
 /// Identifies which modal is currently active
-#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
 pub enum ModalId {
     /// Command palette (Shift+Cmd+A)
     CommandPalette,
@@ -83,6 +86,8 @@ pub enum ModalId {
     FileFinder,
     /// Recent files list (Cmd+E)
     RecentFiles,
+    /// Find in files (Shift+Cmd+F) - results stream into the search panel
+    FindInFiles,
 }
 
 /// State for the command palette modal
@@ -302,20 +307,23 @@ pub struct FileFinderState {
     pub selected_index: usize,
     /// Filtered and ranked file results
     pub results: Vec<FileMatch>,
-    /// All files in workspace (cached when modal opens)
-    pub all_files: Vec<PathBuf>,
+    /// Index of all files in workspace (snapshot taken when modal opens)
+    pub files: Arc<FileIndex>,
+    /// Matches of the last query, narrowed as the query is extended
+    pub query: FileQuery,
     /// Workspace root path (for computing relative paths)
     pub workspace_root: PathBuf,
 }
 
 impl FileFinderState {
-    /// Create a new file finder state with the given files
-    pub fn new(all_files: Vec<PathBuf>, workspace_root: PathBuf) -> Self {
+    /// Create a new file finder state searching the given files
+    pub fn new(files: Arc<FileIndex>, workspace_root: PathBuf) -> Self {
         Self {
             editable: EditableState::new(StringBuffer::new(), EditConstraints::single_line()),
             selected_index: 0,
             results: Vec::new(),
-            all_files,
+            files,
+            query: FileQuery::default(),
             workspace_root,
         }
     }
@@ -391,6 +399,36 @@ impl RecentFilesState {
     }
 }
 
+/// State for the find-in-files modal
+///
+/// Only holds the query being typed; the search itself and its results live
+/// in [`FindInFilesState`](super::FindInFilesState) so they outlive the modal.
+#[derive(Debug, Clone)]
+pub struct FindInFilesModalState {
+    /// Editable state for the query input field
+    pub editable: EditableState<StringBuffer>,
+}
+
+impl FindInFilesModalState {
+    /// Create the modal with `query` (the last search's) preselected
+    pub fn new(query: &str) -> Self {
+        let mut editable = EditableState::new(StringBuffer::new(), EditConstraints::single_line());
+        editable.set_content(query);
+        editable.select_all();
+        Self { editable }
+    }
+
+    /// Get the query text
+    pub fn input(&self) -> String {
+        self.editable.text()
+    }
+
+    /// Set the query text
+    pub fn set_input(&mut self, text: &str) {
+        self.editable.set_content(text);
+    }
+}
+
 /// Union of all modal states
 #[derive(Debug, Clone)]
 pub enum ModalState {
@@ -400,6 +438,7 @@ pub enum ModalState {
     ThemePicker(ThemePickerState),
     FileFinder(FileFinderState),
     RecentFiles(RecentFilesState),
+    FindInFiles(FindInFilesModalState),
 }
 
 impl ModalState {
@@ -412,6 +451,7 @@ impl ModalState {
             ModalState::ThemePicker(_) => ModalId::ThemePicker,
             ModalState::FileFinder(_) => ModalId::FileFinder,
             ModalState::RecentFiles(_) => ModalId::RecentFiles,
+            ModalState::FindInFiles(_) => ModalId::FindInFiles,
         }
     }
 }
@@ -5,11 +5,14 @@
 //! - Workspace root directory tracking
 //! - File type classification and icons
 
-use std::collections::HashSet;
+use std::collections::{HashMap, HashSet};
 use std::path::{Path, PathBuf};
+use std::sync::Arc;
 
 use crate::util::{visible_tree_count, visible_tree_row_at_index, visible_tree_row_matching};
 
+use super::file_index::FileIndex;
+use super::workspace_scan::{read_directory, scan_directories, GitIgnore, IgnoreStack, ScannedDir};
 use super::ScaledMetrics;
 
 // ============================================================================
@@ -141,6 +144,9 @@ pub struct FileNode {
     pub is_dir: bool,
     /// Children (only populated for directories)
     pub children: Vec<FileNode>,
+    /// Whether a directory's children have been read from disk (always
+    /// false for files)
+    pub children_loaded: bool,
     /// Cached file extension classification
     pub extension: FileExtension,
 }
@@ -160,6 +166,7 @@ impl FileNode {
             path,
             is_dir: false,
             children: Vec::new(),
+            children_loaded: false,
             extension,
         }
     }
@@ -177,6 +184,7 @@ impl FileNode {
             path,
             is_dir: true,
             children: Vec::new(),
+            children_loaded: false,
             extension: FileExtension::Unknown,
         }
     }
@@ -222,10 +230,19 @@ const IGNORE_PATTERNS: &[&str] = &[
 ];
 
 /// The complete file tree for a workspace
+///
+/// Directories are filled in as their listings arrive from
+/// [`scan_directories`](super::workspace_scan::scan_directories), so a tree
+/// being scanned holds unloaded directories (see [`FileNode::children_loaded`]).
 #[derive(Debug, Clone, Default)]
 pub struct FileTree {
     /// Root nodes (files/directories at workspace root)
     pub roots: Vec<FileNode>,
+    /// Parsed `.gitignore` files, by the directory containing them
+    ignores: HashMap<PathBuf, Arc<GitIgnore>>,
+    /// Every file in the tree, for the file finder; shared with open
+    /// finders, which keep the snapshot they opened with
+    files: Arc<FileIndex>,
 }
 
 impl FileTree {
@@ -234,62 +251,284 @@ impl FileTree {
     /// The workspace root folder itself becomes the first (and only) root node,
     /// with its contents as children. This matches VS Code behavior where the
     /// project folder name is visible at the top of the file tree.
+    ///
+    /// Blocks until the whole tree is scanned; [`Workspace::open`] scans in
+    /// the background instead.
     pub fn from_directory(root: &Path) -> std::io::Result<Self> {
+        let mut tree = Self::default();
         if !root.is_dir() {
-            return Ok(Self { roots: Vec::new() });
+            return Ok(tree);
         }
 
-        // Scan the contents of the root directory
-        let mut children = Self::scan_directory(root, 0)?;
-        Self::sort_nodes(&mut children);
+        let subdirs = tree.load_root(root)?;
+        scan_directories(subdirs, |batch| {
+            tree.apply_scanned(batch);
+            true
+        });
+        Ok(tree)
+    }
 
-        // Create the root folder node with the workspace directory itself
-        let mut root_node = FileNode::new_dir(root.to_path_buf());
-        root_node.children = children;
+    /// (Re)read the listing of the workspace root, making it the tree's only
+    /// root node. Returns its subdirectories, with the ignore rules for their
+    /// entries, for a [`scan_directories`] pass to fill in.
+    ///
+    /// Subdirectories already loaded keep their children until the scan
+    /// replaces them.
+    pub fn load_root(&mut self, root: &Path) -> std::io::Result<Vec<(PathBuf, IgnoreStack)>> {
+        if !self.roots.iter().any(|node| node.path == root) {
+            *self = Self {
+                roots: vec![FileNode::new_dir(root.to_path_buf())],
+                ..Self::default()
+            };
+        }
 
-        Ok(Self {
-            roots: vec![root_node],
-        })
+        let (listing, ignores) = read_directory(root, &IgnoreStack::default())?;
+        let subdirs = listing
+            .children
+            .iter()
+            .filter(|node| node.is_dir)
+            .map(|node| (node.path.clone(), ignores.clone()))
+            .collect();
+        self.apply_scanned(vec![listing]);
+        Ok(subdirs)
     }
 
-    /// Scan a directory recursively (up to max depth)
-    fn scan_directory(dir: &Path, depth: usize) -> std::io::Result<Vec<FileNode>> {
-        const MAX_DEPTH: usize = 20;
+    /// Patch scanned directory listings into the tree
+    ///
+    /// Listings for directories not in the tree (their parent's listing
+    /// hasn't been applied) are dropped. Subdirectories that were already
+    /// loaded keep their children.
+    pub fn apply_scanned(&mut self, dirs: Vec<ScannedDir>) {
+        for dir in dirs {
+            let Some(node) = Self::find_node_mut(&mut self.roots, &dir.path) else {
+                continue;
+            };
+            if !node.is_dir {
+                continue;
+            }
+
+            let mut previous: HashMap<PathBuf, FileNode> = std::mem::take(&mut node.children)
+                .into_iter()
+                .map(|child| (child.path.clone(), child))
+                .collect();
+            node.children = dir.children;
+
+            let mut added = Vec::new();
+            for child in &mut node.children {
+                match previous.remove(&child.path) {
+                    Some(old) if old.is_dir == child.is_dir => {
+                        if old.children_loaded {
+                            child.children = old.children;
+                            child.children_loaded = true;
+                        }
+                    }
+                    old => {
+                        previous.extend(old.map(|old| (old.path.clone(), old)));
+                        if !child.is_dir {
+                            added.push(child.path.clone());
+                        }
+                    }
+                }
+            }
+            node.children_loaded = true;
+
+            // Nodes left in `previous` are gone (or changed kind)
+            if !added.is_empty() || !previous.is_empty() {
+                let files = Arc::make_mut(&mut self.files);
+                for old in previous.values() {
+                    Self::unindex(files, old);
+                }
+                for path in added {
+                    files.insert(path);
+                }
+            }
 
-        if depth > MAX_DEPTH {
-            return Ok(Vec::new());
+            match dir.gitignore {
+                Some(gitignore) => {
+                    self.ignores.insert(dir.path, gitignore);
+                }
+                None => {
+                    self.ignores.remove(&dir.path);
+                }
+            }
         }
+    }
 
-        let mut nodes = Vec::new();
+    /// The index of every file loaded into the tree
+    pub fn file_index(&self) -> Arc<FileIndex> {
+        Arc::clone(&self.files)
+    }
 
-        for entry in std::fs::read_dir(dir)? {
-            let entry = entry?;
-            let path = entry.path();
+    /// Drop the files of a removed node (and everything below it) from
+    /// the index
+    fn unindex(files: &mut FileIndex, node: &FileNode) {
+        if node.is_dir {
+            for child in &node.children {
+                Self::unindex(files, child);
+            }
+        } else {
+            files.remove(&node.path);
+        }
+    }
 
-            // Check if should ignore
-            if Self::should_ignore(&path) {
+    /// Read the children of a directory the scan hasn't reached yet
+    ///
+    /// No-op for directories that are already loaded or not in the tree.
+    pub fn load_directory(&mut self, dir: &Path) -> std::io::Result<()> {
+        let unloaded = Self::find_node_mut(&mut self.roots, dir)
+            .is_some_and(|node| node.is_dir && !node.children_loaded);
+        if !unloaded {
+            return Ok(());
+        }
+
+        let ignores = dir
+            .parent()
+            .map(|parent| self.ignore_stack(parent))
+            .unwrap_or_default();
+        let (listing, _) = read_directory(dir, &ignores)?;
+        self.apply_scanned(vec![listing]);
+        Ok(())
+    }
+
+    /// Update the tree for paths reported changed by the file system watcher
+    ///
+    /// Each path is looked up on disk and its node inserted, removed or
+    /// left alone; nothing else is re-read. Returns the directories whose
+    /// contents still need a [`scan_directories`] pass (created directories,
+    /// and directories whose `.gitignore` changed), with the ignore rules
+    /// for their entries. Paths under unloaded directories are skipped, since
+    /// those directories are read in full when loaded.
+    pub fn patch_paths(&mut self, paths: &[PathBuf]) -> Vec<(PathBuf, IgnoreStack)> {
+        let mut rescan: Vec<PathBuf> = Vec::new();
+        for path in paths {
+            let Some(parent) = path.parent() else {
                 continue;
+            };
+            if path.file_name().is_some_and(|name| name == ".gitignore") {
+                // Rules for the whole subtree changed: pick them up for the
+                // other paths in this batch, then relist the subtree
+                if Self::find_node_mut(&mut self.roots, parent).is_some() {
+                    match GitIgnore::from_dir(parent) {
+                        Some(gitignore) => {
+                            self.ignores
+                                .insert(parent.to_path_buf(), Arc::new(gitignore));
+                        }
+                        None => {
+                            self.ignores.remove(parent);
+                        }
+                    }
+                    rescan.push(parent.to_path_buf());
+                }
+            } else if self.patch_path(parent, path) {
+                rescan.push(path.clone());
             }
+        }
 
-            let node = if path.is_dir() {
-                let mut dir_node = FileNode::new_dir(path.clone());
-                // Recursively scan children
-                dir_node.children = Self::scan_directory(&path, depth + 1)?;
-                Self::sort_nodes(&mut dir_node.children);
-                dir_node
-            } else {
-                FileNode::new_file(path)
-            };
+        // Scanning a directory covers everything below it
+        rescan.sort();
+        rescan.dedup();
+        let subtrees = rescan.clone();
+        rescan.retain(|dir| {
+            !subtrees
+                .iter()
+                .any(|other| other != dir && dir.starts_with(other))
+        });
+
+        rescan
+            .into_iter()
+            .map(|dir| {
+                let ignores = dir
+                    .parent()
+                    .map(|parent| self.ignore_stack(parent))
+                    .unwrap_or_default();
+                (dir, ignores)
+            })
+            .collect()
+    }
+
+    /// Sync the node for `path` in `parent` with the disk. Returns true if
+    /// a directory was inserted, which still needs its contents scanned.
+    fn patch_path(&mut self, parent: &Path, path: &Path) -> bool {
+        let ignores = self.ignore_stack(parent);
+        let kept = std::fs::metadata(path)
+            .ok()
+            .map(|metadata| metadata.is_dir())
+            .filter(|&is_dir| !Self::should_ignore(path) && !ignores.is_ignored(path, is_dir));
+        if kept != Some(true) {
+            // Forget the rules of a removed (or now ignored) directory
+            self.ignores.retain(|dir, _| !dir.starts_with(path));
+        }
 
-            // Skip empty directories? (optional, currently keeping them)
-            nodes.push(node);
+        let Some(parent_node) = Self::find_node_mut(&mut self.roots, parent) else {
+            return false;
+        };
+        if !parent_node.is_dir || !parent_node.children_loaded {
+            return false;
         }
 
-        Ok(nodes)
+        let existing = parent_node
+            .children
+            .iter()
+            .position(|child| child.path == path);
+        if let Some(index) = existing {
+            if kept == Some(parent_node.children[index].is_dir) {
+                // Modified in place
+                return false;
+            }
+            let old = parent_node.children.remove(index);
+            Self::unindex(Arc::make_mut(&mut self.files), &old);
+        }
+
+        let Some(is_dir) = kept else {
+            return false;
+        };
+        let node = if is_dir {
+            FileNode::new_dir(path.to_path_buf())
+        } else {
+            FileNode::new_file(path.to_path_buf())
+        };
+        let index = parent_node
+            .children
+            .binary_search_by(|child| Self::compare_nodes(child, &node))
+            .unwrap_or_else(|index| index);
+        parent_node.children.insert(index, node);
+        if !is_dir {
+            Arc::make_mut(&mut self.files).insert(path.to_path_buf());
+        }
+        is_dir
+    }
+
+    /// The gitignore rules that apply to the entries of `dir`
+    pub fn ignore_stack(&self, dir: &Path) -> IgnoreStack {
+        let Some(root) = self.roots.iter().find(|root| dir.starts_with(&root.path)) else {
+            return IgnoreStack::default();
+        };
+
+        let mut dirs: Vec<&Path> = dir
+            .ancestors()
+            .take_while(|ancestor| ancestor.starts_with(&root.path))
+            .collect();
+        dirs.reverse();
+        dirs.into_iter()
+            .filter_map(|dir| self.ignores.get(dir))
+            .fold(IgnoreStack::default(), |stack, gitignore| {
+                stack.with(Arc::clone(gitignore))
+            })
+    }
+
+    /// Find the node for `path` by walking its components down from a root
+    fn find_node_mut<'a>(roots: &'a mut [FileNode], path: &Path) -> Option<&'a mut FileNode> {
+        let root = roots.iter_mut().find(|root| path.starts_with(&root.path))?;
+        let relative = path.strip_prefix(&root.path).ok()?;
+        relative.components().try_fold(root, |node, component| {
+            node.children
+                .iter_mut()
+                .find(|child| child.path.file_name() == Some(component.as_os_str()))
+        })
     }
 
     /// Check if a path should be ignored
-    fn should_ignore(path: &Path) -> bool {
+    pub(super) fn should_ignore(path: &Path) -> bool {
         let name = path.file_name().and_then(|n| n.to_str()).unwrap_or("");
 
         // Check exact matches
@@ -315,91 +554,16 @@ impl FileTree {
     }
 
     /// Sort nodes: directories first, then alphabetically (case-insensitive)
-    fn sort_nodes(nodes: &mut [FileNode]) {
-        nodes.sort_by(|a, b| match (a.is_dir, b.is_dir) {
+    pub(super) fn sort_nodes(nodes: &mut [FileNode]) {
+        nodes.sort_by(Self::compare_nodes);
+    }
+
+    fn compare_nodes(a: &FileNode, b: &FileNode) -> std::cmp::Ordering {
+        match (a.is_dir, b.is_dir) {
             (true, false) => std::cmp::Ordering::Less,
             (false, true) => std::cmp::Ordering::Greater,
             _ => a.name.to_lowercase().cmp(&b.name.to_lowercase()),
-        });
-    }
-
-    /// Refresh the file tree from disk (full rescan)
-    pub fn refresh(&mut self, root: &Path) -> std::io::Result<()> {
-        *self = Self::from_directory(root)?;
-        Ok(())
-    }
-
-    /// Incrementally update the tree for changed paths.
-    ///
-    /// Instead of rescanning the entire tree, this method only refreshes
-    /// the parent directories of the changed paths. This is much faster
-    /// for typical file system changes (creating/deleting/modifying files).
-    pub fn update_paths(&mut self, root: &Path, paths: &[PathBuf]) -> std::io::Result<()> {
-        // Collect unique parent directories that need updating
-        let mut parents_to_refresh: HashSet<PathBuf> = HashSet::new();
-
-        for path in paths {
-            // Get the parent directory of the changed path
-            if let Some(parent) = path.parent() {
-                // Only include if within the workspace root
-                if parent.starts_with(root) {
-                    parents_to_refresh.insert(parent.to_path_buf());
-                }
-            }
-        }
-
-        // If no valid parents or too many changes, fall back to full refresh
-        if parents_to_refresh.is_empty() || parents_to_refresh.len() > 10 {
-            return self.refresh(root);
-        }
-
-        // Refresh each parent directory incrementally
-        for parent in &parents_to_refresh {
-            self.refresh_directory(root, parent)?;
-        }
-
-        Ok(())
-    }
-
-    /// Refresh a single directory's children in the tree.
-    fn refresh_directory(&mut self, root: &Path, dir_path: &Path) -> std::io::Result<()> {
-        // Special case: refreshing the root itself
-        if dir_path == root {
-            return self.refresh(root);
-        }
-
-        // Find the node for this directory and update its children
-        for tree_root in &mut self.roots {
-            if Self::refresh_node_directory(tree_root, dir_path)? {
-                return Ok(());
-            }
-        }
-
-        // Directory not found in tree - might be new, do full refresh
-        self.refresh(root)
-    }
-
-    /// Recursively find and refresh a directory node.
-    /// Returns true if the directory was found and refreshed.
-    fn refresh_node_directory(node: &mut FileNode, target_dir: &Path) -> std::io::Result<bool> {
-        if node.path == target_dir && node.is_dir {
-            // Found it! Refresh this node's children
-            let mut new_children = Self::scan_directory(&node.path, 0)?;
-            Self::sort_nodes(&mut new_children);
-            node.children = new_children;
-            return Ok(true);
-        }
-
-        // Recurse into children
-        if node.is_dir && target_dir.starts_with(&node.path) {
-            for child in &mut node.children {
-                if Self::refresh_node_directory(child, target_dir)? {
-                    return Ok(true);
-                }
-            }
         }
-
-        Ok(false)
     }
 
     /// Get all file paths recursively (excludes directories)
@@ -472,6 +636,25 @@ impl FileTree {
 // Workspace
 // ============================================================================
 
+/// A background scan for [`scan_directories`] to run, whose batches go to
+/// [`Workspace::apply_scan_batch`]
+#[derive(Debug, Clone)]
+pub struct ScanRequest {
+    /// Generation the batches are tagged with
+    pub generation: u64,
+    /// Directories to scan, with the ignore rules for their entries
+    pub dirs: Vec<(PathBuf, IgnoreStack)>,
+}
+
+/// Bookkeeping for background scans of a workspace
+#[derive(Debug, Clone, Default)]
+pub struct ScanState {
+    /// Bumped by every full rescan; batches from older scans are dropped
+    generation: u64,
+    /// Scans of the current generation that haven't finished
+    in_flight: usize,
+}
+
 /// Workspace state - manages file tree and sidebar
 #[derive(Debug, Clone)]
 pub struct Workspace {
@@ -495,22 +678,39 @@ pub struct Workspace {
 
     /// Scroll offset in the file tree (in items)
     pub scroll_offset: usize,
+
+    /// Background scans feeding the file tree
+    pub scan: ScanState,
 }
 
 impl Workspace {
-    /// Create a new workspace from a directory
+    /// Create a new workspace from a directory, scanning the whole tree
+    /// before returning
     pub fn new(root: PathBuf, metrics: &ScaledMetrics) -> std::io::Result<Self> {
         // Canonicalize the root path to get the full absolute path
         // This ensures file_name() works correctly (e.g., "." becomes "/path/to/dir")
         let root = std::fs::canonicalize(&root)?;
 
         let file_tree = FileTree::from_directory(&root)?;
+        Ok(Self::with_tree(root, file_tree, metrics))
+    }
 
+    /// Open a workspace with only the root folder listed, returning the
+    /// scan that fills in the rest of the tree in the background
+    pub fn open(root: PathBuf, metrics: &ScaledMetrics) -> std::io::Result<(Self, ScanRequest)> {
+        let root = std::fs::canonicalize(&root)?;
+
+        let mut workspace = Self::with_tree(root, FileTree::default(), metrics);
+        let request = workspace.start_scan()?;
+        Ok((workspace, request))
+    }
+
+    fn with_tree(root: PathBuf, file_tree: FileTree, metrics: &ScaledMetrics) -> Self {
         // Auto-expand the workspace root folder so its contents are visible
         let mut expanded_folders = HashSet::new();
         expanded_folders.insert(root.clone());
 
-        Ok(Self {
+        Self {
             root,
             expanded_folders,
             selected_item: None,
@@ -518,7 +718,8 @@ impl Workspace {
             sidebar_visible: true,
             sidebar_width_logical: metrics.sidebar_default_width_logical,
             scroll_offset: 0,
-        })
+            scan: ScanState::default(),
+        }
     }
 
     /// Get sidebar width in physical pixels
@@ -536,12 +737,17 @@ impl Workspace {
         if self.expanded_folders.contains(path) {
             self.collapse_folder(path);
         } else {
-            self.expanded_folders.insert(path.to_path_buf());
+            self.expand_folder(path);
         }
     }
 
     /// Expand a folder (no-op if already expanded)
+    ///
+    /// A folder the background scan hasn't reached yet is read on the spot.
     pub fn expand_folder(&mut self, path: &Path) {
+        if let Err(e) = self.file_tree.load_directory(path) {
+            tracing::debug!("Failed to load {}: {}", path.display(), e);
+        }
         self.expanded_folders.insert(path.to_path_buf());
     }
 
@@ -560,15 +766,54 @@ impl Workspace {
         self.expanded_folders.contains(path)
     }
 
-    /// Refresh the file tree from disk (full rescan)
-    pub fn refresh(&mut self) -> std::io::Result<()> {
-        self.file_tree.refresh(&self.root)
+    /// Start a full rescan of the file tree from disk
+    ///
+    /// The root listing is re-read right away; the returned scan refreshes
+    /// everything below it and supersedes any scan still running.
+    pub fn start_scan(&mut self) -> std::io::Result<ScanRequest> {
+        let dirs = self.file_tree.load_root(&self.root)?;
+        self.scan.generation += 1;
+        self.scan.in_flight = 1;
+        Ok(ScanRequest {
+            generation: self.scan.generation,
+            dirs,
+        })
     }
 
     /// Incrementally update the file tree for specific changed paths.
-    /// Much faster than full refresh for typical file operations.
-    pub fn update_paths(&mut self, paths: &[PathBuf]) -> std::io::Result<()> {
-        self.file_tree.update_paths(&self.root, paths)
+    ///
+    /// Only the nodes for the changed paths are touched. Returns a scan when
+    /// new directories (or changed `.gitignore` rules) need their contents
+    /// read.
+    pub fn update_paths(&mut self, paths: &[PathBuf]) -> Option<ScanRequest> {
+        let dirs = self.file_tree.patch_paths(paths);
+        if dirs.is_empty() {
+            return None;
+        }
+        self.scan.in_flight += 1;
+        Some(ScanRequest {
+            generation: self.scan.generation,
+            dirs,
+        })
+    }
+
+    /// Patch a batch of listings from a background scan into the tree
+    pub fn apply_scan_batch(&mut self, generation: u64, dirs: Vec<ScannedDir>) {
+        if generation == self.scan.generation {
+            self.file_tree.apply_scanned(dirs);
+        }
+    }
+
+    /// Record that a background scan finished
+    pub fn finish_scan(&mut self, generation: u64) {
+        if generation == self.scan.generation {
+            self.scan.in_flight = self.scan.in_flight.saturating_sub(1);
+        }
+    }
+
+    /// Whether background scans are still filling in the tree
+    pub fn is_scanning(&self) -> bool {
+        self.scan.in_flight > 0
     }
 
     /// Get visible item count (for scrollbar)
@@ -585,13 +830,16 @@ impl Workspace {
 
     /// Reveal a file in the tree (expand parent folders and select)
     pub fn reveal_file(&mut self, path: &Path) {
-        // Expand all parent folders
-        let mut current = path.parent();
-        while let Some(parent) = current {
-            if parent.starts_with(&self.root) && parent != self.root {
-                self.expand_folder(parent);
-            }
-            current = parent.parent();
+        // Expand all parent folders, outermost first so unloaded ones can
+        // be read in order
+        let parents: Vec<PathBuf> = path
+            .ancestors()
+            .skip(1)
+            .filter(|parent| parent.starts_with(&self.root) && *parent != self.root)
+            .map(Path::to_path_buf)
+            .collect();
+        for parent in parents.iter().rev() {
+            self.expand_folder(parent);
         }
 
         // Select the file
@@ -673,6 +921,7 @@ mod tests {
             sidebar_visible: true,
             sidebar_width_logical: metrics.sidebar_default_width_logical,
             scroll_offset: 0,
+            scan: ScanState::default(),
         };
 
         let folder = Path::new("/test/src");
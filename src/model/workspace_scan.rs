@@ -0,0 +1,510 @@
+//! Parallel, gitignore-aware workspace scanning
+//!
+//! Directory listings are read by a pool of threads that share work through
+//! per-thread queues: each thread takes the shallowest directory from its own
+//! queue and steals the deepest from another thread's when it runs dry, so the
+//! top levels of the tree (the ones the sidebar shows first) finish early.
+//!
+//! Every listing is reported as a [`ScannedDir`] before its subdirectories are
+//! queued, so listings arrive parent-first and can be patched straight into a
+//! [`FileTree`](super::FileTree) as they stream in.
+
+use std::collections::VecDeque;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use std::sync::mpsc::{self, RecvTimeoutError, Sender};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant};
+
+use super::workspace::{FileNode, FileTree};
+
+/// Deepest directory level scanned below a scan root
+const MAX_SCAN_DEPTH: usize = 20;
+
+/// Listings collected before a batch is reported
+const SCAN_BATCH_DIRS: usize = 512;
+
+/// Longest a listing waits before its batch is reported
+const SCAN_BATCH_INTERVAL: Duration = Duration::from_millis(50);
+
+/// How long an idle scan thread sleeps before looking for work again
+const IDLE_BACKOFF: Duration = Duration::from_micros(200);
+
+// ============================================================================
+// Gitignore Rules
+// ============================================================================
+
+/// Rules of one `.gitignore` file
+#[derive(Debug)]
+pub struct GitIgnore {
+    /// Directory containing the file; patterns are relative to it
+    base: PathBuf,
+    rules: Vec<IgnoreRule>,
+}
+
+#[derive(Debug)]
+struct IgnoreRule {
+    glob: String,
+    /// `!pattern`: re-include what an earlier rule excluded
+    negated: bool,
+    /// `pattern/`: only matches directories
+    dir_only: bool,
+    /// The pattern contains a `/`, so it matches the path relative to the
+    /// file's directory rather than just the name
+    anchored: bool,
+}
+
+impl GitIgnore {
+    /// Parse the contents of the `.gitignore` in `base`
+    pub fn parse(base: &Path, contents: &str) -> Self {
+        let rules = contents
+            .lines()
+            .filter_map(|line| {
+                let line = line.trim_end();
+                if line.is_empty() || line.starts_with('#') {
+                    return None;
+                }
+                let (negated, line) = match line.strip_prefix('!') {
+                    Some(rest) => (true, rest),
+                    None => (false, line.strip_prefix('\\').unwrap_or(line)),
+                };
+                let (dir_only, line) = match line.strip_suffix('/') {
+                    Some(rest) => (true, rest),
+                    None => (false, line),
+                };
+                let anchored = line.contains('/');
+                let glob = line.strip_prefix('/').unwrap_or(line);
+                if glob.is_empty() {
+                    return None;
+                }
+                Some(IgnoreRule {
+                    glob: glob.to_string(),
+                    negated,
+                    dir_only,
+                    anchored,
+                })
+            })
+            .collect();
+
+        Self {
+            base: base.to_path_buf(),
+            rules,
+        }
+    }
+
+    /// Read `dir/.gitignore`, if there is one
+    pub fn from_dir(dir: &Path) -> Option<Self> {
+        let contents = std::fs::read_to_string(dir.join(".gitignore")).ok()?;
+        Some(Self::parse(dir, &contents))
+    }
+
+    /// Whether the last rule matching `path` ignores it (`Some(true)`) or
+    /// re-includes it (`Some(false)`); `None` when no rule matches
+    pub fn matched(&self, path: &Path, is_dir: bool) -> Option<bool> {
+        let relative = path.strip_prefix(&self.base).ok()?;
+        let relative = relative.to_str()?.replace(std::path::MAIN_SEPARATOR, "/");
+        let name = relative.rsplit('/').next().unwrap_or(&relative);
+
+        self.rules.iter().rev().find_map(|rule| {
+            if rule.dir_only && !is_dir {
+                return None;
+            }
+            let text = if rule.anchored { &relative } else { name };
+            glob_match(rule.glob.as_bytes(), text.as_bytes()).then_some(!rule.negated)
+        })
+    }
+}
+
+/// Match `text` against a gitignore glob: `*` and `?` stay within one path
+/// segment, `**` spans segments and `[...]` matches a character class
+fn glob_match(pattern: &[u8], text: &[u8]) -> bool {
+    match pattern.first() {
+        None => text.is_empty(),
+        Some(b'*') if pattern.get(1) == Some(&b'*') => {
+            let rest = &pattern[2..];
+            match rest.strip_prefix(b"/") {
+                // `**/`: zero or more whole directories
+                Some(rest) => {
+                    glob_match(rest, text)
+                        || text
+                            .iter()
+                            .enumerate()
+                            .any(|(i, &b)| b == b'/' && glob_match(rest, &text[i + 1..]))
+                }
+                None => (0..=text.len()).any(|i| glob_match(rest, &text[i..])),
+            }
+        }
+        Some(b'*') => {
+            let rest = &pattern[1..];
+            for i in 0..=text.len() {
+                if glob_match(rest, &text[i..]) {
+                    return true;
+                }
+                if text.get(i) == Some(&b'/') {
+                    break;
+                }
+            }
+            false
+        }
+        Some(b'?') => match text.first() {
+            Some(&b) if b != b'/' => glob_match(&pattern[1..], &text[utf8_len(b)..]),
+            _ => false,
+        },
+        Some(b'[') => match (class_match(&pattern[1..], text), text.first()) {
+            (Some((matched, rest)), Some(&b)) => {
+                matched && b != b'/' && glob_match(rest, &text[utf8_len(b)..])
+            }
+            (Some(_), None) => false,
+            // No closing bracket: a literal `[`
+            (None, _) => text.first() == Some(&b'[') && glob_match(&pattern[1..], &text[1..]),
+        },
+        Some(b'\\') if pattern.len() > 1 => {
+            text.first() == Some(&pattern[1]) && glob_match(&pattern[2..], &text[1..])
+        }
+        Some(&b) => text.first() == Some(&b) && glob_match(&pattern[1..], &text[1..]),
+    }
+}
+
+/// Match the first byte of `text` against the class body at the start of
+/// `pattern` (just after `[`). Returns the result and the pattern after the
+/// closing `]`, or `None` if the class is unterminated. Classes compare bytes,
+/// which covers the ASCII ranges gitignore files use.
+fn class_match<'p>(pattern: &'p [u8], text: &[u8]) -> Option<(bool, &'p [u8])> {
+    let (negated, body) = match pattern.first() {
+        Some(b'!' | b'^') => (true, &pattern[1..]),
+        _ => (false, pattern),
+    };
+    // A `]` right after the opening bracket is part of the class
+    let close = body
+        .iter()
+        .skip(1)
+        .position(|&b| b == b']')
+        .map(|i| i + 1)?;
+    let (class, rest) = (&body[..close], &body[close + 1..]);
+
+    let Some(&c) = text.first() else {
+        return Some((false, rest));
+    };
+    let mut matched = false;
+    let mut i = 0;
+    while i < class.len() {
+        if i + 2 < class.len() && class[i + 1] == b'-' {
+            matched |= class[i] <= c && c <= class[i + 2];
+            i += 3;
+        } else {
+            matched |= class[i] == c;
+            i += 1;
+        }
+    }
+    Some((matched != negated, rest))
+}
+
+/// Length of the UTF-8 sequence starting with `first`
+fn utf8_len(first: u8) -> usize {
+    match first {
+        0xF0..=0xFF => 4,
+        0xE0..=0xEF => 3,
+        0xC0..=0xDF => 2,
+        _ => 1,
+    }
+}
+
+/// The `.gitignore` files that apply to a directory's entries, outermost first
+#[derive(Debug, Clone, Default)]
+pub struct IgnoreStack {
+    files: Vec<Arc<GitIgnore>>,
+}
+
+impl IgnoreStack {
+    /// This stack with a deeper directory's rules added
+    pub fn with(&self, gitignore: Arc<GitIgnore>) -> Self {
+        let mut files = self.files.clone();
+        files.push(gitignore);
+        Self { files }
+    }
+
+    /// Whether gitignore rules exclude `path`; rules in deeper files take
+    /// precedence over outer ones
+    pub fn is_ignored(&self, path: &Path, is_dir: bool) -> bool {
+        self.files
+            .iter()
+            .rev()
+            .find_map(|gitignore| gitignore.matched(path, is_dir))
+            .unwrap_or(false)
+    }
+}
+
+// ============================================================================
+// Directory Listings
+// ============================================================================
+
+/// One directory's entries, as read by the scanner
+#[derive(Debug, Clone)]
+pub struct ScannedDir {
+    pub path: PathBuf,
+    /// Sorted entries; subdirectories come back with their children unloaded
+    pub children: Vec<FileNode>,
+    /// The directory's own `.gitignore`, if it has one
+    pub gitignore: Option<Arc<GitIgnore>>,
+}
+
+/// List `dir` (one level), skipping built-in and gitignored entries.
+///
+/// `ignores` holds the rules of `dir`'s ancestors; the returned stack adds
+/// `dir`'s own `.gitignore` and applies to the entries' children.
+pub fn read_directory(
+    dir: &Path,
+    ignores: &IgnoreStack,
+) -> std::io::Result<(ScannedDir, IgnoreStack)> {
+    let gitignore = GitIgnore::from_dir(dir).map(Arc::new);
+    let ignores = match &gitignore {
+        Some(gitignore) => ignores.with(Arc::clone(gitignore)),
+        None => ignores.clone(),
+    };
+
+    let mut children = Vec::new();
+    for entry in std::fs::read_dir(dir)? {
+        let entry = entry?;
+        let path = entry.path();
+        if FileTree::should_ignore(&path) {
+            continue;
+        }
+
+        // The entry's type comes with the listing on most platforms; only
+        // symlinks need an extra stat to see what they point at
+        let file_type = entry.file_type()?;
+        let is_dir = if file_type.is_symlink() {
+            path.is_dir()
+        } else {
+            file_type.is_dir()
+        };
+        if ignores.is_ignored(&path, is_dir) {
+            continue;
+        }
+
+        children.push(if is_dir {
+            FileNode::new_dir(path)
+        } else {
+            FileNode::new_file(path)
+        });
+    }
+    FileTree::sort_nodes(&mut children);
+
+    Ok((
+        ScannedDir {
+            path: dir.to_path_buf(),
+            children,
+            gitignore,
+        },
+        ignores,
+    ))
+}
+
+// ============================================================================
+// Parallel Scan
+// ============================================================================
+
+struct ScanJob {
+    dir: PathBuf,
+    ignores: IgnoreStack,
+    depth: usize,
+}
+
+/// Per-thread job queues plus the count of jobs not yet finished
+struct WorkQueues {
+    queues: Vec<Mutex<VecDeque<ScanJob>>>,
+    /// Jobs queued or running; the scan is done when it reaches zero
+    pending: AtomicUsize,
+    stop: AtomicBool,
+}
+
+impl WorkQueues {
+    fn push(&self, worker: usize, job: ScanJob) {
+        self.pending.fetch_add(1, Ordering::SeqCst);
+        self.queues[worker].lock().unwrap().push_back(job);
+    }
+
+    /// The shallowest job from `worker`'s own queue, or else the deepest
+    /// from another's
+    fn pop(&self, worker: usize) -> Option<ScanJob> {
+        if let Some(job) = self.queues[worker].lock().unwrap().pop_front() {
+            return Some(job);
+        }
+        let count = self.queues.len();
+        (1..count).find_map(|offset| {
+            self.queues[(worker + offset) % count]
+                .lock()
+                .unwrap()
+                .pop_back()
+        })
+    }
+}
+
+/// Scan the subtrees under `roots` on a pool of threads, reporting listings
+/// in batches through `on_batch` (on the calling thread) until it returns
+/// false or the scan finishes.
+///
+/// Each root comes with the gitignore rules of its ancestors. A listing is
+/// always reported before the listings of its subdirectories.
+pub fn scan_directories(
+    roots: Vec<(PathBuf, IgnoreStack)>,
+    mut on_batch: impl FnMut(Vec<ScannedDir>) -> bool,
+) {
+    if roots.is_empty() {
+        return;
+    }
+
+    let threads = std::thread::available_parallelism().map_or(1, |n| n.get());
+    let work = WorkQueues {
+        queues: (0..threads).map(|_| Mutex::new(VecDeque::new())).collect(),
+        pending: AtomicUsize::new(0),
+        stop: AtomicBool::new(false),
+    };
+    for (i, (dir, ignores)) in roots.into_iter().enumerate() {
+        work.push(
+            i % threads,
+            ScanJob {
+                dir,
+                ignores,
+                depth: 0,
+            },
+        );
+    }
+
+    let (tx, rx) = mpsc::channel();
+    std::thread::scope(|scope| {
+        for worker in 0..threads {
+            let tx = tx.clone();
+            let work = &work;
+            scope.spawn(move || scan_worker(work, worker, tx));
+        }
+        drop(tx);
+
+        let mut batch = Vec::new();
+        let mut batch_started = Instant::now();
+        loop {
+            let wait = SCAN_BATCH_INTERVAL.saturating_sub(batch_started.elapsed());
+            let flush = match rx.recv_timeout(wait) {
+                Ok(listing) => {
+                    if batch.is_empty() {
+                        batch_started = Instant::now();
+                    }
+                    batch.push(listing);
+                    batch.len() >= SCAN_BATCH_DIRS || batch_started.elapsed() >= SCAN_BATCH_INTERVAL
+                }
+                Err(RecvTimeoutError::Timeout) => true,
+                Err(RecvTimeoutError::Disconnected) => break,
+            };
+            if flush && !batch.is_empty() && !work.stop.load(Ordering::Relaxed) {
+                if !on_batch(std::mem::take(&mut batch)) {
+                    work.stop.store(true, Ordering::Relaxed);
+                }
+                batch_started = Instant::now();
+            }
+        }
+        if !batch.is_empty() && !work.stop.load(Ordering::Relaxed) {
+            on_batch(batch);
+        }
+    });
+}
+
+fn scan_worker(work: &WorkQueues, worker: usize, tx: Sender<ScannedDir>) {
+    while !work.stop.load(Ordering::Relaxed) {
+        let Some(job) = work.pop(worker) else {
+            if work.pending.load(Ordering::SeqCst) == 0 {
+                break;
+            }
+            std::thread::sleep(IDLE_BACKOFF);
+            continue;
+        };
+
+        match read_directory(&job.dir, &job.ignores) {
+            Ok((listing, ignores)) => {
+                let subdirs: Vec<PathBuf> = if job.depth < MAX_SCAN_DEPTH {
+                    listing
+                        .children
+                        .iter()
+                        .filter(|node| node.is_dir)
+                        .map(|node| node.path.clone())
+                        .collect()
+                } else {
+                    Vec::new()
+                };
+                if tx.send(listing).is_err() {
+                    work.stop.store(true, Ordering::Relaxed);
+                }
+                for dir in subdirs {
+                    work.push(
+                        worker,
+                        ScanJob {
+                            dir,
+                            ignores: ignores.clone(),
+                            depth: job.depth + 1,
+                        },
+                    );
+                }
+            }
+            Err(e) => tracing::debug!("Skipping {}: {}", job.dir.display(), e),
+        }
+        // Children were queued first, so this can't drop to zero early
+        work.pending.fetch_sub(1, Ordering::SeqCst);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn ignored(gitignore: &str, path: &str, is_dir: bool) -> bool {
+        let base = Path::new("/repo");
+        let stack = IgnoreStack::default().with(Arc::new(GitIgnore::parse(base, gitignore)));
+        stack.is_ignored(&base.join(path), is_dir)
+    }
+
+    #[test]
+    fn test_glob_match() {
+        assert!(glob_match(b"*.log", b"debug.log"));
+        assert!(!glob_match(b"*.log", b"logs/debug.txt"));
+        assert!(!glob_match(b"*.log", b"a/debug.log"));
+        assert!(glob_match(b"a?c", b"abc"));
+        assert!(!glob_match(b"a?c", b"a/c"));
+        assert!(glob_match(b"**/build", b"build"));
+        assert!(glob_match(b"**/build", b"x/y/build"));
+        assert!(glob_match(b"docs/**", b"docs/a/b.md"));
+        assert!(glob_match(b"a/**/b", b"a/b"));
+        assert!(glob_match(b"a/**/b", b"a/x/y/b"));
+        assert!(glob_match(b"[abc].txt", b"b.txt"));
+        assert!(glob_match(b"file[0-9]", b"file7"));
+        assert!(!glob_match(b"file[!0-9]", b"file7"));
+        assert!(glob_match(b"[x", b"[x"));
+        assert!(glob_match(b"\\*x", b"*x"));
+        assert!(!glob_match(b"\\*x", b"ax"));
+    }
+
+    #[test]
+    fn test_gitignore_rules() {
+        let rules = "# comment\n*.log\n!keep.log\nbuild/\n/dist\ndocs/*.tmp\n";
+
+        assert!(ignored(rules, "debug.log", false));
+        assert!(ignored(rules, "src/trace.log", false));
+        assert!(!ignored(rules, "keep.log", false));
+        assert!(ignored(rules, "build", true));
+        assert!(ignored(rules, "src/build", true));
+        assert!(!ignored(rules, "build", false));
+        assert!(ignored(rules, "dist", true));
+        assert!(!ignored(rules, "src/dist", true));
+        assert!(ignored(rules, "docs/a.tmp", false));
+        assert!(!ignored(rules, "docs/sub/a.tmp", false));
+        assert!(!ignored(rules, "main.rs", false));
+    }
+
+    #[test]
+    fn test_deeper_gitignore_takes_precedence() {
+        let outer = Arc::new(GitIgnore::parse(Path::new("/repo"), "*.gen\n"));
+        let inner = Arc::new(GitIgnore::parse(Path::new("/repo/keep"), "!*.gen\n"));
+        let stack = IgnoreStack::default().with(outer).with(inner);
+
+        assert!(stack.is_ignored(Path::new("/repo/a.gen"), false));
+        assert!(!stack.is_ignored(Path::new("/repo/keep/a.gen"), false));
+    }
+}
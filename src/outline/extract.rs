@@ -3,6 +3,10 @@
 //! Walks the tree-sitter AST to extract structural symbols.
 //! Runs on the syntax worker thread.
 
+use std::borrow::Cow;
+use std::ops::Range;
+
+use ropey::Rope;
 use tree_sitter::{Node, Tree};
 
 use super::{OutlineData, OutlineKind, OutlineNode, OutlineRange};
@@ -11,64 +15,287 @@ use crate::syntax::LanguageId;
 /// Extract outline from a tree-sitter parse tree
 pub fn extract_outline(
     tree: &Tree,
-    source: &str,
+    source: &Rope,
     language: LanguageId,
     revision: u64,
 ) -> OutlineData {
-    let root = tree.root_node();
-
-    let nodes = match language {
-        LanguageId::Markdown => extract_markdown_headings(root, source),
-        LanguageId::Rust => {
-            let flat = extract_rust_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::TypeScript | LanguageId::Tsx | LanguageId::JavaScript | LanguageId::Jsx => {
-            let flat = extract_js_ts_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Python => {
-            let flat = extract_python_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Go => {
-            let flat = extract_go_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Java => {
-            let flat = extract_java_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Php => {
-            let flat = extract_php_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::C | LanguageId::Cpp => {
-            let flat = extract_c_cpp_symbols(root, source, language);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Yaml => {
-            let flat = extract_yaml_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Html => {
-            let flat = extract_html_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Blade => {
-            let flat = extract_blade_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        LanguageId::Vue => {
-            let flat = extract_vue_symbols(root, source);
-            build_tree_by_containment(flat)
-        }
-        _ => Vec::new(),
-    };
+    let mut symbols = Vec::new();
+    if has_outline(language) {
+        collect_symbols(tree.root_node(), source, language, &mut symbols);
+    }
 
     OutlineData {
         revision,
-        roots: nodes,
+        roots: build_outline(language, symbols),
+    }
+}
+
+/// Outline of one document kept between parses
+///
+/// Symbols are cached per child of the tree's root (top-level items in code,
+/// sections in Markdown). After an incremental parse, children that kept
+/// their extent, saw no edits and lie outside `Tree::changed_ranges` reuse
+/// their cached symbols; only the others are walked again.
+#[derive(Default)]
+pub struct OutlineCache {
+    state: Option<CachedOutline>,
+}
+
+struct CachedOutline {
+    language: LanguageId,
+    revision: u64,
+    /// Symbols of each root child, relative to the child's start; `None`
+    /// when the language's root can't be split into independent children
+    units: Option<Vec<Vec<FlatSymbol>>>,
+    roots: Vec<OutlineNode>,
+    /// Root children walked by the last update (the rest were reused)
+    #[cfg(test)]
+    extracted_units: usize,
+}
+
+impl OutlineCache {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Forget the cached outline, so the next update extracts and returns
+    /// the whole outline
+    pub fn invalidate(&mut self) {
+        self.state = None;
+    }
+
+    /// Bring the outline up to date with `tree` at `revision`.
+    ///
+    /// `previous` is the tree of the previous revision with the edits since
+    /// applied, as kept by the parser; symbols are reused only when it
+    /// belongs to the revision this cache was last updated at. Returns
+    /// `None` when the outline is the same as the one last returned.
+    pub fn update(
+        &mut self,
+        tree: &Tree,
+        previous: Option<(&Tree, u64)>,
+        source: &Rope,
+        language: LanguageId,
+        revision: u64,
+    ) -> Option<OutlineData> {
+        let root = tree.root_node();
+        let old = self.state.take().filter(|old| old.language == language);
+
+        let independent = has_outline(language) && units_are_independent(root, source, language);
+        let (units, symbols, extracted_units) = if independent {
+            let reusable =
+                old.as_ref()
+                    .zip(previous)
+                    .and_then(|(old, (prev_tree, prev_revision))| {
+                        let units = old.units.as_ref()?;
+                        (prev_revision == old.revision
+                            && prev_tree.root_node().child_count() == units.len())
+                        .then_some((prev_tree, units))
+                    });
+            let (units, extracted) = match reusable {
+                Some((prev_tree, old_units)) => {
+                    update_units(tree, prev_tree, source, language, old_units)
+                }
+                None => {
+                    let mut cursor = root.walk();
+                    let units: Vec<_> = root
+                        .children(&mut cursor)
+                        .map(|child| extract_unit(child, source, language))
+                        .collect();
+                    let count = units.len();
+                    (units, count)
+                }
+            };
+
+            let mut symbols = Vec::with_capacity(units.iter().map(Vec::len).sum());
+            let mut cursor = root.walk();
+            for (child, unit) in root.children(&mut cursor).zip(&units) {
+                symbols.extend(unit.iter().map(|sym| sym.rebased(&child)));
+            }
+            (Some(units), symbols, extracted)
+        } else {
+            // Nothing to key a cache on: extract everything, but still skip
+            // sending an unchanged outline
+            let mut symbols = Vec::new();
+            if has_outline(language) {
+                collect_symbols(root, source, language, &mut symbols);
+            }
+            (None, symbols, root.child_count())
+        };
+        let roots = build_outline(language, symbols);
+        tracing::trace!(
+            "Outline rev {} walked {} root children",
+            revision,
+            extracted_units
+        );
+
+        let changed = old.as_ref().map_or(true, |old| old.roots != roots);
+        let outline = changed.then(|| OutlineData {
+            revision,
+            roots: roots.clone(),
+        });
+        self.state = Some(CachedOutline {
+            language,
+            revision,
+            units,
+            roots,
+            #[cfg(test)]
+            extracted_units,
+        });
+        outline
+    }
+}
+
+/// Re-extract the root children of `tree` that differ from `prev_tree`,
+/// reusing `old_units` (aligned with `prev_tree`'s root children) for the
+/// rest. Returns the units and how many were extracted.
+fn update_units(
+    tree: &Tree,
+    prev_tree: &Tree,
+    source: &Rope,
+    language: LanguageId,
+    old_units: &[Vec<FlatSymbol>],
+) -> (Vec<Vec<FlatSymbol>>, usize) {
+    let changed: Vec<Range<usize>> = prev_tree
+        .changed_ranges(tree)
+        .map(|range| range.start_byte..range.end_byte)
+        .collect();
+
+    let prev_root = prev_tree.root_node();
+    let mut prev_cursor = prev_root.walk();
+    let old_children: Vec<Node> = prev_root.children(&mut prev_cursor).collect();
+
+    let root = tree.root_node();
+    let mut cursor = root.walk();
+    let mut units = Vec::with_capacity(root.child_count());
+    let mut extracted = 0;
+    let mut old_index = 0;
+    for child in root.children(&mut cursor) {
+        // Both child lists are in document order, in the same coordinates
+        while old_children
+            .get(old_index)
+            .is_some_and(|old| old.start_byte() < child.start_byte())
+        {
+            old_index += 1;
+        }
+        let unchanged = old_children.get(old_index).is_some_and(|old| {
+            old.start_byte() == child.start_byte()
+                && old.end_byte() == child.end_byte()
+                && old.kind_id() == child.kind_id()
+                && !old.has_changes()
+        }) && !changed
+            .iter()
+            .any(|range| range.start <= child.end_byte() && child.start_byte() <= range.end);
+
+        if unchanged {
+            units.push(old_units[old_index].clone());
+        } else {
+            units.push(extract_unit(child, source, language));
+            extracted += 1;
+        }
+    }
+    (units, extracted)
+}
+
+/// Whether outline extraction is implemented for `language`
+fn has_outline(language: LanguageId) -> bool {
+    matches!(
+        language,
+        LanguageId::Markdown
+            | LanguageId::Rust
+            | LanguageId::TypeScript
+            | LanguageId::Tsx
+            | LanguageId::JavaScript
+            | LanguageId::Jsx
+            | LanguageId::Python
+            | LanguageId::Go
+            | LanguageId::Java
+            | LanguageId::Php
+            | LanguageId::C
+            | LanguageId::Cpp
+            | LanguageId::Yaml
+            | LanguageId::Html
+            | LanguageId::Blade
+            | LanguageId::Vue
+    )
+}
+
+/// Whether extracting from each root child separately gives the same
+/// symbols as walking from the root, i.e. the root itself records nothing
+/// and its walk descends into every child
+fn units_are_independent(root: Node, source: &Rope, language: LanguageId) -> bool {
+    if language == LanguageId::Markdown {
+        return true;
+    }
+    let mut probe = Vec::new();
+    classify_node(root, source, language, &mut probe).is_none() && probe.is_empty()
+}
+
+/// Collect the symbols of `node`'s subtree (the node included)
+fn collect_symbols(node: Node, source: &Rope, language: LanguageId, symbols: &mut Vec<FlatSymbol>) {
+    if language == LanguageId::Markdown {
+        collect_headings_recursive(node, source, symbols);
+    } else {
+        walk_and_collect(node, source, symbols, &|node, source, symbols| {
+            classify_node(node, source, language, symbols)
+        });
+    }
+}
+
+/// Symbols of one root child, relative to its start
+fn extract_unit(node: Node, source: &Rope, language: LanguageId) -> Vec<FlatSymbol> {
+    let mut symbols = Vec::new();
+    if language == LanguageId::Markdown {
+        collect_heading_node(node, source, &mut symbols);
+    } else {
+        collect_symbols(node, source, language, &mut symbols);
+    }
+    for sym in &mut symbols {
+        sym.make_relative(&node);
+    }
+    symbols
+}
+
+/// Nest flat symbols: by heading level for Markdown, by range containment
+/// for code
+fn build_outline(language: LanguageId, symbols: Vec<FlatSymbol>) -> Vec<OutlineNode> {
+    if language == LanguageId::Markdown {
+        build_heading_tree(
+            symbols
+                .into_iter()
+                .map(|sym| match sym.kind {
+                    OutlineKind::Heading { level } => (level, sym.name, sym.range),
+                    _ => (1, sym.name, sym.range),
+                })
+                .collect(),
+        )
+    } else {
+        build_tree_by_containment(symbols)
+    }
+}
+
+/// Dispatch to the language's node classifier (see `walk_and_collect`)
+fn classify_node<'tree>(
+    node: Node<'tree>,
+    source: &Rope,
+    language: LanguageId,
+    symbols: &mut Vec<FlatSymbol>,
+) -> Option<Vec<Node<'tree>>> {
+    match language {
+        LanguageId::Rust => classify_rust_node(node, source, symbols),
+        LanguageId::TypeScript | LanguageId::Tsx | LanguageId::JavaScript | LanguageId::Jsx => {
+            classify_js_ts_node(node, source, symbols)
+        }
+        LanguageId::Python => classify_python_node(node, source, symbols),
+        LanguageId::Go => classify_go_node(node, source, symbols),
+        LanguageId::Java => classify_java_node(node, source, symbols),
+        LanguageId::Php => classify_php_node(node, source, symbols),
+        LanguageId::C | LanguageId::Cpp => classify_c_cpp_node(node, source, symbols, language),
+        LanguageId::Yaml => classify_yaml_node(node, source, symbols),
+        LanguageId::Html => classify_html_node(node, source, symbols),
+        LanguageId::Blade => classify_blade_node(node, source, symbols),
+        LanguageId::Vue => classify_vue_node(node, source, symbols),
+        _ => None,
     }
 }
 
@@ -76,6 +303,7 @@ pub fn extract_outline(
 // Flat symbol for pre-nesting
 // =============================================================================
 
+#[derive(Clone)]
 struct FlatSymbol {
     kind: OutlineKind,
     name: String,
@@ -84,6 +312,44 @@ struct FlatSymbol {
     range: OutlineRange,
 }
 
+impl FlatSymbol {
+    /// Re-express positions relative to the start of `unit`, an ancestor.
+    /// Columns are only relative on the unit's first line.
+    fn make_relative(&mut self, unit: &Node) {
+        let base = unit.start_position();
+        let base_byte = unit.start_byte();
+        self.start_byte -= base_byte;
+        self.end_byte -= base_byte;
+        if self.range.start_line == base.row {
+            self.range.start_col -= base.column;
+        }
+        if self.range.end_line == base.row {
+            self.range.end_col -= base.column;
+        }
+        self.range.start_line -= base.row;
+        self.range.end_line -= base.row;
+    }
+
+    /// Inverse of `make_relative` for the unit's current position
+    fn rebased(&self, unit: &Node) -> FlatSymbol {
+        let base = unit.start_position();
+        let base_byte = unit.start_byte();
+        let col = |line: usize, col: usize| if line == 0 { base.column + col } else { col };
+        FlatSymbol {
+            kind: self.kind,
+            name: self.name.clone(),
+            start_byte: base_byte + self.start_byte,
+            end_byte: base_byte + self.end_byte,
+            range: OutlineRange {
+                start_line: base.row + self.range.start_line,
+                start_col: col(self.range.start_line, self.range.start_col),
+                end_line: base.row + self.range.end_line,
+                end_col: col(self.range.end_line, self.range.end_col),
+            },
+        }
+    }
+}
+
 fn node_range(node: &Node) -> OutlineRange {
     let start = node.start_position();
     let end = node.end_position();
@@ -117,32 +383,26 @@ fn flat_sym(kind: OutlineKind, name: &str, node: &Node) -> FlatSymbol {
 // Markdown: level-based heading hierarchy
 // =============================================================================
 
-fn extract_markdown_headings(root: Node, source: &str) -> Vec<OutlineNode> {
-    let mut headings: Vec<(u8, String, OutlineRange)> = Vec::new();
-    collect_headings_recursive(root, source, &mut headings);
-    build_heading_tree(headings)
-}
-
-fn collect_headings_recursive(
-    node: Node,
-    source: &str,
-    headings: &mut Vec<(u8, String, OutlineRange)>,
-) {
+fn collect_headings_recursive(node: Node, source: &Rope, headings: &mut Vec<FlatSymbol>) {
     let mut cursor = node.walk();
     for child in node.children(&mut cursor) {
-        if child.kind() == "atx_heading" || child.kind() == "setext_heading" {
-            if let Some((level, text)) = parse_heading(&child, source) {
-                headings.push((level, text, node_range(&child)));
-            }
-        }
-        // Recurse into section nodes (tree-sitter-markdown wraps in sections)
-        if child.kind() == "section" || child.kind() == "document" {
-            collect_headings_recursive(child, source, headings);
+        collect_heading_node(child, source, headings);
+    }
+}
+
+fn collect_heading_node(node: Node, source: &Rope, headings: &mut Vec<FlatSymbol>) {
+    if node.kind() == "atx_heading" || node.kind() == "setext_heading" {
+        if let Some((level, text)) = parse_heading(&node, source) {
+            headings.push(flat_sym(OutlineKind::Heading { level }, &text, &node));
         }
     }
+    // Recurse into section nodes (tree-sitter-markdown wraps in sections)
+    if node.kind() == "section" || node.kind() == "document" {
+        collect_headings_recursive(node, source, headings);
+    }
 }
 
-fn parse_heading(node: &Node, source: &str) -> Option<(u8, String)> {
+fn parse_heading(node: &Node, source: &Rope) -> Option<(u8, String)> {
     if node.kind() == "atx_heading" {
         let mut level = 1u8;
         let mut text = String::new();
@@ -301,9 +561,9 @@ fn build_tree_by_containment(mut symbols: Vec<FlatSymbol>) -> Vec<OutlineNode> {
 // Shared recursive walking driver
 // =============================================================================
 //
-// Every language's `extract_X_symbols` walks the tree-sitter AST the same
-// way: visit a node, let the language decide what (if anything) to record,
-// then recurse into children. The only per-language variation is:
+// Every code language's outline walks the tree-sitter AST the same way:
+// visit a node, let the language decide what (if anything) to record, then
+// recurse into children. The only per-language variation is:
 //   1. which node kinds produce a `FlatSymbol`, and
 //   2. occasionally, which subset of children to recurse into (e.g. Python
 //      skips decorator nodes so nested decls inside decorator arguments
@@ -317,9 +577,9 @@ fn build_tree_by_containment(mut symbols: Vec<FlatSymbol>) -> Vec<OutlineNode> {
 //     be empty, effectively stopping descent into `node`).
 fn walk_and_collect<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
-    classify: &impl Fn(Node<'tree>, &str, &mut Vec<FlatSymbol>) -> Option<Vec<Node<'tree>>>,
+    classify: &impl Fn(Node<'tree>, &Rope, &mut Vec<FlatSymbol>) -> Option<Vec<Node<'tree>>>,
 ) {
     let next_children = classify(node, source, symbols);
 
@@ -342,43 +602,37 @@ fn walk_and_collect<'tree>(
 // Rust symbol extraction
 // =============================================================================
 
-fn extract_rust_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_rust_node);
-    symbols
-}
-
 fn classify_rust_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
         "function_item" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Function, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Function, &name, &node));
                 }
             }
         }
         "struct_item" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Struct, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Struct, &name, &node));
                 }
             }
         }
         "enum_item" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Enum, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Enum, &name, &node));
                 }
             }
         }
         "enum_variant" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::EnumVariant, name, &node));
+                    symbols.push(flat_sym(OutlineKind::EnumVariant, &name, &node));
                 }
             }
         }
@@ -401,28 +655,28 @@ fn classify_rust_node<'tree>(
         "trait_item" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Trait, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Trait, &name, &node));
                 }
             }
         }
         "const_item" | "static_item" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Constant, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Constant, &name, &node));
                 }
             }
         }
         "mod_item" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Module, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Module, &name, &node));
                 }
             }
         }
         "field_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Field, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Field, &name, &node));
                 }
             }
         }
@@ -436,64 +690,58 @@ fn classify_rust_node<'tree>(
 // TypeScript/JavaScript symbol extraction
 // =============================================================================
 
-fn extract_js_ts_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_js_ts_node);
-    symbols
-}
-
 fn classify_js_ts_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
         "function_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Function, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Function, &name, &node));
                 }
             }
         }
         "class_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Class, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Class, &name, &node));
                 }
             }
         }
         "method_definition" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Method, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Method, &name, &node));
                 }
             }
         }
         "interface_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Interface, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Interface, &name, &node));
                 }
             }
         }
         "type_alias_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Interface, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Interface, &name, &node));
                 }
             }
         }
         "enum_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Enum, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Enum, &name, &node));
                 }
             }
         }
         "public_field_definition" | "property_signature" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Property, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Property, &name, &node));
                 }
             }
         }
@@ -512,7 +760,7 @@ fn classify_js_ts_node<'tree>(
                             } else {
                                 OutlineKind::Constant
                             };
-                            symbols.push(flat_sym(kind, name, &node));
+                            symbols.push(flat_sym(kind, &name, &node));
                         }
                     }
                 }
@@ -536,29 +784,23 @@ fn classify_js_ts_node<'tree>(
 // Python symbol extraction
 // =============================================================================
 
-fn extract_python_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_python_node);
-    symbols
-}
-
 fn classify_python_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
         "function_definition" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Function, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Function, &name, &node));
                 }
             }
         }
         "class_definition" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Class, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Class, &name, &node));
                 }
             }
         }
@@ -580,29 +822,23 @@ fn classify_python_node<'tree>(
 // Go symbol extraction
 // =============================================================================
 
-fn extract_go_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_go_node);
-    symbols
-}
-
 fn classify_go_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
         "function_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Function, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Function, &name, &node));
                 }
             }
         }
         "method_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Method, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Method, &name, &node));
                 }
             }
         }
@@ -618,7 +854,7 @@ fn classify_go_node<'tree>(
                                 Some("interface_type") => OutlineKind::Interface,
                                 _ => OutlineKind::Interface,
                             };
-                            symbols.push(flat_sym(kind, name, &child));
+                            symbols.push(flat_sym(kind, &name, &child));
                         }
                     }
                 }
@@ -630,7 +866,7 @@ fn classify_go_node<'tree>(
                 if child.kind() == "const_spec" || child.kind() == "var_spec" {
                     if let Some(name_node) = child_by_field(&child, "name") {
                         if let Some(name) = node_name(&name_node, source) {
-                            symbols.push(flat_sym(OutlineKind::Constant, name, &child));
+                            symbols.push(flat_sym(OutlineKind::Constant, &name, &child));
                         }
                     }
                 }
@@ -646,43 +882,37 @@ fn classify_go_node<'tree>(
 // Java symbol extraction
 // =============================================================================
 
-fn extract_java_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_java_node);
-    symbols
-}
-
 fn classify_java_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
         "class_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Class, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Class, &name, &node));
                 }
             }
         }
         "interface_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Interface, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Interface, &name, &node));
                 }
             }
         }
         "enum_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Enum, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Enum, &name, &node));
                 }
             }
         }
         "method_declaration" | "constructor_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Method, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Method, &name, &node));
                 }
             }
         }
@@ -692,7 +922,7 @@ fn classify_java_node<'tree>(
                 if child.kind() == "variable_declarator" {
                     if let Some(name_node) = child_by_field(&child, "name") {
                         if let Some(name) = node_name(&name_node, source) {
-                            symbols.push(flat_sym(OutlineKind::Field, name, &node));
+                            symbols.push(flat_sym(OutlineKind::Field, &name, &node));
                         }
                     }
                 }
@@ -708,57 +938,51 @@ fn classify_java_node<'tree>(
 // PHP symbol extraction
 // =============================================================================
 
-fn extract_php_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_php_node);
-    symbols
-}
-
 fn classify_php_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
         "class_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Class, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Class, &name, &node));
                 }
             }
         }
         "function_definition" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Function, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Function, &name, &node));
                 }
             }
         }
         "method_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Method, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Method, &name, &node));
                 }
             }
         }
         "interface_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Interface, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Interface, &name, &node));
                 }
             }
         }
         "trait_declaration" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Trait, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Trait, &name, &node));
                 }
             }
         }
         "namespace_definition" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Namespace, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Namespace, &name, &node));
                 }
             }
         }
@@ -772,17 +996,9 @@ fn classify_php_node<'tree>(
 // C/C++ symbol extraction
 // =============================================================================
 
-fn extract_c_cpp_symbols(root: Node, source: &str, language: LanguageId) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &|node, source, symbols| {
-        classify_c_cpp_node(node, source, symbols, language)
-    });
-    symbols
-}
-
 fn classify_c_cpp_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
     language: LanguageId,
 ) -> Option<Vec<Node<'tree>>> {
@@ -797,28 +1013,28 @@ fn classify_c_cpp_node<'tree>(
         "struct_specifier" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Struct, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Struct, &name, &node));
                 }
             }
         }
         "enum_specifier" => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Enum, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Enum, &name, &node));
                 }
             }
         }
         "class_specifier" if language == LanguageId::Cpp => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Class, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Class, &name, &node));
                 }
             }
         }
         "namespace_definition" if language == LanguageId::Cpp => {
             if let Some(name_node) = child_by_field(&node, "name") {
                 if let Some(name) = node_name(&name_node, source) {
-                    symbols.push(flat_sym(OutlineKind::Namespace, name, &node));
+                    symbols.push(flat_sym(OutlineKind::Namespace, &name, &node));
                 }
             }
         }
@@ -828,7 +1044,7 @@ fn classify_c_cpp_node<'tree>(
     None
 }
 
-fn extract_c_function_name(declarator: &Node, source: &str) -> Option<String> {
+fn extract_c_function_name(declarator: &Node, source: &Rope) -> Option<String> {
     match declarator.kind() {
         "function_declarator" => {
             if let Some(name_node) = child_by_field(declarator, "declarator") {
@@ -852,15 +1068,9 @@ fn extract_c_function_name(declarator: &Node, source: &str) -> Option<String> {
 // YAML symbol extraction
 // =============================================================================
 
-fn extract_yaml_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_yaml_node);
-    symbols
-}
-
 fn classify_yaml_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
@@ -891,15 +1101,9 @@ const HTML_OUTLINE_TAGS: &[&str] = &[
     "fieldset", "figure", "template", "slot",
 ];
 
-fn extract_html_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_html_node);
-    symbols
-}
-
 fn classify_html_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     if node.kind() == "element" {
@@ -926,7 +1130,7 @@ fn classify_html_node<'tree>(
 }
 
 /// Build a display label like `div#app` or `section.hero` from attributes
-fn html_element_label(tag_name: &str, start_tag: &Node, source: &str) -> String {
+fn html_element_label(tag_name: &str, start_tag: &Node, source: &Rope) -> String {
     let mut id = None;
     let mut class = None;
 
@@ -943,11 +1147,11 @@ fn html_element_label(tag_name: &str, start_tag: &Node, source: &str) -> String
             .children(&mut attr.walk())
             .find(|c| c.kind() == "quoted_attribute_value" || c.kind() == "attribute_value")
             .and_then(|n| node_name(&n, source))
-            .map(|v| v.trim_matches('"').trim_matches('\''));
+            .map(|v| v.trim_matches('"').trim_matches('\'').to_string());
 
-        match attr_name {
-            Some("id") => id = attr_val.map(|s| s.to_string()),
-            Some("class") => class = attr_val.map(|s| s.to_string()),
+        match attr_name.as_deref() {
+            Some("id") => id = attr_val,
+            Some("class") => class = attr_val,
             _ => {}
         }
     }
@@ -1004,15 +1208,9 @@ const BLADE_OUTLINE_DIRECTIVES: &[&str] = &[
     "assets",
 ];
 
-fn extract_blade_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_blade_node);
-    symbols
-}
-
 fn classify_blade_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
@@ -1071,14 +1269,14 @@ fn classify_blade_node<'tree>(
 /// Extract the directive identifier from a node's raw text by scanning for `@`.
 /// Returns just the identifier (e.g. "section", "foreach") without the `@` prefix.
 /// This is robust against node ranges that include leading whitespace or control characters.
-fn blade_directive_ident(node: &Node, source: &str) -> Option<String> {
+fn blade_directive_ident(node: &Node, source: &Rope) -> Option<String> {
     let mut cursor = node.walk();
     let raw = node
         .children(&mut cursor)
         .find(|c| c.kind() == "directive_start" || c.kind() == "directive")
         .and_then(|d| node_name(&d, source))?;
 
-    parse_directive_ident(raw)
+    parse_directive_ident(&raw)
 }
 
 /// Parse a directive identifier from raw node text.
@@ -1096,7 +1294,7 @@ fn parse_directive_ident(raw: &str) -> Option<String> {
 }
 
 /// Build a display label for a directive node, e.g. `@section('content')` or `@verbatim`.
-fn blade_directive_label(node: &Node, source: &str) -> String {
+fn blade_directive_label(node: &Node, source: &Rope) -> String {
     let ident = blade_directive_ident(node, source).unwrap_or_else(|| "?".to_string());
     let directive = format!("@{}", ident);
 
@@ -1127,15 +1325,9 @@ fn blade_directive_label(node: &Node, source: &str) -> String {
 // Vue SFC symbol extraction
 // =============================================================================
 
-fn extract_vue_symbols(root: Node, source: &str) -> Vec<FlatSymbol> {
-    let mut symbols = Vec::new();
-    walk_and_collect(root, source, &mut symbols, &classify_vue_node);
-    symbols
-}
-
 fn classify_vue_node<'tree>(
     node: Node<'tree>,
-    source: &str,
+    source: &Rope,
     symbols: &mut Vec<FlatSymbol>,
 ) -> Option<Vec<Node<'tree>>> {
     match node.kind() {
@@ -1160,7 +1352,7 @@ fn classify_vue_node<'tree>(
 }
 
 /// Get the tag name from an HTML element node (element, script_element, style_element)
-fn vue_element_tag_name(node: Node, source: &str) -> Option<String> {
+fn vue_element_tag_name(node: Node, source: &Rope) -> Option<String> {
     let mut cursor = node.walk();
     for child in node.children(&mut cursor) {
         if child.kind() == "start_tag" {
@@ -1178,6 +1370,8 @@ fn vue_element_tag_name(node: Node, source: &str) -> Option<String> {
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::model::editor_area::DocumentId;
+    use crate::syntax::ParserState;
 
     #[test]
     fn test_heading_tree_basic() {
@@ -1356,4 +1550,85 @@ mod tests {
         // Empty after @
         assert_eq!(parse_directive_ident("@"), None);
     }
+
+    fn parse(source: &str, language: LanguageId, revision: u64) -> ParserState {
+        let mut state = ParserState::new();
+        state.parse_and_highlight(source, language, DocumentId(1), revision);
+        state
+    }
+
+    /// Update `cache` from the tree `state` holds for the test document
+    fn update(
+        cache: &mut OutlineCache,
+        state: &ParserState,
+        source: &str,
+        language: LanguageId,
+        revision: u64,
+    ) -> Option<OutlineData> {
+        let (tree, _) = state.get_cached_tree(DocumentId(1)).unwrap();
+        let previous = state.get_previous_tree(DocumentId(1));
+        cache.update(tree, previous, &Rope::from_str(source), language, revision)
+    }
+
+    fn extracted_units(cache: &OutlineCache) -> usize {
+        cache
+            .state
+            .as_ref()
+            .map_or(0, |state| state.extracted_units)
+    }
+
+    #[test]
+    fn test_incremental_outline_reuses_unchanged_items() {
+        let v1 = "struct A {\n    a: u8,\n}\n\nfn one() {\n    let x = 1;\n}\n\nimpl A {\n    fn two(&self) {}\n}\n";
+        let mut state = parse(v1, LanguageId::Rust, 1);
+        let mut cache = OutlineCache::new();
+        let first = update(&mut cache, &state, v1, LanguageId::Rust, 1).unwrap();
+        assert_eq!(first.roots.len(), 3);
+
+        // Editing a function body re-walks that item only, and the outline
+        // is unchanged
+        let v2 = v1.replace("let x = 1;", "let x = 12;");
+        state.parse_and_highlight(&v2, LanguageId::Rust, DocumentId(1), 2);
+        assert!(update(&mut cache, &state, &v2, LanguageId::Rust, 2).is_none());
+        assert_eq!(extracted_units(&cache), 1);
+
+        // Inserting a line moves later items; their cached symbols are
+        // re-based, and the result matches a full extraction
+        let v3 = v2.replace("fn one() {", "// one\nfn one() {");
+        state.parse_and_highlight(&v3, LanguageId::Rust, DocumentId(1), 3);
+        let outline = update(&mut cache, &state, &v3, LanguageId::Rust, 3).unwrap();
+        assert!(extracted_units(&cache) < 4);
+        let (tree, _) = state.get_cached_tree(DocumentId(1)).unwrap();
+        let full = extract_outline(tree, &Rope::from_str(&v3), LanguageId::Rust, 3);
+        assert_eq!(outline.roots, full.roots);
+        assert_eq!(outline.roots[2].children[0].name, "two");
+        assert_eq!(outline.roots[2].children[0].range.start_line, 10);
+
+        // Renaming a symbol is picked up
+        let v4 = v3.replace("fn two", "fn three");
+        state.parse_and_highlight(&v4, LanguageId::Rust, DocumentId(1), 4);
+        let outline = update(&mut cache, &state, &v4, LanguageId::Rust, 4).unwrap();
+        assert_eq!(outline.roots[2].children[0].name, "three");
+    }
+
+    #[test]
+    fn test_incremental_outline_falls_back_without_matching_previous_tree() {
+        let v1 = "# Title\n\n## One\n\ntext\n";
+        let mut state = parse(v1, LanguageId::Markdown, 1);
+        let mut cache = OutlineCache::new();
+        update(&mut cache, &state, v1, LanguageId::Markdown, 1).unwrap();
+
+        // Two parses since the cache's revision: nothing can be reused
+        let v2 = v1.replace("text", "more text");
+        state.parse_and_highlight(&v2, LanguageId::Markdown, DocumentId(1), 2);
+        let v3 = v2.replace("## One", "## Two");
+        state.parse_and_highlight(&v3, LanguageId::Markdown, DocumentId(1), 3);
+        let outline = update(&mut cache, &state, &v3, LanguageId::Markdown, 3).unwrap();
+        assert_eq!(outline.roots[0].children[0].name, "Two");
+
+        // Invalidation forces the outline to be returned again
+        assert!(update(&mut cache, &state, &v3, LanguageId::Markdown, 3).is_none());
+        cache.invalidate();
+        assert!(update(&mut cache, &state, &v3, LanguageId::Markdown, 3).is_some());
+    }
 }
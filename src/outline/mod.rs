@@ -5,7 +5,7 @@
 
 mod extract;
 
-pub use extract::extract_outline;
+pub use extract::{extract_outline, OutlineCache};
 
 /// Symbol kind for display and categorization
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
@@ -72,7 +72,7 @@ pub struct OutlineRange {
 }
 
 /// A single node in the outline tree
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, PartialEq, Eq)]
 pub struct OutlineNode {
     pub kind: OutlineKind,
     pub name: String,
@@ -57,6 +57,7 @@ pub enum PanelId {
     TaskRunner,
     AiChat,
     TodoList,
+    Search,
 }
 
 impl PanelId {
@@ -66,6 +67,7 @@ impl PanelId {
     pub const TASK_RUNNER: PanelId = PanelId::TaskRunner;
     pub const AI_CHAT: PanelId = PanelId::AiChat;
     pub const TODO_LIST: PanelId = PanelId::TodoList;
+    pub const SEARCH: PanelId = PanelId::Search;
 
     /// Get the display name for this panel
     pub fn display_name(&self) -> &'static str {
@@ -76,6 +78,7 @@ impl PanelId {
             PanelId::TaskRunner => "Tasks",
             PanelId::AiChat => "Chat",
             PanelId::TodoList => "TODOs",
+            PanelId::Search => "Search",
         }
     }
 
@@ -84,7 +87,9 @@ impl PanelId {
         match self {
             PanelId::FileExplorer => DockPosition::Left,
             PanelId::Outline => DockPosition::Right,
-            PanelId::Terminal | PanelId::TaskRunner | PanelId::TodoList => DockPosition::Bottom,
+            PanelId::Terminal | PanelId::TaskRunner | PanelId::TodoList | PanelId::Search => {
+                DockPosition::Bottom
+            }
             PanelId::AiChat => DockPosition::Right,
         }
     }
@@ -231,6 +236,7 @@ impl Default for DockLayout {
         layout.left.register_panel(PanelId::FILE_EXPLORER);
         layout.right.register_panel(PanelId::OUTLINE);
         layout.bottom.register_panel(PanelId::TERMINAL);
+        layout.bottom.register_panel(PanelId::SEARCH);
 
         // Left dock (file explorer) is open by default
         layout.left.is_open = true;
@@ -265,6 +271,15 @@ impl DockLayout {
             .find(|&pos| self.dock(pos).panel_ids.contains(&panel_id))
     }
 
+    /// The dock showing a panel: one it is registered to, open, with the
+    /// panel as its active tab
+    pub fn showing_panel(&self, panel_id: PanelId) -> Option<DockPosition> {
+        self.find_panel(panel_id).filter(|&pos| {
+            let dock = self.dock(pos);
+            dock.is_open && dock.active_panel() == Some(panel_id)
+        })
+    }
+
     /// Focus-then-toggle logic for panel keybindings (Cmd+1, Cmd+7, etc.)
     ///
     /// Behavior:
@@ -349,6 +364,7 @@ mod tests {
         );
         assert_eq!(PanelId::TERMINAL.default_position(), DockPosition::Bottom);
         assert_eq!(PanelId::OUTLINE.default_position(), DockPosition::Right);
+        assert_eq!(PanelId::SEARCH.default_position(), DockPosition::Bottom);
     }
 
     #[test]
@@ -1,8 +1,19 @@
 //! Terminal dock panel rendering helpers.
-
-use alacritty_terminal::grid::Dimensions;
+//!
+//! The panel is drawn one row band at a time. Each band is keyed by a hash
+//! of what it shows, so bands are reused from the [`LineRenderCache`] when
+//! the same row content reappears (output scrolling up the screen), and
+//! when only the terminal is damaged ([`render_terminal_rows`]) rows whose
+//! key matches what was last drawn at their position are skipped.
+//!
+//! [`LineRenderCache`]: crate::view::line_cache::LineRenderCache
+
+use std::collections::hash_map::DefaultHasher;
+use std::hash::{Hash, Hasher};
+
+use alacritty_terminal::grid::{Dimensions, Grid};
 use alacritty_terminal::index::{Column, Line};
-use alacritty_terminal::term::cell::Flags;
+use alacritty_terminal::term::cell::{Cell, Flags};
 use alacritty_terminal::vte::ansi::{Color as AnsiColor, NamedColor};
 
 use crate::model::editor_area::Rect;
@@ -40,7 +51,7 @@ pub enum TerminalColorRole {
     Background,
 }
 
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, Hash)]
 pub struct TerminalPalette {
     pub default_fg: u32,
     pub default_bg: u32,
@@ -63,6 +74,48 @@ struct TerminalRenderContext<'a> {
     palette: &'a TerminalPalette,
 }
 
+/// What the visible rows of a session show, resolved once per frame
+struct TerminalViewport<'g> {
+    grid: &'g Grid<Cell>,
+    rows: usize,
+    cols: usize,
+    scroll_offset: usize,
+    /// Oldest addressable line: history lines sit *above* the screen and
+    /// are addressed with negative `Line` indices in alacritty.
+    topmost_line: i32,
+    /// View row and column of the cursor, when it is on screen
+    cursor: Option<(usize, usize)>,
+    indicator: Option<String>,
+}
+
+impl TerminalViewport<'_> {
+    /// Grid line shown at view `row`, or `None` past the top of history
+    fn grid_line(&self, row: usize) -> Option<i32> {
+        let grid_line = terminal_view_row_to_grid_line(row, self.scroll_offset);
+        (grid_line >= self.topmost_line).then_some(grid_line)
+    }
+
+    fn cursor_col(&self, row: usize) -> Option<usize> {
+        self.cursor
+            .filter(|&(cursor_row, _)| cursor_row == row)
+            .map(|(_, col)| col)
+    }
+
+    /// Scrollback indicator drawn over `row`, which is always the top one
+    fn indicator(&self, row: usize) -> Option<&str> {
+        self.indicator.as_deref().filter(|_| row == 0)
+    }
+}
+
+/// Pixel band a view row is drawn into
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct TerminalRowBand {
+    x: usize,
+    y: usize,
+    width: usize,
+    height: usize,
+}
+
 impl TerminalPalette {
     pub fn from_model(model: &AppModel) -> Self {
         let theme = &model.theme.sidebar;
@@ -122,9 +175,34 @@ pub fn render_terminal_panel(
     painter: &mut TextPainter,
     model: &AppModel,
     rect: Rect,
+) {
+    render_terminal(frame, painter, model, rect, false);
+}
+
+/// Redraw only the rows of the terminal panel at `rect` whose content
+/// changed since they were last drawn there, leaving the rest of the
+/// panel as the back buffer holds it. Without a line cache every row is
+/// redrawn.
+pub fn render_terminal_rows(
+    frame: &mut Frame,
+    painter: &mut TextPainter,
+    model: &AppModel,
+    rect: Rect,
+) {
+    render_terminal(frame, painter, model, rect, true);
+}
+
+fn render_terminal(
+    frame: &mut Frame,
+    painter: &mut TextPainter,
+    model: &AppModel,
+    rect: Rect,
+    only_changed: bool,
 ) {
     let palette = TerminalPalette::from_model(model);
-    frame.fill_rect(rect, palette.default_bg);
+    if !only_changed {
+        frame.fill_rect(rect, palette.default_bg);
+    }
 
     let Some(session) = model.terminal.active_session() else {
         return;
@@ -132,19 +210,13 @@ pub fn render_terminal_panel(
 
     frame.set_clip(rect);
 
-    let term = session.term();
-    let grid = term.grid();
     let line_height = painter.line_height();
     let char_width = painter.char_width();
-    let visible_size = grid_size_for_rect(rect, char_width, line_height);
-    let rows = usize::from(visible_size.rows).min(grid.screen_lines());
-    let cols = usize::from(visible_size.cols).min(grid.columns());
-
-    // Clamp scrollback offset to the available history so it can never
-    // scroll past the top of the buffer.
-    let max_offset = grid.total_lines().saturating_sub(grid.screen_lines());
-    let scroll_offset = session.scroll_offset.min(max_offset);
-
+    let viewport = terminal_viewport(
+        session.term().grid(),
+        session.scroll_offset,
+        grid_size_for_rect(rect, char_width, line_height),
+    );
     let ctx = TerminalRenderContext {
         rect,
         char_width,
@@ -152,34 +224,154 @@ pub fn render_terminal_panel(
         palette: &palette,
     };
 
-    // Oldest addressable line: history lines sit *above* the screen and are
-    // addressed with negative `Line` indices in alacritty.
-    let topmost_line = grid.screen_lines() as i32 - grid.total_lines() as i32;
+    let style_key = painter
+        .has_line_cache()
+        .then(|| row_style_key(&ctx, painter));
+
+    for row in 0..viewport.rows {
+        let band = terminal_row_band(&ctx, frame, row);
+        let key = style_key.map(|style_key| row_key(style_key, &viewport, &palette, row));
 
-    for row in 0..rows {
-        let grid_line = terminal_view_row_to_grid_line(row, scroll_offset);
-        if grid_line < topmost_line {
-            continue;
+        if let (Some(key), Some(cache)) = (key, painter.line_cache_mut()) {
+            if only_changed && cache.drawn_at(band.x, band.y) == Some(key) {
+                continue;
+            }
+            if cache.blit(key, frame, band.x, band.y, band.width, band.height) {
+                cache.mark_drawn(band.x, band.y, key);
+                continue;
+            }
         }
-        for col in 0..cols {
-            let cell = &grid[Line(grid_line)][Column(col)];
-            render_terminal_cell(frame, painter, &ctx, row, col, cell);
+
+        render_terminal_row(frame, painter, &ctx, &viewport, row, band);
+
+        if let (Some(key), Some(cache)) = (key, painter.line_cache_mut()) {
+            cache.store(key, frame, band.x, band.y, band.width, band.height);
+            cache.mark_drawn(band.x, band.y, key);
         }
     }
 
-    render_terminal_cursor(frame, painter, &ctx, rows, cols, grid, scroll_offset);
-    render_scrollback_indicator(frame, painter, &ctx, scroll_offset, max_offset);
-
     frame.clear_clip();
 }
 
+/// Resolve the rows, columns, scroll position and cursor shown for `grid`
+/// in a panel of `visible_size` cells
+fn terminal_viewport(
+    grid: &Grid<Cell>,
+    scroll_offset: usize,
+    visible_size: TerminalGridSize,
+) -> TerminalViewport<'_> {
+    let rows = usize::from(visible_size.rows).min(grid.screen_lines());
+    let cols = usize::from(visible_size.cols).min(grid.columns());
+
+    // Clamp scrollback offset to the available history so it can never
+    // scroll past the top of the buffer.
+    let max_offset = grid.total_lines().saturating_sub(grid.screen_lines());
+    let scroll_offset = scroll_offset.min(max_offset);
+
+    TerminalViewport {
+        grid,
+        rows,
+        cols,
+        scroll_offset,
+        topmost_line: grid.screen_lines() as i32 - grid.total_lines() as i32,
+        cursor: cursor_view_position(grid, rows, cols, scroll_offset),
+        indicator: scrollback_indicator_text(scroll_offset, max_offset),
+    }
+}
+
+fn terminal_row_band(
+    ctx: &TerminalRenderContext<'_>,
+    frame: &Frame,
+    row: usize,
+) -> TerminalRowBand {
+    let x = ctx.rect.x.max(0.0) as usize;
+    let right = ((ctx.rect.x + ctx.rect.width).max(0.0) as usize).min(frame.width());
+    TerminalRowBand {
+        x,
+        y: (ctx.rect.y + (row * ctx.line_height) as f32).max(0.0) as usize,
+        width: right.saturating_sub(x),
+        height: ctx.line_height.max(1),
+    }
+}
+
+/// Hash of the palette, font and panel geometry every row band depends on
+fn row_style_key(ctx: &TerminalRenderContext<'_>, painter: &TextPainter) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    "terminal".hash(&mut hasher);
+    ctx.palette.hash(&mut hasher);
+    painter.font_size().to_bits().hash(&mut hasher);
+    ctx.char_width.to_bits().hash(&mut hasher);
+    ctx.line_height.hash(&mut hasher);
+    // Cells are positioned from the fractional panel origin
+    ctx.rect.x.fract().to_bits().hash(&mut hasher);
+    ctx.rect.y.fract().to_bits().hash(&mut hasher);
+    ctx.rect.width.to_bits().hash(&mut hasher);
+    hasher.finish()
+}
+
+/// Hash of everything view `row` draws: its cells' characters, resolved
+/// colours and attributes, the cursor and the scrollback indicator. Rows
+/// showing the same content get the same key wherever they are on screen.
+fn row_key(
+    style_key: u64,
+    viewport: &TerminalViewport<'_>,
+    palette: &TerminalPalette,
+    row: usize,
+) -> u64 {
+    let mut hasher = DefaultHasher::new();
+    style_key.hash(&mut hasher);
+    if let Some(grid_line) = viewport.grid_line(row) {
+        let line = &viewport.grid[Line(grid_line)];
+        for col in 0..viewport.cols {
+            let cell = &line[Column(col)];
+            cell.c.hash(&mut hasher);
+            cell_colors(cell, palette).hash(&mut hasher);
+            cell.flags.bits().hash(&mut hasher);
+        }
+    }
+    viewport.cursor_col(row).hash(&mut hasher);
+    viewport.indicator(row).hash(&mut hasher);
+    hasher.finish()
+}
+
+fn render_terminal_row(
+    frame: &mut Frame,
+    painter: &mut TextPainter,
+    ctx: &TerminalRenderContext<'_>,
+    viewport: &TerminalViewport<'_>,
+    row: usize,
+    band: TerminalRowBand,
+) {
+    frame.fill_rect_px(
+        band.x,
+        band.y,
+        band.width,
+        band.height,
+        ctx.palette.default_bg,
+    );
+
+    if let Some(grid_line) = viewport.grid_line(row) {
+        let line = &viewport.grid[Line(grid_line)];
+        for col in 0..viewport.cols {
+            render_terminal_cell(frame, painter, ctx, row, col, &line[Column(col)]);
+        }
+    }
+
+    if let Some(col) = viewport.cursor_col(row) {
+        render_terminal_cursor(frame, painter, ctx, viewport.grid, row, col);
+    }
+    if let Some(text) = viewport.indicator(row) {
+        render_scrollback_indicator(frame, painter, ctx, text);
+    }
+}
+
 fn render_terminal_cell(
     frame: &mut Frame,
     painter: &mut TextPainter,
     ctx: &TerminalRenderContext<'_>,
     row: usize,
     col: usize,
-    cell: &alacritty_terminal::term::cell::Cell,
+    cell: &Cell,
 ) {
     let skip_glyph = cell.flags.contains(Flags::WIDE_CHAR_SPACER | Flags::HIDDEN);
     let (fg, bg) = cell_colors(cell, ctx.palette);
@@ -208,36 +400,38 @@ fn render_terminal_cell(
     render_cell_decorations(frame, &cell_rect, fg, decorations);
 }
 
-fn render_terminal_cursor(
-    frame: &mut Frame,
-    painter: &mut TextPainter,
-    ctx: &TerminalRenderContext<'_>,
+/// View row and column of the grid cursor, or `None` when it has scrolled
+/// off the visible viewport or lies past its last column
+fn cursor_view_position(
+    grid: &Grid<Cell>,
     rows: usize,
     cols: usize,
-    grid: &alacritty_terminal::grid::Grid<alacritty_terminal::term::cell::Cell>,
     scroll_offset: usize,
-) {
+) -> Option<(usize, usize)> {
     let cursor = grid.cursor.point;
     // The cursor lives on the live screen (line >= 0). Scrolling up by
     // `scroll_offset` pushes it *down* the viewport by that many rows.
-    let cursor_line = cursor.line.0;
-    let view_row = cursor_line + scroll_offset as i32;
-
-    // Hide the cursor when it has scrolled off the visible viewport.
+    let view_row = cursor.line.0 + scroll_offset as i32;
     if view_row < 0 || view_row as usize >= rows {
-        return;
+        return None;
     }
 
-    let row = view_row as usize;
     let col = cursor.column.0;
-    if col >= cols {
-        return;
-    }
+    (col < cols).then_some((view_row as usize, col))
+}
 
+fn render_terminal_cursor(
+    frame: &mut Frame,
+    painter: &mut TextPainter,
+    ctx: &TerminalRenderContext<'_>,
+    grid: &Grid<Cell>,
+    row: usize,
+    col: usize,
+) {
     let cell_rect = terminal_cell_rect(ctx, row, col);
     frame.fill_rect(cell_rect, ctx.palette.cursor);
 
-    let cell = &grid[Line(cursor_line)][Column(col)];
+    let cell = &grid[grid.cursor.point.line][Column(col)];
     if cell.c == ' ' || cell.flags.contains(Flags::HIDDEN | Flags::WIDE_CHAR_SPACER) {
         return;
     }
@@ -269,10 +463,7 @@ fn terminal_view_row_to_grid_line(row: usize, scroll_offset: usize) -> i32 {
     row as i32 - scroll_offset as i32
 }
 
-fn cell_colors(
-    cell: &alacritty_terminal::term::cell::Cell,
-    palette: &TerminalPalette,
-) -> (u32, u32) {
+fn cell_colors(cell: &Cell, palette: &TerminalPalette) -> (u32, u32) {
     let mut fg = resolve_terminal_color(cell.fg, palette, TerminalColorRole::Foreground);
     let bg = resolve_terminal_color(cell.bg, palette, TerminalColorRole::Background);
     if cell.flags.contains(Flags::DIM) {
@@ -316,7 +507,7 @@ fn dim_color(color: u32) -> u32 {
     alpha | r | g | b
 }
 
-fn cell_decorations(cell: &alacritty_terminal::term::cell::Cell) -> TerminalCellDecorations {
+fn cell_decorations(cell: &Cell) -> TerminalCellDecorations {
     TerminalCellDecorations {
         bold: cell.flags.contains(Flags::BOLD),
         italic: cell.flags.contains(Flags::ITALIC),
@@ -362,13 +553,8 @@ fn render_scrollback_indicator(
     frame: &mut Frame,
     painter: &mut TextPainter,
     ctx: &TerminalRenderContext<'_>,
-    scroll_offset: usize,
-    max_offset: usize,
+    text: &str,
 ) {
-    let Some(text) = scrollback_indicator_text(scroll_offset, max_offset) else {
-        return;
-    };
-
     let padding = ctx.char_width.max(1.0).round();
     let width = text.chars().count() as f32 * ctx.char_width + padding;
     let x = (ctx.rect.x + ctx.rect.width - width).max(ctx.rect.x);
@@ -378,7 +564,7 @@ fn render_scrollback_indicator(
         frame,
         (x + padding / 2.0) as usize,
         ctx.rect.y as usize,
-        &text,
+        text,
         ctx.palette.default_fg,
     );
 }
@@ -509,6 +695,35 @@ mod tests {
         }
     }
 
+    #[test]
+    fn row_keys_change_only_for_rows_whose_content_changed() {
+        use alacritty_terminal::vte::ansi::Processor;
+
+        let palette = test_palette();
+        let size = TerminalGridSize { rows: 4, cols: 20 };
+        let keys = |term: &alacritty_terminal::Term<_>, scroll_offset| {
+            let viewport = terminal_viewport(term.grid(), scroll_offset, size);
+            (0..viewport.rows)
+                .map(|row| row_key(0, &viewport, &palette, row))
+                .collect::<Vec<_>>()
+        };
+
+        let mut term = scrollback_term();
+        let before = keys(&term, 0);
+        // Typing at the prompt (the cursor row) changes only that row
+        let mut parser: Processor = Processor::new();
+        parser.advance(&mut term, b"ls");
+        let after = keys(&term, 0);
+        assert_eq!(before[..3], after[..3]);
+        assert_ne!(before[3], after[3]);
+
+        // Scrolling up shifts rows down the view with the same keys, so
+        // their cached bands are reused; the top row gains the indicator
+        let scrolled = keys(&term, 1);
+        assert_eq!(scrolled[1..], after[..3]);
+        assert_ne!(scrolled[0], keys(&term, 2)[1]);
+    }
+
     #[test]
     fn color_resolution_maps_defaults_and_cursor_color() {
         let palette = test_palette();
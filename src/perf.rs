@@ -1,7 +1,9 @@
 //! Performance monitoring module
 //!
 //! Contains `PerfStats` for tracking frame timing and render breakdown.
-//! In release builds, all timing methods compile to no-ops for zero overhead.
+//! In release builds, all timing methods compile to no-ops for zero overhead;
+//! only the end-to-end input latency in `PerfStats::latency` and the frame
+//! pacing counters in `PerfStats::pacing` are kept.
 
 #[cfg(debug_assertions)]
 use std::array::from_fn;
@@ -10,11 +12,17 @@ use std::collections::VecDeque;
 #[cfg(debug_assertions)]
 use std::time::{Duration, Instant};
 
+use crate::frame_pacing::FramePacingStats;
+#[cfg(debug_assertions)]
+use crate::latency::LatencyPhase;
+use crate::latency::LatencyTracker;
 #[cfg(debug_assertions)]
 use crate::overlay::{
     render_overlay_background, render_overlay_border, OverlayAnchor, OverlayConfig,
 };
 #[cfg(debug_assertions)]
+use crate::syntax::LanguageId;
+#[cfg(debug_assertions)]
 use crate::theme::Theme;
 #[cfg(debug_assertions)]
 use crate::view::{Frame, TextPainter};
@@ -298,13 +306,27 @@ pub struct PerfStats {
     pub frame_cache_misses: usize,
     pub total_cache_hits: usize,
     pub total_cache_misses: usize,
+    pub frame_line_cache_hits: usize,
+    pub frame_line_cache_misses: usize,
+    pub total_line_cache_hits: usize,
+    pub total_line_cache_misses: usize,
+    /// Grammar initialization time per language (slowest worker's)
+    pub language_init_times: Vec<(LanguageId, Duration)>,
     pub show_overlay: bool,
+    /// Input-to-present latency, tracked in every build
+    pub latency: LatencyTracker,
+    /// Late and dropped frames and coalesced input, tracked in every build
+    pub pacing: FramePacingStats,
     #[cfg(feature = "profile-tracing")]
     frame_span: Option<tracing::span::EnteredSpan>,
 }
 
 #[cfg(not(debug_assertions))]
 pub struct PerfStats {
+    /// Input-to-present latency, tracked in every build
+    pub latency: LatencyTracker,
+    /// Late and dropped frames and coalesced input, tracked in every build
+    pub pacing: FramePacingStats,
     #[cfg(feature = "profile-tracing")]
     frame_span: Option<tracing::span::EnteredSpan>,
 }
@@ -313,6 +335,8 @@ pub struct PerfStats {
 impl Default for PerfStats {
     fn default() -> Self {
         Self {
+            latency: LatencyTracker::default(),
+            pacing: FramePacingStats::default(),
             #[cfg(feature = "profile-tracing")]
             frame_span: None,
         }
@@ -333,7 +357,14 @@ impl Default for PerfStats {
             frame_cache_misses: 0,
             total_cache_hits: 0,
             total_cache_misses: 0,
+            frame_line_cache_hits: 0,
+            frame_line_cache_misses: 0,
+            total_line_cache_hits: 0,
+            total_line_cache_misses: 0,
+            language_init_times: Vec::new(),
             show_overlay: false,
+            latency: LatencyTracker::default(),
+            pacing: FramePacingStats::default(),
             #[cfg(feature = "profile-tracing")]
             frame_span: None,
         }
@@ -384,6 +415,8 @@ impl PerfStats {
         self.stage_times.fill(Duration::ZERO);
         self.frame_cache_hits = 0;
         self.frame_cache_misses = 0;
+        self.frame_line_cache_hits = 0;
+        self.frame_line_cache_misses = 0;
     }
 
     /// Accumulate cache statistics from a text painter.
@@ -395,6 +428,35 @@ impl PerfStats {
         self.total_cache_misses += misses;
     }
 
+    /// Accumulate editor line render cache statistics.
+    #[inline(always)]
+    pub fn add_line_cache_stats(&mut self, hits: usize, misses: usize) {
+        self.frame_line_cache_hits += hits;
+        self.frame_line_cache_misses += misses;
+        self.total_line_cache_hits += hits;
+        self.total_line_cache_misses += misses;
+    }
+
+    /// Record a syntax worker's grammar initialization time.
+    ///
+    /// Each worker initializes its own grammars, so a language can be
+    /// reported more than once; the slowest time is kept.
+    pub fn record_language_init(&mut self, language: LanguageId, elapsed: Duration) {
+        match self
+            .language_init_times
+            .iter_mut()
+            .find(|(lang, _)| *lang == language)
+        {
+            Some((_, time)) => *time = (*time).max(elapsed),
+            None => self.language_init_times.push((language, elapsed)),
+        }
+    }
+
+    /// Total grammar initialization time across languages
+    pub fn language_init_total(&self) -> Duration {
+        self.language_init_times.iter().map(|(_, time)| *time).sum()
+    }
+
     #[inline(always)]
     pub fn start_frame(&mut self) {
         self.frame_start = Some(Instant::now());
@@ -512,6 +574,15 @@ impl PerfStats {
         }
     }
 
+    pub fn line_cache_hit_rate(&self) -> f64 {
+        let total = self.total_line_cache_hits + self.total_line_cache_misses;
+        if total > 0 {
+            self.total_line_cache_hits as f64 / total as f64 * 100.0
+        } else {
+            0.0
+        }
+    }
+
     pub fn visible_stages(&self) -> Vec<PerfStage> {
         PerfStage::ALL
             .into_iter()
@@ -534,6 +605,17 @@ impl PerfStats {
     #[inline(always)]
     pub fn add_cache_stats(&mut self, _hits: usize, _misses: usize) {}
 
+    #[inline(always)]
+    pub fn add_line_cache_stats(&mut self, _hits: usize, _misses: usize) {}
+
+    #[inline(always)]
+    pub fn record_language_init(
+        &mut self,
+        _language: crate::syntax::LanguageId,
+        _elapsed: std::time::Duration,
+    ) {
+    }
+
     #[inline(always)]
     pub fn start_frame(&mut self) {
         #[cfg(feature = "profile-tracing")]
@@ -603,10 +685,16 @@ pub fn render_perf_overlay(
     let row_gap = (4.0 * scale).round() as usize;
     let section_gap = (6.0 * scale).round() as usize;
     let row_height = line_height + row_gap;
-    let summary_rows = 4;
+    let summary_rows = 5;
     let legend_rows = 1;
     let stacked_bar_rows = 1;
-    let cache_rows = 4;
+    let cache_rows = 6;
+    let latency_kinds = perf.latency.active_kinds();
+    let latency_rows = if latency_kinds.is_empty() {
+        0
+    } else {
+        1 + latency_kinds.len()
+    };
     let breakdown_header_rows = 1;
     let breakdown_rows = active_stages.len() + usize::from(show_untracked);
     let overlay_width = (500.0 * scale).round() as usize;
@@ -614,10 +702,13 @@ pub fn render_perf_overlay(
         + legend_rows
         + stacked_bar_rows
         + cache_rows
+        + latency_rows
         + breakdown_header_rows
         + breakdown_rows;
-    let overlay_height = (padding_y * 2 + overlay_rows * row_height + section_gap * 3)
-        .max((360.0 * scale).round() as usize);
+    let overlay_height = (padding_y * 2
+        + overlay_rows * row_height
+        + section_gap * (3 + usize::from(latency_rows > 0)))
+    .max((360.0 * scale).round() as usize);
 
     let config = OverlayConfig::new(OverlayAnchor::TopRight, overlay_width, overlay_height)
         .with_margin((10.0 * scale).round() as usize)
@@ -711,6 +802,19 @@ pub fn render_perf_overlay(
     );
     row_top += row_height;
 
+    let pacing = &perf.pacing;
+    painter.draw(
+        frame,
+        inner_left,
+        row_text_y(row_top),
+        &format!(
+            "Paced: {} frames | late {} | dropped {} | coalesced {}",
+            pacing.frames, pacing.late_frames, pacing.dropped_frames, pacing.coalesced_events
+        ),
+        text_color,
+    );
+    row_top += row_height;
+
     let mut phase_entries: Vec<(&'static str, Duration, u32)> = active_stages
         .iter()
         .map(|stage| {
@@ -781,12 +885,13 @@ pub fn render_perf_overlay(
     row_top += row_height;
 
     let cache_size = painter.glyph_cache_size();
+    let cache_kb = painter.glyph_cache_bytes() / 1024;
     let hit_rate = perf.cache_hit_rate();
     painter.draw(
         frame,
         inner_left,
         row_text_y(row_top),
-        &format!("Cache: {} glyphs", cache_size),
+        &format!("Cache: {} glyphs ({} KB)", cache_size, cache_kb),
         text_color,
     );
     row_top += row_height;
@@ -815,8 +920,76 @@ pub fn render_perf_overlay(
         text_color,
     );
     row_top += row_height;
+
+    let (line_bands, line_bytes) = painter.line_cache_usage();
+    painter.draw(
+        frame,
+        inner_left,
+        row_text_y(row_top),
+        &format!(
+            "Lines: {} cached ({} KB), {:.1}% hit",
+            line_bands,
+            line_bytes / 1024,
+            perf.line_cache_hit_rate()
+        ),
+        text_color,
+    );
+    row_top += row_height;
+
+    painter.draw(
+        frame,
+        inner_left,
+        row_text_y(row_top),
+        &format!(
+            "Grammars: {} ({:.1} ms init)",
+            perf.language_init_times.len(),
+            perf.language_init_total().as_secs_f64() * 1000.0
+        ),
+        text_color,
+    );
+    row_top += row_height;
     row_top += section_gap;
 
+    if !latency_kinds.is_empty() {
+        painter.draw(
+            frame,
+            inner_left,
+            row_text_y(row_top),
+            "Input → present (p50 / p99 / max):",
+            text_color,
+        );
+        row_top += row_height;
+
+        let ms = |d: Duration| d.as_secs_f64() * 1000.0;
+        for kind in &latency_kinds {
+            let histogram = perf.latency.histogram(*kind, LatencyPhase::Present);
+            let p99 = histogram.percentile(0.99);
+            let color = if ms(p99) < 16.67 {
+                highlight_color
+            } else if ms(p99) < 33.3 {
+                warning_color
+            } else {
+                error_color
+            };
+            painter.draw(
+                frame,
+                inner_left,
+                row_text_y(row_top),
+                &format!(
+                    "{}: {:.1} / {:.1} / {:.1} ms ({})",
+                    kind.label(),
+                    ms(histogram.percentile(0.50)),
+                    ms(p99),
+                    ms(histogram.max()),
+                    histogram.count()
+                ),
+                color,
+            );
+            row_top += row_height;
+        }
+        row_top += section_gap;
+    }
+
     painter.draw(
         frame,
         inner_left,
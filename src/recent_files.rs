@@ -7,6 +7,8 @@ use serde::{Deserialize, Serialize};
 use std::path::{Path, PathBuf};
 use std::time::SystemTime;
 
+use crate::syntax::LanguageId;
+
 /// Maximum number of entries to keep
 const MAX_ENTRIES: usize = 50;
 
@@ -178,6 +180,23 @@ impl RecentFiles {
         }
     }
 
+    /// Distinct syntax languages of recent files, most recent first
+    ///
+    /// Used to pre-warm grammars likely to be needed this session.
+    pub fn languages(&self, limit: usize) -> Vec<LanguageId> {
+        let mut languages = Vec::new();
+        for entry in &self.entries {
+            if languages.len() >= limit {
+                break;
+            }
+            let lang = LanguageId::from_path(&entry.path);
+            if lang != LanguageId::PlainText && !languages.contains(&lang) {
+                languages.push(lang);
+            }
+        }
+        languages
+    }
+
     /// Find index of entry by path
     fn find_index(&self, path: &Path) -> Option<usize> {
         self.entries.iter().position(|e| e.path == path)
@@ -222,6 +241,21 @@ mod tests {
         assert_eq!(recent.entries.len(), MAX_ENTRIES);
     }
 
+    #[test]
+    fn test_languages_are_distinct_in_recency_order() {
+        let mut recent = RecentFiles::default();
+        recent.add(PathBuf::from("/a.rs"), None);
+        recent.add(PathBuf::from("/notes.txt"), None);
+        recent.add(PathBuf::from("/b.py"), None);
+        recent.add(PathBuf::from("/c.rs"), None);
+
+        assert_eq!(
+            recent.languages(8),
+            vec![LanguageId::Rust, LanguageId::Python]
+        );
+        assert_eq!(recent.languages(1), vec![LanguageId::Rust]);
+    }
+
     #[test]
     fn test_time_ago() {
         let entry = RecentEntry::new(PathBuf::from("/test.rs"), None);
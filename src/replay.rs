@@ -0,0 +1,566 @@
+//! Session recording and deterministic replay
+//!
+//! Set `TOKEN_RECORD_SESSION` to a file path and the editor appends every
+//! replayable message that reaches [`update`](crate::update::update) to it,
+//! one JSON object per line after a [`SessionHeader`] describing the window
+//! and the files it was started with. `profile_render --replay <file>` loads
+//! such a [`Session`], rebuilds the starting state and feeds the messages
+//! back through the real update and render path, collecting per-message
+//! timings into a [`ReplayReport`] that can be saved as a baseline and
+//! compared against later runs.
+//!
+//! Only user input is recorded ([`ReplayMsg`]): editor, document, modal,
+//! layout and image viewer messages, modal toggles and the file finder, plus
+//! window resizes and clipboard pastes. Results of background work (file loads, syntax parses, workspace
+//! scans) are left out; the replayer recomputes what it needs synchronously.
+
+use std::collections::BTreeMap;
+use std::fs::File;
+use std::io::{self, BufRead, BufReader, BufWriter, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+
+use serde::{Deserialize, Serialize};
+
+use crate::latency::LatencyHistogram;
+use crate::messages::{AppMsg, DocumentMsg, EditorMsg, ImageMsg, LayoutMsg, ModalMsg, Msg, UiMsg};
+use crate::model::ModalId;
+
+/// Environment variable naming the file a session is recorded to
+pub const RECORD_SESSION_ENV: &str = "TOKEN_RECORD_SESSION";
+
+/// Session file format version, bumped when recorded messages change shape
+pub const SESSION_VERSION: u32 = 1;
+
+/// A recordable subset of [`Msg`]: the messages produced by user input
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub enum ReplayMsg {
+    Editor(EditorMsg),
+    Document(DocumentMsg),
+    Modal(ModalMsg),
+    ToggleModal(ModalId),
+    OpenFuzzyFileFinder,
+    Layout(LayoutMsg),
+    Image(ImageMsg),
+    Resize(u32, u32),
+    PasteFromClipboard(String),
+}
+
+impl ReplayMsg {
+    /// The replayable form of `msg`, if it is user input
+    pub fn from_msg(msg: &Msg) -> Option<Self> {
+        Some(match msg {
+            Msg::Editor(m) => Self::Editor(m.clone()),
+            Msg::Document(m) => Self::Document(m.clone()),
+            Msg::Ui(UiMsg::Modal(m)) => Self::Modal(m.clone()),
+            Msg::Ui(UiMsg::ToggleModal(id)) => Self::ToggleModal(*id),
+            Msg::Ui(UiMsg::OpenFuzzyFileFinder) => Self::OpenFuzzyFileFinder,
+            Msg::Layout(m) => Self::Layout(m.clone()),
+            Msg::Image(m) => Self::Image(m.clone()),
+            Msg::App(AppMsg::Resize(width, height)) => Self::Resize(*width, *height),
+            Msg::App(AppMsg::PasteFromClipboard(text)) => Self::PasteFromClipboard(text.clone()),
+            _ => return None,
+        })
+    }
+
+    pub fn into_msg(self) -> Msg {
+        match self {
+            Self::Editor(m) => Msg::Editor(m),
+            Self::Document(m) => Msg::Document(m),
+            Self::Modal(m) => Msg::Ui(UiMsg::Modal(m)),
+            Self::ToggleModal(id) => Msg::Ui(UiMsg::ToggleModal(id)),
+            Self::OpenFuzzyFileFinder => Msg::Ui(UiMsg::OpenFuzzyFileFinder),
+            Self::Layout(m) => Msg::Layout(m),
+            Self::Image(m) => Msg::Image(m),
+            Self::Resize(width, height) => Msg::App(AppMsg::Resize(width, height)),
+            Self::PasteFromClipboard(text) => Msg::App(AppMsg::PasteFromClipboard(text)),
+        }
+    }
+
+    /// Message kind for grouping timings, e.g. `Editor::MoveCursor`
+    pub fn label(&self) -> String {
+        fn variant(debug: String) -> String {
+            let end = debug
+                .find(|c: char| !(c.is_alphanumeric() || c == '_'))
+                .unwrap_or(debug.len());
+            debug[..end].to_string()
+        }
+
+        match self {
+            Self::Editor(m) => format!("Editor::{}", variant(format!("{:?}", m))),
+            Self::Document(m) => format!("Document::{}", variant(format!("{:?}", m))),
+            Self::Modal(m) => format!("Modal::{}", variant(format!("{:?}", m))),
+            Self::ToggleModal(id) => format!("Ui::ToggleModal::{:?}", id),
+            Self::OpenFuzzyFileFinder => "Ui::OpenFuzzyFileFinder".to_string(),
+            Self::Layout(m) => format!("Layout::{}", variant(format!("{:?}", m))),
+            Self::Image(m) => format!("Image::{}", variant(format!("{:?}", m))),
+            Self::Resize(..) => "App::Resize".to_string(),
+            Self::PasteFromClipboard(_) => "App::PasteFromClipboard".to_string(),
+        }
+    }
+}
+
+/// First line of a session file: what the editor looked like when recording
+/// started
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct SessionHeader {
+    pub version: u32,
+    /// Window size in physical pixels
+    pub window_size: (u32, u32),
+    pub scale_factor: f64,
+    /// Files opened from the command line, in order
+    pub files: Vec<PathBuf>,
+}
+
+impl SessionHeader {
+    pub fn new(window_size: (u32, u32), scale_factor: f64, files: Vec<PathBuf>) -> Self {
+        Self {
+            version: SESSION_VERSION,
+            window_size,
+            scale_factor,
+            files,
+        }
+    }
+}
+
+/// A recorded message and when it arrived
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SessionEvent {
+    /// Microseconds since recording started
+    pub at_us: u64,
+    pub msg: ReplayMsg,
+}
+
+impl SessionEvent {
+    pub fn at(&self) -> Duration {
+        Duration::from_micros(self.at_us)
+    }
+}
+
+/// A recorded session loaded for replay
+#[derive(Debug, Clone)]
+pub struct Session {
+    pub header: SessionHeader,
+    pub events: Vec<SessionEvent>,
+}
+
+impl Session {
+    pub fn load(path: &Path) -> Result<Self, String> {
+        let file = File::open(path).map_err(|e| format!("{}: {}", path.display(), e))?;
+        Self::read(BufReader::new(file)).map_err(|e| format!("{}: {}", path.display(), e))
+    }
+
+    /// Parse a session from JSON lines: a header, then one event per line
+    pub fn read(reader: impl BufRead) -> Result<Self, String> {
+        let mut lines = reader.lines().enumerate();
+
+        let header: SessionHeader = match lines.next() {
+            Some((_, line)) => {
+                let line = line.map_err(|e| e.to_string())?;
+                serde_json::from_str(&line).map_err(|e| format!("line 1: {}", e))?
+            }
+            None => return Err("empty session file".to_string()),
+        };
+        if header.version != SESSION_VERSION {
+            return Err(format!(
+                "unsupported session version {} (expected {})",
+                header.version, SESSION_VERSION
+            ));
+        }
+
+        let mut events = Vec::new();
+        for (index, line) in lines {
+            let line = line.map_err(|e| e.to_string())?;
+            if line.trim().is_empty() {
+                continue;
+            }
+            let event =
+                serde_json::from_str(&line).map_err(|e| format!("line {}: {}", index + 1, e))?;
+            events.push(event);
+        }
+
+        Ok(Self { header, events })
+    }
+}
+
+/// Writes replayable messages to a session file as they are dispatched
+#[derive(Debug)]
+pub struct SessionRecorder<W: Write> {
+    out: W,
+    started: Instant,
+    events: usize,
+}
+
+impl<W: Write> SessionRecorder<W> {
+    /// Start a session on `out`, writing `header` first
+    pub fn new(mut out: W, header: &SessionHeader) -> io::Result<Self> {
+        serde_json::to_writer(&mut out, header)?;
+        out.write_all(b"\n")?;
+        out.flush()?;
+        Ok(Self {
+            out,
+            started: Instant::now(),
+            events: 0,
+        })
+    }
+
+    /// Append `msg` if it is replayable; returns whether it was written
+    ///
+    /// Each event is flushed so a crash loses at most the message that
+    /// caused it; input arrives at human speed, so this is cheap.
+    pub fn record(&mut self, msg: &Msg) -> io::Result<bool> {
+        let Some(msg) = ReplayMsg::from_msg(msg) else {
+            return Ok(false);
+        };
+        let event = SessionEvent {
+            at_us: self.started.elapsed().as_micros() as u64,
+            msg,
+        };
+        serde_json::to_writer(&mut self.out, &event)?;
+        self.out.write_all(b"\n")?;
+        self.out.flush()?;
+        self.events += 1;
+        Ok(true)
+    }
+
+    /// Number of events written so far
+    pub fn events(&self) -> usize {
+        self.events
+    }
+
+    pub fn into_inner(self) -> W {
+        self.out
+    }
+}
+
+/// Fast path for [`record`]: set only while a recorder is installed
+static RECORDING: AtomicBool = AtomicBool::new(false);
+
+static RECORDER: Mutex<Option<SessionRecorder<BufWriter<File>>>> = Mutex::new(None);
+
+/// Start recording every replayable message passed to `update` into `path`
+pub fn start_recording(path: &Path, header: &SessionHeader) -> io::Result<()> {
+    let recorder = SessionRecorder::new(BufWriter::new(File::create(path)?), header)?;
+    *RECORDER.lock().unwrap() = Some(recorder);
+    RECORDING.store(true, Ordering::Release);
+    Ok(())
+}
+
+/// Stop recording; returns the number of events written, if recording
+pub fn stop_recording() -> Option<usize> {
+    RECORDING.store(false, Ordering::Release);
+    RECORDER
+        .lock()
+        .unwrap()
+        .take()
+        .map(|recorder| recorder.events())
+}
+
+/// Record `msg` if a session is being recorded
+///
+/// Called for every message; costs one relaxed load when not recording.
+#[inline]
+pub fn record(msg: &Msg) {
+    if RECORDING.load(Ordering::Relaxed) {
+        record_slow(msg);
+    }
+}
+
+#[cold]
+fn record_slow(msg: &Msg) {
+    let mut recorder = RECORDER.lock().unwrap();
+    let Some(active) = recorder.as_mut() else {
+        return;
+    };
+    if let Err(e) = active.record(msg) {
+        tracing::warn!("Stopped recording session: {}", e);
+        *recorder = None;
+        RECORDING.store(false, Ordering::Release);
+    }
+}
+
+/// Where the session should be recorded, from `TOKEN_RECORD_SESSION`
+pub fn record_path_from_env() -> Option<PathBuf> {
+    std::env::var_os(RECORD_SESSION_ENV)
+        .filter(|value| !value.is_empty())
+        .map(PathBuf::from)
+}
+
+/// Cost of replaying one message
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ReplaySample {
+    pub update: Duration,
+    /// Synchronous syntax parses the message triggered
+    pub syntax: Duration,
+    /// `None` when the message didn't need a redraw
+    pub render: Option<Duration>,
+    /// Heap allocations made while handling the message (`dhat-heap` only)
+    pub allocations: u64,
+    pub allocated_bytes: u64,
+}
+
+/// Timings for one kind of message
+#[derive(Debug, Clone, Default)]
+pub struct MessageStats {
+    pub update: LatencyHistogram,
+    pub syntax: LatencyHistogram,
+    pub render: LatencyHistogram,
+    pub allocations: u64,
+    pub allocated_bytes: u64,
+}
+
+impl MessageStats {
+    pub fn count(&self) -> u64 {
+        self.update.count()
+    }
+
+    pub fn allocations_per_msg(&self) -> u64 {
+        self.allocations.checked_div(self.count()).unwrap_or(0)
+    }
+
+    fn to_json(&self) -> serde_json::Value {
+        serde_json::json!({
+            "count": self.count(),
+            "update": self.update.to_json(),
+            "syntax": self.syntax.to_json(),
+            "render": self.render.to_json(),
+            "allocations": self.allocations,
+            "allocated_bytes": self.allocated_bytes,
+            "allocations_per_msg": self.allocations_per_msg(),
+        })
+    }
+}
+
+/// A metric that got worse than the baseline by more than the threshold
+#[derive(Debug, Clone, PartialEq)]
+pub struct Regression {
+    pub label: String,
+    pub metric: &'static str,
+    pub baseline: u64,
+    pub current: u64,
+}
+
+impl std::fmt::Display for Regression {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(
+            f,
+            "{} {}: {} -> {}",
+            self.label, self.metric, self.baseline, self.current
+        )
+    }
+}
+
+/// Per-message-kind replay timings
+#[derive(Debug, Clone, Default)]
+pub struct ReplayReport {
+    pub by_label: BTreeMap<String, MessageStats>,
+    pub total: MessageStats,
+}
+
+impl ReplayReport {
+    /// Timing differences below this are noise, however large relatively
+    pub const NOISE_FLOOR_US: u64 = 20;
+
+    pub fn record(&mut self, label: String, sample: ReplaySample) {
+        let stats = self.by_label.entry(label).or_default();
+        for stats in [stats, &mut self.total] {
+            stats.update.record(sample.update);
+            if !sample.syntax.is_zero() {
+                stats.syntax.record(sample.syntax);
+            }
+            if let Some(render) = sample.render {
+                stats.render.record(render);
+            }
+            stats.allocations += sample.allocations;
+            stats.allocated_bytes += sample.allocated_bytes;
+        }
+    }
+
+    pub fn to_json(&self) -> serde_json::Value {
+        let by_label: serde_json::Map<_, _> = self
+            .by_label
+            .iter()
+            .map(|(label, stats)| (label.clone(), stats.to_json()))
+            .collect();
+        serde_json::json!({
+            "total": self.total.to_json(),
+            "by_message": by_label,
+        })
+    }
+
+    /// Compare median update/render times and allocations per message with
+    /// a baseline saved from [`to_json`](Self::to_json)
+    ///
+    /// `threshold` is the allowed relative increase (0.1 = 10%). Message
+    /// kinds missing from either side are skipped.
+    pub fn compare(&self, baseline: &serde_json::Value, threshold: f64) -> Vec<Regression> {
+        let mut regressions = Vec::new();
+        let entries = std::iter::once(("total", &self.total, &baseline["total"])).chain(
+            self.by_label
+                .iter()
+                .map(|(label, stats)| (label.as_str(), stats, &baseline["by_message"][label])),
+        );
+
+        for (label, stats, base) in entries {
+            if base.is_null() {
+                continue;
+            }
+            let metrics = [
+                (
+                    "update p50 us",
+                    stats.update.percentile(0.5).as_micros() as u64,
+                    &base["update"]["p50_us"],
+                    Self::NOISE_FLOOR_US,
+                ),
+                (
+                    "render p50 us",
+                    stats.render.percentile(0.5).as_micros() as u64,
+                    &base["render"]["p50_us"],
+                    Self::NOISE_FLOOR_US,
+                ),
+                (
+                    "allocations/msg",
+                    stats.allocations_per_msg(),
+                    &base["allocations_per_msg"],
+                    0,
+                ),
+            ];
+            for (metric, current, base, floor) in metrics {
+                let Some(base) = base.as_u64() else {
+                    continue;
+                };
+                let limit = (base as f64 * (1.0 + threshold)) as u64;
+                if current > limit && current - base > floor {
+                    regressions.push(Regression {
+                        label: label.to_string(),
+                        metric,
+                        baseline: base,
+                        current,
+                    });
+                }
+            }
+        }
+        regressions
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::messages::Direction;
+    use crate::model::editor_area::SplitDirection;
+
+    #[test]
+    fn test_session_round_trips_through_recorder() {
+        let header = SessionHeader::new((800, 600), 2.0, vec![PathBuf::from("src/main.rs")]);
+        let mut recorder = SessionRecorder::new(Vec::new(), &header).unwrap();
+
+        let msgs = [
+            Msg::Editor(EditorMsg::MoveCursor(Direction::Down)),
+            Msg::Document(DocumentMsg::InsertText("hi\n".to_string())),
+            Msg::Ui(UiMsg::Modal(ModalMsg::OpenGotoLine)),
+            Msg::Ui(UiMsg::ToggleModal(ModalId::FindReplace)),
+            Msg::Ui(UiMsg::OpenFuzzyFileFinder),
+            Msg::Layout(LayoutMsg::SplitFocused(SplitDirection::Vertical)),
+            Msg::App(AppMsg::Resize(1024, 768)),
+        ];
+        for msg in &msgs {
+            assert!(recorder.record(msg).unwrap());
+        }
+        assert_eq!(recorder.events(), msgs.len());
+
+        let bytes = recorder.into_inner();
+        let session = Session::read(bytes.as_slice()).unwrap();
+        assert_eq!(session.header, header);
+        assert_eq!(session.events.len(), msgs.len());
+        assert!(session.events.windows(2).all(|w| w[0].at_us <= w[1].at_us));
+
+        let replayed: Vec<String> = session
+            .events
+            .into_iter()
+            .map(|event| format!("{:?}", event.msg.into_msg()))
+            .collect();
+        let expected: Vec<String> = msgs.iter().map(|msg| format!("{:?}", msg)).collect();
+        assert_eq!(replayed, expected);
+    }
+
+    #[test]
+    fn test_background_results_are_not_recorded() {
+        let header = SessionHeader::new((800, 600), 1.0, Vec::new());
+        let mut recorder = SessionRecorder::new(Vec::new(), &header).unwrap();
+
+        assert!(!recorder.record(&Msg::App(AppMsg::SaveFile)).unwrap());
+        assert!(!recorder
+            .record(&Msg::Ui(UiMsg::SetStatus("saved".to_string())))
+            .unwrap());
+        assert_eq!(recorder.events(), 0);
+    }
+
+    #[test]
+    fn test_read_rejects_other_versions_and_reports_bad_lines() {
+        let mut header = SessionHeader::new((800, 600), 1.0, Vec::new());
+        header.version = SESSION_VERSION + 1;
+        let file = format!("{}\n", serde_json::to_string(&header).unwrap());
+        assert!(Session::read(file.as_bytes())
+            .unwrap_err()
+            .contains("version"));
+
+        header.version = SESSION_VERSION;
+        let file = format!("{}\nnot json\n", serde_json::to_string(&header).unwrap());
+        assert!(Session::read(file.as_bytes())
+            .unwrap_err()
+            .starts_with("line 2"));
+    }
+
+    #[test]
+    fn test_labels_name_the_message_kind() {
+        let label = |msg: Msg| ReplayMsg::from_msg(&msg).unwrap().label();
+        assert_eq!(
+            label(Msg::Editor(EditorMsg::SetCursorPosition {
+                line: 1,
+                column: 2
+            })),
+            "Editor::SetCursorPosition"
+        );
+        assert_eq!(
+            label(Msg::Document(DocumentMsg::InsertChar('a'))),
+            "Document::InsertChar"
+        );
+        assert_eq!(label(Msg::App(AppMsg::Resize(1, 2))), "App::Resize");
+    }
+
+    #[test]
+    fn test_compare_flags_regressions_beyond_threshold_and_noise() {
+        let sample = |update_us, allocations| ReplaySample {
+            update: Duration::from_micros(update_us),
+            render: Some(Duration::from_micros(1000)),
+            allocations,
+            ..Default::default()
+        };
+
+        let mut baseline = ReplayReport::default();
+        baseline.record("Editor::PageDown".to_string(), sample(500, 10));
+        baseline.record("Editor::MoveCursor".to_string(), sample(5, 2));
+        let baseline = baseline.to_json();
+
+        let mut current = ReplayReport::default();
+        current.record("Editor::PageDown".to_string(), sample(900, 10));
+        current.record("Editor::MoveCursor".to_string(), sample(10, 3));
+        current.record("Layout::NewTab".to_string(), sample(5000, 100));
+
+        let regressions = current.compare(&baseline, 0.1);
+        let found: Vec<_> = regressions
+            .iter()
+            .map(|r| (r.label.as_str(), r.metric))
+            .collect();
+        // MoveCursor's 5us -> 10us is within the noise floor, but its extra
+        // allocation is not; NewTab has no baseline
+        assert!(found.contains(&("Editor::PageDown", "update p50 us")));
+        assert!(found.contains(&("Editor::MoveCursor", "allocations/msg")));
+        assert!(!found.contains(&("Editor::MoveCursor", "update p50 us")));
+        assert!(found.iter().all(|(label, _)| *label != "Layout::NewTab"));
+        assert!(current.compare(&current.to_json(), 0.1).is_empty());
+    }
+}
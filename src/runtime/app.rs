@@ -1,14 +1,16 @@
 use std::collections::HashMap;
 use std::rc::Rc;
+use std::sync::atomic::{AtomicBool, Ordering};
 use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::Arc;
 use std::time::{Duration, Instant};
 
 use anyhow::Result;
 use softbuffer::Context;
 use winit::application::ApplicationHandler;
 use winit::dpi::LogicalSize;
-use winit::event::{ElementState, MouseButton, WindowEvent};
-use winit::event_loop::{ActiveEventLoop, ControlFlow};
+use winit::event::{ElementState, MouseButton, MouseScrollDelta, WindowEvent};
+use winit::event_loop::{ActiveEventLoop, ControlFlow, EventLoopProxy};
 #[cfg(debug_assertions)]
 use winit::keyboard::{Key, NamedKey};
 use winit::keyboard::{KeyCode, PhysicalKey};
@@ -16,19 +18,19 @@ use winit::window::{CursorIcon, Icon, Window};
 
 use token::cli::StartupConfig;
 use token::commands::{Cmd, Damage};
+use token::frame_pacing::FrameScheduler;
 use token::fs_watcher::{FileSystemEvent, FileSystemWatcher};
 use token::keymap::{
     keystroke_from_winit, load_default_keymap, Command, KeyAction, KeyContext, Keymap,
 };
 use token::messages::{
-    AppMsg, EditorMsg, ImageMsg, LayoutMsg, Msg, SyntaxMsg, UiMsg, WorkspaceMsg,
+    AppMsg, EditorMsg, FindInFilesMsg, ImageMsg, LayoutMsg, Msg, SyntaxMsg, UiMsg, WorkspaceMsg,
 };
 use token::model::editor::Position;
 use token::model::AppModel;
-use token::syntax::{LanguageId, ParserState};
 use token::update::update;
 
-use super::input::{handle_key, KeyModifiers, OptionKeyGesture};
+use super::input::{handle_key, latency_kind, KeyModifiers, OptionKeyGesture};
 use super::mouse::{
     end_tab_drag, handle_mouse_press, handle_mouse_wheel, make_mouse_event, update_tab_drag,
     ClickTracker, DragState,
@@ -37,23 +39,24 @@ use super::webview::WebviewManager;
 use token::view::Renderer;
 
 use super::perf::{PerfStage, PerfStats};
+use super::syntax_worker::{SyntaxParseRequest, SyntaxWorkerPool};
+use super::wake::{waking_channel, LoopWaker};
 
 use winit::keyboard::ModifiersState;
 
-/// Request sent to syntax worker thread
-struct SyntaxParseRequest {
-    document_id: token::model::editor_area::DocumentId,
-    revision: u64,
-    source: String,
-    language: LanguageId,
-}
+type TerminalSpawnReceiver = Receiver<Result<token::terminal::TerminalSpawnResult, String>>;
 
-enum SyntaxWorkerRequest {
-    Parse(SyntaxParseRequest),
-    ClearDocument(token::model::editor_area::DocumentId),
-}
+/// The cursor stops blinking (and the event loop stops waking for it) after
+/// this long without input
+const CURSOR_BLINK_IDLE_TIMEOUT: Duration = Duration::from_secs(10);
 
-type TerminalSpawnReceiver = Receiver<Result<token::terminal::TerminalSpawnResult, String>>;
+/// A cursor move or wheel scroll held back until the event queue drains,
+/// with later events of the same kind merged into it
+struct CoalescedInput {
+    event: WindowEvent,
+    /// Arrival of the first merged event, for latency tracking
+    arrived: Instant,
+}
 
 pub struct App {
     model: AppModel,
@@ -71,8 +74,8 @@ pub struct App {
     msg_tx: Sender<Msg>,
     msg_rx: Receiver<Msg>,
     perf: PerfStats,
-    /// Channel to send parse requests to syntax worker
-    syntax_tx: Sender<SyntaxWorkerRequest>,
+    /// Background syntax parsing threads
+    syntax_workers: SyntaxWorkerPool,
     /// File system watcher for workspace directory (if workspace is open)
     fs_watcher: Option<FileSystemWatcher>,
     /// Pending damage for the next render (accumulated from commands)
@@ -90,24 +93,37 @@ pub struct App {
     /// Receiver for background PTY spawn completion. Spawned asynchronously
     /// because `portable_pty` startup can block on shell initialization.
     terminal_spawn_rx: Option<(usize, TerminalSpawnReceiver)>,
+    /// Session file and startup files for `TOKEN_RECORD_SESSION`; recording
+    /// starts once the renderer knows the window size and scale factor
+    pending_recording: Option<(std::path::PathBuf, Vec<std::path::PathBuf>)>,
+    /// Wakes the event loop when background threads send messages
+    waker: LoopWaker,
+    /// Paces redraws to the display refresh interval
+    frame_scheduler: FrameScheduler,
+    /// Cursor moves or wheel scrolls waiting to be handled as one update
+    coalesced_input: Option<CoalescedInput>,
+    /// Whether the window has keyboard focus; the cursor doesn't blink
+    /// without it
+    window_focused: bool,
+    /// Last key, click, scroll or resize, for pausing the cursor blink
+    last_input: Instant,
 }
 
 impl App {
     pub fn new(window_width: u32, window_height: u32, startup_config: StartupConfig) -> Self {
-        let (msg_tx, msg_rx) = mpsc::channel();
+        let waker = LoopWaker::default();
+        let (msg_tx, msg_rx) = waking_channel(waker.clone());
         let keymap = Keymap::with_bindings(load_default_keymap());
 
-        // Spawn syntax highlighting worker thread
-        let (syntax_tx, syntax_rx) = mpsc::channel::<SyntaxWorkerRequest>();
-        {
-            let msg_tx_clone = msg_tx.clone();
-            std::thread::spawn(move || syntax_worker_loop(syntax_rx, msg_tx_clone));
-        }
+        // Spawn syntax highlighting worker threads
+        let syntax_workers = SyntaxWorkerPool::new(msg_tx.clone());
 
         // Extract file paths and workspace from config
         let mut file_paths = startup_config.file_paths();
         let workspace_root = startup_config.workspace_root().cloned();
         let initial_position = startup_config.initial_position;
+        let pending_recording =
+            token::replay::record_path_from_env().map(|path| (path, file_paths.clone()));
 
         // Load the first file synchronously (needed for immediate editing).
         // Defer additional files to background loads so startup isn't blocked.
@@ -131,18 +147,20 @@ impl App {
         }
 
         // Open workspace if specified and start file watcher
-        let fs_watcher = if let Some(root) = workspace_root {
-            model.open_workspace(root.clone());
+        let (fs_watcher, workspace_scan) = if let Some(root) = workspace_root {
+            let scan = model.open_workspace(root.clone());
             // Start file system watcher for the workspace
-            match FileSystemWatcher::new(root) {
+            let fs_waker = waker.clone();
+            let watcher = match FileSystemWatcher::with_wake(root, move || fs_waker.wake()) {
                 Ok(watcher) => Some(watcher),
                 Err(e) => {
                     tracing::warn!("Failed to start file system watcher: {}", e);
                     None
                 }
-            }
+            };
+            (watcher, scan)
         } else {
-            None
+            (None, None)
         };
 
         // Apply initial cursor position if specified (--line/--column)
@@ -170,7 +188,7 @@ impl App {
             msg_tx,
             msg_rx,
             perf: PerfStats::default(),
-            syntax_tx,
+            syntax_workers,
             fs_watcher,
             pending_damage: Damage::Full, // Start with full render
             should_quit: false,
@@ -179,42 +197,96 @@ impl App {
             syntax_deadlines: HashMap::new(),
             pending_file_loads,
             terminal_spawn_rx: None,
+            pending_recording,
+            waker,
+            frame_scheduler: FrameScheduler::new(),
+            coalesced_input: None,
+            window_focused: true,
+            last_input: Instant::now(),
         };
 
         // Trigger initial syntax parsing for all loaded documents
         app.trigger_initial_syntax_parsing();
+        app.start_initial_large_file_loads();
+        app.prewarm_recent_languages();
+        if let Some(request) = workspace_scan {
+            app.process_cmd(Cmd::ScanWorkspace { request });
+        }
 
         app
     }
 
+    /// Let background threads wake the event loop once it runs
+    pub fn set_event_loop_proxy(&self, proxy: EventLoopProxy<()>) {
+        self.waker.set_proxy(proxy);
+    }
+
     /// Trigger syntax parsing for all documents loaded at startup
     fn trigger_initial_syntax_parsing(&mut self) {
-        // Collect document info first to avoid borrow issues
-        let docs_to_parse: Vec<_> = self
+        // Collect document ids first to avoid borrow issues
+        let doc_ids: Vec<_> = self
             .model
             .editor_area
             .documents
             .iter()
-            .filter(|(_, doc)| doc.language.has_highlighting())
-            .map(|(&id, doc)| (id, doc.revision, doc.buffer.to_string(), doc.language))
+            .filter(|(_, doc)| doc.syntax_enabled())
+            .map(|(&id, _)| id)
             .collect();
 
         // Send parse requests for each document
-        for (doc_id, revision, source, language) in docs_to_parse {
-            if let Err(e) = self
-                .syntax_tx
-                .send(SyntaxWorkerRequest::Parse(SyntaxParseRequest {
-                    document_id: doc_id,
-                    revision,
-                    source,
-                    language,
-                }))
-            {
+        for doc_id in doc_ids {
+            let priority_lines = token::update::viewport_priority_lines(&self.model, doc_id);
+            let visible = self.model.editor_area.is_document_visible(doc_id);
+            let Some(doc) = self.model.editor_area.documents.get_mut(&doc_id) else {
+                continue;
+            };
+            let edits = doc.edit_journal.take(doc.revision);
+            if let Err(e) = self.syntax_workers.parse(SyntaxParseRequest {
+                document_id: doc_id,
+                revision: doc.revision,
+                snapshot: doc.buffer.clone(),
+                edits,
+                language: doc.language,
+                priority_lines,
+                has_highlights: doc.syntax_highlights.is_some(),
+                visible,
+            }) {
                 tracing::warn!("Failed to send initial syntax parse request: {}", e);
             }
         }
     }
 
+    /// Pre-warm grammars for the languages of recently opened files
+    ///
+    /// Queued after the initial parses, so languages of documents already
+    /// open are initialized by those parses first.
+    fn prewarm_recent_languages(&self) {
+        let languages = self.model.recent_files.languages(PREWARM_RECENT_LANGUAGES);
+        self.syntax_workers.prewarm(languages);
+    }
+
+    /// Start streaming large files opened from the command line
+    fn start_initial_large_file_loads(&mut self) {
+        let loads: Vec<_> = self
+            .model
+            .editor_area
+            .documents
+            .iter()
+            .filter_map(|(&id, doc)| {
+                let cancel = Arc::clone(&doc.loading.as_ref()?.cancel);
+                Some((id, doc.file_path.clone()?, cancel))
+            })
+            .collect();
+
+        for (document_id, path, cancel) in loads {
+            self.process_cmd(Cmd::StreamLargeFile {
+                document_id,
+                path,
+                cancel,
+            });
+        }
+    }
+
     /// Dispatch a command through the update loop
     fn dispatch_command(&mut self, command: Command) -> Option<Cmd> {
         let mut result = None;
@@ -253,6 +325,18 @@ impl App {
         let size = window.inner_size();
         self.model.resize(size.width, size.height);
 
+        if let Some((path, files)) = self.pending_recording.take() {
+            let header = token::replay::SessionHeader::new(
+                self.model.window_size,
+                self.model.metrics.scale_factor,
+                files,
+            );
+            match token::replay::start_recording(&path, &header) {
+                Ok(()) => tracing::info!("Recording session to {}", path.display()),
+                Err(e) => tracing::warn!("Failed to record session: {}", e),
+            }
+        }
+
         self.renderer = Some(renderer);
         Ok(())
     }
@@ -336,10 +420,25 @@ impl App {
                 &mut self.model,
                 Msg::App(AppMsg::Resize(size.width, size.height)),
             ),
-            WindowEvent::ScaleFactorChanged { scale_factor, .. } => update(
-                &mut self.model,
-                Msg::App(AppMsg::ScaleFactorChanged(*scale_factor)),
-            ),
+            WindowEvent::ScaleFactorChanged { scale_factor, .. } => {
+                self.update_refresh_rate();
+                update(
+                    &mut self.model,
+                    Msg::App(AppMsg::ScaleFactorChanged(*scale_factor)),
+                )
+            }
+            WindowEvent::Moved(_) => {
+                self.update_refresh_rate();
+                None
+            }
+            WindowEvent::Focused(focused) => {
+                if *focused {
+                    self.note_activity(Instant::now());
+                }
+                // Without focus the cursor blinks back on once, then stops
+                self.window_focused = *focused;
+                None
+            }
             WindowEvent::ModifiersChanged(mods) => {
                 self.modifiers = mods.state();
                 None
@@ -759,12 +858,18 @@ impl App {
     }
 
     fn render(&mut self) -> Result<()> {
+        self.frame_scheduler
+            .begin_frame(Instant::now(), &mut self.perf.pacing);
         self.perf.start_frame();
 
         if let Some(renderer) = &mut self.renderer {
             // Take pending damage and reset to empty for next frame
             let damage = std::mem::take(&mut self.pending_damage);
             renderer.render(&mut self.model, &mut self.perf, &damage)?;
+            // Nothing is presented without damage
+            if !matches!(damage, Damage::None) {
+                self.perf.latency.presented();
+            }
         }
 
         // Sync webviews with preview panes.
@@ -793,7 +898,9 @@ impl App {
     /// Creates, updates, or destroys webviews as needed.
     fn sync_webviews(&mut self) {
         use super::webview::PreviewContent;
-        use token::markdown::{content_to_preview_html, PreviewTheme};
+        use token::markdown::{
+            content_to_preview_html, markdown_to_blocks, preview_css, PreviewTheme,
+        };
         use token::model::editor_area::PreviewId;
         use token::syntax::LanguageId;
         use token::view::geometry::PreviewPaneLayout;
@@ -826,6 +933,7 @@ impl App {
         // Collect info about previews that need updates (to avoid borrow issues)
         let scale_factor = self.model.metrics.scale_factor;
         let theme = PreviewTheme::from_editor_theme(&self.model.theme);
+        let css = preview_css(&theme);
         let metrics = &self.model.metrics;
 
         struct PreviewUpdate {
@@ -853,25 +961,34 @@ impl App {
                 // Only generate HTML when creating or updating content
                 let content = if needs_create || needs_content_update {
                     let buffer_content = document.buffer.to_string();
-                    let html = content_to_preview_html(&buffer_content, document.language, &theme)?;
-
-                    // For HTML files with a file path, enable local resource loading
-                    Some(if document.language == LanguageId::Html {
-                        if let Some(file_path) = &document.file_path {
-                            if let Some(base_dir) = file_path.parent() {
-                                PreviewContent::HtmlFile {
-                                    html,
-                                    base_dir: base_dir.to_path_buf(),
+                    if document.language == LanguageId::Markdown {
+                        // Rendered per block so the page can be patched in place
+                        Some(PreviewContent::Markdown {
+                            blocks: markdown_to_blocks(&buffer_content),
+                            css: css.clone(),
+                        })
+                    } else {
+                        let html =
+                            content_to_preview_html(&buffer_content, document.language, &theme)?;
+
+                        // For HTML files with a file path, enable local resource loading
+                        Some(if document.language == LanguageId::Html {
+                            if let Some(file_path) = &document.file_path {
+                                if let Some(base_dir) = file_path.parent() {
+                                    PreviewContent::HtmlFile {
+                                        html,
+                                        base_dir: base_dir.to_path_buf(),
+                                    }
+                                } else {
+                                    PreviewContent::Html(html)
                                 }
                             } else {
                                 PreviewContent::Html(html)
                             }
                         } else {
                             PreviewContent::Html(html)
-                        }
-                    } else {
-                        PreviewContent::Html(html)
-                    })
+                        })
+                    }
                 } else {
                     None
                 };
@@ -927,6 +1044,8 @@ impl App {
                     scale_factor,
                     window_height,
                 );
+                // Follow theme changes between edits
+                self.webview_manager.update_style(update.preview_id, &css);
 
                 // Update content if revision changed
                 if update.needs_content_update {
@@ -947,6 +1066,76 @@ impl App {
         update(&mut self.model, Msg::Ui(UiMsg::BlinkCursor))
     }
 
+    /// Whether the cursor blinks: while the window is focused and input
+    /// arrived recently. A hidden cursor keeps blinking until it is shown.
+    fn cursor_blink_active(&self, now: Instant) -> bool {
+        (self.window_focused && now.duration_since(self.last_input) < CURSOR_BLINK_IDLE_TIMEOUT)
+            || !self.model.ui.cursor_visible
+    }
+
+    /// Note user input, restarting a paused cursor blink from the visible
+    /// phase
+    fn note_activity(&mut self, now: Instant) {
+        if !self.cursor_blink_active(now) {
+            self.last_tick = now;
+            self.model.reset_cursor_blink();
+        }
+        self.last_input = now;
+    }
+
+    /// Pace frames to the refresh rate of the monitor the window is on
+    fn update_refresh_rate(&mut self) {
+        let millihertz = self
+            .window
+            .as_ref()
+            .and_then(|window| window.current_monitor())
+            .and_then(|monitor| monitor.refresh_rate_millihertz());
+        self.frame_scheduler.set_refresh_rate_millihertz(millihertz);
+    }
+
+    /// Ask for a redraw; bursts within one refresh interval share a frame
+    fn schedule_redraw(&mut self) {
+        let now = Instant::now();
+        self.frame_scheduler.want_redraw(now);
+        if self.frame_scheduler.poll(now) {
+            if let Some(window) = &self.window {
+                window.request_redraw();
+            }
+        }
+    }
+
+    /// Handle a window event that arrived at `arrived` and schedule the
+    /// redraw it asks for
+    fn dispatch_event(&mut self, event: &WindowEvent, arrived: Instant) {
+        let input_kind = latency_kind(event);
+        if let Some(kind) = input_kind {
+            self.note_activity(Instant::now());
+            self.perf.latency.begin_input_at(kind, arrived);
+        }
+        let needs_redraw = if let Some(cmd) = self.handle_event(event) {
+            let needs_redraw = cmd.needs_redraw();
+            // Accumulate damage from command
+            self.pending_damage.merge(cmd.damage());
+            self.process_cmd(cmd);
+            needs_redraw
+        } else {
+            false
+        };
+        if input_kind.is_some() {
+            self.perf.latency.end_input(needs_redraw);
+        }
+        if needs_redraw {
+            self.schedule_redraw();
+        }
+    }
+
+    /// Handle the held-back cursor move or wheel scroll, if any
+    fn flush_coalesced_input(&mut self) {
+        if let Some(input) = self.coalesced_input.take() {
+            self.dispatch_event(&input.event, input.arrived);
+        }
+    }
+
     fn process_cmd(&mut self, cmd: Cmd) {
         match cmd {
             Cmd::None => {}
@@ -976,6 +1165,38 @@ impl App {
                     }
                 });
             }
+            Cmd::StreamLargeFile {
+                document_id,
+                path,
+                cancel,
+            } => {
+                let tx = self.msg_tx.clone();
+                std::thread::spawn(move || stream_large_file(tx, document_id, path, cancel));
+            }
+            Cmd::DecodeImage {
+                document_id,
+                path,
+                scale,
+            } => {
+                let tx = self.msg_tx.clone();
+                std::thread::spawn(move || {
+                    let result = token::image::decode_image(&path, scale);
+                    if let Err(e) = tx.send(Msg::App(AppMsg::ImageDecoded {
+                        document_id,
+                        result,
+                    })) {
+                        tracing::warn!("Failed to send decoded image to main thread: {}", e);
+                    }
+                });
+            }
+            Cmd::ScanWorkspace { request } => {
+                let tx = self.msg_tx.clone();
+                std::thread::spawn(move || scan_workspace(tx, request));
+            }
+            Cmd::FindInFiles { request } => {
+                let tx = self.msg_tx.clone();
+                std::thread::spawn(move || find_in_files(tx, request));
+            }
             Cmd::OpenInExplorer { path } => {
                 #[cfg(target_os = "macos")]
                 {
@@ -1109,6 +1330,7 @@ impl App {
                 let (spawn_tx, spawn_rx) = mpsc::channel();
                 self.terminal_spawn_rx = Some((session_id, spawn_rx));
                 let msg_tx = self.msg_tx.clone();
+                let waker = self.waker.clone();
                 std::thread::spawn(move || {
                     let result = token::terminal::spawn_pty(&cwd, rows, cols, msg_tx, session_id)
                         .map(|pty| token::terminal::TerminalSpawnResult {
@@ -1121,6 +1343,7 @@ impl App {
                     if let Err(e) = spawn_tx.send(result) {
                         tracing::warn!("Failed to send terminal spawn result: {e:?}");
                     }
+                    waker.wake();
                 });
             }
             Cmd::Batch(cmds) => {
@@ -1220,28 +1443,37 @@ impl App {
                 };
                 self.syntax_deadlines
                     .insert(document_id, (deadline, revision));
+                self.perf.latency.await_syntax(document_id, revision);
             }
 
             Cmd::RunSyntaxParse {
                 document_id,
                 revision,
-                source,
+                snapshot,
+                edits,
                 language,
+                priority_lines,
+                has_highlights,
+                visible,
             } => {
                 tracing::debug!(
-                    "RunSyntaxParse: doc={} rev={} lang={:?} len={}",
+                    "RunSyntaxParse: doc={} rev={} lang={:?} len={} edits={:?}",
                     document_id.0,
                     revision,
                     language,
-                    source.len()
+                    snapshot.len_bytes(),
+                    edits.as_ref().map(|d| d.edits.len())
                 );
-                let syntax_tx = self.syntax_tx.clone();
-                if let Err(e) = syntax_tx.send(SyntaxWorkerRequest::Parse(SyntaxParseRequest {
+                if let Err(e) = self.syntax_workers.parse(SyntaxParseRequest {
                     document_id,
                     revision,
-                    source,
+                    snapshot,
+                    edits,
                     language,
-                })) {
+                    priority_lines,
+                    has_highlights,
+                    visible,
+                }) {
                     tracing::warn!("Failed to send syntax parse request: {}", e);
                 }
             }
@@ -1249,13 +1481,16 @@ impl App {
             Cmd::ClearSyntaxState { document_id } => {
                 tracing::debug!("ClearSyntaxState: doc={}", document_id.0);
                 self.syntax_deadlines.remove(&document_id);
-                if let Err(e) = self
-                    .syntax_tx
-                    .send(SyntaxWorkerRequest::ClearDocument(document_id))
-                {
+                if let Err(e) = self.syntax_workers.clear_document(document_id) {
                     tracing::warn!("Failed to send syntax clear request: {}", e);
                 }
             }
+            Cmd::EvictSyntaxCache { document_ids } => {
+                tracing::debug!("EvictSyntaxCache: {} documents", document_ids.len());
+                if let Err(e) = self.syntax_workers.evict_documents(&document_ids) {
+                    tracing::warn!("Failed to send syntax eviction request: {}", e);
+                }
+            }
 
             // =====================================================================
             // Application Commands
@@ -1280,6 +1515,17 @@ impl App {
             // Log syntax-related messages for debugging
             if let Msg::Syntax(ref syntax_msg) = msg {
                 tracing::debug!("Received async syntax message: {:?}", syntax_msg);
+                match *syntax_msg {
+                    SyntaxMsg::LanguageInitialized { language, elapsed } => {
+                        self.perf.record_language_init(language, elapsed);
+                    }
+                    SyntaxMsg::ParseCompleted {
+                        document_id,
+                        revision,
+                        ..
+                    } => self.perf.latency.syntax_completed(document_id, revision),
+                    _ => {}
+                }
             }
 
             if let Some(cmd) = update(&mut self.model, msg) {
@@ -1409,6 +1655,7 @@ impl ApplicationHandler for App {
 
             self.window = Some(window);
             self.context = Some(context);
+            self.update_refresh_rate();
 
             // Dispatch background loads for any additional startup files
             for path in std::mem::take(&mut self.pending_file_loads) {
@@ -1424,34 +1671,60 @@ impl ApplicationHandler for App {
         event: WindowEvent,
     ) {
         let should_exit = matches!(event, WindowEvent::CloseRequested);
-        let should_redraw = if let Some(window) = &self.window {
-            if window_id == window.id() && !should_exit {
-                if let Some(cmd) = self.handle_event(&event) {
-                    let needs_redraw = cmd.needs_redraw();
-                    // Accumulate damage from command
-                    self.pending_damage.merge(cmd.damage());
-                    self.process_cmd(cmd);
-                    needs_redraw
+        let is_app_window = self
+            .window
+            .as_ref()
+            .is_some_and(|window| window.id() == window_id);
+
+        if is_app_window && !should_exit {
+            let arrived = Instant::now();
+            if is_coalescable(&event) {
+                let merged = match &mut self.coalesced_input {
+                    Some(pending) => coalesce_into(&mut pending.event, &event),
+                    None => false,
+                };
+                if merged {
+                    self.perf.pacing.record_coalesced(1);
                 } else {
-                    false
+                    self.flush_coalesced_input();
+                    self.coalesced_input = Some(CoalescedInput { event, arrived });
                 }
             } else {
-                false
+                // Keep event order: held-back moves and scrolls go first
+                self.flush_coalesced_input();
+                self.dispatch_event(&event, arrived);
             }
-        } else {
-            false
-        };
+        }
 
         if should_exit || self.should_quit {
             event_loop.exit();
-        } else if should_redraw {
-            if let Some(window) = &self.window {
-                window.request_redraw();
+        }
+    }
+
+    fn exiting(&mut self, _event_loop: &ActiveEventLoop) {
+        if let Some(path) = token::latency::report_path_from_env() {
+            match self.perf.latency.write_report(&path) {
+                Ok(()) => tracing::info!("Wrote latency report to {}", path.display()),
+                Err(e) => tracing::warn!("Failed to write latency report: {}", e),
             }
         }
+        if let Some(events) = token::replay::stop_recording() {
+            tracing::info!("Recorded {} session events", events);
+        }
+        let pacing = &self.perf.pacing;
+        tracing::info!(
+            "Frame pacing: {} frames, {} late, {} dropped, {} input events coalesced",
+            pacing.frames,
+            pacing.late_frames,
+            pacing.dropped_frames,
+            pacing.coalesced_events
+        );
     }
 
     fn about_to_wait(&mut self, event_loop: &ActiveEventLoop) {
+        // The queue is drained: a burst of moves or scrolls is one update
+        self.flush_coalesced_input();
+
         let mut needs_redraw = false;
 
         if self.process_async_messages() {
@@ -1469,9 +1742,7 @@ impl ApplicationHandler for App {
         }
 
         if needs_redraw {
-            if let Some(window) = &self.window {
-                window.request_redraw();
-            }
+            self.schedule_redraw();
         }
 
         // Check if cursor blink timer has elapsed
@@ -1479,26 +1750,38 @@ impl ApplicationHandler for App {
         let time_since_tick = now.duration_since(self.last_tick);
         let blink_interval = Duration::from_millis(self.model.config.cursor_blink_ms);
 
-        if time_since_tick >= blink_interval {
+        if self.cursor_blink_active(now) && time_since_tick >= blink_interval {
             self.last_tick = now;
             if let Some(cmd) = self.tick() {
                 // Accumulate damage from cursor blink
                 self.pending_damage.merge(cmd.damage());
-                if let Some(window) = &self.window {
-                    window.request_redraw();
-                }
+                self.schedule_redraw();
             }
         }
 
-        // Use WaitUntil to wake up for the next cursor blink
-        // This avoids spinning the event loop constantly (Poll mode)
-        // while still handling async messages, fs changes, and cursor blinks
-        // Calculate next wake time: earliest of blink timer and syntax deadlines
-        let mut next_wake = self.last_tick + blink_interval;
-        if let Some(earliest_deadline) = self.syntax_deadlines.values().map(|(d, _)| *d).min() {
-            next_wake = next_wake.min(earliest_deadline);
+        // Redraws held back to the refresh interval
+        if self.frame_scheduler.poll(now) {
+            if let Some(window) = &self.window {
+                window.request_redraw();
+            }
         }
-        event_loop.set_control_flow(ControlFlow::WaitUntil(next_wake));
+
+        // Wake up for the next cursor blink, syntax deadline or paced frame.
+        // With none of those (idle or unfocused) sleep until an event
+        // arrives; background threads wake the loop through `LoopWaker`.
+        let next_wake = [
+            self.cursor_blink_active(now)
+                .then(|| self.last_tick + blink_interval),
+            self.syntax_deadlines.values().map(|(d, _)| *d).min(),
+            self.frame_scheduler.wake_at(),
+        ]
+        .into_iter()
+        .flatten()
+        .min();
+        event_loop.set_control_flow(match next_wake {
+            Some(deadline) => ControlFlow::WaitUntil(deadline),
+            None => ControlFlow::Wait,
+        });
     }
 }
 
@@ -1575,9 +1858,7 @@ impl App {
         ) {
             // Accumulate damage from file system change
             self.pending_damage.merge(cmd.damage());
-            if cmd.needs_redraw() {
-                return true;
-            }
+            self.process_cmd(cmd);
         }
 
         true
@@ -1597,6 +1878,28 @@ mod tests {
         }
     }
 
+    #[test]
+    fn cursor_blink_pauses_when_idle_or_unfocused() {
+        let mut app = App::new(800, 600, empty_startup_config());
+        let start = app.last_input;
+        assert!(app.cursor_blink_active(start));
+
+        let idle = start + CURSOR_BLINK_IDLE_TIMEOUT;
+        assert!(!app.cursor_blink_active(idle));
+        // A hidden cursor keeps blinking until it is shown again
+        app.model.ui.cursor_visible = false;
+        assert!(app.cursor_blink_active(idle));
+        app.model.ui.cursor_visible = true;
+
+        // Input restarts the blink
+        app.note_activity(idle);
+        assert!(app.cursor_blink_active(idle));
+        assert_eq!(app.last_tick, idle);
+
+        app.window_focused = false;
+        assert!(!app.cursor_blink_active(idle));
+    }
+
     #[test]
     fn spawn_terminal_command_adds_session_to_model() {
         use std::time::{Duration, Instant};
@@ -1690,99 +1993,95 @@ mod tests {
     }
 }
 
-/// Syntax highlighting worker thread loop
-fn syntax_worker_loop(rx: Receiver<SyntaxWorkerRequest>, msg_tx: Sender<Msg>) {
-    use std::collections::HashMap;
-
-    tracing::info!("Syntax worker thread started");
+/// Distinct recent-file languages whose grammars are pre-warmed at startup
+const PREWARM_RECENT_LANGUAGES: usize = 6;
 
-    let mut parser_state = ParserState::new();
-    let mut pending: HashMap<token::model::editor_area::DocumentId, SyntaxParseRequest> =
-        HashMap::new();
+/// Minimum time between progress updates while streaming a large file
+const LARGE_FILE_PROGRESS_INTERVAL: Duration = Duration::from_millis(100);
 
-    loop {
-        // Wait for first request (blocking)
-        match rx.recv() {
-            Ok(req) => handle_syntax_worker_request(&mut pending, &mut parser_state, req),
-            Err(_) => {
-                tracing::info!("Syntax worker channel closed, exiting");
-                return;
+/// Read a large file in chunks and send the growing rope to the main thread.
+///
+/// The first chunk is sent immediately so the start of the file shows up
+/// right away; after that sends are throttled, because each one makes the UI
+/// swap buffers and redraw. Stops early once the document is closed
+/// (`cancel` is set) or the main thread has gone away.
+fn stream_large_file(
+    tx: Sender<Msg>,
+    document_id: token::model::editor_area::DocumentId,
+    path: std::path::PathBuf,
+    cancel: Arc<AtomicBool>,
+) {
+    let mut last_sent: Option<Instant> = None;
+    let mut disconnected = false;
+    let result = std::fs::File::open(&path).and_then(|file| {
+        token::util::read_rope_chunked(file, |rope, bytes_read| {
+            if cancel.load(Ordering::Relaxed) {
+                return false;
             }
-        }
-
-        // Drain any additional pending requests (non-blocking)
-        // Keep only the latest request per document
-        while let Ok(req) = rx.try_recv() {
-            handle_syntax_worker_request(&mut pending, &mut parser_state, req);
-        }
-
-        // Process all pending requests
-        for (_doc_id, req) in pending.drain() {
-            tracing::debug!(
-                "Worker parsing: doc={} rev={} lang={:?}",
-                req.document_id.0,
-                req.revision,
-                req.language
-            );
-
-            let highlights = parser_state.parse_and_highlight(
-                &req.source,
-                req.language,
-                req.document_id,
-                req.revision,
-            );
-
-            // Extract outline from the cached tree (just parsed above)
-            let outline = parser_state
-                .get_cached_tree(req.document_id)
-                .map(|(tree, lang)| {
-                    token::outline::extract_outline(tree, &req.source, lang, req.revision)
-                });
-
-            let line_count = highlights.lines.len();
-            let token_count: usize = highlights.lines.values().map(|lh| lh.tokens.len()).sum();
+            if last_sent.is_some_and(|t| t.elapsed() < LARGE_FILE_PROGRESS_INTERVAL) {
+                return true;
+            }
+            last_sent = Some(Instant::now());
+            disconnected = tx
+                .send(Msg::App(AppMsg::LargeFileChunk {
+                    document_id,
+                    buffer: rope.clone(),
+                    bytes_read,
+                    finished: false,
+                }))
+                .is_err();
+            !disconnected
+        })
+    });
+    if disconnected || cancel.load(Ordering::Relaxed) {
+        tracing::debug!("Stopped streaming {}", path.display());
+        return;
+    }
 
-            tracing::debug!(
-                "Worker sending ParseCompleted: doc={} rev={} lines={} tokens={} outline={}",
-                req.document_id.0,
-                req.revision,
-                line_count,
-                token_count,
-                outline.as_ref().map(|o| o.roots.len()).unwrap_or(0)
-            );
+    let msg = match result {
+        Ok(buffer) => AppMsg::LargeFileChunk {
+            document_id,
+            bytes_read: buffer.len_bytes() as u64,
+            buffer,
+            finished: true,
+        },
+        Err(e) => AppMsg::LargeFileFailed {
+            document_id,
+            error: e.to_string(),
+        },
+    };
+    if let Err(e) = tx.send(Msg::App(msg)) {
+        tracing::warn!("Failed to send large file result to main thread: {}", e);
+    }
+}
 
-            if let Err(e) = msg_tx.send(Msg::Syntax(SyntaxMsg::ParseCompleted {
-                document_id: req.document_id,
-                revision: req.revision,
-                highlights,
-                outline,
-            })) {
-                tracing::warn!("Failed to send parse completion to main thread: {}", e);
-            }
-        }
+/// Run a background workspace scan, streaming listings to the main thread
+fn scan_workspace(tx: Sender<Msg>, request: token::model::ScanRequest) {
+    let generation = request.generation;
+    token::model::workspace_scan::scan_directories(request.dirs, |dirs| {
+        tx.send(Msg::Workspace(WorkspaceMsg::ScanBatch { generation, dirs }))
+            .is_ok()
+    });
+    if let Err(e) = tx.send(Msg::Workspace(WorkspaceMsg::ScanFinished { generation })) {
+        tracing::warn!("Failed to send workspace scan result to main thread: {}", e);
     }
 }
 
-fn handle_syntax_worker_request(
-    pending: &mut HashMap<token::model::editor_area::DocumentId, SyntaxParseRequest>,
-    parser_state: &mut ParserState,
-    request: SyntaxWorkerRequest,
-) {
-    match request {
-        SyntaxWorkerRequest::Parse(req) => {
-            tracing::debug!(
-                "Worker queued parse request: doc={} rev={} lang={:?}",
-                req.document_id.0,
-                req.revision,
-                req.language
-            );
-            pending.insert(req.document_id, req);
-        }
-        SyntaxWorkerRequest::ClearDocument(document_id) => {
-            tracing::debug!("Worker clearing cached syntax state: doc={}", document_id.0);
-            pending.remove(&document_id);
-            parser_state.clear_doc_cache(document_id);
-        }
+/// Run a background find-in-files search, streaming matches to the main thread
+fn find_in_files(tx: Sender<Msg>, request: token::model::FileSearchRequest) {
+    let search_id = request.id;
+    let summary = token::model::find_in_files::search_files(&request, |files| {
+        tx.send(Msg::FindInFiles(FindInFilesMsg::Results {
+            search_id,
+            files,
+        }))
+        .is_ok()
+    });
+    if let Err(e) = tx.send(Msg::FindInFiles(FindInFilesMsg::Finished {
+        search_id,
+        summary,
+    })) {
+        tracing::warn!("Failed to send find-in-files result to main thread: {}", e);
     }
 }
 
@@ -1821,7 +2120,6 @@ impl ScrollAccumulator {
         char_width: f64,
         line_height: f64,
     ) -> (i32, i32) {
-        use winit::event::MouseScrollDelta;
         match delta {
             // Discrete mouse-wheel notches are already whole steps; no
             // sub-unit remainder to accumulate.
@@ -1844,9 +2142,75 @@ impl ScrollAccumulator {
     }
 }
 
+/// Whether `event` may be held back and merged with later events of its
+/// kind until the event queue drains
+fn is_coalescable(event: &WindowEvent) -> bool {
+    matches!(
+        event,
+        WindowEvent::CursorMoved { .. } | WindowEvent::MouseWheel { .. }
+    )
+}
+
+/// Merge `next` into the held-back `pending` event: a cursor move replaces
+/// an earlier one from the same device, and wheel scrolls in the same unit
+/// add up. Returns false when the two can't be merged.
+fn coalesce_into(pending: &mut WindowEvent, next: &WindowEvent) -> bool {
+    match (pending, next) {
+        (
+            WindowEvent::CursorMoved {
+                device_id,
+                position,
+            },
+            WindowEvent::CursorMoved {
+                device_id: next_device,
+                position: next_position,
+            },
+        ) if *device_id == *next_device => {
+            *position = *next_position;
+            true
+        }
+        (
+            WindowEvent::MouseWheel {
+                device_id,
+                delta,
+                phase,
+            },
+            WindowEvent::MouseWheel {
+                device_id: next_device,
+                delta: next_delta,
+                phase: next_phase,
+            },
+        ) if *device_id == *next_device => match merge_scroll_deltas(*delta, *next_delta) {
+            Some(merged) => {
+                *delta = merged;
+                *phase = *next_phase;
+                true
+            }
+            None => false,
+        },
+        _ => false,
+    }
+}
+
+/// Sum two wheel deltas in the same unit. `ScrollAccumulator` is linear in
+/// pixel deltas, so a summed burst scrolls as far as its events one by one.
+fn merge_scroll_deltas(a: MouseScrollDelta, b: MouseScrollDelta) -> Option<MouseScrollDelta> {
+    match (a, b) {
+        (MouseScrollDelta::LineDelta(x1, y1), MouseScrollDelta::LineDelta(x2, y2)) => {
+            Some(MouseScrollDelta::LineDelta(x1 + x2, y1 + y2))
+        }
+        (MouseScrollDelta::PixelDelta(p1), MouseScrollDelta::PixelDelta(p2)) => {
+            Some(MouseScrollDelta::PixelDelta(
+                winit::dpi::PhysicalPosition::new(p1.x + p2.x, p1.y + p2.y),
+            ))
+        }
+        _ => None,
+    }
+}
+
 #[cfg(test)]
 mod mouse_wheel_tests {
-    use super::ScrollAccumulator;
+    use super::{merge_scroll_deltas, ScrollAccumulator};
     use winit::dpi::PhysicalPosition;
     use winit::event::MouseScrollDelta;
 
@@ -1892,4 +2256,39 @@ mod mouse_wheel_tests {
         // 4 × 6px = 24px ≈ 1.5 lines → one line emitted, remainder carried.
         assert_eq!(emitted, -1);
     }
+
+    #[test]
+    fn merged_pixel_deltas_scroll_as_far_as_the_burst() {
+        let burst = [6.0, 7.5, -2.0, 9.0, 4.5];
+
+        let mut one_by_one = ScrollAccumulator::default();
+        let mut stepped = 0;
+        for dy in burst {
+            let (_, v) = one_by_one.deltas(
+                MouseScrollDelta::PixelDelta(PhysicalPosition::new(0.0, dy)),
+                8.0,
+                16.0,
+            );
+            stepped += v;
+        }
+
+        let merged = burst
+            .iter()
+            .map(|&dy| MouseScrollDelta::PixelDelta(PhysicalPosition::new(0.0, dy)))
+            .reduce(|a, b| merge_scroll_deltas(a, b).unwrap())
+            .unwrap();
+        let (_, v) = ScrollAccumulator::default().deltas(merged, 8.0, 16.0);
+        assert_eq!(v, stepped);
+    }
+
+    #[test]
+    fn wheel_deltas_in_different_units_are_not_merged() {
+        let line = MouseScrollDelta::LineDelta(0.0, 1.0);
+        let pixel = MouseScrollDelta::PixelDelta(PhysicalPosition::new(0.0, 4.0));
+        assert!(merge_scroll_deltas(line, pixel).is_none());
+        assert!(matches!(
+            merge_scroll_deltas(line, line),
+            Some(MouseScrollDelta::LineDelta(x, y)) if x == 0.0 && y == 2.0
+        ));
+    }
 }
@@ -13,12 +13,14 @@
 
 use std::time::{Duration, Instant};
 
+use winit::event::{ElementState, WindowEvent};
 use winit::keyboard::{Key, NamedKey};
 
 use token::commands::Cmd;
+use token::latency::InputKind;
 use token::messages::{
-    CsvMsg, Direction, DocumentMsg, EditorMsg, LayoutMsg, ModalMsg, Msg, OutlineMsg, TerminalMsg,
-    UiMsg, WorkspaceMsg,
+    CsvMsg, Direction, DocumentMsg, EditorMsg, FindInFilesMsg, LayoutMsg, ModalMsg, Msg,
+    OutlineMsg, TerminalMsg, UiMsg, WorkspaceMsg,
 };
 use token::model::AppModel;
 use token::panel::{DockPosition, PanelId};
@@ -66,6 +68,23 @@ impl OptionKeyGesture {
     }
 }
 
+/// Kind of input `event` is, for latency tracking, or `None` for events a
+/// user doesn't wait on (releases, cursor motion, redraws)
+pub fn latency_kind(event: &WindowEvent) -> Option<InputKind> {
+    match event {
+        WindowEvent::KeyboardInput { event, .. } if event.state == ElementState::Pressed => {
+            Some(InputKind::Key)
+        }
+        WindowEvent::MouseInput {
+            state: ElementState::Pressed,
+            ..
+        } => Some(InputKind::MouseButton),
+        WindowEvent::MouseWheel { .. } => Some(InputKind::MouseWheel),
+        WindowEvent::Resized(_) => Some(InputKind::Resize),
+        _ => None,
+    }
+}
+
 /// Handle keyboard input for special cases not covered by keymap
 ///
 /// Called as a fallback when:
@@ -115,6 +134,11 @@ pub fn handle_key(
         return handle_outline_dock_key(model, &key).or(Some(Cmd::Redraw));
     }
 
+    // Focus capture: route keys to search results when bottom dock search has focus
+    if is_search_dock_focused(model) {
+        return handle_search_dock_key(model, &key).or(Some(Cmd::Redraw));
+    }
+
     // Focus capture: route keys to terminal panel when bottom dock terminal has focus
     if is_terminal_dock_focused(model) {
         return handle_terminal_dock_key(model, &key, modifiers).or(Some(Cmd::Redraw));
@@ -681,6 +705,36 @@ fn handle_outline_dock_key(model: &mut AppModel, key: &Key) -> Option<Cmd> {
     }
 }
 
+/// Check if the find-in-files results (bottom dock) have keyboard focus
+fn is_search_dock_focused(model: &AppModel) -> bool {
+    if model.ui.focused_dock() != Some(DockPosition::Bottom) {
+        return false;
+    }
+
+    let bottom_dock = model.dock_layout.dock(DockPosition::Bottom);
+    bottom_dock.is_open && bottom_dock.active_panel() == Some(PanelId::Search)
+}
+
+/// Handle keyboard input when the search results panel is focused
+fn handle_search_dock_key(model: &mut AppModel, key: &Key) -> Option<Cmd> {
+    match key {
+        Key::Named(NamedKey::ArrowUp) => {
+            update(model, Msg::FindInFiles(FindInFilesMsg::SelectPrevious))
+        }
+        Key::Named(NamedKey::ArrowDown) => {
+            update(model, Msg::FindInFiles(FindInFilesMsg::SelectNext))
+        }
+        Key::Named(NamedKey::Enter) => {
+            update(model, Msg::FindInFiles(FindInFilesMsg::OpenSelected))
+        }
+        Key::Named(NamedKey::Escape) => {
+            model.ui.focus_editor();
+            Some(Cmd::Redraw)
+        }
+        _ => None,
+    }
+}
+
 /// Check if the terminal panel (bottom dock) has keyboard focus.
 fn is_terminal_dock_focused(model: &AppModel) -> bool {
     if model.ui.focused_dock() != Some(DockPosition::Bottom) {
@@ -5,12 +5,16 @@
 //! - `input` - Keyboard/mouse event to message mapping
 //! - `mouse` - Unified mouse event handling with hit-testing
 //! - `perf` - Performance overlay (debug builds only)
+//! - `syntax_worker` - Background syntax parsing thread pool
+//! - `wake` - Waking the event loop from background threads
 //! - `webview` - Webview management for markdown preview
 
 pub mod app;
 pub mod input;
 pub mod mouse;
 pub mod perf;
+mod syntax_worker;
+mod wake;
 pub mod webview;
 
 pub use app::App;
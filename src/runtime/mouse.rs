@@ -13,15 +13,17 @@ use winit::keyboard::ModifiersState;
 
 use token::commands::Cmd;
 use token::messages::{
-    CsvMsg, EditorMsg, ImageMsg, LayoutMsg, ModalMsg, Msg, OutlineMsg, PreviewMsg, TerminalMsg,
-    UiMsg, WorkspaceMsg,
+    CsvMsg, EditorMsg, FindInFilesMsg, ImageMsg, LayoutMsg, ModalMsg, Msg, OutlineMsg, PreviewMsg,
+    TerminalMsg, UiMsg, WorkspaceMsg,
 };
 use token::model::AppModel;
 use token::update::update;
 use token::util::visible_tree_row_at_index;
 
 use token::model::editor_area::GroupId;
-use token::view::geometry::{DockHeaderLayout, OutlinePanelLayout, TabBarLayout, WindowLayout};
+use token::view::geometry::{
+    DockHeaderLayout, OutlinePanelLayout, SearchPanelLayout, TabBarLayout, WindowLayout,
+};
 use token::view::hit_test::{hit_test_ui, EventResult, HitTarget, MouseEvent};
 use token::view::Renderer;
 
@@ -40,6 +42,9 @@ pub enum ClickRegion {
     Outline {
         row: usize,
     },
+    SearchResult {
+        row: usize,
+    },
     BinaryPlaceholder {
         group: token::model::editor_area::GroupId,
     },
@@ -853,6 +858,41 @@ fn handle_left_click(
                 return EventResult::consumed_with_focus(FocusTarget::Dock(*position));
             }
 
+            // Handle find-in-files result clicks
+            if *active_panel_id == token::panel::PanelId::Search {
+                let window_layout = WindowLayout::compute(model, model.line_height);
+                let dock_rect = match position {
+                    token::panel::DockPosition::Right => window_layout.right_dock_rect,
+                    token::panel::DockPosition::Bottom => window_layout.bottom_dock_rect,
+                    token::panel::DockPosition::Left => None,
+                };
+                let Some(dock_rect) = dock_rect else {
+                    return EventResult::consumed_with_focus(FocusTarget::Dock(*position));
+                };
+                let dock = model.dock_layout.dock(*position);
+                let dock_layout =
+                    DockHeaderLayout::new(dock, dock_rect, &model.metrics, model.char_width);
+                let search_layout =
+                    SearchPanelLayout::new(dock_layout.content_rect, &model.metrics);
+
+                if let Some(clicked_index) = search_layout
+                    .results
+                    .row_index_at_y(event.pos.y as f32, model.find_in_files.scroll_offset)
+                {
+                    let click_count =
+                        click_tracker.track_click(ClickRegion::SearchResult { row: clicked_index });
+                    update(
+                        model,
+                        Msg::FindInFiles(FindInFilesMsg::ClickRow {
+                            index: clicked_index,
+                            click_count,
+                        }),
+                    );
+                }
+
+                return EventResult::consumed_with_focus(FocusTarget::Dock(*position));
+            }
+
             // For left dock (file explorer), return sidebar focus
             match position {
                 token::panel::DockPosition::Left => {
@@ -1111,6 +1151,11 @@ pub fn handle_mouse_wheel(
             };
             if active_panel == Some(token::panel::PanelId::Outline) && v_delta != 0 {
                 update(model, Msg::Outline(OutlineMsg::Scroll { lines: v_delta }))
+            } else if active_panel == Some(token::panel::PanelId::Search) && v_delta != 0 {
+                update(
+                    model,
+                    Msg::FindInFiles(FindInFilesMsg::Scroll { lines: v_delta }),
+                )
             } else if active_panel == Some(token::panel::PanelId::TERMINAL) && v_delta != 0 {
                 let lines = v_delta.unsigned_abs() as usize;
                 let msg = if v_delta < 0 {
@@ -0,0 +1,631 @@
+//! Syntax worker pool
+//!
+//! Parsing and highlighting run on a small pool of background threads. Each
+//! document is pinned to one worker for as long as it is open, so its cached
+//! tree (and the `ParserState` holding it, whose parsers are `!Sync`) never
+//! moves between threads and needs no locking. A document seen for the first
+//! time goes to the least busy worker, which lets idle workers pick up new
+//! work while another one is stuck in a big parse.
+//!
+//! Within a worker, documents shown in an active tab are parsed before
+//! background tabs, and whole-document passes for visible documents run
+//! before those for hidden ones.
+//!
+//! Outlines are updated incrementally from the tree diff of each parse and
+//! only included in a `ParseCompleted` when they changed.
+//!
+//! Grammars are initialized lazily by each worker's `ParserState`. At startup
+//! the languages of recently opened files are pre-warmed on every worker,
+//! one language per idle step, so opening one of them later skips the query
+//! compile. Init times are reported to the UI thread for `PerfStats`.
+//!
+//! Each worker reports its cached parse-state bytes per document whenever
+//! they change, for memory accounting; the UI answers with evictions when
+//! the parser cache is over its soft cap.
+
+use std::collections::{HashMap, VecDeque};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::mpsc::{self, Receiver, SendError, Sender};
+use std::sync::Arc;
+
+use token::messages::{Msg, SyntaxMsg};
+use token::model::editor_area::DocumentId;
+use token::outline::OutlineCache;
+use token::syntax::{EditDelta, LanguageId, ParserState};
+
+/// Upper bound on syntax worker threads
+const MAX_SYNTAX_WORKERS: usize = 4;
+
+/// Request sent to a syntax worker thread
+pub(super) struct SyntaxParseRequest {
+    pub document_id: DocumentId,
+    pub revision: u64,
+    pub snapshot: ropey::Rope,
+    pub edits: Option<EditDelta>,
+    pub language: LanguageId,
+    /// Lines to highlight before the rest of the document
+    pub priority_lines: Option<std::ops::Range<usize>>,
+    /// Whether the UI has highlights to keep outside `priority_lines`
+    pub has_highlights: bool,
+    /// Whether an active tab shows the document
+    pub visible: bool,
+}
+
+/// Whole-document highlight pass queued behind a viewport-first pass
+struct DeferredHighlightPass {
+    document_id: DocumentId,
+    revision: u64,
+    visible: bool,
+}
+
+enum SyntaxWorkerRequest {
+    Parse(SyntaxParseRequest),
+    ClearDocument(DocumentId),
+    /// Drop the document's cached trees, keeping its queued parse and outline
+    Evict(DocumentId),
+    /// Initialize these grammars when there is nothing else to do
+    Prewarm(Vec<LanguageId>),
+}
+
+/// Sending half of one worker thread
+struct SyntaxWorker {
+    tx: Sender<SyntaxWorkerRequest>,
+    /// Parse requests sent but not yet answered, plus queued background
+    /// passes; used to route new documents to the least busy worker
+    load: Arc<AtomicUsize>,
+}
+
+/// Pool of syntax worker threads with per-document affinity
+pub(super) struct SyntaxWorkerPool {
+    workers: Vec<SyntaxWorker>,
+    affinity: HashMap<DocumentId, usize>,
+}
+
+impl SyntaxWorkerPool {
+    /// Spawn one worker per spare core, up to `MAX_SYNTAX_WORKERS`
+    pub fn new(msg_tx: Sender<Msg>) -> Self {
+        let cores = std::thread::available_parallelism().map_or(1, |n| n.get());
+        Self::with_workers(cores.saturating_sub(1).clamp(1, MAX_SYNTAX_WORKERS), msg_tx)
+    }
+
+    pub fn with_workers(count: usize, msg_tx: Sender<Msg>) -> Self {
+        let workers = (0..count.max(1))
+            .map(|index| {
+                let (tx, rx) = mpsc::channel();
+                let load = Arc::new(AtomicUsize::new(0));
+                let worker_load = Arc::clone(&load);
+                let worker_msg_tx = msg_tx.clone();
+                if let Err(e) = std::thread::Builder::new()
+                    .name(format!("syntax-{}", index))
+                    .spawn(move || syntax_worker_loop(index, rx, worker_msg_tx, worker_load))
+                {
+                    tracing::warn!("Failed to spawn syntax worker {}: {}", index, e);
+                }
+                SyntaxWorker { tx, load }
+            })
+            .collect();
+
+        Self {
+            workers,
+            affinity: HashMap::new(),
+        }
+    }
+
+    /// Queue a parse on the worker that owns the document, pinning it to the
+    /// least busy worker if this is its first request
+    pub fn parse(&mut self, request: SyntaxParseRequest) -> Result<(), String> {
+        let index = self.worker_for(request.document_id);
+        let worker = &self.workers[index];
+        worker.load.fetch_add(1, Ordering::Relaxed);
+        worker
+            .tx
+            .send(SyntaxWorkerRequest::Parse(request))
+            .map_err(|SendError(_)| {
+                worker.load.fetch_sub(1, Ordering::Relaxed);
+                format!("syntax worker {} has exited", index)
+            })
+    }
+
+    /// Drop a document's cached syntax state and release its worker pin
+    pub fn clear_document(&mut self, document_id: DocumentId) -> Result<(), String> {
+        let Some(index) = self.affinity.remove(&document_id) else {
+            return Ok(());
+        };
+        self.workers[index]
+            .tx
+            .send(SyntaxWorkerRequest::ClearDocument(document_id))
+            .map_err(|_| format!("syntax worker {} has exited", index))
+    }
+
+    /// Drop documents' cached parse trees on their workers; they stay
+    /// pinned, and their next parse starts from scratch
+    pub fn evict_documents(&self, document_ids: &[DocumentId]) -> Result<(), String> {
+        for document_id in document_ids {
+            let Some(&index) = self.affinity.get(document_id) else {
+                continue;
+            };
+            self.workers[index]
+                .tx
+                .send(SyntaxWorkerRequest::Evict(*document_id))
+                .map_err(|_| format!("syntax worker {} has exited", index))?;
+        }
+        Ok(())
+    }
+
+    /// Pre-warm grammars on every worker in the background
+    ///
+    /// Any worker may receive the next new document, so each one initializes
+    /// its own copy. Pre-warming yields to parse requests and is not counted
+    /// in the workers' load.
+    pub fn prewarm(&self, languages: Vec<LanguageId>) {
+        if languages.is_empty() {
+            return;
+        }
+        for (index, worker) in self.workers.iter().enumerate() {
+            if worker
+                .tx
+                .send(SyntaxWorkerRequest::Prewarm(languages.clone()))
+                .is_err()
+            {
+                tracing::warn!("Syntax worker {} has exited, skipping pre-warm", index);
+            }
+        }
+    }
+
+    fn worker_for(&mut self, document_id: DocumentId) -> usize {
+        if let Some(&index) = self.affinity.get(&document_id) {
+            return index;
+        }
+        let loads: Vec<usize> = self
+            .workers
+            .iter()
+            .map(|worker| worker.load.load(Ordering::Relaxed))
+            .collect();
+        let index = least_loaded_worker(&loads);
+        self.affinity.insert(document_id, index);
+        index
+    }
+}
+
+/// Index of the idlest worker, preferring lower indices on ties
+fn least_loaded_worker(loads: &[usize]) -> usize {
+    loads
+        .iter()
+        .enumerate()
+        .min_by_key(|&(index, &load)| (load, index))
+        .map_or(0, |(index, _)| index)
+}
+
+/// Syntax highlighting worker thread loop
+///
+/// Requests that carry priority lines are answered in two steps: the
+/// viewport is highlighted and sent right away, and the whole-document pass
+/// is deferred until no newer requests are waiting. A deferred pass is
+/// dropped when a newer request for the same document supersedes it.
+fn syntax_worker_loop(
+    index: usize,
+    rx: Receiver<SyntaxWorkerRequest>,
+    msg_tx: Sender<Msg>,
+    load: Arc<AtomicUsize>,
+) {
+    tracing::info!("Syntax worker {} started", index);
+
+    let mut parser_state = ParserState::new();
+    let mut pending: HashMap<DocumentId, SyntaxParseRequest> = HashMap::new();
+    let mut deferred: Vec<DeferredHighlightPass> = Vec::new();
+    let mut prewarm: VecDeque<LanguageId> = VecDeque::new();
+    let mut outlines: HashMap<DocumentId, OutlineCache> = HashMap::new();
+    let mut reported_memory: Vec<(DocumentId, usize)> = Vec::new();
+
+    loop {
+        // Block for the next request only when no background work is queued
+        let first = if deferred.is_empty() && prewarm.is_empty() {
+            match rx.recv() {
+                Ok(req) => Some(req),
+                Err(_) => {
+                    tracing::info!("Syntax worker {} channel closed, exiting", index);
+                    return;
+                }
+            }
+        } else {
+            match rx.try_recv() {
+                Ok(req) => Some(req),
+                Err(mpsc::TryRecvError::Empty) => None,
+                Err(mpsc::TryRecvError::Disconnected) => {
+                    tracing::info!("Syntax worker {} channel closed, exiting", index);
+                    return;
+                }
+            }
+        };
+
+        let Some(first) = first else {
+            if deferred.is_empty() {
+                // Idle with no open documents waiting: warm up one grammar
+                if let Some(lang) = prewarm.pop_front() {
+                    parser_state.ensure_language(lang);
+                    report_language_inits(&mut parser_state, &msg_tx);
+                }
+                continue;
+            }
+
+            // Idle: run the oldest deferred pass, visible documents first
+            let next = deferred
+                .iter()
+                .position(|pass| pass.visible)
+                .unwrap_or_default();
+            let pass = deferred.remove(next);
+            run_deferred_highlight_pass(&mut parser_state, &msg_tx, pass);
+            load.fetch_sub(1, Ordering::Relaxed);
+            continue;
+        };
+
+        let mut received = handle_syntax_worker_request(
+            &mut pending,
+            &mut prewarm,
+            &mut outlines,
+            &mut parser_state,
+            first,
+        );
+
+        // Drain any additional pending requests (non-blocking)
+        // Keep only the latest request per document
+        while let Ok(req) = rx.try_recv() {
+            received += handle_syntax_worker_request(
+                &mut pending,
+                &mut prewarm,
+                &mut outlines,
+                &mut parser_state,
+                req,
+            );
+        }
+
+        // Newer requests supersede queued background passes
+        let queued_passes = deferred.len();
+        deferred.retain(|pass| !pending.contains_key(&pass.document_id));
+        load.fetch_sub(queued_passes - deferred.len(), Ordering::Relaxed);
+
+        // Process all pending requests, visible documents first
+        let mut batch: Vec<SyntaxParseRequest> = pending.drain().map(|(_, req)| req).collect();
+        batch.sort_by_key(|req| !req.visible);
+        for req in batch {
+            tracing::debug!(
+                "Worker {} parsing: doc={} rev={} lang={:?} priority={:?} visible={}",
+                index,
+                req.document_id.0,
+                req.revision,
+                req.language,
+                req.priority_lines,
+                req.visible
+            );
+
+            let highlights = match req.priority_lines.clone() {
+                Some(lines) => parser_state.parse_and_highlight_lines(
+                    &req.snapshot,
+                    req.edits.as_ref(),
+                    req.language,
+                    req.document_id,
+                    req.revision,
+                    lines,
+                ),
+                None => parser_state.parse_and_highlight_snapshot(
+                    &req.snapshot,
+                    req.edits.as_ref(),
+                    req.language,
+                    req.document_id,
+                    req.revision,
+                ),
+            };
+
+            // Update the outline from the cached tree (just parsed above);
+            // `None` when it hasn't changed since the last one sent
+            let outline_cache = outlines.entry(req.document_id).or_default();
+            if !req.has_highlights {
+                // The UI reset this document's syntax state
+                outline_cache.invalidate();
+            }
+            let outline = parser_state
+                .get_cached_tree(req.document_id)
+                .zip(parser_state.get_cached_snapshot(req.document_id))
+                .and_then(|((tree, lang), source)| {
+                    let previous = parser_state.get_previous_tree(req.document_id);
+                    outline_cache.update(tree, previous, source, lang, req.revision)
+                });
+
+            let line_count = highlights.line_count();
+            let token_count = highlights.token_count();
+
+            tracing::debug!(
+                "Worker sending ParseCompleted: doc={} rev={} lines={} tokens={} outline={:?} covered={:?}",
+                req.document_id.0,
+                req.revision,
+                line_count,
+                token_count,
+                outline.as_ref().map(|o| o.roots.len()),
+                highlights.covered_lines
+            );
+
+            let needs_full_pass = highlights.covered_lines.as_ref().is_some_and(|lines| {
+                parser_state.needs_full_pass(req.document_id, lines, req.has_highlights)
+            });
+            if needs_full_pass {
+                load.fetch_add(1, Ordering::Relaxed);
+                deferred.push(DeferredHighlightPass {
+                    document_id: req.document_id,
+                    revision: req.revision,
+                    visible: req.visible,
+                });
+            }
+
+            if let Err(e) = msg_tx.send(Msg::Syntax(SyntaxMsg::ParseCompleted {
+                document_id: req.document_id,
+                revision: req.revision,
+                highlights,
+                outline,
+            })) {
+                tracing::warn!("Failed to send parse completion to main thread: {}", e);
+            }
+        }
+
+        load.fetch_sub(received, Ordering::Relaxed);
+        report_language_inits(&mut parser_state, &msg_tx);
+        report_parser_cache(index, &parser_state, &mut reported_memory, &msg_tx);
+    }
+}
+
+/// Send the worker's cached parse-state bytes if they changed since the
+/// last report
+fn report_parser_cache(
+    index: usize,
+    parser_state: &ParserState,
+    reported: &mut Vec<(DocumentId, usize)>,
+    msg_tx: &Sender<Msg>,
+) {
+    let documents = parser_state.memory_by_document();
+    if documents == *reported {
+        return;
+    }
+    *reported = documents.clone();
+    let _ = msg_tx.send(Msg::Syntax(SyntaxMsg::ParserCacheReport {
+        worker: index,
+        documents,
+    }));
+}
+
+/// Send grammar init times recorded since the last report to the UI thread
+fn report_language_inits(parser_state: &mut ParserState, msg_tx: &Sender<Msg>) {
+    for (language, elapsed) in parser_state.take_init_timings() {
+        if msg_tx
+            .send(Msg::Syntax(SyntaxMsg::LanguageInitialized {
+                language,
+                elapsed,
+            }))
+            .is_err()
+        {
+            return;
+        }
+    }
+}
+
+/// Highlight the whole document behind an earlier viewport-first pass
+fn run_deferred_highlight_pass(
+    parser_state: &mut ParserState,
+    msg_tx: &Sender<Msg>,
+    pass: DeferredHighlightPass,
+) {
+    let Some(highlights) = parser_state.highlight_cached(pass.document_id, pass.revision) else {
+        tracing::debug!(
+            "Dropping superseded background highlight pass: doc={} rev={}",
+            pass.document_id.0,
+            pass.revision
+        );
+        return;
+    };
+
+    tracing::debug!(
+        "Worker sending background ParseCompleted: doc={} rev={} lines={}",
+        pass.document_id.0,
+        pass.revision,
+        highlights.line_count()
+    );
+
+    if let Err(e) = msg_tx.send(Msg::Syntax(SyntaxMsg::ParseCompleted {
+        document_id: pass.document_id,
+        revision: pass.revision,
+        highlights,
+        // Sent with the viewport pass if it changed
+        outline: None,
+    })) {
+        tracing::warn!("Failed to send parse completion to main thread: {}", e);
+    }
+}
+
+/// Fold one request into the pending set, returning how many parse requests
+/// it carried (for the worker's load count)
+fn handle_syntax_worker_request(
+    pending: &mut HashMap<DocumentId, SyntaxParseRequest>,
+    prewarm: &mut VecDeque<LanguageId>,
+    outlines: &mut HashMap<DocumentId, OutlineCache>,
+    parser_state: &mut ParserState,
+    request: SyntaxWorkerRequest,
+) -> usize {
+    match request {
+        SyntaxWorkerRequest::Parse(mut req) => {
+            tracing::debug!(
+                "Worker queued parse request: doc={} rev={} lang={:?}",
+                req.document_id.0,
+                req.revision,
+                req.language
+            );
+            // A superseded request's edits haven't reached the cached tree
+            // yet, so carry them forward in front of the newer ones.
+            if let Some(prev) = pending.remove(&req.document_id) {
+                req.has_highlights &= prev.has_highlights;
+                req.edits = match (prev.edits, req.edits.take()) {
+                    (Some(mut chained), Some(next)) => {
+                        chained.chain(prev.revision, next).then_some(chained)
+                    }
+                    _ => None,
+                };
+            }
+            pending.insert(req.document_id, req);
+            1
+        }
+        SyntaxWorkerRequest::ClearDocument(document_id) => {
+            tracing::debug!("Worker clearing cached syntax state: doc={}", document_id.0);
+            pending.remove(&document_id);
+            outlines.remove(&document_id);
+            parser_state.clear_doc_cache(document_id);
+            0
+        }
+        SyntaxWorkerRequest::Evict(document_id) => {
+            tracing::debug!("Worker evicting cached trees: doc={}", document_id.0);
+            parser_state.clear_doc_cache(document_id);
+            0
+        }
+        SyntaxWorkerRequest::Prewarm(languages) => {
+            tracing::debug!("Worker queued grammar pre-warm: {:?}", languages);
+            prewarm.extend(
+                languages
+                    .into_iter()
+                    .filter(|&lang| !parser_state.is_language_initialized(lang)),
+            );
+            0
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Pool whose worker channels end in the test instead of threads
+    fn detached_pool(count: usize) -> (SyntaxWorkerPool, Vec<Receiver<SyntaxWorkerRequest>>) {
+        let (workers, receivers) = (0..count)
+            .map(|_| {
+                let (tx, rx) = mpsc::channel();
+                let load = Arc::new(AtomicUsize::new(0));
+                (SyntaxWorker { tx, load }, rx)
+            })
+            .unzip();
+        let pool = SyntaxWorkerPool {
+            workers,
+            affinity: HashMap::new(),
+        };
+        (pool, receivers)
+    }
+
+    fn request(document_id: u64) -> SyntaxParseRequest {
+        SyntaxParseRequest {
+            document_id: DocumentId(document_id),
+            revision: 1,
+            snapshot: ropey::Rope::from("fn main() {}"),
+            edits: None,
+            language: LanguageId::Rust,
+            priority_lines: None,
+            has_highlights: false,
+            visible: true,
+        }
+    }
+
+    fn received_documents(rx: &Receiver<SyntaxWorkerRequest>) -> Vec<(bool, u64)> {
+        rx.try_iter()
+            .map(|req| match req {
+                SyntaxWorkerRequest::Parse(req) => (true, req.document_id.0),
+                SyntaxWorkerRequest::ClearDocument(id) => (false, id.0),
+                SyntaxWorkerRequest::Evict(_) => panic!("unexpected eviction request"),
+                SyntaxWorkerRequest::Prewarm(_) => panic!("unexpected pre-warm request"),
+            })
+            .collect()
+    }
+
+    #[test]
+    fn test_least_loaded_worker_prefers_idle_then_lowest_index() {
+        assert_eq!(least_loaded_worker(&[2, 0, 0]), 1);
+        assert_eq!(least_loaded_worker(&[3, 1, 2]), 1);
+        assert_eq!(least_loaded_worker(&[0, 0]), 0);
+        assert_eq!(least_loaded_worker(&[]), 0);
+    }
+
+    #[test]
+    fn test_documents_stay_pinned_to_their_worker() {
+        let (mut pool, receivers) = detached_pool(2);
+
+        // New documents spread to whichever worker is idle
+        pool.parse(request(1)).unwrap();
+        pool.parse(request(2)).unwrap();
+        // A busy document keeps its worker (and cached tree)
+        pool.parse(request(1)).unwrap();
+        pool.parse(request(1)).unwrap();
+
+        assert_eq!(
+            received_documents(&receivers[0]),
+            vec![(true, 1), (true, 1), (true, 1)]
+        );
+        assert_eq!(received_documents(&receivers[1]), vec![(true, 2)]);
+
+        // Worker 1 is now the idler one for a third document
+        pool.parse(request(3)).unwrap();
+        assert_eq!(received_documents(&receivers[1]), vec![(true, 3)]);
+    }
+
+    #[test]
+    fn test_clear_document_goes_to_owner_and_releases_pin() {
+        let (mut pool, receivers) = detached_pool(2);
+        pool.parse(request(1)).unwrap();
+        pool.parse(request(2)).unwrap();
+        received_documents(&receivers[0]);
+        received_documents(&receivers[1]);
+
+        pool.clear_document(DocumentId(2)).unwrap();
+        assert_eq!(received_documents(&receivers[1]), vec![(false, 2)]);
+        // Unknown documents have no worker state to clear
+        pool.clear_document(DocumentId(9)).unwrap();
+        assert!(received_documents(&receivers[0]).is_empty());
+
+        // Once its load drains, a reopened document can land anywhere
+        pool.workers[0].load.store(5, Ordering::Relaxed);
+        pool.workers[1].load.store(0, Ordering::Relaxed);
+        pool.parse(request(2)).unwrap();
+        assert_eq!(received_documents(&receivers[1]), vec![(true, 2)]);
+    }
+
+    #[test]
+    fn test_evict_goes_to_owner_and_keeps_pin() {
+        let (mut pool, receivers) = detached_pool(2);
+        pool.parse(request(1)).unwrap();
+        pool.parse(request(2)).unwrap();
+        received_documents(&receivers[0]);
+        received_documents(&receivers[1]);
+
+        pool.evict_documents(&[DocumentId(2), DocumentId(9)])
+            .unwrap();
+        let evicted: Vec<_> = receivers[1].try_iter().collect();
+        assert!(matches!(
+            evicted.as_slice(),
+            [SyntaxWorkerRequest::Evict(DocumentId(2))]
+        ));
+        assert!(receivers[0].try_iter().next().is_none());
+
+        // The document's next parse still goes to the worker it was on
+        pool.workers[1].load.store(5, Ordering::Relaxed);
+        pool.parse(request(2)).unwrap();
+        assert_eq!(received_documents(&receivers[1]), vec![(true, 2)]);
+    }
+
+    #[test]
+    fn test_prewarm_reaches_every_worker_without_adding_load() {
+        let (pool, receivers) = detached_pool(3);
+        pool.prewarm(vec![LanguageId::Rust, LanguageId::Python]);
+        pool.prewarm(Vec::new());
+
+        for (rx, worker) in receivers.iter().zip(&pool.workers) {
+            let requests: Vec<_> = rx.try_iter().collect();
+            assert_eq!(requests.len(), 1);
+            assert!(matches!(
+                &requests[0],
+                SyntaxWorkerRequest::Prewarm(langs) if langs == &[LanguageId::Rust, LanguageId::Python]
+            ));
+            assert_eq!(worker.load.load(Ordering::Relaxed), 0);
+        }
+    }
+}
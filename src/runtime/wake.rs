@@ -0,0 +1,52 @@
+//! Waking the event loop from background threads
+//!
+//! Workers report back through the app's `Msg` channel, which the event
+//! loop drains in `about_to_wait`. Without a wakeup the loop would have to
+//! poll that channel on a timer; with one it can sleep in `ControlFlow::Wait`
+//! while the window is idle or unfocused.
+
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Arc, Mutex};
+use std::thread;
+
+use token::messages::Msg;
+use winit::event_loop::EventLoopProxy;
+
+/// Sends an empty user event to the event loop, once it is running
+#[derive(Clone, Default)]
+pub struct LoopWaker {
+    proxy: Arc<Mutex<Option<EventLoopProxy<()>>>>,
+}
+
+impl LoopWaker {
+    pub fn set_proxy(&self, proxy: EventLoopProxy<()>) {
+        *self.proxy.lock().unwrap() = Some(proxy);
+    }
+
+    pub fn wake(&self) {
+        if let Some(proxy) = self.proxy.lock().unwrap().as_ref() {
+            // Fails only once the event loop has exited
+            let _ = proxy.send_event(());
+        }
+    }
+}
+
+/// Create the app's message channel: messages sent on the returned sender
+/// are forwarded to the receiver by a relay thread, which wakes the event
+/// loop after each one
+pub fn waking_channel(waker: LoopWaker) -> (Sender<Msg>, Receiver<Msg>) {
+    let (tx, relay_rx) = mpsc::channel::<Msg>();
+    let (relay_tx, rx) = mpsc::channel();
+
+    thread::spawn(move || {
+        // Ends when every sender is gone or the app dropped its receiver
+        for msg in relay_rx {
+            if relay_tx.send(msg).is_err() {
+                break;
+            }
+            waker.wake();
+        }
+    });
+
+    (tx, rx)
+}
@@ -2,6 +2,10 @@
 //!
 //! Manages wry WebView instances that overlay the editor window for rich preview.
 //! Supports both Markdown (rendered to HTML) and HTML files (with local resource loading).
+//!
+//! Markdown previews are updated in place: the blocks that changed since the
+//! last update are patched into the page's DOM and a new stylesheet replaces
+//! the old one, so the page only reloads when it fell out of step.
 
 use std::borrow::Cow;
 use std::collections::HashMap;
@@ -12,6 +16,7 @@ use std::sync::{Arc, RwLock};
 use winit::window::Window;
 use wry::{Rect, WebView, WebViewBuilder};
 
+use token::markdown::{diff_blocks, markdown_page, style_script, MarkdownBlock};
 use token::model::editor_area::PreviewId;
 
 /// Content source for a preview - either generated HTML or a file with base directory
@@ -26,12 +31,67 @@ pub enum PreviewContent {
         /// Base directory for resolving relative resource paths
         base_dir: PathBuf,
     },
+    /// Markdown rendered per top-level block, with its stylesheet
+    Markdown {
+        blocks: Vec<MarkdownBlock>,
+        css: String,
+    },
 }
 
 /// Shared state for custom protocol handler
 struct ProtocolState {
     /// Current HTML content indexed by preview ID
     contents: HashMap<PreviewId, PreviewContent>,
+    /// Version of each Markdown preview's blocks, bumped by every patch so
+    /// the page can tell whether a patch applies to what it shows
+    versions: HashMap<PreviewId, u64>,
+}
+
+/// How a content update reaches an open webview
+enum ContentUpdate {
+    /// Nothing the page shows changed
+    Unchanged,
+    /// Run this script in the page
+    Script(String),
+    /// Load the page again
+    Reload,
+}
+
+impl ProtocolState {
+    /// Store new content for a preview, returning how to bring its page
+    /// up to date
+    fn replace(&mut self, preview_id: PreviewId, content: PreviewContent) -> ContentUpdate {
+        let version = self.versions.entry(preview_id).or_default();
+        let update = match (self.contents.get(&preview_id), &content) {
+            (
+                Some(PreviewContent::Markdown {
+                    blocks: old_blocks,
+                    css: old_css,
+                }),
+                PreviewContent::Markdown { blocks, css },
+            ) => {
+                let mut script = String::new();
+                if old_css != css {
+                    script.push_str(&style_script(css));
+                }
+                if let Some(patch) = diff_blocks(old_blocks, blocks) {
+                    script.push_str(&patch.to_script(*version, *version + 1));
+                    *version += 1;
+                }
+                if script.is_empty() {
+                    ContentUpdate::Unchanged
+                } else {
+                    ContentUpdate::Script(script)
+                }
+            }
+            _ => {
+                *version += 1;
+                ContentUpdate::Reload
+            }
+        };
+        self.contents.insert(preview_id, content);
+        update
+    }
 }
 
 type SharedProtocolState = Arc<RwLock<ProtocolState>>;
@@ -50,6 +110,7 @@ impl WebviewManager {
             webviews: HashMap::new(),
             protocol_state: Arc::new(RwLock::new(ProtocolState {
                 contents: HashMap::new(),
+                versions: HashMap::new(),
             })),
         }
     }
@@ -101,16 +162,48 @@ impl WebviewManager {
     }
 
     /// Update webview content
+    ///
+    /// Markdown previews are patched in place, keeping their scroll
+    /// position; other content reloads the page.
     pub fn update_content(&mut self, preview_id: PreviewId, content: PreviewContent) {
         // Update stored content
-        if let Ok(mut state) = self.protocol_state.write() {
-            state.contents.insert(preview_id, content);
+        let update = match self.protocol_state.write() {
+            Ok(mut state) => state.replace(preview_id, content),
+            Err(_) => ContentUpdate::Reload,
+        };
+
+        let Some(webview) = self.webviews.get(&preview_id) else {
+            return;
+        };
+        match update {
+            ContentUpdate::Unchanged => {}
+            ContentUpdate::Script(script) => {
+                let _ = webview.evaluate_script(&script);
+            }
+            ContentUpdate::Reload => {
+                // Reload the webview to pick up new content
+                let url = format!("token://preview-{}/index.html", preview_id.0);
+                let _ = webview.load_url(&url);
+            }
         }
+    }
+
+    /// Replace a Markdown preview's stylesheet, when the theme changed
+    pub fn update_style(&mut self, preview_id: PreviewId, new_css: &str) {
+        let Ok(mut state) = self.protocol_state.write() else {
+            return;
+        };
+        let Some(PreviewContent::Markdown { css, .. }) = state.contents.get_mut(&preview_id) else {
+            return;
+        };
+        if css == new_css {
+            return;
+        }
+        *css = new_css.to_string();
+        drop(state);
 
-        // Reload the webview to pick up new content
         if let Some(webview) = self.webviews.get(&preview_id) {
-            let url = format!("token://preview-{}/index.html", preview_id.0);
-            let _ = webview.load_url(&url);
+            let _ = webview.evaluate_script(&style_script(new_css));
         }
     }
 
@@ -142,6 +235,7 @@ impl WebviewManager {
         self.webviews.remove(&preview_id);
         if let Ok(mut state) = self.protocol_state.write() {
             state.contents.remove(&preview_id);
+            state.versions.remove(&preview_id);
         }
     }
 
@@ -197,6 +291,11 @@ fn handle_protocol_request(
         Some(c) => c.clone(),
         None => return error_response(404, "Preview not found"),
     };
+    let version = state_guard
+        .versions
+        .get(&preview_id)
+        .copied()
+        .unwrap_or_default();
 
     drop(state_guard); // Release lock before I/O
 
@@ -212,6 +311,17 @@ fn handle_protocol_request(
                 error_response(404, "Not found")
             }
         }
+        PreviewContent::Markdown { blocks, css } => {
+            if path == "/index.html" || path == "/" {
+                let html = markdown_page(&blocks, &css, version);
+                Response::builder()
+                    .header("Content-Type", "text/html; charset=utf-8")
+                    .body(Cow::Owned(html.into_bytes()))
+                    .unwrap_or_else(|_| error_response(500, "Response error"))
+            } else {
+                error_response(404, "Not found")
+            }
+        }
         PreviewContent::HtmlFile { html, base_dir } => {
             if path == "/index.html" || path == "/" {
                 // Serve the HTML content
@@ -0,0 +1,286 @@
+//! Edit journal for incremental syntax parsing
+//!
+//! Documents record every buffer change as a [`TextEdit`] when it is pushed
+//! onto the undo stack. When a parse is requested, the accumulated edits are
+//! drained into an [`EditDelta`] and shipped to the syntax worker together
+//! with an O(1) rope snapshot. The worker replays the edits against its own
+//! cached snapshot to produce tree-sitter [`InputEdit`]s, so the cost of
+//! bringing a cached tree up to date scales with the size of the edits rather
+//! than the size of the file.
+
+use ropey::Rope;
+use tree_sitter::{InputEdit, Point};
+
+/// Upper bound on journaled edits between two parse requests. Past this the
+/// journal gives up and the worker falls back to diffing snapshots, which is
+/// cheaper than replaying an enormous edit list.
+const MAX_JOURNAL_EDITS: usize = 16_384;
+
+/// A single buffer change, expressed in char offsets against the text as it
+/// was when the change was applied.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct TextEdit {
+    /// Start of the replaced range (char offset)
+    pub start_char: usize,
+    /// End of the replaced range in the old text (char offset, exclusive)
+    pub old_end_char: usize,
+    /// Text inserted at `start_char`
+    pub text: String,
+}
+
+impl TextEdit {
+    /// Pure insertion of `text` at `position`
+    pub fn insert(position: usize, text: &str) -> Self {
+        Self {
+            start_char: position,
+            old_end_char: position,
+            text: text.to_owned(),
+        }
+    }
+
+    /// Pure deletion of `len` chars starting at `position`
+    pub fn delete(position: usize, len: usize) -> Self {
+        Self {
+            start_char: position,
+            old_end_char: position + len,
+            text: String::new(),
+        }
+    }
+
+    /// Replace `old_len` chars at `position` with `text`
+    pub fn replace(position: usize, old_len: usize, text: &str) -> Self {
+        Self {
+            start_char: position,
+            old_end_char: position + old_len,
+            text: text.to_owned(),
+        }
+    }
+
+    /// Apply this edit to `rope` (the text it was recorded against) and return
+    /// the equivalent tree-sitter edit.
+    ///
+    /// Returns `None` without touching `rope` if the edit does not fit, which
+    /// means the journal and the snapshot have drifted apart.
+    pub fn apply_to(&self, rope: &mut Rope) -> Option<InputEdit> {
+        if self.start_char > self.old_end_char || self.old_end_char > rope.len_chars() {
+            return None;
+        }
+
+        let start_byte = rope.char_to_byte(self.start_char);
+        let old_end_byte = rope.char_to_byte(self.old_end_char);
+        let start_position = rope_point(rope, start_byte);
+        let old_end_position = rope_point(rope, old_end_byte);
+
+        if self.old_end_char > self.start_char {
+            rope.remove(self.start_char..self.old_end_char);
+        }
+        if !self.text.is_empty() {
+            rope.insert(self.start_char, &self.text);
+        }
+
+        let new_end_byte = start_byte + self.text.len();
+        let new_end_position = rope_point(rope, new_end_byte);
+
+        Some(InputEdit {
+            start_byte,
+            old_end_byte,
+            new_end_byte,
+            start_position,
+            old_end_position,
+            new_end_position,
+        })
+    }
+}
+
+/// Convert a byte offset to a tree-sitter Point (row, column in bytes) using
+/// the rope's line index.
+pub(super) fn rope_point(rope: &Rope, byte: usize) -> Point {
+    let row = rope.byte_to_line(byte);
+    Point {
+        row,
+        column: byte - rope.line_to_byte(row),
+    }
+}
+
+/// Edits that turn the snapshot at `base_revision` into a newer snapshot
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct EditDelta {
+    /// Revision of the text the first edit applies to
+    pub base_revision: u64,
+    /// Edits in application order
+    pub edits: Vec<TextEdit>,
+}
+
+impl EditDelta {
+    /// Append a follow-up delta. Returns `false` (leaving `self` untouched)
+    /// if `next` does not start where this delta ends.
+    pub fn chain(&mut self, target_revision: u64, next: EditDelta) -> bool {
+        if next.base_revision != target_revision {
+            return false;
+        }
+        self.edits.extend(next.edits);
+        true
+    }
+}
+
+/// Per-document record of edits since the last parse request.
+///
+/// The journal tracks the document revision it has seen last. Any revision
+/// bump that bypasses the journal (reloads, bulk replacements) leaves it
+/// behind the document, and [`EditJournal::take`] then reports the history as
+/// unknown instead of handing out an incomplete edit list.
+#[derive(Debug, Clone, Default)]
+pub struct EditJournal {
+    edits: Vec<TextEdit>,
+    base_revision: u64,
+    head_revision: u64,
+    overflowed: bool,
+}
+
+impl EditJournal {
+    /// Record edits that moved the document from `revision_before` to
+    /// `revision_after`.
+    pub fn record(
+        &mut self,
+        revision_before: u64,
+        revision_after: u64,
+        edits: impl IntoIterator<Item = TextEdit>,
+    ) {
+        if self.head_revision != revision_before {
+            self.overflowed = true;
+        }
+        if !self.overflowed {
+            self.edits.extend(edits);
+            if self.edits.len() > MAX_JOURNAL_EDITS {
+                self.overflowed = true;
+            }
+        }
+        if self.overflowed {
+            self.edits = Vec::new();
+        }
+        self.head_revision = revision_after;
+    }
+
+    /// Drain the journal for a parse request at `revision`.
+    ///
+    /// Returns `None` when the recorded history does not reach `revision`.
+    /// Either way, the journal restarts from `revision`.
+    pub fn take(&mut self, revision: u64) -> Option<EditDelta> {
+        let complete = !self.overflowed && self.head_revision == revision;
+        let edits = std::mem::take(&mut self.edits);
+        let delta = complete.then_some(EditDelta {
+            base_revision: self.base_revision,
+            edits,
+        });
+        self.base_revision = revision;
+        self.head_revision = revision;
+        self.overflowed = false;
+        delta
+    }
+
+    /// Number of edits waiting to be sent
+    pub fn len(&self) -> usize {
+        self.edits.len()
+    }
+
+    /// Whether no edits are waiting to be sent
+    pub fn is_empty(&self) -> bool {
+        self.edits.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_apply_insert_produces_input_edit() {
+        let mut rope = Rope::from_str("fn main() {}\n");
+        let edit = TextEdit::insert(11, "\n    x\n");
+        let input = edit.apply_to(&mut rope).unwrap();
+
+        assert_eq!(rope.to_string(), "fn main() {\n    x\n}\n");
+        assert_eq!(input.start_byte, 11);
+        assert_eq!(input.old_end_byte, 11);
+        assert_eq!(input.new_end_byte, 18);
+        assert_eq!(input.start_position, Point { row: 0, column: 11 });
+        assert_eq!(input.new_end_position, Point { row: 2, column: 0 });
+    }
+
+    #[test]
+    fn test_apply_multibyte_uses_byte_offsets() {
+        let mut rope = Rope::from_str("é = 1\nb = 2");
+        // Delete "b" (char 6, byte 7)
+        let input = TextEdit::delete(6, 1).apply_to(&mut rope).unwrap();
+
+        assert_eq!(rope.to_string(), "é = 1\n = 2");
+        assert_eq!(input.start_byte, 7);
+        assert_eq!(input.old_end_byte, 8);
+        assert_eq!(input.new_end_byte, 7);
+        assert_eq!(input.start_position, Point { row: 1, column: 0 });
+        assert_eq!(input.old_end_position, Point { row: 1, column: 1 });
+    }
+
+    #[test]
+    fn test_apply_out_of_range_is_rejected() {
+        let mut rope = Rope::from_str("abc");
+        assert!(TextEdit::delete(2, 5).apply_to(&mut rope).is_none());
+        assert_eq!(rope.to_string(), "abc");
+    }
+
+    #[test]
+    fn test_journal_take_returns_edits_since_last_take() {
+        let mut journal = EditJournal::default();
+        journal.record(0, 1, [TextEdit::insert(0, "a")]);
+        journal.record(1, 2, [TextEdit::insert(1, "b")]);
+
+        let delta = journal.take(2).unwrap();
+        assert_eq!(delta.base_revision, 0);
+        assert_eq!(delta.edits.len(), 2);
+
+        journal.record(2, 3, [TextEdit::delete(0, 1)]);
+        let delta = journal.take(3).unwrap();
+        assert_eq!(delta.base_revision, 2);
+        assert_eq!(delta.edits, vec![TextEdit::delete(0, 1)]);
+    }
+
+    #[test]
+    fn test_journal_detects_unrecorded_revision_bump() {
+        let mut journal = EditJournal::default();
+        journal.record(0, 1, [TextEdit::insert(0, "a")]);
+        // Document went 1 → 2 without the journal seeing it
+        journal.record(2, 3, [TextEdit::insert(1, "b")]);
+        assert!(journal.take(3).is_none());
+
+        // After a miss the journal restarts cleanly
+        journal.record(3, 4, [TextEdit::insert(0, "c")]);
+        assert_eq!(journal.take(4).unwrap().base_revision, 3);
+    }
+
+    #[test]
+    fn test_journal_behind_document_is_unknown() {
+        let mut journal = EditJournal::default();
+        journal.record(0, 1, [TextEdit::insert(0, "a")]);
+        assert!(journal.take(5).is_none());
+    }
+
+    #[test]
+    fn test_delta_chain_requires_contiguous_revisions() {
+        let mut first = EditDelta {
+            base_revision: 1,
+            edits: vec![TextEdit::insert(0, "a")],
+        };
+        let gap = EditDelta {
+            base_revision: 4,
+            edits: vec![TextEdit::insert(0, "b")],
+        };
+        assert!(!first.chain(3, gap));
+
+        let next = EditDelta {
+            base_revision: 3,
+            edits: vec![TextEdit::insert(0, "c")],
+        };
+        assert!(first.chain(3, next));
+        assert_eq!(first.edits.len(), 2);
+    }
+}
@@ -1,8 +1,15 @@
 //! Syntax highlighting data structures
 //!
 //! Defines tokens, line highlights, and document-level syntax state.
+//!
+//! A document's tokens live in a single arena in which every line owns one
+//! contiguous, sorted run. Lines find their run through a per-line index kept
+//! in a gap buffer, so renumbering lines after an edit only moves the index
+//! entries between the previous edit and this one, and a finished parse
+//! result crosses from the worker to the UI as two allocations.
 
 use std::collections::HashMap;
+use std::ops::Range;
 
 use super::languages::LanguageId;
 
@@ -51,56 +58,211 @@ pub const HIGHLIGHT_NAMES: &[&str] = &[
 pub type HighlightId = u16;
 
 /// A single highlighted span within a line
-#[derive(Debug, Clone, PartialEq, Eq)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub struct HighlightToken {
-    /// Start column (0-indexed, inclusive)
-    pub start_col: usize,
-    /// End column (exclusive)
-    pub end_col: usize,
+    /// Start column in chars (0-indexed, inclusive)
+    pub start_col: u32,
+    /// End column in chars (exclusive)
+    pub end_col: u32,
     /// Index into HIGHLIGHT_NAMES
     pub highlight: HighlightId,
 }
 
-/// Highlight information for a single line
+impl HighlightToken {
+    /// Create a token from char columns, saturating columns that don't fit
+    pub fn new(start_col: usize, end_col: usize, highlight: HighlightId) -> Self {
+        Self {
+            start_col: u32::try_from(start_col).unwrap_or(u32::MAX),
+            end_col: u32::try_from(end_col).unwrap_or(u32::MAX),
+            highlight,
+        }
+    }
+
+    /// Whether char column `col` falls inside this token
+    pub fn contains(&self, col: usize) -> bool {
+        col >= self.start_col as usize && col < self.end_col as usize
+    }
+}
+
+/// Get the highlight ID at `col` in a line's tokens (sorted by start_col)
+pub fn highlight_at(tokens: &[HighlightToken], col: usize) -> Option<HighlightId> {
+    for token in tokens {
+        if token.contains(col) {
+            return Some(token.highlight);
+        }
+        if token.start_col as usize > col {
+            break; // tokens are sorted, no need to continue
+        }
+    }
+    None
+}
+
+/// Runs with at least this many tokens get a reach table, so the tokens
+/// reaching a column of a long line are found by binary search
+const REACH_TABLE_MIN_TOKENS: usize = 256;
+
+/// Running maximum of `end_col` along a run. Tokens nest (an escape inside
+/// a string), so their own ends aren't sorted, but this is.
+fn reach_table(tokens: &[HighlightToken]) -> Box<[u32]> {
+    tokens
+        .iter()
+        .scan(0, |reach, token| {
+            *reach = token.end_col.max(*reach);
+            Some(*reach)
+        })
+        .collect()
+}
+
+/// A line's run of tokens in the arena
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+struct LineSpan {
+    start: u32,
+    len: u32,
+}
+
+impl LineSpan {
+    fn range(self) -> Range<usize> {
+        self.start as usize..(self.start + self.len) as usize
+    }
+}
+
+/// Line number → [`LineSpan`] index, stored as a gap buffer.
+///
+/// Lines past the end of the index have no tokens. Inserting or removing
+/// lines moves the gap to the edit; consecutive edits on nearby lines (the
+/// common case while typing) only move a handful of entries.
 #[derive(Debug, Clone, Default)]
-pub struct LineHighlights {
-    /// Tokens sorted by start_col
-    pub tokens: Vec<HighlightToken>,
+struct LineIndex {
+    spans: Vec<LineSpan>,
+    gap_start: usize,
+    gap_len: usize,
 }
 
-impl LineHighlights {
-    /// Get the highlight ID for a given column, if any
-    pub fn highlight_at(&self, col: usize) -> Option<HighlightId> {
-        for token in &self.tokens {
-            if col >= token.start_col && col < token.end_col {
-                return Some(token.highlight);
-            }
-            if token.start_col > col {
-                break; // tokens are sorted, no need to continue
+impl LineIndex {
+    /// Build from spans for lines `0..spans.len()`
+    fn from_spans(spans: Vec<LineSpan>) -> Self {
+        Self {
+            gap_start: spans.len(),
+            gap_len: 0,
+            spans,
+        }
+    }
+
+    fn len(&self) -> usize {
+        self.spans.len() - self.gap_len
+    }
+
+    fn slot(&self, line: usize) -> usize {
+        if line < self.gap_start {
+            line
+        } else {
+            line + self.gap_len
+        }
+    }
+
+    fn get(&self, line: usize) -> LineSpan {
+        if line < self.len() {
+            self.spans[self.slot(line)]
+        } else {
+            LineSpan::default()
+        }
+    }
+
+    fn set(&mut self, line: usize, span: LineSpan) {
+        if line >= self.len() {
+            if span.len == 0 {
+                return;
             }
+            self.insert_empty(self.len(), line + 1 - self.len());
+        }
+        let slot = self.slot(line);
+        self.spans[slot] = span;
+    }
+
+    fn move_gap(&mut self, at: usize) {
+        if at < self.gap_start {
+            let count = self.gap_start - at;
+            self.spans
+                .copy_within(at..self.gap_start, at + self.gap_len);
+            self.gap_start -= count;
+        } else if at > self.gap_start {
+            let count = at - self.gap_start;
+            let after_gap = self.gap_start + self.gap_len;
+            self.spans
+                .copy_within(after_gap..after_gap + count, self.gap_start);
+            self.gap_start += count;
+        }
+    }
+
+    /// Insert `count` empty lines before `at`
+    fn insert_empty(&mut self, at: usize, count: usize) {
+        if at > self.len() || count == 0 {
+            return;
         }
-        None
+        self.move_gap(at);
+        if self.gap_len < count {
+            // Grow the gap in place: everything after it moves to the end
+            let grow = count.max(self.spans.len() / 8).max(64);
+            let after_gap = self.gap_start + self.gap_len;
+            let old_len = self.spans.len();
+            self.spans.resize(old_len + grow, LineSpan::default());
+            self.spans.copy_within(after_gap..old_len, after_gap + grow);
+            self.gap_len += grow;
+        }
+        self.spans[self.gap_start..self.gap_start + count].fill(LineSpan::default());
+        self.gap_start += count;
+        self.gap_len -= count;
+    }
+
+    /// Remove `lines`, returning the number of tokens they referenced
+    fn remove(&mut self, lines: Range<usize>) -> usize {
+        let end = lines.end.min(self.len());
+        if lines.start >= end {
+            return 0;
+        }
+        self.move_gap(lines.start);
+        let after_gap = self.gap_start + self.gap_len;
+        let removed = self.spans[after_gap..after_gap + (end - lines.start)]
+            .iter()
+            .map(|span| span.len as usize)
+            .sum();
+        self.gap_len += end - lines.start;
+        removed
+    }
+
+    /// Spans in line order
+    fn iter(&self) -> impl Iterator<Item = &LineSpan> {
+        self.spans[..self.gap_start]
+            .iter()
+            .chain(&self.spans[self.gap_start + self.gap_len..])
     }
 }
 
 /// Complete highlight state for a document
 #[derive(Debug, Clone)]
 pub struct SyntaxHighlights {
-    /// Map of line number (0-indexed) → tokens
-    pub lines: HashMap<usize, LineHighlights>,
+    /// Token arena; each line's tokens are one contiguous run sorted by
+    /// start_col
+    tokens: Vec<HighlightToken>,
+    /// Line number (0-indexed) → run in `tokens`
+    index: LineIndex,
+    /// Arena slots no longer referenced by any line
+    garbage: usize,
+    /// Reach tables of long runs, by run start. Runs are never modified in
+    /// place, so a table stays valid until its run is dropped.
+    reach: HashMap<u32, Box<[u32]>>,
     /// Document revision this corresponds to
     pub revision: u64,
     /// Primary language of document
     pub language: LanguageId,
+    /// Lines covered when this came from a viewport-limited pass.
+    /// `None` means the whole document was highlighted.
+    pub covered_lines: Option<Range<usize>>,
 }
 
 impl Default for SyntaxHighlights {
     fn default() -> Self {
-        Self {
-            lines: HashMap::new(),
-            revision: 0,
-            language: LanguageId::PlainText,
-        }
+        Self::new(LanguageId::PlainText, 0)
     }
 }
 
@@ -108,23 +270,167 @@ impl SyntaxHighlights {
     /// Create new empty highlights for a language
     pub fn new(language: LanguageId, revision: u64) -> Self {
         Self {
-            lines: HashMap::new(),
+            tokens: Vec::new(),
+            index: LineIndex::default(),
+            garbage: 0,
+            reach: HashMap::new(),
             revision,
             language,
+            covered_lines: None,
         }
     }
 
-    /// Get highlights for a specific line
-    pub fn get_line(&self, line: usize) -> Option<&LineHighlights> {
-        self.lines.get(&line)
+    /// Apply a newer parse result on top of these highlights.
+    ///
+    /// A whole-document result replaces everything. A viewport-limited one
+    /// only replaces its covered lines, so lines outside the viewport keep
+    /// their previous colors until the background pass arrives.
+    pub fn apply(&mut self, update: SyntaxHighlights) {
+        let Some(covered) = update.covered_lines.clone() else {
+            *self = update;
+            return;
+        };
+        for line in covered.start..covered.end.min(self.index.len()) {
+            self.clear_line(line);
+        }
+        for (line, tokens) in update.iter_lines() {
+            self.set_line(line, tokens);
+        }
+        self.revision = update.revision;
+        self.language = update.language;
+    }
+
+    /// Get highlight tokens for a specific line, if it has any
+    pub fn get_line(&self, line: usize) -> Option<&[HighlightToken]> {
+        let tokens = self.get_line_tokens(line);
+        (!tokens.is_empty()).then_some(tokens)
     }
 
     /// Get highlight tokens for a line, or empty slice if none
     pub fn get_line_tokens(&self, line: usize) -> &[HighlightToken] {
-        self.lines
-            .get(&line)
-            .map(|lh| lh.tokens.as_slice())
-            .unwrap_or(&[])
+        &self.tokens[self.index.get(line).range()]
+    }
+
+    /// Tokens of a line that can color char columns from `col` on: its run
+    /// from the first token that ends past `col`. Earlier tokens end before
+    /// `col`, and later ones may still be covered by a token nesting them.
+    pub fn get_line_tokens_from(&self, line: usize, col: usize) -> &[HighlightToken] {
+        let span = self.index.get(line);
+        let tokens = &self.tokens[span.range()];
+        let skip = match self.reach.get(&span.start).filter(|_| span.len > 0) {
+            Some(reach) => reach.partition_point(|&end| end as usize <= col),
+            None => tokens
+                .iter()
+                .position(|t| t.end_col as usize > col)
+                .unwrap_or(tokens.len()),
+        };
+        &tokens[skip..]
+    }
+
+    /// Whether a line has any highlight tokens
+    pub fn has_line(&self, line: usize) -> bool {
+        self.index.get(line).len > 0
+    }
+
+    /// Get the highlight ID at a given line and column, if any
+    pub fn highlight_at(&self, line: usize, col: usize) -> Option<HighlightId> {
+        highlight_at(self.get_line_tokens(line), col)
+    }
+
+    /// Lines that have tokens, in line order
+    pub fn iter_lines(&self) -> impl Iterator<Item = (usize, &[HighlightToken])> {
+        self.index
+            .iter()
+            .enumerate()
+            .filter(|(_, span)| span.len > 0)
+            .map(|(line, span)| (line, &self.tokens[span.range()]))
+    }
+
+    /// Number of lines that have tokens
+    pub fn line_count(&self) -> usize {
+        self.index.iter().filter(|span| span.len > 0).count()
+    }
+
+    /// Total number of tokens across all lines
+    pub fn token_count(&self) -> usize {
+        self.tokens.len() - self.garbage
+    }
+
+    /// Whether no line has any tokens
+    pub fn is_empty(&self) -> bool {
+        self.token_count() == 0
+    }
+
+    /// Approximate heap memory held by these highlights, in bytes
+    pub fn memory_bytes(&self) -> usize {
+        self.tokens.capacity() * std::mem::size_of::<HighlightToken>()
+            + self.index.spans.capacity() * std::mem::size_of::<LineSpan>()
+            + self
+                .reach
+                .values()
+                .map(|reach| reach.len() * std::mem::size_of::<u32>())
+                .sum::<usize>()
+    }
+
+    /// Replace a line's tokens (which must be sorted by start_col)
+    pub fn set_line(&mut self, line: usize, tokens: &[HighlightToken]) {
+        self.clear_line(line);
+        if tokens.is_empty() {
+            return;
+        }
+        let start = self.tokens.len() as u32;
+        self.tokens.extend_from_slice(tokens);
+        if tokens.len() >= REACH_TABLE_MIN_TOKENS {
+            self.reach.insert(start, reach_table(tokens));
+        }
+        self.index.set(
+            line,
+            LineSpan {
+                start,
+                len: tokens.len() as u32,
+            },
+        );
+        self.compact_if_sparse();
+    }
+
+    /// Drop a line's tokens
+    pub fn clear_line(&mut self, line: usize) {
+        let span = self.index.get(line);
+        if span.len > 0 {
+            self.garbage += span.len as usize;
+            self.reach.remove(&span.start);
+            self.index.set(line, LineSpan::default());
+        }
+    }
+
+    /// Rewrite the arena in line order once more than half of it is garbage
+    fn compact_if_sparse(&mut self) {
+        if self.garbage < 1024 || self.garbage * 2 < self.tokens.len() {
+            return;
+        }
+        let mut tokens = Vec::with_capacity(self.token_count());
+        let mut reach = HashMap::with_capacity(self.reach.len());
+        let spans = self
+            .index
+            .iter()
+            .map(|span| {
+                let start = tokens.len() as u32;
+                tokens.extend_from_slice(&self.tokens[span.range()]);
+                if span.len > 0 {
+                    if let Some(table) = self.reach.remove(&span.start) {
+                        reach.insert(start, table);
+                    }
+                }
+                LineSpan {
+                    start,
+                    len: span.len,
+                }
+            })
+            .collect();
+        self.tokens = tokens;
+        self.reach = reach;
+        self.index = LineIndex::from_spans(spans);
+        self.garbage = 0;
     }
 
     /// Shift highlights to account for a text edit, keeping old highlights
@@ -143,33 +449,123 @@ impl SyntaxHighlights {
         old_line_count: usize,
         new_line_count: usize,
     ) {
-        let delta = new_line_count as isize - old_line_count as isize;
-        if delta == 0 {
-            // Single-line edit: just clear the edited line's highlights
-            self.lines.remove(&edit_line);
-            return;
+        self.clear_line(edit_line);
+
+        if new_line_count > old_line_count {
+            // Insertion: open up empty lines right after the edit line
+            self.index
+                .insert_empty(edit_line + 1, new_line_count - old_line_count);
+        } else if new_line_count < old_line_count {
+            // Deletion: drop the edit line and the deleted range, then put
+            // back an empty edit line so everything after moves up
+            let deleted_lines = old_line_count - new_line_count;
+            let removed = edit_line..edit_line + deleted_lines + 1;
+            for line in removed.clone() {
+                let span = self.index.get(line);
+                if span.len > 0 {
+                    self.reach.remove(&span.start);
+                }
+            }
+            self.garbage += self.index.remove(removed);
+            self.index.insert_empty(edit_line, 1);
         }
+    }
+}
 
-        let mut new_lines = HashMap::new();
+/// Collects highlight tokens in any order and packs them into a
+/// [`SyntaxHighlights`].
+///
+/// Tree-sitter captures arrive roughly in document order, but multi-line
+/// nodes and injected languages interleave lines, so tokens are buffered with
+/// their line and sorted once at the end.
+#[derive(Debug)]
+pub struct HighlightsBuilder {
+    entries: Vec<(u32, HighlightToken)>,
+    revision: u64,
+    language: LanguageId,
+    covered_lines: Option<Range<usize>>,
+}
 
-        for (line, highlights) in self.lines.drain() {
-            if line < edit_line {
-                new_lines.insert(line, highlights);
-            } else if delta > 0 {
-                // Insertion: skip the edit line, shift everything after down
-                if line > edit_line {
-                    new_lines.insert((line as isize + delta) as usize, highlights);
-                }
-            } else {
-                // Deletion: skip lines in the deleted range, shift rest up
-                let deleted_lines = (-delta) as usize;
-                if line > edit_line + deleted_lines {
-                    new_lines.insert((line as isize + delta) as usize, highlights);
+impl HighlightsBuilder {
+    /// Start collecting highlights for a language
+    pub fn new(language: LanguageId, revision: u64) -> Self {
+        Self {
+            entries: Vec::new(),
+            revision,
+            language,
+            covered_lines: None,
+        }
+    }
+
+    /// Mark the result as covering only `lines`
+    pub fn set_covered_lines(&mut self, lines: Range<usize>) {
+        self.covered_lines = Some(lines);
+    }
+
+    /// Add a token; empty spans are ignored
+    pub fn push(&mut self, line: usize, start_col: usize, end_col: usize, highlight: HighlightId) {
+        if start_col < end_col {
+            let line = u32::try_from(line).unwrap_or(u32::MAX);
+            self.entries
+                .push((line, HighlightToken::new(start_col, end_col, highlight)));
+        }
+    }
+
+    /// Sort each line's tokens by span, resolve identical-span duplicates
+    /// with last-capture-wins, and pack them into the arena.
+    ///
+    /// Tree-sitter queries follow the last-match-wins convention: generic
+    /// fallbacks (e.g. `(identifier) @variable`) come first in the query file
+    /// and specific overrides (function names, keywords gated by predicates)
+    /// come last. Keeping the last capture for a span makes those overrides
+    /// take effect; keeping the first would paint everything with the fallback.
+    pub fn finish(mut self) -> SyntaxHighlights {
+        // Stable sort preserves capture order within identical spans
+        self.entries
+            .sort_by_key(|(line, t)| (*line, t.start_col, t.end_col));
+        // Collapse runs of identical spans, keeping the LAST capture
+        self.entries
+            .dedup_by(|(next_line, next), (kept_line, kept)| {
+                if next_line == kept_line
+                    && next.start_col == kept.start_col
+                    && next.end_col == kept.end_col
+                {
+                    kept.highlight = next.highlight;
+                    true
+                } else {
+                    false
                 }
+            });
+
+        let line_count = self
+            .entries
+            .last()
+            .map_or(0, |(line, _)| *line as usize + 1);
+        let mut spans = vec![LineSpan::default(); line_count];
+        let mut tokens = Vec::with_capacity(self.entries.len());
+        for (line, token) in self.entries {
+            let span = &mut spans[line as usize];
+            if span.len == 0 {
+                span.start = tokens.len() as u32;
             }
+            span.len += 1;
+            tokens.push(token);
+        }
+        let reach = spans
+            .iter()
+            .filter(|span| span.len as usize >= REACH_TABLE_MIN_TOKENS)
+            .map(|span| (span.start, reach_table(&tokens[span.range()])))
+            .collect();
+
+        SyntaxHighlights {
+            tokens,
+            index: LineIndex::from_spans(spans),
+            garbage: 0,
+            reach,
+            revision: self.revision,
+            language: self.language,
+            covered_lines: self.covered_lines,
         }
-
-        self.lines = new_lines;
     }
 }
 
@@ -196,6 +592,10 @@ pub fn highlight_id_for_name(name: &str) -> Option<HighlightId> {
 mod tests {
     use super::*;
 
+    fn token(start_col: usize, end_col: usize, highlight: HighlightId) -> HighlightToken {
+        HighlightToken::new(start_col, end_col, highlight)
+    }
+
     #[test]
     fn test_highlight_id_lookup() {
         assert!(highlight_id_for_name("keyword").is_some());
@@ -206,161 +606,204 @@ mod tests {
     }
 
     #[test]
-    fn test_shift_for_edit_insert_line() {
-        let mut highlights = SyntaxHighlights::new(super::super::LanguageId::Rust, 1);
-        highlights.lines.insert(
-            0,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 2,
-                    highlight: 1,
-                }],
-            },
-        );
-        highlights.lines.insert(
-            1,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 3,
-                    highlight: 2,
-                }],
-            },
+    fn test_line_tokens_from_skips_to_first_token_reaching_col() {
+        // A long minified line: a string nesting escapes that end before
+        // col 5000, followed by many short tokens
+        let mut tokens = vec![token(0, 6000, 22), token(10, 12, 6), token(20, 22, 6)];
+        tokens.extend((600..1200).map(|i| token(i * 10, i * 10 + 5, 10)));
+        let mut builder = HighlightsBuilder::new(super::super::LanguageId::JavaScript, 1);
+        for t in &tokens {
+            builder.push(0, t.start_col as usize, t.end_col as usize, t.highlight);
+        }
+        let mut highlights = builder.finish();
+        assert!(highlights.reach.contains_key(&0));
+
+        let first_reaching = |tokens: &[HighlightToken], col: usize| {
+            let skip = tokens.iter().position(|t| t.end_col as usize > col);
+            tokens.len() - skip.unwrap_or(tokens.len())
+        };
+        let line = highlights.get_line_tokens(0).to_vec();
+        for col in [0, 11, 5000, 6000, 8003, 11_995, 20_000] {
+            let from = highlights.get_line_tokens_from(0, col);
+            assert_eq!(from.len(), first_reaching(&line, col), "col {}", col);
+        }
+        assert_eq!(
+            highlights.get_line_tokens_from(0, 5000)[0],
+            token(0, 6000, 22)
         );
-        highlights.lines.insert(
-            2,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 4,
-                    highlight: 3,
-                }],
-            },
+
+        // set_line builds the table too, and it follows the run through a
+        // compaction
+        highlights.set_line(3, &line);
+        for _ in 0..4 {
+            highlights.set_line(1, &line);
+        }
+        assert_eq!(highlights.garbage, 0);
+        assert_eq!(highlights.reach.len(), 3);
+        assert_eq!(
+            highlights.get_line_tokens_from(3, 6000)[0],
+            token(6000, 6005, 10)
         );
+        highlights.clear_line(3);
+        assert!(highlights.get_line_tokens_from(3, 0).is_empty());
+    }
+
+    #[test]
+    fn test_shift_for_edit_insert_line() {
+        let mut highlights = SyntaxHighlights::new(super::super::LanguageId::Rust, 1);
+        highlights.set_line(0, &[token(0, 2, 1)]);
+        highlights.set_line(1, &[token(0, 3, 2)]);
+        highlights.set_line(2, &[token(0, 4, 3)]);
 
         // Insert a line at line 1 (old 3 lines -> new 4 lines)
         highlights.shift_for_edit(1, 3, 4);
 
         // Line 0 should be unchanged
-        assert!(highlights.lines.contains_key(&0));
+        assert!(highlights.has_line(0));
         // Line 1 should be cleared (edit line)
-        assert!(!highlights.lines.contains_key(&1));
+        assert!(!highlights.has_line(1));
         // Old line 2 should now be at line 3
-        assert!(highlights.lines.contains_key(&3));
-        assert_eq!(highlights.lines.get(&3).unwrap().tokens[0].highlight, 3);
+        assert!(highlights.has_line(3));
+        assert_eq!(highlights.get_line_tokens(3)[0].highlight, 3);
     }
 
     #[test]
     fn test_shift_for_edit_delete_line() {
         let mut highlights = SyntaxHighlights::new(super::super::LanguageId::Rust, 1);
-        highlights.lines.insert(
-            0,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 2,
-                    highlight: 1,
-                }],
-            },
-        );
-        highlights.lines.insert(
-            1,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 3,
-                    highlight: 2,
-                }],
-            },
-        );
-        highlights.lines.insert(
-            2,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 4,
-                    highlight: 3,
-                }],
-            },
-        );
-        highlights.lines.insert(
-            3,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 5,
-                    highlight: 4,
-                }],
-            },
-        );
+        highlights.set_line(0, &[token(0, 2, 1)]);
+        highlights.set_line(1, &[token(0, 3, 2)]);
+        highlights.set_line(2, &[token(0, 4, 3)]);
+        highlights.set_line(3, &[token(0, 5, 4)]);
 
         // Delete line at line 1 (old 4 lines -> new 3 lines)
         highlights.shift_for_edit(1, 4, 3);
 
         // Line 0 unchanged
-        assert!(highlights.lines.contains_key(&0));
+        assert!(highlights.has_line(0));
         // Lines 1-2 (edit line + deleted range) should be gone
         // Old line 3 should now be at line 2
-        assert!(highlights.lines.contains_key(&2));
-        assert_eq!(highlights.lines.get(&2).unwrap().tokens[0].highlight, 4);
+        assert!(highlights.has_line(2));
+        assert_eq!(highlights.get_line_tokens(2)[0].highlight, 4);
     }
 
     #[test]
     fn test_shift_for_edit_same_line() {
         let mut highlights = SyntaxHighlights::new(super::super::LanguageId::Rust, 1);
-        highlights.lines.insert(
-            0,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 5,
-                    highlight: 1,
-                }],
-            },
-        );
-        highlights.lines.insert(
-            1,
-            LineHighlights {
-                tokens: vec![HighlightToken {
-                    start_col: 0,
-                    end_col: 3,
-                    highlight: 2,
-                }],
-            },
-        );
+        highlights.set_line(0, &[token(0, 5, 1)]);
+        highlights.set_line(1, &[token(0, 3, 2)]);
 
         // Same-line edit (no line count change)
         highlights.shift_for_edit(0, 2, 2);
 
         // Line 0 should be cleared
-        assert!(!highlights.lines.contains_key(&0));
+        assert!(!highlights.has_line(0));
         // Line 1 should remain
-        assert!(highlights.lines.contains_key(&1));
+        assert!(highlights.has_line(1));
     }
 
     #[test]
-    fn test_line_highlights_at() {
-        let line = LineHighlights {
-            tokens: vec![
-                HighlightToken {
-                    start_col: 0,
-                    end_col: 5,
-                    highlight: 1,
-                },
-                HighlightToken {
-                    start_col: 10,
-                    end_col: 15,
-                    highlight: 2,
-                },
-            ],
-        };
+    fn test_shift_for_edit_matches_line_renumbering() {
+        // Repeated inserts and deletes around the gap must renumber exactly
+        // like shifting every line after the edit
+        let mut highlights = SyntaxHighlights::new(LanguageId::Rust, 1);
+        let mut expected: Vec<Option<HighlightId>> = (0..200).map(Some).collect();
+        for (line, id) in expected.iter().enumerate() {
+            highlights.set_line(line, &[token(0, 1, id.unwrap())]);
+        }
+
+        let edits = [(10, 3), (150, -5), (11, 1), (0, -2), (120, 40), (60, -30)];
+        for &(edit_line, delta) in &edits {
+            let old_count = expected.len();
+            let new_count = (old_count as isize + delta) as usize;
+            highlights.shift_for_edit(edit_line, old_count, new_count);
+
+            expected[edit_line] = None;
+            if delta > 0 {
+                let at = edit_line + 1;
+                expected.splice(at..at, std::iter::repeat_n(None, delta as usize));
+            } else {
+                expected.drain(edit_line + 1..edit_line + 1 + (-delta) as usize);
+            }
+        }
+
+        for (line, id) in expected.iter().enumerate() {
+            assert_eq!(highlights.highlight_at(line, 0), *id, "line {}", line);
+        }
+        let live = expected.iter().filter(|id| id.is_some()).count();
+        assert_eq!(highlights.token_count(), live);
+        assert_eq!(highlights.line_count(), live);
+    }
 
-        assert_eq!(line.highlight_at(0), Some(1));
-        assert_eq!(line.highlight_at(4), Some(1));
-        assert_eq!(line.highlight_at(5), None);
-        assert_eq!(line.highlight_at(10), Some(2));
-        assert_eq!(line.highlight_at(14), Some(2));
-        assert_eq!(line.highlight_at(15), None);
+    #[test]
+    fn test_builder_sorts_and_keeps_last_capture() {
+        let mut builder = HighlightsBuilder::new(LanguageId::Rust, 4);
+        builder.push(2, 4, 8, 1);
+        builder.push(0, 5, 9, 1);
+        builder.push(0, 0, 4, 1);
+        builder.push(0, 5, 9, 2); // same span, later capture wins
+        builder.push(1, 3, 3, 1); // empty, dropped
+        let highlights = builder.finish();
+
+        assert_eq!(highlights.revision, 4);
+        assert_eq!(
+            highlights.get_line_tokens(0),
+            &[token(0, 4, 1), token(5, 9, 2)]
+        );
+        assert!(highlights.get_line(1).is_none());
+        assert_eq!(highlights.get_line_tokens(2), &[token(4, 8, 1)]);
+        assert_eq!(highlights.line_count(), 2);
+        assert_eq!(highlights.token_count(), 3);
+    }
+
+    #[test]
+    fn test_set_line_compacts_garbage() {
+        let mut highlights = SyntaxHighlights::new(LanguageId::Rust, 1);
+        for round in 0..10u16 {
+            for line in 0..500 {
+                highlights.set_line(line, &[token(0, 1, round), token(2, 3, round)]);
+            }
+        }
+        assert_eq!(highlights.token_count(), 1000);
+        assert!(highlights.tokens.len() < 3000);
+        assert_eq!(highlights.highlight_at(499, 2), Some(9));
+    }
+
+    #[test]
+    fn test_apply_viewport_pass_keeps_lines_outside() {
+        let mut highlights = SyntaxHighlights::new(LanguageId::Rust, 1);
+        for line in 0..10 {
+            highlights.set_line(line, &[token(0, 3, 1)]);
+        }
+
+        // Viewport pass over lines 4..6: line 5 lost its tokens
+        let mut partial = SyntaxHighlights::new(LanguageId::Rust, 2);
+        partial.covered_lines = Some(4..6);
+        partial.set_line(4, &[token(0, 3, 2)]);
+        highlights.apply(partial);
+
+        assert_eq!(highlights.revision, 2);
+        assert_eq!(highlights.get_line_tokens(3)[0].highlight, 1);
+        assert_eq!(highlights.get_line_tokens(4)[0].highlight, 2);
+        assert!(highlights.get_line(5).is_none());
+        assert_eq!(highlights.get_line_tokens(9)[0].highlight, 1);
+
+        // A whole-document pass replaces everything
+        let mut full = SyntaxHighlights::new(LanguageId::Rust, 3);
+        full.set_line(0, &[token(0, 3, 3)]);
+        highlights.apply(full);
+        assert_eq!(highlights.line_count(), 1);
+        assert!(highlights.covered_lines.is_none());
+    }
+
+    #[test]
+    fn test_line_highlights_at() {
+        let tokens = [token(0, 5, 1), token(10, 15, 2)];
+
+        assert_eq!(highlight_at(&tokens, 0), Some(1));
+        assert_eq!(highlight_at(&tokens, 4), Some(1));
+        assert_eq!(highlight_at(&tokens, 5), None);
+        assert_eq!(highlight_at(&tokens, 10), Some(2));
+        assert_eq!(highlight_at(&tokens, 14), Some(2));
+        assert_eq!(highlight_at(&tokens, 15), None);
     }
 }
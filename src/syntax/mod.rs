@@ -13,19 +13,30 @@
 //!              → (worker thread) → Msg::SyntaxUpdated → Cmd::Redraw
 //! ```
 //!
+//! Parse requests carry a rope snapshot plus the [`EditDelta`] journaled since
+//! the previous request, so the worker can edit its cached tree without
+//! diffing the whole document.
+//!
+//! When the document is larger than the viewport, the worker highlights the
+//! visible lines first and sends them on their own, then fills in the rest of
+//! the document as a background pass. The background pass is skipped when
+//! every edit since the last one stayed inside the viewport.
+//!
 //! ## Supported Languages (Phase 1)
 //!
 //! - YAML
 //! - Markdown
 //! - Rust
 
+mod edits;
 mod highlights;
 mod languages;
 mod parser;
 
+pub use edits::{EditDelta, EditJournal, TextEdit};
 pub use highlights::{
-    highlight_id_for_name, HighlightId, HighlightToken, LineHighlights, SyntaxHighlights,
-    HIGHLIGHT_NAMES,
+    highlight_at, highlight_id_for_name, HighlightId, HighlightToken, HighlightsBuilder,
+    SyntaxHighlights, HIGHLIGHT_NAMES,
 };
 pub use languages::LanguageId;
 pub use parser::ParserState;
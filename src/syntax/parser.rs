@@ -2,15 +2,33 @@
 //!
 //! Manages parsers, trees, and queries for syntax highlighting.
 //! Supports incremental parsing by caching trees and computing edits.
+//! Injected languages (script/style bodies, fenced code blocks) are cached
+//! per document too, so an edit only re-parses the injection it lands in.
 
-use std::collections::HashMap;
+use std::borrow::Cow;
+use std::collections::{HashMap, HashSet};
+use std::ops::Range;
+use std::time::{Duration, Instant};
 
+use ropey::Rope;
 use streaming_iterator::StreamingIterator;
 use tree_sitter::{InputEdit, Parser, Point, Query, QueryCursor, Tree, TreeCursor};
 
-use super::highlights::{highlight_id_for_name, HighlightToken, SyntaxHighlights};
+use super::edits::{rope_point, EditDelta};
+use super::highlights::{highlight_id_for_name, HighlightId, HighlightsBuilder, SyntaxHighlights};
 use super::languages::LanguageId;
 use crate::model::editor_area::DocumentId;
+use crate::util::{LineColumns, LONG_LINE_BYTES};
+
+/// Rough heap cost of one visible tree-sitter node: its subtree data and
+/// its parent's pointer to it (hidden nodes are not counted by
+/// `descendant_count`, so this errs high per visible node)
+const TREE_NODE_BYTES: usize = 96;
+
+/// Approximate heap bytes of a tree
+fn tree_memory_bytes(tree: &Tree) -> usize {
+    tree.root_node().descendant_count() * TREE_NODE_BYTES
+}
 
 /// Cached parse state for a document (enables incremental parsing)
 struct DocParseState {
@@ -18,8 +36,140 @@ struct DocParseState {
     language: LanguageId,
     /// The parsed tree
     tree: Tree,
-    /// The source text that was parsed (needed for computing edits)
-    source: String,
+    /// Snapshot of the text that was parsed, which highlight queries and
+    /// outline extraction read from. Rope clones share chunks with the
+    /// editor's buffer, so keeping this costs no copy.
+    snapshot: Rope,
+    /// Document revision the tree corresponds to
+    revision: u64,
+    /// Lines whose highlights may differ from the last whole-document pass
+    dirty: DirtyLines,
+    /// The previous revision's tree with this parse's edits applied (so its
+    /// positions line up with `tree`), and that revision. `None` after a
+    /// parse from scratch.
+    previous: Option<(Tree, u64)>,
+}
+
+/// Byte range of a host document whose text is highlighted with another
+/// language (a `<script>`/`<style>` body or a fenced code block)
+struct InjectionRegion {
+    language: LanguageId,
+    bytes: Range<usize>,
+    /// Host position of the region's first byte
+    base_row: usize,
+    base_col: usize,
+}
+
+impl InjectionRegion {
+    /// Region covering `node`, if it is non-empty and within `source`
+    fn from_node(node: tree_sitter::Node, source: &Rope, language: LanguageId) -> Option<Self> {
+        let bytes = node.start_byte()..node.end_byte();
+        if bytes.is_empty() || bytes.end > source.len_bytes() {
+            return None;
+        }
+        Some(Self {
+            language,
+            bytes,
+            base_row: node.start_position().row,
+            base_col: node.start_position().column,
+        })
+    }
+}
+
+/// Parsed injection kept between revisions of its host document
+struct CachedInjection {
+    language: LanguageId,
+    /// Text the tree was parsed from
+    text: String,
+    tree: Tree,
+    /// Tokens as (row, start_char, end_char, highlight), relative to the
+    /// region start, so they stay valid when edits move the region
+    tokens: Vec<(usize, usize, usize, HighlightId)>,
+    /// Which injection parse produced this, counting from 1, so tests can
+    /// tell reused injections from re-parsed ones
+    #[cfg(test)]
+    parse_serial: u64,
+}
+
+impl CachedInjection {
+    /// Approximate heap bytes held by the injection
+    fn memory_bytes(&self) -> usize {
+        self.text.capacity()
+            + tree_memory_bytes(&self.tree)
+            + self.tokens.capacity() * std::mem::size_of::<(usize, usize, usize, HighlightId)>()
+    }
+
+    /// Add the injection's tokens at the region's position in the host
+    fn push_tokens(&self, region: &InjectionRegion, highlights: &mut HighlightsBuilder) {
+        for &(row, start_char, end_char, highlight_id) in &self.tokens {
+            let (start_col, end_col) = if row == 0 {
+                (region.base_col + start_char, region.base_col + end_char)
+            } else {
+                (start_char, end_char)
+            };
+            highlights.push(region.base_row + row, start_col, end_col, highlight_id);
+        }
+    }
+}
+
+/// Lines touched since the last whole-document highlight pass.
+///
+/// Tracked in current line numbers, so any edit that changes the line count
+/// marks everything dirty: lines below it moved, and the highlights the UI
+/// holds for them were only shifted approximately.
+#[derive(Debug, Clone, PartialEq, Eq)]
+enum DirtyLines {
+    Clean,
+    Lines(Range<usize>),
+    All,
+}
+
+impl DirtyLines {
+    fn include(&mut self, lines: Range<usize>) {
+        *self = match std::mem::replace(self, DirtyLines::All) {
+            DirtyLines::Clean => DirtyLines::Lines(lines),
+            DirtyLines::Lines(dirty) => {
+                DirtyLines::Lines(dirty.start.min(lines.start)..dirty.end.max(lines.end))
+            }
+            DirtyLines::All => DirtyLines::All,
+        };
+    }
+
+    fn merge(&mut self, other: DirtyLines) {
+        match other {
+            DirtyLines::Clean => {}
+            DirtyLines::Lines(lines) => self.include(lines),
+            DirtyLines::All => *self = DirtyLines::All,
+        }
+    }
+
+    /// Record an edit, in the coordinates of the text it applied to
+    fn include_edit(&mut self, edit: &InputEdit) {
+        if edit.old_end_position.row != edit.new_end_position.row {
+            *self = DirtyLines::All;
+        } else {
+            self.include(edit.start_position.row..edit.new_end_position.row + 1);
+        }
+    }
+
+    fn within(&self, lines: &Range<usize>) -> bool {
+        match self {
+            DirtyLines::Clean => true,
+            DirtyLines::Lines(dirty) => lines.start <= dirty.start && dirty.end <= lines.end,
+            DirtyLines::All => false,
+        }
+    }
+}
+
+/// Outcome of bringing a cached tree in line with a new snapshot
+enum TreeSync {
+    /// Text is identical; the cached tree can be reused as-is
+    Unchanged,
+    /// Edits were applied to the cached tree; reparse with it as the old tree.
+    /// Carries the lines the edits touched.
+    Edited(DirtyLines),
+    /// The cached tree can't be related to the new text; parse from scratch
+    Stale,
 }
 
 /// Convert byte column to character column (handles UTF-8 multi-byte chars)
@@ -32,31 +182,6 @@ fn byte_to_char_col(text: &str, byte_col: usize) -> usize {
     text[..valid_byte].chars().count()
 }
 
-/// Sort each line's tokens by span and resolve identical-span duplicates
-/// with last-capture-wins.
-///
-/// Tree-sitter queries follow the last-match-wins convention: generic
-/// fallbacks (e.g. `(identifier) @variable`) come first in the query file
-/// and specific overrides (function names, keywords gated by predicates)
-/// come last. Keeping the last capture for a span makes those overrides
-/// take effect; keeping the first would paint everything with the fallback.
-fn finalize_line_tokens(highlights: &mut SyntaxHighlights) {
-    for line_highlights in highlights.lines.values_mut() {
-        let tokens = &mut line_highlights.tokens;
-        // Stable sort preserves capture order within identical spans
-        tokens.sort_by_key(|t| (t.start_col, t.end_col));
-        // Collapse runs of identical spans, keeping the LAST capture
-        tokens.dedup_by(|next, kept| {
-            if next.start_col == kept.start_col && next.end_col == kept.end_col {
-                kept.highlight = next.highlight;
-                true
-            } else {
-                false
-            }
-        });
-    }
-}
-
 /// Convert a byte offset to a tree-sitter Point (row, column in bytes)
 fn byte_to_point(text: &str, byte_offset: usize) -> Point {
     let mut row = 0usize;
@@ -75,6 +200,270 @@ fn byte_to_point(text: &str, byte_offset: usize) -> Point {
     Point { row, column: col }
 }
 
+/// Apply the edits needed to turn `cached.snapshot` into `snapshot` to the
+/// cached tree.
+///
+/// Uses the journaled `delta` when it starts at the cached revision, which
+/// costs O(edits). Without a usable journal, falls back to diffing the two
+/// snapshots.
+fn sync_cached_tree(
+    cached: &mut DocParseState,
+    snapshot: &Rope,
+    delta: Option<&EditDelta>,
+) -> TreeSync {
+    let Some(delta) = delta.filter(|d| d.base_revision == cached.revision) else {
+        return match compute_rope_edit(&cached.snapshot, snapshot) {
+            Some(edit) => {
+                cached.tree.edit(&edit);
+                let mut touched = DirtyLines::Clean;
+                touched.include_edit(&edit);
+                TreeSync::Edited(touched)
+            }
+            None => TreeSync::Unchanged,
+        };
+    };
+
+    if delta.edits.is_empty() {
+        return if cached.snapshot.len_bytes() == snapshot.len_bytes() {
+            TreeSync::Unchanged
+        } else {
+            TreeSync::Stale
+        };
+    }
+
+    // Replay against a clone of the cached snapshot to recover byte offsets
+    // and points in the text each edit was made against.
+    let mut replay = cached.snapshot.clone();
+    let mut input_edits = Vec::with_capacity(delta.edits.len());
+    for edit in &delta.edits {
+        match edit.apply_to(&mut replay) {
+            Some(input_edit) => input_edits.push(input_edit),
+            None => return TreeSync::Stale,
+        }
+    }
+    if replay.len_bytes() != snapshot.len_bytes() || replay.len_chars() != snapshot.len_chars() {
+        tracing::warn!("Edit journal replay diverged from snapshot, reparsing from scratch");
+        return TreeSync::Stale;
+    }
+    // Comparing contents is O(file), too slow to do on every keystroke in
+    // release builds, but a journal that drifted without changing the length
+    // would edit the tree at the wrong offsets
+    debug_assert!(
+        replay == *snapshot,
+        "edit journal replay matches the snapshot's length but not its text"
+    );
+
+    let mut touched = DirtyLines::Clean;
+    for input_edit in &input_edits {
+        cached.tree.edit(input_edit);
+        touched.include_edit(input_edit);
+    }
+    TreeSync::Edited(touched)
+}
+
+/// Text of the line starting at byte `line_start`, without its terminator,
+/// and the byte offset where the next line starts. Matches `str::lines`.
+fn line_from(source: &str, line_start: usize) -> (&str, usize) {
+    let rest = source.get(line_start..).unwrap_or("");
+    let len = rest.find('\n').unwrap_or(rest.len());
+    let line = &rest[..len];
+    (
+        line.strip_suffix('\r').unwrap_or(line),
+        line_start + len + 1,
+    )
+}
+
+/// The line of a rope starting at byte `line_start`, like [`line_from`].
+/// Borrowed when the line lies within one chunk.
+fn rope_line_from(rope: &Rope, line_start: usize) -> (Cow<'_, str>, usize) {
+    let len = rope.len_bytes();
+    let start = line_start.min(len);
+    let mut end = len;
+    let mut at = start;
+    while at < len {
+        let chunk = rope_chunk_from(rope, at);
+        if let Some(newline) = memchr::memchr(b'\n', chunk) {
+            end = at + newline;
+            break;
+        }
+        at += chunk.len();
+    }
+    let next_start = end + 1;
+    if end > start && rope.byte(end - 1) == b'\r' {
+        end -= 1;
+    }
+    (rope.byte_slice(start..end).into(), next_start)
+}
+
+/// Text that [`SourceLines`] can find lines in: the document's rope, or an
+/// injection's string
+trait LineText<'a>: Copy {
+    /// Text of the line starting at byte `line_start`, without its
+    /// terminator, and the byte offset where the next line starts
+    fn line_from(self, line_start: usize) -> (Cow<'a, str>, usize);
+}
+
+impl<'a> LineText<'a> for &'a str {
+    fn line_from(self, line_start: usize) -> (Cow<'a, str>, usize) {
+        let (line, next_start) = line_from(self, line_start);
+        (Cow::Borrowed(line), next_start)
+    }
+}
+
+impl<'a> LineText<'a> for &'a Rope {
+    fn line_from(self, line_start: usize) -> (Cow<'a, str>, usize) {
+        rope_line_from(self, line_start)
+    }
+}
+
+/// Lines of a source located by their start byte, with column tables for
+/// the long ones.
+///
+/// Minified files put megabytes on one line with a capture every few bytes,
+/// and finding that line's end and counting chars from its start for every
+/// capture made highlighting them quadratic. A long line's end and
+/// [`LineColumns`] table are computed the first time a capture lands on it;
+/// later captures cost a binary search plus at most one checkpoint interval.
+struct SourceLines<'a, T> {
+    source: T,
+    /// Start byte, text and next line's start byte of the last short line
+    /// looked up, since consecutive captures mostly share a line
+    last: Option<(usize, Cow<'a, str>, usize)>,
+    /// Text, next line's start byte and column table, by line start byte
+    long_lines: HashMap<usize, (Cow<'a, str>, usize, LineColumns)>,
+}
+
+/// A line of a [`SourceLines`], without its terminator
+struct SourceLine<'s> {
+    text: &'s str,
+    /// Byte offset where the next line starts
+    next_start: usize,
+    columns: Option<&'s LineColumns>,
+}
+
+impl SourceLine<'_> {
+    /// Char column of byte column `byte_col`
+    fn char_col(&self, byte_col: usize) -> usize {
+        match self.columns {
+            Some(columns) => columns.char_at_byte(self.text, byte_col),
+            None => byte_to_char_col(self.text, byte_col),
+        }
+    }
+
+    /// Line length in chars
+    fn len_chars(&self) -> usize {
+        match self.columns {
+            Some(columns) => columns.len_chars(),
+            None => self.text.chars().count(),
+        }
+    }
+}
+
+impl<'a, T: LineText<'a>> SourceLines<'a, T> {
+    fn new(source: T) -> Self {
+        Self {
+            source,
+            last: None,
+            long_lines: HashMap::new(),
+        }
+    }
+
+    /// The line starting at byte `line_start`, like [`line_from`]
+    fn line(&mut self, line_start: usize) -> SourceLine<'_> {
+        let is_last = matches!(&self.last, Some((start, ..)) if *start == line_start);
+        if !is_last && !self.long_lines.contains_key(&line_start) {
+            let (text, next_start) = self.source.line_from(line_start);
+            if text.len() < LONG_LINE_BYTES {
+                self.last = Some((line_start, text, next_start));
+            } else {
+                let columns = LineColumns::new(&text);
+                self.long_lines
+                    .insert(line_start, (text, next_start, columns));
+            }
+        }
+        if let Some((start, text, next_start)) = &self.last {
+            if *start == line_start {
+                return SourceLine {
+                    text,
+                    next_start: *next_start,
+                    columns: None,
+                };
+            }
+        }
+        let (text, next_start, columns) = &self.long_lines[&line_start];
+        SourceLine {
+            text,
+            next_start: *next_start,
+            columns: Some(columns),
+        }
+    }
+}
+
+/// Return the rope's bytes from `byte` to the end of its chunk
+fn rope_chunk_from(rope: &Rope, byte: usize) -> &[u8] {
+    if byte >= rope.len_bytes() {
+        return &[];
+    }
+    let (chunk, chunk_start, _, _) = rope.chunk_at_byte(byte);
+    &chunk.as_bytes()[byte - chunk_start..]
+}
+
+/// Parse directly from the rope's chunks, so no contiguous copy is needed
+fn parse_rope(parser: &mut Parser, rope: &Rope, old_tree: Option<&Tree>) -> Option<Tree> {
+    parser.parse_with_options(
+        &mut |byte: usize, _: Point| rope_chunk_from(rope, byte),
+        old_tree,
+        None,
+    )
+}
+
+/// Query text provider reading a node's text from the rope's chunks, so
+/// predicates like `#match?` need no contiguous copy
+fn rope_text<'a>(rope: &'a Rope) -> impl FnMut(tree_sitter::Node) -> ropey::iter::Chunks<'a> {
+    move |node| rope.byte_slice(node.start_byte()..node.end_byte()).chunks()
+}
+
+/// The text of `bytes` in `rope`, borrowed when it lies within one chunk
+fn rope_text_in(rope: &Rope, bytes: Range<usize>) -> Cow<'_, str> {
+    rope.byte_slice(bytes).into()
+}
+
+/// Compute an InputEdit by diffing two ropes, like
+/// [`compute_incremental_edit`]. Returns None if they are identical.
+fn compute_rope_edit(old: &Rope, new: &Rope) -> Option<InputEdit> {
+    let start = old
+        .bytes()
+        .zip(new.bytes())
+        .take_while(|(a, b)| a == b)
+        .count();
+    if start == old.len_bytes() && start == new.len_bytes() {
+        return None;
+    }
+
+    // Common suffix, not overlapping the prefix
+    let max_suffix = old.len_bytes().min(new.len_bytes()) - start;
+    let mut old_back = old.bytes_at(old.len_bytes());
+    let mut new_back = new.bytes_at(new.len_bytes());
+    let mut suffix = 0;
+    while suffix < max_suffix {
+        match (old_back.prev(), new_back.prev()) {
+            (Some(a), Some(b)) if a == b => suffix += 1,
+            _ => break,
+        }
+    }
+
+    let old_end = old.len_bytes() - suffix;
+    let new_end = new.len_bytes() - suffix;
+    Some(InputEdit {
+        start_byte: start,
+        old_end_byte: old_end,
+        new_end_byte: new_end,
+        start_position: rope_point(old, start),
+        old_end_position: rope_point(old, old_end),
+        new_end_position: rope_point(new, new_end),
+    })
+}
+
 /// Compute an InputEdit by diffing old and new source text.
 /// Returns None if the sources are identical.
 fn compute_incremental_edit(old_src: &str, new_src: &str) -> Option<InputEdit> {
@@ -159,17 +548,30 @@ const BLADE_HIGHLIGHTS: &str = include_str!("../../queries/blade/highlights.scm"
 const JUST_HIGHLIGHTS: &str = tree_sitter_just::HIGHLIGHTS_QUERY;
 
 /// Thread-local parser state (tree-sitter parsers are !Sync)
+///
+/// Grammars are set up on first use of each language: creating a parser is
+/// cheap, but compiling a highlight query can take milliseconds for large
+/// grammars, so a session only pays for the languages it actually opens.
 pub struct ParserState {
     /// Parser instances per language
     parsers: HashMap<LanguageId, Parser>,
     /// Compiled queries per language
     queries: HashMap<LanguageId, Query>,
+    /// Languages whose initialization has run (even if it failed)
+    initialized: HashSet<LanguageId>,
+    /// Initialization time per language, not yet collected by the caller
+    init_timings: Vec<(LanguageId, Duration)>,
     /// Cached parse state per document (for incremental parsing)
     doc_cache: HashMap<DocumentId, DocParseState>,
+    /// Injected sub-documents per host document, in document order
+    injections: HashMap<DocumentId, Vec<CachedInjection>>,
     /// Markdown inline grammar parser (for two-pass parsing)
     markdown_inline_parser: Option<Parser>,
     /// Markdown inline grammar query
     markdown_inline_query: Option<Query>,
+    /// Injection parses so far
+    #[cfg(test)]
+    injection_parses: u64,
 }
 
 impl ParserState {
@@ -180,62 +582,64 @@ impl ParserState {
             .map(|state| (&state.tree, state.language))
     }
 
-    /// Create a new parser state with initialized languages
+    /// Snapshot of the text of the cached tree for a document (for outline
+    /// extraction on worker thread)
+    pub fn get_cached_snapshot(&self, doc_id: DocumentId) -> Option<&Rope> {
+        self.doc_cache.get(&doc_id).map(|state| &state.snapshot)
+    }
+
+    /// Previous revision's tree for a document, edited to line up with the
+    /// cached tree, for diffing the two with `Tree::changed_ranges`
+    pub fn get_previous_tree(&self, doc_id: DocumentId) -> Option<(&Tree, u64)> {
+        self.doc_cache
+            .get(&doc_id)
+            .and_then(|state| state.previous.as_ref())
+            .map(|(tree, revision)| (tree, *revision))
+    }
+
+    /// Create a new parser state; languages are initialized on first use
     pub fn new() -> Self {
-        let mut state = Self {
+        Self {
             parsers: HashMap::new(),
             queries: HashMap::new(),
+            initialized: HashSet::new(),
+            init_timings: Vec::new(),
             doc_cache: HashMap::new(),
+            injections: HashMap::new(),
             markdown_inline_parser: None,
             markdown_inline_query: None,
-        };
-
-        // Initialize Phase 1 languages
-        state.init_language(LanguageId::Yaml);
-        state.init_language(LanguageId::Markdown);
-        state.init_language(LanguageId::Rust);
-
-        // Initialize Phase 2 languages (web stack)
-        state.init_language(LanguageId::Html);
-        state.init_language(LanguageId::Css);
-        state.init_language(LanguageId::JavaScript);
-
-        // Initialize Phase 3 languages (priority)
-        state.init_language(LanguageId::TypeScript);
-        state.init_language(LanguageId::Tsx);
-        state.init_language(LanguageId::Jsx);
-        state.init_language(LanguageId::Json);
-        state.init_language(LanguageId::Toml);
-
-        // Initialize Phase 4 languages (common)
-        state.init_language(LanguageId::Python);
-        state.init_language(LanguageId::Go);
-        state.init_language(LanguageId::Php);
-
-        // Initialize Phase 5 languages (extended)
-        state.init_language(LanguageId::C);
-        state.init_language(LanguageId::Cpp);
-        state.init_language(LanguageId::Java);
-        state.init_language(LanguageId::Bash);
-
-        // Initialize Phase 6 languages (specialized)
-        state.init_language(LanguageId::Scheme);
-        state.init_language(LanguageId::Ini);
-        state.init_language(LanguageId::Xml);
-        state.init_language(LanguageId::Sema);
-
-        // Initialize Phase 7 languages (template)
-        state.init_language(LanguageId::Blade);
+            #[cfg(test)]
+            injection_parses: 0,
+        }
+    }
 
-        // Initialize Phase 8 languages (framework)
-        state.init_language(LanguageId::Vue);
-        // Initialize Phase 8 languages (build tooling)
-        state.init_language(LanguageId::Just);
+    /// Initialize a language's parser and query if this is its first use.
+    ///
+    /// Returns whether a parser is available. Initialization is attempted
+    /// once per language; a grammar that fails to load stays unavailable.
+    pub fn ensure_language(&mut self, lang: LanguageId) -> bool {
+        if lang != LanguageId::PlainText && self.initialized.insert(lang) {
+            let start = Instant::now();
+            self.init_language(lang);
+            // Markdown is parsed in two passes (block + inline)
+            if lang == LanguageId::Markdown {
+                self.init_markdown_inline();
+            }
+            let elapsed = start.elapsed();
+            tracing::debug!("Initialized {:?} grammar in {:?}", lang, elapsed);
+            self.init_timings.push((lang, elapsed));
+        }
+        self.parsers.contains_key(&lang)
+    }
 
-        // Initialize markdown inline parser for two-pass parsing
-        state.init_markdown_inline();
+    /// Whether a language has been initialized
+    pub fn is_language_initialized(&self, lang: LanguageId) -> bool {
+        self.initialized.contains(&lang)
+    }
 
-        state
+    /// Take the initialization times recorded since the last call
+    pub fn take_init_timings(&mut self) -> Vec<(LanguageId, Duration)> {
+        std::mem::take(&mut self.init_timings)
     }
 
     /// Initialize the markdown inline grammar parser and query
@@ -360,168 +764,311 @@ impl ParserState {
         language: LanguageId,
         doc_id: DocumentId,
         revision: u64,
+    ) -> SyntaxHighlights {
+        let snapshot = Rope::from_str(source);
+        self.parse_and_highlight_snapshot(&snapshot, None, language, doc_id, revision)
+    }
+
+    /// Parse a rope snapshot and extract highlights.
+    ///
+    /// `delta` carries the edits journaled since the cached tree's revision;
+    /// without it the cached snapshot is diffed against the new one. Parsing
+    /// and highlight queries both read straight from the rope.
+    pub fn parse_and_highlight_snapshot(
+        &mut self,
+        snapshot: &Rope,
+        delta: Option<&EditDelta>,
+        language: LanguageId,
+        doc_id: DocumentId,
+        revision: u64,
     ) -> SyntaxHighlights {
         // Skip plain text
         if language == LanguageId::PlainText {
             return SyntaxHighlights::new(language, revision);
         }
+        let Some(tree) = self.parse_document(snapshot, delta, language, doc_id, revision) else {
+            return SyntaxHighlights::new(language, revision);
+        };
 
-        // Use specialized two-pass parsing for markdown (block + inline)
-        if language == LanguageId::Markdown {
-            return self.parse_and_highlight_markdown(source, doc_id, revision);
-        }
+        let highlights = match language {
+            // Use specialized two-pass parsing for markdown (block + inline)
+            LanguageId::Markdown => self.highlight_markdown(snapshot, &tree, doc_id, revision),
+            // Use specialized parsing with language injection for HTML
+            LanguageId::Html => self.highlight_html(snapshot, &tree, doc_id, revision),
+            // Use specialized parsing with language injection for Vue SFC
+            LanguageId::Vue => self.highlight_vue(snapshot, &tree, doc_id, revision),
+            _ => self.extract_highlights(snapshot, &tree, language, revision),
+        };
+        self.mark_highlighted(doc_id);
+        highlights
+    }
 
-        // Use specialized parsing with language injection for HTML
-        if language == LanguageId::Html {
-            return self.parse_and_highlight_html(source, doc_id, revision);
+    /// Parse a rope snapshot and extract highlights for `lines` only.
+    ///
+    /// This is the viewport-first pass: the result has `covered_lines` set
+    /// and the rest of the document is left to [`Self::highlight_cached`].
+    /// Languages with injected sub-languages (Markdown, HTML, Vue) are
+    /// highlighted as a whole, since their injections are collected by
+    /// walking the entire tree.
+    #[allow(clippy::too_many_arguments)]
+    pub fn parse_and_highlight_lines(
+        &mut self,
+        snapshot: &Rope,
+        delta: Option<&EditDelta>,
+        language: LanguageId,
+        doc_id: DocumentId,
+        revision: u64,
+        lines: Range<usize>,
+    ) -> SyntaxHighlights {
+        if matches!(
+            language,
+            LanguageId::PlainText | LanguageId::Markdown | LanguageId::Html | LanguageId::Vue
+        ) {
+            return self.parse_and_highlight_snapshot(snapshot, delta, language, doc_id, revision);
         }
 
-        // Use specialized parsing with language injection for Vue SFC
-        if language == LanguageId::Vue {
-            return self.parse_and_highlight_vue(source, doc_id, revision);
-        }
+        let Some(tree) = self.parse_document(snapshot, delta, language, doc_id, revision) else {
+            return SyntaxHighlights::new(language, revision);
+        };
+        self.extract_highlights_in(snapshot, &tree, language, revision, Some(lines))
+    }
 
-        let parser = match self.parsers.get_mut(&language) {
-            Some(p) => p,
-            None => {
-                tracing::warn!("No parser for language {:?}", language);
-                return SyntaxHighlights::new(language, revision);
-            }
+    /// Whether lines outside `lines` still need a whole-document pass after a
+    /// viewport-first pass over `lines`.
+    ///
+    /// Returns `false` when every edit since the last whole-document pass
+    /// landed inside `lines` without changing the line count, so the
+    /// highlights the UI already holds for the rest are still correct. Pass
+    /// `has_highlights = false` if the UI dropped its highlights since.
+    pub fn needs_full_pass(
+        &mut self,
+        doc_id: DocumentId,
+        lines: &Range<usize>,
+        has_highlights: bool,
+    ) -> bool {
+        let Some(cached) = self.doc_cache.get_mut(&doc_id) else {
+            return true;
         };
+        if !has_highlights {
+            cached.dirty = DirtyLines::All;
+        }
+        if cached.dirty.within(lines) {
+            cached.dirty = DirtyLines::Clean;
+            return false;
+        }
+        true
+    }
 
-        // Try incremental parsing if we have a cached tree for this document
-        let tree = if let Some(cached) = self.doc_cache.get_mut(&doc_id) {
-            if cached.language == language {
-                // Same language, try incremental parse
-                if let Some(edit) = compute_incremental_edit(&cached.source, source) {
-                    // Apply the edit to the cached tree
-                    cached.tree.edit(&edit);
-
-                    tracing::trace!(
-                        "Incremental parse: edit at byte {}..{} -> {}..{}",
-                        edit.start_byte,
-                        edit.old_end_byte,
-                        edit.start_byte,
-                        edit.new_end_byte
-                    );
+    /// Extract highlights for the whole document from the cached tree.
+    ///
+    /// This is the background half of a viewport-first parse. Returns `None`
+    /// if the cached tree has moved on from `revision` (or was dropped), in
+    /// which case a newer parse supersedes this pass.
+    pub fn highlight_cached(
+        &mut self,
+        doc_id: DocumentId,
+        revision: u64,
+    ) -> Option<SyntaxHighlights> {
+        let cached = self
+            .doc_cache
+            .get(&doc_id)
+            .filter(|cached| cached.revision == revision)?;
+        let highlights =
+            self.extract_highlights(&cached.snapshot, &cached.tree, cached.language, revision);
+        self.mark_highlighted(doc_id);
+        Some(highlights)
+    }
 
-                    // Parse with the edited old tree for incremental reuse
-                    match parser.parse(source, Some(&cached.tree)) {
-                        Some(new_tree) => {
-                            // Update cache with new tree and source
-                            cached.tree = new_tree.clone();
-                            cached.source = source.to_owned();
-                            new_tree
-                        }
-                        None => {
-                            // Incremental parse failed, fall back to full parse
-                            tracing::warn!(
-                                "Incremental parse failed for {:?}, falling back to full parse",
-                                language
-                            );
-                            self.doc_cache.remove(&doc_id);
-                            match parser.parse(source, None) {
-                                Some(t) => {
-                                    self.doc_cache.insert(
-                                        doc_id,
-                                        DocParseState {
-                                            language,
-                                            tree: t.clone(),
-                                            source: source.to_owned(),
-                                        },
-                                    );
-                                    t
-                                }
-                                None => {
-                                    tracing::error!("Full parse also failed for {:?}", language);
-                                    return SyntaxHighlights::new(language, revision);
-                                }
-                            }
-                        }
+    /// Record that the UI now has whole-document highlights for `doc_id`
+    fn mark_highlighted(&mut self, doc_id: DocumentId) {
+        if let Some(cached) = self.doc_cache.get_mut(&doc_id) {
+            cached.dirty = DirtyLines::Clean;
+        }
+    }
+
+    /// Bring the cached tree for `doc_id` up to date with `snapshot`,
+    /// reparsing incrementally when the cached tree can be edited, and
+    /// return the new tree.
+    fn parse_document(
+        &mut self,
+        snapshot: &Rope,
+        delta: Option<&EditDelta>,
+        language: LanguageId,
+        doc_id: DocumentId,
+        revision: u64,
+    ) -> Option<Tree> {
+        if !self.ensure_language(language) {
+            tracing::warn!("No parser for language {:?}", language);
+            return None;
+        }
+
+        let mut dirty = DirtyLines::All;
+        let mut old_revision = 0;
+        let old_tree = match self.doc_cache.remove(&doc_id) {
+            Some(mut cached) if cached.language == language => {
+                old_revision = cached.revision;
+                match sync_cached_tree(&mut cached, snapshot, delta) {
+                    TreeSync::Unchanged => {
+                        tracing::trace!("Source unchanged, reusing cached tree");
+                        let tree = cached.tree.clone();
+                        cached.snapshot = snapshot.clone();
+                        cached.previous = Some((tree.clone(), cached.revision));
+                        cached.revision = revision;
+                        self.doc_cache.insert(doc_id, cached);
+                        return Some(tree);
                     }
-                } else {
-                    // No edit (source unchanged), reuse cached tree
-                    tracing::trace!("Source unchanged, reusing cached tree");
-                    cached.tree.clone()
+                    TreeSync::Edited(touched) => {
+                        dirty = cached.dirty;
+                        dirty.merge(touched);
+                        Some(cached.tree)
+                    }
+                    TreeSync::Stale => None,
                 }
-            } else {
-                // Language changed, do full parse
+            }
+            Some(cached) => {
                 tracing::debug!(
                     "Language changed from {:?} to {:?}, doing full parse",
                     cached.language,
                     language
                 );
-                self.doc_cache.remove(&doc_id);
-                match parser.parse(source, None) {
-                    Some(t) => {
-                        self.doc_cache.insert(
-                            doc_id,
-                            DocParseState {
-                                language,
-                                tree: t.clone(),
-                                source: source.to_owned(),
-                            },
-                        );
-                        t
-                    }
-                    None => {
-                        tracing::error!("Parse failed for {:?}", language);
-                        return SyntaxHighlights::new(language, revision);
-                    }
-                }
+                None
             }
-        } else {
-            // No cached tree, do full parse
-            match parser.parse(source, None) {
-                Some(t) => {
-                    self.doc_cache.insert(
-                        doc_id,
-                        DocParseState {
-                            language,
-                            tree: t.clone(),
-                            source: source.to_owned(),
-                        },
-                    );
-                    t
-                }
-                None => {
-                    tracing::error!("Parse failed for {:?}", language);
-                    return SyntaxHighlights::new(language, revision);
-                }
+            None => None,
+        };
+
+        let parser = self.parsers.get_mut(&language)?;
+        let mut reparsed = old_tree.is_some();
+        let tree = match parse_rope(parser, snapshot, old_tree.as_ref()) {
+            Some(tree) => tree,
+            None if old_tree.is_some() => {
+                tracing::warn!(
+                    "Incremental parse failed for {:?}, falling back to full parse",
+                    language
+                );
+                let Some(tree) = parse_rope(parser, snapshot, None) else {
+                    tracing::error!("Full parse also failed for {:?}", language);
+                    return None;
+                };
+                dirty = DirtyLines::All;
+                reparsed = false;
+                tree
+            }
+            None => {
+                tracing::error!("Parse failed for {:?}", language);
+                return None;
             }
         };
 
-        // Extract highlights
-        self.extract_highlights(source, &tree, language, revision)
+        // Edits can change the structure (and so the colors) of text they
+        // didn't touch, e.g. opening a block comment
+        if let Some(old_tree) = old_tree.as_ref().filter(|_| dirty != DirtyLines::All) {
+            for range in old_tree.changed_ranges(&tree) {
+                dirty.include(range.start_point.row..range.end_point.row + 1);
+            }
+        }
+
+        self.doc_cache.insert(
+            doc_id,
+            DocParseState {
+                language,
+                tree: tree.clone(),
+                snapshot: snapshot.clone(),
+                revision,
+                dirty,
+                previous: old_tree
+                    .filter(|_| reparsed)
+                    .map(|old_tree| (old_tree, old_revision)),
+            },
+        );
+        Some(tree)
     }
 
     /// Remove cached parse state for a document (call when document is closed)
     pub fn clear_doc_cache(&mut self, doc_id: DocumentId) {
         self.doc_cache.remove(&doc_id);
+        self.injections.remove(&doc_id);
+    }
+
+    /// Approximate bytes of cached parse state per document, by document id
+    ///
+    /// Counts each document's tree and injections. Snapshots share their
+    /// chunks with the editor's buffer and the previous tree shares most
+    /// nodes with the current one, so neither is counted.
+    pub fn memory_by_document(&self) -> Vec<(DocumentId, usize)> {
+        let mut documents: HashMap<DocumentId, usize> = self
+            .doc_cache
+            .iter()
+            .map(|(&doc_id, cached)| (doc_id, tree_memory_bytes(&cached.tree)))
+            .collect();
+        for (&doc_id, injections) in &self.injections {
+            *documents.entry(doc_id).or_default() += injections
+                .iter()
+                .map(CachedInjection::memory_bytes)
+                .sum::<usize>();
+        }
+        let mut documents: Vec<(DocumentId, usize)> = documents.into_iter().collect();
+        documents.sort_by_key(|&(doc_id, _)| doc_id.0);
+        documents
     }
 
     /// Extract highlight tokens from a parsed tree
     fn extract_highlights(
         &self,
-        source: &str,
+        source: &Rope,
         tree: &Tree,
         language: LanguageId,
         revision: u64,
     ) -> SyntaxHighlights {
-        let query = match self.queries.get(&language) {
-            Some(q) => q,
-            None => return SyntaxHighlights::new(language, revision),
+        self.extract_highlights_in(source, tree, language, revision, None)
+    }
+
+    /// Extract highlight tokens, limited to `lines` when given.
+    ///
+    /// The query cursor is restricted to the line range, so the cost scales
+    /// with the lines highlighted rather than the size of the file. Tokens of
+    /// nodes that straddle the range are clipped to it.
+    fn extract_highlights_in(
+        &self,
+        source: &Rope,
+        tree: &Tree,
+        language: LanguageId,
+        revision: u64,
+        lines: Option<Range<usize>>,
+    ) -> SyntaxHighlights {
+        let mut highlights = HighlightsBuilder::new(language, revision);
+        if let Some(lines) = lines.clone() {
+            highlights.set_covered_lines(lines);
+        }
+        self.collect_highlights(source, tree, language, lines, &mut highlights);
+        highlights.finish()
+    }
+
+    /// Run the language's highlight query over `tree` and add its tokens
+    fn collect_highlights(
+        &self,
+        source: &Rope,
+        tree: &Tree,
+        language: LanguageId,
+        lines: Option<Range<usize>>,
+        highlights: &mut HighlightsBuilder,
+    ) {
+        let Some(query) = self.queries.get(&language) else {
+            return;
         };
 
-        let mut highlights = SyntaxHighlights::new(language, revision);
         let mut cursor = QueryCursor::new();
-        let source_bytes = source.as_bytes();
 
-        // Pre-split into lines for byte→char column conversion
-        let lines: Vec<&str> = source.lines().collect();
+        let rows = match lines {
+            Some(lines) => {
+                cursor.set_point_range(Point::new(lines.start, 0)..Point::new(lines.end, 0));
+                lines
+            }
+            None => 0..usize::MAX,
+        };
 
         // Run query and collect captures using StreamingIterator
-        let mut captures = cursor.captures(query, tree.root_node(), source_bytes);
+        let mut source_lines = SourceLines::new(source);
+        let mut captures = cursor.captures(query, tree.root_node(), rope_text(source));
         while let Some((query_match, capture_idx)) = captures.next() {
             let capture = &query_match.captures[*capture_idx];
             let capture_name = &query.capture_names()[capture.index as usize];
@@ -536,183 +1083,83 @@ impl ParserState {
             let start = node.start_position();
             let end = node.end_position();
 
-            // Handle multi-line nodes
-            if start.row == end.row {
-                // Single line token
-                let row = start.row;
-                let line = lines.get(row).copied().unwrap_or("");
-                let start_char = byte_to_char_col(line, start.column);
-                let end_char = byte_to_char_col(line, end.column);
-
-                if start_char < end_char {
-                    let line_highlights = highlights.lines.entry(row).or_default();
-                    line_highlights.tokens.push(HighlightToken {
-                        start_col: start_char,
-                        end_col: end_char,
-                        highlight: highlight_id,
-                    });
+            // Walk the node's lines (multi-line nodes are split per line),
+            // locating each line from the node's byte offset instead of
+            // indexing a per-document line table
+            let mut line_start = node.start_byte().saturating_sub(start.column);
+            for row in start.row..(end.row + 1).min(rows.end) {
+                let line = source_lines.line(line_start);
+                line_start = line.next_start;
+                if row < rows.start {
+                    continue;
                 }
-            } else {
-                // Multi-line token: split across lines
-                for row in start.row..=end.row {
-                    let line = lines.get(row).copied().unwrap_or("");
-                    let line_char_len = line.chars().count();
 
-                    let (start_char, end_char) = if row == start.row {
-                        // First line: from start to end of line
-                        let start_char = byte_to_char_col(line, start.column);
-                        (start_char, line_char_len)
-                    } else if row == end.row {
-                        // Last line: from start of line to end position
-                        let end_char = byte_to_char_col(line, end.column);
-                        (0, end_char)
-                    } else {
-                        // Middle lines: entire line
-                        (0, line_char_len)
-                    };
+                let start_char = if row == start.row {
+                    line.char_col(start.column)
+                } else {
+                    0
+                };
+                let end_char = if row == end.row {
+                    line.char_col(end.column)
+                } else {
+                    line.len_chars()
+                };
 
-                    if start_char < end_char {
-                        let line_highlights = highlights.lines.entry(row).or_default();
-                        line_highlights.tokens.push(HighlightToken {
-                            start_col: start_char,
-                            end_col: end_char,
-                            highlight: highlight_id,
-                        });
-                    }
-                }
+                highlights.push(row, start_char, end_char, highlight_id);
             }
         }
-
-        finalize_line_tokens(&mut highlights);
-
-        highlights
     }
 
-    /// Two-pass markdown parsing: block structure + inline elements
-    fn parse_and_highlight_markdown(
+    /// Two-pass markdown highlighting of a parsed block tree: block
+    /// structure + inline elements
+    fn highlight_markdown(
         &mut self,
-        source: &str,
+        source: &Rope,
+        block_tree: &Tree,
         doc_id: DocumentId,
         revision: u64,
     ) -> SyntaxHighlights {
         let language = LanguageId::Markdown;
 
-        // Step 1: Parse block structure with existing block parser
-        let parser = match self.parsers.get_mut(&language) {
-            Some(p) => p,
-            None => {
-                tracing::warn!("No parser for markdown");
-                return SyntaxHighlights::new(language, revision);
-            }
-        };
-
-        // Try incremental parsing if we have a cached tree
-        let block_tree = if let Some(cached) = self.doc_cache.get_mut(&doc_id) {
-            if cached.language == language {
-                if let Some(edit) = compute_incremental_edit(&cached.source, source) {
-                    cached.tree.edit(&edit);
-                    match parser.parse(source, Some(&cached.tree)) {
-                        Some(new_tree) => {
-                            cached.tree = new_tree.clone();
-                            cached.source = source.to_owned();
-                            new_tree
-                        }
-                        None => {
-                            self.doc_cache.remove(&doc_id);
-                            match parser.parse(source, None) {
-                                Some(t) => {
-                                    self.doc_cache.insert(
-                                        doc_id,
-                                        DocParseState {
-                                            language,
-                                            tree: t.clone(),
-                                            source: source.to_owned(),
-                                        },
-                                    );
-                                    t
-                                }
-                                None => return SyntaxHighlights::new(language, revision),
-                            }
-                        }
-                    }
-                } else {
-                    cached.tree.clone()
-                }
-            } else {
-                self.doc_cache.remove(&doc_id);
-                match parser.parse(source, None) {
-                    Some(t) => {
-                        self.doc_cache.insert(
-                            doc_id,
-                            DocParseState {
-                                language,
-                                tree: t.clone(),
-                                source: source.to_owned(),
-                            },
-                        );
-                        t
-                    }
-                    None => return SyntaxHighlights::new(language, revision),
-                }
-            }
-        } else {
-            match parser.parse(source, None) {
-                Some(t) => {
-                    self.doc_cache.insert(
-                        doc_id,
-                        DocParseState {
-                            language,
-                            tree: t.clone(),
-                            source: source.to_owned(),
-                        },
-                    );
-                    t
-                }
-                None => return SyntaxHighlights::new(language, revision),
-            }
-        };
-
-        // Step 2: Extract block-level highlights
-        let mut highlights = self.extract_highlights(source, &block_tree, language, revision);
+        // Step 1: Extract block-level highlights
+        let mut highlights = HighlightsBuilder::new(language, revision);
+        self.collect_highlights(source, block_tree, language, None, &mut highlights);
 
-        // Step 3: Parse inline content if we have the inline parser
+        // Step 2: Parse inline content if we have the inline parser
         if self.markdown_inline_parser.is_some() && self.markdown_inline_query.is_some() {
-            self.parse_markdown_inline_regions(source, &block_tree, &mut highlights);
+            self.parse_markdown_inline_regions(source, block_tree, &mut highlights);
         }
 
-        // Step 4: Language injection for fenced code blocks
-        self.extract_fenced_code_highlights(source, &block_tree, &mut highlights);
+        // Step 3: Language injection for fenced code blocks
+        let mut regions = Vec::new();
+        self.collect_fenced_code_regions(&mut block_tree.walk(), source, &mut regions);
+        self.highlight_injections(doc_id, source, &regions, &mut highlights);
 
-        // Re-sort tokens after adding inline and injected highlights
-        finalize_line_tokens(&mut highlights);
-
-        highlights
+        // Sort block, inline and injected tokens together
+        highlights.finish()
     }
 
     /// Parse inline content regions within markdown block tree
     fn parse_markdown_inline_regions(
         &mut self,
-        source: &str,
+        source: &Rope,
         block_tree: &Tree,
-        highlights: &mut SyntaxHighlights,
+        highlights: &mut HighlightsBuilder,
     ) {
         // Node kinds that contain inline content
         const INLINE_NODE_KINDS: &[&str] = &["paragraph", "heading_content", "pipe_table_cell"];
 
-        let lines: Vec<&str> = source.lines().collect();
-
         // Walk block tree to find nodes with inline content
         let mut cursor = block_tree.walk();
-        self.visit_inline_nodes(&mut cursor, source, &lines, highlights, INLINE_NODE_KINDS);
+        self.visit_inline_nodes(&mut cursor, source, highlights, INLINE_NODE_KINDS);
     }
 
     /// Recursively visit nodes and parse inline content
     fn visit_inline_nodes(
         &mut self,
         cursor: &mut TreeCursor,
-        source: &str,
-        lines: &[&str],
-        highlights: &mut SyntaxHighlights,
+        source: &Rope,
+        highlights: &mut HighlightsBuilder,
         inline_node_kinds: &[&str],
     ) {
         loop {
@@ -723,14 +1170,13 @@ impl ParserState {
                 let start_byte = node.start_byte();
                 let end_byte = node.end_byte();
 
-                if start_byte < end_byte && end_byte <= source.len() {
-                    let inline_source = &source[start_byte..end_byte];
+                if start_byte < end_byte && end_byte <= source.len_bytes() {
+                    let inline_source = rope_text_in(source, start_byte..end_byte);
                     let base_row = node.start_position().row;
                     let base_col = node.start_position().column;
 
                     self.parse_and_extract_inline_highlights(
-                        inline_source,
-                        lines,
+                        &inline_source,
                         highlights,
                         base_row,
                         base_col,
@@ -740,7 +1186,7 @@ impl ParserState {
 
             // Recurse into children
             if cursor.goto_first_child() {
-                self.visit_inline_nodes(cursor, source, lines, highlights, inline_node_kinds);
+                self.visit_inline_nodes(cursor, source, highlights, inline_node_kinds);
                 cursor.goto_parent();
             }
 
@@ -754,8 +1200,7 @@ impl ParserState {
     fn parse_and_extract_inline_highlights(
         &mut self,
         inline_source: &str,
-        _lines: &[&str],
-        highlights: &mut SyntaxHighlights,
+        highlights: &mut HighlightsBuilder,
         base_row: usize,
         base_col: usize,
     ) {
@@ -811,12 +1256,7 @@ impl ParserState {
                 };
 
                 if actual_start_col < actual_end_col {
-                    let line_highlights = highlights.lines.entry(actual_row).or_default();
-                    line_highlights.tokens.push(HighlightToken {
-                        start_col: actual_start_col,
-                        end_col: actual_end_col,
-                        highlight: highlight_id,
-                    });
+                    highlights.push(actual_row, actual_start_col, actual_end_col, highlight_id);
                 }
             } else {
                 // Multi-line inline tokens: split across lines
@@ -842,343 +1282,30 @@ impl ParserState {
                     };
 
                     if actual_start_col < actual_end_col {
-                        let line_highlights = highlights.lines.entry(actual_row).or_default();
-                        line_highlights.tokens.push(HighlightToken {
-                            start_col: actual_start_col,
-                            end_col: actual_end_col,
-                            highlight: highlight_id,
-                        });
+                        highlights.push(actual_row, actual_start_col, actual_end_col, highlight_id);
                     }
                 }
             }
         }
     }
 
-    /// Extract syntax highlights for fenced code blocks using language injection
-    fn extract_fenced_code_highlights(
-        &mut self,
-        source: &str,
-        block_tree: &Tree,
-        highlights: &mut SyntaxHighlights,
-    ) {
-        let lines: Vec<&str> = source.lines().collect();
-
-        // Walk block tree to find fenced_code_block nodes
-        let mut cursor = block_tree.walk();
-        self.visit_code_blocks(&mut cursor, source, &lines, highlights);
-    }
-
-    /// Recursively visit nodes to find and process fenced code blocks
-    fn visit_code_blocks(
-        &mut self,
+    /// Collect the fenced code blocks of a markdown block tree as injections
+    fn collect_fenced_code_regions(
+        &self,
         cursor: &mut TreeCursor,
-        source: &str,
-        lines: &[&str],
-        highlights: &mut SyntaxHighlights,
+        source: &Rope,
+        regions: &mut Vec<InjectionRegion>,
     ) {
         loop {
             let node = cursor.node();
 
             if node.kind() == "fenced_code_block" {
-                self.process_fenced_code_block(node, source, lines, highlights);
+                regions.extend(fenced_code_region(node, source));
             }
 
             // Recurse into children
             if cursor.goto_first_child() {
-                self.visit_code_blocks(cursor, source, lines, highlights);
-                cursor.goto_parent();
-            }
-
-            if !cursor.goto_next_sibling() {
-                break;
-            }
-        }
-    }
-
-    /// Process a single fenced code block for language injection
-    fn process_fenced_code_block(
-        &mut self,
-        node: tree_sitter::Node,
-        source: &str,
-        _lines: &[&str],
-        highlights: &mut SyntaxHighlights,
-    ) {
-        // Find info_string and code_fence_content children
-        let mut language_name: Option<&str> = None;
-        let mut content_node: Option<tree_sitter::Node> = None;
-
-        let mut child_cursor = node.walk();
-        if child_cursor.goto_first_child() {
-            loop {
-                let child = child_cursor.node();
-                match child.kind() {
-                    "info_string" => {
-                        // Get the language from info_string's first child (usually "language" node)
-                        if let Some(lang_node) = child.child(0) {
-                            if lang_node.kind() == "language" {
-                                if let Ok(text) = lang_node.utf8_text(source.as_bytes()) {
-                                    language_name = Some(text);
-                                }
-                            }
-                        }
-                    }
-                    "code_fence_content" => {
-                        content_node = Some(child);
-                    }
-                    _ => {}
-                }
-
-                if !child_cursor.goto_next_sibling() {
-                    break;
-                }
-            }
-        }
-
-        // If we have both language and content, inject highlighting
-        let (Some(lang_str), Some(content)) = (language_name, content_node) else {
-            return;
-        };
-
-        // Map language name to LanguageId
-        let Some(lang_id) = LanguageId::from_code_fence_info(lang_str) else {
-            return;
-        };
-
-        // Skip if we don't have a parser for this language
-        let Some(parser) = self.parsers.get_mut(&lang_id) else {
-            return;
-        };
-
-        // Get the code content
-        let start_byte = content.start_byte();
-        let end_byte = content.end_byte();
-        if start_byte >= end_byte || end_byte > source.len() {
-            return;
-        }
-
-        let code_source = &source[start_byte..end_byte];
-        let base_row = content.start_position().row;
-        let base_col = content.start_position().column;
-
-        // Parse with the language's parser
-        let Some(code_tree) = parser.parse(code_source, None) else {
-            return;
-        };
-
-        // Get the query for this language
-        let Some(query) = self.queries.get(&lang_id) else {
-            return;
-        };
-
-        // Extract highlights from the parsed code
-        let code_lines: Vec<&str> = code_source.lines().collect();
-        let source_bytes = code_source.as_bytes();
-
-        let mut cursor = QueryCursor::new();
-        let mut captures = cursor.captures(query, code_tree.root_node(), source_bytes);
-
-        while let Some((query_match, capture_idx)) = captures.next() {
-            let capture = &query_match.captures[*capture_idx];
-            let capture_name = &query.capture_names()[capture.index as usize];
-
-            let highlight_id = match highlight_id_for_name(capture_name) {
-                Some(id) => id,
-                None => continue,
-            };
-
-            let cap_node = capture.node;
-            let start = cap_node.start_position();
-            let end = cap_node.end_position();
-
-            // Handle single-line tokens
-            if start.row == end.row {
-                let local_line = code_lines.get(start.row).copied().unwrap_or("");
-                let start_char = byte_to_char_col(local_line, start.column);
-                let end_char = byte_to_char_col(local_line, end.column);
-
-                // Adjust for base position
-                let actual_row = base_row + start.row;
-                let (actual_start_col, actual_end_col) = if start.row == 0 {
-                    (base_col + start_char, base_col + end_char)
-                } else {
-                    (start_char, end_char)
-                };
-
-                if actual_start_col < actual_end_col {
-                    // Remove any existing highlight for this range (block query may have
-                    // marked the whole content as @string)
-                    let line_highlights = highlights.lines.entry(actual_row).or_default();
-                    line_highlights.tokens.push(HighlightToken {
-                        start_col: actual_start_col,
-                        end_col: actual_end_col,
-                        highlight: highlight_id,
-                    });
-                }
-            } else {
-                // Multi-line tokens: split across lines
-                for row in start.row..=end.row {
-                    let local_line = code_lines.get(row).copied().unwrap_or("");
-                    let line_char_len = local_line.chars().count();
-
-                    let (start_char, end_char) = if row == start.row {
-                        let start_char = byte_to_char_col(local_line, start.column);
-                        (start_char, line_char_len)
-                    } else if row == end.row {
-                        let end_char = byte_to_char_col(local_line, end.column);
-                        (0, end_char)
-                    } else {
-                        (0, line_char_len)
-                    };
-
-                    let actual_row = base_row + row;
-                    let (actual_start_col, actual_end_col) = if row == 0 {
-                        (base_col + start_char, base_col + end_char)
-                    } else {
-                        (start_char, end_char)
-                    };
-
-                    if actual_start_col < actual_end_col {
-                        let line_highlights = highlights.lines.entry(actual_row).or_default();
-                        line_highlights.tokens.push(HighlightToken {
-                            start_col: actual_start_col,
-                            end_col: actual_end_col,
-                            highlight: highlight_id,
-                        });
-                    }
-                }
-            }
-        }
-    }
-
-    /// Specialized HTML parsing with script/style language injection
-    fn parse_and_highlight_html(
-        &mut self,
-        source: &str,
-        doc_id: DocumentId,
-        revision: u64,
-    ) -> SyntaxHighlights {
-        let language = LanguageId::Html;
-
-        // Step 1: Parse HTML structure
-        let parser = match self.parsers.get_mut(&language) {
-            Some(p) => p,
-            None => {
-                tracing::warn!("No parser for HTML");
-                return SyntaxHighlights::new(language, revision);
-            }
-        };
-
-        // Try incremental parsing if cached
-        let html_tree = if let Some(cached) = self.doc_cache.get_mut(&doc_id) {
-            if cached.language == language {
-                if let Some(edit) = compute_incremental_edit(&cached.source, source) {
-                    cached.tree.edit(&edit);
-                    match parser.parse(source, Some(&cached.tree)) {
-                        Some(new_tree) => {
-                            cached.tree = new_tree.clone();
-                            cached.source = source.to_owned();
-                            new_tree
-                        }
-                        None => {
-                            self.doc_cache.remove(&doc_id);
-                            match parser.parse(source, None) {
-                                Some(t) => {
-                                    self.doc_cache.insert(
-                                        doc_id,
-                                        DocParseState {
-                                            language,
-                                            tree: t.clone(),
-                                            source: source.to_owned(),
-                                        },
-                                    );
-                                    t
-                                }
-                                None => return SyntaxHighlights::new(language, revision),
-                            }
-                        }
-                    }
-                } else {
-                    cached.tree.clone()
-                }
-            } else {
-                self.doc_cache.remove(&doc_id);
-                match parser.parse(source, None) {
-                    Some(t) => {
-                        self.doc_cache.insert(
-                            doc_id,
-                            DocParseState {
-                                language,
-                                tree: t.clone(),
-                                source: source.to_owned(),
-                            },
-                        );
-                        t
-                    }
-                    None => return SyntaxHighlights::new(language, revision),
-                }
-            }
-        } else {
-            match parser.parse(source, None) {
-                Some(t) => {
-                    self.doc_cache.insert(
-                        doc_id,
-                        DocParseState {
-                            language,
-                            tree: t.clone(),
-                            source: source.to_owned(),
-                        },
-                    );
-                    t
-                }
-                None => return SyntaxHighlights::new(language, revision),
-            }
-        };
-
-        // Step 2: Extract HTML-level highlights
-        let mut highlights = self.extract_highlights(source, &html_tree, language, revision);
-
-        // Step 3: Language injection for <script> and <style> elements
-        self.extract_html_embedded_highlights(source, &html_tree, &mut highlights);
-
-        // Re-sort tokens after adding injected highlights
-        finalize_line_tokens(&mut highlights);
-
-        highlights
-    }
-
-    /// Extract highlights for embedded script/style content in HTML
-    fn extract_html_embedded_highlights(
-        &mut self,
-        source: &str,
-        html_tree: &Tree,
-        highlights: &mut SyntaxHighlights,
-    ) {
-        let mut cursor = html_tree.walk();
-        self.visit_html_embedded_elements(&mut cursor, source, highlights);
-    }
-
-    /// Recursively visit nodes to find script/style elements
-    fn visit_html_embedded_elements(
-        &mut self,
-        cursor: &mut TreeCursor,
-        source: &str,
-        highlights: &mut SyntaxHighlights,
-    ) {
-        loop {
-            let node = cursor.node();
-
-            match node.kind() {
-                "script_element" => {
-                    self.process_script_element(node, source, highlights);
-                }
-                "style_element" => {
-                    self.process_style_element(node, source, highlights);
-                }
-                _ => {}
-            }
-
-            if cursor.goto_first_child() {
-                self.visit_html_embedded_elements(cursor, source, highlights);
+                self.collect_fenced_code_regions(cursor, source, regions);
                 cursor.goto_parent();
             }
 
@@ -1188,199 +1315,85 @@ impl ParserState {
         }
     }
 
-    /// Process <script> element - inject JavaScript highlighting
-    fn process_script_element(
-        &mut self,
-        node: tree_sitter::Node,
-        source: &str,
-        highlights: &mut SyntaxHighlights,
-    ) {
-        // Find raw_text child (the script content)
-        let mut raw_text_node: Option<tree_sitter::Node> = None;
-
-        let mut child_cursor = node.walk();
-        if child_cursor.goto_first_child() {
-            loop {
-                let child = child_cursor.node();
-                if child.kind() == "raw_text" {
-                    raw_text_node = Some(child);
-                    break;
-                }
-                if !child_cursor.goto_next_sibling() {
-                    break;
-                }
-            }
-        }
-
-        let Some(raw_text) = raw_text_node else {
-            return;
-        };
-
-        // Default to JavaScript (could check type attribute for TypeScript)
-        self.inject_html_language_highlights(raw_text, source, LanguageId::JavaScript, highlights);
-    }
-
-    /// Process <style> element - inject CSS highlighting
-    fn process_style_element(
-        &mut self,
-        node: tree_sitter::Node,
-        source: &str,
-        highlights: &mut SyntaxHighlights,
-    ) {
-        // Find raw_text child (the style content)
-        let mut raw_text_node: Option<tree_sitter::Node> = None;
-
-        let mut child_cursor = node.walk();
-        if child_cursor.goto_first_child() {
-            loop {
-                let child = child_cursor.node();
-                if child.kind() == "raw_text" {
-                    raw_text_node = Some(child);
-                    break;
-                }
-                if !child_cursor.goto_next_sibling() {
-                    break;
-                }
-            }
-        }
-
-        let Some(raw_text) = raw_text_node else {
-            return;
-        };
-
-        self.inject_html_language_highlights(raw_text, source, LanguageId::Css, highlights);
-    }
-
-    /// Specialized Vue SFC parsing - HTML structure with smart script language detection
-    fn parse_and_highlight_vue(
+    /// Specialized HTML highlighting with script/style language injection
+    fn highlight_html(
         &mut self,
-        source: &str,
+        source: &Rope,
+        html_tree: &Tree,
         doc_id: DocumentId,
         revision: u64,
     ) -> SyntaxHighlights {
-        let language = LanguageId::Vue;
-
-        // Step 1: Parse with HTML grammar (Vue SFC is structurally valid HTML)
-        let parser = match self.parsers.get_mut(&language) {
-            Some(p) => p,
-            None => {
-                tracing::warn!("No parser for Vue");
-                return SyntaxHighlights::new(language, revision);
-            }
-        };
-
-        // Try incremental parsing if cached
-        let tree = if let Some(cached) = self.doc_cache.get_mut(&doc_id) {
-            if cached.language == language {
-                if let Some(edit) = compute_incremental_edit(&cached.source, source) {
-                    cached.tree.edit(&edit);
-                    match parser.parse(source, Some(&cached.tree)) {
-                        Some(new_tree) => {
-                            cached.tree = new_tree.clone();
-                            cached.source = source.to_owned();
-                            new_tree
-                        }
-                        None => {
-                            self.doc_cache.remove(&doc_id);
-                            match parser.parse(source, None) {
-                                Some(t) => {
-                                    self.doc_cache.insert(
-                                        doc_id,
-                                        DocParseState {
-                                            language,
-                                            tree: t.clone(),
-                                            source: source.to_owned(),
-                                        },
-                                    );
-                                    t
-                                }
-                                None => return SyntaxHighlights::new(language, revision),
-                            }
-                        }
-                    }
-                } else {
-                    cached.tree.clone()
-                }
-            } else {
-                self.doc_cache.remove(&doc_id);
-                match parser.parse(source, None) {
-                    Some(t) => {
-                        self.doc_cache.insert(
-                            doc_id,
-                            DocParseState {
-                                language,
-                                tree: t.clone(),
-                                source: source.to_owned(),
-                            },
-                        );
-                        t
-                    }
-                    None => return SyntaxHighlights::new(language, revision),
-                }
-            }
-        } else {
-            match parser.parse(source, None) {
-                Some(t) => {
-                    self.doc_cache.insert(
-                        doc_id,
-                        DocParseState {
-                            language,
-                            tree: t.clone(),
-                            source: source.to_owned(),
-                        },
-                    );
-                    t
-                }
-                None => return SyntaxHighlights::new(language, revision),
-            }
-        };
-
-        // Step 2: Extract HTML-level highlights (Vue uses same query as HTML)
-        let mut highlights = self.extract_highlights(source, &tree, language, revision);
+        let language = LanguageId::Html;
 
-        // Step 3: Language injection for script/style with Vue-aware lang detection
-        self.extract_vue_embedded_highlights(source, &tree, &mut highlights);
+        // Step 1: Extract HTML-level highlights
+        let mut highlights = HighlightsBuilder::new(language, revision);
+        self.collect_highlights(source, html_tree, language, None, &mut highlights);
 
-        // Re-sort tokens after adding injected highlights
-        finalize_line_tokens(&mut highlights);
+        // Step 2: Language injection for <script> and <style> elements
+        let mut regions = Vec::new();
+        self.collect_embedded_regions(&mut html_tree.walk(), source, false, &mut regions);
+        self.highlight_injections(doc_id, source, &regions, &mut highlights);
 
-        highlights
+        // Sort host and injected tokens together
+        highlights.finish()
     }
 
-    /// Extract highlights for embedded script/style content in Vue SFC
-    fn extract_vue_embedded_highlights(
+    /// Specialized Vue SFC highlighting of a tree parsed with the HTML
+    /// grammar (Vue SFC is structurally valid HTML), with smart script
+    /// language detection
+    fn highlight_vue(
         &mut self,
-        source: &str,
+        source: &Rope,
         tree: &Tree,
-        highlights: &mut SyntaxHighlights,
-    ) {
-        let mut cursor = tree.walk();
-        self.visit_vue_embedded_elements(&mut cursor, source, highlights);
+        doc_id: DocumentId,
+        revision: u64,
+    ) -> SyntaxHighlights {
+        let language = LanguageId::Vue;
+
+        // Step 1: Extract HTML-level highlights (Vue uses same query as HTML)
+        let mut highlights = HighlightsBuilder::new(language, revision);
+        self.collect_highlights(source, tree, language, None, &mut highlights);
+
+        // Step 2: Language injection for script/style with Vue-aware lang detection
+        let mut regions = Vec::new();
+        self.collect_embedded_regions(&mut tree.walk(), source, true, &mut regions);
+        self.highlight_injections(doc_id, source, &regions, &mut highlights);
+
+        // Sort host and injected tokens together
+        highlights.finish()
     }
 
-    /// Recursively visit nodes to find script/style elements in Vue SFC
-    fn visit_vue_embedded_elements(
-        &mut self,
+    /// Recursively collect the contents of script/style elements as injections
+    ///
+    /// Scripts are JavaScript in HTML; in Vue SFCs their `lang` attribute
+    /// selects TypeScript or TSX.
+    fn collect_embedded_regions(
+        &self,
         cursor: &mut TreeCursor,
-        source: &str,
-        highlights: &mut SyntaxHighlights,
+        source: &Rope,
+        vue: bool,
+        regions: &mut Vec<InjectionRegion>,
     ) {
         loop {
             let node = cursor.node();
 
-            match node.kind() {
-                "script_element" => {
-                    self.process_vue_script_element(node, source, highlights);
-                }
-                "style_element" => {
-                    // Style injection is identical to HTML
-                    self.process_style_element(node, source, highlights);
-                }
-                _ => {}
+            let language = match node.kind() {
+                "script_element" if vue => Some(detect_vue_script_language(node, source)),
+                // Could check the type attribute for TypeScript
+                "script_element" => Some(LanguageId::JavaScript),
+                "style_element" => Some(LanguageId::Css),
+                _ => None,
+            };
+            if let Some(language) = language {
+                regions.extend(
+                    raw_text_child(node).and_then(|raw_text| {
+                        InjectionRegion::from_node(raw_text, source, language)
+                    }),
+                );
             }
 
             if cursor.goto_first_child() {
-                self.visit_vue_embedded_elements(cursor, source, highlights);
+                self.collect_embedded_regions(cursor, source, vue, regions);
                 cursor.goto_parent();
             }
 
@@ -1390,71 +1403,104 @@ impl ParserState {
         }
     }
 
-    /// Process Vue <script> element - detect lang attribute for TypeScript support
-    fn process_vue_script_element(
+    /// Highlight injected regions, reusing the document's cached injections.
+    ///
+    /// An injection whose text is unchanged since the last pass reuses its
+    /// tokens without parsing. Otherwise it is paired with a leftover cached
+    /// injection of the same language in document order, which is the one an
+    /// edit landed in; the edit between their texts is applied to the cached
+    /// tree and only the changed part is re-parsed.
+    fn highlight_injections(
         &mut self,
-        node: tree_sitter::Node,
-        source: &str,
-        highlights: &mut SyntaxHighlights,
+        doc_id: DocumentId,
+        source: &Rope,
+        regions: &[InjectionRegion],
+        highlights: &mut HighlightsBuilder,
     ) {
-        let lang_id = detect_vue_script_language(node, source);
-
-        // Find raw_text child (the script content)
-        let mut child_cursor = node.walk();
-        if child_cursor.goto_first_child() {
-            loop {
-                let child = child_cursor.node();
-                if child.kind() == "raw_text" {
-                    self.inject_html_language_highlights(child, source, lang_id, highlights);
-                    break;
-                }
-                if !child_cursor.goto_next_sibling() {
-                    break;
+        let mut previous: Vec<Option<CachedInjection>> = self
+            .injections
+            .remove(&doc_id)
+            .unwrap_or_default()
+            .into_iter()
+            .map(Some)
+            .collect();
+
+        // Unchanged injections, found scanning forward from the last match
+        // since regions and cached injections are both in document order
+        let mut hint = 0;
+        let reused: Vec<Option<CachedInjection>> = regions
+            .iter()
+            .map(|region| {
+                let text = rope_text_in(source, region.bytes.clone());
+                let found = (hint..previous.len()).chain(0..hint).find(|&i| {
+                    previous[i].as_ref().is_some_and(|cached| {
+                        cached.language == region.language && cached.text == text
+                    })
+                })?;
+                hint = found + 1;
+                previous[found].take()
+            })
+            .collect();
+
+        // Cached injections still left over were edited (or removed)
+        let mut current = Vec::with_capacity(regions.len());
+        for (region, reused) in regions.iter().zip(reused) {
+            let injection = match reused {
+                Some(cached) => Some(cached),
+                None => {
+                    let edited = previous
+                        .iter_mut()
+                        .find(|cached| {
+                            cached
+                                .as_ref()
+                                .is_some_and(|cached| cached.language == region.language)
+                        })
+                        .and_then(Option::take);
+                    self.parse_injection(source, region, edited)
                 }
+            };
+            if let Some(injection) = injection {
+                injection.push_tokens(region, highlights);
+                current.push(injection);
             }
         }
+
+        if !current.is_empty() {
+            self.injections.insert(doc_id, current);
+        }
     }
 
-    /// Inject language highlights for HTML embedded content
-    fn inject_html_language_highlights(
+    /// Parse one injected region, incrementally when `previous` holds the
+    /// region's last tree, and collect its tokens
+    fn parse_injection(
         &mut self,
-        raw_text: tree_sitter::Node,
-        source: &str,
-        lang_id: LanguageId,
-        highlights: &mut SyntaxHighlights,
-    ) {
-        let start_byte = raw_text.start_byte();
-        let end_byte = raw_text.end_byte();
-
-        if start_byte >= end_byte || end_byte > source.len() {
-            return;
+        source: &Rope,
+        region: &InjectionRegion,
+        previous: Option<CachedInjection>,
+    ) -> Option<CachedInjection> {
+        let lang_id = region.language;
+        if !self.ensure_language(lang_id) {
+            return None;
         }
+        let code_text = rope_text_in(source, region.bytes.clone());
+        let code_source: &str = &code_text;
 
-        let code_source = &source[start_byte..end_byte];
-        let base_row = raw_text.start_position().row;
-        let base_col = raw_text.start_position().column;
-
-        // Get parser for this language
-        let Some(parser) = self.parsers.get_mut(&lang_id) else {
-            return;
-        };
-
-        // Parse the embedded code
-        let Some(code_tree) = parser.parse(code_source, None) else {
-            return;
-        };
+        let old_tree = previous.and_then(|mut cached| {
+            let edit = compute_incremental_edit(&cached.text, code_source)?;
+            cached.tree.edit(&edit);
+            Some(cached.tree)
+        });
 
-        // Get query for this language
-        let Some(query) = self.queries.get(&lang_id) else {
-            return;
-        };
+        let parser = self.parsers.get_mut(&lang_id)?;
+        let code_tree = parser.parse(code_source, old_tree.as_ref())?;
+        let query = self.queries.get(&lang_id)?;
 
-        // Extract highlights
-        let code_lines: Vec<&str> = code_source.lines().collect();
-        let source_bytes = code_source.as_bytes();
+        // Extract highlights relative to the start of the region
+        let mut code_lines = SourceLines::new(code_source);
+        let mut tokens = Vec::new();
 
         let mut cursor = QueryCursor::new();
-        let mut captures = cursor.captures(query, code_tree.root_node(), source_bytes);
+        let mut captures = cursor.captures(query, code_tree.root_node(), code_source.as_bytes());
 
         while let Some((query_match, capture_idx)) = captures.next() {
             let capture = &query_match.captures[*capture_idx];
@@ -1469,60 +1515,101 @@ impl ParserState {
             let start = cap_node.start_position();
             let end = cap_node.end_position();
 
-            // Handle single-line tokens
-            if start.row == end.row {
-                let local_line = code_lines.get(start.row).copied().unwrap_or("");
-                let start_char = byte_to_char_col(local_line, start.column);
-                let end_char = byte_to_char_col(local_line, end.column);
-
-                let actual_row = base_row + start.row;
-                let (actual_start_col, actual_end_col) = if start.row == 0 {
-                    (base_col + start_char, base_col + end_char)
+            // Multi-line tokens are split across lines
+            let mut line_start = cap_node.start_byte().saturating_sub(start.column);
+            for row in start.row..=end.row {
+                let local_line = code_lines.line(line_start);
+                line_start = local_line.next_start;
+                let start_char = if row == start.row {
+                    local_line.char_col(start.column)
                 } else {
-                    (start_char, end_char)
+                    0
+                };
+                let end_char = if row == end.row {
+                    local_line.char_col(end.column)
+                } else {
+                    local_line.len_chars()
                 };
 
-                if actual_start_col < actual_end_col {
-                    let line_highlights = highlights.lines.entry(actual_row).or_default();
-                    line_highlights.tokens.push(HighlightToken {
-                        start_col: actual_start_col,
-                        end_col: actual_end_col,
-                        highlight: highlight_id,
-                    });
+                if start_char < end_char {
+                    tokens.push((row, start_char, end_char, highlight_id));
                 }
-            } else {
-                // Multi-line tokens
-                for row in start.row..=end.row {
-                    let local_line = code_lines.get(row).copied().unwrap_or("");
-                    let line_char_len = local_line.chars().count();
+            }
+        }
 
-                    let (start_char, end_char) = if row == start.row {
-                        let sc = byte_to_char_col(local_line, start.column);
-                        (sc, line_char_len)
-                    } else if row == end.row {
-                        let ec = byte_to_char_col(local_line, end.column);
-                        (0, ec)
-                    } else {
-                        (0, line_char_len)
-                    };
+        tracing::trace!(
+            "Parsed {:?} injection ({} bytes, incremental={})",
+            lang_id,
+            code_source.len(),
+            old_tree.is_some()
+        );
 
-                    let actual_row = base_row + row;
-                    let (actual_start_col, actual_end_col) = if row == 0 {
-                        (base_col + start_char, base_col + end_char)
-                    } else {
-                        (start_char, end_char)
-                    };
+        Some(CachedInjection {
+            language: lang_id,
+            text: code_source.to_string(),
+            tree: code_tree,
+            tokens,
+            #[cfg(test)]
+            parse_serial: {
+                self.injection_parses += 1;
+                self.injection_parses
+            },
+        })
+    }
+}
 
-                    if actual_start_col < actual_end_col {
-                        let line_highlights = highlights.lines.entry(actual_row).or_default();
-                        line_highlights.tokens.push(HighlightToken {
-                            start_col: actual_start_col,
-                            end_col: actual_end_col,
-                            highlight: highlight_id,
-                        });
+/// The injection for a fenced code block with a recognized info string
+fn fenced_code_region(node: tree_sitter::Node, source: &Rope) -> Option<InjectionRegion> {
+    // Find info_string and code_fence_content children
+    let mut language_name: Option<Cow<str>> = None;
+    let mut content_node: Option<tree_sitter::Node> = None;
+
+    let mut child_cursor = node.walk();
+    if child_cursor.goto_first_child() {
+        loop {
+            let child = child_cursor.node();
+            match child.kind() {
+                "info_string" => {
+                    // Get the language from info_string's first child (usually "language" node)
+                    if let Some(lang_node) = child.child(0) {
+                        if lang_node.kind() == "language" {
+                            language_name = Some(rope_text_in(
+                                source,
+                                lang_node.start_byte()..lang_node.end_byte(),
+                            ));
+                        }
                     }
                 }
+                "code_fence_content" => {
+                    content_node = Some(child);
+                }
+                _ => {}
             }
+
+            if !child_cursor.goto_next_sibling() {
+                break;
+            }
+        }
+    }
+
+    // Map language name to LanguageId
+    let language = LanguageId::from_code_fence_info(&language_name?)?;
+    InjectionRegion::from_node(content_node?, source, language)
+}
+
+/// The `raw_text` child of a script/style element (its content)
+fn raw_text_child(node: tree_sitter::Node) -> Option<tree_sitter::Node> {
+    let mut child_cursor = node.walk();
+    if !child_cursor.goto_first_child() {
+        return None;
+    }
+    loop {
+        let child = child_cursor.node();
+        if child.kind() == "raw_text" {
+            return Some(child);
+        }
+        if !child_cursor.goto_next_sibling() {
+            return None;
         }
     }
 }
@@ -1530,7 +1617,7 @@ impl ParserState {
 /// Detect the script language from a Vue SFC `<script>` element's `lang` attribute.
 /// Returns TypeScript for `lang="ts"` or `lang="typescript"`, TSX for `lang="tsx"`,
 /// and JavaScript as default.
-fn detect_vue_script_language(script_node: tree_sitter::Node, source: &str) -> LanguageId {
+fn detect_vue_script_language(script_node: tree_sitter::Node, source: &Rope) -> LanguageId {
     let mut cursor = script_node.walk();
     if !cursor.goto_first_child() {
         return LanguageId::JavaScript;
@@ -1549,14 +1636,14 @@ fn detect_vue_script_language(script_node: tree_sitter::Node, source: &str) -> L
                         if ac.goto_first_child() {
                             loop {
                                 let n = ac.node();
+                                let text = rope_text_in(source, n.start_byte()..n.end_byte());
                                 if n.kind() == "attribute_name" {
-                                    let name = &source[n.start_byte()..n.end_byte()];
-                                    is_lang = name == "lang";
+                                    is_lang = text == "lang";
                                 } else if n.kind() == "quoted_attribute_value"
                                     || n.kind() == "attribute_value"
                                 {
-                                    let v = &source[n.start_byte()..n.end_byte()];
-                                    value = Some(v.trim_matches('"').trim_matches('\''));
+                                    value =
+                                        Some(text.trim_matches('"').trim_matches('\'').to_string());
                                 }
                                 if !ac.goto_next_sibling() {
                                     break;
@@ -1565,7 +1652,7 @@ fn detect_vue_script_language(script_node: tree_sitter::Node, source: &str) -> L
                         }
                         if is_lang {
                             if let Some(v) = value {
-                                return match v {
+                                return match v.as_str() {
                                     "ts" | "typescript" => LanguageId::TypeScript,
                                     "tsx" => LanguageId::Tsx,
                                     _ => LanguageId::JavaScript,
@@ -1609,11 +1696,11 @@ enabled: true
         let highlights = state.parse_and_highlight(source, LanguageId::Yaml, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Yaml);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
 
         // Check that comment line has a comment token
-        if let Some(line0) = highlights.lines.get(&0) {
-            assert!(!line0.tokens.is_empty());
+        if let Some(line0) = highlights.get_line(0) {
+            assert!(!line0.is_empty());
         }
     }
 
@@ -1629,7 +1716,7 @@ enabled: true
         let highlights = state.parse_and_highlight(source, LanguageId::Rust, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Rust);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -1640,13 +1727,13 @@ enabled: true
         let highlights = state.parse_and_highlight(source, LanguageId::PlainText, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::PlainText);
-        assert!(highlights.lines.is_empty());
+        assert!(highlights.is_empty());
     }
 
     #[test]
     fn test_all_query_files_compile() {
         // This test ensures all .scm query files are valid and compile without errors
-        let state = ParserState::new();
+        let mut state = ParserState::new();
 
         // All languages with highlighting should have compiled queries
         let languages_with_queries = [
@@ -1684,6 +1771,7 @@ enabled: true
         ];
 
         for lang in languages_with_queries {
+            assert!(state.ensure_language(lang), "No parser for {:?}", lang);
             assert!(
                 state.queries.contains_key(&lang),
                 "Query failed to compile for {:?}",
@@ -1692,6 +1780,40 @@ enabled: true
         }
     }
 
+    #[test]
+    fn test_languages_initialize_on_first_use() {
+        let mut state = ParserState::new();
+        assert!(!state.is_language_initialized(LanguageId::Rust));
+        assert!(state.take_init_timings().is_empty());
+
+        state.parse_and_highlight("fn main() {}", LanguageId::Rust, DocumentId(1), 1);
+        assert!(state.is_language_initialized(LanguageId::Rust));
+        assert!(!state.is_language_initialized(LanguageId::Python));
+
+        let timings = state.take_init_timings();
+        assert_eq!(timings.len(), 1);
+        assert_eq!(timings[0].0, LanguageId::Rust);
+
+        // Already initialized: nothing new to report
+        assert!(state.ensure_language(LanguageId::Rust));
+        assert!(state.take_init_timings().is_empty());
+
+        // Plain text has no grammar and is never initialized
+        assert!(!state.ensure_language(LanguageId::PlainText));
+        assert!(!state.is_language_initialized(LanguageId::PlainText));
+    }
+
+    #[test]
+    fn test_injected_language_initializes_on_demand() {
+        let mut state = ParserState::new();
+        let source = "# Title\n\n```rust\nfn main() {}\n```\n";
+        state.parse_and_highlight(source, LanguageId::Markdown, DocumentId(2), 1);
+
+        assert!(state.is_language_initialized(LanguageId::Markdown));
+        assert!(state.is_language_initialized(LanguageId::Rust));
+        assert!(!state.is_language_initialized(LanguageId::Python));
+    }
+
     /// Test that each query file compiles correctly and show detailed errors if not.
     /// These tests are separate per language to make failures more specific.
     mod query_compilation_tests {
@@ -1900,17 +2022,17 @@ enabled: true
 
     /// Guard the last-match-wins capture precedence: generic fallbacks come
     /// first in the query files, specific overrides last, and the override
-    /// must win for identical spans (see `finalize_line_tokens`).
+    /// must win for identical spans (see `HighlightsBuilder::finish`).
     #[test]
     fn test_capture_precedence_last_match_wins() {
         let mut state = ParserState::new();
 
         let source = "(define (factorial n) 1)\n";
         let highlights = state.parse_and_highlight(source, LanguageId::Sema, DocumentId(60), 1);
-        let line = &highlights.lines[&0];
+        let line = highlights.get_line_tokens(0);
 
         let name_at = |col: usize| {
-            line.highlight_at(col)
+            crate::syntax::highlights::highlight_at(line, col)
                 .map(|id| crate::syntax::highlights::HIGHLIGHT_NAMES[id as usize])
                 .unwrap_or("<none>")
         };
@@ -1934,7 +2056,7 @@ enabled: true
         let highlights = state.parse_and_highlight(source, LanguageId::Html, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Html);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -1949,7 +2071,7 @@ enabled: true
         let highlights = state.parse_and_highlight(source, LanguageId::Css, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Css);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -1964,7 +2086,7 @@ const x = 42;"#;
         let highlights = state.parse_and_highlight(source, LanguageId::JavaScript, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::JavaScript);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -1984,7 +2106,7 @@ fn main() {}
         let highlights = state.parse_and_highlight(source, LanguageId::Markdown, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Markdown);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     // Phase 3 parsing tests
@@ -2006,7 +2128,7 @@ const x: number = 42;"#;
         let highlights = state.parse_and_highlight(source, LanguageId::TypeScript, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::TypeScript);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2025,7 +2147,7 @@ export default Hello;"#;
         let highlights = state.parse_and_highlight(source, LanguageId::Tsx, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Tsx);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2045,7 +2167,32 @@ export default Hello;"#;
         let highlights = state.parse_and_highlight(source, LanguageId::Json, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Json);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
+    }
+
+    #[test]
+    fn test_long_line_token_columns() {
+        let mut state = ParserState::new();
+        // A minified line past LONG_LINE_BYTES whose byte and char columns
+        // drift apart
+        let line = format!("[{}1]", "\"é\",".repeat(2000));
+        let source = format!("{line}\n[\"é\"]\n");
+        assert!(line.len() >= LONG_LINE_BYTES);
+        let doc_id = DocumentId(24);
+        let highlights = state.parse_and_highlight(&source, LanguageId::Json, doc_id, 1);
+
+        let string = highlight_id_for_name("string").unwrap();
+        let strings = |line: usize| -> Vec<(u32, u32)> {
+            highlights
+                .get_line_tokens(line)
+                .iter()
+                .filter(|t| t.highlight == string)
+                .map(|t| (t.start_col, t.end_col))
+                .collect()
+        };
+        let expected: Vec<(u32, u32)> = (0..2000).map(|i| (1 + 4 * i, 4 + 4 * i)).collect();
+        assert_eq!(strings(0), expected);
+        assert_eq!(strings(1), vec![(1, 4)]);
     }
 
     #[test]
@@ -2066,7 +2213,7 @@ path = "src/main.rs""#;
         let highlights = state.parse_and_highlight(source, LanguageId::Toml, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Toml);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     // Phase 4 parsing tests
@@ -2088,7 +2235,7 @@ if __name__ == "__main__":
         let highlights = state.parse_and_highlight(source, LanguageId::Python, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Python);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2115,7 +2262,7 @@ func main() {
         let highlights = state.parse_and_highlight(source, LanguageId::Go, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Go);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2143,7 +2290,7 @@ echo $user->greet();
         let highlights = state.parse_and_highlight(source, LanguageId::Php, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Php);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     // Phase 5 parsing tests
@@ -2171,7 +2318,7 @@ int main() {
         let highlights = state.parse_and_highlight(source, LanguageId::C, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::C);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2201,7 +2348,7 @@ int main() {
         let highlights = state.parse_and_highlight(source, LanguageId::Cpp, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Cpp);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2231,7 +2378,7 @@ public class Person {
         let highlights = state.parse_and_highlight(source, LanguageId::Java, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Java);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2258,7 +2405,7 @@ fi"#;
         let highlights = state.parse_and_highlight(source, LanguageId::Bash, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Bash);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2281,7 +2428,7 @@ fi"#;
         let highlights = state.parse_and_highlight(source, LanguageId::Scheme, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Scheme);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2307,7 +2454,7 @@ fi"#;
         let highlights = state.parse_and_highlight(source, LanguageId::Sema, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Sema);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2323,7 +2470,7 @@ number = 42
         let highlights = state.parse_and_highlight(source, LanguageId::Ini, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Ini);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2342,7 +2489,7 @@ number = 42
         let highlights = state.parse_and_highlight(source, LanguageId::Xml, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Xml);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2360,7 +2507,7 @@ test:
         let highlights = state.parse_and_highlight(source, LanguageId::Just, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Just);
-        assert!(!highlights.lines.is_empty());
+        assert!(!highlights.is_empty());
     }
 
     #[test]
@@ -2372,7 +2519,7 @@ test:
         let source1 = "let x = 1;";
         let highlights1 = state.parse_and_highlight(source1, LanguageId::JavaScript, doc_id, 1);
         assert!(
-            !highlights1.lines.is_empty(),
+            !highlights1.is_empty(),
             "Initial parse should produce highlights"
         );
 
@@ -2380,16 +2527,13 @@ test:
         let source2 = "let x = 1;\nlet y = 2;";
         let highlights2 = state.parse_and_highlight(source2, LanguageId::JavaScript, doc_id, 2);
         assert!(
-            !highlights2.lines.is_empty(),
+            !highlights2.is_empty(),
             "Second parse should produce highlights"
         );
         assert_eq!(highlights2.revision, 2, "Revision should match");
 
         // Verify we have highlights for line 0
-        assert!(
-            highlights2.lines.contains_key(&0),
-            "Should have highlights for line 0"
-        );
+        assert!(highlights2.has_line(0), "Should have highlights for line 0");
         // Line 1 may or may not have highlights depending on the query
         // (some elements might not be captured if they're on the same line as other captures)
     }
@@ -2421,16 +2565,19 @@ test:
         );
         eprintln!(
             "Highlights lines: {:?}",
-            highlights.lines.keys().collect::<Vec<_>>()
+            highlights
+                .iter_lines()
+                .map(|(line, _)| line)
+                .collect::<Vec<_>>()
         );
-        for (line, lh) in &highlights.lines {
-            eprintln!("Line {}: {:?}", line, lh.tokens);
+        for (line, tokens) in highlights.iter_lines() {
+            eprintln!("Line {}: {:?}", line, tokens);
         }
 
         // Should have highlights on line 1 (the fn main line)
-        assert!(!highlights.lines.is_empty(), "Should have some highlights");
+        assert!(!highlights.is_empty(), "Should have some highlights");
         assert!(
-            highlights.lines.contains_key(&1),
+            highlights.has_line(1),
             "Should have highlights on line 1 where 'fn main' is"
         );
     }
@@ -2458,9 +2605,9 @@ test:
         }
 
         eprintln!("\nHighlights:");
-        for (line_num, lh) in &highlights.lines {
-            eprintln!("Line {}: {} tokens", line_num, lh.tokens.len());
-            for tok in &lh.tokens {
+        for (line_num, tokens) in highlights.iter_lines() {
+            eprintln!("Line {}: {} tokens", line_num, tokens.len());
+            for tok in tokens {
                 eprintln!(
                     "  col {}..{}: highlight {}",
                     tok.start_col, tok.end_col, tok.highlight
@@ -2474,16 +2621,12 @@ test:
 
         let rope_line_1 = rope.line(1).to_string();
         eprintln!("\nRope line 1: {:?}", rope_line_1);
-        eprintln!(
-            "Highlights for line 1 exist: {}",
-            highlights.lines.contains_key(&1)
-        );
+        eprintln!("Highlights for line 1 exist: {}", highlights.has_line(1));
 
         // The highlight tokens for line 1 should match the text on rope line 1
-        if let Some(line_highlights) = highlights.lines.get(&1) {
+        if let Some(line_highlights) = highlights.get_line(1) {
             // "fn main() {}" - "fn" is keyword at columns 0..2
             let fn_token = line_highlights
-                .tokens
                 .iter()
                 .find(|t| t.start_col == 0 && t.end_col == 2);
             assert!(
@@ -2503,17 +2646,219 @@ test:
         // Initial parse
         let source1 = "let x = 1;";
         let h1 = state.parse_and_highlight(source1, LanguageId::JavaScript, doc_id, 1);
-        assert!(!h1.lines.is_empty());
+        assert!(!h1.is_empty());
 
         // Insert a character (simulates typing)
         let source2 = "let x = 12;";
         let h2 = state.parse_and_highlight(source2, LanguageId::JavaScript, doc_id, 2);
-        assert!(!h2.lines.is_empty());
+        assert!(!h2.is_empty());
 
         // Cache should be populated
         assert!(state.doc_cache.contains_key(&doc_id));
     }
 
+    #[test]
+    fn test_journaled_edits_match_fresh_parse() {
+        use crate::syntax::edits::TextEdit;
+
+        let mut state = ParserState::new();
+        let doc_id = DocumentId(103);
+
+        let mut rope = Rope::from_str("fn main() {\n    let x = 1;\n}\n");
+        state.parse_and_highlight_snapshot(&rope, None, LanguageId::Rust, doc_id, 1);
+
+        // Two edits: insert a line, then rename `x` on the original line
+        let edits = vec![
+            TextEdit::insert(12, "    let y = 2;\n"),
+            TextEdit::replace(35, 1, "value"),
+        ];
+        for edit in &edits {
+            edit.apply_to(&mut rope).unwrap();
+        }
+        assert_eq!(
+            rope.to_string(),
+            "fn main() {\n    let y = 2;\n    let value = 1;\n}\n"
+        );
+
+        let delta = EditDelta {
+            base_revision: 1,
+            edits,
+        };
+        let source = rope.to_string();
+        let incremental =
+            state.parse_and_highlight_snapshot(&rope, Some(&delta), LanguageId::Rust, doc_id, 2);
+        assert_eq!(state.doc_cache[&doc_id].revision, 2);
+        assert_eq!(state.doc_cache[&doc_id].snapshot.to_string(), source);
+
+        let fresh = ParserState::new().parse_and_highlight(&source, LanguageId::Rust, doc_id, 2);
+        for line in 0..4 {
+            assert_eq!(
+                incremental.get_line_tokens(line),
+                fresh.get_line_tokens(line),
+                "line {} differs from a fresh parse",
+                line
+            );
+        }
+    }
+
+    #[test]
+    fn test_rope_edit_matches_string_diff() {
+        let cases = [
+            ("let x = 1;", "let x = 12;"),
+            ("fn main() {}", "fn main() {\n    let x = 1;\n}"),
+            ("a\nb\nc\n", "a\nc\n"),
+            ("héllo wörld", "héllo, wörld"),
+            ("same", "same"),
+        ];
+        for (old, new) in cases {
+            assert_eq!(
+                compute_rope_edit(&Rope::from_str(old), &Rope::from_str(new)),
+                compute_incremental_edit(old, new),
+                "{:?} -> {:?}",
+                old,
+                new
+            );
+        }
+    }
+
+    #[test]
+    fn test_rope_lines_match_str_lines_across_chunks() {
+        // Lines long enough to straddle rope chunk boundaries
+        let mut source = String::new();
+        for i in 0..200 {
+            source.push_str(&format!("{}{}\r\n", "é".repeat(i * 7), i));
+        }
+        let rope = Rope::from_str(&source);
+
+        let mut line_start = 0;
+        while line_start <= source.len() {
+            let (expected, expected_next) = line_from(&source, line_start);
+            let (line, next) = rope_line_from(&rope, line_start);
+            assert_eq!(line, expected);
+            assert_eq!(next, expected_next);
+            line_start = next;
+        }
+    }
+
+    #[test]
+    fn test_mismatched_journal_falls_back_to_diff() {
+        use crate::syntax::edits::TextEdit;
+
+        let mut state = ParserState::new();
+        let doc_id = DocumentId(104);
+        state.parse_and_highlight("let a = 1;", LanguageId::JavaScript, doc_id, 1);
+
+        // Delta claims a base revision the worker never parsed
+        let delta = EditDelta {
+            base_revision: 7,
+            edits: vec![TextEdit::insert(0, "zzz")],
+        };
+        let rope = Rope::from_str("let ab = 1;");
+        let highlights = state.parse_and_highlight_snapshot(
+            &rope,
+            Some(&delta),
+            LanguageId::JavaScript,
+            doc_id,
+            2,
+        );
+        assert!(!highlights.is_empty());
+        assert_eq!(state.doc_cache[&doc_id].snapshot.to_string(), "let ab = 1;");
+    }
+
+    #[test]
+    fn test_viewport_pass_matches_full_pass_lines() {
+        let mut source = String::new();
+        for i in 0..40 {
+            source.push_str(&format!(
+                "/* block\n   comment */ fn f{}() {{ let s = \"x\"; }}\n",
+                i
+            ));
+        }
+        let rope = Rope::from_str(&source);
+        let doc_id = DocumentId(105);
+
+        let mut state = ParserState::new();
+        let partial =
+            state.parse_and_highlight_lines(&rope, None, LanguageId::Rust, doc_id, 1, 21..31);
+        assert_eq!(partial.covered_lines, Some(21..31));
+        assert!(partial
+            .iter_lines()
+            .all(|(line, _)| (21..31).contains(&line)));
+
+        let full = ParserState::new().parse_and_highlight(&source, LanguageId::Rust, doc_id, 1);
+        for line in 21..31 {
+            assert_eq!(
+                partial.get_line_tokens(line),
+                full.get_line_tokens(line),
+                "line {} differs from the full pass",
+                line
+            );
+        }
+
+        // The background pass fills in the rest from the cached tree
+        let rest = state.highlight_cached(doc_id, 1).unwrap();
+        assert!(rest.covered_lines.is_none());
+        assert_eq!(rest.line_count(), full.line_count());
+        assert!(state.highlight_cached(doc_id, 2).is_none());
+    }
+
+    #[test]
+    fn test_full_pass_skipped_when_edits_stay_in_viewport() {
+        use crate::syntax::edits::TextEdit;
+
+        let mut state = ParserState::new();
+        let doc_id = DocumentId(106);
+        let mut rope = Rope::from_str(&"let a = 1;\n".repeat(50));
+        state.parse_and_highlight_snapshot(&rope, None, LanguageId::JavaScript, doc_id, 1);
+
+        // Same-line edit on line 10
+        let edits = vec![TextEdit::replace(118, 1, "22")];
+        for edit in &edits {
+            edit.apply_to(&mut rope).unwrap();
+        }
+        let delta = EditDelta {
+            base_revision: 1,
+            edits,
+        };
+        state.parse_and_highlight_lines(
+            &rope,
+            Some(&delta),
+            LanguageId::JavaScript,
+            doc_id,
+            2,
+            0..20,
+        );
+        assert!(state.needs_full_pass(doc_id, &(20..40), true));
+        assert!(!state.needs_full_pass(doc_id, &(0..20), true));
+
+        // A line-count change invalidates everything below it
+        let edits = vec![TextEdit::insert(0, "\n")];
+        for edit in &edits {
+            edit.apply_to(&mut rope).unwrap();
+        }
+        let delta = EditDelta {
+            base_revision: 2,
+            edits,
+        };
+        state.parse_and_highlight_lines(
+            &rope,
+            Some(&delta),
+            LanguageId::JavaScript,
+            doc_id,
+            3,
+            0..20,
+        );
+        assert_eq!(
+            state.get_cached_snapshot(doc_id).map(Rope::to_string),
+            Some(rope.to_string())
+        );
+        assert!(state.needs_full_pass(doc_id, &(0..20), true));
+
+        // Without highlights on the UI side there is nothing to keep
+        state.highlight_cached(doc_id, 3).unwrap();
+        assert!(state.needs_full_pass(doc_id, &(0..20), false));
+    }
+
     #[test]
     fn test_incremental_parse_delete_char() {
         let mut state = ParserState::new();
@@ -2522,12 +2867,12 @@ test:
         // Initial parse
         let source1 = "let x = 123;";
         let h1 = state.parse_and_highlight(source1, LanguageId::JavaScript, doc_id, 1);
-        assert!(!h1.lines.is_empty());
+        assert!(!h1.is_empty());
 
         // Delete characters
         let source2 = "let x = 1;";
         let h2 = state.parse_and_highlight(source2, LanguageId::JavaScript, doc_id, 2);
-        assert!(!h2.lines.is_empty());
+        assert!(!h2.is_empty());
     }
 
     #[test]
@@ -2538,15 +2883,15 @@ test:
         // Initial parse
         let source1 = "fn main() {}";
         let h1 = state.parse_and_highlight(source1, LanguageId::Rust, doc_id, 1);
-        assert!(!h1.lines.is_empty());
+        assert!(!h1.is_empty());
 
         // Insert newline and content
         let source2 = "fn main() {\n    let x = 1;\n}";
         let h2 = state.parse_and_highlight(source2, LanguageId::Rust, doc_id, 2);
-        assert!(!h2.lines.is_empty());
+        assert!(!h2.is_empty());
         // Should have highlights on multiple lines now
         assert!(
-            h2.lines.len() >= 2,
+            h2.line_count() >= 2,
             "Should have highlights on multiple lines"
         );
     }
@@ -2559,11 +2904,11 @@ test:
         // Parse as Rust
         let source = "let x = 1;";
         let h1 = state.parse_and_highlight(source, LanguageId::Rust, doc_id, 1);
-        assert!(!h1.lines.is_empty());
+        assert!(!h1.is_empty());
 
         // Parse same source as JavaScript (language change should trigger full reparse)
         let h2 = state.parse_and_highlight(source, LanguageId::JavaScript, doc_id, 2);
-        assert!(!h2.lines.is_empty());
+        assert!(!h2.is_empty());
 
         // Cache should reflect JavaScript now
         assert_eq!(
@@ -2581,14 +2926,14 @@ test:
 
         // First parse
         let h1 = state.parse_and_highlight(source, LanguageId::JavaScript, doc_id, 1);
-        assert!(!h1.lines.is_empty());
+        assert!(!h1.is_empty());
 
         // Same source again (should reuse cached tree)
         let h2 = state.parse_and_highlight(source, LanguageId::JavaScript, doc_id, 2);
-        assert!(!h2.lines.is_empty());
+        assert!(!h2.is_empty());
 
         // Results should be identical
-        assert_eq!(h1.lines.len(), h2.lines.len());
+        assert_eq!(h1.line_count(), h2.line_count());
     }
 
     #[test]
@@ -2606,6 +2951,24 @@ test:
         assert!(!state.doc_cache.contains_key(&doc_id));
     }
 
+    #[test]
+    fn test_memory_by_document() {
+        let mut state = ParserState::new();
+        let small = DocumentId(106);
+        let large = DocumentId(107);
+        state.parse_and_highlight("let x = 1;", LanguageId::JavaScript, small, 1);
+        let source = "let x = 1;\n".repeat(200);
+        state.parse_and_highlight(&source, LanguageId::JavaScript, large, 1);
+
+        let report = state.memory_by_document();
+        assert_eq!(report.len(), 2);
+        assert_eq!(report[0].0, small);
+        assert!(report[1].1 > report[0].1 * 100);
+
+        state.clear_doc_cache(large);
+        assert_eq!(state.memory_by_document(), vec![report[0]]);
+    }
+
     #[test]
     fn test_compute_incremental_edit_insert() {
         // Insert "X" at position 5
@@ -2693,12 +3056,12 @@ test:
 
         assert_eq!(highlights.language, LanguageId::Markdown);
         // Should have highlights for inline content
-        let line0 = highlights.lines.get(&0);
+        let line0 = highlights.get_line(0);
         assert!(line0.is_some(), "Line 0 should have highlights");
 
         // Check that we have a text.emphasis highlight
         let line = line0.unwrap();
-        let has_emphasis = line.tokens.iter().any(|t| {
+        let has_emphasis = line.iter().any(|t| {
             let name = super::super::highlights::HIGHLIGHT_NAMES
                 .get(t.highlight as usize)
                 .unwrap_or(&"");
@@ -2707,7 +3070,7 @@ test:
         assert!(
             has_emphasis,
             "Should have text.emphasis highlight for *italic*, found: {:?}",
-            line.tokens
+            line
         );
     }
 
@@ -2719,11 +3082,11 @@ test:
         let highlights = state.parse_and_highlight(source, LanguageId::Markdown, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Markdown);
-        let line0 = highlights.lines.get(&0);
+        let line0 = highlights.get_line(0);
         assert!(line0.is_some(), "Line 0 should have highlights");
 
         let line = line0.unwrap();
-        let has_strong = line.tokens.iter().any(|t| {
+        let has_strong = line.iter().any(|t| {
             let name = super::super::highlights::HIGHLIGHT_NAMES
                 .get(t.highlight as usize)
                 .unwrap_or(&"");
@@ -2732,7 +3095,7 @@ test:
         assert!(
             has_strong,
             "Should have text.strong highlight for **bold**, found: {:?}",
-            line.tokens
+            line
         );
     }
 
@@ -2744,11 +3107,11 @@ test:
         let highlights = state.parse_and_highlight(source, LanguageId::Markdown, doc_id, 1);
 
         assert_eq!(highlights.language, LanguageId::Markdown);
-        let line0 = highlights.lines.get(&0);
+        let line0 = highlights.get_line(0);
         assert!(line0.is_some(), "Line 0 should have highlights");
 
         let line = line0.unwrap();
-        let has_code = line.tokens.iter().any(|t| {
+        let has_code = line.iter().any(|t| {
             let name = super::super::highlights::HIGHLIGHT_NAMES
                 .get(t.highlight as usize)
                 .unwrap_or(&"");
@@ -2757,7 +3120,7 @@ test:
         assert!(
             has_code,
             "Should have string highlight for `code`, found: {:?}",
-            line.tokens
+            line
         );
     }
 
@@ -2779,11 +3142,11 @@ fn main() {
 
         // Line 3 should have "fn" highlighted as keyword (rust code inside code block)
         // Note: Line 0 = "# Code Example", Line 1 = "", Line 2 = "```rust", Line 3 = "fn main..."
-        let line3 = highlights.lines.get(&3);
+        let line3 = highlights.get_line(3);
         assert!(line3.is_some(), "Line 3 (fn main) should have highlights");
 
         let line = line3.unwrap();
-        let has_keyword = line.tokens.iter().any(|t| {
+        let has_keyword = line.iter().any(|t| {
             let name = super::super::highlights::HIGHLIGHT_NAMES
                 .get(t.highlight as usize)
                 .unwrap_or(&"");
@@ -2792,7 +3155,7 @@ fn main() {
         assert!(
             has_keyword,
             "Should have keyword highlight for 'fn' in rust code block, found: {:?}",
-            line.tokens
+            line
         );
     }
 
@@ -2814,20 +3177,14 @@ def hello():
         let highlights = state.parse_and_highlight(source, LanguageId::Markdown, doc_id, 1);
 
         // Should have highlights for heading
-        assert!(
-            highlights.lines.contains_key(&0),
-            "Should highlight heading"
-        );
+        assert!(highlights.has_line(0), "Should highlight heading");
         // Should have highlights for paragraph with inline elements
         assert!(
-            highlights.lines.contains_key(&2),
+            highlights.has_line(2),
             "Should highlight paragraph with inline elements"
         );
         // Should have highlights for code block
-        assert!(
-            highlights.lines.contains_key(&7),
-            "Should highlight python code block"
-        );
+        assert!(highlights.has_line(7), "Should highlight python code block");
     }
 
     #[test]
@@ -2847,18 +3204,17 @@ fn main() {}
         // Verify specific highlights exist
         // Line 0: # Heading - should have punctuation.special and text.title
         let line0 = highlights
-            .lines
-            .get(&0)
+            .get_line(0)
             .expect("Line 0 should have highlights");
         assert!(
-            line0.tokens.iter().any(|t| {
+            line0.iter().any(|t| {
                 super::super::highlights::HIGHLIGHT_NAMES.get(t.highlight as usize)
                     == Some(&"punctuation.special")
             }),
             "Line 0 should have punctuation.special for #"
         );
         assert!(
-            line0.tokens.iter().any(|t| {
+            line0.iter().any(|t| {
                 super::super::highlights::HIGHLIGHT_NAMES.get(t.highlight as usize)
                     == Some(&"text.title")
             }),
@@ -2867,11 +3223,9 @@ fn main() {}
 
         // Line 2: inline elements
         let line2 = highlights
-            .lines
-            .get(&2)
+            .get_line(2)
             .expect("Line 2 should have highlights");
         let highlight_names: Vec<&str> = line2
-            .tokens
             .iter()
             .filter_map(|t| {
                 super::super::highlights::HIGHLIGHT_NAMES
@@ -2898,10 +3252,9 @@ fn main() {}
 
         // Line 5: rust code block content should have keyword (line 4 is ```rust)
         let line5 = highlights
-            .lines
-            .get(&5)
+            .get_line(5)
             .expect("Line 5 (fn main) should have highlights");
-        let has_keyword = line5.tokens.iter().any(|t| {
+        let has_keyword = line5.iter().any(|t| {
             let name = super::super::highlights::HIGHLIGHT_NAMES
                 .get(t.highlight as usize)
                 .unwrap_or(&"");
@@ -2911,7 +3264,6 @@ fn main() {}
             has_keyword,
             "Line 5 should have keyword for 'fn', got: {:?}",
             line5
-                .tokens
                 .iter()
                 .filter_map(|t| super::super::highlights::HIGHLIGHT_NAMES.get(t.highlight as usize))
                 .collect::<Vec<_>>()
@@ -2940,14 +3292,14 @@ function hello() {
         assert_eq!(highlights.language, LanguageId::Html);
 
         // Line 4 should have "function" as keyword.function
-        let line4 = highlights.lines.get(&4);
+        let line4 = highlights.get_line(4);
         assert!(
             line4.is_some(),
             "Line 4 (function hello) should have highlights"
         );
 
         let line = line4.unwrap();
-        let has_keyword = line.tokens.iter().any(|t| {
+        let has_keyword = line.iter().any(|t| {
             let name = super::super::highlights::HIGHLIGHT_NAMES
                 .get(t.highlight as usize)
                 .unwrap_or(&"");
@@ -2956,8 +3308,7 @@ function hello() {
         assert!(
             has_keyword,
             "Should have keyword highlight for 'function', got: {:?}",
-            line.tokens
-                .iter()
+            line.iter()
                 .filter_map(|t| super::super::highlights::HIGHLIGHT_NAMES.get(t.highlight as usize))
                 .collect::<Vec<_>>()
         );
@@ -2983,14 +3334,14 @@ function hello() {
         assert_eq!(highlights.language, LanguageId::Html);
 
         // Line 4 should have ".container" class highlighted as @type
-        let line4 = highlights.lines.get(&4);
+        let line4 = highlights.get_line(4);
         assert!(
             line4.is_some(),
             "Line 4 (.container) should have highlights"
         );
 
         let line = line4.unwrap();
-        let has_type = line.tokens.iter().any(|t| {
+        let has_type = line.iter().any(|t| {
             let name = super::super::highlights::HIGHLIGHT_NAMES
                 .get(t.highlight as usize)
                 .unwrap_or(&"");
@@ -2999,8 +3350,7 @@ function hello() {
         assert!(
             has_type,
             "Should have type highlight for class selector, got: {:?}",
-            line.tokens
-                .iter()
+            line.iter()
                 .filter_map(|t| super::super::highlights::HIGHLIGHT_NAMES.get(t.highlight as usize))
                 .collect::<Vec<_>>()
         );
@@ -3031,20 +3381,11 @@ export default {
 
         assert_eq!(highlights.language, LanguageId::Vue);
         // Should have HTML highlights in template
-        assert!(
-            highlights.lines.contains_key(&1),
-            "Should highlight template div"
-        );
+        assert!(highlights.has_line(1), "Should highlight template div");
         // Should have TypeScript highlights in script (lang="ts")
-        assert!(
-            highlights.lines.contains_key(&5),
-            "Should highlight export default"
-        );
+        assert!(highlights.has_line(5), "Should highlight export default");
         // Should have CSS highlights in style
-        assert!(
-            highlights.lines.contains_key(&15),
-            "Should highlight .container"
-        );
+        assert!(highlights.has_line(15), "Should highlight .container");
     }
 
     #[test]
@@ -3062,10 +3403,7 @@ export default {
 
         assert_eq!(highlights.language, LanguageId::Vue);
         // Should have JavaScript highlights in script (default, no lang attr)
-        assert!(
-            highlights.lines.contains_key(&1),
-            "Should highlight export default"
-        );
+        assert!(highlights.has_line(1), "Should highlight export default");
     }
 
     #[test]
@@ -3089,16 +3427,73 @@ export default {
         let highlights = state.parse_and_highlight(source, LanguageId::Html, doc_id, 1);
 
         // Should have highlights for HTML tags
-        assert!(highlights.lines.contains_key(&1), "Should highlight <html>");
+        assert!(highlights.has_line(1), "Should highlight <html>");
         // Should have highlights for CSS inside style
-        assert!(
-            highlights.lines.contains_key(&4),
-            "Should highlight CSS body selector"
-        );
+        assert!(highlights.has_line(4), "Should highlight CSS body selector");
         // Should have highlights for JavaScript inside script
-        assert!(
-            highlights.lines.contains_key(&7),
-            "Should highlight JS console.log"
-        );
+        assert!(highlights.has_line(7), "Should highlight JS console.log");
+    }
+
+    /// Parse serials of the cached injections of `doc_id`
+    fn injection_serials(state: &ParserState, doc_id: DocumentId) -> Vec<u64> {
+        state.injections[&doc_id]
+            .iter()
+            .map(|injection| injection.parse_serial)
+            .collect()
+    }
+
+    fn assert_same_highlights(a: &SyntaxHighlights, b: &SyntaxHighlights) {
+        assert_eq!(a.line_count(), b.line_count());
+        for ((line_a, tokens_a), (line_b, tokens_b)) in a.iter_lines().zip(b.iter_lines()) {
+            assert_eq!(line_a, line_b);
+            assert_eq!(tokens_a, tokens_b, "line {}", line_a);
+        }
+    }
+
+    #[test]
+    fn test_markdown_edit_reparses_only_the_edited_injection() {
+        let mut state = ParserState::new();
+        let doc_id = DocumentId(500);
+        let v1 = "# Notes\n\nSome prose.\n\n```rust\nfn a() {}\n```\n\n```python\ndef b():\n    pass\n```\n\n```rust\nfn c() {}\n```\n";
+        state.parse_and_highlight(v1, LanguageId::Markdown, doc_id, 1);
+        assert_eq!(injection_serials(&state, doc_id), vec![1, 2, 3]);
+
+        // Editing prose (adding a line above every block) re-parses nothing
+        let v2 = v1.replace("Some prose.", "Some more\nprose.");
+        let highlights = state.parse_and_highlight(&v2, LanguageId::Markdown, doc_id, 2);
+        assert_eq!(injection_serials(&state, doc_id), vec![1, 2, 3]);
+        let fresh = ParserState::new().parse_and_highlight(&v2, LanguageId::Markdown, doc_id, 2);
+        assert_same_highlights(&highlights, &fresh);
+
+        // Editing one block re-parses that block only
+        let v3 = v2.replace("fn c() {}", "fn c() { let x = 1; }");
+        let highlights = state.parse_and_highlight(&v3, LanguageId::Markdown, doc_id, 3);
+        assert_eq!(injection_serials(&state, doc_id), vec![1, 2, 4]);
+        let fresh = ParserState::new().parse_and_highlight(&v3, LanguageId::Markdown, doc_id, 3);
+        assert_same_highlights(&highlights, &fresh);
+
+        state.clear_doc_cache(doc_id);
+        assert!(!state.injections.contains_key(&doc_id));
+    }
+
+    #[test]
+    fn test_vue_template_edit_keeps_script_and_style_trees() {
+        let mut state = ParserState::new();
+        let doc_id = DocumentId(501);
+        let v1 = "<template>\n  <div>{{ a }}</div>\n</template>\n\n<script lang=\"ts\">\nconst a: number = 1;\n</script>\n\n<style>\n.a { color: red; }\n</style>\n";
+        state.parse_and_highlight(v1, LanguageId::Vue, doc_id, 1);
+        assert_eq!(injection_serials(&state, doc_id), vec![1, 2]);
+
+        let v2 = v1.replace("{{ a }}", "{{ a + 1 }}");
+        let highlights = state.parse_and_highlight(&v2, LanguageId::Vue, doc_id, 2);
+        assert_eq!(injection_serials(&state, doc_id), vec![1, 2]);
+        let fresh = ParserState::new().parse_and_highlight(&v2, LanguageId::Vue, doc_id, 2);
+        assert_same_highlights(&highlights, &fresh);
+
+        let v3 = v2.replace("color: red;", "color: red; margin: 0;");
+        let highlights = state.parse_and_highlight(&v3, LanguageId::Vue, doc_id, 3);
+        assert_eq!(injection_serials(&state, doc_id), vec![1, 3]);
+        let fresh = ParserState::new().parse_and_highlight(&v3, LanguageId::Vue, doc_id, 3);
+        assert_same_highlights(&highlights, &fresh);
     }
 }
@@ -70,6 +70,14 @@ impl TerminalState {
         self.sessions.iter_mut().find(|s| s.id == session_id)
     }
 
+    /// Approximate bytes held by all sessions' grids and scrollback.
+    pub fn memory_bytes(&self) -> usize {
+        self.sessions
+            .iter()
+            .map(TerminalSession::memory_bytes)
+            .sum()
+    }
+
     /// Whether any terminal spawn is currently in progress.
     pub fn has_pending_spawn(&self) -> bool {
         !self.pending_spawn_ids.is_empty()
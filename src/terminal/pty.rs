@@ -8,23 +8,101 @@ use std::io::{Read, Write};
 use std::path::Path;
 use std::sync::atomic::{AtomicBool, Ordering};
 use std::sync::mpsc::{self, Sender};
-use std::sync::{Arc, Mutex};
+use std::sync::{Arc, Condvar, Mutex};
 use std::thread;
-use std::time::Duration;
+use std::time::{Duration, Instant};
 
 use portable_pty::{native_pty_system, CommandBuilder, MasterPty, PtySize};
 
 use crate::messages::{Msg, TerminalMsg};
 
-/// How much PTY output to accumulate before forwarding it as a
-/// `Msg::Terminal(PtyOutput)`. Matches the plan's "coalesce into chunks"
-/// guidance to avoid flooding the message queue during large builds.
+/// Size of a single read from the PTY master.
 const READ_CHUNK_SIZE: usize = 32 * 1024;
 
-/// Maximum time to hold PTY output before forwarding it, so small, infrequent
-/// output (e.g. a shell prompt) still reaches the UI promptly.
+/// Minimum time between `Msg::Terminal(PtyOutput)` messages for one session.
+/// Output read within this window is coalesced into the next message, so a
+/// flood (`yes`, a large build) costs the UI thread at most one apply per
+/// frame instead of one per read, while a lone prompt or keystroke echo is
+/// still forwarded as soon as it is read.
 const READ_FLUSH_INTERVAL: Duration = Duration::from_millis(16);
 
+/// Output read from the PTY but not yet applied by the UI thread, beyond
+/// which the reader stops reading. The PTY's kernel buffer then fills and
+/// the child blocks on write, so a fast producer is throttled to the rate
+/// the terminal can be parsed and drawn instead of queueing unbounded
+/// memory in the message channel.
+const MAX_UNAPPLIED_OUTPUT: usize = 1024 * 1024;
+
+#[derive(Debug, Default)]
+struct FlowState {
+    /// Output read since the last message was sent
+    pending: Vec<u8>,
+    /// Bytes sent to the UI thread that it hasn't applied yet
+    in_flight: usize,
+    last_sent: Option<Instant>,
+    /// Set once the handle is killed or dropped; the reader stops waiting
+    closed: bool,
+}
+
+/// Coalescing and backpressure between a session's reader thread, its flush
+/// timer thread and the UI thread applying the output.
+#[derive(Debug, Default)]
+struct OutputFlow {
+    state: Mutex<FlowState>,
+    /// Signalled when output is applied or the flow is closed
+    drained: Condvar,
+}
+
+impl OutputFlow {
+    /// Block until the UI thread has caught up enough to read more. Returns
+    /// false once the flow is closed.
+    fn wait_for_room(&self) -> bool {
+        let mut state = self.state.lock().unwrap();
+        while !state.closed && state.in_flight + state.pending.len() >= MAX_UNAPPLIED_OUTPUT {
+            state = self.drained.wait(state).unwrap();
+        }
+        !state.closed
+    }
+
+    /// Append freshly read output, returning a chunk to send now if nothing
+    /// was sent within the last flush interval.
+    fn push(&self, bytes: &[u8]) -> Option<Vec<u8>> {
+        let mut state = self.state.lock().unwrap();
+        state.pending.extend_from_slice(bytes);
+        let due = state
+            .last_sent
+            .map_or(true, |sent| sent.elapsed() >= READ_FLUSH_INTERVAL);
+        due.then(|| Self::take(&mut state)).flatten()
+    }
+
+    /// Take everything pending, for the flush timer and the final flush.
+    fn take_pending(&self) -> Option<Vec<u8>> {
+        Self::take(&mut self.state.lock().unwrap())
+    }
+
+    fn take(state: &mut FlowState) -> Option<Vec<u8>> {
+        if state.pending.is_empty() {
+            return None;
+        }
+        let data = std::mem::take(&mut state.pending);
+        state.in_flight += data.len();
+        state.last_sent = Some(Instant::now());
+        Some(data)
+    }
+
+    /// The UI thread applied `len` bytes of sent output.
+    fn applied(&self, len: usize) {
+        let mut state = self.state.lock().unwrap();
+        state.in_flight = state.in_flight.saturating_sub(len);
+        self.drained.notify_all();
+    }
+
+    fn close(&self) {
+        self.state.lock().unwrap().closed = true;
+        self.drained.notify_all();
+    }
+}
+
 /// A spawned PTY: the shell process, its master (controlling) side, and a
 /// channel for sending bytes to the shell's stdin.
 pub struct PtyHandle {
@@ -34,6 +112,8 @@ pub struct PtyHandle {
     /// Cloneable handle for terminating the child process independently of
     /// the read thread (which may be blocked in `read()`).
     child_killer: Box<dyn portable_pty::ChildKiller + Send + Sync>,
+    /// Output shared with the read and flush threads.
+    flow: Arc<OutputFlow>,
 }
 
 impl PtyHandle {
@@ -59,8 +139,24 @@ impl PtyHandle {
     /// Kill the child shell process and release the PTY master. Safe to call
     /// multiple times; subsequent calls are no-ops once the killer has run.
     pub fn kill(&mut self) {
+        self.flow.close();
         let _ = self.child_killer.kill();
     }
+
+    /// Report that `len` bytes of a `PtyOutput` message have been applied,
+    /// letting the reader continue once it was held back by
+    /// `MAX_UNAPPLIED_OUTPUT`.
+    pub fn output_applied(&self, len: usize) {
+        self.flow.applied(len);
+    }
+}
+
+impl Drop for PtyHandle {
+    fn drop(&mut self) {
+        // A reader waiting for the UI to catch up must not outlive the
+        // session it was reading for.
+        self.flow.close();
+    }
 }
 
 #[cfg(any(test, debug_assertions))]
@@ -72,6 +168,7 @@ impl PtyHandle {
                 master: Box::new(TestMasterPty),
                 write_tx,
                 child_killer: Box::new(TestChildKiller),
+                flow: Arc::default(),
             },
             write_rx,
         )
@@ -203,29 +300,24 @@ pub fn spawn_pty(
             }
         })?;
 
-    // Shared accumulator for PTY output coalescing, protected so both the
-    // read thread and a flush timer thread can append/flush safely.
-    let accumulator = Arc::new(Mutex::new(Vec::with_capacity(READ_CHUNK_SIZE)));
-    let flush_done = Arc::new(AtomicBool::new(false));
+    let flow = Arc::new(OutputFlow::default());
+    let read_done = Arc::new(AtomicBool::new(false));
 
-    // Read thread: PTY output -> shared accumulator.
+    // Read thread: PTY output -> `flow`, sent straight on when the UI
+    // hasn't had output for a frame, otherwise left for the flush thread.
     {
-        let accumulator = Arc::clone(&accumulator);
-        let flush_done = Arc::clone(&flush_done);
+        let flow = Arc::clone(&flow);
+        let read_done = Arc::clone(&read_done);
         let msg_tx = msg_tx.clone();
         thread::Builder::new()
             .name(format!("pty-reader-{session_id}"))
             .spawn(move || {
                 let mut buf = [0u8; READ_CHUNK_SIZE];
-                loop {
+                while flow.wait_for_room() {
                     match reader.read(&mut buf) {
                         Ok(0) => break,
                         Ok(n) => {
-                            let mut acc = accumulator.lock().unwrap();
-                            acc.extend_from_slice(&buf[..n]);
-                            if acc.len() >= READ_CHUNK_SIZE {
-                                let data = std::mem::take(&mut *acc);
-                                acc.reserve(READ_CHUNK_SIZE);
+                            if let Some(data) = flow.push(&buf[..n]) {
                                 let _ = msg_tx.send(Msg::Terminal(TerminalMsg::PtyOutput {
                                     session_id,
                                     data,
@@ -236,34 +328,28 @@ pub fn spawn_pty(
                         Err(_) => break,
                     }
                 }
-                flush_done.store(true, Ordering::Relaxed);
+                read_done.store(true, Ordering::Relaxed);
             })?;
     }
 
-    // Flush timer thread: forwards accumulated output every 16 ms so small
-    // amounts of data (e.g. a shell prompt) don't sit in the buffer while
-    // the read thread is blocked waiting for more PTY output.
+    // Flush timer thread: forwards output coalesced by the reader every
+    // 16 ms, so a burst that arrived right after a send doesn't sit in the
+    // buffer while the read thread is blocked waiting for more PTY output.
     {
-        let accumulator = Arc::clone(&accumulator);
-        let flush_done = Arc::clone(&flush_done);
+        let flow = Arc::clone(&flow);
         thread::Builder::new()
             .name(format!("pty-flush-{session_id}"))
             .spawn(move || {
-                while !flush_done.load(Ordering::Relaxed) {
+                while !read_done.load(Ordering::Relaxed) {
                     thread::sleep(READ_FLUSH_INTERVAL);
-                    let mut acc = accumulator.lock().unwrap();
-                    if !acc.is_empty() {
-                        let data = std::mem::take(&mut *acc);
-                        acc.reserve(READ_CHUNK_SIZE);
+                    if let Some(data) = flow.take_pending() {
                         let _ =
                             msg_tx.send(Msg::Terminal(TerminalMsg::PtyOutput { session_id, data }));
                     }
                 }
 
                 // Final flush after the read thread has exited.
-                let mut acc = accumulator.lock().unwrap();
-                if !acc.is_empty() {
-                    let data = std::mem::take(&mut *acc);
+                if let Some(data) = flow.take_pending() {
                     let _ = msg_tx.send(Msg::Terminal(TerminalMsg::PtyOutput { session_id, data }));
                 }
 
@@ -282,6 +368,7 @@ pub fn spawn_pty(
         master: pair.master,
         write_tx,
         child_killer,
+        flow,
     })
 }
 
@@ -315,6 +402,36 @@ mod tests {
         false
     }
 
+    #[test]
+    fn output_is_coalesced_within_a_flush_interval() {
+        let flow = OutputFlow::default();
+        assert_eq!(flow.push(b"a"), Some(b"a".to_vec()));
+        assert_eq!(flow.push(b"b"), None);
+        assert_eq!(flow.push(b"c"), None);
+        assert_eq!(flow.take_pending(), Some(b"bc".to_vec()));
+        assert_eq!(flow.take_pending(), None);
+    }
+
+    #[test]
+    fn reader_waits_until_output_is_applied() {
+        let flow = Arc::new(OutputFlow::default());
+        let data = flow.push(&vec![0; MAX_UNAPPLIED_OUTPUT]).unwrap();
+        let waiter = {
+            let flow = Arc::clone(&flow);
+            thread::spawn(move || flow.wait_for_room())
+        };
+        thread::sleep(Duration::from_millis(20));
+        assert!(!waiter.is_finished());
+
+        flow.applied(data.len());
+        assert!(waiter.join().unwrap());
+
+        // Closing releases a reader the UI will never catch up with
+        flow.push(&vec![0; MAX_UNAPPLIED_OUTPUT]);
+        flow.close();
+        assert!(!flow.wait_for_room());
+    }
+
     #[test]
     fn spawns_shell_and_echoes_output() {
         let (msg_tx, msg_rx) = mpsc::channel();
@@ -7,6 +7,7 @@ use std::sync::mpsc::Sender;
 
 use alacritty_terminal::event::{Event, EventListener};
 use alacritty_terminal::grid::Dimensions;
+use alacritty_terminal::term::cell::Cell;
 use alacritty_terminal::term::{Config, Term};
 use alacritty_terminal::vte::ansi::Processor;
 
@@ -42,7 +43,7 @@ impl Dimensions for GridSize {
 /// Forwards `alacritty_terminal` events back into the Elm update loop as
 /// `Msg::Terminal` variants, matching the async-worker pattern already used
 /// for syntax highlighting and file-system watching (see
-/// `src/runtime/app.rs`'s `syntax_worker_loop`).
+/// `src/runtime/syntax_worker.rs`'s `syntax_worker_loop`).
 ///
 /// Must stay cheap and non-blocking: `send_event` is called synchronously
 /// from within VT sequence parsing.
@@ -163,6 +164,13 @@ impl TerminalSession {
             .saturating_sub(self.term.grid().screen_lines())
     }
 
+    /// Approximate bytes held by the grid: every line of history and the
+    /// screen, at the current width.
+    pub fn memory_bytes(&self) -> usize {
+        let grid = self.term.grid();
+        grid.total_lines() * grid.columns() * std::mem::size_of::<Cell>()
+    }
+
     /// Keep the view offset inside the available history.
     pub fn clamp_scroll_offset(&mut self) {
         self.scroll_offset = self.scroll_offset.min(self.max_scrollback_offset());
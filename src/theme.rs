@@ -11,6 +11,8 @@ use std::path::Path;
 
 use serde::Deserialize;
 
+use crate::syntax::{HighlightId, HIGHLIGHT_NAMES};
+
 // Embed theme YAML files at compile time
 pub const DEFAULT_DARK_YAML: &str = include_str!("../themes/dark.yaml");
 pub const FLEET_DARK_YAML: &str = include_str!("../themes/fleet-dark.yaml");
@@ -507,6 +509,8 @@ pub struct Theme {
     pub button: ButtonTheme,
     pub image_preview: ImagePreviewTheme,
     pub syntax: SyntaxTheme,
+    /// `syntax` compiled for drawing
+    pub highlight_colors: HighlightColors,
     pub scrollbar: ScrollbarTheme,
 }
 
@@ -923,6 +927,39 @@ impl SyntaxTheme {
     }
 }
 
+/// Syntax colors compiled into a table indexed by [`HighlightId`], so the
+/// renderer resolves a token's color with an array load instead of a
+/// highlight-name match
+///
+/// Compiled once when a [`Theme`] is resolved; switching themes swaps the
+/// table and never touches highlight data.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub struct HighlightColors {
+    colors: [u32; HIGHLIGHT_NAMES.len()],
+    /// Color for ids outside the table
+    fallback: u32,
+}
+
+impl HighlightColors {
+    pub fn compile(syntax: &SyntaxTheme) -> Self {
+        Self {
+            colors: std::array::from_fn(|id| {
+                syntax.color_for_highlight(id as HighlightId).to_argb_u32()
+            }),
+            fallback: syntax.text.to_argb_u32(),
+        }
+    }
+
+    /// ARGB color of a highlight id
+    #[inline]
+    pub fn get(&self, highlight: HighlightId) -> u32 {
+        self.colors
+            .get(highlight as usize)
+            .copied()
+            .unwrap_or(self.fallback)
+    }
+}
+
 impl Theme {
     /// Load theme from YAML string
     pub fn from_yaml(yaml: &str) -> Result<Self, String> {
@@ -994,6 +1031,187 @@ impl Theme {
         // Build CSV theme using editor/gutter as fallbacks
         let csv = CsvTheme::from_data(Some(&data.ui.csv), &gutter, &editor);
 
+        let syntax = {
+            let defaults = SyntaxTheme::default_dark();
+            SyntaxTheme {
+                keyword: data
+                    .ui
+                    .syntax
+                    .keyword
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.keyword),
+                function: data
+                    .ui
+                    .syntax
+                    .function
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.function),
+                function_builtin: data
+                    .ui
+                    .syntax
+                    .function_builtin
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.function_builtin),
+                string: data
+                    .ui
+                    .syntax
+                    .string
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.string),
+                number: data
+                    .ui
+                    .syntax
+                    .number
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.number),
+                comment: data
+                    .ui
+                    .syntax
+                    .comment
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.comment),
+                type_name: data
+                    .ui
+                    .syntax
+                    .type_name
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.type_name),
+                variable: data
+                    .ui
+                    .syntax
+                    .variable
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.variable),
+                variable_builtin: data
+                    .ui
+                    .syntax
+                    .variable_builtin
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.variable_builtin),
+                property: data
+                    .ui
+                    .syntax
+                    .property
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.property),
+                operator: data
+                    .ui
+                    .syntax
+                    .operator
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.operator),
+                punctuation: data
+                    .ui
+                    .syntax
+                    .punctuation
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.punctuation),
+                constant: data
+                    .ui
+                    .syntax
+                    .constant
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.constant),
+                tag: data
+                    .ui
+                    .syntax
+                    .tag
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.tag),
+                attribute: data
+                    .ui
+                    .syntax
+                    .attribute
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.attribute),
+                escape: data
+                    .ui
+                    .syntax
+                    .escape
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.escape),
+                label: data
+                    .ui
+                    .syntax
+                    .label
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.label),
+                text: data
+                    .ui
+                    .syntax
+                    .text
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.text),
+                text_emphasis: data
+                    .ui
+                    .syntax
+                    .text_emphasis
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.text_emphasis),
+                text_strong: data
+                    .ui
+                    .syntax
+                    .text_strong
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.text_strong),
+                text_title: data
+                    .ui
+                    .syntax
+                    .text_title
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.text_title),
+                text_uri: data
+                    .ui
+                    .syntax
+                    .text_uri
+                    .as_ref()
+                    .map(|s| Color::from_hex(s))
+                    .transpose()?
+                    .unwrap_or(defaults.text_uri),
+            }
+        };
         Ok(Theme {
             name: data.name,
             editor,
@@ -1296,187 +1514,8 @@ impl Theme {
                         .clamp(2, 64),
                 }
             },
-            syntax: {
-                let defaults = SyntaxTheme::default_dark();
-                SyntaxTheme {
-                    keyword: data
-                        .ui
-                        .syntax
-                        .keyword
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.keyword),
-                    function: data
-                        .ui
-                        .syntax
-                        .function
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.function),
-                    function_builtin: data
-                        .ui
-                        .syntax
-                        .function_builtin
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.function_builtin),
-                    string: data
-                        .ui
-                        .syntax
-                        .string
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.string),
-                    number: data
-                        .ui
-                        .syntax
-                        .number
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.number),
-                    comment: data
-                        .ui
-                        .syntax
-                        .comment
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.comment),
-                    type_name: data
-                        .ui
-                        .syntax
-                        .type_name
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.type_name),
-                    variable: data
-                        .ui
-                        .syntax
-                        .variable
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.variable),
-                    variable_builtin: data
-                        .ui
-                        .syntax
-                        .variable_builtin
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.variable_builtin),
-                    property: data
-                        .ui
-                        .syntax
-                        .property
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.property),
-                    operator: data
-                        .ui
-                        .syntax
-                        .operator
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.operator),
-                    punctuation: data
-                        .ui
-                        .syntax
-                        .punctuation
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.punctuation),
-                    constant: data
-                        .ui
-                        .syntax
-                        .constant
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.constant),
-                    tag: data
-                        .ui
-                        .syntax
-                        .tag
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.tag),
-                    attribute: data
-                        .ui
-                        .syntax
-                        .attribute
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.attribute),
-                    escape: data
-                        .ui
-                        .syntax
-                        .escape
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.escape),
-                    label: data
-                        .ui
-                        .syntax
-                        .label
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.label),
-                    text: data
-                        .ui
-                        .syntax
-                        .text
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.text),
-                    text_emphasis: data
-                        .ui
-                        .syntax
-                        .text_emphasis
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.text_emphasis),
-                    text_strong: data
-                        .ui
-                        .syntax
-                        .text_strong
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.text_strong),
-                    text_title: data
-                        .ui
-                        .syntax
-                        .text_title
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.text_title),
-                    text_uri: data
-                        .ui
-                        .syntax
-                        .text_uri
-                        .as_ref()
-                        .map(|s| Color::from_hex(s))
-                        .transpose()?
-                        .unwrap_or(defaults.text_uri),
-                }
-            },
+            highlight_colors: HighlightColors::compile(&syntax),
+            syntax,
             scrollbar: ScrollbarTheme::from_data(Some(&data.ui.scrollbar)),
         })
     }
@@ -1515,6 +1554,7 @@ impl Theme {
                     csv: CsvTheme::default_dark(),
                     button: ButtonTheme::default_dark(),
                     image_preview: ImagePreviewTheme::default_dark(),
+                    highlight_colors: HighlightColors::compile(&SyntaxTheme::default_dark()),
                     syntax: SyntaxTheme::default_dark(),
                     scrollbar: ScrollbarTheme::default_dark(),
                 }
@@ -5,6 +5,7 @@ use std::path::PathBuf;
 use crate::commands::{Cmd, CommandId};
 use crate::config::EditorConfig;
 use crate::config_paths;
+use crate::image::ImageData;
 use crate::keymap::get_default_keymap_yaml;
 use crate::messages::{AppMsg, DockMsg, DocumentMsg, LayoutMsg, TerminalMsg, UiMsg};
 use crate::model::{AppModel, ModalId, SplitDirection};
@@ -49,6 +50,11 @@ pub fn update_app(model: &mut AppModel, msg: AppMsg) -> Option<Cmd> {
         }
 
         AppMsg::SaveFile => {
+            if model.document().is_loading() {
+                // Saving a partially loaded buffer would truncate the file
+                model.ui.set_status("Cannot save while the file is loading");
+                return Some(Cmd::redraw_status_bar());
+            }
             let file_path = model.document().file_path.clone();
             match file_path {
                 Some(path) => {
@@ -120,6 +126,8 @@ pub fn update_app(model: &mut AppModel, msg: AppMsg) -> Option<Cmd> {
                     doc.saved_revision = Some(0);
                     doc.language = language;
                     doc.syntax_highlights = None;
+                    doc.large_file = false;
+                    doc.stop_loading();
                     doc.revision = doc.revision.wrapping_add(1);
 
                     // Cmd::OpenFileInEditor (e.g. OpenKeybindings/OpenLogFile)
@@ -167,6 +175,94 @@ pub fn update_app(model: &mut AppModel, msg: AppMsg) -> Option<Cmd> {
             }
         }
 
+        AppMsg::LargeFileChunk {
+            document_id,
+            buffer,
+            bytes_read,
+            finished,
+        } => {
+            // The tab may have been closed while the file was loading
+            let doc = model.editor_area.documents.get_mut(&document_id)?;
+            let progress = doc.loading.as_mut()?;
+            progress.bytes_read = bytes_read;
+            let percent = progress.percent();
+
+            // Edits are blocked while loading, so the new rope only ever
+            // extends what is already shown and cursors stay valid
+            doc.buffer = buffer;
+            doc.revision = doc.revision.wrapping_add(1);
+            let name = doc.display_name();
+
+            if finished {
+                doc.loading = None;
+                let lines = doc.line_count();
+                model.ui.set_status(format!(
+                    "Loaded: {} ({} lines, syntax highlighting off for large files)",
+                    name, lines
+                ));
+            } else {
+                model
+                    .ui
+                    .set_status(format!("Loading {}... {}%", name, percent));
+            }
+            Some(Cmd::Batch(vec![
+                Cmd::redraw_editor(),
+                Cmd::redraw_status_bar(),
+            ]))
+        }
+
+        AppMsg::LargeFileFailed { document_id, error } => {
+            let doc = model.editor_area.documents.get(&document_id)?;
+            // The document stays read-only: `loading` is left set so the
+            // partial buffer can never be saved over the file
+            let name = doc.display_name();
+            model
+                .ui
+                .set_status(format!("Error loading {}: {}", name, error));
+            Some(Cmd::redraw_status_bar())
+        }
+
+        AppMsg::ImageDecoded {
+            document_id,
+            result,
+        } => {
+            // The tab may have been closed while the image was decoding
+            let name = model
+                .editor_area
+                .documents
+                .get(&document_id)?
+                .display_name();
+            let mut updated = false;
+            for editor_id in model.editor_area.editors_for_document(document_id) {
+                let Some(state) = model
+                    .editor_area
+                    .editors
+                    .get_mut(&editor_id)
+                    .and_then(|editor| editor.view_mode.as_image_mut())
+                else {
+                    continue;
+                };
+                match &result {
+                    Ok(chain) => state.set_decoded(chain.clone()),
+                    Err(error) => state.data = ImageData::Failed(error.clone()),
+                }
+                updated = true;
+            }
+            if !updated {
+                return None;
+            }
+
+            if let Err(error) = &result {
+                model
+                    .ui
+                    .set_status(format!("Error decoding image {}: {}", name, error));
+            }
+            Some(Cmd::Batch(vec![
+                Cmd::redraw_editor(),
+                Cmd::redraw_status_bar(),
+            ]))
+        }
+
         AppMsg::Quit => Some(Cmd::Quit),
 
         AppMsg::ReloadConfiguration => {
@@ -201,6 +297,10 @@ pub fn update_app(model: &mut AppModel, msg: AppMsg) -> Option<Cmd> {
         // File Dialog Messages
         // =====================================================================
         AppMsg::SaveFileAs => {
+            if model.document().is_loading() {
+                model.ui.set_status("Cannot save while the file is loading");
+                return Some(Cmd::redraw_status_bar());
+            }
             let suggested = model.document().file_path.clone();
             Some(Cmd::ShowSaveFileDialog {
                 suggested_path: suggested,
@@ -265,12 +365,17 @@ pub fn update_app(model: &mut AppModel, msg: AppMsg) -> Option<Cmd> {
         }
 
         AppMsg::OpenFolderDialogResult { folder } => {
-            if let Some(root) = folder {
-                model.open_workspace(root);
-            } else {
+            let Some(root) = folder else {
                 model.ui.set_status("Open folder cancelled");
+                return Some(Cmd::redraw_status_bar());
+            };
+            match model.open_workspace(root) {
+                Some(request) => Some(Cmd::batch(vec![
+                    Cmd::redraw_status_bar(),
+                    Cmd::ScanWorkspace { request },
+                ])),
+                None => Some(Cmd::redraw_status_bar()),
             }
-            Some(Cmd::redraw_status_bar())
         }
 
         AppMsg::PasteFromClipboard(text) => {
@@ -336,6 +441,7 @@ pub fn execute_command(model: &mut AppModel, cmd_id: CommandId) -> Option<Cmd> {
         CommandId::PrevTab => update_layout(model, LayoutMsg::PrevTab),
         CommandId::CloseTab => update_layout(model, LayoutMsg::CloseFocusedTab),
         CommandId::Find => update_ui(model, UiMsg::ToggleModal(ModalId::FindReplace)),
+        CommandId::FindInFiles => update_ui(model, UiMsg::ToggleModal(ModalId::FindInFiles)),
         CommandId::ShowCommandPalette => {
             update_ui(model, UiMsg::ToggleModal(ModalId::CommandPalette))
         }
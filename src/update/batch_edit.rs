@@ -0,0 +1,204 @@
+//! Batched multi-cursor edits
+//!
+//! Applying a multi-cursor edit one cursor at a time means re-shifting every
+//! sibling cursor after each rope change, which is quadratic in the cursor
+//! count (hundreds of cursors after "select all occurrences"). Instead, each
+//! handler describes one [`CursorEdit`] per cursor against the buffer as it
+//! is, and [`apply_cursor_edits`] applies them together: sorted once, written
+//! to the rope in a single reverse pass, cursors placed with a running
+//! offset delta, and recorded as one `EditOperation::Batch`.
+
+use crate::model::{AppModel, Cursor, EditOperation, Position, Selection};
+
+/// Replace the chars `start..end` of the buffer with `text`, leaving cursor
+/// `cursor` at the end of the inserted text
+///
+/// Offsets are into the buffer before any edit of the batch is applied.
+#[derive(Debug, Clone)]
+pub(crate) struct CursorEdit {
+    pub cursor: usize,
+    pub start: usize,
+    pub end: usize,
+    pub text: String,
+}
+
+impl CursorEdit {
+    pub fn new(cursor: usize, start: usize, end: usize, text: impl Into<String>) -> Self {
+        Self {
+            cursor,
+            start,
+            end,
+            text: text.into(),
+        }
+    }
+
+    fn is_noop(&self) -> bool {
+        self.start == self.end && self.text.is_empty()
+    }
+}
+
+/// A change as written to the rope, in application order
+struct AppliedEdit {
+    cursor: usize,
+    position: usize,
+    deleted: String,
+    inserted: String,
+}
+
+/// Apply one edit per cursor of the focused editor as a single undoable step
+///
+/// Every cursor should get an edit (an empty one for cursors that don't
+/// change the text); each cursor ends up collapsed at the end of its
+/// inserted text. Ranges overlapping an earlier edit are clipped to start
+/// where it ends, so overlapping selections or word deletes never touch the
+/// same text twice.
+///
+/// Highlights of lines after edits that add or remove lines are shifted so
+/// they stay aligned until the reparse. Returns whether the buffer changed.
+pub(crate) fn apply_cursor_edits(model: &mut AppModel, mut edits: Vec<CursorEdit>) -> bool {
+    edits.sort_by_key(|edit| (edit.start, edit.end));
+    let mut prev_end = 0;
+    for edit in &mut edits {
+        edit.start = edit.start.max(prev_end);
+        edit.end = edit.end.max(edit.start);
+        prev_end = edit.end;
+    }
+
+    let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
+    let mut applied = Vec::new();
+    // (edit_line, old_line_count, new_line_count) deltas, bottom-up
+    let mut line_shifts = Vec::new();
+
+    let doc = model.document_mut();
+    for edit in edits.iter().rev().filter(|edit| !edit.is_noop()) {
+        let deleted = if edit.start < edit.end {
+            let deleted = doc.buffer.slice(edit.start..edit.end).to_string();
+            doc.buffer.remove(edit.start..edit.end);
+            deleted
+        } else {
+            String::new()
+        };
+
+        let removed_lines = deleted.matches('\n').count();
+        let added_lines = edit.text.matches('\n').count();
+        if removed_lines != added_lines {
+            line_shifts.push((
+                doc.buffer.char_to_line(edit.start),
+                removed_lines,
+                added_lines,
+            ));
+        }
+
+        doc.buffer.insert(edit.start, &edit.text);
+        applied.push(AppliedEdit {
+            cursor: edit.cursor,
+            position: edit.start,
+            deleted,
+            inserted: edit.text.clone(),
+        });
+    }
+
+    if let Some(ref mut highlights) = doc.syntax_highlights {
+        for (edit_line, old_lines, new_lines) in line_shifts {
+            highlights.shift_for_edit(edit_line, old_lines, new_lines);
+        }
+    }
+
+    // Earlier edits move later ones by the net number of chars they inserted
+    let mut delta: isize = 0;
+    for edit in &edits {
+        let inserted = edit.text.chars().count();
+        let offset = (edit.start as isize + delta) as usize + inserted;
+        delta += inserted as isize - (edit.end - edit.start) as isize;
+
+        let (line, column) = model.document().offset_to_cursor(offset);
+        let editor = model.editor_mut();
+        editor.cursors[edit.cursor] = Cursor::at(line, column);
+        editor.selections[edit.cursor] = Selection::new(Position::new(line, column));
+    }
+
+    if applied.is_empty() {
+        return false;
+    }
+
+    let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
+    let operations = applied
+        .into_iter()
+        .map(|edit| {
+            let cursor_before = cursors_before[edit.cursor];
+            let cursor_after = cursors_after[edit.cursor];
+            match (edit.deleted.is_empty(), edit.inserted.is_empty()) {
+                (true, _) => EditOperation::Insert {
+                    position: edit.position,
+                    text: edit.inserted,
+                    cursor_before,
+                    cursor_after,
+                },
+                (false, true) => EditOperation::Delete {
+                    position: edit.position,
+                    text: edit.deleted,
+                    cursor_before,
+                    cursor_after,
+                },
+                (false, false) => EditOperation::Replace {
+                    position: edit.position,
+                    deleted_text: edit.deleted,
+                    inserted_text: edit.inserted,
+                    cursor_before,
+                    cursor_after,
+                },
+            }
+        })
+        .collect();
+
+    model.document_mut().push_edit(EditOperation::Batch {
+        operations,
+        cursors_before,
+        cursors_after,
+    });
+    true
+}
+
+/// Char range selected by cursor `idx`, or its position when nothing is
+/// selected
+pub(crate) fn selection_range(model: &AppModel, idx: usize) -> (usize, usize) {
+    let doc = model.document();
+    let selection = model.editor().selections[idx];
+    if selection.is_empty() {
+        let cursor = model.editor().cursors[idx];
+        let offset = doc.cursor_to_offset(cursor.line, cursor.column);
+        return (offset, offset);
+    }
+    let start = selection.start();
+    let end = selection.end();
+    (
+        doc.cursor_to_offset(start.line, start.column),
+        doc.cursor_to_offset(end.line, end.column),
+    )
+}
+
+/// Merge overlapping selections before replacing them, so a span selected
+/// by several cursors (e.g. overlapping matches from SelectAllOccurrences,
+/// which only deduplicates cursors) is replaced once; returns whether any
+/// cursor has a selection
+pub(crate) fn merge_selected_ranges(model: &mut AppModel) -> bool {
+    let any_has_selection = model.editor().selections.iter().any(|s| !s.is_empty());
+    if any_has_selection {
+        model.editor_mut().merge_overlapping_selections();
+    }
+    any_has_selection
+}
+
+/// Edits replacing each cursor's selection, or inserting at the cursor when
+/// nothing is selected, with `text_for(cursor)`
+pub(crate) fn replace_selection_edits<'a>(
+    model: &AppModel,
+    text_for: impl Fn(usize) -> &'a str,
+) -> Vec<CursorEdit> {
+    (0..model.editor().cursors.len())
+        .map(|idx| {
+            let (start, end) = selection_range(model, idx);
+            CursorEdit::new(idx, start, end, text_for(idx))
+        })
+        .collect()
+}
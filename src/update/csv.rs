@@ -92,7 +92,7 @@ fn toggle_csv_mode(model: &mut AppModel) -> Option<Cmd> {
         .map(Delimiter::from_extension)
         .unwrap_or_else(|| detect_delimiter(&content));
 
-    match parse_csv(&content, delimiter) {
+    match parse_csv(content, delimiter) {
         Ok(data) => {
             if data.is_empty() || data.column_count() == 0 {
                 tracing::warn!("CSV parsing produced empty data");
@@ -799,6 +799,7 @@ pub(crate) fn edit_paste_text(model: &mut AppModel, text: String) -> Option<Cmd>
 // === Document Sync ===
 
 use crate::model::Document;
+use crate::syntax::TextEdit;
 
 /// Sync a cell edit back to the document text buffer
 fn sync_cell_edit_to_document(doc: &mut Document, edit: &CellEdit, delimiter: Delimiter) {
@@ -843,7 +844,7 @@ fn sync_cell_edit_to_document(doc: &mut Document, edit: &CellEdit, delimiter: De
     doc.buffer.insert(abs_start, &escaped);
 
     doc.is_modified = true;
-    doc.revision = doc.revision.wrapping_add(1);
+    doc.record_buffer_edits([TextEdit::replace(abs_start, abs_end - abs_start, &escaped)]);
 }
 
 /// Find byte range of a row in the document (excluding newline)
@@ -5,6 +5,9 @@ use crate::messages::DocumentMsg;
 use crate::model::{AppModel, Cursor, EditOperation, Position, Selection};
 use crate::util::char_type;
 
+use super::batch_edit::{
+    apply_cursor_edits, merge_selected_ranges, replace_selection_edits, selection_range, CursorEdit,
+};
 use super::editor::{
     cursors_in_reverse_order, delete_selection, lines_covered_by_all_cursors,
     shift_sibling_cursors, sync_other_editor_cursors, sync_other_editor_cursors_for_deleted_text,
@@ -132,98 +135,30 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
         DocumentMsg::InsertChar(ch) => {
             let cursor_before = *model.editor().primary_cursor();
 
-            // Multi-cursor: process all cursors in reverse document order
+            // Multi-cursor: surround applies if any cursor has a selection;
+            // cursors without one just get the char
             if model.editor().has_multiple_cursors() {
                 let close = surround_pair(ch);
-                let any_has_selection = model.editor().selections.iter().any(|s| !s.is_empty());
+                let any_has_selection = merge_selected_ranges(model);
                 let do_surround =
                     model.config.auto_surround && close.is_some() && any_has_selection;
 
-                // Overlapping selections (e.g. from SelectAllOccurrences, which only
-                // deduplicates cursors but does not merge overlapping ranges) would
-                // corrupt the buffer when processed in reverse order below, since each
-                // selection's offset is recomputed against an already-mutated buffer.
-                // Merging first guarantees non-overlapping ranges, making reverse-order
-                // processing safe.
-                if do_surround {
-                    model.editor_mut().merge_overlapping_selections();
-                }
-
-                let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
-                let indices = cursors_in_reverse_order(model);
-                let mut operations = Vec::new();
-
-                for idx in indices {
-                    let cursor = model.editor().cursors[idx];
-                    let selection = model.editor().selections[idx];
-
-                    if do_surround && !selection.is_empty() {
-                        let Some(close) = close else { continue };
-                        let sel_start = selection.start();
-                        let sel_end = selection.end();
-                        let start_offset = model
-                            .document()
-                            .cursor_to_offset(sel_start.line, sel_start.column);
-                        let end_offset = model
-                            .document()
-                            .cursor_to_offset(sel_end.line, sel_end.column);
-                        let selected_text: String = model
-                            .document()
-                            .buffer
-                            .slice(start_offset..end_offset)
-                            .chars()
-                            .collect();
-
-                        model.document_mut().buffer.remove(start_offset..end_offset);
-                        let wrapped = format!("{ch}{selected_text}{close}");
-                        model.document_mut().buffer.insert(start_offset, &wrapped);
-
-                        let new_offset = start_offset + wrapped.len();
-                        let (new_line, new_col) = model.document().offset_to_cursor(new_offset);
-
-                        operations.push(EditOperation::Replace {
-                            position: start_offset,
-                            deleted_text: selected_text,
-                            inserted_text: wrapped,
-                            cursor_before: cursor,
-                            cursor_after: Cursor::at(new_line, new_col),
-                        });
-
-                        model.editor_mut().cursors[idx] = Cursor::at(new_line, new_col);
-                        model.editor_mut().cursors[idx].desired_column = None;
-                        let new_pos = Position::new(new_line, new_col);
-                        model.editor_mut().selections[idx] = Selection::new(new_pos);
-                    } else {
-                        let pos = model
-                            .document()
-                            .cursor_to_offset(cursor.line, cursor.column);
-
-                        model.document_mut().buffer.insert_char(pos, ch);
-
-                        operations.push(EditOperation::Insert {
-                            position: pos,
-                            text: ch.to_string(),
-                            cursor_before: cursor,
-                            cursor_after: Cursor::at(cursor.line, cursor.column + 1),
-                        });
-
-                        model.editor_mut().cursors[idx].column += 1;
-                        model.editor_mut().cursors[idx].desired_column = None;
-
-                        let new_pos = model.editor().cursors[idx].to_position();
-                        model.editor_mut().selections[idx] = Selection::new(new_pos);
-                    }
-                }
-
-                // Record batch for proper multi-cursor undo
-                let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
-                model.document_mut().push_edit(EditOperation::Batch {
-                    operations,
-                    cursors_before,
-                    cursors_after,
-                });
+                let edits = (0..model.editor().cursors.len())
+                    .map(|idx| {
+                        let (start, end) = selection_range(model, idx);
+                        let text = match close {
+                            Some(close) if do_surround && start < end => {
+                                let selected: String =
+                                    model.document().buffer.slice(start..end).chars().collect();
+                                format!("{ch}{selected}{close}")
+                            }
+                            _ => ch.to_string(),
+                        };
+                        CursorEdit::new(idx, start, end, text)
+                    })
+                    .collect();
+                apply_cursor_edits(model, edits);
 
-                model.document_mut().is_modified = true;
                 model.ensure_cursor_visible();
                 model.reset_cursor_blink();
                 return Some(redraw_with_syntax_parse(model));
@@ -319,58 +254,14 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             let edit_line = cursor_before.line;
             let old_line_count = model.document().line_count();
 
-            // Multi-cursor: process all cursors in reverse document order
             if model.editor().has_multiple_cursors() {
-                let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
-                let indices = cursors_in_reverse_order(model);
-                let mut operations = Vec::new();
-
-                for idx in indices {
-                    let cursor = model.editor().cursors[idx];
-                    let insert_line = cursor.line;
-                    let pos = model
-                        .document()
-                        .cursor_to_offset(cursor.line, cursor.column);
-                    model.document_mut().buffer.insert_char(pos, '\n');
-
-                    // Record individual operation
-                    operations.push(EditOperation::Insert {
-                        position: pos,
-                        text: "\n".to_string(),
-                        cursor_before: cursor,
-                        cursor_after: Cursor::at(cursor.line + 1, 0),
-                    });
-
-                    // Move cursor to beginning of next line
-                    model.editor_mut().cursors[idx].line += 1;
-                    model.editor_mut().cursors[idx].column = 0;
-                    model.editor_mut().cursors[idx].desired_column = None;
-
-                    let new_pos = model.editor().cursors[idx].to_position();
-                    model.editor_mut().selections[idx] = Selection::new(new_pos);
-
-                    // Adjust all OTHER cursors that are AFTER this insertion point
-                    // (they need to shift down by 1 line)
-                    shift_sibling_cursors(model.editor_mut(), idx, insert_line, 1, None);
-                }
-
-                // Record batch for proper multi-cursor undo
-                // Operations stored in application order; undo iterates .rev()
-                let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
-                model.document_mut().push_edit(EditOperation::Batch {
-                    operations,
-                    cursors_before,
-                    cursors_after,
-                });
+                merge_selected_ranges(model);
+                let edits = replace_selection_edits(model, |_| "\n");
+                apply_cursor_edits(model, edits);
 
-                model.document_mut().is_modified = true;
                 model.ensure_cursor_visible();
                 model.reset_cursor_blink();
-                let new_line_count = model.document().line_count();
-                return Some(redraw_with_syntax_parse_shift(
-                    model,
-                    Some((edit_line, old_line_count, new_line_count)),
-                ));
+                return Some(redraw_with_syntax_parse(model));
             }
 
             // Single cursor: check for selection first
@@ -418,95 +309,19 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             let cursor_before = *model.editor().primary_cursor();
             let old_line_count = model.document().line_count();
 
-            // Multi-cursor: process all cursors in reverse document order
             if model.editor().has_multiple_cursors() {
-                let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
-                let indices = cursors_in_reverse_order(model);
-                let mut operations = Vec::new();
-
-                for idx in indices {
-                    let selection = model.editor().selections[idx];
-                    if !selection.is_empty() {
-                        // Delete selection
-                        let start = selection.start();
-                        let end = selection.end();
-                        let start_offset =
-                            model.document().cursor_to_offset(start.line, start.column);
-                        let end_offset = model.document().cursor_to_offset(end.line, end.column);
-                        let deleted_text: String = model
-                            .document()
-                            .buffer
-                            .slice(start_offset..end_offset)
-                            .to_string();
-                        model.document_mut().buffer.remove(start_offset..end_offset);
-
-                        // Record operation
-                        operations.push(EditOperation::Delete {
-                            position: start_offset,
-                            text: deleted_text,
-                            cursor_before: model.editor().cursors[idx],
-                            cursor_after: Cursor::at(start.line, start.column),
-                        });
-
-                        model.editor_mut().cursors[idx].line = start.line;
-                        model.editor_mut().cursors[idx].column = start.column;
-                        model.editor_mut().selections[idx] = Selection::new(start);
-                    } else {
-                        let cursor = model.editor().cursors[idx];
-                        let pos = model
-                            .document()
-                            .cursor_to_offset(cursor.line, cursor.column);
-                        if pos > 0 {
-                            let deleted_char: String = model
-                                .document()
-                                .buffer
-                                .slice(pos - 1..pos)
-                                .chars()
-                                .collect();
-                            let is_newline = deleted_char == "\n";
-                            let deleted_from_line = cursor.line;
-
-                            model.document_mut().buffer.remove(pos - 1..pos);
-                            let (new_line, new_col) = model.document().offset_to_cursor(pos - 1);
-
-                            // Record operation
-                            operations.push(EditOperation::Delete {
-                                position: pos - 1,
-                                text: deleted_char,
-                                cursor_before: cursor,
-                                cursor_after: Cursor::at(new_line, new_col),
-                            });
-
-                            model.editor_mut().cursors[idx].line = new_line;
-                            model.editor_mut().cursors[idx].column = new_col;
-                            let new_pos = model.editor().cursors[idx].to_position();
-                            model.editor_mut().selections[idx] = Selection::new(new_pos);
-
-                            // If we deleted a newline, adjust all other cursors below this point
-                            // new_col is the column where the merge point is (end of previous line)
-                            if is_newline {
-                                shift_sibling_cursors(
-                                    model.editor_mut(),
-                                    idx,
-                                    deleted_from_line,
-                                    -1,
-                                    Some(new_col),
-                                );
-                            }
+                let edits = (0..model.editor().cursors.len())
+                    .map(|idx| {
+                        let (start, end) = selection_range(model, idx);
+                        if start < end {
+                            return CursorEdit::new(idx, start, end, "");
                         }
-                    }
-                }
-
-                // Record batch for proper multi-cursor undo
-                // Operations stored in application order; undo iterates .rev()
-                let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
-                model.document_mut().push_edit(EditOperation::Batch {
-                    operations,
-                    cursors_before,
-                    cursors_after,
-                });
+                        // No selection: delete the char before the cursor
+                        CursorEdit::new(idx, start.saturating_sub(1), start, "")
+                    })
+                    .collect();
+                apply_cursor_edits(model, edits);
 
-                model.document_mut().is_modified = true;
                 model.ensure_cursor_visible();
                 model.reset_cursor_blink();
                 return Some(redraw_with_syntax_parse(model));
@@ -583,96 +398,23 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             let cursor_before = *model.editor().primary_cursor();
             let old_line_count = model.document().line_count();
 
-            // Multi-cursor: process all cursors in reverse document order
             if model.editor().has_multiple_cursors() {
-                let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
-                let indices = cursors_in_reverse_order(model);
-                let mut operations = Vec::new();
-
-                for idx in indices {
-                    let selection = model.editor().selections[idx];
-                    if !selection.is_empty() {
-                        // Delete selection (same as DeleteBackward)
-                        let start = selection.start();
-                        let end = selection.end();
-                        let start_offset =
-                            model.document().cursor_to_offset(start.line, start.column);
-                        let end_offset = model.document().cursor_to_offset(end.line, end.column);
-
-                        if start_offset < end_offset {
-                            let deleted_text: String = model
-                                .document()
-                                .buffer
-                                .slice(start_offset..end_offset)
-                                .to_string();
-                            model.document_mut().buffer.remove(start_offset..end_offset);
-
-                            operations.push(EditOperation::Delete {
-                                position: start_offset,
-                                text: deleted_text,
-                                cursor_before: model.editor().cursors[idx],
-                                cursor_after: Cursor::at(start.line, start.column),
-                            });
-
-                            model.editor_mut().cursors[idx].line = start.line;
-                            model.editor_mut().cursors[idx].column = start.column;
-                            model.editor_mut().selections[idx] = Selection::new(start);
+                let edits = (0..model.editor().cursors.len())
+                    .map(|idx| {
+                        let (start, end) = selection_range(model, idx);
+                        if start < end {
+                            return CursorEdit::new(idx, start, end, "");
                         }
-                    } else {
                         // No selection: delete word to the left
-                        let cursor = model.editor().cursors[idx];
-                        let end_offset = model
-                            .document()
-                            .cursor_to_offset(cursor.line, cursor.column);
-
-                        if end_offset == 0 {
-                            continue;
-                        }
-
-                        let start_offset = word_start_before(&model.document().buffer, end_offset);
-                        if start_offset >= end_offset {
-                            continue;
-                        }
-
-                        let deleted_text: String = model
-                            .document()
-                            .buffer
-                            .slice(start_offset..end_offset)
-                            .to_string();
-                        model.document_mut().buffer.remove(start_offset..end_offset);
-
-                        let (new_line, new_col) = model.document().offset_to_cursor(start_offset);
-
-                        operations.push(EditOperation::Delete {
-                            position: start_offset,
-                            text: deleted_text,
-                            cursor_before: cursor,
-                            cursor_after: Cursor::at(new_line, new_col),
-                        });
-
-                        model.editor_mut().cursors[idx].line = new_line;
-                        model.editor_mut().cursors[idx].column = new_col;
-                        let new_pos = model.editor().cursors[idx].to_position();
-                        model.editor_mut().selections[idx] = Selection::new(new_pos);
-                    }
-                }
-
-                let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
-                model.document_mut().push_edit(EditOperation::Batch {
-                    operations,
-                    cursors_before,
-                    cursors_after,
-                });
+                        let word_start = word_start_before(&model.document().buffer, start);
+                        CursorEdit::new(idx, word_start, start, "")
+                    })
+                    .collect();
+                apply_cursor_edits(model, edits);
 
-                model.document_mut().is_modified = true;
                 model.ensure_cursor_visible();
                 model.reset_cursor_blink();
-                let new_line_count = model.document().line_count();
-                let edit_line = cursor_before.line.min(new_line_count.saturating_sub(1));
-                return Some(redraw_with_syntax_parse_shift(
-                    model,
-                    Some((edit_line, old_line_count, new_line_count)),
-                ));
+                return Some(redraw_with_syntax_parse(model));
             }
 
             // Single cursor: check for selection
@@ -735,94 +477,23 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             let cursor_before = *model.editor().primary_cursor();
             let old_line_count = model.document().line_count();
 
-            // Multi-cursor: process all cursors in reverse document order
             if model.editor().has_multiple_cursors() {
-                let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
-                let indices = cursors_in_reverse_order(model);
-                let mut operations = Vec::new();
-
-                for idx in indices {
-                    let selection = model.editor().selections[idx];
-                    if !selection.is_empty() {
-                        // Delete selection (same as DeleteForward)
-                        let start = selection.start();
-                        let end = selection.end();
-                        let start_offset =
-                            model.document().cursor_to_offset(start.line, start.column);
-                        let end_offset = model.document().cursor_to_offset(end.line, end.column);
-
-                        if start_offset < end_offset {
-                            let deleted_text: String = model
-                                .document()
-                                .buffer
-                                .slice(start_offset..end_offset)
-                                .to_string();
-                            model.document_mut().buffer.remove(start_offset..end_offset);
-
-                            operations.push(EditOperation::Delete {
-                                position: start_offset,
-                                text: deleted_text,
-                                cursor_before: model.editor().cursors[idx],
-                                cursor_after: Cursor::at(start.line, start.column),
-                            });
-
-                            model.editor_mut().cursors[idx].line = start.line;
-                            model.editor_mut().cursors[idx].column = start.column;
-                            model.editor_mut().selections[idx] = Selection::new(start);
+                let edits = (0..model.editor().cursors.len())
+                    .map(|idx| {
+                        let (start, end) = selection_range(model, idx);
+                        if start < end {
+                            return CursorEdit::new(idx, start, end, "");
                         }
-                    } else {
                         // No selection: delete word to the right
-                        let cursor = model.editor().cursors[idx];
-                        let start_offset = model
-                            .document()
-                            .cursor_to_offset(cursor.line, cursor.column);
-
-                        let buffer_len = model.document().buffer.len_chars();
-                        if start_offset >= buffer_len {
-                            continue;
-                        }
-
-                        let end_offset = word_end_after(&model.document().buffer, start_offset);
-                        if end_offset <= start_offset {
-                            continue;
-                        }
-
-                        let deleted_text: String = model
-                            .document()
-                            .buffer
-                            .slice(start_offset..end_offset)
-                            .to_string();
-                        model.document_mut().buffer.remove(start_offset..end_offset);
-
-                        operations.push(EditOperation::Delete {
-                            position: start_offset,
-                            text: deleted_text,
-                            cursor_before: cursor,
-                            cursor_after: cursor, // Cursor stays in place
-                        });
-
-                        // Cursor position doesn't change for forward delete
-                        let new_pos = model.editor().cursors[idx].to_position();
-                        model.editor_mut().selections[idx] = Selection::new(new_pos);
-                    }
-                }
-
-                let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
-                model.document_mut().push_edit(EditOperation::Batch {
-                    operations,
-                    cursors_before,
-                    cursors_after,
-                });
+                        let word_end = word_end_after(&model.document().buffer, start);
+                        CursorEdit::new(idx, start, word_end, "")
+                    })
+                    .collect();
+                apply_cursor_edits(model, edits);
 
-                model.document_mut().is_modified = true;
                 model.ensure_cursor_visible();
                 model.reset_cursor_blink();
-                let new_line_count = model.document().line_count();
-                let edit_line = cursor_before.line.min(new_line_count.saturating_sub(1));
-                return Some(redraw_with_syntax_parse_shift(
-                    model,
-                    Some((edit_line, old_line_count, new_line_count)),
-                ));
+                return Some(redraw_with_syntax_parse(model));
             }
 
             // Single cursor: check for selection
@@ -886,97 +557,43 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             let cursor_before = *model.editor().primary_cursor();
             let old_line_count = model.document().line_count();
 
-            // Multi-cursor: process all cursors in reverse document order
             if model.editor().has_multiple_cursors() {
-                let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
-                let indices = cursors_in_reverse_order(model);
-                let mut operations = Vec::new();
-
-                for idx in indices {
-                    let selection = model.editor().selections[idx];
-                    if !selection.is_empty() {
-                        let start = selection.start();
-                        let end = selection.end();
-                        let start_offset =
-                            model.document().cursor_to_offset(start.line, start.column);
-                        let end_offset = model.document().cursor_to_offset(end.line, end.column);
-                        let deleted_text: String = model
-                            .document()
-                            .buffer
-                            .slice(start_offset..end_offset)
-                            .to_string();
-                        model.document_mut().buffer.remove(start_offset..end_offset);
-
-                        // Record operation
-                        operations.push(EditOperation::Delete {
-                            position: start_offset,
-                            text: deleted_text.clone(),
-                            cursor_before: model.editor().cursors[idx],
-                            cursor_after: Cursor::at(start.line, start.column),
-                        });
-
-                        model.editor_mut().cursors[idx].line = start.line;
-                        model.editor_mut().cursors[idx].column = start.column;
-                        model.editor_mut().selections[idx] = Selection::new(start);
-
-                        // Sync cursors in other views
-                        sync_other_editor_cursors_for_deleted_text(
-                            model,
-                            start.line,
-                            start.column,
-                            &deleted_text,
-                        );
-                    } else {
-                        let cursor = model.editor().cursors[idx];
-                        let pos = model
-                            .document()
-                            .cursor_to_offset(cursor.line, cursor.column);
-                        if pos < model.document().buffer.len_chars() {
-                            let deleted_char: String = model
-                                .document()
-                                .buffer
-                                .slice(pos..pos + 1)
-                                .chars()
-                                .collect();
-                            let is_newline = deleted_char == "\n";
-                            model.document_mut().buffer.remove(pos..pos + 1);
+                let len_chars = model.document().buffer.len_chars();
+                let edits: Vec<CursorEdit> = (0..model.editor().cursors.len())
+                    .map(|idx| {
+                        let (start, end) = selection_range(model, idx);
+                        if start < end {
+                            CursorEdit::new(idx, start, end, "")
+                        } else {
+                            CursorEdit::new(idx, start, (start + 1).min(len_chars), "")
+                        }
+                    })
+                    .collect();
 
-                            // Record operation (cursor doesn't move for delete forward)
-                            operations.push(EditOperation::Delete {
-                                position: pos,
-                                text: deleted_char,
-                                cursor_before: cursor,
-                                cursor_after: cursor,
-                            });
+                // Peer views get the same deletes, last first so the positions
+                // of earlier ones stay valid
+                let mut deletes: Vec<(usize, usize)> = edits
+                    .iter()
+                    .filter(|edit| edit.start < edit.end)
+                    .map(|edit| (edit.start, edit.end))
+                    .collect();
+                deletes.sort_unstable_by(|a, b| b.cmp(a));
+                let peer_syncs: Vec<(usize, usize, String)> = deletes
+                    .into_iter()
+                    .map(|(start, end)| {
+                        let (line, column) = model.document().offset_to_cursor(start);
+                        let text = model.document().buffer.slice(start..end).to_string();
+                        (line, column, text)
+                    })
+                    .collect();
 
-                            // Sync cursors in other views
-                            sync_other_editor_cursors_for_single_char_delete(
-                                model,
-                                cursor.line,
-                                cursor.column,
-                                is_newline,
-                            );
-                        }
-                    }
+                apply_cursor_edits(model, edits);
+                for (line, column, text) in peer_syncs {
+                    sync_other_editor_cursors_for_deleted_text(model, line, column, &text);
                 }
 
-                // Record batch for proper multi-cursor undo
-                // Operations stored in application order; undo iterates .rev()
-                let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
-                model.document_mut().push_edit(EditOperation::Batch {
-                    operations,
-                    cursors_before,
-                    cursors_after,
-                });
-
-                model.document_mut().is_modified = true;
                 model.reset_cursor_blink();
-                let new_line_count = model.document().line_count();
-                let edit_line = cursor_before.line.min(new_line_count.saturating_sub(1));
-                return Some(redraw_with_syntax_parse_shift(
-                    model,
-                    Some((edit_line, old_line_count, new_line_count)),
-                ));
+                return Some(redraw_with_syntax_parse(model));
             }
 
             // Single cursor: check for selection
@@ -1296,6 +913,7 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             if let Some(edit) = model.document_mut().undo_stack.pop() {
                 apply_undo_operation(model, &edit);
                 let doc = model.document_mut();
+                doc.record_buffer_edits(edit.undo_text_edits());
                 doc.redo_stack.push(edit);
                 doc.is_modified = doc.saved_revision != Some(doc.undo_stack.len());
                 model.editor_mut().collapse_selections_to_cursors();
@@ -1309,6 +927,7 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             if let Some(edit) = model.document_mut().redo_stack.pop() {
                 apply_redo_operation(model, &edit);
                 let doc = model.document_mut();
+                doc.record_buffer_edits(edit.text_edits());
                 doc.undo_stack.push(edit);
                 doc.is_modified = doc.saved_revision != Some(doc.undo_stack.len());
                 model.editor_mut().collapse_selections_to_cursors();
@@ -1507,150 +1126,88 @@ fn update_document_inner(model: &mut AppModel, msg: DocumentMsg) -> Option<Cmd>
             let old_line_count = model.document().line_count();
 
             if model.editor().has_multiple_cursors() {
-                let cursors_before: Vec<Cursor> = model.editor().cursors.clone();
-                let mut operations = Vec::new();
+                merge_selected_ranges(model);
 
+                // If clipboard has same number of lines as cursors, distribute one
+                // per cursor in document order; otherwise paste it all at each
                 let lines: Vec<&str> = text.lines().collect();
                 let cursor_count = model.editor().cursors.len();
-
-                // If clipboard has same number of lines as cursors, distribute one per cursor
-                if lines.len() == cursor_count {
-                    let indices = cursors_in_reverse_order(model);
-                    for (i, idx) in indices.iter().enumerate() {
-                        let line_to_paste = lines[cursor_count - 1 - i]; // Reverse order
-                        let cursor = model.editor().cursors[*idx];
-                        let pos = model
-                            .document()
-                            .cursor_to_offset(cursor.line, cursor.column);
-                        model.document_mut().buffer.insert(pos, line_to_paste);
-
-                        let char_count = line_to_paste.chars().count();
-                        model.editor_mut().cursors[*idx].column += char_count;
-                        let new_pos = model.editor().cursors[*idx].to_position();
-                        model.editor_mut().selections[*idx] = Selection::new(new_pos);
-
-                        operations.push(EditOperation::Insert {
-                            position: pos,
-                            text: line_to_paste.to_string(),
-                            cursor_before: cursor,
-                            cursor_after: Cursor::at(
-                                model.editor().cursors[*idx].line,
-                                model.editor().cursors[*idx].column,
-                            ),
-                        });
+                let edits = if lines.len() == cursor_count {
+                    let mut line_for_cursor = vec![""; cursor_count];
+                    for (i, idx) in cursors_in_reverse_order(model).into_iter().enumerate() {
+                        line_for_cursor[idx] = lines[cursor_count - 1 - i];
                     }
+                    replace_selection_edits(model, |idx| line_for_cursor[idx])
                 } else {
-                    // Paste full text at each cursor
-                    let indices = cursors_in_reverse_order(model);
-                    let lines_added = text.chars().filter(|&c| c == '\n').count();
-
-                    for idx in indices {
-                        let cursor = model.editor().cursors[idx];
-                        let insert_line = cursor.line;
-                        let pos = model
-                            .document()
-                            .cursor_to_offset(cursor.line, cursor.column);
-                        model.document_mut().buffer.insert(pos, &text);
-
-                        // Update cursor position (move to end of pasted text)
-                        let new_offset = pos + text.chars().count();
-                        let (new_line, new_col) = model.document().offset_to_cursor(new_offset);
-                        model.editor_mut().cursors[idx].line = new_line;
-                        model.editor_mut().cursors[idx].column = new_col;
-                        let new_pos = model.editor().cursors[idx].to_position();
-                        model.editor_mut().selections[idx] = Selection::new(new_pos);
-
-                        operations.push(EditOperation::Insert {
-                            position: pos,
-                            text: text.clone(),
-                            cursor_before: cursor,
-                            cursor_after: Cursor::at(new_line, new_col),
-                        });
+                    replace_selection_edits(model, |_| text.as_str())
+                };
+                apply_cursor_edits(model, edits);
 
-                        // Adjust other cursors for lines added
-                        if lines_added > 0 {
-                            shift_sibling_cursors(
-                                model.editor_mut(),
-                                idx,
-                                insert_line,
-                                lines_added as isize,
-                                None,
-                            );
-                        }
-                    }
-                }
+                model.ui.set_status(format!("Pasted {} chars", text.len()));
+                model.ensure_cursor_visible();
+                model.reset_cursor_blink();
+                return Some(redraw_with_syntax_parse(model));
+            }
 
-                // Record batch for proper multi-cursor undo
-                if !operations.is_empty() {
-                    let cursors_after: Vec<Cursor> = model.editor().cursors.clone();
-                    model.document_mut().push_edit(EditOperation::Batch {
-                        operations,
-                        cursors_before,
-                        cursors_after,
-                    });
-                }
-            } else {
-                // Single cursor: use Replace if selection exists for atomic undo
-                if !model.editor().primary_selection().is_empty() {
-                    let Some((pos, deleted_text)) = delete_selection(model) else {
-                        let cursor_pos = model.cursor_buffer_position();
-                        let (edit_line, edit_column) =
-                            model.document().offset_to_cursor(cursor_pos);
-                        model.document_mut().buffer.insert(cursor_pos, &text);
-                        let new_offset = cursor_pos + text.chars().count();
-                        model.set_cursor_from_position(new_offset);
-                        model.document_mut().is_modified = true;
-                        model.ui.set_status(format!("Pasted {} chars", text.len()));
-                        model.ensure_cursor_visible();
-                        model.reset_cursor_blink();
-                        sync_other_editor_cursors_for_text(model, edit_line, edit_column, &text);
-                        return Some(redraw_with_syntax_parse_shift(
-                            model,
-                            Some((
-                                paste_edit_line,
-                                old_line_count,
-                                model.document().line_count(),
-                            )),
-                        ));
-                    };
+            // Single cursor: use Replace if selection exists for atomic undo
+            if !model.editor().primary_selection().is_empty() {
+                let Some((pos, deleted_text)) = delete_selection(model) else {
+                    let cursor_pos = model.cursor_buffer_position();
+                    let (edit_line, edit_column) = model.document().offset_to_cursor(cursor_pos);
+                    model.document_mut().buffer.insert(cursor_pos, &text);
+                    let new_offset = cursor_pos + text.chars().count();
+                    model.set_cursor_from_position(new_offset);
+                    model.document_mut().is_modified = true;
+                    model.ui.set_status(format!("Pasted {} chars", text.len()));
+                    model.ensure_cursor_visible();
+                    model.reset_cursor_blink();
+                    sync_other_editor_cursors_for_text(model, edit_line, edit_column, &text);
+                    return Some(redraw_with_syntax_parse_shift(
+                        model,
+                        Some((
+                            paste_edit_line,
+                            old_line_count,
+                            model.document().line_count(),
+                        )),
+                    ));
+                };
 
-                    let (edit_line, edit_column) = model.document().offset_to_cursor(pos);
-                    model.document_mut().buffer.insert(pos, &text);
+                let (edit_line, edit_column) = model.document().offset_to_cursor(pos);
+                model.document_mut().buffer.insert(pos, &text);
 
-                    // Move cursor to end of pasted text
-                    let new_offset = pos + text.chars().count();
-                    model.set_cursor_from_position(new_offset);
+                // Move cursor to end of pasted text
+                let new_offset = pos + text.chars().count();
+                model.set_cursor_from_position(new_offset);
 
-                    let cursor_after = *model.editor().primary_cursor();
-                    model.document_mut().push_edit(EditOperation::Replace {
-                        position: pos,
-                        deleted_text,
-                        inserted_text: text.clone(),
-                        cursor_before,
-                        cursor_after,
-                    });
+                let cursor_after = *model.editor().primary_cursor();
+                model.document_mut().push_edit(EditOperation::Replace {
+                    position: pos,
+                    deleted_text,
+                    inserted_text: text.clone(),
+                    cursor_before,
+                    cursor_after,
+                });
 
-                    sync_other_editor_cursors_for_text(model, edit_line, edit_column, &text);
-                } else {
-                    let pos = model.cursor_buffer_position();
-                    let (edit_line, edit_column) = model.document().offset_to_cursor(pos);
+                sync_other_editor_cursors_for_text(model, edit_line, edit_column, &text);
+            } else {
+                let pos = model.cursor_buffer_position();
+                let (edit_line, edit_column) = model.document().offset_to_cursor(pos);
 
-                    model.document_mut().buffer.insert(pos, &text);
+                model.document_mut().buffer.insert(pos, &text);
 
-                    // Move cursor to end of pasted text
-                    let new_offset = pos + text.chars().count();
-                    model.set_cursor_from_position(new_offset);
+                // Move cursor to end of pasted text
+                let new_offset = pos + text.chars().count();
+                model.set_cursor_from_position(new_offset);
 
-                    let cursor_after = *model.editor().primary_cursor();
-                    model.document_mut().push_edit(EditOperation::Insert {
-                        position: pos,
-                        text: text.clone(),
-                        cursor_before,
-                        cursor_after,
-                    });
+                let cursor_after = *model.editor().primary_cursor();
+                model.document_mut().push_edit(EditOperation::Insert {
+                    position: pos,
+                    text: text.clone(),
+                    cursor_before,
+                    cursor_after,
+                });
 
-                    sync_other_editor_cursors_for_text(model, edit_line, edit_column, &text);
-                }
+                sync_other_editor_cursors_for_text(model, edit_line, edit_column, &text);
             }
 
             model.document_mut().is_modified = true;
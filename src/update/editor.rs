@@ -578,8 +578,9 @@ fn update_editor_inner(model: &mut AppModel, msg: EditorMsg) -> Option<Cmd> {
                 iterations += 1;
 
                 let Some((start_off, end_off)) = model
-                    .document()
-                    .find_next_occurrence(&search_text, search_offset)
+                    .document_mut()
+                    .match_index(&search_text, true)
+                    .and_then(|index| index.next_after(search_offset))
                 else {
                     // No occurrences at all
                     break;
@@ -713,7 +714,11 @@ fn update_editor_inner(model: &mut AppModel, msg: EditorMsg) -> Option<Cmd> {
             }
 
             // Find all occurrences
-            let occurrences = model.document().find_all_occurrences(&search_text);
+            let occurrences = model
+                .document_mut()
+                .match_index(&search_text, true)
+                .map(|index| index.to_vec())
+                .unwrap_or_default();
 
             if occurrences.is_empty() {
                 return Some(Cmd::redraw_editor());
@@ -805,15 +810,10 @@ fn update_editor_inner(model: &mut AppModel, msg: EditorMsg) -> Option<Cmd> {
                     .preview_cursors
                     .clear();
                 for preview_line in top_line..=bottom_line {
-                    let line_text = model.document().get_line(preview_line).unwrap_or_default();
-                    let line_text_trimmed = line_text.trim_end_matches('\n');
                     // Convert visual column to char column, clamped to line length
-                    let char_col = crate::util::text::visual_col_to_char_col(
-                        line_text_trimmed,
-                        current_visual_col,
-                    );
-                    let line_len = model.document().line_length(preview_line);
-                    let clamped_col = char_col.min(line_len);
+                    let clamped_col = model
+                        .document()
+                        .char_col_at_visual(preview_line, current_visual_col);
                     model
                         .editor_mut()
                         .rectangle_selection
@@ -841,22 +841,12 @@ fn update_editor_inner(model: &mut AppModel, msg: EditorMsg) -> Option<Cmd> {
 
             // Create a cursor (and optionally selection) for each line in the rectangle
             for line in top_line..=bottom_line {
-                let line_text = model.document().get_line(line).unwrap_or_default();
-                let line_text_trimmed = line_text.trim_end_matches('\n');
-                let line_len = model.document().line_length(line);
+                let document = model.document();
 
                 // Convert visual columns to char columns for this line
-                let start_char_col =
-                    crate::util::text::visual_col_to_char_col(line_text_trimmed, left_visual_col)
-                        .min(line_len);
-                let end_char_col =
-                    crate::util::text::visual_col_to_char_col(line_text_trimmed, right_visual_col)
-                        .min(line_len);
-                let cursor_char_col = crate::util::text::visual_col_to_char_col(
-                    line_text_trimmed,
-                    current_visual_col,
-                )
-                .min(line_len);
+                let start_char_col = document.char_col_at_visual(line, left_visual_col);
+                let end_char_col = document.char_col_at_visual(line, right_visual_col);
+                let cursor_char_col = document.char_col_at_visual(line, current_visual_col);
 
                 // Create cursor at the dragged-to position (clamped to line length)
                 let cursor = Cursor::at(line, cursor_char_col);
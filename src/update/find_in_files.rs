@@ -0,0 +1,181 @@
+//! Find-in-files update handlers
+
+use std::path::PathBuf;
+
+use crate::commands::Cmd;
+use crate::messages::{FindInFilesMsg, LayoutMsg};
+use crate::model::{AppModel, ModalState, Position, Selection};
+use crate::panel::PanelId;
+use crate::view::geometry::{DockHeaderLayout, SearchPanelLayout, WindowLayout};
+
+use super::layout::update_layout;
+
+/// Handle find-in-files messages
+pub fn update_find_in_files(model: &mut AppModel, msg: FindInFilesMsg) -> Option<Cmd> {
+    match msg {
+        FindInFilesMsg::Results { search_id, files } => model
+            .find_in_files
+            .apply_batch(search_id, files)
+            .then_some(Cmd::Redraw),
+
+        FindInFilesMsg::Finished { search_id, summary } => {
+            if !model.find_in_files.finish(search_id, summary) {
+                return None;
+            }
+            tracing::debug!(
+                "Find in files: {} matches in {} of {} files searched",
+                model.find_in_files.match_count,
+                model.find_in_files.results.len(),
+                summary.files_searched
+            );
+            Some(Cmd::Redraw)
+        }
+
+        FindInFilesMsg::SelectPrevious => {
+            let state = &mut model.find_in_files;
+            state.selected_index = Some(state.selected_index.map_or(0, |i| i.saturating_sub(1)));
+            Some(Cmd::Redraw)
+        }
+
+        FindInFilesMsg::SelectNext => {
+            let state = &mut model.find_in_files;
+            let last = state.row_count().saturating_sub(1);
+            state.selected_index = Some(state.selected_index.map_or(0, |i| (i + 1).min(last)));
+            Some(Cmd::Redraw)
+        }
+
+        FindInFilesMsg::OpenSelected => match model.find_in_files.selected_index {
+            Some(index) => open_result(model, index),
+            None => Some(Cmd::Redraw),
+        },
+
+        FindInFilesMsg::ClickRow { index, click_count } => {
+            if index >= model.find_in_files.row_count() {
+                return Some(Cmd::Redraw);
+            }
+            model.find_in_files.selected_index = Some(index);
+            if click_count >= 2 {
+                return open_result(model, index);
+            }
+            Some(Cmd::Redraw)
+        }
+
+        FindInFilesMsg::Scroll { lines } => {
+            let state = &mut model.find_in_files;
+            state.scroll_offset = if lines < 0 {
+                state
+                    .scroll_offset
+                    .saturating_sub(lines.unsigned_abs() as usize)
+            } else {
+                state.scroll_offset.saturating_add(lines as usize)
+            };
+            let visible = results_visible_capacity(model);
+            let state = &mut model.find_in_files;
+            state.scroll_offset = state
+                .scroll_offset
+                .min(state.row_count().saturating_sub(visible));
+            Some(Cmd::Redraw)
+        }
+    }
+}
+
+/// Start a new search when the find-in-files modal's query changed.
+/// Called after every modal message, like `index_find_matches`.
+pub(super) fn search_on_query_change(model: &mut AppModel) -> Option<Cmd> {
+    let Some(ModalState::FindInFiles(modal)) = &model.ui.active_modal else {
+        return None;
+    };
+    let query = modal.input();
+    if query == model.find_in_files.query {
+        return None;
+    }
+
+    let Some(workspace) = &model.workspace else {
+        model.find_in_files.start("", Default::default(), vec![]);
+        return Some(Cmd::Redraw);
+    };
+    let files = workspace.file_tree.file_index();
+    let buffers = unsaved_buffers(model);
+    model
+        .find_in_files
+        .start(&query, files, buffers)
+        .map(|request| Cmd::FindInFiles { request })
+}
+
+/// Open documents with unsaved edits, by path
+fn unsaved_buffers(model: &AppModel) -> Vec<(PathBuf, ropey::Rope)> {
+    model
+        .editor_area
+        .documents
+        .values()
+        .filter(|doc| doc.is_modified && !doc.is_loading())
+        .filter_map(|doc| Some((doc.file_path.clone()?, doc.buffer.clone())))
+        .collect()
+}
+
+/// Show the results panel in its dock, without moving focus
+pub(super) fn show_results_panel(model: &mut AppModel) {
+    if let Some(position) = model.dock_layout.find_panel(PanelId::SEARCH) {
+        model
+            .dock_layout
+            .dock_mut(position)
+            .activate(PanelId::SEARCH);
+    }
+}
+
+/// Open the file of result row `index` and select its first match
+fn open_result(model: &mut AppModel, index: usize) -> Option<Cmd> {
+    let Some((path, line, column)) = model
+        .find_in_files
+        .target(index)
+        .map(|(path, line, column)| (path.to_path_buf(), line, column))
+    else {
+        return Some(Cmd::Redraw);
+    };
+    let match_chars = model.find_in_files.query.chars().count();
+
+    let cmd = update_layout(model, LayoutMsg::OpenFileInNewTab(path.clone()));
+    let opened = model
+        .editor_area
+        .focused_document()
+        .is_some_and(|doc| doc.file_path.as_ref() == Some(&path) && !doc.is_loading());
+    if !opened {
+        return cmd;
+    }
+
+    // The file may have changed since it was searched
+    let doc = model.document();
+    let line = line.min(doc.line_count().saturating_sub(1));
+    let line_len = doc.line_length(line);
+    let start = column.min(line_len);
+    let end = (column + match_chars).min(line_len);
+
+    let editor = model.editor_mut();
+    editor.collapse_to_primary();
+    editor.cursors[0].line = line;
+    editor.cursors[0].column = end;
+    editor.cursors[0].desired_column = None;
+    editor.selections[0] =
+        Selection::from_anchor_head(Position::new(line, start), Position::new(line, end));
+    model.ensure_cursor_visible_centered();
+    model.ui.focus_editor();
+    cmd.or(Some(Cmd::Redraw))
+}
+
+/// Result rows that fit in the bottom dock
+fn results_visible_capacity(model: &AppModel) -> usize {
+    WindowLayout::compute(model, model.line_height)
+        .bottom_dock_rect
+        .map(|rect| {
+            let dock_layout = DockHeaderLayout::new(
+                &model.dock_layout.bottom,
+                rect,
+                &model.metrics,
+                model.char_width,
+            );
+            SearchPanelLayout::new(dock_layout.content_rect, &model.metrics)
+                .results
+                .visible_capacity()
+        })
+        .unwrap_or(0)
+}
@@ -1,6 +1,7 @@
 //! Layout message handlers (split views, tabs, groups)
 
 use std::path::PathBuf;
+use std::sync::Arc;
 
 use crate::commands::Cmd;
 use crate::messages::LayoutMsg;
@@ -11,8 +12,8 @@ use crate::model::{
     SplitDirection, Tab, TabId,
 };
 use crate::util::{
-    filename_for_display, is_likely_binary, is_supported_image, validate_file_for_opening,
-    FileOpenError,
+    filename_for_display, is_large_file, is_likely_binary, is_supported_image,
+    validate_file_for_opening, FileOpenError,
 };
 
 use super::syntax::schedule_syntax_parse;
@@ -356,7 +357,7 @@ fn open_file_in_new_tab(model: &mut AppModel, path: PathBuf) -> Option<Cmd> {
     // 1. Validate file and load/create document
     let doc_id = model.editor_area.next_document_id();
     let document = match validate_file_for_opening(&path) {
-        Ok(()) => {
+        Ok(size_bytes) => {
             // File exists - check for image files first
             if is_supported_image(&path) {
                 let group = model.editor_area.groups.get(&group_id);
@@ -367,10 +368,13 @@ fn open_file_in_new_tab(model: &mut AppModel, path: PathBuf) -> Option<Cmd> {
                     })
                     .unwrap_or(600);
 
-                match crate::image::load_image(&path, vw, vh) {
+                // Only the header is read here; the pixels are decoded in the
+                // background while the tab shows a placeholder
+                match crate::image::open_image(&path, vw, vh) {
                     Some(image_state) => {
                         let w = image_state.width;
                         let h = image_state.height;
+                        let scale = image_state.scale;
 
                         let mut doc = Document::new();
                         doc.id = Some(doc_id);
@@ -402,6 +406,11 @@ fn open_file_in_new_tab(model: &mut AppModel, path: PathBuf) -> Option<Cmd> {
                             .set_status(format!("Opened image: {} ({}×{})", filename, w, h));
                         return Some(Cmd::Batch(vec![
                             Cmd::Redraw,
+                            Cmd::DecodeImage {
+                                document_id: doc_id,
+                                path,
+                                scale,
+                            },
                             Cmd::SaveRecentFiles {
                                 recent: model.recent_files.clone(),
                             },
@@ -418,8 +427,6 @@ fn open_file_in_new_tab(model: &mut AppModel, path: PathBuf) -> Option<Cmd> {
 
             // Check for binary content
             if is_likely_binary(&path) {
-                let size_bytes = std::fs::metadata(&path).map(|m| m.len()).unwrap_or(0);
-
                 let mut doc = Document::new();
                 doc.id = Some(doc_id);
                 doc.file_path = Some(path.clone());
@@ -457,11 +464,21 @@ fn open_file_in_new_tab(model: &mut AppModel, path: PathBuf) -> Option<Cmd> {
                 ]));
             }
 
-            // Load text document from file
-            match Document::from_file(path.clone()) {
+            // Large files start empty and stream in the background
+            // (see Cmd::StreamLargeFile)
+            let loaded = if is_large_file(size_bytes, model.config.large_file_threshold_mb) {
+                Ok(Document::loading_from_file(path.clone(), size_bytes))
+            } else {
+                Document::from_file(path.clone())
+            };
+            match loaded {
                 Ok(mut doc) => {
                     doc.id = Some(doc_id);
-                    model.ui.set_status(format!("Opened: {}", path.display()));
+                    if doc.is_loading() {
+                        model.ui.set_status(format!("Loading {}...", filename));
+                    } else {
+                        model.ui.set_status(format!("Opened: {}", path.display()));
+                    }
                     doc
                 }
                 Err(e) => {
@@ -484,6 +501,14 @@ fn open_file_in_new_tab(model: &mut AppModel, path: PathBuf) -> Option<Cmd> {
             return Some(Cmd::Redraw);
         }
     };
+    let stream_cmd = document
+        .loading
+        .as_ref()
+        .map(|progress| Cmd::StreamLargeFile {
+            document_id: doc_id,
+            path: path.clone(),
+            cancel: Arc::clone(&progress.cancel),
+        });
     model.editor_area.documents.insert(doc_id, document);
 
     // Record in recent files
@@ -520,6 +545,7 @@ fn open_file_in_new_tab(model: &mut AppModel, path: PathBuf) -> Option<Cmd> {
     if let Some(parse_cmd) = schedule_syntax_parse(model, doc_id) {
         cmds.push(parse_cmd);
     }
+    cmds.extend(stream_cmd);
     Some(Cmd::Batch(cmds))
 }
 
@@ -1269,7 +1295,13 @@ fn release_document_if_unreferenced(
     }
 
     model.editor_area.close_previews_for_document(doc_id);
-    model.editor_area.documents.remove(&doc_id).is_some()
+    match model.editor_area.documents.remove(&doc_id) {
+        Some(mut document) => {
+            document.stop_loading();
+            true
+        }
+        None => false,
+    }
 }
 
 /// Sync all editor viewports to their group's actual dimensions.
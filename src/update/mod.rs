@@ -3,10 +3,12 @@
 //! All state transformations flow through these functions.
 
 mod app;
+mod batch_edit;
 mod csv;
 mod dock;
 mod document;
 mod editor;
+mod find_in_files;
 mod image;
 pub mod layout;
 mod outline;
@@ -18,6 +20,7 @@ mod ui;
 mod workspace;
 
 use crate::commands::Cmd;
+use crate::editable::EditContext;
 use crate::messages::{CsvMsg, Direction, DocumentMsg, EditorMsg, Msg};
 use crate::model::sync_status_bar;
 use crate::model::AppModel;
@@ -32,10 +35,13 @@ pub use csv::update_csv;
 pub use dock::update_dock;
 pub use document::update_document;
 pub use editor::update_editor;
+pub use find_in_files::update_find_in_files;
 pub use layout::update_layout;
 pub use outline::update_outline;
 pub use preview::update_preview;
-pub use syntax::{schedule_syntax_parse, update_syntax, SYNTAX_DEBOUNCE_MS};
+pub use syntax::{
+    schedule_syntax_parse, update_syntax, viewport_priority_lines, SYNTAX_DEBOUNCE_MS,
+};
 pub use terminal::update_terminal;
 pub use text_edit::{apply_text_edit_msg, update_text_edit};
 pub use ui::update_ui;
@@ -45,8 +51,12 @@ pub use workspace::update_workspace;
 ///
 /// In debug builds, this wraps with tracing instrumentation.
 /// In release builds, it's a direct dispatch with zero overhead.
+/// Every message is offered to the session recorder first (see
+/// [`crate::replay`]).
 #[inline]
 pub fn update(model: &mut AppModel, msg: Msg) -> Option<Cmd> {
+    crate::replay::record(&msg);
+
     #[cfg(debug_assertions)]
     {
         update_traced(model, msg)
@@ -100,6 +110,11 @@ fn update_inner(model: &mut AppModel, msg: Msg) -> Option<Cmd> {
                 return None;
             }
 
+            // Large files are read-only until they finish streaming in
+            if !matches!(m, DocumentMsg::Copy) && focused_document_is_loading(model) {
+                return None;
+            }
+
             // When in CSV mode, intercept document messages for cell editing
             let csv_info = model
                 .editor_area
@@ -124,6 +139,12 @@ fn update_inner(model: &mut AppModel, msg: Msg) -> Option<Cmd> {
         Msg::Workspace(m) => workspace::update_workspace(model, m),
         Msg::Dock(m) => dock::update_dock(model, m),
         Msg::Outline(m) => outline::update_outline(model, m),
+        Msg::FindInFiles(m) => find_in_files::update_find_in_files(model, m),
+        Msg::TextEdit(EditContext::Editor, m)
+            if m.is_editing() && focused_document_is_loading(model) =>
+        {
+            return None;
+        }
         Msg::TextEdit(context, m) => text_edit::update_text_edit(model, context, m),
         Msg::Terminal(m) => terminal::update_terminal(model, m),
     };
@@ -132,6 +153,14 @@ fn update_inner(model: &mut AppModel, msg: Msg) -> Option<Cmd> {
     result
 }
 
+/// Whether the focused document is a large file that is still streaming in
+fn focused_document_is_loading(model: &AppModel) -> bool {
+    model
+        .editor_area
+        .focused_document()
+        .is_some_and(|doc| doc.is_loading())
+}
+
 /// Map text editor movement messages to CSV navigation messages
 ///
 /// When not editing: arrows move cell selection
@@ -251,6 +280,7 @@ fn msg_type_name(msg: &Msg) -> String {
         Msg::Workspace(m) => format!("Workspace::{:?}", m),
         Msg::Dock(m) => format!("Dock::{:?}", m),
         Msg::Outline(m) => format!("Outline::{:?}", m),
+        Msg::FindInFiles(m) => format!("FindInFiles::{:?}", m),
         Msg::TextEdit(ctx, m) => format!("TextEdit::{:?}::{:?}", ctx, m),
         Msg::Terminal(m) => format!("Terminal::{:?}", m),
     }
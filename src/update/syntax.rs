@@ -2,16 +2,23 @@
 //!
 //! Handles syntax-related messages for the Elm architecture.
 
+use std::ops::Range;
+
 use crate::commands::Cmd;
 #[cfg(debug_assertions)]
 use crate::debug_overlay::SyntaxEventType;
 use crate::messages::SyntaxMsg;
+use crate::model::editor_area::DocumentId;
 use crate::model::AppModel;
 
 /// Debounce delay in milliseconds
 /// Kept short since we preserve old highlights during the wait (no FOUC)
 pub const SYNTAX_DEBOUNCE_MS: u64 = 30;
 
+/// Lines above and below the viewport included in the first highlight pass,
+/// so short scrolls don't reveal uncolored text before the full pass lands
+pub const VIEWPORT_HIGHLIGHT_MARGIN: usize = 100;
+
 /// Handle syntax-related messages
 pub fn update_syntax(model: &mut AppModel, msg: SyntaxMsg) -> Option<Cmd> {
     match msg {
@@ -58,9 +65,15 @@ pub fn update_syntax(model: &mut AppModel, msg: SyntaxMsg) -> Option<Cmd> {
                 return None;
             }
 
-            // Snapshot the document content for parsing
-            let source = doc.buffer.to_string();
+            // Snapshot the document (O(1) rope clone) and drain the edits
+            // made since the last request so the worker can edit its tree
+            let priority_lines = viewport_priority_lines(model, document_id);
+            let visible = model.editor_area.is_document_visible(document_id);
+            let doc = model.editor_area.documents.get_mut(&document_id)?;
+            let snapshot = doc.buffer.clone();
+            let edits = doc.edit_journal.take(revision);
             let language = doc.language;
+            let has_highlights = doc.syntax_highlights.is_some();
 
             #[cfg(debug_assertions)]
             if let Some(ref mut overlay) = model.debug_overlay {
@@ -68,15 +81,26 @@ pub fn update_syntax(model: &mut AppModel, msg: SyntaxMsg) -> Option<Cmd> {
                     SyntaxEventType::ParseStarted,
                     document_id.0,
                     revision,
-                    format!("ParseReady → RunParse ({} chars)", source.len()),
+                    format!(
+                        "ParseReady → RunParse ({} chars, {})",
+                        snapshot.len_chars(),
+                        edits
+                            .as_ref()
+                            .map(|d| format!("{} edits", d.edits.len()))
+                            .unwrap_or_else(|| "full diff".to_string())
+                    ),
                 );
             }
 
             Some(Cmd::RunSyntaxParse {
                 document_id,
                 revision,
-                source,
+                snapshot,
+                edits,
                 language,
+                priority_lines,
+                has_highlights,
+                visible,
             })
         }
 
@@ -104,6 +128,13 @@ pub fn update_syntax(model: &mut AppModel, msg: SyntaxMsg) -> Option<Cmd> {
                 }
             };
 
+            // The worker only sends outlines that changed since its last one,
+            // so keep each one, even from a stale parse: the next result may
+            // leave it out as unchanged.
+            if let Some(outline) = outline {
+                doc.outline = Some(outline);
+            }
+
             // Skip if document has been edited since parse started
             if doc.revision != revision {
                 tracing::debug!(
@@ -128,13 +159,16 @@ pub fn update_syntax(model: &mut AppModel, msg: SyntaxMsg) -> Option<Cmd> {
             // Store the highlights and record debug info
             #[cfg(debug_assertions)]
             let (line_count, token_count) = {
-                let lc = highlights.lines.len();
-                let tc: usize = highlights.lines.values().map(|lh| lh.tokens.len()).sum();
+                let lc = highlights.line_count();
+                let tc = highlights.token_count();
                 (lc, tc)
             };
 
-            doc.syntax_highlights = Some(highlights);
-            doc.outline = outline;
+            // Viewport-first results only replace the lines they cover
+            match doc.syntax_highlights.as_mut() {
+                Some(existing) => existing.apply(highlights),
+                None => doc.syntax_highlights = Some(highlights),
+            }
             tracing::debug!(
                 "Applied syntax highlights for document {:?}, revision {}",
                 document_id,
@@ -160,9 +194,10 @@ pub fn update_syntax(model: &mut AppModel, msg: SyntaxMsg) -> Option<Cmd> {
         } => {
             let doc = model.editor_area.documents.get_mut(&document_id)?;
 
-            // Update language and clear old highlights
+            // Update language and clear old highlights and outline
             doc.language = language;
             doc.syntax_highlights = None;
+            doc.outline = None;
 
             // Trigger a new parse
             let revision = doc.revision;
@@ -183,9 +218,59 @@ pub fn update_syntax(model: &mut AppModel, msg: SyntaxMsg) -> Option<Cmd> {
                 delay_ms: 0, // Immediate parse on language change
             })
         }
+
+        // Timing only; recorded into PerfStats by the runtime
+        SyntaxMsg::LanguageInitialized { .. } => None,
+
+        SyntaxMsg::ParserCacheReport { worker, documents } => {
+            model.memory.record_parser_cache(worker, documents);
+            let document_ids = crate::memory::evict_parser_caches(model);
+            if document_ids.is_empty() {
+                return None;
+            }
+            tracing::debug!(
+                "Parser cache over its cap, evicting {} background documents",
+                document_ids.len()
+            );
+            Some(Cmd::EvictSyntaxCache { document_ids })
+        }
     }
 }
 
+/// Lines of `document_id` to highlight before the rest of the document.
+///
+/// Uses the focused editor's viewport when it shows the document, otherwise
+/// any editor showing it. Returns `None` when the range would cover the whole
+/// document anyway, so small files are highlighted in a single pass.
+pub fn viewport_priority_lines(model: &AppModel, document_id: DocumentId) -> Option<Range<usize>> {
+    let line_count = model
+        .editor_area
+        .documents
+        .get(&document_id)?
+        .buffer
+        .len_lines();
+    let editor = model
+        .editor_area
+        .focused_editor()
+        .filter(|editor| editor.document_id == Some(document_id))
+        .or_else(|| {
+            model
+                .editor_area
+                .editors
+                .values()
+                .find(|editor| editor.document_id == Some(document_id))
+        })?;
+
+    let viewport = &editor.viewport;
+    let start = viewport
+        .top_line
+        .saturating_sub(VIEWPORT_HIGHLIGHT_MARGIN)
+        .min(line_count);
+    let end =
+        (viewport.top_line + viewport.visible_lines + VIEWPORT_HIGHLIGHT_MARGIN).min(line_count);
+    (start < end && (start > 0 || end < line_count)).then_some(start..end)
+}
+
 /// Schedule a syntax parse for a document (call after document edits)
 ///
 /// This returns a `Cmd::DebouncedSyntaxParse` that should be included
@@ -196,8 +281,8 @@ pub fn schedule_syntax_parse(
 ) -> Option<Cmd> {
     let doc = model.editor_area.documents.get(&document_id)?;
 
-    // Skip plain text documents
-    if !doc.language.has_highlighting() {
+    // Skip plain text and large-file documents
+    if !doc.syntax_enabled() {
         return None;
     }
 
@@ -223,6 +308,7 @@ pub fn schedule_syntax_parse(
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::outline::OutlineData;
     use crate::syntax::{LanguageId, ParserState, SyntaxHighlights};
 
     #[test]
@@ -289,19 +375,68 @@ mod tests {
         if let Some(Cmd::RunSyntaxParse {
             document_id,
             revision,
-            source,
+            snapshot,
+            edits,
             language,
+            priority_lines,
+            has_highlights,
+            visible,
         }) = cmd
         {
             assert_eq!(document_id, doc_id);
             assert_eq!(revision, 5);
-            assert_eq!(source, "fn main() {}");
+            assert_eq!(snapshot.to_string(), "fn main() {}");
+            // The buffer was replaced behind the journal's back
+            assert!(edits.is_none());
             assert_eq!(language, LanguageId::Rust);
+            // A one-line document fits the viewport: single pass
+            assert!(priority_lines.is_none());
+            assert!(!has_highlights);
+            // The only document is in the focused group's active tab
+            assert!(visible);
         } else {
             panic!("Expected RunSyntaxParse command");
         }
     }
 
+    #[test]
+    fn test_parse_ready_prioritizes_viewport_lines() {
+        let mut model = AppModel::new(800, 600, 1.0, vec![]);
+        let doc_id = model.document().id.expect("Document should have an ID");
+        {
+            let doc = model.editor_area.documents.get_mut(&doc_id).unwrap();
+            doc.language = LanguageId::Rust;
+            doc.buffer = ropey::Rope::from("fn f() {}\n".repeat(1000));
+            doc.syntax_highlights = Some(SyntaxHighlights::new(LanguageId::Rust, 0));
+        }
+        {
+            let viewport = &mut model.editor_area.focused_editor_mut().unwrap().viewport;
+            viewport.top_line = 500;
+            viewport.visible_lines = 30;
+        }
+        let revision = model.editor_area.documents[&doc_id].revision;
+
+        let cmd = update_syntax(
+            &mut model,
+            SyntaxMsg::ParseReady {
+                document_id: doc_id,
+                revision,
+            },
+        );
+
+        let Some(Cmd::RunSyntaxParse {
+            priority_lines,
+            has_highlights,
+            ..
+        }) = cmd
+        else {
+            panic!("Expected RunSyntaxParse command");
+        };
+        let margin = VIEWPORT_HIGHLIGHT_MARGIN;
+        assert_eq!(priority_lines, Some(500 - margin..530 + margin));
+        assert!(has_highlights);
+    }
+
     #[test]
     fn test_parse_ready_skips_stale_revision() {
         let mut model = AppModel::new(800, 600, 1.0, vec![]);
@@ -392,6 +527,41 @@ mod tests {
         assert!(doc.syntax_highlights.is_none());
     }
 
+    #[test]
+    fn test_parse_completed_keeps_outline_unless_a_new_one_is_sent() {
+        let mut model = AppModel::new(800, 600, 1.0, vec![]);
+        let doc_id = model.document().id.expect("Document should have an ID");
+        {
+            let doc = model.editor_area.documents.get_mut(&doc_id).unwrap();
+            doc.language = LanguageId::Rust;
+            doc.revision = 3;
+        }
+
+        let completed = |revision, outline| SyntaxMsg::ParseCompleted {
+            document_id: doc_id,
+            revision,
+            highlights: SyntaxHighlights::new(LanguageId::Rust, revision),
+            outline,
+        };
+        let outline_revision = |model: &AppModel| {
+            model.editor_area.documents[&doc_id]
+                .outline
+                .as_ref()
+                .map(|o| o.revision)
+        };
+
+        // A changed outline is kept even when the parse itself is stale
+        update_syntax(&mut model, completed(2, Some(OutlineData::empty(2))));
+        assert_eq!(outline_revision(&model), Some(2));
+
+        // No outline means unchanged
+        update_syntax(&mut model, completed(3, None));
+        assert_eq!(outline_revision(&model), Some(2));
+
+        update_syntax(&mut model, completed(3, Some(OutlineData::empty(3))));
+        assert_eq!(outline_revision(&model), Some(3));
+    }
+
     #[test]
     fn test_full_syntax_update_flow() {
         // Simulate the complete flow: edit -> schedule -> ready -> parse -> completed
@@ -442,7 +612,7 @@ mod tests {
         // Verify highlights are stored
         let doc = model.editor_area.documents.get(&doc_id).unwrap();
         assert!(doc.syntax_highlights.is_some());
-        assert!(!doc.syntax_highlights.as_ref().unwrap().lines.is_empty());
+        assert!(!doc.syntax_highlights.as_ref().unwrap().is_empty());
     }
 
     #[test]
@@ -480,8 +650,7 @@ mod tests {
                 .syntax_highlights
                 .as_ref()
                 .unwrap()
-                .lines
-                .contains_key(&0),
+                .has_line(0),
             "Should have highlights on line 0 before edit"
         );
 
@@ -540,12 +709,11 @@ mod tests {
 
         // Verify the new highlights have tokens on line 1 (where fn main is now)
         assert!(
-            new_highlights.lines.contains_key(&1),
+            new_highlights.has_line(1),
             "New highlights should have tokens on line 1"
         );
         assert!(
-            !new_highlights.lines.contains_key(&0)
-                || new_highlights.lines.get(&0).unwrap().tokens.is_empty(),
+            new_highlights.get_line_tokens(0).is_empty(),
             "Line 0 should be empty or have no tokens (it's just a newline)"
         );
 
@@ -568,7 +736,7 @@ mod tests {
 
         let final_highlights = doc.syntax_highlights.as_ref().unwrap();
         assert!(
-            final_highlights.lines.contains_key(&1),
+            final_highlights.has_line(1),
             "Final highlights should have tokens on line 1"
         );
     }
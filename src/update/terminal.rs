@@ -7,6 +7,7 @@
 use crate::commands::Cmd;
 use crate::messages::TerminalMsg;
 use crate::model::AppModel;
+use crate::panel::PanelId;
 
 /// Default terminal grid size for a newly spawned session, before the dock
 /// panel has a resolved content rect to derive real rows/cols from (wired
@@ -26,6 +27,18 @@ fn next_session_id(model: &AppModel) -> usize {
         .unwrap_or(0)
 }
 
+/// Redraw the terminal rows when `session_id` is the session on screen.
+/// Output from background sessions, or while the panel is hidden, only
+/// updates the emulator; the next full redraw of the panel shows it.
+fn redraw_if_visible(model: &AppModel, session_id: usize) -> Option<Cmd> {
+    let on_screen = model
+        .terminal
+        .active_session()
+        .is_some_and(|session| session.id == session_id)
+        && model.dock_layout.showing_panel(PanelId::TERMINAL).is_some();
+    on_screen.then(Cmd::redraw_terminal)
+}
+
 pub fn update_terminal(model: &mut AppModel, msg: TerminalMsg) -> Option<Cmd> {
     match msg {
         TerminalMsg::NewSession => {
@@ -57,16 +70,16 @@ pub fn update_terminal(model: &mut AppModel, msg: TerminalMsg) -> Option<Cmd> {
         }
 
         TerminalMsg::PtyOutput { session_id, data } => {
-            if let Some(session) = model.terminal.session_mut(session_id) {
-                let was_at_bottom = session.scroll_offset == 0;
-                session.apply_bytes(&data);
-                if was_at_bottom {
-                    session.scroll_offset = 0;
-                } else {
-                    session.clamp_scroll_offset();
-                }
+            let session = model.terminal.session_mut(session_id)?;
+            let was_at_bottom = session.scroll_offset == 0;
+            session.apply_bytes(&data);
+            session.pty.output_applied(data.len());
+            if was_at_bottom {
+                session.scroll_offset = 0;
+            } else {
+                session.clamp_scroll_offset();
             }
-            Some(Cmd::Redraw)
+            redraw_if_visible(model, session_id)
         }
 
         TerminalMsg::ProcessExited { session_id, code } => {
@@ -108,7 +121,7 @@ pub fn update_terminal(model: &mut AppModel, msg: TerminalMsg) -> Option<Cmd> {
             None
         }
 
-        TerminalMsg::Redraw { session_id: _ } => Some(Cmd::Redraw),
+        TerminalMsg::Redraw { session_id } => redraw_if_visible(model, session_id),
 
         TerminalMsg::ScrollUp(lines) => {
             if let Some(session) = model.terminal.active_session_mut() {
@@ -209,7 +222,30 @@ mod tests {
                 data: b"hello".to_vec(),
             },
         );
-        assert!(matches!(cmd, Some(Cmd::Redraw)));
+        assert!(cmd.is_none());
+    }
+
+    #[test]
+    fn pty_output_redraws_terminal_rows_only_while_on_screen() {
+        let mut model = test_model();
+        push_test_session(&mut model, 2, 20);
+        let output = |model: &mut AppModel| {
+            update_terminal(
+                model,
+                TerminalMsg::PtyOutput {
+                    session_id: 7,
+                    data: b"hi".to_vec(),
+                },
+            )
+        };
+
+        model.dock_layout.bottom.close();
+        assert!(output(&mut model).is_none());
+
+        model.dock_layout.bottom.activate(PanelId::TERMINAL);
+        let damage = output(&mut model).unwrap().damage();
+        assert!(damage.includes_terminal());
+        assert!(!damage.includes_editor());
     }
 
     #[test]
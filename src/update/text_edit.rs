@@ -14,6 +14,7 @@ use crate::editable::{
 use crate::messages::{Direction, DocumentMsg, EditorMsg};
 use crate::model::{AppModel, FindReplaceField, ModalState};
 
+use super::ui::index_find_matches;
 use super::{update_document, update_editor};
 
 /// Handle a TextEditMsg by routing to the appropriate EditableState.
@@ -63,6 +64,7 @@ pub fn update_text_edit(
                 state.focused_field = FindReplaceField::Query;
                 let modified = apply_text_edit_msg(&mut state.query_editable, &msg);
                 if modified {
+                    index_find_matches(model);
                     Some(Cmd::Redraw)
                 } else {
                     None
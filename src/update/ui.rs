@@ -5,15 +5,18 @@ use std::time::Duration;
 use crate::commands::{filter_commands, Cmd};
 use crate::editable::{EditableState, StringBuffer};
 use crate::messages::LayoutMsg;
-use crate::messages::{ModalMsg, UiMsg};
+use crate::messages::{FindInFilesMsg, ModalMsg, UiMsg};
 use crate::model::{
-    AppModel, FileFinderState, GotoLineState, ModalId, ModalState, RecentFilesState,
-    SegmentContent, SegmentId, ThemePickerState, TransientMessage,
+    AppModel, FileFinderState, FindInFilesModalState, GotoLineState, ModalId, ModalState,
+    RecentFilesState, SegmentContent, SegmentId, ThemePickerState, TransientMessage,
 };
+use crate::panel::PanelId;
+use crate::syntax::TextEdit;
 use crate::theme::load_theme;
 use crate::update::layout::update_layout;
 
 use super::app::execute_command;
+use super::find_in_files::{search_on_query_change, show_results_panel, update_find_in_files};
 
 /// Handle UI messages (status bar, cursor blink, modals)
 pub fn update_ui(model: &mut AppModel, msg: UiMsg) -> Option<Cmd> {
@@ -82,7 +85,14 @@ pub fn update_ui(model: &mut AppModel, msg: UiMsg) -> Option<Cmd> {
             Some(Cmd::redraw_status_bar())
         }
 
-        UiMsg::Modal(modal_msg) => update_modal(model, modal_msg),
+        UiMsg::Modal(modal_msg) => {
+            let cmd = update_modal(model, modal_msg);
+            index_find_matches(model);
+            match (cmd, search_on_query_change(model)) {
+                (Some(cmd), Some(search)) => Some(Cmd::batch(vec![cmd, search])),
+                (cmd, search) => cmd.or(search),
+            }
+        }
 
         UiMsg::ToggleModal(modal_id) => {
             if let Some(ref active) = model.ui.active_modal {
@@ -109,9 +119,9 @@ pub fn update_ui(model: &mut AppModel, msg: UiMsg) -> Option<Cmd> {
                 ModalId::FileFinder => {
                     // Get files from workspace (if open)
                     if let Some(ref workspace) = model.workspace {
-                        let all_files = workspace.file_tree.get_all_file_paths();
+                        let files = workspace.file_tree.file_index();
                         let workspace_root = workspace.root.clone();
-                        let mut state = FileFinderState::new(all_files, workspace_root);
+                        let mut state = FileFinderState::new(files, workspace_root);
                         // Initialize results with all files (empty query shows all)
                         update_file_finder_results(&mut state);
                         ModalState::FileFinder(state)
@@ -130,6 +140,14 @@ pub fn update_ui(model: &mut AppModel, msg: UiMsg) -> Option<Cmd> {
                         current_file.as_deref(),
                     ))
                 }
+                ModalId::FindInFiles => {
+                    if model.workspace.is_none() {
+                        model.ui.set_status("No workspace open");
+                        return Some(Cmd::Redraw);
+                    }
+                    show_results_panel(model);
+                    ModalState::FindInFiles(FindInFilesModalState::new(&model.find_in_files.query))
+                }
             };
             model.ui.open_modal(state);
             Some(Cmd::Redraw)
@@ -145,16 +163,13 @@ pub fn update_ui(model: &mut AppModel, msg: UiMsg) -> Option<Cmd> {
             }
 
             // Get files from workspace
-            let (all_files, workspace_root) = if let Some(ref workspace) = model.workspace {
-                (
-                    workspace.file_tree.get_all_file_paths(),
-                    workspace.root.clone(),
-                )
+            let (files, workspace_root) = if let Some(ref workspace) = model.workspace {
+                (workspace.file_tree.file_index(), workspace.root.clone())
             } else {
                 return Some(Cmd::Redraw);
             };
 
-            let mut state = FileFinderState::new(all_files, workspace_root);
+            let mut state = FileFinderState::new(files, workspace_root);
             // Initialize results with all files (empty query shows all)
             update_file_finder_results(&mut state);
             model.ui.open_modal(ModalState::FileFinder(state));
@@ -271,6 +286,7 @@ fn modal_editable_mut(modal: &mut ModalState) -> Option<&mut EditableState<Strin
         ModalState::ThemePicker(_) => None,
         ModalState::FileFinder(state) => Some(&mut state.editable),
         ModalState::RecentFiles(state) => Some(&mut state.editable),
+        ModalState::FindInFiles(state) => Some(&mut state.editable),
     }
 }
 
@@ -278,13 +294,17 @@ fn modal_editable_mut(modal: &mut ModalState) -> Option<&mut EditableState<Strin
 /// text input changes (insert/delete/cut/paste). `CommandPalette` and
 /// `RecentFiles` reset their selected index back to the top of the list;
 /// `FileFinder` refreshes its fuzzy-matched results. Other modal types have
-/// no such side effect.
+/// no such side effect (`FindInFiles` starts its search from the `UiMsg::Modal`
+/// handler, since that needs the whole model).
 fn on_modal_input_changed(modal: &mut ModalState) {
     match modal {
         ModalState::CommandPalette(state) => state.selected_index = 0,
         ModalState::FileFinder(state) => update_file_finder_results(state),
         ModalState::RecentFiles(state) => state.selected_index = 0,
-        ModalState::GotoLine(_) | ModalState::FindReplace(_) | ModalState::ThemePicker(_) => {}
+        ModalState::GotoLine(_)
+        | ModalState::FindReplace(_)
+        | ModalState::ThemePicker(_)
+        | ModalState::FindInFiles(_) => {}
     }
 }
 
@@ -336,6 +356,7 @@ fn update_modal(model: &mut AppModel, msg: ModalMsg) -> Option<Cmd> {
                         state.editable.set_content(&text);
                         state.selected_index = 0;
                     }
+                    ModalState::FindInFiles(state) => state.set_input(&text),
                 }
                 Some(Cmd::Redraw)
             } else {
@@ -562,6 +583,10 @@ fn update_modal(model: &mut AppModel, msg: ModalMsg) -> Option<Cmd> {
         }
 
         ModalMsg::SelectPrevious => {
+            // Arrows step through the results panel while the query is typed
+            if let Some(ModalState::FindInFiles(_)) = model.ui.active_modal {
+                return update_find_in_files(model, FindInFilesMsg::SelectPrevious);
+            }
             if let Some(ref mut modal) = model.ui.active_modal {
                 let preview_theme_id = match modal {
                     ModalState::CommandPalette(state) => {
@@ -595,6 +620,9 @@ fn update_modal(model: &mut AppModel, msg: ModalMsg) -> Option<Cmd> {
         }
 
         ModalMsg::SelectNext => {
+            if let Some(ModalState::FindInFiles(_)) = model.ui.active_modal {
+                return update_find_in_files(model, FindInFilesMsg::SelectNext);
+            }
             if let Some(ref mut modal) = model.ui.active_modal {
                 let preview_theme_id = match modal {
                     ModalState::CommandPalette(state) => {
@@ -744,6 +772,20 @@ fn update_modal(model: &mut AppModel, msg: ModalMsg) -> Option<Cmd> {
                         model.ui.close_modal();
                         Some(Cmd::Redraw)
                     }
+                    ModalState::FindInFiles(_) => {
+                        model.ui.close_modal();
+                        if model.find_in_files.selected_index.is_some() {
+                            return update_find_in_files(model, FindInFilesMsg::OpenSelected);
+                        }
+                        // Hand focus to the results so they can be stepped through
+                        if let Some(position) = model.dock_layout.find_panel(PanelId::SEARCH) {
+                            model.ui.focus_dock(position);
+                            if model.find_in_files.row_count() > 0 {
+                                model.find_in_files.selected_index = Some(0);
+                            }
+                        }
+                        Some(Cmd::Redraw)
+                    }
                 }
             } else {
                 None
@@ -844,6 +886,20 @@ fn update_modal(model: &mut AppModel, msg: ModalMsg) -> Option<Cmd> {
     }
 }
 
+/// Keep the focused document's match index current for the open find
+/// modal's query, so the modal can show a match count and find next/previous
+/// don't rescan the document
+pub(super) fn index_find_matches(model: &mut AppModel) {
+    let Some(ModalState::FindReplace(state)) = &model.ui.active_modal else {
+        return;
+    };
+    let query = state.query();
+    let case_sensitive = state.case_sensitive;
+    if let Some(doc) = model.try_document_mut() {
+        doc.match_index(&query, case_sensitive);
+    }
+}
+
 /// Find next occurrence in the document and select it
 fn find_next_in_document(model: &mut AppModel, query: &str, case_sensitive: bool) -> Option<Cmd> {
     let editor = model.editor();
@@ -858,9 +914,14 @@ fn find_next_in_document(model: &mut AppModel, query: &str, case_sensitive: bool
         doc.cursor_to_offset(editor.cursors[0].line, editor.cursors[0].column)
     };
 
-    if let Some((start, end)) =
-        doc.find_next_occurrence_with_options(query, start_offset, case_sensitive)
-    {
+    // Repeated find steps reuse the document's cached match index
+    let found = model
+        .document_mut()
+        .match_index(query, case_sensitive)
+        .and_then(|index| index.next_after(start_offset));
+
+    if let Some((start, end)) = found {
+        let doc = model.document();
         let (start_line, start_col) = doc.offset_to_cursor(start);
         let (end_line, end_col) = doc.offset_to_cursor(end);
 
@@ -902,9 +963,14 @@ fn find_prev_in_document(model: &mut AppModel, query: &str, case_sensitive: bool
         doc.cursor_to_offset(editor.cursors[0].line, editor.cursors[0].column)
     };
 
-    if let Some((start, end)) =
-        doc.find_prev_occurrence_with_options(query, start_offset, case_sensitive)
-    {
+    // Repeated find steps reuse the document's cached match index
+    let found = model
+        .document_mut()
+        .match_index(query, case_sensitive)
+        .and_then(|index| index.prev_before(start_offset));
+
+    if let Some((start, end)) = found {
+        let doc = model.document();
         let (start_line, start_col) = doc.offset_to_cursor(start);
         let (end_line, end_col) = doc.offset_to_cursor(end);
 
@@ -938,6 +1004,10 @@ fn replace_and_find_next(
     replacement: &str,
     case_sensitive: bool,
 ) -> Option<Cmd> {
+    if model.document().is_loading() {
+        return refuse_replace_while_loading(model);
+    }
+
     // First, gather all the info we need without holding borrows
     let should_replace = {
         let editor = model.editor();
@@ -973,7 +1043,11 @@ fn replace_and_find_next(
         doc.buffer.remove(start_offset..end_offset);
         doc.buffer.insert(start_offset, replacement);
         doc.is_modified = true;
-        doc.revision += 1;
+        doc.record_buffer_edits([TextEdit::replace(
+            start_offset,
+            end_offset - start_offset,
+            replacement,
+        )]);
 
         // Update cursor position
         let new_offset = start_offset + replacement.chars().count();
@@ -996,8 +1070,15 @@ fn replace_all(
     replacement: &str,
     case_sensitive: bool,
 ) -> Option<Cmd> {
-    let doc = model.document();
-    let occurrences = doc.find_all_occurrences_with_options(query, case_sensitive);
+    if model.document().is_loading() {
+        return refuse_replace_while_loading(model);
+    }
+
+    let occurrences = model
+        .document_mut()
+        .match_index(query, case_sensitive)
+        .map(|index| index.to_vec())
+        .unwrap_or_default();
 
     if occurrences.is_empty() {
         model.ui.transient_message = Some(TransientMessage::new(
@@ -1012,12 +1093,14 @@ fn replace_all(
     // Replace from end to start to preserve offsets
     let doc = model.document_mut();
     let replacement_char_len = replacement.chars().count();
+    let mut edits = Vec::with_capacity(count);
     for (start, end) in occurrences.into_iter().rev() {
         doc.buffer.remove(start..end);
         doc.buffer.insert(start, replacement);
+        edits.push(TextEdit::replace(start, end - start, replacement));
     }
     doc.is_modified = true;
-    doc.revision += 1;
+    doc.record_buffer_edits(edits);
 
     // Position cursor at end of last replacement (which is now first in document)
     let editor = model.editor_mut();
@@ -1032,6 +1115,15 @@ fn replace_all(
     Some(Cmd::redraw_editor())
 }
 
+/// Large files are read-only until they finish streaming in; the next
+/// chunk would overwrite a replacement
+fn refuse_replace_while_loading(model: &mut AppModel) -> Option<Cmd> {
+    model
+        .ui
+        .set_status("Cannot replace while the file is loading");
+    Some(Cmd::redraw_status_bar())
+}
+
 /// Get the line numbers of all cursors in the focused editor
 /// Returns empty vec if no focused editor exists
 fn get_current_cursor_lines(model: &AppModel) -> Vec<usize> {
@@ -1051,69 +1143,16 @@ fn get_current_cursor_lines(model: &AppModel) -> Vec<usize> {
 // Fuzzy File Finder
 // ============================================================================
 
-use crate::model::FileMatch;
-use nucleo_matcher::{Config, Matcher, Utf32Str};
-use std::path::Path;
-
 /// Update file finder results based on current query
 pub fn update_file_finder_results(state: &mut FileFinderState) {
     let query = state.input();
-    state.results = fuzzy_match_files(&state.all_files, &query, &state.workspace_root);
+    state.results = state
+        .files
+        .search(&query, &mut state.query, &state.workspace_root);
     // Reset selection to first item
     state.selected_index = 0;
 }
 
-/// Perform fuzzy matching on file paths
-fn fuzzy_match_files(
-    files: &[std::path::PathBuf],
-    query: &str,
-    workspace_root: &Path,
-) -> Vec<FileMatch> {
-    if query.is_empty() {
-        // Show all files sorted alphabetically when no query (limit to first 100)
-        return files
-            .iter()
-            .take(100)
-            .map(|p| FileMatch::from_path(p, workspace_root, 0, vec![]))
-            .collect();
-    }
-
-    let mut matcher = Matcher::new(Config::DEFAULT);
-    let mut query_buf = Vec::new();
-    let needle = Utf32Str::new(query, &mut query_buf);
-
-    let mut results: Vec<FileMatch> = files
-        .iter()
-        .filter_map(|path| {
-            let filename = path.file_name()?.to_str()?;
-            let mut filename_buf = Vec::new();
-            let haystack = Utf32Str::new(filename, &mut filename_buf);
-
-            // Get fuzzy match score
-            let score = matcher.fuzzy_match(haystack, needle)?;
-
-            // Get match indices for highlighting
-            let mut indices = vec![];
-            matcher.fuzzy_indices(haystack, needle, &mut indices);
-            let indices = indices.to_vec();
-
-            Some(FileMatch::from_path(
-                path,
-                workspace_root,
-                score as u32,
-                indices,
-            ))
-        })
-        .collect();
-
-    // Sort by score descending
-    results.sort_by_key(|a| std::cmp::Reverse(a.score));
-
-    // Limit results
-    results.truncate(50);
-    results
-}
-
 #[cfg(test)]
 mod tests {
     use super::{get_current_cursor_lines, update_ui};
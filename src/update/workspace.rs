@@ -2,7 +2,7 @@
 
 use crate::commands::Cmd;
 use crate::messages::{LayoutMsg, WorkspaceMsg};
-use crate::model::AppModel;
+use crate::model::{AppModel, ScanRequest};
 use crate::util::visible_tree_index_of;
 use crate::view::geometry::status_bar_height;
 
@@ -156,14 +156,17 @@ pub fn update_workspace(model: &mut AppModel, msg: WorkspaceMsg) -> Option<Cmd>
         }
 
         WorkspaceMsg::Refresh => {
+            let mut scan = None;
             if let Some(workspace) = &mut model.workspace {
-                if let Err(e) = workspace.refresh() {
-                    model.ui.set_status(format!("Failed to refresh: {}", e));
-                } else {
-                    model.ui.set_status("File tree refreshed");
+                match workspace.start_scan() {
+                    Ok(request) => {
+                        scan = Some(request);
+                        model.ui.set_status("Refreshing file tree");
+                    }
+                    Err(e) => model.ui.set_status(format!("Failed to refresh: {}", e)),
                 }
             }
-            Some(Cmd::redraw_editor())
+            Some(with_scan(Cmd::redraw_editor(), scan))
         }
 
         WorkspaceMsg::Scroll { lines } => {
@@ -195,30 +198,45 @@ pub fn update_workspace(model: &mut AppModel, msg: WorkspaceMsg) -> Option<Cmd>
         }
 
         WorkspaceMsg::FileSystemChange { paths } => {
-            // Incrementally update the file tree for changed paths
-            // This is much faster than a full refresh
+            // Patch only the nodes for the changed paths; new directories
+            // are filled in by a background scan
+            let mut scan = None;
             if let Some(workspace) = &mut model.workspace {
                 if paths.is_empty() {
-                    // No specific paths - do full refresh
-                    if let Err(e) = workspace.refresh() {
-                        tracing::warn!("Failed to refresh file tree: {}", e);
-                    } else {
-                        tracing::debug!("File tree fully refreshed");
+                    // No specific paths - do full rescan
+                    match workspace.start_scan() {
+                        Ok(request) => scan = Some(request),
+                        Err(e) => tracing::warn!("Failed to refresh file tree: {}", e),
                     }
                 } else {
-                    // Incremental update for specific changed paths
-                    if let Err(e) = workspace.update_paths(&paths) {
-                        tracing::warn!("Failed to update file tree: {}", e);
-                    } else {
-                        tracing::debug!(
-                            "File tree incrementally updated for {} paths",
-                            paths.len()
-                        );
-                    }
+                    scan = workspace.update_paths(&paths);
+                    tracing::debug!("File tree incrementally updated for {} paths", paths.len());
                 }
             }
+            Some(with_scan(Cmd::redraw_editor(), scan))
+        }
+
+        WorkspaceMsg::ScanBatch { generation, dirs } => {
+            if let Some(workspace) = &mut model.workspace {
+                workspace.apply_scan_batch(generation, dirs);
+            }
             Some(Cmd::redraw_editor())
         }
+
+        WorkspaceMsg::ScanFinished { generation } => {
+            if let Some(workspace) = &mut model.workspace {
+                workspace.finish_scan(generation);
+            }
+            None
+        }
+    }
+}
+
+/// `cmd`, plus the background scan if there is one
+fn with_scan(cmd: Cmd, scan: Option<ScanRequest>) -> Cmd {
+    match scan {
+        Some(request) => Cmd::batch(vec![cmd, Cmd::ScanWorkspace { request }]),
+        None => cmd,
     }
 }
 
@@ -426,6 +444,7 @@ mod tests {
             sidebar_visible: true,
             sidebar_width_logical: metrics.sidebar_default_width_logical,
             scroll_offset: 0,
+            scan: crate::model::ScanState::default(),
         }
     }
 
@@ -0,0 +1,342 @@
+//! Column tables for long lines
+//!
+//! Converting between byte, char and tab-expanded visual columns normally
+//! scans the line from its start, which is fine for source code but turns
+//! quadratic on minified files, where one line can hold megabytes of text
+//! and hundreds of thousands of tokens. [`LineColumns`] is built in one
+//! forward pass over such a line and keeps a checkpoint every
+//! [`CHECKPOINT_INTERVAL`] chars, so each conversion binary-searches the
+//! checkpoints and scans at most one interval.
+//!
+//! [`LineColumnCache`] holds the tables of a document's long lines for its
+//! current revision.
+
+use std::collections::HashMap;
+use std::sync::Arc;
+
+use super::text::TABULATOR_WIDTH;
+
+/// Lines at least this many bytes long get a column table
+pub const LONG_LINE_BYTES: usize = 4096;
+
+/// Chars between two checkpoints
+pub const CHECKPOINT_INTERVAL: usize = 1024;
+
+/// Most line tables a [`LineColumnCache`] holds
+const MAX_CACHED_LINES: usize = 256;
+
+/// A position on a line as byte, char and visual column
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ColumnCheckpoint {
+    pub byte: usize,
+    pub char: usize,
+    pub visual: usize,
+}
+
+impl ColumnCheckpoint {
+    /// The position after `ch`
+    #[inline]
+    fn advance(self, ch: char) -> Self {
+        Self {
+            byte: self.byte + ch.len_utf8(),
+            char: self.char + 1,
+            visual: advance_visual(self.visual, ch),
+        }
+    }
+}
+
+/// Visual column after `ch` when it starts at `visual`
+#[inline]
+pub fn advance_visual(visual: usize, ch: char) -> usize {
+    if ch == '\t' {
+        visual + TABULATOR_WIDTH - (visual % TABULATOR_WIDTH)
+    } else {
+        visual + 1
+    }
+}
+
+/// Sparse byte/char/visual column table for one line, without its line
+/// ending
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct LineColumns {
+    /// Positions of chars `0, CHECKPOINT_INTERVAL, 2 * CHECKPOINT_INTERVAL, ..`
+    checkpoints: Vec<ColumnCheckpoint>,
+    /// Position after the last char
+    end: ColumnCheckpoint,
+}
+
+impl LineColumns {
+    /// Table for `text`
+    pub fn new(text: &str) -> Self {
+        Self::from_chunks(std::iter::once(text))
+    }
+
+    /// Table for the line made of `chunks`, e.g. the chunks of a rope slice
+    pub fn from_chunks<'a>(chunks: impl IntoIterator<Item = &'a str>) -> Self {
+        let mut checkpoints = Vec::new();
+        let mut pos = ColumnCheckpoint::default();
+        for chunk in chunks {
+            for ch in chunk.chars() {
+                if pos.char % CHECKPOINT_INTERVAL == 0 {
+                    checkpoints.push(pos);
+                }
+                pos = pos.advance(ch);
+            }
+        }
+        if checkpoints.is_empty() {
+            checkpoints.push(pos);
+        }
+        Self {
+            checkpoints,
+            end: pos,
+        }
+    }
+
+    /// Line length in bytes
+    pub fn len_bytes(&self) -> usize {
+        self.end.byte
+    }
+
+    /// Line length in chars
+    pub fn len_chars(&self) -> usize {
+        self.end.char
+    }
+
+    /// Line width in visual columns
+    pub fn len_visual(&self) -> usize {
+        self.end.visual
+    }
+
+    /// Last checkpoint at or before byte `byte`
+    pub fn checkpoint_at_byte(&self, byte: usize) -> ColumnCheckpoint {
+        self.checkpoint_where(|cp| cp.byte <= byte)
+    }
+
+    /// Last checkpoint at or before char column `char_col`
+    pub fn checkpoint_at_char(&self, char_col: usize) -> ColumnCheckpoint {
+        self.checkpoint_where(|cp| cp.char <= char_col)
+    }
+
+    /// Last checkpoint at or before visual column `visual_col`
+    pub fn checkpoint_at_visual(&self, visual_col: usize) -> ColumnCheckpoint {
+        self.checkpoint_where(|cp| cp.visual <= visual_col)
+    }
+
+    fn checkpoint_where(&self, before: impl FnMut(&ColumnCheckpoint) -> bool) -> ColumnCheckpoint {
+        // The first checkpoint is the line start, which is before everything
+        let index = self.checkpoints.partition_point(before).max(1);
+        self.checkpoints[index - 1]
+    }
+
+    /// Char column of byte `byte_col` of `text`, the line this table was
+    /// built from. A byte inside a multi-byte char maps to that char.
+    pub fn char_at_byte(&self, text: &str, byte_col: usize) -> usize {
+        let mut byte_col = byte_col.min(text.len());
+        while byte_col > 0 && !text.is_char_boundary(byte_col) {
+            byte_col -= 1;
+        }
+        let cp = self.checkpoint_at_byte(byte_col);
+        cp.char + text[cp.byte..byte_col].chars().count()
+    }
+
+    /// Visual column of char column `char_col`. `chars_at` returns the
+    /// line's chars starting at a checkpoint.
+    pub fn visual_at_char<I>(
+        &self,
+        chars_at: impl FnOnce(ColumnCheckpoint) -> I,
+        char_col: usize,
+    ) -> usize
+    where
+        I: Iterator<Item = char>,
+    {
+        if char_col >= self.end.char {
+            return self.end.visual;
+        }
+        let cp = self.checkpoint_at_char(char_col);
+        chars_at(cp)
+            .take(char_col - cp.char)
+            .fold(cp.visual, advance_visual)
+    }
+
+    /// Char column at visual column `visual_col`, like
+    /// [`visual_col_to_char_col`](super::text::visual_col_to_char_col).
+    /// `chars_at` returns the line's chars starting at a checkpoint.
+    pub fn char_at_visual<I>(
+        &self,
+        chars_at: impl FnOnce(ColumnCheckpoint) -> I,
+        visual_col: usize,
+    ) -> usize
+    where
+        I: Iterator<Item = char>,
+    {
+        if visual_col >= self.end.visual {
+            return self.end.char;
+        }
+        let cp = self.checkpoint_at_visual(visual_col);
+        let mut visual = cp.visual;
+        let mut char_col = cp.char;
+        for ch in chars_at(cp).take(self.end.char - cp.char) {
+            if visual >= visual_col {
+                break;
+            }
+            visual = advance_visual(visual, ch);
+            char_col += 1;
+        }
+        char_col
+    }
+
+    /// Approximate heap bytes held by the table
+    pub fn memory_bytes(&self) -> usize {
+        self.checkpoints.capacity() * std::mem::size_of::<ColumnCheckpoint>()
+    }
+}
+
+/// Column tables of a document's long lines, valid for one revision
+#[derive(Debug, Clone, Default)]
+pub struct LineColumnCache {
+    revision: u64,
+    lines: HashMap<usize, Arc<LineColumns>>,
+}
+
+impl LineColumnCache {
+    /// Table of `line` if it was built at `revision`
+    pub fn get(&self, line: usize, revision: u64) -> Option<&Arc<LineColumns>> {
+        if self.revision != revision {
+            return None;
+        }
+        self.lines.get(&line)
+    }
+
+    /// Drop the tables if they were built at another revision
+    pub fn sync(&mut self, revision: u64) {
+        if self.revision != revision {
+            self.lines.clear();
+            self.revision = revision;
+        }
+    }
+
+    /// Store the table of `line` at `revision`, dropping tables of older
+    /// revisions. Scrolling through a file of many long lines starts over
+    /// once `MAX_CACHED_LINES` tables are held.
+    pub fn insert(&mut self, line: usize, revision: u64, columns: LineColumns) {
+        self.sync(revision);
+        if self.lines.len() >= MAX_CACHED_LINES {
+            self.lines.clear();
+        }
+        self.lines.insert(line, Arc::new(columns));
+    }
+
+    /// Approximate heap bytes held by the tables
+    pub fn memory_bytes(&self) -> usize {
+        self.lines
+            .values()
+            .map(|columns| columns.memory_bytes())
+            .sum()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::util::text::{char_col_to_visual_col, visual_col_to_char_col};
+
+    /// A long line mixing tabs and multi-byte chars
+    fn long_line() -> String {
+        (0..3000)
+            .map(|i| match i % 7 {
+                0 => "\t".to_string(),
+                3 => "é".to_string(),
+                5 => "日本".to_string(),
+                _ => format!("{}", i % 10),
+            })
+            .collect()
+    }
+
+    fn chars_at<'a>(text: &'a str) -> impl Fn(ColumnCheckpoint) -> std::str::Chars<'a> + Copy {
+        move |cp| text[cp.byte..].chars()
+    }
+
+    #[test]
+    fn test_lengths_match_the_line() {
+        let text = long_line();
+        let columns = LineColumns::new(&text);
+        let chars = text.chars().count();
+        assert_eq!(columns.len_bytes(), text.len());
+        assert_eq!(columns.len_chars(), chars);
+        assert_eq!(columns.len_visual(), char_col_to_visual_col(&text, chars));
+        assert_eq!(
+            columns.checkpoints.len(),
+            chars.div_ceil(CHECKPOINT_INTERVAL)
+        );
+    }
+
+    #[test]
+    fn test_chunked_build_matches_contiguous_build() {
+        let text = long_line();
+        let split = text.char_indices().nth(1500).unwrap().0;
+        let chunks = [&text[..split], "", &text[split..]];
+        assert_eq!(LineColumns::from_chunks(chunks), LineColumns::new(&text));
+    }
+
+    #[test]
+    fn test_byte_to_char_matches_scanning_from_line_start() {
+        let text = long_line();
+        let columns = LineColumns::new(&text);
+        for byte in (0..=text.len() + 3).step_by(37) {
+            let mut valid = byte.min(text.len());
+            while !text.is_char_boundary(valid) {
+                valid -= 1;
+            }
+            assert_eq!(
+                columns.char_at_byte(&text, byte),
+                text[..valid].chars().count(),
+                "byte {byte}"
+            );
+        }
+    }
+
+    #[test]
+    fn test_visual_conversions_match_scanning_from_line_start() {
+        let text = long_line();
+        let columns = LineColumns::new(&text);
+        let chars = text.chars().count();
+        for col in (0..chars + 5).step_by(13) {
+            assert_eq!(
+                columns.visual_at_char(chars_at(&text), col),
+                char_col_to_visual_col(&text, col),
+                "char {col}"
+            );
+        }
+        for visual in (0..columns.len_visual() + 5).step_by(11) {
+            assert_eq!(
+                columns.char_at_visual(chars_at(&text), visual),
+                visual_col_to_char_col(&text, visual),
+                "visual {visual}"
+            );
+        }
+    }
+
+    #[test]
+    fn test_empty_line() {
+        let columns = LineColumns::new("");
+        assert_eq!(columns.len_chars(), 0);
+        assert_eq!(columns.char_at_byte("", 4), 0);
+        assert_eq!(columns.visual_at_char(chars_at(""), 2), 0);
+        assert_eq!(columns.char_at_visual(chars_at(""), 2), 0);
+    }
+
+    #[test]
+    fn test_cache_drops_tables_of_older_revisions() {
+        let mut cache = LineColumnCache::default();
+        cache.insert(3, 1, LineColumns::new("abc"));
+        assert!(cache.get(3, 1).is_some());
+        assert!(cache.get(3, 2).is_none());
+
+        cache.insert(5, 2, LineColumns::new("de"));
+        assert!(cache.get(3, 2).is_none());
+        assert_eq!(cache.get(5, 2).map(|c| c.len_chars()), Some(2));
+
+        cache.sync(3);
+        assert_eq!(cache.memory_bytes(), 0);
+    }
+}
@@ -9,8 +9,11 @@ use std::fs::{self, File};
 use std::io::Read;
 use std::path::Path;
 
-/// Maximum file size in bytes (50 MB)
-pub const MAX_FILE_SIZE: u64 = 50 * 1024 * 1024;
+/// Maximum file size in bytes (4 GB)
+///
+/// Files above the large-file threshold are streamed in the background, so
+/// this only guards against files that would not fit in memory at all.
+pub const MAX_FILE_SIZE: u64 = 4 * 1024 * 1024 * 1024;
 
 /// Errors that can occur when validating a file for opening
 #[derive(Debug, Clone)]
@@ -73,8 +76,10 @@ impl std::error::Error for FileOpenError {}
 /// - Has read permissions
 /// - Does not exceed size limit
 ///
+/// Returns the file size in bytes on success.
+///
 /// Does NOT check for binary content (use `is_likely_binary` separately after this passes)
-pub fn validate_file_for_opening(path: &Path) -> Result<(), FileOpenError> {
+pub fn validate_file_for_opening(path: &Path) -> Result<u64, FileOpenError> {
     let metadata = fs::metadata(path).map_err(|e| match e.kind() {
         std::io::ErrorKind::NotFound => FileOpenError::NotFound,
         std::io::ErrorKind::PermissionDenied => FileOpenError::PermissionDenied,
@@ -91,7 +96,14 @@ pub fn validate_file_for_opening(path: &Path) -> Result<(), FileOpenError> {
         });
     }
 
-    Ok(())
+    Ok(metadata.len())
+}
+
+/// Check if a file of `size` bytes should open in large-file mode
+///
+/// A threshold of 0 disables large-file mode.
+pub fn is_large_file(size: u64, threshold_mb: u64) -> bool {
+    threshold_mb > 0 && size > threshold_mb.saturating_mul(1024 * 1024)
 }
 
 /// Check if a file path has a supported image extension
@@ -106,6 +118,9 @@ pub fn is_supported_image(path: &Path) -> bool {
     )
 }
 
+/// Bytes inspected when sniffing whether content is binary
+const BINARY_SNIFF_LEN: usize = 8192;
+
 /// Check if a file is likely binary by scanning for null bytes
 ///
 /// Reads the first 8KB of the file and checks for null bytes,
@@ -118,13 +133,18 @@ pub fn is_likely_binary(path: &Path) -> bool {
         return false;
     };
 
-    let mut buffer = [0u8; 8192];
+    let mut buffer = [0u8; BINARY_SNIFF_LEN];
     let Ok(bytes_read) = file.read(&mut buffer) else {
         return false;
     };
 
-    // Check for null bytes in the read content
-    buffer[..bytes_read].contains(&0)
+    is_binary_content(&buffer[..bytes_read])
+}
+
+/// [`is_likely_binary`] for content already in memory: checks the first 8KB
+/// for null bytes
+pub fn is_binary_content(bytes: &[u8]) -> bool {
+    memchr::memchr(0, &bytes[..bytes.len().min(BINARY_SNIFF_LEN)]).is_some()
 }
 
 /// Get the filename from a path for display in error messages
@@ -160,6 +180,23 @@ mod tests {
         assert!(result.is_ok());
     }
 
+    #[test]
+    fn test_validate_returns_file_size() {
+        let mut temp = NamedTempFile::new().unwrap();
+        temp.write_all(b"Hello, world!").unwrap();
+        temp.flush().unwrap();
+
+        assert_eq!(validate_file_for_opening(temp.path()).unwrap(), 13);
+    }
+
+    #[test]
+    fn test_is_large_file() {
+        let mb = 1024 * 1024;
+        assert!(!is_large_file(16 * mb, 16));
+        assert!(is_large_file(16 * mb + 1, 16));
+        assert!(!is_large_file(10 * 1024 * mb, 0));
+    }
+
     #[test]
     fn test_is_binary_text_file() {
         let mut temp = NamedTempFile::new().unwrap();
@@ -179,6 +216,16 @@ mod tests {
         assert!(is_likely_binary(temp.path()));
     }
 
+    #[test]
+    fn test_is_binary_content_sniffs_prefix_only() {
+        assert!(!is_binary_content(b"plain text"));
+        assert!(is_binary_content(b"\x7fELF\x00\x01"));
+
+        let mut late_null = vec![b'a'; 10_000];
+        late_null.push(0);
+        assert!(!is_binary_content(&late_null));
+    }
+
     #[test]
     fn test_is_supported_image() {
         assert!(is_supported_image(Path::new("photo.png")));
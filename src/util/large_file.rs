@@ -0,0 +1,159 @@
+//! Chunked loading for large files
+//!
+//! Large files are read into a rope a chunk at a time instead of through
+//! `read_to_string`, so the peak memory is the rope plus one chunk rather than
+//! two full copies of the file. The caller gets an O(1) snapshot of the rope
+//! after every chunk, which lets the UI show the start of the file while the
+//! rest is still streaming in.
+
+use std::io::{self, Read};
+
+use ropey::Rope;
+
+/// Size of the first chunk, kept small so the first screen shows up quickly
+pub const FIRST_CHUNK_BYTES: usize = 256 * 1024;
+
+/// Size of every chunk after the first
+pub const CHUNK_BYTES: usize = 4 * 1024 * 1024;
+
+/// Read UTF-8 text from `reader` into a rope, one chunk at a time.
+///
+/// `on_chunk` is called after each chunk with the rope so far and the number
+/// of bytes consumed; returning `false` stops reading early (the partial rope
+/// is returned). Chunk boundaries never split a UTF-8 sequence or a CRLF pair.
+///
+/// Fails with `InvalidData` on malformed UTF-8, like `read_to_string`.
+pub fn read_rope_chunked<R: Read>(
+    mut reader: R,
+    mut on_chunk: impl FnMut(&Rope, u64) -> bool,
+) -> io::Result<Rope> {
+    let mut rope = Rope::new();
+    let mut buf: Vec<u8> = Vec::with_capacity(FIRST_CHUNK_BYTES);
+    let mut chunk_bytes = FIRST_CHUNK_BYTES;
+    let mut bytes_read: u64 = 0;
+
+    loop {
+        // Top the buffer up to the chunk size (it may hold a carried tail)
+        let filled = buf.len();
+        buf.resize(chunk_bytes.max(filled + 4), 0);
+        let requested = buf.len() - filled;
+        let n = read_full(&mut reader, &mut buf[filled..])?;
+        buf.truncate(filled + n);
+        let at_eof = n < requested;
+
+        // An incomplete sequence at the end is carried into the next chunk;
+        // anything else that fails to decode is an error
+        let mut split = match std::str::from_utf8(&buf) {
+            Ok(_) => buf.len(),
+            Err(e) if e.error_len().is_none() && !at_eof => e.valid_up_to(),
+            Err(e) => return Err(io::Error::new(io::ErrorKind::InvalidData, e)),
+        };
+        // Keep a trailing CR with the chunk that has its LF
+        if !at_eof && split > 0 && buf[split - 1] == b'\r' {
+            split -= 1;
+        }
+
+        if split > 0 {
+            let text = std::str::from_utf8(&buf[..split]).expect("validated UTF-8 prefix");
+            rope.append(Rope::from_str(text));
+            bytes_read += split as u64;
+            buf.drain(..split);
+        }
+
+        if at_eof {
+            on_chunk(&rope, bytes_read);
+            return Ok(rope);
+        }
+        if !on_chunk(&rope, bytes_read) {
+            return Ok(rope);
+        }
+        chunk_bytes = CHUNK_BYTES;
+    }
+}
+
+/// Fill `buf` as far as the reader allows, returning the bytes read
+fn read_full<R: Read>(reader: &mut R, buf: &mut [u8]) -> io::Result<usize> {
+    let mut total = 0;
+    while total < buf.len() {
+        match reader.read(&mut buf[total..]) {
+            Ok(0) => break,
+            Ok(n) => total += n,
+            Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(total)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Reader that hands out at most `step` bytes per call
+    struct Trickle<'a> {
+        data: &'a [u8],
+        step: usize,
+    }
+
+    impl Read for Trickle<'_> {
+        fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+            let n = self.step.min(buf.len()).min(self.data.len());
+            buf[..n].copy_from_slice(&self.data[..n]);
+            self.data = &self.data[n..];
+            Ok(n)
+        }
+    }
+
+    #[test]
+    fn test_chunked_read_matches_source() {
+        // Multibyte chars and CRLFs straddle chunk boundaries at some offset
+        let line = "héllo wörld ✓ 日本語\r\n";
+        let text = line.repeat(FIRST_CHUNK_BYTES / line.len() * 6 + 7);
+        let mut chunks = 0;
+        let rope = read_rope_chunked(
+            Trickle {
+                data: text.as_bytes(),
+                step: 7919,
+            },
+            |_, _| {
+                chunks += 1;
+                true
+            },
+        )
+        .unwrap();
+
+        assert_eq!(rope.to_string(), text);
+        assert_eq!(rope.len_lines(), Rope::from_str(&text).len_lines());
+        assert!(chunks >= 2);
+    }
+
+    #[test]
+    fn test_chunked_read_reports_progress_and_stops() {
+        let text = "x".repeat(FIRST_CHUNK_BYTES * 3);
+        let mut progress = Vec::new();
+        let rope = read_rope_chunked(text.as_bytes(), |rope, bytes| {
+            progress.push((rope.len_bytes(), bytes));
+            false
+        })
+        .unwrap();
+
+        assert_eq!(
+            progress,
+            vec![(FIRST_CHUNK_BYTES, FIRST_CHUNK_BYTES as u64)]
+        );
+        assert_eq!(rope.len_bytes(), FIRST_CHUNK_BYTES);
+    }
+
+    #[test]
+    fn test_chunked_read_rejects_invalid_utf8() {
+        let data = b"valid\xff\xfeinvalid";
+        let err = read_rope_chunked(&data[..], |_, _| true).unwrap_err();
+        assert_eq!(err.kind(), io::ErrorKind::InvalidData);
+    }
+
+    #[test]
+    fn test_chunked_read_empty() {
+        let rope = read_rope_chunked(&b""[..], |_, _| true).unwrap();
+        assert_eq!(rope.len_bytes(), 0);
+    }
+}
@@ -1,18 +1,30 @@
 //! Utility modules
 
+pub mod columns;
 pub mod file_validation;
+pub mod large_file;
+pub mod search;
 pub mod text;
 pub mod tree;
 
 // Re-export text utilities at the util level for backward compatibility
-pub use text::{char_type, is_punctuation, is_word_boundary, CharType};
+pub use text::{char_mask, char_type, is_punctuation, is_word_boundary, CharType};
+
+// Re-export long-line column tables
+pub use columns::{LineColumnCache, LineColumns, LONG_LINE_BYTES};
 
 // Re-export file validation utilities
 pub use file_validation::{
-    filename_for_display, is_likely_binary, is_supported_image, validate_file_for_opening,
-    FileOpenError, MAX_FILE_SIZE,
+    filename_for_display, is_binary_content, is_large_file, is_likely_binary, is_supported_image,
+    validate_file_for_opening, FileOpenError, MAX_FILE_SIZE,
 };
 
+// Re-export large file loading
+pub use large_file::read_rope_chunked;
+
+// Re-export document search
+pub use search::{MatchCache, MatchIndex, SearchQuery};
+
 // Re-export tree traversal utilities
 pub use tree::{
     visible_tree_count, visible_tree_index_of, visible_tree_row_at_index,
@@ -0,0 +1,830 @@
+//! Document search over rope chunks
+//!
+//! Searches run directly on the rope's chunks, so a find-all never flattens
+//! the document into a `String`. Each chunk is scanned with `memchr`'s
+//! vectorized substring search; case-insensitive ASCII queries scan for the
+//! query's first byte in either case with `memchr2` and verify candidates with
+//! an ASCII case-folding compare. Matches that straddle a chunk boundary are
+//! found in a small seam buffer holding the last few bytes before the chunk
+//! and the first few bytes of it.
+//!
+//! Char offsets come from a running count per chunk rather than a byte→char
+//! table for the whole document, and matches are reported to a callback as
+//! they are found so callers can stop early.
+//!
+//! [`MatchCache`] keeps the matches of recent queries per document and
+//! patches them on every edit, so find-all results and match counts stay
+//! current without rescanning the file.
+
+use std::ops::Range;
+
+use memchr::memmem::Finder;
+use ropey::{Rope, RopeSlice};
+
+use crate::syntax::TextEdit;
+
+/// A compiled search query
+///
+/// Matches are reported as `(start_char, end_char)` char offsets and may
+/// overlap (`"aa"` matches `"aaaa"` three times).
+#[derive(Debug, Clone)]
+pub struct SearchQuery {
+    kernel: Kernel,
+    /// Length of a match in chars
+    needle_chars: usize,
+}
+
+#[derive(Debug, Clone)]
+enum Kernel {
+    /// Byte-exact search (case-sensitive queries)
+    Exact(Finder<'static>),
+    /// ASCII case folding over bytes (case-insensitive ASCII queries)
+    AsciiFold(Vec<u8>),
+    /// Simple per-char case folding over the char stream (case-insensitive
+    /// queries containing non-ASCII chars)
+    UnicodeFold {
+        folded: Vec<char>,
+        fallback: Vec<usize>,
+    },
+}
+
+impl SearchQuery {
+    /// Compile `needle`. Returns `None` for an empty needle, which never
+    /// matches.
+    pub fn new(needle: &str, case_sensitive: bool) -> Option<Self> {
+        if needle.is_empty() {
+            return None;
+        }
+        let needle_chars = needle.chars().count();
+        let kernel = if case_sensitive {
+            Kernel::Exact(Finder::new(needle.as_bytes()).into_owned())
+        } else if needle.is_ascii() {
+            Kernel::AsciiFold(needle.as_bytes().to_ascii_lowercase())
+        } else {
+            let folded: Vec<char> = needle.chars().map(fold_char).collect();
+            let fallback = kmp_fallback(&folded);
+            Kernel::UnicodeFold { folded, fallback }
+        };
+        Some(Self {
+            kernel,
+            needle_chars,
+        })
+    }
+
+    /// Call `on_match(start_char, end_char)` for every match in document
+    /// order. Returning `false` from the callback stops the search.
+    pub fn for_each_match(&self, rope: &Rope, on_match: impl FnMut(usize, usize) -> bool) {
+        self.for_each_match_in(rope.slice(..), on_match)
+    }
+
+    /// Like [`SearchQuery::for_each_match`], with offsets relative to the
+    /// start of `text`
+    pub fn for_each_match_in(
+        &self,
+        text: RopeSlice<'_>,
+        mut on_match: impl FnMut(usize, usize) -> bool,
+    ) {
+        match &self.kernel {
+            Kernel::UnicodeFold { folded, fallback } => {
+                scan_chars(text, folded, fallback, &mut on_match)
+            }
+            _ => self.scan_chunks(text, &mut on_match),
+        }
+    }
+
+    /// Call `on_match(start_byte, end_byte)` for every match in `text`, in
+    /// order. Returning `false` from the callback stops the search.
+    pub fn for_each_match_in_str(
+        &self,
+        text: &str,
+        mut on_match: impl FnMut(usize, usize) -> bool,
+    ) {
+        match &self.kernel {
+            Kernel::UnicodeFold { folded, fallback } => {
+                scan_str_chars(text, folded, fallback, &mut on_match)
+            }
+            _ => {
+                let bytes = text.as_bytes();
+                let n = self.needle_len();
+                let mut from = 0;
+                while let Some(i) = self.find_at(bytes, from) {
+                    if !on_match(i, i + n) {
+                        return;
+                    }
+                    from = i + 1;
+                }
+            }
+        }
+    }
+
+    /// Whether `haystack` may contain a match: exact for the byte kernels,
+    /// always `true` for queries that need the char-stream kernel
+    pub fn may_match_bytes(&self, haystack: &[u8]) -> bool {
+        match &self.kernel {
+            Kernel::UnicodeFold { .. } => true,
+            _ => self.find_at(haystack, 0).is_some(),
+        }
+    }
+
+    /// Length of every match in chars
+    pub fn match_len(&self) -> usize {
+        self.needle_chars
+    }
+
+    /// Collect every match in document order
+    pub fn find_all(&self, rope: &Rope) -> Vec<(usize, usize)> {
+        let mut matches = Vec::new();
+        self.for_each_match(rope, |start, end| {
+            matches.push((start, end));
+            true
+        });
+        matches
+    }
+
+    fn needle_len(&self) -> usize {
+        match &self.kernel {
+            Kernel::Exact(finder) => finder.needle().len(),
+            Kernel::AsciiFold(folded) => folded.len(),
+            Kernel::UnicodeFold { .. } => unreachable!("char-stream kernel has no byte length"),
+        }
+    }
+
+    /// Offset of the first match at or after `from` that fits entirely in
+    /// `haystack`
+    fn find_at(&self, haystack: &[u8], from: usize) -> Option<usize> {
+        let rest = haystack.get(from..)?;
+        match &self.kernel {
+            Kernel::Exact(finder) => finder.find(rest).map(|i| from + i),
+            Kernel::AsciiFold(folded) => find_ascii_fold(rest, folded).map(|i| from + i),
+            Kernel::UnicodeFold { .. } => unreachable!("char-stream kernel has no byte search"),
+        }
+    }
+
+    /// Byte-kernel driver: scan each chunk in place, plus a seam buffer for
+    /// matches that cross into it from earlier chunks
+    fn scan_chunks(&self, text: RopeSlice<'_>, on_match: &mut impl FnMut(usize, usize) -> bool) {
+        let n = self.needle_len();
+        // Up to `n - 1` bytes preceding the current chunk: the only place a
+        // match that crosses the chunk's start can begin
+        let mut tail: Vec<u8> = Vec::with_capacity(n);
+        let mut seam: Vec<u8> = Vec::with_capacity(2 * n);
+        let mut chunk_char = 0;
+
+        for chunk in text.chunks() {
+            let bytes = chunk.as_bytes();
+
+            if !tail.is_empty() {
+                seam.clear();
+                seam.extend_from_slice(&tail);
+                seam.extend_from_slice(&bytes[..bytes.len().min(n - 1)]);
+                let mut from = 0;
+                // Anything starting at `tail.len()` or later lies inside this
+                // chunk and is found by the chunk scan below
+                while let Some(i) = self.find_at(&seam, from).filter(|&i| i < tail.len()) {
+                    let start = chunk_char - count_chars(&tail[i..]);
+                    if !on_match(start, start + self.needle_chars) {
+                        return;
+                    }
+                    from = i + 1;
+                }
+            }
+
+            let mut from = 0;
+            let mut counted_bytes = 0;
+            let mut counted_chars = chunk_char;
+            while let Some(i) = self.find_at(bytes, from) {
+                counted_chars += count_chars(&bytes[counted_bytes..i]);
+                counted_bytes = i;
+                if !on_match(counted_chars, counted_chars + self.needle_chars) {
+                    return;
+                }
+                from = i + 1;
+            }
+            chunk_char = counted_chars + count_chars(&bytes[counted_bytes..]);
+
+            let keep = n - 1;
+            if bytes.len() >= keep {
+                tail.clear();
+                tail.extend_from_slice(&bytes[bytes.len() - keep..]);
+            } else {
+                tail.extend_from_slice(bytes);
+                let excess = tail.len().saturating_sub(keep);
+                tail.drain(..excess);
+            }
+        }
+    }
+}
+
+/// Edits per batch above which a [`MatchIndex`] is dropped instead of patched
+const MAX_PATCHED_EDITS: usize = 256;
+
+/// Queries cached per document
+const MAX_CACHED_QUERIES: usize = 4;
+
+/// Matches of one query, kept current across edits
+///
+/// Match starts are stored sorted. An edit drops the matches it overlaps,
+/// rescans a window of `match_len - 1` chars either side of the new text and
+/// shifts the matches after it. The shift is applied lazily: entries from
+/// `shift_from` on still need `shift` added, so an edit with no matches
+/// nearby costs a binary search instead of a pass over every later match.
+#[derive(Debug, Clone)]
+pub struct MatchIndex {
+    query: SearchQuery,
+    needle: String,
+    case_sensitive: bool,
+    /// Match starts in chars; entries from `shift_from` on are off by `shift`
+    starts: Vec<usize>,
+    shift_from: usize,
+    shift: isize,
+    /// Document revision the matches are valid for
+    revision: u64,
+}
+
+impl MatchIndex {
+    /// Find every match of `needle` in `rope`. Returns `None` for an empty
+    /// needle.
+    pub fn build(needle: &str, case_sensitive: bool, rope: &Rope, revision: u64) -> Option<Self> {
+        let query = SearchQuery::new(needle, case_sensitive)?;
+        let mut starts = Vec::new();
+        query.for_each_match(rope, |start, _| {
+            starts.push(start);
+            true
+        });
+        Some(Self {
+            query,
+            needle: needle.to_owned(),
+            case_sensitive,
+            shift_from: starts.len(),
+            starts,
+            shift: 0,
+            revision,
+        })
+    }
+
+    /// Whether this index answers `needle` with the given case sensitivity
+    pub fn is_for(&self, needle: &str, case_sensitive: bool) -> bool {
+        self.case_sensitive == case_sensitive && self.needle == needle
+    }
+
+    /// Document revision the matches are valid for
+    pub fn revision(&self) -> u64 {
+        self.revision
+    }
+
+    /// Number of matches
+    pub fn len(&self) -> usize {
+        self.starts.len()
+    }
+
+    /// Whether there are no matches
+    pub fn is_empty(&self) -> bool {
+        self.starts.is_empty()
+    }
+
+    fn start(&self, i: usize) -> usize {
+        if i >= self.shift_from {
+            self.starts[i].wrapping_add_signed(self.shift)
+        } else {
+            self.starts[i]
+        }
+    }
+
+    /// The `i`th match as `(start_char, end_char)`
+    pub fn get(&self, i: usize) -> Option<(usize, usize)> {
+        (i < self.starts.len()).then(|| {
+            let start = self.start(i);
+            (start, start + self.query.match_len())
+        })
+    }
+
+    /// All matches in document order
+    pub fn iter(&self) -> impl Iterator<Item = (usize, usize)> + '_ {
+        (0..self.starts.len()).map(|i| {
+            let start = self.start(i);
+            (start, start + self.query.match_len())
+        })
+    }
+
+    /// All matches in document order
+    pub fn to_vec(&self) -> Vec<(usize, usize)> {
+        self.iter().collect()
+    }
+
+    /// First match starting after `offset`, wrapping around to the first
+    /// match
+    pub fn next_after(&self, offset: usize) -> Option<(usize, usize)> {
+        self.get(self.lower_bound(offset.saturating_add(1)))
+            .or_else(|| self.get(0))
+    }
+
+    /// Last match starting before `offset`, wrapping around to the last match
+    pub fn prev_before(&self, offset: usize) -> Option<(usize, usize)> {
+        match self.lower_bound(offset) {
+            0 => self.len().checked_sub(1).and_then(|i| self.get(i)),
+            i => self.get(i - 1),
+        }
+    }
+
+    /// Index of the first match starting at or after `offset`
+    fn lower_bound(&self, offset: usize) -> usize {
+        let (exact, shifted) = self.starts.split_at(self.shift_from);
+        let i = exact.partition_point(|&s| s < offset);
+        if i < exact.len() {
+            return i;
+        }
+        let shift = self.shift;
+        self.shift_from + shifted.partition_point(|&s| s.wrapping_add_signed(shift) < offset)
+    }
+
+    /// Move the lazy shift boundary to `at`, applying the shift to the
+    /// entries in between
+    fn rebase_shift(&mut self, at: usize) {
+        if at > self.shift_from {
+            for s in &mut self.starts[self.shift_from..at] {
+                *s = s.wrapping_add_signed(self.shift);
+            }
+        } else {
+            for s in &mut self.starts[at..self.shift_from] {
+                *s = s.wrapping_add_signed(-self.shift);
+            }
+        }
+        self.shift_from = at;
+    }
+
+    /// Bring the index from `revision_before` to `revision_after`, where
+    /// `rope` is the text after all of `edits` (applied in order).
+    ///
+    /// Returns `false` if the index can't be patched (it is for another
+    /// revision, or the batch is too large) and should be dropped.
+    pub fn apply_edits(
+        &mut self,
+        rope: &Rope,
+        revision_before: u64,
+        revision_after: u64,
+        edits: &[TextEdit],
+    ) -> bool {
+        if self.revision != revision_before || edits.len() > MAX_PATCHED_EDITS {
+            return false;
+        }
+
+        // A match overlapping an edit starts at most `reach` chars before it
+        let reach = self.query.match_len() - 1;
+        // Where new matches may start, in the coordinates of the latest edit
+        let mut windows: Vec<Range<usize>> = Vec::with_capacity(edits.len());
+
+        for edit in edits {
+            let start = edit.start_char;
+            let old_end = edit.old_end_char;
+            let new_end = start + edit.text.chars().count();
+            let delta = new_end as isize - old_end as isize;
+
+            for window in &mut windows {
+                if window.start >= old_end {
+                    window.start = window.start.wrapping_add_signed(delta);
+                    window.end = window.end.wrapping_add_signed(delta);
+                } else if window.end > start {
+                    let end = if window.end > old_end {
+                        window.end.wrapping_add_signed(delta)
+                    } else {
+                        new_end
+                    };
+                    window.start = window.start.min(start);
+                    window.end = end.max(new_end);
+                }
+            }
+
+            let lo = self.lower_bound(start.saturating_sub(reach));
+            let hi = self.lower_bound(old_end);
+            self.rebase_shift(hi);
+            self.starts.drain(lo..hi);
+            self.shift_from = lo;
+            self.shift += delta;
+
+            windows.push(start.saturating_sub(reach)..new_end + reach);
+        }
+
+        windows.sort_by_key(|window| window.start);
+        let len = rope.len_chars();
+        let mut merged: Vec<Range<usize>> = Vec::with_capacity(windows.len());
+        for window in windows {
+            let window = window.start.min(len)..window.end.min(len);
+            match merged.last_mut() {
+                Some(last) if window.start <= last.end => last.end = last.end.max(window.end),
+                _ => merged.push(window),
+            }
+        }
+
+        // Back to front, so splicing never moves the matches of an earlier
+        // window. Matches already starting inside a window are replaced too,
+        // which keeps merged windows from reporting them twice.
+        for window in merged.into_iter().rev() {
+            let mut found = Vec::new();
+            self.query
+                .for_each_match_in(rope.slice(window.clone()), |start, _| {
+                    found.push(window.start + start);
+                    true
+                });
+            let lo = self.lower_bound(window.start);
+            let hi = self.lower_bound((window.end + 1).saturating_sub(self.query.match_len()));
+            let hi = hi.max(lo);
+            self.rebase_shift(hi);
+            self.starts.splice(lo..hi, found.iter().copied());
+            self.shift_from = lo + found.len();
+        }
+
+        self.revision = revision_after;
+        true
+    }
+}
+
+/// Per-document [`MatchIndex`]es for the most recent queries
+#[derive(Debug, Clone, Default)]
+pub struct MatchCache {
+    /// Least recently used first
+    entries: Vec<MatchIndex>,
+}
+
+impl MatchCache {
+    /// The index for `needle` if it is current for `revision`
+    pub fn get(&self, needle: &str, case_sensitive: bool, revision: u64) -> Option<&MatchIndex> {
+        self.entries
+            .iter()
+            .find(|entry| entry.is_for(needle, case_sensitive) && entry.revision == revision)
+    }
+
+    /// The index for `needle`, searching `rope` if it isn't cached. Returns
+    /// `None` for an empty needle.
+    pub fn get_or_build(
+        &mut self,
+        needle: &str,
+        case_sensitive: bool,
+        rope: &Rope,
+        revision: u64,
+    ) -> Option<&MatchIndex> {
+        let cached = self
+            .entries
+            .iter()
+            .position(|entry| entry.is_for(needle, case_sensitive));
+        let entry = match cached {
+            Some(i) if self.entries[i].revision == revision => self.entries.remove(i),
+            _ => {
+                let entry = MatchIndex::build(needle, case_sensitive, rope, revision)?;
+                if let Some(i) = cached {
+                    self.entries.remove(i);
+                } else if self.entries.len() >= MAX_CACHED_QUERIES {
+                    self.entries.remove(0);
+                }
+                entry
+            }
+        };
+        self.entries.push(entry);
+        self.entries.last()
+    }
+
+    /// Patch every cached index for an edit batch, dropping the ones that
+    /// can't be patched
+    pub fn apply_edits(
+        &mut self,
+        rope: &Rope,
+        revision_before: u64,
+        revision_after: u64,
+        edits: &[TextEdit],
+    ) {
+        self.entries
+            .retain_mut(|entry| entry.apply_edits(rope, revision_before, revision_after, edits));
+    }
+
+    /// Drop every cached index
+    pub fn clear(&mut self) {
+        self.entries.clear();
+    }
+}
+
+/// Find `folded` (lowercase ASCII) in `haystack`, ignoring ASCII case
+fn find_ascii_fold(haystack: &[u8], folded: &[u8]) -> Option<usize> {
+    let first = folded[0];
+    let upper = first.to_ascii_uppercase();
+    let mut pos = 0;
+    loop {
+        let rest = &haystack[pos..];
+        let candidate = if upper != first {
+            memchr::memchr2(first, upper, rest)
+        } else {
+            memchr::memchr(first, rest)
+        }?;
+        let start = pos + candidate;
+        let end = start + folded.len();
+        // Later candidates can't fit either
+        if end > haystack.len() {
+            return None;
+        }
+        if haystack[start..end].eq_ignore_ascii_case(folded) {
+            return Some(start);
+        }
+        pos = start + 1;
+    }
+}
+
+/// Number of chars in a run of UTF-8 bytes (counts non-continuation bytes;
+/// the loop vectorizes)
+fn count_chars(bytes: &[u8]) -> usize {
+    bytes.iter().filter(|&&b| (b & 0xC0) != 0x80).count()
+}
+
+/// Simple case folding: the lowercase form when it is a single char
+fn fold_char(c: char) -> char {
+    let mut lower = c.to_lowercase();
+    match (lower.next(), lower.next()) {
+        (Some(folded), None) => folded,
+        _ => c,
+    }
+}
+
+/// KMP failure table: `fallback[i]` is the length of the longest proper
+/// prefix of `pattern[..=i]` that is also a suffix of it
+fn kmp_fallback(pattern: &[char]) -> Vec<usize> {
+    let mut fallback = vec![0; pattern.len()];
+    let mut k = 0;
+    for i in 1..pattern.len() {
+        while k > 0 && pattern[i] != pattern[k] {
+            k = fallback[k - 1];
+        }
+        if pattern[i] == pattern[k] {
+            k += 1;
+        }
+        fallback[i] = k;
+    }
+    fallback
+}
+
+/// Char-stream driver for non-ASCII case-insensitive queries: a single KMP
+/// pass over folded chars
+fn scan_chars(
+    text: RopeSlice<'_>,
+    folded: &[char],
+    fallback: &[usize],
+    on_match: &mut impl FnMut(usize, usize) -> bool,
+) {
+    let mut matched = 0;
+    for (idx, c) in text.chars().enumerate() {
+        let c = fold_char(c);
+        while matched > 0 && folded[matched] != c {
+            matched = fallback[matched - 1];
+        }
+        if folded[matched] == c {
+            matched += 1;
+        }
+        if matched == folded.len() {
+            if !on_match(idx + 1 - folded.len(), idx + 1) {
+                return;
+            }
+            matched = fallback[matched - 1];
+        }
+    }
+}
+
+/// [`scan_chars`] over a `&str`, reporting byte offsets. A match spans
+/// exactly `folded.len()` chars (folding maps char to char), so the byte
+/// offsets of the last that many chars locate its start.
+fn scan_str_chars(
+    text: &str,
+    folded: &[char],
+    fallback: &[usize],
+    on_match: &mut impl FnMut(usize, usize) -> bool,
+) {
+    let mut starts = std::collections::VecDeque::with_capacity(folded.len());
+    let mut matched = 0;
+    for (offset, c) in text.char_indices() {
+        if starts.len() == folded.len() {
+            starts.pop_front();
+        }
+        starts.push_back(offset);
+        let end = offset + c.len_utf8();
+        let c = fold_char(c);
+        while matched > 0 && folded[matched] != c {
+            matched = fallback[matched - 1];
+        }
+        if folded[matched] == c {
+            matched += 1;
+        }
+        if matched == folded.len() {
+            if !on_match(starts[0], end) {
+                return;
+            }
+            matched = fallback[matched - 1];
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn find(text: &str, needle: &str, case_sensitive: bool) -> Vec<(usize, usize)> {
+        SearchQuery::new(needle, case_sensitive)
+            .map(|q| q.find_all(&Rope::from_str(text)))
+            .unwrap_or_default()
+    }
+
+    /// Reference: char-by-char comparison against the whole string
+    fn reference(text: &str, needle: &str, case_sensitive: bool) -> Vec<(usize, usize)> {
+        let fold = |c: char| if case_sensitive { c } else { fold_char(c) };
+        let hay: Vec<char> = text.chars().map(fold).collect();
+        let pat: Vec<char> = needle.chars().map(fold).collect();
+        if pat.is_empty() || pat.len() > hay.len() {
+            return Vec::new();
+        }
+        (0..=hay.len() - pat.len())
+            .filter(|&i| hay[i..i + pat.len()] == pat[..])
+            .map(|i| (i, i + pat.len()))
+            .collect()
+    }
+
+    #[test]
+    fn test_empty_needle_never_matches() {
+        assert!(SearchQuery::new("", true).is_none());
+        assert!(find("abc", "", false).is_empty());
+    }
+
+    #[test]
+    fn test_overlapping_matches() {
+        assert_eq!(find("aaaa", "aa", true), vec![(0, 2), (1, 3), (2, 4)]);
+        assert_eq!(find("ababa", "aba", true), vec![(0, 3), (2, 5)]);
+        assert_eq!(find("AaAa", "aa", false), vec![(0, 2), (1, 3), (2, 4)]);
+    }
+
+    #[test]
+    fn test_ascii_case_folding() {
+        assert_eq!(
+            find("Hello HELLO hello", "hELLo", false),
+            vec![(0, 5), (6, 11), (12, 17)]
+        );
+        // Non-letter first byte
+        assert_eq!(find("x_Y x_y", "_y", false), vec![(1, 3), (5, 7)]);
+    }
+
+    #[test]
+    fn test_unicode_offsets_are_in_chars() {
+        assert_eq!(find("αβγ αβγ", "β", true), vec![(1, 2), (5, 6)]);
+        assert_eq!(find("hello 🎉 world 🎉", "world", false), vec![(8, 13)]);
+        assert_eq!(find("Ößer ößer", "ÖSER", false), Vec::new());
+        assert_eq!(find("Ößer ößer", "ößer", false), vec![(0, 4), (5, 9)]);
+    }
+
+    #[test]
+    fn test_matches_across_chunk_boundaries() {
+        // Long enough for many rope chunks, with needles of several lengths
+        // landing on every possible offset relative to chunk boundaries
+        let line = "fn héllo_wörld(x: u32) -> u32 { x * 2 } // ÄÖÜ 日本語\n";
+        let text = line.repeat(400);
+        let rope = Rope::from_str(&text);
+        assert!(rope.chunks().count() > 10);
+
+        for needle in [
+            "x",
+            "u32",
+            "wörld",
+            "} // ä",
+            "日本語\nfn h",
+            "HÉLLO_W",
+            &line[3..],
+        ] {
+            for case_sensitive in [true, false] {
+                assert_eq!(
+                    find(&text, needle, case_sensitive),
+                    reference(&text, needle, case_sensitive),
+                    "needle {:?}, case_sensitive {}",
+                    needle,
+                    case_sensitive
+                );
+            }
+        }
+    }
+
+    #[test]
+    fn test_needle_longer_than_chunk() {
+        let text = "abcdefghij".repeat(2000);
+        let needle = &text[3..3 + 2500];
+        assert_eq!(find(&text, needle, true), reference(&text, needle, true));
+        let upper = needle.to_uppercase();
+        assert_eq!(find(&text, &upper, false), reference(&text, &upper, false));
+    }
+
+    #[test]
+    fn test_callback_can_stop_early() {
+        let query = SearchQuery::new("ab", true).unwrap();
+        let rope = Rope::from_str(&"ab ".repeat(1000));
+        let mut seen = Vec::new();
+        query.for_each_match(&rope, |start, _| {
+            seen.push(start);
+            seen.len() < 3
+        });
+        assert_eq!(seen, vec![0, 3, 6]);
+    }
+
+    #[test]
+    fn test_str_matches_are_byte_offsets() {
+        let text = "fn héllo() { HÉLLO } // héllo";
+        for (needle, case_sensitive) in [("héllo", true), ("HÉLLO", false), ("hél", false)] {
+            let query = SearchQuery::new(needle, case_sensitive).unwrap();
+            let mut by_bytes = Vec::new();
+            query.for_each_match_in_str(text, |start, end| {
+                by_bytes.push(text[..start].chars().count()..text[..end].chars().count());
+                true
+            });
+            let by_chars: Vec<_> = find(text, needle, case_sensitive)
+                .into_iter()
+                .map(|(start, end)| start..end)
+                .collect();
+            assert_eq!(by_bytes, by_chars, "needle {:?}", needle);
+        }
+
+        let query = SearchQuery::new("zzz", false).unwrap();
+        assert!(!query.may_match_bytes(text.as_bytes()));
+        assert!(SearchQuery::new("Héllo", false)
+            .unwrap()
+            .may_match_bytes(b"none"));
+    }
+
+    /// Apply `edits` in order, the way `Document::record_buffer_edits` sees
+    /// them
+    fn apply(rope: &mut Rope, edits: &[TextEdit]) {
+        for edit in edits {
+            rope.remove(edit.start_char..edit.old_end_char);
+            rope.insert(edit.start_char, &edit.text);
+        }
+    }
+
+    #[test]
+    fn test_match_index_tracks_edits() {
+        let base = "let foo = fo; foofoo\nFOO ô Foo\n".repeat(50);
+        let texts = ["", "f", "o", "foo", "x\n", "FOO", "ô"];
+        for (needle, case_sensitive) in [("foo", true), ("FO", false), ("o", true), ("fÔ", false)]
+        {
+            let query = SearchQuery::new(needle, case_sensitive).unwrap();
+            let mut rope = Rope::from_str(&base);
+            let mut index = MatchIndex::build(needle, case_sensitive, &rope, 0).unwrap();
+            let mut seed = 0x2545_f491_4f6c_dd1du64;
+            for revision in 0..400 {
+                // Batches of up to three edits, like multi-cursor typing
+                let mut edits = Vec::new();
+                for _ in 0..=(revision % 3) {
+                    seed ^= seed << 13;
+                    seed ^= seed >> 7;
+                    seed ^= seed << 17;
+                    let len = rope.len_chars();
+                    let start = (seed >> 32) as usize % (len + 1);
+                    let removed = ((seed >> 8) as usize % 5).min(len - start);
+                    let edit =
+                        TextEdit::replace(start, removed, texts[seed as usize % texts.len()]);
+                    apply(&mut rope, std::slice::from_ref(&edit));
+                    edits.push(edit);
+                }
+
+                assert!(index.apply_edits(&rope, revision, revision + 1, &edits));
+                assert_eq!(
+                    index.to_vec(),
+                    query.find_all(&rope),
+                    "needle {:?} after revision {}",
+                    needle,
+                    revision
+                );
+            }
+        }
+    }
+
+    #[test]
+    fn test_match_index_next_and_prev_wrap() {
+        let rope = Rope::from_str("ab ab ab");
+        let index = MatchIndex::build("ab", true, &rope, 0).unwrap();
+        assert_eq!(index.next_after(0), Some((3, 5)));
+        assert_eq!(index.next_after(6), Some((0, 2)));
+        assert_eq!(index.prev_before(3), Some((0, 2)));
+        assert_eq!(index.prev_before(0), Some((6, 8)));
+        assert_eq!(index.len(), 3);
+    }
+
+    #[test]
+    fn test_match_cache_drops_stale_indexes() {
+        let mut rope = Rope::from_str("abc abc");
+        let mut cache = MatchCache::default();
+        assert_eq!(
+            cache
+                .get_or_build("abc", true, &rope, 0)
+                .map(MatchIndex::len),
+            Some(2)
+        );
+        assert!(cache.get_or_build("", true, &rope, 0).is_none());
+
+        let edit = TextEdit::insert(3, " abc");
+        apply(&mut rope, std::slice::from_ref(&edit));
+        cache.apply_edits(&rope, 0, 1, std::slice::from_ref(&edit));
+        assert_eq!(cache.get("abc", true, 1).map(MatchIndex::len), Some(3));
+
+        // An edit from a revision the index never saw can't be patched
+        cache.apply_edits(&rope, 5, 6, &[TextEdit::delete(0, 1)]);
+        assert!(cache.get("abc", true, 1).is_none());
+        assert!(cache.get("abc", true, 6).is_none());
+    }
+}
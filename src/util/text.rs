@@ -37,6 +37,24 @@ pub fn is_punctuation(ch: char) -> bool {
     )
 }
 
+/// Bitmask of the characters in `text`, case-insensitive, for rejecting
+/// fuzzy-match candidates early: a candidate can only match a query whose
+/// mask is a subset of its own.
+///
+/// Letters and digits get a bit each; other ASCII characters share the
+/// remaining bits, and all non-ASCII characters share the top one.
+pub fn char_mask(text: &str) -> u64 {
+    text.chars().fold(0, |mask, ch| {
+        let bit = match ch.to_ascii_lowercase() {
+            c @ 'a'..='z' => c as u32 - 'a' as u32,
+            c @ '0'..='9' => 26 + c as u32 - '0' as u32,
+            c if c.is_ascii() => 36 + c as u32 % 27,
+            _ => 63,
+        };
+        mask | 1 << bit
+    })
+}
+
 /// Character type for word navigation (IntelliJ-style)
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub enum CharType {
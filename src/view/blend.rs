@@ -0,0 +1,152 @@
+//! Row kernels for frame compositing
+//!
+//! Solid fills, constant-color blends (rect overlays, whole-frame dim) and
+//! glyph coverage blits run a row at a time over `&mut [u32]` spans instead of
+//! going through the bounds- and clip-checked per-pixel `Frame` methods.
+//!
+//! The kernels are plain safe Rust over fixed-width lane chunks with no
+//! data-dependent branches, which LLVM turns into the target's SIMD (SSE2 on
+//! x86_64, NEON on aarch64; AVX2 with `-C target-cpu=native`). Every lane does
+//! exactly the f32 arithmetic of [`blend_colors`](super::frame::blend_colors)
+//! in the same order, so results are bit-identical to the per-pixel path.
+
+/// Pixels per chunk; wide enough for two SSE2/NEON or one AVX2 register
+const LANES: usize = 8;
+
+/// Fill a row span with a solid color
+#[inline]
+pub fn fill_row(row: &mut [u32], color: u32) {
+    row.fill(color);
+}
+
+/// Blend `color` over every pixel of a row span with a constant `alpha`
+///
+/// Matches `blend_colors(pixel, color, alpha)` per pixel.
+#[inline]
+pub fn blend_row(row: &mut [u32], color: u32, alpha: f32) {
+    let inv = 1.0 - alpha;
+    let fg = [
+        ((color >> 16) & 0xFF) as f32 * alpha,
+        ((color >> 8) & 0xFF) as f32 * alpha,
+        (color & 0xFF) as f32 * alpha,
+    ];
+
+    let mut chunks = row.chunks_exact_mut(LANES);
+    for chunk in &mut chunks {
+        for px in chunk.iter_mut() {
+            *px = blend_scaled(*px, inv, fg);
+        }
+    }
+    for px in chunks.into_remainder() {
+        *px = blend_scaled(*px, inv, fg);
+    }
+}
+
+/// Blend `color` over a row span using per-pixel 8-bit coverage
+///
+/// Matches `blend_colors(pixel, color, coverage / 255.0)` for every nonzero
+/// coverage value; pixels with zero coverage are left untouched. Only the
+/// shorter of `row` and `coverage` is processed.
+#[inline]
+pub fn blend_coverage_row(row: &mut [u32], coverage: &[u8], color: u32) {
+    let len = row.len().min(coverage.len());
+    let (row, coverage) = (&mut row[..len], &coverage[..len]);
+    let fg = [
+        ((color >> 16) & 0xFF) as f32,
+        ((color >> 8) & 0xFF) as f32,
+        (color & 0xFF) as f32,
+    ];
+
+    let mut rows = row.chunks_exact_mut(LANES);
+    let mut covs = coverage.chunks_exact(LANES);
+    for (chunk, cov) in (&mut rows).zip(&mut covs) {
+        for (px, &c) in chunk.iter_mut().zip(cov) {
+            *px = blend_coverage(*px, c, fg);
+        }
+    }
+    for (px, &c) in rows.into_remainder().iter_mut().zip(covs.remainder()) {
+        *px = blend_coverage(*px, c, fg);
+    }
+}
+
+/// `blend_colors` with the foreground already multiplied by alpha
+#[inline(always)]
+fn blend_scaled(bg: u32, inv: f32, fg: [f32; 3]) -> u32 {
+    let r = (((bg >> 16) & 0xFF) as f32 * inv + fg[0]) as u32;
+    let g = (((bg >> 8) & 0xFF) as f32 * inv + fg[1]) as u32;
+    let b = ((bg & 0xFF) as f32 * inv + fg[2]) as u32;
+    0xFF000000 | (r << 16) | (g << 8) | b
+}
+
+#[inline(always)]
+fn blend_coverage(bg: u32, coverage: u8, fg: [f32; 3]) -> u32 {
+    let alpha = coverage as f32 / 255.0;
+    let inv = 1.0 - alpha;
+    let r = (((bg >> 16) & 0xFF) as f32 * inv + fg[0] * alpha) as u32;
+    let g = (((bg >> 8) & 0xFF) as f32 * inv + fg[1] * alpha) as u32;
+    let b = ((bg & 0xFF) as f32 * inv + fg[2] * alpha) as u32;
+    let blended = 0xFF000000 | (r << 16) | (g << 8) | b;
+    if coverage == 0 {
+        bg
+    } else {
+        blended
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::view::frame::blend_colors;
+
+    /// Deterministic pixels with varied channels and alpha bytes
+    fn pixels(len: usize, seed: u32) -> Vec<u32> {
+        (0..len as u32)
+            .map(|i| (i.wrapping_mul(2_654_435_761) ^ seed).rotate_left(i % 29))
+            .collect()
+    }
+
+    #[test]
+    fn test_blend_row_matches_blend_colors() {
+        for len in [0, 1, 7, 8, 9, 31, 100] {
+            for (color, alpha_byte) in [(0x80336699, 0x80), (0xFFFFFFFF, 1), (0x00ABCDEF, 254)] {
+                let alpha = alpha_byte as f32 / 255.0;
+                let mut row = pixels(len, color);
+                let expected: Vec<u32> = row
+                    .iter()
+                    .map(|&bg| blend_colors(bg, color, alpha))
+                    .collect();
+                blend_row(&mut row, color, alpha);
+                assert_eq!(row, expected, "len {} color {:08x}", len, color);
+            }
+        }
+    }
+
+    #[test]
+    fn test_blend_coverage_row_matches_blend_colors() {
+        // Every coverage value, at lengths that exercise the remainder
+        for len in [5, 8, 13, 256, 300] {
+            let coverage: Vec<u8> = (0..len).map(|i| (i * 37 % 256) as u8).collect();
+            let mut row = pixels(len, 0x1234_5678);
+            let expected: Vec<u32> = row
+                .iter()
+                .zip(&coverage)
+                .map(|(&bg, &c)| {
+                    if c > 0 {
+                        blend_colors(bg, 0xFFCDD6F4, c as f32 / 255.0)
+                    } else {
+                        bg
+                    }
+                })
+                .collect();
+            blend_coverage_row(&mut row, &coverage, 0xFFCDD6F4);
+            assert_eq!(row, expected, "len {}", len);
+        }
+    }
+
+    #[test]
+    fn test_blend_coverage_row_stops_at_shorter_input() {
+        let mut row = vec![0xFF000000; 4];
+        blend_coverage_row(&mut row, &[255, 255], 0xFFFFFFFF);
+        assert_eq!(row, vec![0xFFFFFFFF, 0xFFFFFFFF, 0xFF000000, 0xFF000000]);
+    }
+}
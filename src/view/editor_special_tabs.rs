@@ -1,28 +1,66 @@
 //! Non-text editor tab rendering.
 
+use std::collections::hash_map::DefaultHasher;
+use std::hash::{Hash, Hasher};
+
 use crate::model::editor::BinaryPlaceholderState;
 use crate::model::AppModel;
 
 use super::frame::{Frame, TextPainter};
+use super::line_cache::LineRenderCache;
 use super::{button, geometry};
 
 /// Render an image viewer tab.
+///
+/// The rendered viewport is kept in `cache` and copied back while the image,
+/// its zoom and pan, and the viewport size stay the same, so frames that only
+/// redraw other parts of the window don't resample the image. A view is only
+/// stored once it repeats from the previous frame, so a zoom or pan in
+/// progress doesn't copy out a viewport it will never reuse.
 pub fn render_image_tab(
     frame: &mut Frame,
     model: &AppModel,
     img_state: &crate::image::ImageState,
     layout: &geometry::GroupLayout,
+    cache: Option<&mut LineRenderCache>,
 ) {
     let content_rect = layout.content_rect;
-    crate::image::render::render_image(
-        frame,
-        img_state,
-        &model.theme.image_preview,
-        content_rect.x as usize,
-        content_rect.y as usize,
-        content_rect.width as usize,
-        content_rect.height as usize,
-    );
+    let (x, y) = (content_rect.x as usize, content_rect.y as usize);
+    let (width, height) = (content_rect.width as usize, content_rect.height as usize);
+    let theme = &model.theme.image_preview;
+
+    // The placeholder shown while decoding is cheap and short-lived
+    let key = img_state.mips().map(|chain| {
+        let mut hasher = DefaultHasher::new();
+        "image-viewport".hash(&mut hasher);
+        chain.id().hash(&mut hasher);
+        chain.level(img_state.scale).0.hash(&mut hasher);
+        img_state.scale.to_bits().hash(&mut hasher);
+        img_state.offset_x.to_bits().hash(&mut hasher);
+        img_state.offset_y.to_bits().hash(&mut hasher);
+        (width, height).hash(&mut hasher);
+        theme.checkerboard_light.to_argb_u32().hash(&mut hasher);
+        theme.checkerboard_dark.to_argb_u32().hash(&mut hasher);
+        theme.checkerboard_size.hash(&mut hasher);
+        hasher.finish()
+    });
+
+    let mut cache = cache.zip(key);
+    if let Some((cache, key)) = &mut cache {
+        if cache.blit(*key, frame, x, y, width, height) {
+            cache.mark_drawn(x, y, *key);
+            return;
+        }
+    }
+
+    crate::image::render::render_image(frame, img_state, theme, x, y, width, height);
+
+    if let Some((cache, key)) = cache {
+        if cache.drawn_at(x, y) == Some(key) {
+            cache.store(key, frame, x, y, width, height);
+        }
+        cache.mark_drawn(x, y, key);
+    }
 }
 
 /// Render a binary file placeholder tab.
@@ -92,7 +130,8 @@ pub fn render_binary_placeholder(
     );
 }
 
-fn format_file_size(bytes: u64) -> String {
+/// Size in B, KB, MB or GB, e.g. "1.5 KB"
+pub fn format_file_size(bytes: u64) -> String {
     if bytes < 1024 {
         format!("{} B", bytes)
     } else if bytes < 1024 * 1024 {
@@ -114,6 +153,7 @@ mod tests {
     use crate::update::update;
     use crate::view::frame::Frame;
     use crate::view::geometry::GroupLayout;
+    use crate::view::line_cache::LineRenderCache;
 
     fn make_image_model(content_width: u32, content_height: u32) -> AppModel {
         let mut model = AppModel::new(content_width, content_height, 1.0, vec![]);
@@ -151,6 +191,13 @@ mod tests {
     }
 
     fn render_image_buffer(model: &AppModel) -> Vec<u32> {
+        render_image_buffer_cached(model, None)
+    }
+
+    fn render_image_buffer_cached(
+        model: &AppModel,
+        cache: Option<&mut LineRenderCache>,
+    ) -> Vec<u32> {
         let width = model.window_size.0 as usize;
         let height = model.window_size.1 as usize;
         let mut buffer = vec![0; width * height];
@@ -169,7 +216,7 @@ mod tests {
             .unwrap();
         let layout = GroupLayout::new(group, model, 8.0);
 
-        render_image_tab(&mut frame, model, image, &layout);
+        render_image_tab(&mut frame, model, image, &layout, cache);
         buffer
     }
 
@@ -249,6 +296,55 @@ mod tests {
         );
     }
 
+    #[test]
+    fn image_tab_viewport_is_cached_until_zoom_changes() {
+        let mut model = make_image_model(80, 60);
+        let mut cache = LineRenderCache::new();
+        let uncached = render_image_buffer(&model);
+
+        let first = render_image_buffer_cached(&model, Some(&mut cache));
+        assert!(cache.is_empty(), "a view seen once must not be stored yet");
+        let second = render_image_buffer_cached(&model, Some(&mut cache));
+        assert_eq!(cache.len(), 1);
+        let third = render_image_buffer_cached(&model, Some(&mut cache));
+        assert_eq!(cache.len(), 1, "unchanged viewport must be reused");
+        assert_eq!(cache.take_stats(), (1, 2));
+        assert_eq!(first, uncached);
+        assert_eq!(second, uncached);
+        assert_eq!(third, uncached);
+
+        update(
+            &mut model,
+            Msg::Image(ImageMsg::Zoom {
+                delta: 1.0,
+                mouse_x: 40.0,
+                mouse_y: model.metrics.tab_bar_height as f64 + 30.0,
+            }),
+        );
+        let zoomed = render_image_buffer_cached(&model, Some(&mut cache));
+        assert_eq!(cache.len(), 1, "a view mid-zoom must not be stored");
+        assert_eq!(zoomed, render_image_buffer(&model));
+        render_image_buffer_cached(&model, Some(&mut cache));
+        assert_eq!(cache.len(), 2);
+    }
+
+    #[test]
+    fn image_tab_shows_placeholder_while_decoding() {
+        let mut model = make_image_model(80, 60);
+        model.editor_mut().view_mode =
+            ViewMode::Image(Box::new(ImageState::loading(8, 8, 0, "PNG".into(), 80, 60)));
+        let mut cache = LineRenderCache::new();
+        let buffer = render_image_buffer_cached(&model, Some(&mut cache));
+        assert!(cache.is_empty(), "placeholder must not be cached");
+
+        // The image is centered at 100%, so its middle pixel is placeholder
+        let width = model.window_size.0 as usize;
+        let top = model.metrics.tab_bar_height;
+        let dark = model.theme.image_preview.checkerboard_dark.to_argb_u32();
+        assert_eq!(buffer[(top + 30) * width + 40], dark);
+        assert_eq!(buffer[(top + 30) * width + 41], dark);
+    }
+
     #[test]
     fn binary_placeholder_hover_is_scoped_to_its_own_group() {
         use crate::model::editor::BinaryPlaceholderState;
@@ -1,13 +1,19 @@
 //! Text editor content rendering (text area, gutter, cursors).
 
+use std::borrow::Cow;
+use std::collections::hash_map::DefaultHasher;
+use std::hash::{Hash, Hasher};
+use std::sync::Arc;
 #[cfg(debug_assertions)]
 use std::time::{Duration, Instant};
 
 use crate::model::editor::Selection;
-use crate::model::{AppModel, Document, EditorState, TextViewportMap};
+use crate::model::{AppModel, Document, EditorState, Rect, TextViewportMap};
 use crate::perf::{PerfStage, PerfStats};
+use crate::util::columns::{advance_visual, ColumnCheckpoint};
+use crate::util::LineColumns;
 
-use super::frame::{Frame, TextPainter};
+use super::frame::{push_style_runs, Frame, StyleRun, TextPainter};
 use super::geometry::{self, char_col_to_visual_col, column_to_pixel_x, expand_tabs_for_display};
 
 /// Cursor width in pixels.
@@ -16,7 +22,7 @@ const CURSOR_WIDTH: usize = 2;
 const CURSOR_INSET: usize = 1;
 
 /// Shared theme colors for text editor rendering.
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, Hash)]
 struct EditorPalette {
     background: u32,
     current_line: u32,
@@ -139,7 +145,11 @@ impl EditorRenderContext {
 /// Reused buffers for syntax-highlighted text line rendering.
 struct EditorTextBuffers {
     adjusted_tokens: Vec<crate::syntax::HighlightToken>,
+    /// `adjusted_tokens` grouped into colored runs for drawing
+    style_runs: Vec<StyleRun>,
     display_text: String,
+    /// Visual column of each char of a long line's visible window
+    window_visual_cols: Vec<usize>,
     selection_spans: Vec<(usize, usize)>,
     bracket_visual_cols: [Option<usize>; 2],
 }
@@ -148,7 +158,9 @@ impl EditorTextBuffers {
     fn new(max_chars: usize) -> Self {
         Self {
             adjusted_tokens: Vec::with_capacity(32),
+            style_runs: Vec::with_capacity(32),
             display_text: String::with_capacity(max_chars + 16),
+            window_visual_cols: Vec::new(),
             selection_spans: Vec::with_capacity(8),
             bracket_visual_cols: [None, None],
         }
@@ -164,6 +176,55 @@ struct VisibleTextLine {
     y: usize,
     height: usize,
     is_active_line: bool,
+    /// Column table when the line is long, so its columns are located
+    /// without scanning from the start of the line
+    columns: Option<Arc<LineColumns>>,
+}
+
+/// A visible line's text as column conversions need it: the whole line when
+/// it's short, the rope slice and its column table when it's long.
+enum LineColumnText<'a> {
+    Short(Cow<'a, str>),
+    Long {
+        line: ropey::RopeSlice<'a>,
+        columns: &'a LineColumns,
+    },
+}
+
+impl<'a> LineColumnText<'a> {
+    fn new(document: &'a Document, line: &'a VisibleTextLine) -> Option<Self> {
+        match line.columns.as_deref() {
+            Some(columns) => Some(Self::Long {
+                line: document.get_line_slice(line.doc_line)?,
+                columns,
+            }),
+            None => document.get_line_cow(line.doc_line).map(Self::Short),
+        }
+    }
+
+    fn visual_col(&self, char_col: usize) -> usize {
+        match self {
+            Self::Short(text) => char_col_to_visual_col(text, char_col),
+            Self::Long { line, columns } => {
+                columns.visual_at_char(|cp| line.chars_at(cp.char), char_col)
+            }
+        }
+    }
+
+    fn visual_len(&self) -> usize {
+        match self {
+            Self::Short(text) => char_col_to_visual_col(text, text.chars().count()),
+            Self::Long { columns, .. } => columns.len_visual(),
+        }
+    }
+}
+
+/// A line's text-area band and the line-cache key of its contents.
+#[derive(Debug, Clone, Copy)]
+struct LineBand {
+    x: usize,
+    width: usize,
+    key: u64,
 }
 
 /// Stateful text editor renderer.
@@ -219,7 +280,7 @@ impl<'a> TextEditorRenderer<'a> {
         viewport_left: usize,
         selection: &Selection,
         doc_line: usize,
-        line_text: &str,
+        line_text: &LineColumnText,
     ) -> Option<(usize, usize)> {
         if selection.is_empty() {
             return None;
@@ -243,8 +304,8 @@ impl<'a> TextEditorRenderer<'a> {
             line_len
         };
 
-        let visual_start_col = char_col_to_visual_col(line_text, start_col);
-        let visual_end_col = char_col_to_visual_col(line_text, end_col);
+        let visual_start_col = line_text.visual_col(start_col);
+        let visual_end_col = line_text.visual_col(end_col);
         Some(ctx.clipped_span_x(visual_start_col, visual_end_col, viewport_left))
     }
 
@@ -253,7 +314,7 @@ impl<'a> TextEditorRenderer<'a> {
         viewport_left: usize,
         rect_sel: &crate::model::editor::RectangleSelectionState,
         doc_line: usize,
-        line_text: &str,
+        line_text: &LineColumnText,
     ) -> Option<(usize, usize)> {
         if !rect_sel.active || doc_line < rect_sel.top_line() || doc_line > rect_sel.bottom_line() {
             return None;
@@ -262,7 +323,7 @@ impl<'a> TextEditorRenderer<'a> {
         let left_visual_col = rect_sel.left_visual_col();
         let right_visual_col = rect_sel.right_visual_col();
 
-        let line_visual_len = char_col_to_visual_col(line_text, line_text.chars().count());
+        let line_visual_len = line_text.visual_len();
 
         // A line has nothing to draw only when it's fully to the left of the
         // whole rectangle. Don't bail based on the live drag column (just
@@ -315,6 +376,7 @@ impl<'a> TextEditorRenderer<'a> {
             y,
             height,
             is_active_line: doc_line == self.editor.active_cursor().line,
+            columns: self.document.line_columns(doc_line).cloned(),
         }
     }
 
@@ -354,7 +416,7 @@ impl<'a> TextEditorRenderer<'a> {
         selection_spans.clear();
         let mut bracket_visual_cols = [None, None];
 
-        let Some(line_text) = document.get_line_cow(line.doc_line) else {
+        let Some(line_text) = LineColumnText::new(document, line) else {
             self.text_buffers.selection_spans = selection_spans;
             self.text_buffers.bracket_visual_cols = bracket_visual_cols;
             return;
@@ -395,7 +457,7 @@ impl<'a> TextEditorRenderer<'a> {
                     continue;
                 }
 
-                let visual_col = char_col_to_visual_col(&line_text, pos.column);
+                let visual_col = line_text.visual_col(pos.column);
                 if ctx.contains_visual_col(visual_col, viewport_left) {
                     bracket_visual_cols[slot] = Some(visual_col);
                 }
@@ -430,18 +492,18 @@ impl<'a> TextEditorRenderer<'a> {
         }
     }
 
-    fn render_line_text_stage(
-        &mut self,
-        frame: &mut Frame,
-        painter: &mut TextPainter,
-        line: &VisibleTextLine,
-    ) {
+    fn prepare_line_text_stage(&mut self, line: &VisibleTextLine) {
         let document = self.document;
         let ctx = &self.ctx;
         let viewport_left = self.viewport_left();
-        let model = self.model;
         let text_buffers = &mut self.text_buffers;
 
+        text_buffers.display_text.clear();
+        text_buffers.adjusted_tokens.clear();
+        if let Some(columns) = line.columns.as_deref() {
+            self.prepare_long_line_text_stage(line.doc_line, columns);
+            return;
+        }
         let Some(line_text) = document.get_line_cow(line.doc_line) else {
             return;
         };
@@ -449,51 +511,207 @@ impl<'a> TextEditorRenderer<'a> {
         let max_chars = ctx.visible_columns;
         let expanded_text = expand_tabs_for_display(&line_text);
 
-        text_buffers.display_text.clear();
         for ch in expanded_text.chars().skip(viewport_left).take(max_chars) {
             text_buffers.display_text.push(ch);
         }
 
         let line_tokens = document.get_line_highlights(line.doc_line);
-        text_buffers.adjusted_tokens.clear();
         for t in line_tokens.iter() {
-            let visual_start = char_col_to_visual_col(&line_text, t.start_col);
-            let visual_end = char_col_to_visual_col(&line_text, t.end_col);
+            let visual_start = char_col_to_visual_col(&line_text, t.start_col as usize);
+            let visual_end = char_col_to_visual_col(&line_text, t.end_col as usize);
             let start = visual_start.saturating_sub(viewport_left);
             let end = visual_end.saturating_sub(viewport_left);
 
             if end > 0 && start < max_chars {
                 text_buffers
                     .adjusted_tokens
-                    .push(crate::syntax::HighlightToken {
-                        start_col: start,
-                        end_col: end.min(max_chars),
-                        highlight: t.highlight,
-                    });
+                    .push(crate::syntax::HighlightToken::new(
+                        start,
+                        end.min(max_chars),
+                        t.highlight,
+                    ));
             }
         }
+    }
+
+    /// Prepare only the horizontally visible part of a long line: its
+    /// column table locates the first visible char, and only that window of
+    /// the line is copied, expanded and matched against tokens.
+    fn prepare_long_line_text_stage(&mut self, doc_line: usize, columns: &LineColumns) {
+        let document = self.document;
+        let viewport_left = self.viewport_left();
+        let max_chars = self.ctx.visible_columns;
+        let right = viewport_left + max_chars;
+        let text_buffers = &mut self.text_buffers;
+
+        let Some(slice) = document.get_line_slice(doc_line) else {
+            return;
+        };
+        let chars_at = |cp: ColumnCheckpoint| slice.chars_at(cp.char);
+        let first = columns.char_at_visual(chars_at, viewport_left);
+        let first_visual = columns.visual_at_char(chars_at, first);
+
+        // A tab straddling the left edge leaves the spaces past the edge
+        for _ in viewport_left..first_visual.min(right) {
+            text_buffers.display_text.push(' ');
+        }
+        let Some(window) = document.get_line_range_cow(doc_line, first..first + max_chars) else {
+            return;
+        };
+        let visual_cols = &mut text_buffers.window_visual_cols;
+        visual_cols.clear();
+        let mut visual = first_visual;
+        for ch in window.chars() {
+            if visual >= right {
+                break;
+            }
+            visual_cols.push(visual);
+            let next = advance_visual(visual, ch);
+            if ch == '\t' {
+                for _ in visual..next.min(right) {
+                    text_buffers.display_text.push(' ');
+                }
+            } else {
+                text_buffers.display_text.push(ch);
+            }
+            visual = next;
+        }
+        let window_end = first + visual_cols.len();
+        let visual_of = |col: usize| {
+            if col < first {
+                0
+            } else {
+                visual_cols.get(col - first).copied().unwrap_or(visual)
+            }
+        };
+
+        // Both the tokens ending before the window and those starting past it
+        // are skipped by binary search. One ending right at `first` may
+        // still color a tab straddling the left edge.
+        let line_tokens = document.get_line_highlights_from(doc_line, first.saturating_sub(1));
+        let candidates = line_tokens.partition_point(|t| (t.start_col as usize) < window_end);
+        for t in &line_tokens[..candidates] {
+            let start = visual_of(t.start_col as usize).saturating_sub(viewport_left);
+            let end = visual_of(t.end_col as usize).saturating_sub(viewport_left);
+            if end > 0 && start < max_chars {
+                text_buffers
+                    .adjusted_tokens
+                    .push(crate::syntax::HighlightToken::new(
+                        start,
+                        end.min(max_chars),
+                        t.highlight,
+                    ));
+            }
+        }
+    }
+
+    fn render_line_text_stage(
+        &mut self,
+        frame: &mut Frame,
+        painter: &mut TextPainter,
+        line: &VisibleTextLine,
+    ) {
+        let x = self.ctx.text_start_x;
+        let text_color = self.palette.text;
+        let text_buffers = &mut self.text_buffers;
 
         if text_buffers.adjusted_tokens.is_empty() {
-            painter.draw(
-                frame,
-                ctx.text_start_x,
-                line.y,
-                &text_buffers.display_text,
-                self.palette.text,
-            );
+            painter.draw(frame, x, line.y, &text_buffers.display_text, text_color);
         } else {
-            painter.draw_with_highlights(
+            text_buffers.style_runs.clear();
+            push_style_runs(
+                &text_buffers.adjusted_tokens,
+                &self.model.theme.highlight_colors,
+                text_color,
+                &mut text_buffers.style_runs,
+            );
+            painter.draw_runs(
                 frame,
-                ctx.text_start_x,
+                x,
                 line.y,
                 &text_buffers.display_text,
-                &text_buffers.adjusted_tokens,
-                &model.theme.syntax,
-                self.palette.text,
+                &text_buffers.style_runs,
+                text_color,
             );
         }
     }
 
+    /// Hash of the render state shared by every line band: theme colors,
+    /// font scale and where text starts within the band.
+    fn line_band_style_key(&self, painter: &TextPainter) -> u64 {
+        let mut hasher = DefaultHasher::new();
+        self.palette.hash(&mut hasher);
+        self.model.theme.highlight_colors.hash(&mut hasher);
+        painter.font_size().to_bits().hash(&mut hasher);
+        self.ctx.char_width.to_bits().hash(&mut hasher);
+        self.ctx.line_height.hash(&mut hasher);
+        self.ctx
+            .text_start_x
+            .wrapping_sub(self.ctx.gutter_right_x + 1)
+            .hash(&mut hasher);
+        hasher.finish()
+    }
+
+    /// Locate the text-area band for a line whose decorations and text have
+    /// been prepared, keyed by everything that ends up in its pixels.
+    ///
+    /// Positions are hashed relative to the band and the viewport, so the key
+    /// survives vertical and horizontal scrolling.
+    fn line_band(&self, frame: &Frame, line: &VisibleTextLine, style_key: u64) -> Option<LineBand> {
+        let x = self.ctx.gutter_right_x + 1;
+        let width = self
+            .ctx
+            .rect_w
+            .saturating_sub(self.ctx.gutter_width + 1)
+            .min(frame.width().saturating_sub(x));
+        if width == 0 || line.height == 0 {
+            return None;
+        }
+
+        let mut hasher = DefaultHasher::new();
+        style_key.hash(&mut hasher);
+        width.hash(&mut hasher);
+        line.height.hash(&mut hasher);
+        line.is_active_line.hash(&mut hasher);
+        self.text_buffers.display_text.hash(&mut hasher);
+        self.text_buffers.adjusted_tokens.hash(&mut hasher);
+        for &(x_start, x_end) in &self.text_buffers.selection_spans {
+            (x_start.wrapping_sub(x), x_end.wrapping_sub(x)).hash(&mut hasher);
+        }
+        let viewport_left = self.viewport_left();
+        for visual_col in self.text_buffers.bracket_visual_cols {
+            visual_col.map(|col| col - viewport_left).hash(&mut hasher);
+        }
+
+        Some(LineBand {
+            x,
+            width,
+            key: hasher.finish(),
+        })
+    }
+
+    fn blit_cached_line_band(
+        frame: &mut Frame,
+        painter: &mut TextPainter,
+        band: LineBand,
+        line: &VisibleTextLine,
+    ) -> bool {
+        painter.line_cache_mut().is_some_and(|cache| {
+            cache.blit(band.key, frame, band.x, line.y, band.width, line.height)
+        })
+    }
+
+    fn store_line_band(
+        frame: &Frame,
+        painter: &mut TextPainter,
+        band: LineBand,
+        line: &VisibleTextLine,
+    ) {
+        if let Some(cache) = painter.line_cache_mut() {
+            cache.store(band.key, frame, band.x, line.y, band.width, line.height);
+        }
+    }
+
     fn render_gutter_line_number(
         &self,
         frame: &mut Frame,
@@ -522,8 +740,7 @@ impl<'a> TextEditorRenderer<'a> {
         y: usize,
         color: u32,
     ) {
-        let line_text = self.document.get_line_cow(line).unwrap_or_default();
-        let visual_cursor_col = char_col_to_visual_col(&line_text, column);
+        let visual_cursor_col = self.document.visual_col(line, column);
 
         if !self
             .ctx
@@ -601,15 +818,27 @@ impl<'a> TextEditorRenderer<'a> {
         }
     }
 
+    /// Render a line's decorations and text over its background, reusing
+    /// the painter's line cache when `style_key` is given.
     fn render_line_content_stages(
         &mut self,
         frame: &mut Frame,
         painter: &mut TextPainter,
         line: &VisibleTextLine,
+        style_key: Option<u64>,
     ) {
         self.collect_line_decorations(line);
+        self.prepare_line_text_stage(line);
+        let band = style_key.and_then(|style_key| self.line_band(frame, line, style_key));
+        if band.is_some_and(|band| Self::blit_cached_line_band(frame, painter, band, line)) {
+            return;
+        }
+
         self.render_line_decoration_stage(frame, line);
         self.render_line_text_stage(frame, painter, line);
+        if let Some(band) = band {
+            Self::store_line_band(frame, painter, band, line);
+        }
     }
 
     fn render_dirty_line_cursor_stage(&self, frame: &mut Frame, line: &VisibleTextLine) {
@@ -622,6 +851,10 @@ impl<'a> TextEditorRenderer<'a> {
         painter: &mut TextPainter,
         dirty_lines: &[usize],
     ) {
+        let style_key = painter
+            .has_line_cache()
+            .then(|| self.line_band_style_key(painter));
+
         for &doc_line in dirty_lines {
             if !self.ctx.viewport.contains_doc_line(doc_line) {
                 continue;
@@ -634,7 +867,7 @@ impl<'a> TextEditorRenderer<'a> {
             let line = self.prepare_visible_line(doc_line, y);
             self.render_line_background_stage(frame, &line);
             self.render_gutter_line_number(frame, painter, &line);
-            self.render_line_content_stages(frame, painter, &line);
+            self.render_line_content_stages(frame, painter, &line, style_key);
             self.render_dirty_line_cursor_stage(frame, &line);
         }
     }
@@ -664,6 +897,10 @@ impl<'a> TextEditorRenderer<'a> {
         #[cfg(not(debug_assertions))]
         self.render_current_line_background_stage(frame);
 
+        let style_key = painter
+            .has_line_cache()
+            .then(|| self.line_band_style_key(painter));
+
         for screen_line in 0..self.ctx.visible_lines {
             let Some(doc_line) = self.ctx.viewport.doc_line_for_visible_row(screen_line) else {
                 break;
@@ -678,15 +915,25 @@ impl<'a> TextEditorRenderer<'a> {
             {
                 let start = Instant::now();
                 self.collect_line_decorations(&line);
+                self.prepare_line_text_stage(&line);
+                let band = style_key.and_then(|style_key| self.line_band(frame, &line, style_key));
+                if band.is_some_and(|band| Self::blit_cached_line_band(frame, painter, band, &line))
+                {
+                    glyph_time += start.elapsed();
+                    continue;
+                }
                 self.render_line_decoration_stage(frame, &line);
                 decoration_time += start.elapsed();
 
                 let start = Instant::now();
                 self.render_line_text_stage(frame, painter, &line);
+                if let Some(band) = band {
+                    Self::store_line_band(frame, painter, band, &line);
+                }
                 glyph_time += start.elapsed();
             }
             #[cfg(not(debug_assertions))]
-            self.render_line_content_stages(frame, painter, &line);
+            self.render_line_content_stages(frame, painter, &line, style_key);
         }
 
         if is_focused {
@@ -795,6 +1042,48 @@ pub fn render_cursor_lines_only(
     renderer.render_cursor_lines_only(frame, painter, dirty_lines);
 }
 
+/// Window rects [`render_cursor_lines_only`] repaints for `dirty_lines`: a
+/// band across the focused group for each of them that is visible.
+pub fn cursor_lines_damage_rects(
+    model: &AppModel,
+    dirty_lines: &[usize],
+    char_width: f32,
+    line_height: usize,
+) -> Vec<Rect> {
+    let focused_group_id = model.editor_area.focused_group_id;
+    let Some(group) = model.editor_area.groups.get(&focused_group_id) else {
+        return Vec::new();
+    };
+    let Some(editor) = group
+        .active_editor_id()
+        .and_then(|id| model.editor_area.editors.get(&id))
+    else {
+        return Vec::new();
+    };
+    let Some(document) = editor
+        .document_id
+        .and_then(|id| model.editor_area.documents.get(&id))
+    else {
+        return Vec::new();
+    };
+
+    let layout = geometry::GroupLayout::new(group, model, char_width);
+    let ctx = EditorRenderContext::new(&layout, editor, document, char_width, line_height);
+    dirty_lines
+        .iter()
+        .filter(|&&doc_line| ctx.viewport.contains_doc_line(doc_line))
+        .filter_map(|&doc_line| ctx.line_y(doc_line))
+        .map(|y| {
+            Rect::new(
+                ctx.rect_x as f32,
+                y as f32,
+                ctx.rect_w as f32,
+                line_height as f32,
+            )
+        })
+        .collect()
+}
+
 /// Render text content (lines, selections, cursors) for an editor group.
 #[allow(clippy::too_many_arguments)]
 pub fn render_text_area(
@@ -838,7 +1127,7 @@ mod tests {
     use crate::model::editor::RectangleSelectionState;
     use crate::model::{AppModel, Cursor, Position, Rect, Selection};
     use crate::view::geometry::GroupLayout;
-    use crate::view::{Frame, GlyphCache, Renderer, TextPainter};
+    use crate::view::{Frame, GlyphCache, LineRenderCache, Renderer, TextPainter};
     use fontdue::{Font, FontSettings};
     use ropey::Rope;
 
@@ -948,6 +1237,13 @@ mod tests {
     }
 
     fn render_full_editor_group(model: &AppModel) -> Vec<u32> {
+        render_full_editor_group_with(model, None)
+    }
+
+    fn render_full_editor_group_with(
+        model: &AppModel,
+        line_cache: Option<&mut LineRenderCache>,
+    ) -> Vec<u32> {
         let width = model.window_size.0 as usize;
         let height = model.window_size.1 as usize;
         let mut buffer = vec![0; width * height];
@@ -962,6 +1258,9 @@ mod tests {
             char_width,
             line_height,
         );
+        if let Some(line_cache) = line_cache {
+            painter = painter.with_line_cache(line_cache);
+        }
         let group = model
             .editor_area
             .groups
@@ -1044,4 +1343,39 @@ mod tests {
             "cursor-line fast path should match a full text render after cursor visibility changes"
         );
     }
+
+    #[test]
+    fn line_cache_hits_reproduce_the_uncached_render() {
+        let mut model = make_text_model();
+        model.ui.cursor_visible = true;
+        let uncached = render_full_editor_group(&model);
+        let mut line_cache = LineRenderCache::new();
+
+        line_cache.begin_frame();
+        assert_eq!(
+            render_full_editor_group_with(&model, Some(&mut line_cache)),
+            uncached
+        );
+        let (hits, lines) = line_cache.take_stats();
+        assert_eq!(hits, 0);
+        assert!(lines > 0);
+
+        line_cache.begin_frame();
+        assert_eq!(
+            render_full_editor_group_with(&model, Some(&mut line_cache)),
+            uncached,
+            "a frame served from the line cache should match a fresh render"
+        );
+        assert_eq!(line_cache.take_stats(), (lines, 0));
+
+        // Moving the cursor up a line changes which line is active, so only
+        // the old and new active lines are rendered again
+        model.editor_mut().cursors = vec![Cursor::at(0, 2)];
+        line_cache.begin_frame();
+        assert_eq!(
+            render_full_editor_group_with(&model, Some(&mut line_cache)),
+            render_full_editor_group(&model)
+        );
+        assert_eq!(line_cache.take_stats(), (lines - 2, 2));
+    }
 }
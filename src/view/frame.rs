@@ -6,7 +6,8 @@
 use crate::model::editor_area::Rect;
 use fontdue::Font;
 
-use super::GlyphCache;
+use super::blend::{blend_coverage_row, blend_row, fill_row};
+use super::{GlyphCache, LineRenderCache};
 
 /// Blend a foreground color onto a background color using alpha compositing.
 ///
@@ -160,12 +161,7 @@ impl<'a> Frame<'a> {
         let x1 = ((rect.x + rect.width) as usize).min(self.max_x());
         let y1 = ((rect.y + rect.height) as usize).min(self.max_y());
 
-        for y in y0..y1 {
-            let row_start = y * self.width;
-            for x in x0..x1 {
-                self.buffer[row_start + x] = color;
-            }
-        }
+        self.fill_span_rows(x0, y0, x1, y1, color);
     }
 
     /// Fill a rectangle specified by pixel coordinates
@@ -175,12 +171,7 @@ impl<'a> Frame<'a> {
         let x1 = (x + w).min(self.max_x());
         let y1 = (y + h).min(self.max_y());
 
-        for py in y0..y1 {
-            let row_start = py * self.width;
-            for px in x0..x1 {
-                self.buffer[row_start + px] = color;
-            }
-        }
+        self.fill_span_rows(x0, y0, x1, y1, color);
     }
 
     /// Fill a rectangle with alpha blending (pixel coordinates, ARGB format)
@@ -199,13 +190,7 @@ impl<'a> Frame<'a> {
         let x1 = (x + w).min(self.max_x());
         let y1 = (y + h).min(self.max_y());
 
-        for py in y0..y1 {
-            let row_start = py * self.width;
-            for px in x0..x1 {
-                self.buffer[row_start + px] =
-                    blend_colors(self.buffer[row_start + px], color, alpha);
-            }
-        }
+        self.blend_span_rows(x0, y0, x1, y1, color, alpha);
     }
 
     /// Fill a rectangle with alpha blending (color is ARGB format)
@@ -225,13 +210,7 @@ impl<'a> Frame<'a> {
         let x1 = ((rect.x + rect.width) as usize).min(self.max_x());
         let y1 = ((rect.y + rect.height) as usize).min(self.max_y());
 
-        for y in y0..y1 {
-            let row_start = y * self.width;
-            for x in x0..x1 {
-                let idx = row_start + x;
-                self.buffer[idx] = blend_colors(self.buffer[idx], color, alpha);
-            }
-        }
+        self.blend_span_rows(x0, y0, x1, y1, color, alpha);
     }
 
     /// Set a single pixel (bounds-checked, respects clip rect)
@@ -254,6 +233,56 @@ impl<'a> Frame<'a> {
         }
     }
 
+    /// Copy a pixel rectangle out of the frame into `out`, row by row
+    ///
+    /// Returns false (leaving `out` untouched) unless the whole rectangle
+    /// lies inside the frame.
+    pub fn read_rect_px(&self, x: usize, y: usize, w: usize, h: usize, out: &mut Vec<u32>) -> bool {
+        if x + w > self.width || y + h > self.height {
+            return false;
+        }
+
+        out.clear();
+        out.reserve(w * h);
+        for row in y..y + h {
+            let start = row * self.width + x;
+            out.extend_from_slice(&self.buffer[start..start + w]);
+        }
+        true
+    }
+
+    /// Copy a rectangle of pixels laid out as by [`Self::read_rect_px`] into
+    /// the frame
+    ///
+    /// Returns false (drawing nothing) unless the whole rectangle lies inside
+    /// the clip region and `pixels` holds exactly `w * h` values.
+    pub fn write_rect_px(
+        &mut self,
+        x: usize,
+        y: usize,
+        w: usize,
+        h: usize,
+        pixels: &[u32],
+    ) -> bool {
+        if x < self.min_x()
+            || y < self.min_y()
+            || x + w > self.max_x()
+            || y + h > self.max_y()
+            || pixels.len() != w * h
+        {
+            return false;
+        }
+        if w == 0 {
+            return true;
+        }
+
+        for (row, src) in (y..y + h).zip(pixels.chunks_exact(w)) {
+            let start = row * self.width + x;
+            self.buffer[start..start + w].copy_from_slice(src);
+        }
+        true
+    }
+
     /// Blend a pixel with alpha (ARGB format, alpha in high byte)
     #[inline]
     pub fn blend_pixel(&mut self, x: usize, y: usize, color: u32) {
@@ -285,6 +314,67 @@ impl<'a> Frame<'a> {
         self.buffer[idx] = blend_colors(self.buffer[idx], color, alpha);
     }
 
+    /// Blend one row of 8-bit coverage (a glyph bitmap row) starting at
+    /// (`x`, `y`), respecting clip rect. Zero coverage leaves pixels untouched.
+    ///
+    /// Equivalent to `blend_text_pixel` with `coverage / 255.0` for each
+    /// nonzero coverage value.
+    #[inline]
+    pub fn blend_coverage_span(&mut self, x: isize, y: isize, coverage: &[u8], color: u32) {
+        if y < self.min_y() as isize || y >= self.max_y() as isize {
+            return;
+        }
+        let x0 = x.max(self.min_x() as isize);
+        let x1 = (x + coverage.len() as isize).min(self.max_x() as isize);
+        if x0 >= x1 {
+            return;
+        }
+        let row_start = y as usize * self.width;
+        let skip = (x0 - x) as usize;
+        blend_coverage_row(
+            &mut self.buffer[row_start + x0 as usize..row_start + x1 as usize],
+            &coverage[skip..],
+            color,
+        );
+    }
+
+    /// Fill the already-clipped span `x0..x1` on rows `y0..y1`
+    #[inline]
+    fn fill_span_rows(&mut self, x0: usize, y0: usize, x1: usize, y1: usize, color: u32) {
+        if x0 >= x1 {
+            return;
+        }
+        for y in y0..y1 {
+            let row_start = y * self.width;
+            fill_row(&mut self.buffer[row_start + x0..row_start + x1], color);
+        }
+    }
+
+    /// Blend `color` at `alpha` over the already-clipped span `x0..x1` on
+    /// rows `y0..y1`
+    #[inline]
+    fn blend_span_rows(
+        &mut self,
+        x0: usize,
+        y0: usize,
+        x1: usize,
+        y1: usize,
+        color: u32,
+        alpha: f32,
+    ) {
+        if x0 >= x1 {
+            return;
+        }
+        for y in y0..y1 {
+            let row_start = y * self.width;
+            blend_row(
+                &mut self.buffer[row_start + x0..row_start + x1],
+                color,
+                alpha,
+            );
+        }
+    }
+
     /// Fill a rectangle with alpha blending
     pub fn blend_rect(&mut self, rect: Rect, color: u32) {
         // `color`'s alpha is loop-invariant across the whole rect; extract
@@ -315,11 +405,7 @@ impl<'a> Frame<'a> {
         let x1 = ((rect.x + rect.width) as usize).min(self.max_x());
         let y1 = ((rect.y + rect.height) as usize).min(self.max_y());
 
-        for y in y0..y1 {
-            for x in x0..x1 {
-                self.blend_text_pixel(x, y, color, alpha);
-            }
-        }
+        self.blend_span_rows(x0, y0, x1, y1, color, alpha);
     }
 
     /// Blit an RGBA8 image into the frame, scaled to fit within the given rect
@@ -408,11 +494,8 @@ impl<'a> Frame<'a> {
                 dim_color | 0xFF000000,
             );
         }
-        for y in self.min_y()..self.max_y() {
-            for x in self.min_x()..self.max_x() {
-                self.blend_text_pixel(x, y, dim_color, a);
-            }
-        }
+        let (x0, y0, x1, y1) = (self.min_x(), self.min_y(), self.max_x(), self.max_y());
+        self.blend_span_rows(x0, y0, x1, y1, dim_color, a);
     }
 
     /// Draw a rectangle with a 1px border
@@ -509,6 +592,7 @@ pub struct CacheStats {
 pub struct TextPainter<'a> {
     font: &'a Font,
     glyph_cache: &'a mut GlyphCache,
+    line_cache: Option<&'a mut LineRenderCache>,
     font_size: f32,
     ascent: f32,
     char_width: f32,
@@ -531,6 +615,7 @@ impl<'a> TextPainter<'a> {
         Self {
             font,
             glyph_cache,
+            line_cache: None,
             font_size,
             ascent,
             char_width,
@@ -540,6 +625,33 @@ impl<'a> TextPainter<'a> {
         }
     }
 
+    /// Attach a line render cache for the editor text area to reuse
+    pub fn with_line_cache(mut self, line_cache: &'a mut LineRenderCache) -> Self {
+        self.line_cache = Some(line_cache);
+        self
+    }
+
+    /// Whether a line render cache is attached
+    #[inline]
+    pub fn has_line_cache(&self) -> bool {
+        self.line_cache.is_some()
+    }
+
+    /// Get the attached line render cache, if any
+    #[inline]
+    pub fn line_cache_mut(&mut self) -> Option<&mut LineRenderCache> {
+        self.line_cache.as_deref_mut()
+    }
+
+    /// Get the number of cached line bands and the bytes they hold
+    #[inline]
+    #[allow(dead_code)]
+    pub fn line_cache_usage(&self) -> (usize, usize) {
+        self.line_cache
+            .as_deref()
+            .map_or((0, 0), |cache| (cache.len(), cache.memory_bytes()))
+    }
+
     /// Get the cache statistics (hits and misses)
     #[cfg(debug_assertions)]
     #[inline]
@@ -548,6 +660,12 @@ impl<'a> TextPainter<'a> {
         &self.cache_stats
     }
 
+    /// Get the font size in pixels
+    #[inline]
+    pub fn font_size(&self) -> f32 {
+        self.font_size
+    }
+
     /// Get the character width for monospace layout calculations
     #[inline]
     pub fn char_width(&self) -> f32 {
@@ -567,160 +685,136 @@ impl<'a> TextPainter<'a> {
         self.glyph_cache.len()
     }
 
+    /// Get the bytes of glyph coverage held by the atlas
+    #[inline]
+    pub fn glyph_cache_bytes(&self) -> usize {
+        self.glyph_cache.memory_bytes()
+    }
+
     /// Draw text at the specified position
     pub fn draw(&mut self, frame: &mut Frame, x: usize, y: usize, text: &str, color: u32) {
         let mut current_x = x as f32;
         let baseline = y as f32 + self.ascent;
 
         for ch in text.chars() {
-            let key = (ch, self.font_size.to_bits());
+            current_x += self.draw_glyph(frame, ch, current_x, baseline, color);
+        }
+    }
 
-            // Track cache hit/miss before lookup
-            #[cfg(debug_assertions)]
-            let is_hit = self.glyph_cache.contains_key(&key);
-            #[cfg(debug_assertions)]
-            if is_hit {
-                self.cache_stats.hits += 1;
-            } else {
-                self.cache_stats.misses += 1;
-            }
+    /// Draw one glyph with its origin at `x` on `baseline`, returning its
+    /// advance width
+    #[inline]
+    fn draw_glyph(
+        &mut self,
+        frame: &mut Frame,
+        ch: char,
+        x: f32,
+        baseline: f32,
+        color: u32,
+    ) -> f32 {
+        let font = self.font;
+        let font_size = self.font_size;
+        let (glyph, _is_hit) = self
+            .glyph_cache
+            .get_or_insert_with(ch, font_size.to_bits(), || font.rasterize(ch, font_size));
+
+        #[cfg(debug_assertions)]
+        if _is_hit {
+            self.cache_stats.hits += 1;
+        } else {
+            self.cache_stats.misses += 1;
+        }
 
-            let (metrics, bitmap) = self
-                .glyph_cache
-                .entry(key)
-                .or_insert_with(|| self.font.rasterize(ch, self.font_size));
-
-            let glyph_top = baseline - metrics.height as f32 - metrics.ymin as f32;
-
-            for bitmap_y in 0..metrics.height {
-                for bitmap_x in 0..metrics.width {
-                    let bitmap_idx = bitmap_y * metrics.width + bitmap_x;
-                    if bitmap_idx < bitmap.len() {
-                        let alpha = bitmap[bitmap_idx];
-                        if alpha > 0 {
-                            let px = current_x as isize + bitmap_x as isize + metrics.xmin as isize;
-                            let py = (glyph_top + bitmap_y as f32) as isize;
-
-                            if px >= 0 && py >= 0 {
-                                frame.blend_text_pixel(
-                                    px as usize,
-                                    py as usize,
-                                    color,
-                                    alpha as f32 / 255.0,
-                                );
-                            }
-                        }
-                    }
-                }
-            }
+        let metrics = glyph.metrics;
+        let glyph_top = baseline - metrics.height as f32 - metrics.ymin as f32;
 
-            current_x += metrics.advance_width;
+        let px = x as isize + metrics.xmin as isize;
+        for (bitmap_y, row) in glyph.rows().enumerate() {
+            let py = (glyph_top + bitmap_y as f32) as isize;
+            frame.blend_coverage_span(px, py, row, color);
         }
+
+        metrics.advance_width
     }
 
     /// Measure text width in pixels
     #[allow(dead_code)]
     pub fn measure_width(&mut self, text: &str) -> f32 {
+        let font = self.font;
+        let font_size = self.font_size;
         let mut width = 0.0;
         for ch in text.chars() {
-            let key = (ch, self.font_size.to_bits());
-            let (metrics, _) = self
+            let (glyph, _) = self
                 .glyph_cache
-                .entry(key)
-                .or_insert_with(|| self.font.rasterize(ch, self.font_size));
-            width += metrics.advance_width;
+                .get_or_insert_with(ch, font_size.to_bits(), || font.rasterize(ch, font_size));
+            width += glyph.metrics.advance_width;
         }
         width
     }
 
-    /// Draw text with syntax highlighting
+    /// Draw text as consecutive style runs, each in one color
     ///
-    /// Applies per-character colors based on highlight tokens.
-    /// Falls back to default_color for characters without highlighting.
-    #[allow(clippy::too_many_arguments)]
-    pub fn draw_with_highlights(
+    /// Chars past the last run are drawn in `default_color`.
+    pub fn draw_runs(
         &mut self,
         frame: &mut Frame,
         x: usize,
         y: usize,
         text: &str,
-        tokens: &[crate::syntax::HighlightToken],
-        syntax_theme: &crate::theme::SyntaxTheme,
+        runs: &[StyleRun],
         default_color: u32,
     ) {
-        if tokens.is_empty() {
-            // No highlighting, use default color
-            self.draw(frame, x, y, text, default_color);
-            return;
-        }
-
         let mut current_x = x as f32;
         let baseline = y as f32 + self.ascent;
+        let mut chars = text.chars();
 
-        let mut token_idx = 0;
-
-        for (col, ch) in text.chars().enumerate() {
-            // Advance token_idx past any tokens that end before or at this column
-            while token_idx < tokens.len() && tokens[token_idx].end_col <= col {
-                token_idx += 1;
-            }
-
-            // Determine color for this character
-            let color = if token_idx < tokens.len()
-                && col >= tokens[token_idx].start_col
-                && col < tokens[token_idx].end_col
-            {
-                syntax_theme
-                    .color_for_highlight(tokens[token_idx].highlight)
-                    .to_argb_u32()
-            } else {
-                default_color
-            };
-
-            // Draw the character
-            let key = (ch, self.font_size.to_bits());
-
-            // Track cache hit/miss before lookup
-            #[cfg(debug_assertions)]
-            let is_hit = self.glyph_cache.contains_key(&key);
-            #[cfg(debug_assertions)]
-            if is_hit {
-                self.cache_stats.hits += 1;
-            } else {
-                self.cache_stats.misses += 1;
+        for run in runs {
+            for ch in chars.by_ref().take(run.len) {
+                current_x += self.draw_glyph(frame, ch, current_x, baseline, run.color);
             }
+        }
+        for ch in chars {
+            current_x += self.draw_glyph(frame, ch, current_x, baseline, default_color);
+        }
+    }
+}
 
-            let (metrics, bitmap) = self
-                .glyph_cache
-                .entry(key)
-                .or_insert_with(|| self.font.rasterize(ch, self.font_size));
-
-            let glyph_top = baseline - metrics.height as f32 - metrics.ymin as f32;
-
-            for bitmap_y in 0..metrics.height {
-                for bitmap_x in 0..metrics.width {
-                    let bitmap_idx = bitmap_y * metrics.width + bitmap_x;
-                    if bitmap_idx < bitmap.len() {
-                        let alpha = bitmap[bitmap_idx];
-                        if alpha > 0 {
-                            let px = current_x as isize + bitmap_x as isize + metrics.xmin as isize;
-                            let py = (glyph_top + bitmap_y as f32) as isize;
-
-                            if px >= 0 && py >= 0 {
-                                frame.blend_text_pixel(
-                                    px as usize,
-                                    py as usize,
-                                    color,
-                                    alpha as f32 / 255.0,
-                                );
-                            }
-                        }
-                    }
-                }
-            }
+/// A stretch of `len` chars of a line drawn in one color
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct StyleRun {
+    pub len: usize,
+    pub color: u32,
+}
 
-            current_x += metrics.advance_width;
+/// Group a line's highlight tokens into style runs, appended to `runs`
+///
+/// Tokens must be sorted by start column. Gaps between tokens get
+/// `default_color`; where tokens overlap, the earlier one wins until it
+/// ends. Nothing is emitted past the last token.
+pub fn push_style_runs(
+    tokens: &[crate::syntax::HighlightToken],
+    colors: &crate::theme::HighlightColors,
+    default_color: u32,
+    runs: &mut Vec<StyleRun>,
+) {
+    let mut col = 0;
+    for token in tokens {
+        let start = (token.start_col as usize).max(col);
+        let end = token.end_col as usize;
+        if end <= start {
+            continue;
+        }
+        if start > col {
+            runs.push(StyleRun {
+                len: start - col,
+                color: default_color,
+            });
         }
+        runs.push(StyleRun {
+            len: end - start,
+            color: colors.get(token.highlight),
+        });
+        col = end;
     }
 }
 
@@ -730,6 +824,44 @@ mod tests {
     use std::collections::VecDeque;
     use std::time::Duration;
 
+    #[test]
+    fn test_style_runs_fill_gaps_and_skip_overlaps() {
+        use crate::syntax::{highlight_id_for_name, HighlightToken};
+        use crate::theme::{HighlightColors, SyntaxTheme};
+
+        let syntax = SyntaxTheme::default_dark();
+        let colors = HighlightColors::compile(&syntax);
+        let keyword = highlight_id_for_name("keyword").unwrap();
+        let string = highlight_id_for_name("string").unwrap();
+        let tokens = [
+            HighlightToken::new(2, 5, keyword),
+            // Starts inside the keyword, which wins until it ends
+            HighlightToken::new(4, 8, string),
+            // Entirely covered by earlier tokens
+            HighlightToken::new(6, 7, keyword),
+        ];
+
+        let mut runs = Vec::new();
+        push_style_runs(&tokens, &colors, 0xFF00FF00, &mut runs);
+        assert_eq!(
+            runs,
+            vec![
+                StyleRun {
+                    len: 2,
+                    color: 0xFF00FF00
+                },
+                StyleRun {
+                    len: 3,
+                    color: syntax.keyword.to_argb_u32()
+                },
+                StyleRun {
+                    len: 3,
+                    color: syntax.string.to_argb_u32()
+                },
+            ]
+        );
+    }
+
     #[test]
     fn test_frame_fill_rect() {
         let mut buffer = vec![0u32; 100 * 100];
@@ -751,6 +883,33 @@ mod tests {
         assert_eq!(frame.get_pixel(5, 5), 0);
     }
 
+    #[test]
+    fn read_rect_px_round_trips_through_write_rect_px() {
+        let mut source: Vec<u32> = (0..40 * 30).collect();
+        let frame = Frame::new(&mut source, 40, 30);
+        let mut pixels = Vec::new();
+        assert!(frame.read_rect_px(5, 7, 12, 4, &mut pixels));
+        assert_eq!(pixels.len(), 12 * 4);
+        assert!(!frame.read_rect_px(30, 0, 12, 4, &mut pixels));
+
+        let mut buffer = vec![0u32; 40 * 30];
+        let mut frame = Frame::new(&mut buffer, 40, 30);
+        assert!(frame.write_rect_px(5, 7, 12, 4, &pixels));
+        for y in 7..11 {
+            for x in 5..17 {
+                assert_eq!(frame.get_pixel(x, y), (y * 40 + x) as u32);
+            }
+        }
+        assert_eq!(frame.get_pixel(4, 7), 0);
+
+        // Partially clipped or mis-sized writes draw nothing
+        frame.set_clip(Rect::new(0.0, 0.0, 10.0, 30.0));
+        assert!(!frame.write_rect_px(5, 20, 12, 4, &pixels));
+        frame.clear_clip();
+        assert!(!frame.write_rect_px(5, 20, 12, 3, &pixels));
+        assert_eq!(frame.get_pixel(5, 20), 0);
+    }
+
     #[test]
     fn set_clip_with_negative_width_produces_empty_not_inverted_clip() {
         // Regression test: `set_clip` used to cast `rect.x + rect.width` to
@@ -818,6 +977,69 @@ mod tests {
         assert_eq!(buffer_a, buffer_b);
     }
 
+    #[test]
+    fn fill_rect_blended_matches_per_pixel_blend_pixel_reference() {
+        // Odd widths leave a remainder after the row kernel's full chunks
+        let rect = Rect {
+            x: 1.0,
+            y: 2.0,
+            width: 19.0,
+            height: 4.0,
+        };
+        let color = 0x40F0A030;
+        let background: Vec<u32> = (0..24 * 8).map(|i| 0xFF000000 | (i * 0x010305)).collect();
+
+        let mut buffer_a = background.clone();
+        let mut frame_a = Frame::new(&mut buffer_a, 24, 8);
+        frame_a.fill_rect_blended(rect, color);
+
+        let mut buffer_b = background;
+        let mut frame_b = Frame::new(&mut buffer_b, 24, 8);
+        for y in 2..6 {
+            for x in 1..20 {
+                frame_b.blend_pixel(x, y, color);
+            }
+        }
+
+        assert_eq!(buffer_a, buffer_b);
+    }
+
+    #[test]
+    fn blend_coverage_span_matches_per_pixel_blend_pixel_reference() {
+        // A glyph row hanging off the left edge and across the clip's right
+        // edge, plus a row above the frame
+        let coverage: Vec<u8> = (0..21).map(|i| (i * 53 % 256) as u8).collect();
+        let color = 0xFFCDD6F4;
+
+        let mut buffer_a = vec![0xFF1E1E2E_u32; 16 * 4];
+        let mut frame_a = Frame::new(&mut buffer_a, 16, 4);
+        frame_a.set_clip(Rect {
+            x: 0.0,
+            y: 0.0,
+            width: 12.0,
+            height: 4.0,
+        });
+        frame_a.blend_coverage_span(-3, 1, &coverage, color);
+        frame_a.blend_coverage_span(-3, -1, &coverage, color);
+
+        let mut buffer_b = vec![0xFF1E1E2E_u32; 16 * 4];
+        let mut frame_b = Frame::new(&mut buffer_b, 16, 4);
+        frame_b.set_clip(Rect {
+            x: 0.0,
+            y: 0.0,
+            width: 12.0,
+            height: 4.0,
+        });
+        for (i, &alpha) in coverage.iter().enumerate() {
+            let x = i as isize - 3;
+            if alpha > 0 && x >= 0 {
+                frame_b.blend_pixel(x as usize, 1, ((alpha as u32) << 24) | (color & 0xFFFFFF));
+            }
+        }
+
+        assert_eq!(buffer_a, buffer_b);
+    }
+
     #[test]
     fn test_frame_blend_pixel() {
         let mut buffer = vec![0xFFFFFFFF_u32; 10 * 10]; // White background
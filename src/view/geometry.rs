@@ -550,14 +550,7 @@ pub fn pixel_to_cursor_in_group(
     let x_offset = local_x - text_x;
     let visual_column = viewport.visual_column_for_x_offset(x_offset, char_width);
 
-    let line_text = document.get_line(line).unwrap_or_default();
-    let line_text_trimmed = super::helpers::trim_line_ending(&line_text);
-    let column = visual_col_to_char_col(line_text_trimmed, visual_column);
-
-    let line_len = document.line_length(line);
-    let column = column.min(line_len);
-
-    (line, column)
+    (line, document.char_col_at_visual(line, visual_column))
 }
 
 // ============================================================================
@@ -2222,6 +2215,35 @@ impl OutlinePanelLayout {
     }
 }
 
+/// Shared layout for the find-in-files panel content area: one summary row
+/// ("N matches in M files") above the scrollable result rows, which use the
+/// outline panel's row metrics.
+#[derive(Debug, Clone, Copy)]
+pub struct SearchPanelLayout {
+    /// Y coordinate of the summary row.
+    pub summary_y: f32,
+    /// Scrollable result rows below the summary.
+    pub results: OutlinePanelLayout,
+}
+
+impl SearchPanelLayout {
+    /// Build search panel geometry from the dock content rectangle and scaled metrics.
+    pub fn new(content_rect: Rect, metrics: &ScaledMetrics) -> Self {
+        let row_height = (metrics.file_tree_row_height as f32).min(content_rect.height);
+        let results_rect = Rect::new(
+            content_rect.x,
+            content_rect.y + row_height,
+            content_rect.width,
+            content_rect.height - row_height,
+        );
+
+        Self {
+            summary_y: content_rect.y,
+            results: OutlinePanelLayout::new(results_rect, metrics),
+        }
+    }
+}
+
 /// Computed positions for a single tree node at a given depth and y.
 #[derive(Debug, Clone, Copy)]
 pub struct TreeNodePosition {
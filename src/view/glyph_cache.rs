@@ -0,0 +1,446 @@
+//! Packed glyph atlas
+//!
+//! Rasterized glyph coverage lives in one contiguous 8-bit buffer, packed
+//! into shelves (rows of glyphs of similar height), instead of one heap
+//! allocation per glyph. Lookups for printable ASCII at the current font size
+//! skip hashing through a direct-indexed table; everything else goes through
+//! a `HashMap` from key to slot.
+//!
+//! The atlas grows a shelf at a time up to a byte budget. Once it is full, the
+//! least recently used shelf tall enough for the new glyph is cleared and
+//! reused, so scrolling through CJK or emoji-heavy text keeps memory bounded.
+
+use std::collections::HashMap;
+
+use fontdue::Metrics;
+
+/// Cache key: the character and the font size's bit pattern
+pub type GlyphCacheKey = (char, u32);
+
+/// Width of the atlas in pixels (one byte each)
+pub const ATLAS_WIDTH: usize = 1024;
+
+/// Default coverage budget (4096 rows of `ATLAS_WIDTH`)
+pub const DEFAULT_ATLAS_BYTES: usize = 4 * 1024 * 1024;
+
+/// Shelf heights are rounded up to this, so glyphs of nearly equal height
+/// share shelves
+const SHELF_HEIGHT_STEP: usize = 4;
+
+/// Marks an empty entry in the ASCII table
+const NO_SLOT: u32 = u32::MAX;
+
+/// A cached glyph: its metrics and where its coverage sits in the atlas
+#[derive(Debug, Clone, Copy)]
+struct Slot {
+    key: GlyphCacheKey,
+    metrics: Metrics,
+    x: usize,
+    y: usize,
+    /// Owning shelf, or `None` for glyphs without coverage (spaces)
+    shelf: Option<usize>,
+}
+
+#[derive(Debug, Clone)]
+struct Shelf {
+    y: usize,
+    height: usize,
+    next_x: usize,
+    last_used: u64,
+    slots: Vec<u32>,
+}
+
+/// A glyph borrowed from the atlas
+#[derive(Debug, Clone, Copy)]
+pub struct Glyph<'a> {
+    pub metrics: Metrics,
+    /// Coverage rows, `ATLAS_WIDTH` apart
+    coverage: &'a [u8],
+}
+
+impl<'a> Glyph<'a> {
+    /// Coverage of bitmap row `y`, `metrics.width` bytes
+    #[inline]
+    pub fn row(&self, y: usize) -> &'a [u8] {
+        let start = y * ATLAS_WIDTH;
+        &self.coverage[start..start + self.metrics.width]
+    }
+
+    /// Coverage rows from top to bottom
+    #[inline]
+    pub fn rows(&self) -> impl Iterator<Item = &'a [u8]> + 'a {
+        let coverage = self.coverage;
+        let width = self.metrics.width;
+        (0..self.metrics.height).map(move |y| &coverage[y * ATLAS_WIDTH..y * ATLAS_WIDTH + width])
+    }
+}
+
+/// Glyph cache backed by a packed coverage atlas
+#[derive(Debug, Clone)]
+pub struct GlyphCache {
+    pixels: Vec<u8>,
+    max_rows: usize,
+    shelves: Vec<Shelf>,
+    slots: Vec<Slot>,
+    free_slots: Vec<u32>,
+    index: HashMap<GlyphCacheKey, u32>,
+    /// Slots for ASCII chars at `ascii_size`
+    ascii: [u32; 128],
+    ascii_size: u32,
+    /// Bumped on every lookup, for shelf LRU
+    clock: u64,
+}
+
+impl Default for GlyphCache {
+    fn default() -> Self {
+        Self::with_max_bytes(DEFAULT_ATLAS_BYTES)
+    }
+}
+
+impl GlyphCache {
+    /// Create an empty cache with the default budget
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Create an empty cache holding at most `max_bytes` of coverage
+    /// (rounded down to whole atlas rows)
+    pub fn with_max_bytes(max_bytes: usize) -> Self {
+        Self {
+            pixels: Vec::new(),
+            max_rows: max_bytes / ATLAS_WIDTH,
+            shelves: Vec::new(),
+            slots: Vec::new(),
+            free_slots: Vec::new(),
+            index: HashMap::new(),
+            ascii: [NO_SLOT; 128],
+            ascii_size: 0,
+            clock: 0,
+        }
+    }
+
+    /// Number of cached glyphs
+    pub fn len(&self) -> usize {
+        self.index.len()
+    }
+
+    /// Whether no glyphs are cached
+    pub fn is_empty(&self) -> bool {
+        self.index.is_empty()
+    }
+
+    /// Bytes of coverage currently allocated
+    pub fn memory_bytes(&self) -> usize {
+        self.pixels.len()
+    }
+
+    /// Whether `ch` at `size_bits` is cached
+    pub fn contains(&self, ch: char, size_bits: u32) -> bool {
+        self.index.contains_key(&(ch, size_bits))
+    }
+
+    /// Drop every cached glyph, keeping the allocations
+    pub fn clear(&mut self) {
+        self.pixels.clear();
+        self.shelves.clear();
+        self.slots.clear();
+        self.free_slots.clear();
+        self.index.clear();
+        self.ascii = [NO_SLOT; 128];
+    }
+
+    /// Look up `ch` at `size_bits`, calling `rasterize` to fill it in on a
+    /// miss. Returns the glyph and whether it was already cached.
+    #[inline]
+    pub fn get_or_insert_with(
+        &mut self,
+        ch: char,
+        size_bits: u32,
+        rasterize: impl FnOnce() -> (Metrics, Vec<u8>),
+    ) -> (Glyph<'_>, bool) {
+        self.clock += 1;
+        let (slot, hit) = match self.lookup(ch, size_bits) {
+            Some(slot) => (slot, true),
+            None => {
+                let (metrics, coverage) = rasterize();
+                (self.insert(ch, size_bits, metrics, &coverage), false)
+            }
+        };
+        let slot = self.slots[slot as usize];
+        if let Some(shelf) = slot.shelf {
+            self.shelves[shelf].last_used = self.clock;
+        }
+        (self.glyph(&slot), hit)
+    }
+
+    fn lookup(&mut self, ch: char, size_bits: u32) -> Option<u32> {
+        let Some(ascii) = ascii_index(ch) else {
+            return self.index.get(&(ch, size_bits)).copied();
+        };
+        if size_bits != self.ascii_size {
+            // The table only serves one size; follow whichever size is drawn
+            self.ascii = [NO_SLOT; 128];
+            self.ascii_size = size_bits;
+        }
+        match self.ascii[ascii] {
+            NO_SLOT => {
+                let slot = self.index.get(&(ch, size_bits)).copied()?;
+                self.ascii[ascii] = slot;
+                Some(slot)
+            }
+            slot => Some(slot),
+        }
+    }
+
+    fn glyph(&self, slot: &Slot) -> Glyph<'_> {
+        let metrics = slot.metrics;
+        let coverage = if metrics.width == 0 || metrics.height == 0 || slot.shelf.is_none() {
+            &[][..]
+        } else {
+            let start = slot.y * ATLAS_WIDTH + slot.x;
+            &self.pixels[start..start + (metrics.height - 1) * ATLAS_WIDTH + metrics.width]
+        };
+        let metrics = if coverage.is_empty() {
+            // Glyphs that didn't fit in the atlas draw as blank
+            Metrics {
+                width: 0,
+                height: 0,
+                ..metrics
+            }
+        } else {
+            metrics
+        };
+        Glyph { metrics, coverage }
+    }
+
+    fn insert(&mut self, ch: char, size_bits: u32, metrics: Metrics, coverage: &[u8]) -> u32 {
+        let (width, height) = (metrics.width, metrics.height);
+        let placed = if width == 0 || height == 0 || coverage.len() < width * height {
+            None
+        } else {
+            self.allocate(width, height)
+        };
+
+        let slot = Slot {
+            key: (ch, size_bits),
+            metrics,
+            x: placed.map_or(0, |(_, x, _)| x),
+            y: placed.map_or(0, |(_, _, y)| y),
+            shelf: placed.map(|(shelf, _, _)| shelf),
+        };
+        let id = match self.free_slots.pop() {
+            Some(id) => {
+                self.slots[id as usize] = slot;
+                id
+            }
+            None => {
+                self.slots.push(slot);
+                (self.slots.len() - 1) as u32
+            }
+        };
+
+        if let Some((shelf, x, y)) = placed {
+            self.shelves[shelf].slots.push(id);
+            for (row, src) in coverage.chunks_exact(width).take(height).enumerate() {
+                let start = (y + row) * ATLAS_WIDTH + x;
+                self.pixels[start..start + width].copy_from_slice(src);
+            }
+        }
+
+        self.index.insert((ch, size_bits), id);
+        if let Some(ascii) = ascii_index(ch).filter(|_| size_bits == self.ascii_size) {
+            self.ascii[ascii] = id;
+        }
+        id
+    }
+
+    /// Find room for a `width`×`height` glyph: `(shelf, x, y)`
+    fn allocate(&mut self, width: usize, height: usize) -> Option<(usize, usize, usize)> {
+        let shelf_height = height.div_ceil(SHELF_HEIGHT_STEP) * SHELF_HEIGHT_STEP;
+        if width > ATLAS_WIDTH || shelf_height > self.max_rows {
+            return None;
+        }
+
+        // Best fit among shelves with room left
+        let fit = self
+            .shelves
+            .iter()
+            .enumerate()
+            .filter(|(_, s)| s.height >= height && s.next_x + width <= ATLAS_WIDTH)
+            .filter(|(_, s)| s.height <= shelf_height * 2)
+            .min_by_key(|(_, s)| s.height)
+            .map(|(i, _)| i);
+        let shelf = match fit {
+            Some(i) => i,
+            None => self
+                .add_shelf(shelf_height)
+                .or_else(|| self.evict_shelf(height))
+                .or_else(|| {
+                    // Nothing tall enough to reuse: start over
+                    self.clear();
+                    self.add_shelf(shelf_height)
+                })?,
+        };
+
+        let s = &mut self.shelves[shelf];
+        let x = s.next_x;
+        s.next_x += width;
+        Some((shelf, x, s.y))
+    }
+
+    fn add_shelf(&mut self, height: usize) -> Option<usize> {
+        let y = self.shelves.last().map_or(0, |s| s.y + s.height);
+        if y + height > self.max_rows {
+            return None;
+        }
+        self.pixels.resize((y + height) * ATLAS_WIDTH, 0);
+        self.shelves.push(Shelf {
+            y,
+            height,
+            next_x: 0,
+            last_used: self.clock,
+            slots: Vec::new(),
+        });
+        Some(self.shelves.len() - 1)
+    }
+
+    /// Empty the least recently used shelf at least `height` tall
+    fn evict_shelf(&mut self, height: usize) -> Option<usize> {
+        let shelf = self
+            .shelves
+            .iter()
+            .enumerate()
+            .filter(|(_, s)| s.height >= height)
+            .min_by_key(|(_, s)| s.last_used)
+            .map(|(i, _)| i)?;
+
+        for id in std::mem::take(&mut self.shelves[shelf].slots) {
+            let key = self.slots[id as usize].key;
+            self.index.remove(&key);
+            if let Some(ascii) = ascii_index(key.0).filter(|_| key.1 == self.ascii_size) {
+                self.ascii[ascii] = NO_SLOT;
+            }
+            self.free_slots.push(id);
+        }
+        self.shelves[shelf].next_x = 0;
+        Some(shelf)
+    }
+}
+
+#[inline]
+fn ascii_index(ch: char) -> Option<usize> {
+    let code = ch as usize;
+    (code < 128).then_some(code)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Fake rasterizer: a `width`×`height` bitmap seeded by `seed`
+    fn bitmap(width: usize, height: usize, seed: u8) -> (Metrics, Vec<u8>) {
+        let metrics = Metrics {
+            width,
+            height,
+            advance_width: width as f32,
+            ..Metrics::default()
+        };
+        let coverage = (0..width * height)
+            .map(|i| (i as u8).wrapping_mul(31).wrapping_add(seed))
+            .collect();
+        (metrics, coverage)
+    }
+
+    fn coverage_of(glyph: &Glyph<'_>) -> Vec<u8> {
+        glyph.rows().flatten().copied().collect()
+    }
+
+    #[test]
+    fn test_glyph_round_trips_through_atlas() {
+        let mut cache = GlyphCache::new();
+        for (i, ch) in ['a', 'é', '日', '🦀'].into_iter().enumerate() {
+            let (width, height) = (5 + i * 3, 9 + i * 4);
+            let (glyph, hit) = cache.get_or_insert_with(ch, 16, || bitmap(width, height, i as u8));
+            assert!(!hit);
+            assert_eq!(coverage_of(&glyph), bitmap(width, height, i as u8).1);
+        }
+
+        let (glyph, hit) = cache.get_or_insert_with('日', 16, || unreachable!());
+        assert!(hit);
+        assert_eq!(coverage_of(&glyph), bitmap(11, 17, 2).1);
+        assert_eq!(glyph.row(1), &bitmap(11, 17, 2).1[11..22]);
+        assert_eq!(cache.len(), 4);
+    }
+
+    #[test]
+    fn test_ascii_fast_path_is_per_size() {
+        let mut cache = GlyphCache::new();
+        cache.get_or_insert_with('x', 14, || bitmap(6, 8, 1));
+        cache.get_or_insert_with('x', 20, || bitmap(9, 12, 2));
+
+        // Switching sizes must not hand out the other size's glyph
+        let (glyph, hit) = cache.get_or_insert_with('x', 14, || unreachable!());
+        assert!(hit);
+        assert_eq!(glyph.metrics.width, 6);
+        let (glyph, hit) = cache.get_or_insert_with('x', 20, || unreachable!());
+        assert!(hit);
+        assert_eq!(glyph.metrics.width, 9);
+    }
+
+    #[test]
+    fn test_blank_glyphs_take_no_atlas_space() {
+        let mut cache = GlyphCache::new();
+        let (glyph, _) = cache.get_or_insert_with(' ', 16, || bitmap(0, 0, 0));
+        assert_eq!(glyph.rows().count(), 0);
+        assert_eq!(cache.memory_bytes(), 0);
+        assert!(cache.contains(' ', 16));
+    }
+
+    #[test]
+    fn test_eviction_keeps_memory_under_budget() {
+        let budget = 64 * ATLAS_WIDTH;
+        let mut cache = GlyphCache::with_max_bytes(budget);
+        let mut rasterized = 0;
+
+        // Far more 16px-tall CJK glyphs than fit in four shelves
+        let cjk: Vec<char> = (0x4e00..0x4e00 + 2000).filter_map(char::from_u32).collect();
+        for (i, &ch) in cjk.iter().enumerate() {
+            let (glyph, _) = cache.get_or_insert_with(ch, 16, || {
+                rasterized += 1;
+                bitmap(14, 16, i as u8)
+            });
+            assert_eq!(coverage_of(&glyph), bitmap(14, 16, i as u8).1);
+            // Keep one glyph hot so its shelf is never the LRU one
+            cache.get_or_insert_with('a', 16, || bitmap(7, 16, 0));
+            assert!(cache.memory_bytes() <= budget);
+        }
+
+        assert_eq!(rasterized, 2000);
+        // The hot shelf survives; the others were recycled
+        assert!(cache.contains('a', 16));
+        assert!(cache.contains(cjk[0], 16));
+        assert!(!cache.contains(cjk[100], 16));
+        assert!(cache.contains(cjk[1999], 16));
+        assert!(cache.len() <= 4 * (ATLAS_WIDTH / 7));
+    }
+
+    #[test]
+    fn test_evicted_ascii_glyph_is_rasterized_again() {
+        let mut cache = GlyphCache::with_max_bytes(8 * ATLAS_WIDTH);
+        cache.get_or_insert_with('a', 16, || bitmap(ATLAS_WIDTH, 8, 1));
+        cache.get_or_insert_with('b', 16, || bitmap(ATLAS_WIDTH, 8, 2));
+        assert!(!cache.contains('a', 16));
+
+        let (glyph, hit) = cache.get_or_insert_with('a', 16, || bitmap(ATLAS_WIDTH, 8, 3));
+        assert!(!hit);
+        assert_eq!(coverage_of(&glyph), bitmap(ATLAS_WIDTH, 8, 3).1);
+    }
+
+    #[test]
+    fn test_oversized_glyph_draws_blank() {
+        let mut cache = GlyphCache::with_max_bytes(8 * ATLAS_WIDTH);
+        let (glyph, _) = cache.get_or_insert_with('W', 400, || bitmap(30, 40, 0));
+        assert_eq!(glyph.rows().count(), 0);
+        assert_eq!(glyph.metrics.advance_width, 30.0);
+    }
+}
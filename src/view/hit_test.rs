@@ -517,7 +517,7 @@ pub fn hit_test_modal(model: &AppModel, pt: Point) -> Option<HitTarget> {
             let (l, _) = super::geometry::theme_picker_layout(ww, wh, lh, visible_rows);
             l
         }
-        Some(ModalState::GotoLine(_)) => {
+        Some(ModalState::GotoLine(_)) | Some(ModalState::FindInFiles(_)) => {
             let (l, _) = super::geometry::goto_line_layout(ww, wh, lh);
             l
         }
@@ -0,0 +1,257 @@
+//! Rendered-pixel cache for editor text lines and terminal rows
+//!
+//! Each visible line of the text area is drawn into a band of the frame:
+//! background, selection and bracket decorations, then glyphs. The band's
+//! pixels depend only on the line's displayed text, its highlight tokens, its
+//! decorations and the theme/font state, so once drawn they can be kept and
+//! copied back on later frames instead of blending every glyph again.
+//!
+//! The caller hashes everything a band depends on into a `u64` key; keys are
+//! independent of the band's screen position, so scrolled lines and split
+//! panes showing the same text reuse the same entry. Bands not drawn for a
+//! while are dropped once the cache grows past its byte budget.
+//!
+//! The terminal panel draws its rows the same way, and also records which
+//! key each row position last showed ([`mark_drawn`](LineRenderCache::mark_drawn)),
+//! so that when only the terminal is damaged it can skip rows the back
+//! buffer already holds.
+
+use std::collections::HashMap;
+
+use super::frame::Frame;
+
+/// Screens' worth of band pixels kept before old bands are evicted
+pub const DEFAULT_BUDGET_SCREENS: usize = 2;
+
+#[derive(Debug)]
+struct CachedBand {
+    width: usize,
+    height: usize,
+    pixels: Vec<u32>,
+    last_used: u64,
+}
+
+/// Cache of rendered text-area line bands, keyed by content hash
+#[derive(Debug, Default)]
+pub struct LineRenderCache {
+    bands: HashMap<u64, CachedBand>,
+    /// Key of the band last drawn at each `(x, y)` that recorded one
+    drawn: HashMap<(usize, usize), u64>,
+    bytes: usize,
+    frame: u64,
+    hits: usize,
+    misses: usize,
+}
+
+impl LineRenderCache {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Number of cached bands
+    pub fn len(&self) -> usize {
+        self.bands.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.bands.is_empty()
+    }
+
+    /// Bytes of pixel data held
+    pub fn memory_bytes(&self) -> usize {
+        self.bytes
+    }
+
+    /// Start a new frame; bands used from here on count as most recent
+    pub fn begin_frame(&mut self) {
+        self.frame += 1;
+    }
+
+    /// Copy the band cached under `key` into the frame at `(x, y)`
+    ///
+    /// Returns false on a miss, or when the cached band has a different size
+    /// or would not fit in the frame, in which case the caller renders the
+    /// line and [`store`](Self::store)s it.
+    pub fn blit(
+        &mut self,
+        key: u64,
+        frame: &mut Frame,
+        x: usize,
+        y: usize,
+        width: usize,
+        height: usize,
+    ) -> bool {
+        if let Some(band) = self.bands.get_mut(&key) {
+            if band.width == width
+                && band.height == height
+                && frame.write_rect_px(x, y, width, height, &band.pixels)
+            {
+                band.last_used = self.frame;
+                self.hits += 1;
+                return true;
+            }
+        }
+        self.misses += 1;
+        false
+    }
+
+    /// Capture the band just rendered at `(x, y)` under `key`
+    pub fn store(
+        &mut self,
+        key: u64,
+        frame: &Frame,
+        x: usize,
+        y: usize,
+        width: usize,
+        height: usize,
+    ) {
+        let mut pixels = Vec::new();
+        if !frame.read_rect_px(x, y, width, height, &mut pixels) {
+            return;
+        }
+
+        self.bytes += pixels.len() * std::mem::size_of::<u32>();
+        let band = CachedBand {
+            width,
+            height,
+            pixels,
+            last_used: self.frame,
+        };
+        if let Some(old) = self.bands.insert(key, band) {
+            self.bytes -= old.pixels.len() * std::mem::size_of::<u32>();
+        }
+    }
+
+    /// Key of the band last [`mark_drawn`](Self::mark_drawn) at `(x, y)`
+    pub fn drawn_at(&self, x: usize, y: usize) -> Option<u64> {
+        self.drawn.get(&(x, y)).copied()
+    }
+
+    /// Record that the back buffer now holds the band for `key` at `(x, y)`
+    ///
+    /// Only meaningful while nothing else draws over that position; callers
+    /// compare against it only on frames that redraw nothing but their own
+    /// bands.
+    pub fn mark_drawn(&mut self, x: usize, y: usize, key: u64) {
+        self.drawn.insert((x, y), key);
+    }
+
+    /// Evict least recently used bands until at most `max_bytes` are held
+    ///
+    /// Bands used in the current frame are never evicted, so everything on
+    /// screen stays cached even when it alone exceeds the budget.
+    pub fn trim_to(&mut self, max_bytes: usize) {
+        if self.bytes <= max_bytes {
+            return;
+        }
+
+        let mut by_age: Vec<(u64, u64)> = self
+            .bands
+            .iter()
+            .map(|(&key, band)| (band.last_used, key))
+            .collect();
+        by_age.sort_unstable();
+
+        for (last_used, key) in by_age {
+            if self.bytes <= max_bytes || last_used == self.frame {
+                break;
+            }
+            if let Some(band) = self.bands.remove(&key) {
+                self.bytes -= band.pixels.len() * std::mem::size_of::<u32>();
+            }
+        }
+    }
+
+    /// Hits and misses since the last call
+    pub fn take_stats(&mut self) -> (usize, usize) {
+        (
+            std::mem::take(&mut self.hits),
+            std::mem::take(&mut self.misses),
+        )
+    }
+
+    pub fn clear(&mut self) {
+        self.bands.clear();
+        self.drawn.clear();
+        self.bytes = 0;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn frame_pixels(seed: u32) -> Vec<u32> {
+        (0..32 * 16).map(|i| i ^ seed).collect()
+    }
+
+    #[test]
+    fn test_store_then_blit_restores_band_at_new_position() {
+        let mut cache = LineRenderCache::new();
+        let mut source = frame_pixels(0xABCD);
+        let frame = Frame::new(&mut source, 32, 16);
+        cache.store(7, &frame, 4, 2, 20, 3);
+        assert_eq!(cache.len(), 1);
+        assert_eq!(cache.memory_bytes(), 20 * 3 * 4);
+
+        let mut target = vec![0; 32 * 16];
+        let mut frame = Frame::new(&mut target, 32, 16);
+        assert!(cache.blit(7, &mut frame, 4, 10, 20, 3));
+        for y in 0..3 {
+            for x in 4..24 {
+                assert_eq!(frame.get_pixel(x, 10 + y), source[(2 + y) * 32 + x]);
+            }
+        }
+
+        // Unknown keys and size mismatches miss
+        assert!(!cache.blit(8, &mut frame, 4, 10, 20, 3));
+        assert!(!cache.blit(7, &mut frame, 4, 10, 20, 2));
+        assert_eq!(cache.take_stats(), (1, 2));
+        assert_eq!(cache.take_stats(), (0, 0));
+    }
+
+    #[test]
+    fn test_trim_evicts_oldest_and_keeps_current_frame() {
+        let mut cache = LineRenderCache::new();
+        let mut source = frame_pixels(1);
+        let frame = Frame::new(&mut source, 32, 16);
+        let band_bytes = 32 * 4;
+
+        for key in 0..4 {
+            cache.begin_frame();
+            cache.store(key, &frame, 0, key as usize, 32, 1);
+        }
+        assert_eq!(cache.memory_bytes(), 4 * band_bytes);
+
+        cache.trim_to(2 * band_bytes);
+        assert_eq!(cache.len(), 2);
+        let mut target = vec![0; 32 * 16];
+        let mut target_frame = Frame::new(&mut target, 32, 16);
+        assert!(!cache.blit(0, &mut target_frame, 0, 0, 32, 1));
+        assert!(cache.blit(3, &mut target_frame, 0, 0, 32, 1));
+
+        // The band drawn this frame survives even a zero budget
+        cache.trim_to(0);
+        assert_eq!(cache.len(), 1);
+        assert_eq!(cache.memory_bytes(), band_bytes);
+
+        cache.clear();
+        assert!(cache.is_empty());
+        assert_eq!(cache.memory_bytes(), 0);
+    }
+
+    #[test]
+    fn test_drawn_slots_track_last_key_per_position() {
+        let mut cache = LineRenderCache::new();
+        assert_eq!(cache.drawn_at(0, 20), None);
+
+        cache.mark_drawn(0, 20, 5);
+        cache.mark_drawn(0, 20, 6);
+        cache.mark_drawn(0, 40, 5);
+        assert_eq!(cache.drawn_at(0, 20), Some(6));
+        assert_eq!(cache.drawn_at(0, 40), Some(5));
+
+        cache.clear();
+        assert_eq!(cache.drawn_at(0, 20), None);
+    }
+}
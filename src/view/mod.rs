@@ -2,16 +2,20 @@
 //!
 //! Contains the Renderer struct and all rendering-related functionality.
 
+pub mod blend;
 pub mod button;
 pub mod editor_scrollbars;
 pub mod editor_special_tabs;
 pub mod editor_text;
 pub mod frame;
 pub mod geometry;
+pub mod glyph_cache;
 pub mod helpers;
 pub mod hit_test;
+pub mod line_cache;
 pub mod modal;
 pub mod panels;
+pub mod present;
 pub mod scrollbar;
 pub mod selectable_list;
 pub mod text_field;
@@ -19,7 +23,9 @@ pub mod tree_view;
 
 pub use button::{button_rect, render_button, ButtonState};
 pub use frame::{Frame, TextPainter};
+pub use glyph_cache::{Glyph, GlyphCache, GlyphCacheKey};
 pub use helpers::get_tab_display_name;
+pub use line_cache::LineRenderCache;
 pub use text_field::{TextFieldContent, TextFieldOptions, TextFieldRenderer};
 
 // Re-export geometry helpers for backward compatibility
@@ -34,15 +40,15 @@ pub use hit_test::{
 };
 
 use anyhow::Result;
-use fontdue::{Font, FontSettings, LineMetrics, Metrics};
+use fontdue::{Font, FontSettings, LineMetrics};
 use softbuffer::Surface;
-use std::collections::HashMap;
 use std::num::NonZeroU32;
 use std::rc::Rc;
 use winit::window::Window;
 
 use crate::commands::{Damage, DamageArea};
 use crate::model::editor_area::{EditorGroup, GroupId, Rect, SplitterBar};
+use present::{DirtyRect, PresentHistory};
 
 /// Check if the damage contains cursor lines (free function to avoid borrow issues)
 fn has_cursor_lines_damage(damage: &Damage) -> bool {
@@ -53,11 +59,17 @@ fn has_cursor_lines_damage(damage: &Damage) -> bool {
             .any(|a| matches!(a, DamageArea::CursorLines(_))),
     }
 }
-use crate::model::AppModel;
-
-pub type GlyphCacheKey = (char, u32);
 
-pub type GlyphCache = HashMap<GlyphCacheKey, (Metrics, Vec<u8>)>;
+/// A dirty rect as softbuffer damage; `None` if it is empty
+fn to_surface_rect(rect: &DirtyRect) -> Option<softbuffer::Rect> {
+    Some(softbuffer::Rect {
+        x: rect.x as u32,
+        y: rect.y as u32,
+        width: NonZeroU32::new(rect.width as u32)?,
+        height: NonZeroU32::new(rect.height as u32)?,
+    })
+}
+use crate::model::AppModel;
 
 /// Controls how preview panes render their content
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -76,6 +88,9 @@ struct RenderPlan {
     effective_damage: Damage,
     render_editor: bool,
     render_status_bar: bool,
+    /// Redraw just the terminal panel's changed rows (nothing else that
+    /// would repaint the docks is damaged)
+    render_terminal_rows: bool,
     cursor_lines_only: Option<Vec<usize>>,
     show_modal: bool,
     show_drop_overlay: bool,
@@ -108,6 +123,7 @@ impl<'buffer, 'a> RenderSession<'buffer, 'a> {
         window_height: usize,
         font: &'a Font,
         glyph_cache: &'a mut GlyphCache,
+        line_cache: &'a mut LineRenderCache,
         font_size: f32,
         ascent: f32,
         char_width: f32,
@@ -124,7 +140,8 @@ impl<'buffer, 'a> RenderSession<'buffer, 'a> {
                 ascent,
                 char_width,
                 line_height,
-            ),
+            )
+            .with_line_cache(line_cache),
             model,
             plan,
         }
@@ -182,6 +199,15 @@ impl<'buffer, 'a> RenderSession<'buffer, 'a> {
         );
     }
 
+    fn render_terminal_rows_phase(&mut self) {
+        panels::render_terminal_rows(
+            &mut self.frame,
+            &mut self.painter,
+            self.model,
+            &self.plan.window_layout,
+        );
+    }
+
     fn render_status_bar_phase(&mut self) {
         Renderer::render_status_bar(
             &mut self.frame,
@@ -413,7 +439,7 @@ impl<'a> EditorGroupScene<'a> {
             }
             EditorContentKind::Image { state } => {
                 perf.measure_stage(crate::perf::PerfStage::Image, || {
-                    Renderer::render_image_tab(frame, model, state, &self.layout);
+                    Renderer::render_image_tab(frame, painter, model, state, &self.layout);
                 });
             }
             EditorContentKind::BinaryPlaceholder { placeholder } => {
@@ -538,7 +564,9 @@ impl<'a> PreviewPaneScene<'a> {
 
 pub struct Renderer {
     font: Font,
-    surface: Surface<Rc<Window>, Rc<Window>>,
+    /// Window surface frames are presented to; `None` for a headless
+    /// renderer, which only draws into the back buffer
+    surface: Option<Surface<Rc<Window>, Rc<Window>>>,
     /// Persistent back buffer for partial rendering.
     /// Softbuffer doesn't guarantee buffer contents are preserved between frames,
     /// so we maintain our own buffer and copy to the surface on present.
@@ -548,6 +576,11 @@ pub struct Renderer {
     font_size: f32,
     line_metrics: LineMetrics,
     glyph_cache: GlyphCache,
+    /// Rendered editor text lines, reused across frames
+    line_cache: LineRenderCache,
+    /// Damage of recent presents, for copying only what an aged surface
+    /// buffer is missing
+    present_history: PresentHistory,
     char_width: f32,
     scale_factor: f64,
 }
@@ -582,6 +615,23 @@ impl Renderer {
             )
             .map_err(|e| anyhow::anyhow!("Failed to resize surface: {}", e))?;
 
+        Self::with_surface(Some(surface), width, height, scale_factor)
+    }
+
+    /// Create a renderer without a window, for profiling and replay
+    ///
+    /// Frames go through the same render path as on screen but stop at the
+    /// back buffer (see [`back_buffer`](Self::back_buffer)).
+    pub fn headless(width: u32, height: u32, scale_factor: f64) -> Result<Self> {
+        Self::with_surface(None, width, height, scale_factor)
+    }
+
+    fn with_surface(
+        surface: Option<Surface<Rc<Window>, Rc<Window>>>,
+        width: u32,
+        height: u32,
+        scale_factor: f64,
+    ) -> Result<Self> {
         let font = Font::from_bytes(
             include_bytes!("../../assets/JetBrainsMono.ttf") as &[u8],
             FontSettings::default(),
@@ -609,7 +659,9 @@ impl Renderer {
             height,
             font_size,
             line_metrics,
-            glyph_cache: HashMap::new(),
+            glyph_cache: GlyphCache::new(),
+            line_cache: LineRenderCache::new(),
+            present_history: PresentHistory::new(),
             char_width,
             scale_factor,
         })
@@ -632,6 +684,11 @@ impl Renderer {
         (self.width, self.height)
     }
 
+    /// The last rendered frame, in `0xAARRGGBB` pixels
+    pub fn back_buffer(&self) -> &[u32] {
+        &self.back_buffer
+    }
+
     // =========================================================================
     // Damage Tracking Helpers
     // =========================================================================
@@ -673,6 +730,62 @@ impl Renderer {
         damage.clone()
     }
 
+    /// Window pixels a frame drawn from `plan` may have changed, or `None`
+    /// when the whole frame has to be presented
+    ///
+    /// Mirrors what the render phases draw: the cursor-lines fast path
+    /// repaints line bands of the focused group (the scrollbars it redraws
+    /// on top come out identical outside them), an editor redraw covers
+    /// everything above the status bar, and overlays force a full frame.
+    fn damaged_rects(
+        model: &AppModel,
+        plan: &RenderPlan,
+        char_width: f32,
+        line_height: usize,
+    ) -> Option<Vec<DirtyRect>> {
+        if cfg!(feature = "damage-debug")
+            || plan.effective_damage.is_full()
+            || plan.show_modal
+            || plan.show_drop_overlay
+            || plan.show_tab_drag_ghost
+        {
+            return None;
+        }
+        #[cfg(debug_assertions)]
+        if plan.show_perf_overlay || plan.show_debug_overlay {
+            return None;
+        }
+
+        let layout = &plan.window_layout;
+        let mut rects: Vec<Rect> = Vec::new();
+        if let Some(dirty_lines) = &plan.cursor_lines_only {
+            rects.extend(editor_text::cursor_lines_damage_rects(
+                model,
+                dirty_lines,
+                char_width,
+                line_height,
+            ));
+        } else {
+            if plan.render_editor {
+                rects.push(layout.content_rect);
+            } else if plan.render_terminal_rows {
+                rects.extend(panels::terminal_dock(model, layout).map(|(_, rect)| rect));
+            }
+            if plan.render_status_bar {
+                rects.push(layout.status_bar_rect);
+            }
+        }
+
+        Some(
+            rects
+                .into_iter()
+                .filter_map(|rect| {
+                    DirtyRect::from_rect(rect, plan.window_width, plan.window_height)
+                })
+                .collect(),
+        )
+    }
+
     #[allow(clippy::too_many_arguments)]
     fn build_render_plan(
         &self,
@@ -691,6 +804,8 @@ impl Renderer {
         model
             .editor_area
             .sync_all_viewports(line_height, char_width, &model.metrics);
+        model.editor_area.sync_visible_line_columns();
+        model.editor_area.sync_image_mips();
 
         let effective_damage = self.compute_effective_damage(damage, model, show_perf_overlay);
         let render_editor = effective_damage.is_full()
@@ -698,6 +813,7 @@ impl Renderer {
             || has_cursor_lines_damage(&effective_damage);
         let render_status_bar =
             effective_damage.is_full() || effective_damage.includes_status_bar();
+        let render_terminal_rows = !render_editor && effective_damage.includes_terminal();
 
         let is_text_mode = model
             .editor_area
@@ -722,6 +838,7 @@ impl Renderer {
             effective_damage,
             render_editor,
             render_status_bar,
+            render_terminal_rows,
             cursor_lines_only,
             show_modal: model.ui.active_modal.is_some(),
             show_drop_overlay: model.ui.drop_state.is_hovering,
@@ -1130,11 +1247,18 @@ impl Renderer {
 
     fn render_image_tab(
         frame: &mut Frame,
+        painter: &mut TextPainter,
         model: &AppModel,
         img_state: &crate::image::ImageState,
         layout: &geometry::GroupLayout,
     ) {
-        editor_special_tabs::render_image_tab(frame, model, img_state, layout);
+        editor_special_tabs::render_image_tab(
+            frame,
+            model,
+            img_state,
+            layout,
+            painter.line_cache_mut(),
+        );
     }
 
     #[allow(clippy::too_many_arguments)]
@@ -1401,6 +1525,10 @@ impl Renderer {
         }
 
         // Draw cells
+        let last_visible_col = layout
+            .visible_columns
+            .last()
+            .map_or(0, |&(col_idx, _)| col_idx + 1);
         for screen_row in 0..visible_rows {
             let data_row = csv.viewport.top_row + screen_row;
             if data_row >= csv.data.row_count() {
@@ -1409,11 +1537,18 @@ impl Renderer {
 
             let y = layout.data_y + screen_row * line_height;
 
+            // Split the row once rather than re-scanning it for every column
+            let cells: Vec<_> = csv
+                .data
+                .row_cells(data_row)
+                .take(last_visible_col)
+                .collect();
+
             for (i, &(col_idx, col_x)) in layout.visible_columns.iter().enumerate() {
                 let col_width_px = layout.column_widths_px.get(i).copied().unwrap_or(50);
                 let col_width_chars = csv.column_widths.get(col_idx).copied().unwrap_or(10);
 
-                let cell_value = csv.data.get(data_row, col_idx);
+                let cell_value = cells.get(col_idx).map_or("", |cell| cell.as_ref());
                 let display_text = truncate_text(cell_value, col_width_chars);
 
                 // Determine color and alignment
@@ -1697,12 +1832,15 @@ impl Renderer {
             // Resize back buffer to match new window size
             let new_size = (self.width as usize) * (self.height as usize);
             self.back_buffer.resize(new_size, 0);
-
-            let width = NonZeroU32::new(self.width.max(1)).unwrap();
-            let height = NonZeroU32::new(self.height.max(1)).unwrap();
-            self.surface
-                .resize(width, height)
-                .map_err(|e| anyhow::anyhow!("Failed to resize surface: {}", e))?;
+            self.present_history.clear();
+
+            if let Some(surface) = &mut self.surface {
+                let width = NonZeroU32::new(self.width.max(1)).unwrap();
+                let height = NonZeroU32::new(self.height.max(1)).unwrap();
+                surface
+                    .resize(width, height)
+                    .map_err(|e| anyhow::anyhow!("Failed to resize surface: {}", e))?;
+            }
         }
 
         let line_height = self.line_metrics.new_line_size.ceil() as usize;
@@ -1730,6 +1868,7 @@ impl Renderer {
 
         // All rendering happens to back_buffer (persistent between frames).
         // At the end, we copy to the surface buffer and present.
+        self.line_cache.begin_frame();
         if !plan.uses_cursor_lines_fast_path() {
             perf.measure_stage(crate::perf::PerfStage::Clear, || {
                 self.clear_back_buffer(model, &plan);
@@ -1745,7 +1884,8 @@ impl Renderer {
                 ascent,
                 char_width,
                 line_height,
-            );
+            )
+            .with_line_cache(&mut self.line_cache);
             perf.measure_stage(crate::perf::PerfStage::CursorFastPath, || {
                 editor_text::render_cursor_lines_only(&mut frame, &mut painter, model, dirty_lines);
             });
@@ -1773,6 +1913,7 @@ impl Renderer {
                 height_usize,
                 &self.font,
                 &mut self.glyph_cache,
+                &mut self.line_cache,
                 font_size,
                 ascent,
                 char_width,
@@ -1800,6 +1941,12 @@ impl Renderer {
                 }
             }
 
+            if plan.render_terminal_rows {
+                perf.measure_stage(crate::perf::PerfStage::BottomDock, || {
+                    session.render_terminal_rows_phase();
+                });
+            }
+
             if plan.render_status_bar {
                 perf.measure_stage(crate::perf::PerfStage::StatusBar, || {
                     session.render_status_bar_phase();
@@ -1838,6 +1985,16 @@ impl Renderer {
             session.record_cache_stats(perf);
         }
 
+        let (line_hits, line_misses) = self.line_cache.take_stats();
+        perf.add_line_cache_stats(line_hits, line_misses);
+        self.line_cache.trim_to(
+            width_usize
+                * height_usize
+                * std::mem::size_of::<u32>()
+                * line_cache::DEFAULT_BUDGET_SCREENS,
+        );
+        model.memory.glyph_cache_bytes = self.glyph_cache.memory_bytes();
+
         // Debug: visualize damage regions with colored outlines
         #[cfg(feature = "damage-debug")]
         {
@@ -1854,22 +2011,41 @@ impl Renderer {
             );
         }
 
-        // Copy back buffer to surface and present
-        {
-            let mut buffer = perf.measure_stage(crate::perf::PerfStage::SurfaceAcquire, || {
-                self.surface
-                    .buffer_mut()
-                    .map_err(|e| anyhow::anyhow!("Failed to get surface buffer: {}", e))
-            })?;
-            perf.measure_stage(crate::perf::PerfStage::BufferCopy, || {
-                buffer.copy_from_slice(&self.back_buffer);
-            });
-            perf.measure_stage(crate::perf::PerfStage::SurfacePresent, || {
-                buffer
-                    .present()
-                    .map_err(|e| anyhow::anyhow!("Failed to present buffer: {}", e))
-            })?;
+        // Copy the damaged part of the back buffer to the surface and
+        // present it
+        let dirty = Self::damaged_rects(model, &plan, char_width, line_height);
+        if dirty.as_ref().is_some_and(Vec::is_empty) {
+            // Nothing on screen changed
+            return Ok(());
         }
+        self.present_history.push(dirty.clone());
+        let Some(surface) = &mut self.surface else {
+            return Ok(());
+        };
+
+        let mut buffer = perf.measure_stage(crate::perf::PerfStage::SurfaceAcquire, || {
+            surface
+                .buffer_mut()
+                .map_err(|e| anyhow::anyhow!("Failed to get surface buffer: {}", e))
+        })?;
+        let copy = self
+            .present_history
+            .rects_for_age(buffer.age(), self.back_buffer.len());
+        perf.measure_stage(crate::perf::PerfStage::BufferCopy, || match &copy {
+            Some(rects) => present::copy_rects(&self.back_buffer, &mut buffer, width_usize, rects),
+            None => buffer.copy_from_slice(&self.back_buffer),
+        });
+        perf.measure_stage(crate::perf::PerfStage::SurfacePresent, || {
+            match dirty {
+                Some(rects) => {
+                    let damage: Vec<softbuffer::Rect> =
+                        rects.iter().filter_map(to_surface_rect).collect();
+                    buffer.present_with_damage(&damage)
+                }
+                None => buffer.present(),
+            }
+            .map_err(|e| anyhow::anyhow!("Failed to present buffer: {}", e))
+        })?;
 
         Ok(())
     }
@@ -1961,6 +2137,10 @@ impl Renderer {
                                 }
                             }
                         }
+                        DamageArea::Terminal => {
+                            // Terminal rows are redrawn in place inside the
+                            // dock and aren't outlined
+                        }
                     }
                 }
             }
@@ -2333,3 +2513,109 @@ mod cursor_fast_path_scrollbar_tests {
         );
     }
 }
+
+#[cfg(test)]
+mod partial_present_tests {
+    use super::*;
+    use crate::messages::{Msg, UiMsg};
+    use crate::update::update;
+
+    fn headless_model(width: u32, height: u32) -> (Renderer, AppModel) {
+        let renderer = Renderer::headless(width, height, 1.0).expect("headless renderer");
+        let mut model = AppModel::new(width, height, 1.0, vec![]);
+        model.set_char_width(renderer.char_width());
+        model.line_height = renderer.line_height();
+        model.recompute_tab_bar_height_from_line_height();
+        model.resize(width, height);
+
+        let mut text = String::new();
+        for i in 0..100 {
+            text.push_str(&format!("fn line_{i}() {{}}\n"));
+        }
+        model.document_mut().buffer = ropey::Rope::from(text.as_str());
+        (renderer, model)
+    }
+
+    /// Render `msg`'s damage and check every pixel that changed lies inside
+    /// the rects the frame reported; returns those rects
+    fn render_and_check(renderer: &mut Renderer, model: &mut AppModel, msg: Msg) -> Vec<DirtyRect> {
+        let (width, height) = renderer.dimensions();
+        let before = renderer.back_buffer().to_vec();
+        let damage = update(model, msg).expect("message should redraw").damage();
+        let mut perf = crate::perf::PerfStats::default();
+        renderer.render(model, &mut perf, &damage).unwrap();
+
+        let rects = renderer
+            .present_history
+            .rects_for_age(1, (width * height) as usize)
+            .expect("partial damage should not present the whole frame");
+        let after = renderer.back_buffer();
+        let mut changed = 0;
+        for (index, (old, new)) in before.iter().zip(after).enumerate() {
+            if old == new {
+                continue;
+            }
+            changed += 1;
+            let (x, y) = (index % width as usize, index / width as usize);
+            assert!(
+                rects.iter().any(|r| r.contains(&DirtyRect {
+                    x,
+                    y,
+                    width: 1,
+                    height: 1
+                })),
+                "pixel ({x}, {y}) changed outside the damage rects {rects:?}"
+            );
+        }
+        assert!(changed > 0, "the message should have changed some pixels");
+        rects
+    }
+
+    #[test]
+    fn cursor_blink_presents_only_the_cursor_line() {
+        let (mut renderer, mut model) = headless_model(640, 480);
+        let mut perf = crate::perf::PerfStats::default();
+        renderer
+            .render(&mut model, &mut perf, &Damage::Full)
+            .unwrap();
+
+        // Make the next blink tick toggle the cursor
+        model.config.cursor_blink_ms = 0;
+        let rects = render_and_check(&mut renderer, &mut model, Msg::Ui(UiMsg::BlinkCursor));
+
+        let area: usize = rects.iter().map(DirtyRect::area).sum();
+        assert_eq!(rects.len(), 1);
+        assert_eq!(rects[0].height, renderer.line_height());
+        assert!(area * 20 < 640 * 480, "blink damage covers {area} pixels");
+    }
+
+    #[test]
+    fn status_message_presents_only_the_status_bar() {
+        let (mut renderer, mut model) = headless_model(640, 480);
+        let mut perf = crate::perf::PerfStats::default();
+        renderer
+            .render(&mut model, &mut perf, &Damage::Full)
+            .unwrap();
+
+        let rects = render_and_check(
+            &mut renderer,
+            &mut model,
+            Msg::Ui(UiMsg::SetStatus("Saved".to_string())),
+        );
+        let layout = geometry::WindowLayout::compute(&model, renderer.line_height());
+        assert_eq!(
+            rects,
+            vec![DirtyRect::from_rect(layout.status_bar_rect, 640, 480).unwrap()]
+        );
+    }
+
+    #[test]
+    fn full_damage_presents_the_whole_frame() {
+        let (mut renderer, mut model) = headless_model(320, 240);
+        let mut perf = crate::perf::PerfStats::default();
+        renderer
+            .render(&mut model, &mut perf, &Damage::Full)
+            .unwrap();
+        assert_eq!(renderer.present_history.rects_for_age(1, 320 * 240), None);
+    }
+}
@@ -289,6 +289,47 @@ fn render_goto_line_modal(
     );
 }
 
+fn render_find_in_files_modal(
+    frame: &mut Frame,
+    painter: &mut TextPainter,
+    model: &AppModel,
+    state: &crate::model::FindInFilesModalState,
+    ctx: &ModalRenderCtx,
+) {
+    let colors = &ctx.colors;
+    let line_height = ctx.line_height;
+    let char_width = ctx.char_width;
+
+    // Same shape as Go to Line: a title above a single input
+    let (layout, w) = geometry::goto_line_layout(ctx.window_width, ctx.window_height, line_height);
+
+    render_modal_shell(frame, &layout, colors);
+
+    let title_r = layout.widget(w.title);
+    let results = &model.find_in_files;
+    let title = if results.query.is_empty() {
+        "Find in Files".to_string()
+    } else {
+        format!("Find in Files: {}", super::panels::search_summary(results))
+    };
+    painter.draw(frame, title_r.x, title_r.y, &title, colors.fg);
+
+    let input_r = layout.widget(w.input);
+    TextFieldRenderer::render_modal_input(
+        frame,
+        painter,
+        &state.editable,
+        input_r,
+        line_height,
+        char_width,
+        colors.input_bg,
+        colors.fg,
+        colors.highlight,
+        colors.selection_bg,
+        model.ui.cursor_visible,
+    );
+}
+
 fn render_find_replace_modal(
     frame: &mut Frame,
     painter: &mut TextPainter,
@@ -317,7 +358,17 @@ fn render_find_replace_modal(
     } else {
         "Find"
     };
-    painter.draw(frame, title_r.x, title_r.y, title, colors.fg);
+    // The update loop keeps the query's matches indexed, so the count is a
+    // lookup rather than a search
+    let count = model
+        .try_document()
+        .and_then(|doc| doc.cached_match_count(&state.query(), state.case_sensitive));
+    let title = match count {
+        Some(1) => format!("{} (1 match)", title),
+        Some(count) => format!("{} ({} matches)", title, count),
+        None => title.to_string(),
+    };
+    painter.draw(frame, title_r.x, title_r.y, &title, colors.fg);
 
     if let Some(label_idx) = w.find_label {
         let label_r = layout.widget(label_idx);
@@ -598,6 +649,9 @@ pub fn render_modals(
         ModalState::RecentFiles(state) => {
             render_recent_files_modal(frame, painter, model, state, &ctx)
         }
+        ModalState::FindInFiles(state) => {
+            render_find_in_files_modal(frame, painter, model, state, &ctx)
+        }
     }
 }
 
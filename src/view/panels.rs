@@ -1,14 +1,18 @@
-//! Panel rendering: sidebar file tree, dock panels, and outline panel
+//! Panel rendering: sidebar file tree, dock panels, outline and search panels
 
 use crate::model::editor_area::Rect;
-use crate::model::AppModel;
+use crate::model::find_in_files::SearchResultRow;
+use crate::model::{AppModel, FindInFilesState};
 
 use super::frame::{Frame, TextPainter};
-use super::geometry::{DockHeaderLayout, OutlinePanelLayout, TreeListLayout};
+use super::geometry::{
+    DockHeaderLayout, OutlinePanelLayout, SearchPanelLayout, TreeListLayout, WindowLayout,
+};
 use super::tree_view::{render_tree, TreeRenderLayout};
 
 enum DockContentKind {
     Outline,
+    Search,
     Terminal,
     Placeholder { message: &'static str },
 }
@@ -38,6 +42,7 @@ impl DockPaneScene {
             .unwrap_or(crate::panel::PanelId::TERMINAL);
         let content = match active_panel {
             crate::panel::PanelId::Outline => DockContentKind::Outline,
+            crate::panel::PanelId::Search => DockContentKind::Search,
             crate::panel::PanelId::Terminal => DockContentKind::Terminal,
             _ => {
                 let placeholder = crate::panels::PlaceholderPanel::new(active_panel);
@@ -73,6 +78,15 @@ impl DockPaneScene {
                     self.text_color,
                 );
             }
+            DockContentKind::Search => {
+                render_search_panel(
+                    frame,
+                    painter,
+                    model,
+                    self.layout.content_rect,
+                    self.text_color,
+                );
+            }
             DockContentKind::Terminal => {
                 crate::panels::terminal::render_terminal_panel(
                     frame,
@@ -338,6 +352,43 @@ pub fn render_dock(
     scene.render(frame, painter, model);
 }
 
+/// The open dock showing the terminal panel and its rect, if any
+pub fn terminal_dock(
+    model: &AppModel,
+    window_layout: &WindowLayout,
+) -> Option<(crate::panel::DockPosition, Rect)> {
+    let position = model
+        .dock_layout
+        .showing_panel(crate::panel::PanelId::TERMINAL)?;
+    let rect = match position {
+        crate::panel::DockPosition::Left => None,
+        crate::panel::DockPosition::Right => window_layout.right_dock_rect,
+        crate::panel::DockPosition::Bottom => window_layout.bottom_dock_rect,
+    }?;
+    Some((position, rect))
+}
+
+/// Redraw the changed rows of the terminal panel, when it is showing in an
+/// open dock, without repainting the dock around it
+pub fn render_terminal_rows(
+    frame: &mut Frame,
+    painter: &mut TextPainter,
+    model: &AppModel,
+    window_layout: &WindowLayout,
+) {
+    let Some((position, rect)) = terminal_dock(model, window_layout) else {
+        return;
+    };
+
+    let layout = DockHeaderLayout::new(
+        model.dock_layout.dock(position),
+        rect,
+        &model.metrics,
+        model.char_width,
+    );
+    crate::panels::terminal::render_terminal_rows(frame, painter, model, layout.content_rect);
+}
+
 /// Compute the scroll offset that keeps `selected_index` visible within a
 /// window of `visible_capacity` rows, starting from the model's last-known
 /// `scroll_offset`.
@@ -498,6 +549,158 @@ pub fn render_outline_panel(
     );
 }
 
+/// One-line summary of a find-in-files search, e.g. "12 matches in 3 files"
+pub fn search_summary(state: &FindInFilesState) -> String {
+    if state.query.is_empty() {
+        return "Type to search the workspace".to_string();
+    }
+    if state.results.is_empty() {
+        return if state.searching {
+            "Searching\u{2026}".to_string()
+        } else {
+            "No results".to_string()
+        };
+    }
+
+    let plural = |n: usize| if n == 1 { "" } else { "s" };
+    let mut summary = format!(
+        "{} match{} in {} file{}",
+        state.match_count,
+        if state.match_count == 1 { "" } else { "es" },
+        state.results.len(),
+        plural(state.results.len())
+    );
+    if state.truncated {
+        summary.push_str(" (limited)");
+    }
+    if state.searching {
+        summary.push('\u{2026}');
+    }
+    summary
+}
+
+/// Render the find-in-files panel: a summary row, then each file with
+/// matches followed by its matching lines
+pub fn render_search_panel(
+    frame: &mut Frame,
+    painter: &mut TextPainter,
+    model: &AppModel,
+    rect: Rect,
+    text_color: u32,
+) {
+    let theme = &model.theme.sidebar;
+    let selection_bg = theme.selection_background.to_argb_u32();
+    let selection_fg = theme.selection_foreground.to_argb_u32();
+    let dim_color = theme.folder_icon.to_argb_u32();
+    let match_bg = model.theme.editor.selection_background.to_argb_u32();
+
+    let state = &model.find_in_files;
+    let layout = SearchPanelLayout::new(rect, &model.metrics);
+    let results = layout.results;
+    let char_w = painter.char_width() as usize;
+    let container_width = rect.x as usize + rect.width as usize;
+
+    let summary_pos = results.tree.node_position(0, layout.summary_y as usize);
+    painter.draw(
+        frame,
+        summary_pos.text_x + rect.x as usize,
+        summary_pos.text_y,
+        &search_summary(state),
+        dim_color,
+    );
+
+    let scroll_offset = resolve_outline_scroll_offset(
+        state.scroll_offset,
+        state.selected_index,
+        results.visible_capacity(),
+    );
+    let root = model.workspace.as_ref().map(|ws| ws.root.as_path());
+
+    frame.set_clip(results.content_rect);
+    let rows = state
+        .rows_from(scroll_offset)
+        .take(results.visible_capacity() + 1);
+    for (visual_row, row) in rows.enumerate() {
+        let index = scroll_offset + visual_row;
+        let row_y = results.content_rect.y as usize + visual_row * results.row_height;
+        let is_selected = state.selected_index == Some(index);
+        if is_selected {
+            frame.fill_rect_blended(
+                Rect::new(
+                    results.content_rect.x,
+                    row_y as f32,
+                    results.content_rect.width,
+                    results.row_height as f32,
+                ),
+                selection_bg,
+            );
+        }
+        let fg = if is_selected {
+            selection_fg
+        } else {
+            text_color
+        };
+        let dim = if is_selected { selection_fg } else { dim_color };
+
+        match row {
+            SearchResultRow::File(file) => {
+                let pos = results.tree.node_position(0, row_y);
+                let text_x = pos.text_x + rect.x as usize;
+                let path = root
+                    .and_then(|root| file.path.strip_prefix(root).ok())
+                    .unwrap_or(&file.path)
+                    .display()
+                    .to_string();
+                let count = format!(" ({})", file.match_count());
+                let available = results.tree.available_text_width(container_width, text_x);
+                let max_chars = available
+                    .checked_div(char_w)
+                    .unwrap_or(80)
+                    .saturating_sub(count.len());
+
+                let display = truncate_with_ellipsis(&path, max_chars);
+                painter.draw(frame, text_x, pos.text_y, &display, fg);
+                let count_x = text_x + display.chars().count() * char_w;
+                painter.draw(frame, count_x, pos.text_y, &count, dim);
+            }
+            SearchResultRow::Line(_, line) => {
+                let pos = results.tree.node_position(1, row_y);
+                let text_x = pos.text_x + rect.x as usize;
+                let number = format!("{}: ", line.line + 1);
+                painter.draw(frame, text_x, pos.text_y, &number, dim);
+
+                let preview_x = text_x + number.len() * char_w;
+                let available = results
+                    .tree
+                    .available_text_width(container_width, preview_x);
+                let max_chars = available.checked_div(char_w).unwrap_or(80);
+                let display = truncate_with_ellipsis(&line.preview, max_chars);
+
+                if !is_selected {
+                    let shown = display.chars().count();
+                    for &(start, end) in &line.highlights {
+                        let end = end.min(shown);
+                        if start >= end {
+                            continue;
+                        }
+                        frame.fill_rect_blended(
+                            Rect::new(
+                                (preview_x + start * char_w) as f32,
+                                row_y as f32,
+                                ((end - start) * char_w) as f32,
+                                results.row_height as f32,
+                            ),
+                            match_bg,
+                        );
+                    }
+                }
+                painter.draw(frame, preview_x, pos.text_y, &display, fg);
+            }
+        }
+    }
+    frame.clear_clip();
+}
+
 #[cfg(test)]
 mod outline_scroll_tests {
     use super::resolve_outline_scroll_offset;
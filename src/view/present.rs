@@ -0,0 +1,229 @@
+//! Partial presentation of the back buffer
+//!
+//! Every frame is drawn into the renderer's persistent back buffer, and only
+//! the parts named by the frame's damage change. Copying the whole buffer to
+//! the window surface and presenting it whole costs a full framebuffer of
+//! bandwidth even for a cursor blink, so the renderer turns the damage into
+//! [`DirtyRect`]s, copies just those and presents them as damage.
+//!
+//! Surfaces may hand out a buffer that was presented a few frames ago
+//! (softbuffer's `Buffer::age`), so [`PresentHistory`] keeps the rects of
+//! the last few presents: bringing an `n`-frame-old buffer up to date means
+//! copying the union of the last `n` frames' rects. Buffers of unknown age
+//! get a full copy.
+
+use std::collections::VecDeque;
+
+use crate::model::editor_area::Rect;
+
+/// Presents remembered; older surface buffers get a full copy
+const MAX_BUFFER_AGE: usize = 3;
+
+/// Pixel rectangle of the frame, in window coordinates
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct DirtyRect {
+    pub x: usize,
+    pub y: usize,
+    pub width: usize,
+    pub height: usize,
+}
+
+impl DirtyRect {
+    /// Pixels covered by `rect`, rounded outward and clipped to the window;
+    /// `None` when nothing is left
+    pub fn from_rect(rect: Rect, window_width: usize, window_height: usize) -> Option<Self> {
+        let x0 = (rect.x.max(0.0).floor() as usize).min(window_width);
+        let y0 = (rect.y.max(0.0).floor() as usize).min(window_height);
+        let x1 = ((rect.x + rect.width).max(0.0).ceil() as usize).min(window_width);
+        let y1 = ((rect.y + rect.height).max(0.0).ceil() as usize).min(window_height);
+        (x1 > x0 && y1 > y0).then(|| Self {
+            x: x0,
+            y: y0,
+            width: x1 - x0,
+            height: y1 - y0,
+        })
+    }
+
+    pub fn area(&self) -> usize {
+        self.width * self.height
+    }
+
+    /// Whether `other` lies entirely inside this rect
+    pub fn contains(&self, other: &Self) -> bool {
+        other.x >= self.x
+            && other.y >= self.y
+            && other.x + other.width <= self.x + self.width
+            && other.y + other.height <= self.y + self.height
+    }
+}
+
+/// Drop rects covered by another rect in the list
+fn remove_covered(rects: &mut Vec<DirtyRect>) {
+    let mut index = 0;
+    while index < rects.len() {
+        let rect = rects[index];
+        let covered = rects
+            .iter()
+            .enumerate()
+            .any(|(other, r)| other != index && r.contains(&rect) && (r != &rect || other < index));
+        if covered {
+            rects.swap_remove(index);
+        } else {
+            index += 1;
+        }
+    }
+}
+
+/// Copy `rects` of a `stride`-pixel-wide frame from `src` to `dst`
+pub fn copy_rects(src: &[u32], dst: &mut [u32], stride: usize, rects: &[DirtyRect]) {
+    for rect in rects {
+        for row in rect.y..rect.y + rect.height {
+            let start = row * stride + rect.x;
+            let end = start + rect.width;
+            if end > src.len() || end > dst.len() {
+                break;
+            }
+            dst[start..end].copy_from_slice(&src[start..end]);
+        }
+    }
+}
+
+/// Rects changed by the most recent presents, newest first
+///
+/// `None` entries are presents of the whole frame.
+#[derive(Debug, Default)]
+pub struct PresentHistory {
+    frames: VecDeque<Option<Vec<DirtyRect>>>,
+}
+
+impl PresentHistory {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Record a present; `None` when the whole frame changed
+    pub fn push(&mut self, rects: Option<Vec<DirtyRect>>) {
+        self.frames.push_front(rects);
+        self.frames.truncate(MAX_BUFFER_AGE);
+    }
+
+    /// Forget all presents, e.g. after a resize
+    pub fn clear(&mut self) {
+        self.frames.clear();
+    }
+
+    /// Rects to copy into a surface buffer last presented `age` presents ago
+    /// (including the one being made) for it to match the back buffer, or
+    /// `None` when it needs a full copy
+    ///
+    /// `window_area` is the frame's pixel count; when the rects would cover
+    /// most of it, one contiguous full copy is cheaper.
+    pub fn rects_for_age(&self, age: u8, window_area: usize) -> Option<Vec<DirtyRect>> {
+        let age = age as usize;
+        if age == 0 || age > self.frames.len() {
+            return None;
+        }
+
+        let mut rects = Vec::new();
+        for frame in self.frames.iter().take(age) {
+            rects.extend_from_slice(frame.as_deref()?);
+        }
+        remove_covered(&mut rects);
+
+        let area: usize = rects.iter().map(DirtyRect::area).sum();
+        (area * 4 < window_area * 3).then_some(rects)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn rect(x: usize, y: usize, width: usize, height: usize) -> DirtyRect {
+        DirtyRect {
+            x,
+            y,
+            width,
+            height,
+        }
+    }
+
+    #[test]
+    fn test_from_rect_rounds_outward_and_clips() {
+        let dirty = DirtyRect::from_rect(Rect::new(10.5, 20.25, 30.0, 9.5), 100, 100);
+        assert_eq!(dirty, Some(rect(10, 20, 31, 10)));
+
+        let clipped = DirtyRect::from_rect(Rect::new(90.0, -5.0, 50.0, 10.0), 100, 100);
+        assert_eq!(clipped, Some(rect(90, 0, 10, 5)));
+
+        assert_eq!(
+            DirtyRect::from_rect(Rect::new(120.0, 0.0, 10.0, 10.0), 100, 100),
+            None
+        );
+    }
+
+    #[test]
+    fn test_copy_rects_leaves_other_pixels_alone() {
+        let src: Vec<u32> = (0..16).collect();
+        let mut dst = vec![u32::MAX; 16];
+        copy_rects(&src, &mut dst, 4, &[rect(1, 1, 2, 2)]);
+
+        let copied: Vec<usize> = (0..16).filter(|&i| dst[i] != u32::MAX).collect();
+        assert_eq!(copied, vec![5, 6, 9, 10]);
+        assert!(copied.iter().all(|&i| dst[i] == src[i]));
+    }
+
+    #[test]
+    fn test_history_unions_rects_of_buffer_age() {
+        let mut history = PresentHistory::new();
+        history.push(Some(vec![rect(0, 0, 10, 10)]));
+        history.push(Some(vec![rect(0, 20, 10, 10)]));
+
+        assert_eq!(
+            history.rects_for_age(1, 10_000),
+            Some(vec![rect(0, 20, 10, 10)])
+        );
+        let both = history.rects_for_age(2, 10_000).unwrap();
+        assert_eq!(both.len(), 2);
+        assert!(both.contains(&rect(0, 0, 10, 10)));
+
+        // Unknown or older than remembered
+        assert_eq!(history.rects_for_age(0, 10_000), None);
+        assert_eq!(history.rects_for_age(3, 10_000), None);
+    }
+
+    #[test]
+    fn test_history_falls_back_to_full_copy() {
+        let mut history = PresentHistory::new();
+        history.push(None);
+        history.push(Some(vec![rect(0, 0, 10, 10)]));
+        assert!(history.rects_for_age(1, 10_000).is_some());
+        // The frame before was presented whole
+        assert_eq!(history.rects_for_age(2, 10_000), None);
+
+        // Rects covering most of the window
+        history.push(Some(vec![rect(0, 0, 100, 80)]));
+        assert_eq!(history.rects_for_age(1, 10_000), None);
+
+        for _ in 0..MAX_BUFFER_AGE + 1 {
+            history.push(Some(vec![rect(0, 0, 1, 1)]));
+        }
+        assert!(history
+            .rects_for_age(MAX_BUFFER_AGE as u8, 10_000)
+            .is_some());
+        history.clear();
+        assert_eq!(history.rects_for_age(1, 10_000), None);
+    }
+
+    #[test]
+    fn test_covered_and_duplicate_rects_are_copied_once() {
+        let mut history = PresentHistory::new();
+        history.push(Some(vec![rect(0, 0, 50, 50), rect(10, 10, 5, 5)]));
+        history.push(Some(vec![rect(10, 10, 5, 5)]));
+        history.push(Some(vec![rect(0, 0, 50, 50)]));
+        assert_eq!(
+            history.rects_for_age(3, 10_000),
+            Some(vec![rect(0, 0, 50, 50)])
+        );
+    }
+}
@@ -2,6 +2,7 @@
 //! - FileLoaded resetting view_mode/tab_content for non-text tabs
 //! - OpenFileDialogResult preserving per-file commands
 //! - ReloadConfiguration triggering a full redraw
+//! - LargeFileChunk streaming large files in read-only
 
 mod common;
 
@@ -136,3 +137,133 @@ fn reload_configuration_returns_full_redraw() {
         cmd
     );
 }
+
+// ============================================================================
+// Large files stream in read-only, without syntax highlighting
+// ============================================================================
+
+#[test]
+fn large_file_streams_in_read_only_without_syntax() {
+    use std::fs;
+    use tempfile::tempdir;
+    use token::messages::{DocumentMsg, ModalMsg, UiMsg};
+    use token::model::{FindReplaceState, ModalState};
+
+    let mut model = test_model("hello\n", 0, 0);
+    model.config.large_file_threshold_mb = 1;
+
+    let dir = tempdir().expect("failed to create temp dir");
+    let path = dir.path().join("big.rs");
+    let text = "fn main() {}\n".repeat(100_000);
+    fs::write(&path, &text).unwrap();
+
+    let cmd = update(
+        &mut model,
+        Msg::App(AppMsg::OpenFileDialogResult {
+            paths: vec![path.clone()],
+        }),
+    );
+    let Some(Cmd::Batch(cmds)) = cmd else {
+        panic!("expected a batch of commands, got: {:?}", cmd);
+    };
+    let document_id = cmds
+        .iter()
+        .find_map(|c| match c {
+            Cmd::StreamLargeFile { document_id, .. } => Some(*document_id),
+            _ => None,
+        })
+        .expect("large file should be streamed in the background");
+    assert!(
+        !cmds
+            .iter()
+            .any(|c| matches!(c, Cmd::DebouncedSyntaxParse { .. })),
+        "large files should not be sent to the syntax worker, got: {:?}",
+        cmds
+    );
+    assert!(model.document().is_loading());
+
+    // First chunk shows up, but the buffer stays read-only
+    update(
+        &mut model,
+        Msg::App(AppMsg::LargeFileChunk {
+            document_id,
+            buffer: ropey::Rope::from_str(&text[..13_000]),
+            bytes_read: 13_000,
+            finished: false,
+        }),
+    );
+    assert_eq!(model.document().line_count(), 1_001);
+    update(&mut model, Msg::Document(DocumentMsg::InsertChar('x')));
+    assert_eq!(model.document().buffer.len_bytes(), 13_000);
+
+    // Find/replace edits the buffer directly, so it has its own guard
+    let mut find_replace = FindReplaceState::default();
+    find_replace.set_query("main");
+    find_replace.set_replacement("start");
+    model
+        .ui
+        .open_modal(ModalState::FindReplace(find_replace.clone()));
+    update(&mut model, Msg::Ui(UiMsg::Modal(ModalMsg::ReplaceAll)));
+    model.ui.open_modal(ModalState::FindReplace(find_replace));
+    update(
+        &mut model,
+        Msg::Ui(UiMsg::Modal(ModalMsg::ReplaceAndFindNext)),
+    );
+    assert_eq!(model.document().buffer.to_string(), text[..13_000]);
+    model.ui.close_modal();
+
+    update(
+        &mut model,
+        Msg::App(AppMsg::LargeFileChunk {
+            document_id,
+            buffer: ropey::Rope::from_str(&text),
+            bytes_read: text.len() as u64,
+            finished: true,
+        }),
+    );
+    assert!(!model.document().is_loading());
+    assert_eq!(model.document().buffer.len_bytes(), text.len());
+
+    update(&mut model, Msg::Document(DocumentMsg::InsertChar('x')));
+    assert_eq!(model.document().buffer.len_bytes(), text.len() + 1);
+}
+
+#[test]
+fn closing_a_loading_tab_stops_the_stream() {
+    use std::fs;
+    use std::sync::atomic::Ordering;
+    use tempfile::tempdir;
+    use token::messages::LayoutMsg;
+
+    let mut model = test_model("hello\n", 0, 0);
+    model.config.large_file_threshold_mb = 1;
+
+    let dir = tempdir().expect("failed to create temp dir");
+    let path = dir.path().join("big.log");
+    fs::write(&path, "line\n".repeat(300_000)).unwrap();
+
+    let cmd = update(
+        &mut model,
+        Msg::App(AppMsg::OpenFileDialogResult { paths: vec![path] }),
+    );
+    let Some(Cmd::Batch(cmds)) = cmd else {
+        panic!("expected a batch of commands, got: {:?}", cmd);
+    };
+    let cancel = cmds
+        .iter()
+        .find_map(|c| match c {
+            Cmd::StreamLargeFile { cancel, .. } => Some(cancel.clone()),
+            _ => None,
+        })
+        .expect("large file should be streamed in the background");
+    assert!(!cancel.load(Ordering::Relaxed));
+
+    let tab_id = model
+        .editor_area
+        .focused_group()
+        .and_then(|group| group.active_tab())
+        .expect("active tab")
+        .id;
+    update(&mut model, Msg::Layout(LayoutMsg::CloseTab(tab_id)));
+    assert!(cancel.load(Ordering::Relaxed));
+}
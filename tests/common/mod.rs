@@ -57,7 +57,9 @@ pub fn test_model(text: &str, line: usize, column: usize) -> AppModel {
         dock_layout: token::panel::DockLayout::default(),
         terminal: token::terminal::TerminalState::default(),
         outline_panel: token::model::OutlinePanelState::default(),
+        find_in_files: token::model::FindInFilesState::default(),
         recent_files: token::recent_files::RecentFiles::default(),
+        memory: token::memory::MemoryStats::default(),
         #[cfg(debug_assertions)]
         debug_overlay: None,
     }
@@ -124,7 +126,9 @@ pub fn test_model_with_selection(
         dock_layout: token::panel::DockLayout::default(),
         terminal: token::terminal::TerminalState::default(),
         outline_panel: token::model::OutlinePanelState::default(),
+        find_in_files: token::model::FindInFilesState::default(),
         recent_files: token::recent_files::RecentFiles::default(),
+        memory: token::memory::MemoryStats::default(),
         #[cfg(debug_assertions)]
         debug_overlay: None,
     }
@@ -188,7 +192,9 @@ pub fn test_model_multi_cursor(text: &str, positions: &[(usize, usize)]) -> AppM
         dock_layout: token::panel::DockLayout::default(),
         terminal: token::terminal::TerminalState::default(),
         outline_panel: token::model::OutlinePanelState::default(),
+        find_in_files: token::model::FindInFilesState::default(),
         recent_files: token::recent_files::RecentFiles::default(),
+        memory: token::memory::MemoryStats::default(),
         #[cfg(debug_assertions)]
         debug_overlay: None,
     }
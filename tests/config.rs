@@ -105,6 +105,8 @@ fn test_config_serialize_deserialize() {
         auto_surround: true,
         bracket_matching: true,
         show_scrollbar: true,
+        large_file_threshold_mb: 16,
+        memory_caps_mb: Default::default(),
     };
     let yaml = serde_yaml::to_string(&config).unwrap();
     let parsed: EditorConfig = serde_yaml::from_str(&yaml).unwrap();
@@ -131,6 +133,22 @@ fn test_config_cursor_blink_ms_default_when_missing() {
     assert_eq!(config.cursor_blink_ms, 600); // Should use default
 }
 
+#[test]
+fn test_config_memory_caps_deserialize() {
+    use token::memory::MemorySubsystem;
+
+    let config: EditorConfig = serde_yaml::from_str("theme: dark").unwrap();
+    assert!(config.memory_caps_mb.is_empty());
+
+    let yaml = "theme: dark\nmemory_caps_mb:\n  parser_cache: 256\n  glyph_cache: 8";
+    let config: EditorConfig = serde_yaml::from_str(yaml).unwrap();
+    assert_eq!(
+        config.memory_caps_mb.get(&MemorySubsystem::ParserCache),
+        Some(&256)
+    );
+    assert_eq!(config.memory_caps_mb.len(), 2);
+}
+
 // ========================================================================
 // ReloadResult Tests
 // ========================================================================
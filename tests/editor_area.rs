@@ -28,6 +28,37 @@ fn test_rect_contains() {
     assert!(!rect.contains(50.0, 70.0)); // At bottom edge
 }
 
+#[test]
+fn test_document_visible_only_in_active_tab() {
+    let mut area = create_test_editor_area();
+    let visible_doc = area.focused_document_id().unwrap();
+
+    // Open a second document in a background tab of the same group
+    let background_doc = area.next_document_id();
+    let mut document = Document::new();
+    document.id = Some(background_doc);
+    area.documents.insert(background_doc, document);
+    let editor_id = area.next_editor_id();
+    let mut editor = EditorState::new();
+    editor.id = Some(editor_id);
+    editor.document_id = Some(background_doc);
+    area.editors.insert(editor_id, editor);
+    let tab_id = area.next_tab_id();
+    area.focused_group_mut().unwrap().tabs.push(Tab {
+        id: tab_id,
+        editor_id,
+        is_pinned: false,
+        is_preview: false,
+    });
+
+    assert!(area.is_document_visible(visible_doc));
+    assert!(!area.is_document_visible(background_doc));
+
+    area.focused_group_mut().unwrap().active_tab_index = 1;
+    assert!(!area.is_document_visible(visible_doc));
+    assert!(area.is_document_visible(background_doc));
+}
+
 #[test]
 fn test_single_group_layout() {
     let mut area = create_test_editor_area();
@@ -2,8 +2,10 @@ mod common;
 
 use common::test_model;
 use std::path::Path;
-use token::image::ImageState;
+use token::image::{ImageData, ImageState, MipChain};
+use token::messages::{AppMsg, Msg};
 use token::model::{Rect, ViewMode};
+use token::update::update;
 use token::util::is_supported_image;
 
 #[test]
@@ -147,3 +149,60 @@ fn test_sync_all_viewports_does_not_override_user_zoomed_image_scale() {
     let image = model.editor().view_mode.as_image().unwrap();
     assert!((image.scale - 2.0).abs() < 1e-9);
 }
+
+#[test]
+fn test_decoded_image_replaces_loading_placeholder() {
+    let mut model = test_model("", 0, 0);
+    model.editor_mut().view_mode = ViewMode::Image(Box::new(ImageState::loading(
+        1000,
+        500,
+        0,
+        "PNG".into(),
+        400,
+        300,
+    )));
+    let document_id = model.editor().document_id.unwrap();
+    assert!(model.editor().view_mode.as_image().unwrap().is_loading());
+
+    let chain = MipChain::new(1000, 500, vec![255; 1000 * 500 * 4]);
+    let cmd = update(
+        &mut model,
+        Msg::App(AppMsg::ImageDecoded {
+            document_id,
+            result: Ok(chain),
+        }),
+    );
+    assert!(cmd.is_some_and(|cmd| cmd.needs_redraw()));
+
+    // Fitted at 40%, so the half-size level is built on arrival
+    let image = model.editor().view_mode.as_image().unwrap();
+    let mips = image.mips().expect("decoded pixels");
+    assert_eq!(mips.built_levels(), 2);
+    assert_eq!(mips.level(image.scale).1.width, 500);
+}
+
+#[test]
+fn test_failed_decode_is_reported() {
+    let mut model = test_model("", 0, 0);
+    model.editor_mut().view_mode = ViewMode::Image(Box::new(ImageState::loading(
+        10,
+        10,
+        0,
+        "PNG".into(),
+        400,
+        300,
+    )));
+    let document_id = model.editor().document_id.unwrap();
+
+    update(
+        &mut model,
+        Msg::App(AppMsg::ImageDecoded {
+            document_id,
+            result: Err("corrupt".into()),
+        }),
+    );
+
+    let image = model.editor().view_mode.as_image().unwrap();
+    assert!(matches!(image.data, ImageData::Failed(ref e) if e == "corrupt"));
+    assert!(model.ui.status_message.contains("corrupt"));
+}
@@ -0,0 +1,86 @@
+//! Memory accounting tests: per-subsystem measurement and parser cache
+//! eviction under a soft cap
+
+mod common;
+
+use common::test_model;
+use token::commands::Cmd;
+use token::memory::{MemorySubsystem, MemoryUsage};
+use token::messages::{Msg, SyntaxMsg};
+use token::model::editor_area::DocumentId;
+use token::update::update;
+
+const MB: usize = 1024 * 1024;
+
+fn report(worker: usize, documents: &[(u64, usize)]) -> Msg {
+    Msg::Syntax(SyntaxMsg::ParserCacheReport {
+        worker,
+        documents: documents
+            .iter()
+            .map(|&(id, bytes)| (DocumentId(id), bytes))
+            .collect(),
+    })
+}
+
+fn evicted(cmd: Option<Cmd>) -> Vec<u64> {
+    match cmd {
+        Some(Cmd::EvictSyntaxCache { document_ids }) => {
+            document_ids.into_iter().map(|id| id.0).collect()
+        }
+        None => Vec::new(),
+        other => panic!("unexpected command {:?}", other),
+    }
+}
+
+#[test]
+fn test_measure_counts_buffers_and_worker_reports() {
+    let mut model = test_model(&"hello world\n".repeat(1000), 0, 0);
+    update(&mut model, report(0, &[(1, 3 * MB)]));
+    update(&mut model, report(1, &[(8, MB)]));
+    model.memory.glyph_cache_bytes = 4096;
+
+    let usage = MemoryUsage::measure(&model);
+    assert!(usage.get(MemorySubsystem::Buffers) >= 12_000);
+    assert_eq!(usage.get(MemorySubsystem::ParserCache), 4 * MB);
+    assert_eq!(usage.get(MemorySubsystem::GlyphCache), 4096);
+    assert_eq!(usage.total(), usage.iter().map(|(_, bytes)| bytes).sum());
+
+    // A newer report replaces the worker's previous one
+    update(&mut model, report(1, &[]));
+    assert_eq!(model.memory.parser_cache_bytes(), 3 * MB);
+}
+
+#[test]
+fn test_reports_under_no_cap_evict_nothing() {
+    let mut model = test_model("hello\n", 0, 0);
+    let cmd = update(&mut model, report(0, &[(50, 100 * MB)]));
+    assert!(evicted(cmd).is_empty());
+}
+
+#[test]
+fn test_parser_cache_over_cap_evicts_background_documents_largest_first() {
+    let mut model = test_model("hello\n", 0, 0);
+    let visible = model.document().id.expect("document id").0;
+    model
+        .config
+        .memory_caps_mb
+        .insert(MemorySubsystem::ParserCache, 4);
+
+    // 7 MB cached; dropping the largest background tree is enough
+    let cmd = update(
+        &mut model,
+        report(0, &[(visible, 3 * MB), (20, MB), (21, 3 * MB)]),
+    );
+    assert_eq!(evicted(cmd), vec![21]);
+    assert_eq!(model.memory.parser_cache_bytes(), 4 * MB);
+
+    // Visible documents are kept even when that leaves the cache over
+    model
+        .config
+        .memory_caps_mb
+        .insert(MemorySubsystem::ParserCache, 1);
+    let cmd = update(&mut model, report(0, &[(visible, 3 * MB), (20, MB)]));
+    assert_eq!(evicted(cmd), vec![20]);
+    let cmd = update(&mut model, report(0, &[(visible, 3 * MB)]));
+    assert!(evicted(cmd).is_empty());
+}
@@ -10,6 +10,7 @@ use token::messages::{ModalMsg, Msg, UiMsg};
 use token::model::{
     CommandPaletteState, FindReplaceState, GotoLineState, ModalId, ModalState, ThemePickerState,
 };
+use token::replay::{Session, SessionHeader, SessionRecorder};
 use token::update::update;
 
 // Helper to create a CommandPaletteState with initial text
@@ -589,3 +590,38 @@ fn test_open_find_replace_message() {
         ModalId::FindReplace
     );
 }
+
+// ========================================================================
+// Session Replay Tests
+// ========================================================================
+
+#[test]
+fn test_replayed_session_opens_find_replace_and_types_query() {
+    let header = SessionHeader::new((800, 600), 1.0, Vec::new());
+    let mut recorder = SessionRecorder::new(Vec::new(), &header).unwrap();
+    let mut model = test_model("hello\n", 0, 0);
+
+    let msgs = [
+        Msg::Ui(UiMsg::ToggleModal(ModalId::FindReplace)),
+        Msg::Ui(UiMsg::Modal(ModalMsg::InsertChar('h'))),
+        Msg::Ui(UiMsg::Modal(ModalMsg::InsertChar('i'))),
+    ];
+    for msg in msgs {
+        assert!(recorder.record(&msg).unwrap());
+        update(&mut model, msg);
+    }
+
+    let session = Session::read(recorder.into_inner().as_slice()).unwrap();
+    let mut replayed = test_model("hello\n", 0, 0);
+    for event in session.events {
+        update(&mut replayed, event.msg.into_msg());
+    }
+
+    for model in [&model, &replayed] {
+        if let Some(ModalState::FindReplace(state)) = &model.ui.active_modal {
+            assert_eq!(state.query(), "hi");
+        } else {
+            panic!("Expected find/replace modal");
+        }
+    }
+}
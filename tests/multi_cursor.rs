@@ -1220,3 +1220,99 @@ fn test_auto_surround_with_overlapping_occurrences_does_not_corrupt_buffer() {
     // the whole overlapping span is wrapped exactly once.
     assert_eq!(text, "(aaaa)");
 }
+
+// ========================================================================
+// Batched multi-cursor edits
+// ========================================================================
+
+#[test]
+fn test_insert_char_multi_cursor_same_line() {
+    let mut model = test_model("abc\n", 0, 0);
+    model.editor_mut().add_cursor_at(0, 1);
+    model.editor_mut().add_cursor_at(0, 2);
+
+    update(&mut model, Msg::Document(DocumentMsg::InsertChar('X')));
+
+    assert_eq!(model.document().buffer.to_string(), "XaXbXc\n");
+    let columns: Vec<usize> = model.editor().cursors.iter().map(|c| c.column).collect();
+    assert_eq!(
+        columns,
+        vec![1, 3, 5],
+        "Cursors on the same line should move past every earlier insert"
+    );
+
+    update(&mut model, Msg::Document(DocumentMsg::Undo));
+    assert_eq!(model.document().buffer.to_string(), "abc\n");
+}
+
+#[test]
+fn test_delete_backward_multi_cursor_same_line() {
+    let mut model = test_model("abcd\n", 0, 1);
+    model.editor_mut().add_cursor_at(0, 3);
+
+    update(&mut model, Msg::Document(DocumentMsg::DeleteBackward));
+
+    assert_eq!(model.document().buffer.to_string(), "bd\n");
+    let columns: Vec<usize> = model.editor().cursors.iter().map(|c| c.column).collect();
+    assert_eq!(columns, vec![0, 1]);
+}
+
+#[test]
+fn test_delete_forward_newline_multi_cursor_adjusts_positions() {
+    let mut model = test_model("ab\ncd\nef", 0, 2);
+    model.editor_mut().add_cursor_at(1, 2);
+
+    update(&mut model, Msg::Document(DocumentMsg::DeleteForward));
+
+    assert_eq!(model.document().buffer.to_string(), "abcdef");
+    let positions: Vec<(usize, usize)> = model
+        .editor()
+        .cursors
+        .iter()
+        .map(|c| (c.line, c.column))
+        .collect();
+    assert_eq!(positions, vec![(0, 2), (0, 4)]);
+}
+
+#[test]
+fn test_insert_char_replaces_multi_cursor_selections() {
+    let mut model = test_model("foo bar foo\n", 0, 3);
+    model.editor_mut().selections[0].anchor = Position::new(0, 0);
+    model.editor_mut().selections[0].head = Position::new(0, 3);
+    model.editor_mut().add_cursor_at(0, 11);
+    model.editor_mut().selections[1].anchor = Position::new(0, 8);
+    model.editor_mut().selections[1].head = Position::new(0, 11);
+
+    update(&mut model, Msg::Document(DocumentMsg::InsertChar('x')));
+
+    assert_eq!(model.document().buffer.to_string(), "x bar x\n");
+    assert!(model.editor().selections.iter().all(|s| s.is_empty()));
+
+    update(&mut model, Msg::Document(DocumentMsg::Undo));
+    assert_eq!(model.document().buffer.to_string(), "foo bar foo\n");
+}
+
+#[test]
+fn test_insert_char_with_a_thousand_cursors_is_one_undo_step() {
+    let text = "line\n".repeat(1000);
+    let mut model = test_model(&text, 0, 0);
+    for line in 1..1000 {
+        model.editor_mut().add_cursor_at(line, 0);
+    }
+    assert_eq!(model.editor().cursor_count(), 1000);
+
+    update(&mut model, Msg::Document(DocumentMsg::InsertChar('X')));
+
+    assert_eq!(model.document().buffer.to_string(), "Xline\n".repeat(1000));
+    assert!(model
+        .editor()
+        .cursors
+        .iter()
+        .enumerate()
+        .all(|(line, c)| c.line == line && c.column == 1));
+    assert_eq!(model.document().undo_stack.len(), 1);
+
+    update(&mut model, Msg::Document(DocumentMsg::Undo));
+    assert_eq!(model.document().buffer.to_string(), text);
+    assert_eq!(model.editor().cursor_count(), 1000);
+}
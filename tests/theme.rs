@@ -101,6 +101,29 @@ fn test_all_builtin_themes_parse() {
     }
 }
 
+#[test]
+fn test_highlight_colors_match_syntax_theme() {
+    use token::syntax::{HighlightId, HIGHLIGHT_NAMES};
+
+    for builtin in BUILTIN_THEMES {
+        let theme = Theme::from_yaml(builtin.yaml).unwrap();
+        for id in 0..HIGHLIGHT_NAMES.len() as HighlightId {
+            assert_eq!(
+                theme.highlight_colors.get(id),
+                theme.syntax.color_for_highlight(id).to_argb_u32(),
+                "Theme '{}' highlight {}",
+                builtin.id,
+                HIGHLIGHT_NAMES[id as usize]
+            );
+        }
+        // Unknown ids fall back to plain text
+        assert_eq!(
+            theme.highlight_colors.get(HighlightId::MAX),
+            theme.syntax.text.to_argb_u32()
+        );
+    }
+}
+
 // ============================================================================
 // Theme loading tests
 // ============================================================================
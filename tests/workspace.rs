@@ -8,7 +8,9 @@ use std::collections::HashSet;
 use std::path::PathBuf;
 
 use token::messages::{Msg, WorkspaceMsg};
-use token::model::{FileExtension, FileNode, FileTree, FocusTarget, ScaledMetrics, Workspace};
+use token::model::{
+    FileExtension, FileNode, FileTree, FocusTarget, ScaledMetrics, ScanState, Workspace,
+};
 use token::update::update;
 
 // ============================================================================
@@ -294,6 +296,7 @@ fn test_workspace() -> Workspace {
         sidebar_visible: true,
         sidebar_width_logical: metrics.sidebar_default_width_logical,
         scroll_offset: 0,
+        scan: ScanState::default(),
     }
 }
 
@@ -677,6 +680,301 @@ fn test_workspace_open_or_toggle_folder() {
     assert!(!model.workspace.as_ref().unwrap().is_expanded(&folder_path));
 }
 
+// ============================================================================
+// Disk scanning tests
+// ============================================================================
+
+fn file_names(ws: &Workspace) -> Vec<String> {
+    let mut names: Vec<String> = ws
+        .file_tree
+        .get_all_file_paths()
+        .iter()
+        .map(|path| {
+            path.strip_prefix(&ws.root)
+                .unwrap()
+                .to_string_lossy()
+                .replace('\\', "/")
+        })
+        .collect();
+    names.sort();
+    names
+}
+
+fn write_file(path: &std::path::Path) {
+    std::fs::create_dir_all(path.parent().unwrap()).unwrap();
+    std::fs::write(path, "").unwrap();
+}
+
+#[test]
+fn test_workspace_scan_honors_gitignore() {
+    let dir = tempfile::tempdir().unwrap();
+    let root = dir.path();
+    std::fs::write(root.join(".gitignore"), "*.log\nbuild/\n").unwrap();
+    write_file(&root.join("src/main.rs"));
+    write_file(&root.join("src/debug.log"));
+    write_file(&root.join("build/out.rs"));
+    write_file(&root.join("node_modules/dep/index.js"));
+    std::fs::write(root.join("src/.gitignore"), "!keep.log\n").unwrap();
+    write_file(&root.join("src/keep.log"));
+
+    let ws = Workspace::new(root.to_path_buf(), &ScaledMetrics::new(1.0)).unwrap();
+    assert_eq!(
+        file_names(&ws),
+        vec![
+            ".gitignore",
+            "src/.gitignore",
+            "src/keep.log",
+            "src/main.rs"
+        ]
+    );
+}
+
+#[test]
+fn test_workspace_open_streams_scan_batches() {
+    let dir = tempfile::tempdir().unwrap();
+    let root = dir.path();
+    for i in 0..5 {
+        write_file(&root.join(format!("dir{}/nested/file{}.rs", i, i)));
+    }
+    write_file(&root.join("top.rs"));
+
+    let (mut ws, request) = Workspace::open(root.to_path_buf(), &ScaledMetrics::new(1.0)).unwrap();
+    // Only the root is listed up front
+    assert_eq!(file_names(&ws), vec!["top.rs"]);
+    assert!(ws.is_scanning());
+
+    let generation = request.generation;
+    token::model::workspace_scan::scan_directories(request.dirs, |dirs| {
+        ws.apply_scan_batch(generation, dirs);
+        true
+    });
+    ws.finish_scan(generation);
+
+    assert!(!ws.is_scanning());
+    assert_eq!(file_names(&ws).len(), 6);
+    assert!(file_names(&ws).contains(&"dir3/nested/file3.rs".to_string()));
+}
+
+#[test]
+fn test_workspace_stale_scan_batches_are_dropped() {
+    let dir = tempfile::tempdir().unwrap();
+    let root = dir.path();
+    write_file(&root.join("a/one.rs"));
+
+    let (mut ws, stale) = Workspace::open(root.to_path_buf(), &ScaledMetrics::new(1.0)).unwrap();
+    let current = ws.start_scan().unwrap();
+    assert_ne!(stale.generation, current.generation);
+
+    token::model::workspace_scan::scan_directories(stale.dirs, |dirs| {
+        ws.apply_scan_batch(stale.generation, dirs);
+        true
+    });
+    ws.finish_scan(stale.generation);
+    assert!(file_names(&ws).is_empty());
+    assert!(ws.is_scanning());
+}
+
+#[test]
+fn test_workspace_expand_loads_unscanned_folder() {
+    let dir = tempfile::tempdir().unwrap();
+    let root = dir.path();
+    write_file(&root.join("src/lib.rs"));
+
+    let (mut ws, _request) = Workspace::open(root.to_path_buf(), &ScaledMetrics::new(1.0)).unwrap();
+    let src = ws.root.join("src");
+    assert!(file_names(&ws).is_empty());
+
+    ws.expand_folder(&src);
+    assert_eq!(file_names(&ws), vec!["src/lib.rs"]);
+}
+
+#[test]
+fn test_workspace_update_paths_patches_nodes() {
+    let dir = tempfile::tempdir().unwrap();
+    let root = dir.path();
+    write_file(&root.join("src/a.rs"));
+    write_file(&root.join("src/c.rs"));
+
+    let mut ws = Workspace::new(root.to_path_buf(), &ScaledMetrics::new(1.0)).unwrap();
+    let src = ws.root.join("src");
+
+    // Created file is inserted in sorted position
+    write_file(&src.join("b.rs"));
+    assert!(ws.update_paths(&[src.join("b.rs")]).is_none());
+    assert_eq!(file_names(&ws), vec!["src/a.rs", "src/b.rs", "src/c.rs"]);
+
+    // Deleted file is removed; modified files are left alone
+    std::fs::remove_file(src.join("a.rs")).unwrap();
+    assert!(ws
+        .update_paths(&[src.join("a.rs"), src.join("c.rs")])
+        .is_none());
+    assert_eq!(file_names(&ws), vec!["src/b.rs", "src/c.rs"]);
+    let index = ws.file_tree.file_index();
+    assert_eq!(index.len(), 2);
+    assert!(index.contains(&src.join("b.rs")));
+    assert!(!index.contains(&src.join("a.rs")));
+
+    // Gitignored files are not added
+    std::fs::write(ws.root.join(".gitignore"), "*.tmp\n").unwrap();
+    write_file(&src.join("scratch.tmp"));
+    let request = ws
+        .update_paths(&[ws.root.join(".gitignore"), src.join("scratch.tmp")])
+        .expect("gitignore change rescans its directory");
+    assert_eq!(request.dirs.len(), 1);
+    assert!(!file_names(&ws).contains(&"src/scratch.tmp".to_string()));
+
+    // A created directory is inserted unloaded and its contents scanned
+    write_file(&ws.root.join("tests/it.rs"));
+    let request = ws.update_paths(&[ws.root.join("tests")]).unwrap();
+    assert_eq!(request.dirs[0].0, ws.root.join("tests"));
+    let generation = request.generation;
+    token::model::workspace_scan::scan_directories(request.dirs, |dirs| {
+        ws.apply_scan_batch(generation, dirs);
+        true
+    });
+    assert!(file_names(&ws).contains(&"tests/it.rs".to_string()));
+    assert!(ws
+        .file_tree
+        .file_index()
+        .contains(&ws.root.join("tests/it.rs")));
+
+    // Removing a directory drops its files from the index
+    std::fs::remove_dir_all(ws.root.join("tests")).unwrap();
+    ws.update_paths(&[ws.root.join("tests")]);
+    assert!(!ws
+        .file_tree
+        .file_index()
+        .contains(&ws.root.join("tests/it.rs")));
+}
+
+// ============================================================================
+// Find in files tests
+// ============================================================================
+
+fn run_search(
+    state: &mut token::model::FindInFilesState,
+    request: token::model::FileSearchRequest,
+) {
+    let summary = token::model::find_in_files::search_files(&request, |files| {
+        state.apply_batch(request.id, files);
+        true
+    });
+    state.finish(request.id, summary);
+}
+
+#[test]
+fn test_find_in_files_searches_workspace_and_unsaved_buffers() {
+    let dir = tempfile::tempdir().unwrap();
+    let root = dir.path();
+    std::fs::create_dir_all(root.join("src")).unwrap();
+    std::fs::write(
+        root.join("src/lib.rs"),
+        "fn needle() {}
+// a Needle
+",
+    )
+    .unwrap();
+    std::fs::write(
+        root.join("src/main.rs"),
+        "fn main() {}
+",
+    )
+    .unwrap();
+    std::fs::write(root.join("blob.bin"), b"needle\0\x01\x02").unwrap();
+    let ws = Workspace::new(root.to_path_buf(), &ScaledMetrics::new(1.0)).unwrap();
+
+    let mut state = token::model::FindInFilesState::default();
+    // The unsaved buffer of main.rs is searched instead of the file
+    let buffers = vec![(
+        ws.root.join("src/main.rs"),
+        ropey::Rope::from_str("fn main() {\n    needle();\n}\n"),
+    )];
+    let request = state
+        .start("needle", ws.file_tree.file_index(), buffers)
+        .unwrap();
+    assert!(!request.case_sensitive);
+    run_search(&mut state, request);
+
+    assert!(!state.searching);
+    let mut found: Vec<(String, Vec<usize>)> = state
+        .results
+        .iter()
+        .map(|file| {
+            let name = file.path.strip_prefix(&ws.root).unwrap();
+            let lines = file.lines.iter().map(|line| line.line).collect();
+            (name.to_string_lossy().replace('\\', "/"), lines)
+        })
+        .collect();
+    found.sort();
+    assert_eq!(
+        found,
+        vec![
+            ("src/lib.rs".to_string(), vec![0, 1]),
+            ("src/main.rs".to_string(), vec![1]),
+        ]
+    );
+    assert_eq!(state.match_count, 3);
+
+    // An uppercase letter makes the search case-sensitive
+    let request = state
+        .start("Needle", ws.file_tree.file_index(), vec![])
+        .unwrap();
+    run_search(&mut state, request);
+    assert_eq!(state.match_count, 1);
+    assert_eq!(
+        state.target(1).map(|(_, line, column)| (line, column)),
+        Some((1, 5))
+    );
+}
+
+#[test]
+fn test_find_in_files_drops_superseded_results() {
+    use common::test_model;
+    use token::messages::FindInFilesMsg;
+
+    let dir = tempfile::tempdir().unwrap();
+    std::fs::write(dir.path().join("a.txt"), "one two\n").unwrap();
+    let ws = Workspace::new(dir.path().to_path_buf(), &ScaledMetrics::new(1.0)).unwrap();
+
+    let mut model = test_model("", 0, 0);
+    let stale = model
+        .find_in_files
+        .start("one", ws.file_tree.file_index(), vec![])
+        .unwrap();
+    let current = model
+        .find_in_files
+        .start("two", ws.file_tree.file_index(), vec![])
+        .unwrap();
+    assert!(stale.cancel.load(std::sync::atomic::Ordering::Relaxed));
+
+    // Results of the superseded search arriving late are dropped
+    let stale = token::model::FileSearchRequest {
+        cancel: Default::default(),
+        ..stale
+    };
+    for request in [stale, current] {
+        let search_id = request.id;
+        let mut batches = Vec::new();
+        let summary = token::model::find_in_files::search_files(&request, |files| {
+            batches.push(files);
+            true
+        });
+        for files in batches {
+            update(
+                &mut model,
+                Msg::FindInFiles(FindInFilesMsg::Results { search_id, files }),
+            );
+        }
+        update(
+            &mut model,
+            Msg::FindInFiles(FindInFilesMsg::Finished { search_id, summary }),
+        );
+    }
+
+    assert_eq!(model.find_in_files.match_count, 1);
+    assert_eq!(model.find_in_files.results[0].lines[0].column, 4);
+}
+
 // ============================================================================
 // Sidebar resize tests
 // ============================================================================